@@ -0,0 +1,156 @@
+#include "draw_packet.h"
+#include <benchmark/benchmark.h>
+
+using namespace Renderer;
+
+namespace
+{
+	//Submeshes per object and materials,roughly what the Bistro scene sorts into.
+	constexpr uint32_t PACKETS_PER_OBJECT = 4;
+	constexpr uint32_t MATERIALS = 512;
+
+	void BuildPackets(DrawPacketList& OutPackets, uint32_t InCount, std::mt19937& InRandom)
+	{
+		std::uniform_real_distribution<float> lDepth(0.0f, 500.0f);
+		OutPackets.Clear();
+		for (uint32_t i = 0; i < InCount; ++i)
+		{
+			if (i % PACKETS_PER_OBJECT == 0)
+			{
+				OutPackets.AddObject({});
+			}
+			DrawPacket lPacket = {};
+			lPacket.mIndexCount = 3 * (64 + InRandom() % 1024);
+			lPacket.mStartIndexLocation = InRandom();
+			lPacket.mObjectIndex = i / PACKETS_PER_OBJECT;
+			lPacket.mMaterial = InRandom() % MATERIALS;
+			//One submesh in three also goes to the depth prepass.
+			const auto lPass = i % 3 == 0 ? DrawPass::DEPTH_ONLY : DrawPass::COLOR;
+			const auto lPipeline = lPass == DrawPass::COLOR ? DrawPipeline::COLOR_MSAA : DrawPipeline::DEPTH_ONLY;
+			OutPackets.Add(DrawKey::Make(lPass, lPipeline, lPacket.mMaterial, lDepth(InRandom)), lPacket);
+		}
+	}
+}
+
+static void BM_DrawPacketBuild(benchmark::State& state)
+{
+	const uint32_t lCount = uint32_t(state.range(0));
+	std::mt19937 lRandom(5);
+	DrawPacketList lPackets;
+	for (auto _ : state)
+	{
+		BuildPackets(lPackets, lCount, lRandom);
+		benchmark::DoNotOptimize(lPackets.Size());
+	}
+	state.SetItemsProcessed(state.iterations() * lCount);
+}
+BENCHMARK(BM_DrawPacketBuild)->Arg(50000)->Arg(500000)->Unit(benchmark::kMillisecond);
+
+static void BM_DrawPacketSortSerial(benchmark::State& state)
+{
+	const uint32_t lCount = uint32_t(state.range(0));
+	std::mt19937 lRandom(5);
+	DrawPacketList lPackets;
+	for (auto _ : state)
+	{
+		state.PauseTiming();
+		BuildPackets(lPackets, lCount, lRandom);
+		state.ResumeTiming();
+		lPackets.Sort();
+		benchmark::DoNotOptimize(lPackets.GetSortedRange(DrawPass::COLOR).data());
+	}
+	state.SetItemsProcessed(state.iterations() * lCount);
+}
+BENCHMARK(BM_DrawPacketSortSerial)->Arg(50000)->Arg(500000)->Unit(benchmark::kMillisecond);
+
+static void BM_DrawPacketSortTaskflow(benchmark::State& state)
+{
+	const uint32_t lCount = uint32_t(state.range(0));
+	std::mt19937 lRandom(5);
+	DrawPacketList lPackets;
+	tf::Executor lExecutor;
+	tf::Taskflow lFlow;
+	lPackets.EmplaceSortTasks(lFlow);
+	for (auto _ : state)
+	{
+		state.PauseTiming();
+		BuildPackets(lPackets, lCount, lRandom);
+		state.ResumeTiming();
+		lExecutor.run(lFlow).wait();
+		benchmark::DoNotOptimize(lPackets.GetSortedRange(DrawPass::COLOR).data());
+	}
+	state.counters["workers"] = double(lExecutor.num_workers());
+	state.SetItemsProcessed(state.iterations() * lCount);
+}
+BENCHMARK(BM_DrawPacketSortTaskflow)->Arg(50000)->Arg(500000)->Unit(benchmark::kMillisecond)->UseRealTime();
+
+//Baseline:comparison sort of the same key and index pairs.
+static void BM_DrawPacketStdSort(benchmark::State& state)
+{
+	const uint32_t lCount = uint32_t(state.range(0));
+	std::mt19937 lRandom(5);
+	std::uniform_real_distribution<float> lDepth(0.0f, 500.0f);
+	std::vector<DrawPacketList::SortItem> lSource;
+	for (uint32_t i = 0; i < lCount; ++i)
+	{
+		lSource.push_back({ DrawKey::Make(DrawPass::COLOR, DrawPipeline::COLOR_MSAA, lRandom() % MATERIALS, lDepth(lRandom)), i });
+	}
+	std::vector<DrawPacketList::SortItem> lItems;
+	for (auto _ : state)
+	{
+		state.PauseTiming();
+		lItems = lSource;
+		state.ResumeTiming();
+		std::sort(lItems.begin(), lItems.end(), [](const auto& a, const auto& b) { return a.mKey < b.mKey; });
+		benchmark::DoNotOptimize(lItems.data());
+	}
+	state.SetItemsProcessed(state.iterations() * lCount);
+}
+BENCHMARK(BM_DrawPacketStdSort)->Arg(50000)->Arg(500000)->Unit(benchmark::kMillisecond);
+
+//Recording the sorted color pass split into one range per worker,each on its own mock command list.
+//Draws stay the same,every extra list costs the state its first packet sets again.
+static void BM_DrawRecordParallel(benchmark::State& state)
+{
+	const uint32_t lCount = uint32_t(state.range(0));
+	const uint32_t lWorkers = uint32_t(state.range(1));
+	std::mt19937 lRandom(5);
+	DrawPacketList lPackets;
+	BuildPackets(lPackets, lCount, lRandom);
+	lPackets.Sort();
+	std::vector<std::span<const DrawPacketList::SortItem>> lRanges;
+	DrawPacketList::SplitRanges(lPackets.GetSortedRange(DrawPass::COLOR), lWorkers, 1, lRanges);
+	std::vector<CountingCommandList> lLists(lRanges.size());
+	//Never bound,the mock only copies the pointers.
+	std::array<ID3D12PipelineState*, (size_t)DrawPipeline::COUNT> lPipelines = {};
+	std::array<D3D12_INDEX_BUFFER_VIEW, 2> lIndexBuffers = {};
+	tf::Executor lExecutor(lWorkers);
+	tf::Taskflow lFlow;
+	lFlow.for_each_index(size_t(0), lRanges.size(), size_t(1), [&](size_t InRange)
+		{
+			lLists[InRange].Reset();
+			lPackets.Record(&lLists[InRange], lRanges[InRange], lPipelines, DrawPipeline::COLOR_MSAA, lIndexBuffers);
+		});
+	for (auto _ : state)
+	{
+		lExecutor.run(lFlow).wait();
+	}
+	uint32_t lDraws = 0;
+	uint32_t lStateChanges = 0;
+	size_t lBytes = 0;
+	for (const auto& list : lLists)
+	{
+		lDraws += list.GetDraws();
+		lStateChanges += list.GetStateChanges();
+		lBytes += list.GetBytes();
+	}
+	state.counters["lists"] = double(lLists.size());
+	state.counters["draws"] = double(lDraws);
+	state.counters["state_changes"] = double(lStateChanges);
+	state.counters["bytes"] = double(lBytes);
+	state.SetItemsProcessed(state.iterations() * lDraws);
+}
+BENCHMARK(BM_DrawRecordParallel)
+	->Args({ 16384, 1 })->Args({ 16384, 2 })->Args({ 16384, 4 })->Args({ 16384, 8 })
+	->Args({ 65536, 1 })->Args({ 65536, 2 })->Args({ 65536, 4 })->Args({ 65536, 8 })
+	->Unit(benchmark::kMicrosecond)->UseRealTime();
@@ -0,0 +1,138 @@
+#include "geometry_allocator.h"
+#include "synthetic_scene.h"
+#include <benchmark/benchmark.h>
+
+using namespace Renderer;
+
+namespace
+{
+	constexpr uint32_t LIVE_MESHES = 4096;
+	constexpr uint32_t CAPACITY = 1 << 24;
+
+	//Vertex counts of streamed meshes,mostly small props with a tail of large ones.
+	std::vector<uint32_t> MakeMeshSizes(uint32_t InCount)
+	{
+		std::mt19937 lRandom(3);
+		std::lognormal_distribution<double> lSize(6.0, 1.2);
+		std::vector<uint32_t> lSizes;
+		for (uint32_t i = 0; i < InCount; ++i)
+		{
+			lSizes.push_back(std::clamp<uint32_t>(uint32_t(lSize(lRandom)), 8, 65536));
+		}
+		return lSizes;
+	}
+
+	//What the pools did before the TLSF allocator:append only,freed ranges are never reused.
+	struct BumpAllocator
+	{
+		uint32_t Allocate(uint32_t InCount)
+		{
+			if (mHead + InCount > mCapacity)
+			{
+				return GeometryAllocator::INVALID_OFFSET;
+			}
+			const uint32_t lOffset = mHead;
+			mHead += InCount;
+			return lOffset;
+		}
+
+		uint32_t mCapacity = CAPACITY;
+		uint32_t mHead = 0;
+	};
+}
+
+//Streaming churn:each iteration unloads a random live mesh and loads a new one in its place.
+//Reports the cost per load/unload pair and how far the range has to reach to hold the live set.
+static void BM_GeometryAllocatorChurn(benchmark::State& state)
+{
+	const auto lSizes = MakeMeshSizes(LIVE_MESHES * 4);
+	GeometryAllocator lAllocator(CAPACITY);
+	std::vector<uint32_t> lLive;
+	for (uint32_t i = 0; i < LIVE_MESHES; ++i)
+	{
+		lLive.push_back(lAllocator.Allocate(lSizes[i]));
+	}
+	std::mt19937 lRandom(9);
+	std::uniform_int_distribution<uint32_t> lPick(0, LIVE_MESHES - 1);
+	size_t lNext = 0;
+	uint32_t lHighWater = 0;
+	for (auto _ : state)
+	{
+		const uint32_t lSlot = lPick(lRandom);
+		lAllocator.Free(lLive[lSlot]);
+		const uint32_t lSize = lSizes[lNext++ % lSizes.size()];
+		const uint32_t lOffset = lAllocator.Allocate(lSize);
+		if (lOffset == GeometryAllocator::INVALID_OFFSET)
+		{
+			state.SkipWithError("Out of space");
+			break;
+		}
+		lLive[lSlot] = lOffset;
+		lHighWater = std::max(lHighWater, lLive[lSlot] + lSize);
+		benchmark::DoNotOptimize(lLive[lSlot]);
+	}
+	const auto lStats = lAllocator.GetStats();
+	state.counters["used"] = double(lStats.mUsed);
+	state.counters["high_water"] = double(lHighWater);
+	state.counters["free_blocks"] = double(lStats.mFreeBlocks);
+	state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_GeometryAllocatorChurn);
+
+//Same churn on the bump allocator,cheaper per call but every load takes new space until the range is exhausted.
+static void BM_BumpAllocatorChurn(benchmark::State& state)
+{
+	const auto lSizes = MakeMeshSizes(LIVE_MESHES * 4);
+	BumpAllocator lAllocator;
+	for (uint32_t i = 0; i < LIVE_MESHES; ++i)
+	{
+		lAllocator.Allocate(lSizes[i]);
+	}
+	size_t lNext = 0;
+	uint32_t lFailures = 0;
+	for (auto _ : state)
+	{
+		const uint32_t lOffset = lAllocator.Allocate(lSizes[lNext++ % lSizes.size()]);
+		if (lOffset == GeometryAllocator::INVALID_OFFSET)
+		{
+			//Out of range,the pool would have to be rebuilt from the live meshes.
+			lFailures++;
+			lAllocator.mHead = 0;
+		}
+		benchmark::DoNotOptimize(lOffset);
+	}
+	state.counters["high_water"] = double(lAllocator.mHead);
+	state.counters["rebuilds"] = double(lFailures);
+	state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_BumpAllocatorChurn);
+
+//Planning and applying compaction after half the live meshes were unloaded.
+static void BM_GeometryAllocatorDefragment(benchmark::State& state)
+{
+	const auto lSizes = MakeMeshSizes(LIVE_MESHES);
+	const uint32_t lMaxMoves = uint32_t(state.range(0));
+	uint64_t lMoves = 0;
+	for (auto _ : state)
+	{
+		state.PauseTiming();
+		GeometryAllocator lAllocator(CAPACITY);
+		std::vector<uint32_t> lOffsets;
+		for (uint32_t size : lSizes)
+		{
+			lOffsets.push_back(lAllocator.Allocate(size));
+		}
+		for (size_t i = 0; i < lOffsets.size(); i += 2)
+		{
+			lAllocator.Free(lOffsets[i]);
+		}
+		state.ResumeTiming();
+		for (const auto& move : lAllocator.PlanDefragment(lMaxMoves))
+		{
+			lAllocator.Free(move.mFrom);
+			lMoves++;
+		}
+	}
+	state.counters["moves"] = benchmark::Counter(double(lMoves), benchmark::Counter::kAvgIterations);
+}
+BENCHMARK(BM_GeometryAllocatorDefragment)->Arg(16)->Arg(256)->Unit(benchmark::kMicrosecond);
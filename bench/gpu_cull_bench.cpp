@@ -0,0 +1,123 @@
+#include "gpu_cull.h"
+#include "occlusion_culling.h"
+#include "synthetic_scene.h"
+#include <benchmark/benchmark.h>
+
+using namespace Renderer;
+using namespace DirectX;
+
+namespace
+{
+	constexpr uint32_t DEPTH_WIDTH = 1920;
+	constexpr uint32_t DEPTH_HEIGHT = 1080;
+
+	SimpleMath::Matrix MakeStreetViewPrj()
+	{
+		const SimpleMath::Vector3 lEye(0.0f, 2.0f, 0.0f);
+		return Synthetic::MakeViewPrj(lEye, lEye + SimpleMath::Vector3(0.0f, 0.0f, 1.0f), XM_PIDIV2, float(DEPTH_WIDTH) / DEPTH_HEIGHT, 0.1f);
+	}
+
+	//Camera pass constants with the Hi-Z of a street level view into a 16 x 16 block city.
+	GpuCullConstants MakeCityConstants(std::vector<float>& OutHiZ)
+	{
+		const auto lViewPrj = MakeStreetViewPrj();
+		GpuCullConstants lConstants = {};
+		GpuCullReference::InitHiZLayout(lConstants, DEPTH_WIDTH, DEPTH_HEIGHT);
+		for (int i = 0; i < 4; ++i)
+		{
+			lConstants.mViewPrj[i] = XMFLOAT4(lViewPrj.m[i]);
+			lConstants.mOcclusionViewPrj[i] = XMFLOAT4(lViewPrj.m[i]);
+		}
+		lConstants.mPassFlag = GPU_INSTANCE_CAMERA;
+		lConstants.mClipPlanes = GPU_CULL_SIDE_PLANES | GPU_CULL_NEAR_PLANE;
+
+		SoftwareOcclusionCuller lCuller(DEPTH_WIDTH, DEPTH_HEIGHT);
+		lCuller.BeginFrame(lViewPrj);
+		for (const auto& building : Synthetic::MakeCity(16, 16, 16.0f, 8.0f, 7).mBuildings)
+		{
+			const auto lMesh = Synthetic::MakeBoxMesh(building);
+			lCuller.RasterizeOccluder(lMesh.mPositions.data(), sizeof(XMFLOAT3), lMesh.mPositions.size(), lMesh.mIndices, SimpleMath::Matrix::Identity);
+		}
+		GpuCullReference::BuildHiZ(lConstants, lCuller.GetDepth(), OutHiZ);
+		return lConstants;
+	}
+
+	std::vector<GpuInstance> MakeInstances(uint32_t InCount)
+	{
+		std::mt19937 lRandom(11);
+		std::uniform_real_distribution<float> lX(-200.0f, 200.0f);
+		std::uniform_real_distribution<float> lZ(-20.0f, 400.0f);
+		std::vector<GpuInstance> lInstances(InCount);
+		for (uint32_t i = 0; i < InCount; ++i)
+		{
+			lInstances[i].mBoundsCenter = XMFLOAT3(lX(lRandom), 1.0f, lZ(lRandom));
+			lInstances[i].mBoundsExtents = XMFLOAT3(1.0f, 1.0f, 1.0f);
+			lInstances[i].mFlags = GPU_INSTANCE_CAMERA | GPU_INSTANCE_SHADOW_CASTER;
+			lInstances[i].mIndexCount = 36;
+		}
+		return lInstances;
+	}
+}
+
+//One culling dispatch on the CPU:InInstances props tested against the frustum,and with occlusion on against the Hi-Z.
+static void BM_GpuCullReference(benchmark::State& state)
+{
+	std::vector<float> lHiZ;
+	GpuCullConstants lConstants = MakeCityConstants(lHiZ);
+	const auto lInstances = MakeInstances(uint32_t(state.range(0)));
+	lConstants.mInstanceCount = uint32_t(lInstances.size());
+	lConstants.mUseOcclusion = uint32_t(state.range(1));
+	GpuCullReference lReference;
+	for (auto _ : state)
+	{
+		lReference.Cull(lConstants, lInstances, lHiZ);
+		benchmark::DoNotOptimize(lReference.GetDraws().data());
+	}
+	const auto& lCounts = lReference.GetCounts();
+	state.counters["draws"] = lCounts.mDraws;
+	state.counters["frustum_culled"] = lCounts.mFrustumCulled;
+	state.counters["occlusion_culled"] = lCounts.mOcclusionCulled;
+	state.SetItemsProcessed(state.iterations() * lInstances.size());
+}
+BENCHMARK(BM_GpuCullReference)->Args({ 10000, 0 })->Args({ 10000, 1 })->Args({ 100000, 1 })->Unit(benchmark::kMicrosecond);
+
+//Hi-Z build of a full HD depth buffer,the farthest depth of 8x8 tiles and then every level down to one texel.
+static void BM_GpuCullBuildHiZ(benchmark::State& state)
+{
+	std::vector<float> lHiZ;
+	const GpuCullConstants lConstants = MakeCityConstants(lHiZ);
+	std::vector<float> lDepth(size_t(DEPTH_WIDTH) * DEPTH_HEIGHT);
+	std::mt19937 lRandom(5);
+	std::uniform_real_distribution<float> lDepthValue(0.0f, 1.0f);
+	for (auto& depth : lDepth)
+	{
+		depth = lDepthValue(lRandom);
+	}
+	for (auto _ : state)
+	{
+		GpuCullReference::BuildHiZ(lConstants, lDepth, lHiZ);
+		benchmark::DoNotOptimize(lHiZ.data());
+	}
+	state.SetItemsProcessed(state.iterations() * lDepth.size());
+}
+BENCHMARK(BM_GpuCullBuildHiZ)->Unit(benchmark::kMicrosecond);
+
+//Refilling the persistent instance table of a static scene,nothing changes so nothing is marked for upload.
+static void BM_GpuInstanceTableStatic(benchmark::State& state)
+{
+	const auto lInstances = MakeInstances(uint32_t(state.range(0)));
+	GpuInstanceTable lTable;
+	for (auto _ : state)
+	{
+		lTable.Begin();
+		for (const auto& instance : lInstances)
+		{
+			lTable.Add(instance);
+		}
+		lTable.End();
+		benchmark::DoNotOptimize(lTable.GetDirtyEnd());
+		lTable.ClearDirty();
+	}
+	state.SetItemsProcessed(state.iterations() * lInstances.size());
+}
+BENCHMARK(BM_GpuInstanceTableStatic)->Arg(10000)->Arg(100000);
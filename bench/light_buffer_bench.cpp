@@ -0,0 +1,98 @@
+#include "light_buffer.h"
+#include <benchmark/benchmark.h>
+
+using namespace Renderer;
+
+namespace
+{
+	constexpr uint32_t LIGHTS = 10000;
+
+	std::vector<ECS::LightComponent> MakeLights()
+	{
+		std::mt19937 lRandom(3);
+		std::uniform_real_distribution<float> lPosition(-100.0f, 100.0f);
+		std::vector<ECS::LightComponent> lLights(LIGHTS);
+		for (auto& light : lLights)
+		{
+			light.pos = { lPosition(lRandom), lPosition(lRandom), lPosition(lRandom), 1.0f };
+			light.radius_attenu = { 5.0f, 1.0f, 0.0f, 0.0f };
+		}
+		return lLights;
+	}
+
+	//InPerMille of the lights,as scattered slots or as runs of InRun neighbours like a moving group of lamps.
+	std::vector<uint32_t> MakeDirtySlots(uint32_t InPerMille, uint32_t InRun)
+	{
+		std::mt19937 lRandom(9);
+		std::vector<uint8_t> lDirty(LIGHTS, 0);
+		std::vector<uint32_t> lSlots;
+		while (lSlots.size() < size_t(LIGHTS) * InPerMille / 1000)
+		{
+			uint32_t lFirst = lRandom() % LIGHTS;
+			for (uint32_t i = lFirst; i < std::min(lFirst + InRun, LIGHTS); ++i)
+			{
+				if (!lDirty[i])
+				{
+					lDirty[i] = 1;
+					lSlots.push_back(i);
+				}
+			}
+		}
+		return lSlots;
+	}
+}
+
+//Per frame CPU side of the delta upload:convert the patched lights,coalesce their slots and pack them into the ring slice.
+static void BM_LightDeltaUpload(benchmark::State& state)
+{
+	const auto lComponents = MakeLights();
+	std::vector<ECS::LigthData> lLights(LIGHTS);
+	const auto lDirtySource = MakeDirtySlots(uint32_t(state.range(0)), uint32_t(state.range(1)));
+	std::vector<uint8_t> lSlice(lLights.size() * sizeof(ECS::LigthData));
+	std::vector<uint32_t> lDirty;
+	std::vector<LightCopy> lCopies;
+	uint32_t lBytes = 0;
+	for (auto _ : state)
+	{
+		lDirty = lDirtySource;
+		for (auto slot : lDirty)
+		{
+			lLights[slot] = LightBuffer::ToLightData(lComponents[slot]);
+		}
+		lCopies.clear();
+		LightBuffer::CoalesceCopies(lDirty, LIGHTS, lCopies);
+		lBytes = 0;
+		for (const auto& copy : lCopies)
+		{
+			memcpy(lSlice.data() + lBytes, &lLights[copy.mFirstSlot], copy.mCount * sizeof(ECS::LigthData));
+			lBytes += copy.mCount * sizeof(ECS::LigthData);
+		}
+		benchmark::DoNotOptimize(lSlice.data());
+	}
+	state.counters["dirty"] = double(lDirtySource.size());
+	state.counters["copies"] = double(lCopies.size());
+	state.counters["upload_bytes"] = double(lBytes);
+}
+BENCHMARK(BM_LightDeltaUpload)
+	->Args({ 10, 1 })->Args({ 100, 1 })->Args({ 400, 1 })
+	->Args({ 10, 16 })->Args({ 100, 16 })->Args({ 400, 16 })
+	->Args({ 1000, 1 });
+
+//Baseline:rebuild and upload every light each frame,what the renderer did before the registry signals.
+static void BM_LightFullUpload(benchmark::State& state)
+{
+	const auto lComponents = MakeLights();
+	std::vector<ECS::LigthData> lLights(LIGHTS);
+	std::vector<uint8_t> lSlice(lLights.size() * sizeof(ECS::LigthData));
+	for (auto _ : state)
+	{
+		for (uint32_t i = 0; i < LIGHTS; ++i)
+		{
+			lLights[i] = LightBuffer::ToLightData(lComponents[i]);
+		}
+		memcpy(lSlice.data(), lLights.data(), lSlice.size());
+		benchmark::DoNotOptimize(lSlice.data());
+	}
+	state.counters["upload_bytes"] = double(lSlice.size());
+}
+BENCHMARK(BM_LightFullUpload);
@@ -0,0 +1,79 @@
+#include "cluster_light_cull.h"
+#include "zbin_light_cull.h"
+#include "light_buffer.h"
+#include "synthetic_scene.h"
+#include <benchmark/benchmark.h>
+
+using namespace Renderer;
+
+namespace
+{
+	constexpr uint32_t WIDTH = 1920;
+	constexpr uint32_t HEIGHT = 1080;
+
+	//Point lights of 3 to 8 units filling the view frustum up to 100 units deep.
+	std::vector<ECS::LigthData> MakeLights(uint32_t InCount)
+	{
+		std::mt19937 lRandom(5);
+		std::uniform_real_distribution<float> lDepth(2.0f, 100.0f);
+		std::uniform_real_distribution<float> lUnit(-1.0f, 1.0f);
+		std::uniform_real_distribution<float> lRange(3.0f, 8.0f);
+		std::vector<ECS::LigthData> lLights;
+		for (uint32_t i = 0; i < InCount; ++i)
+		{
+			const float lZ = lDepth(lRandom);
+			ECS::LightComponent lLight;
+			lLight.pos = { lUnit(lRandom) * lZ, lUnit(lRandom) * lZ * HEIGHT / WIDTH, lZ, 1.0f };
+			lLight.radius_attenu = { lRange(lRandom), 1.0f, 0.0f, 0.0f };
+			lLights.push_back(LightBuffer::ToLightData(lLight));
+		}
+		return lLights;
+	}
+}
+
+//Compacted per cluster light lists on the default 32x16x16 grid as the light count scales.
+//mask_bytes is what the per cluster bit mask the lists replaced would take for the same lights.
+static void BM_ClusterLightCull(benchmark::State& state)
+{
+	const auto lLights = MakeLights(uint32_t(state.range(0)));
+	auto lFrame = Synthetic::MakeFrameData(WIDTH, HEIGHT, { 0.0f, 0.0f, 0.0f }, { 0.0f, 0.0f, 1.0f });
+	lFrame.LightCount = (uint32_t)lLights.size();
+	tf::Executor lExecutor(1);
+	ClusterLightCuller lCuller(lExecutor);
+	for (auto _ : state)
+	{
+		lCuller.Cull(lFrame, lLights);
+		benchmark::DoNotOptimize(lCuller.GetLightIndices().data());
+	}
+	const auto& lStats = lCuller.GetStats();
+	state.counters["assignments"] = double(lStats.mAssignments);
+	state.counters["dropped"] = double(lStats.mDroppedAssignments);
+	state.counters["max_cluster_lights"] = double(lStats.mMaxClusterLights);
+	state.counters["list_bytes"] = double(lStats.mListBytes);
+	state.counters["mask_bytes"] = double(lStats.mMaskBytes);
+	state.SetItemsProcessed(state.iterations() * lLights.size());
+}
+BENCHMARK(BM_ClusterLightCull)->Arg(256)->Arg(1024)->Arg(4096)->Arg(16384)->Unit(benchmark::kMillisecond);
+
+//Z-binned culling over the same lights,sorting,bins and tile rects plus the tile masks the GPU would expand.
+//Its memory grows with tiles * lights / 32 instead of with the cluster count.
+static void BM_ZBinLightCull(benchmark::State& state)
+{
+	const auto lLights = MakeLights(uint32_t(state.range(0)));
+	auto lFrame = Synthetic::MakeFrameData(WIDTH, HEIGHT, { 0.0f, 0.0f, 0.0f }, { 0.0f, 0.0f, 1.0f });
+	lFrame.LightCount = (uint32_t)lLights.size();
+	lFrame.ZBinWordsPerTile = ZBinLightCuller::GetWordsPerTile(lFrame.LightCount);
+	tf::Executor lExecutor(1);
+	ZBinLightCuller lCuller(lExecutor);
+	for (auto _ : state)
+	{
+		lCuller.Cull(lFrame, lLights, WIDTH, HEIGHT, true);
+		benchmark::DoNotOptimize(lCuller.GetTileMasks().data());
+	}
+	const auto& lStats = lCuller.GetStats();
+	state.counters["tile_assignments"] = double(lStats.mTileAssignments);
+	state.counters["used_bins"] = double(lStats.mUsedBins);
+	state.counters["memory_bytes"] = double(lStats.mMemoryBytes);
+	state.SetItemsProcessed(state.iterations() * lLights.size());
+}
+BENCHMARK(BM_ZBinLightCull)->Arg(256)->Arg(1024)->Arg(4096)->Arg(16384)->Unit(benchmark::kMillisecond);
@@ -0,0 +1,112 @@
+#include "mesh_store.h"
+#include "synthetic_scene.h"
+#include <benchmark/benchmark.h>
+
+using namespace ECS;
+
+namespace
+{
+	constexpr uint32_t SUBMESHES_PER_MESH = 4;
+
+	//The render component as it was before the MeshStore split:geometry,material names and meshlets live inline.
+	struct LegacyStaticMeshComponent : public Component
+	{
+		std::vector<Renderer::Vertex> mVertices;
+		std::vector<uint32_t> mIndices;
+		UINT mVertexCount = 0;
+		UINT mIndexCount = 0;
+		UINT StartIndexLocation = 0;
+		INT BaseVertexLocation = 0;
+		std::unordered_map<MaterialIndex, SubMesh> mSubMeshes;
+		std::unordered_map<MaterialIndex, std::string> mMatBaseColorName;
+		std::unordered_map<MaterialIndex, std::string> mMatNormalMapName;
+		DirectX::XMFLOAT3 mBaseColor = {};
+		MaterialName MatName;
+		MaterialName NormalMap;
+		uint32_t mMeshletOffsetWithInThreadGroup = 0;
+		StaticMeshComponentMeshOffset mMeshOffsetWithinScene;
+		std::vector<std::array<DirectX::Meshlet, MAX_MESHLET_PER_THREAD_GROUP>> mMeshlets;
+		std::vector<DirectX::XMFLOAT3> mMeshletsVerticesPosition;
+		std::vector<DirectX::MeshletTriangle> mMeshletPrimditives;
+		std::vector<uint32_t> mMeshletsIndices;
+	};
+
+	LegacyStaticMeshComponent MakeLegacyComponent(StaticMesh&& InMesh)
+	{
+		LegacyStaticMeshComponent lComponent;
+		lComponent.mVertexCount = (UINT)InMesh.mVertices.size();
+		lComponent.mIndexCount = (UINT)InMesh.mIndices.size();
+		lComponent.mVertices = std::move(InMesh.mVertices);
+		lComponent.mIndices = std::move(InMesh.mIndices);
+		lComponent.mSubMeshes = std::move(InMesh.mSubmeshMap);
+		for (const auto& [matid, subMesh] : lComponent.mSubMeshes)
+		{
+			lComponent.mMatBaseColorName[matid] = "base_color_" + std::to_string(matid) + ".png";
+			lComponent.mMatNormalMapName[matid] = "normal_" + std::to_string(matid) + ".png";
+		}
+		lComponent.mName = InMesh.mName;
+		lComponent.mMeshlets.resize(1);
+		return lComponent;
+	}
+}
+
+//Walk every mesh entity and every submesh the way the draw packet build does,hot component plus MeshStore ranges.
+static void BM_MeshStoreIterate(benchmark::State& state)
+{
+	Synthetic::ScopedAssetRegistry lAssets;
+	const uint32_t lCount = uint32_t(state.range(0));
+	entt::registry lRegistry;
+	MeshStore lStore;
+	for (uint32_t i = 0; i < lCount; ++i)
+	{
+		auto lEntity = lRegistry.create();
+		auto lComponent = lStore.Add(Synthetic::MakeCubeStaticMesh(SUBMESHES_PER_MESH, "mesh" + std::to_string(i)));
+		lComponent.StartIndexLocation = i * 36;
+		lRegistry.emplace<StaticMeshComponent>(lEntity, lComponent);
+	}
+	for (auto _ : state)
+	{
+		uint64_t lSum = 0;
+		auto lLock = lStore.ReadLock();
+		lRegistry.view<StaticMeshComponent>().each([&](const StaticMeshComponent& InComponent)
+			{
+				for (const auto& subMesh : lStore.GetSubMeshes(InComponent))
+				{
+					lSum += InComponent.StartIndexLocation + subMesh.IndexOffset + subMesh.IndexCount + subMesh.Material;
+				}
+			});
+		benchmark::DoNotOptimize(lSum);
+	}
+	state.counters["component_bytes"] = double(sizeof(StaticMeshComponent));
+	state.SetItemsProcessed(state.iterations() * lCount * SUBMESHES_PER_MESH);
+}
+BENCHMARK(BM_MeshStoreIterate)->Arg(10000)->Arg(100000);
+
+//Baseline:the same walk over the fat component and its per entity submesh hash map.
+static void BM_LegacyComponentIterate(benchmark::State& state)
+{
+	const uint32_t lCount = uint32_t(state.range(0));
+	entt::registry lRegistry;
+	for (uint32_t i = 0; i < lCount; ++i)
+	{
+		auto lEntity = lRegistry.create();
+		auto& lComponent = lRegistry.emplace<LegacyStaticMeshComponent>(lEntity,
+			MakeLegacyComponent(Synthetic::MakeCubeStaticMesh(SUBMESHES_PER_MESH, "mesh" + std::to_string(i))));
+		lComponent.StartIndexLocation = i * 36;
+	}
+	for (auto _ : state)
+	{
+		uint64_t lSum = 0;
+		lRegistry.view<LegacyStaticMeshComponent>().each([&](const LegacyStaticMeshComponent& InComponent)
+			{
+				for (const auto& [matid, subMesh] : InComponent.mSubMeshes)
+				{
+					lSum += InComponent.StartIndexLocation + subMesh.IndexOffset + subMesh.TriangleCount * 3 + matid;
+				}
+			});
+		benchmark::DoNotOptimize(lSum);
+	}
+	state.counters["component_bytes"] = double(sizeof(LegacyStaticMeshComponent));
+	state.SetItemsProcessed(state.iterations() * lCount * SUBMESHES_PER_MESH);
+}
+BENCHMARK(BM_LegacyComponentIterate)->Arg(10000)->Arg(100000);
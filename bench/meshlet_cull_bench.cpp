@@ -0,0 +1,70 @@
+#include "meshlet_cull.h"
+#include "synthetic_scene.h"
+#include <benchmark/benchmark.h>
+
+using namespace Renderer;
+using namespace DirectX;
+
+namespace
+{
+	struct MeshletBatch
+	{
+		MeshletCullReference mReference;
+		std::vector<MeshletInstance> mInstances;
+		std::vector<MeshletGroup> mGroups;
+	};
+
+	//InInstances spheres of 512 meshlets scattered in front of the camera,grouped the way DXRRenderer builds its table.
+	void MakeBatch(uint32_t InInstances, MeshletBatch& OutBatch)
+	{
+		std::vector<MeshletCullBounds> lBounds;
+		for (const auto& meshlet : Synthetic::MakeSphereMeshlets(32, 64, 2))
+		{
+			lBounds.push_back(MeshletCullReference::MakeBounds(Synthetic::MakeCullData(meshlet)));
+		}
+		OutBatch.mReference.AddMesh(0, lBounds);
+
+		std::mt19937 lRandom(13);
+		std::uniform_real_distribution<float> lX(-150.0f, 150.0f);
+		std::uniform_real_distribution<float> lZ(-20.0f, 300.0f);
+		std::uniform_real_distribution<float> lScale(0.5f, 3.0f);
+		for (uint32_t i = 0; i < InInstances; ++i)
+		{
+			const auto lModel = SimpleMath::Matrix::CreateScale(lScale(lRandom)) * SimpleMath::Matrix::CreateTranslation(lX(lRandom), 1.0f, lZ(lRandom));
+			OutBatch.mInstances.push_back(MeshletCullReference::MakeInstance(lModel, {}));
+			for (uint32_t first = 0; first < lBounds.size(); first += MAX_MESHLET_PER_THREAD_GROUP)
+			{
+				OutBatch.mGroups.push_back({ i, first, std::min(uint32_t(lBounds.size()) - first, (uint32_t)MAX_MESHLET_PER_THREAD_GROUP), 0 });
+			}
+		}
+	}
+}
+
+//One amplification pass on the CPU:every meshlet of the batch through the tests enabled by the second argument.
+static void BM_MeshletCullReference(benchmark::State& state)
+{
+	MeshletBatch lBatch;
+	MakeBatch(uint32_t(state.range(0)), lBatch);
+	const SimpleMath::Vector3 lEye(0.0f, 2.0f, 0.0f);
+	const SimpleMath::Vector3 lTarget(0.0f, 2.0f, 1.0f);
+	const auto lConstants = MeshletCullReference::MakeConstants(Synthetic::MakeViewPrj(lEye, lTarget, XM_PIDIV2, 16.0f / 9.0f, 0.1f),
+		Synthetic::MakePrj(XM_PIDIV2, 16.0f / 9.0f, 0.1f), lEye, 1080.0f, uint32_t(state.range(1)), 2.0f);
+	for (auto _ : state)
+	{
+		lBatch.mReference.Cull(lConstants, lBatch.mInstances, lBatch.mGroups);
+		benchmark::DoNotOptimize(lBatch.mReference.GetCounts().mVisible);
+	}
+	const auto& lCounts = lBatch.mReference.GetCounts();
+	state.counters["meshlets"] = lCounts.mMeshlets;
+	state.counters["visible"] = lCounts.mVisible;
+	state.counters["frustum_culled"] = lCounts.mFrustumCulled;
+	state.counters["small_culled"] = lCounts.mSmallCulled;
+	state.counters["cone_culled"] = lCounts.mConeCulled;
+	state.SetItemsProcessed(state.iterations() * lCounts.mMeshlets);
+}
+BENCHMARK(BM_MeshletCullReference)
+	->Args({ 256, 0 })
+	->Args({ 256, MESHLET_CULL_FRUSTUM })
+	->Args({ 256, MESHLET_CULL_FRUSTUM | MESHLET_CULL_SMALL })
+	->Args({ 256, MESHLET_CULL_FRUSTUM | MESHLET_CULL_SMALL | MESHLET_CULL_CONE })
+	->Unit(benchmark::kMicrosecond);
@@ -0,0 +1,79 @@
+#include "occlusion_culling.h"
+#include "synthetic_scene.h"
+#include <benchmark/benchmark.h>
+
+using namespace Renderer;
+using namespace DirectX;
+
+namespace
+{
+	SimpleMath::Matrix MakeStreetViewPrj()
+	{
+		const SimpleMath::Vector3 lEye(0.0f, 2.0f, 0.0f);
+		const float lAspect = float(SoftwareOcclusionCuller::DEFAULT_WIDTH) / SoftwareOcclusionCuller::DEFAULT_HEIGHT;
+		return Synthetic::MakeViewPrj(lEye, lEye + SimpleMath::Vector3(0.0f, 0.0f, 1.0f), XM_PIDIV2, lAspect, 0.1f);
+	}
+
+	std::vector<Synthetic::BoxMesh> MakeCityMeshes(int InBlocks)
+	{
+		std::vector<Synthetic::BoxMesh> lMeshes;
+		for (const auto& building : Synthetic::MakeCity(InBlocks, InBlocks, 16.0f, 8.0f, 7).mBuildings)
+		{
+			lMeshes.push_back(Synthetic::MakeBoxMesh(building));
+		}
+		return lMeshes;
+	}
+
+	void RasterizeCity(SoftwareOcclusionCuller& InCuller, const std::vector<Synthetic::BoxMesh>& InMeshes)
+	{
+		InCuller.BeginFrame(MakeStreetViewPrj());
+		for (const auto& mesh : InMeshes)
+		{
+			InCuller.RasterizeOccluder(mesh.mPositions.data(), sizeof(XMFLOAT3), mesh.mPositions.size(), mesh.mIndices, SimpleMath::Matrix::Identity);
+		}
+		InCuller.BuildHierarchy();
+	}
+}
+
+//Occluder pass of one frame:clear,rasterize every building of an InBlocks x InBlocks city and build the HiZ.
+static void BM_OcclusionRasterizeCity(benchmark::State& state)
+{
+	const auto lMeshes = MakeCityMeshes(int(state.range(0)));
+	SoftwareOcclusionCuller lCuller;
+	for (auto _ : state)
+	{
+		RasterizeCity(lCuller, lMeshes);
+		benchmark::DoNotOptimize(lCuller.GetDepth().data());
+	}
+	state.counters["triangles"] = lCuller.GetRasterizedTriangles();
+	state.SetItemsProcessed(state.iterations() * lMeshes.size());
+}
+BENCHMARK(BM_OcclusionRasterizeCity)->Arg(4)->Arg(8)->Arg(16);
+
+//Query pass:project and test the bounds of InProps props scattered through the city.
+static void BM_OcclusionTestBounds(benchmark::State& state)
+{
+	SoftwareOcclusionCuller lCuller;
+	RasterizeCity(lCuller, MakeCityMeshes(8));
+	std::mt19937 lRandom(11);
+	std::uniform_real_distribution<float> lX(-100.0f, 100.0f);
+	std::uniform_real_distribution<float> lZ(-20.0f, 200.0f);
+	std::vector<BoundingBox> lProps(size_t(state.range(0)));
+	for (auto& prop : lProps)
+	{
+		prop = BoundingBox(XMFLOAT3(lX(lRandom), 1.0f, lZ(lRandom)), XMFLOAT3(1.0f, 1.0f, 1.0f));
+	}
+	uint32_t lVisible = 0;
+	for (auto _ : state)
+	{
+		lVisible = 0;
+		for (const auto& prop : lProps)
+		{
+			lVisible += lCuller.IsVisible(prop) ? 1 : 0;
+		}
+		benchmark::DoNotOptimize(lVisible);
+	}
+	state.counters["visible"] = lVisible;
+	state.SetItemsProcessed(state.iterations() * lProps.size());
+}
+BENCHMARK(BM_OcclusionTestBounds)->Arg(1000)->Arg(10000);
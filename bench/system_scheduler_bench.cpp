@@ -0,0 +1,81 @@
+#include "system_scheduler.h"
+#include "synthetic_scene.h"
+#include <benchmark/benchmark.h>
+
+using namespace ECS;
+
+namespace
+{
+	constexpr uint32_t SYSTEMS = 8;
+	constexpr uint32_t ENTITIES = 20000;
+
+	template<uint32_t I>
+	struct Payload
+	{
+		float mValue = 1.0f;
+	};
+
+	//Integrates its own Payload pool,or with InShared every system writes Payload<0> and the schedule turns into a chain.
+	template<uint32_t I, bool InShared>
+	class PayloadSystem final : public System
+	{
+	public:
+		using Component = Payload<InShared ? 0 : I>;
+
+		PayloadSystem() : System("Payload" + std::to_string(I))
+		{
+			Writes<Component>();
+		}
+
+		void Update(entt::registry& InRegistry, EntityCommandBuffer& OutCommands, float InDelta) override
+		{
+			InRegistry.view<Component>().each([InDelta](Component& InPayload)
+				{
+					InPayload.mValue = std::sqrt(InPayload.mValue * InPayload.mValue + InDelta) * 0.999f;
+				});
+		}
+	};
+
+	template<bool InShared, uint32_t... I>
+	void RegisterSystems(SystemScheduler& OutScheduler, entt::registry& OutRegistry, std::integer_sequence<uint32_t, I...>)
+	{
+		(OutScheduler.Register<PayloadSystem<I, InShared>>(), ...);
+		for (uint32_t i = 0; i < ENTITIES; ++i)
+		{
+			auto lEntity = OutRegistry.create();
+			(OutRegistry.emplace<Payload<I>>(lEntity), ...);
+		}
+	}
+
+	template<bool InShared>
+	void RunSchedule(benchmark::State& state)
+	{
+		Synthetic::EnsureLogger();
+		tf::Executor lExecutor(size_t(state.range(0)));
+		entt::registry lRegistry;
+		EntityCommandQueue lQueue;
+		SystemScheduler lScheduler;
+		RegisterSystems<InShared>(lScheduler, lRegistry, std::make_integer_sequence<uint32_t, SYSTEMS>());
+		for (auto _ : state)
+		{
+			lScheduler.Run(lRegistry, lQueue, 0.016f, lExecutor);
+			lQueue.Playback(lRegistry);
+		}
+		state.counters["workers"] = double(lExecutor.num_workers());
+		state.SetItemsProcessed(state.iterations() * SYSTEMS * ENTITIES);
+	}
+}
+
+//Eight systems on disjoint pools,the graph has no edges and should scale with the worker count.
+static void BM_SystemSchedulerIndependent(benchmark::State& state)
+{
+	RunSchedule<false>(state);
+}
+BENCHMARK(BM_SystemSchedulerIndependent)->Arg(1)->Arg(2)->Arg(4)->Arg(8)->UseRealTime();
+
+//Baseline:the same work where every system writes one pool,so they run one after the other on any worker count.
+static void BM_SystemSchedulerConflicting(benchmark::State& state)
+{
+	RunSchedule<true>(state);
+}
+BENCHMARK(BM_SystemSchedulerConflicting)->Arg(1)->Arg(2)->Arg(4)->Arg(8)->UseRealTime();
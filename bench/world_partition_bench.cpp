@@ -0,0 +1,98 @@
+#include "world_partition.h"
+#include "mesh_store.h"
+#include "synthetic_scene.h"
+#include <benchmark/benchmark.h>
+
+using namespace GAS;
+
+namespace
+{
+	constexpr float CELL_SIZE = 32.0f;
+	constexpr uint32_t SUBMESHES_PER_MESH = 4;
+	//Focus speed in world units per frame,a fast vehicle at 60 fps.
+	constexpr float FOCUS_STEP = 1.0f;
+
+	//InCellsPerSide^2 cells of InMeshesPerCell cubes scattered over each cell,cooked to one file per cell.
+	std::vector<WorldPartition::Cell> CookGrid(int32_t InCellsPerSide, uint32_t InMeshesPerCell, const std::filesystem::path& InDirectory)
+	{
+		std::mt19937 lRandom(3);
+		std::uniform_real_distribution<float> lOffset(0.0f, CELL_SIZE);
+		std::vector<ECS::StaticMesh> lMeshes;
+		for (int32_t z = 0; z < InCellsPerSide; ++z)
+		{
+			for (int32_t x = 0; x < InCellsPerSide; ++x)
+			{
+				for (uint32_t i = 0; i < InMeshesPerCell; ++i)
+				{
+					auto lMesh = Synthetic::MakeCubeStaticMesh(SUBMESHES_PER_MESH, "prop");
+					lMesh.Scale = DirectX::SimpleMath::Vector3(1.0f, 1.0f, 1.0f);
+					lMesh.Translation = DirectX::SimpleMath::Vector3(x * CELL_SIZE + lOffset(lRandom), 0.5f, z * CELL_SIZE + lOffset(lRandom));
+					lMeshes.push_back(std::move(lMesh));
+				}
+			}
+		}
+		return WorldPartition::Cook(std::move(lMeshes), InDirectory, CELL_SIZE);
+	}
+
+	//Closed loop around the middle of the grid,crossing cells on every side.
+	DirectX::SimpleMath::Vector3 FocusOnPath(int32_t InCellsPerSide, uint64_t InFrame)
+	{
+		const float lCenter = 0.5f * InCellsPerSide * CELL_SIZE;
+		const float lRadius = 0.35f * InCellsPerSide * CELL_SIZE;
+		const float lAngle = float(InFrame) * FOCUS_STEP / lRadius;
+		return DirectX::SimpleMath::Vector3(lCenter + lRadius * std::cos(lAngle), 2.0f, lCenter + lRadius * std::sin(lAngle));
+	}
+}
+
+//One streaming frame per iteration along the path,as GameScene::UpdateStreaming drives it.
+//Cells read this frame land on the next one,reading stands in for the loader thread and is not part of the frame time.
+static void BM_WorldPartitionStream(benchmark::State& state)
+{
+	Synthetic::ScopedAssetRegistry lAssets;
+	const int32_t lCellsPerSide = int32_t(state.range(0));
+	const auto lDirectory = std::filesystem::temp_directory_path() / "world_partition_bench";
+	StreamingSettings lSettings;
+	lSettings.mCellSize = CELL_SIZE;
+	lSettings.mLoadRadius = 2.0f * CELL_SIZE;
+	lSettings.mUnloadRadius = 3.0f * CELL_SIZE;
+	WorldPartition lPartition;
+	lPartition.Open(CookGrid(lCellsPerSide, uint32_t(state.range(1)), lDirectory), lSettings);
+	ECS::MeshStore lStore;
+	std::vector<std::pair<CellCoord, std::vector<ECS::StaticMesh>>> lRead;
+	uint64_t lFrame = 0;
+	for (auto _ : state)
+	{
+		const auto lStart = std::chrono::steady_clock::now();
+		for (auto& [coord, meshes] : lRead)
+		{
+			std::vector<ECS::StaticMeshComponent> lComponents;
+			for (auto& mesh : meshes)
+			{
+				lComponents.push_back(lStore.Add(std::move(mesh)));
+			}
+			lPartition.OnCellLoaded(coord, {}, std::move(lComponents));
+		}
+		lRead.clear();
+		auto lPlan = lPartition.Plan(FocusOnPath(lCellsPerSide, lFrame++));
+		for (auto coord : lPlan.mUnload)
+		{
+			lStore.Remove(lPartition.OnCellUnloaded(coord));
+		}
+		lPartition.EndFrame(std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - lStart).count());
+
+		for (auto coord : lPlan.mLoad)
+		{
+			lRead.emplace_back(coord, WorldPartition::ReadCell(lPartition.GetCell(coord)->mFile));
+		}
+	}
+	const auto& lStats = lPartition.GetStats();
+	state.counters["bandwidth_MBs"] = lStats.mBandwidthMBs;
+	state.counters["hitches"] = lStats.mHitches;
+	state.counters["cell_loads"] = lStats.mCellLoads;
+	state.counters["max_frame_ms"] = lStats.mMaxFrameMs;
+	state.SetBytesProcessed(int64_t(lStats.mBytesStreamed));
+	lPartition.Close();
+	std::filesystem::remove_all(lDirectory);
+}
+//Bandwidth is measured over one second windows,run long enough to close a few.
+BENCHMARK(BM_WorldPartitionStream)->Args({ 16, 64 })->Args({ 32, 256 })->MinTime(3.0)->Unit(benchmark::kMicrosecond);
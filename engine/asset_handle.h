@@ -0,0 +1,18 @@
+#pragma once
+
+namespace AssetLoader
+{
+	//Slot index plus the generation the slot had when the handle was handed out.
+	//A handle whose asset has been freed stays detectable because the slot generation moves on.
+	template<typename T>
+	struct AssetHandle
+	{
+		uint32_t mIndex = UINT32_MAX;
+		uint32_t mGeneration = 0;
+		bool IsValid() const { return mIndex != UINT32_MAX; }
+		bool operator==(const AssetHandle&) const = default;
+	};
+
+	struct TextureData;
+	using TextureHandle = AssetHandle<TextureData>;
+}
@@ -2,6 +2,7 @@
 #include "stb_texture_loader.h"
 #include "obj_model_loader.h"
 #include "fbx_loader.h"
+#include "asset_registry.h"
 
 namespace AssetLoader
 {
@@ -29,6 +30,7 @@ AssetLoader::TextureAssetLoader::~TextureAssetLoader()
 
 void AssetLoader::InitAssetLoader()
 {
+	gAssetRegistry = new AssetRegistry;
 	gStbTextureLoader = new StbTextureAssetLoader;
 	gObjModelLoader = new ObjModelLoader;
     gFbxModelLoader = new FbxLoader;
@@ -46,4 +48,10 @@ void AssetLoader::DestroyAssetLoader()
 		delete gObjModelLoader;
 		gObjModelLoader = nullptr;
 	}
+	if (gAssetRegistry)
+	{
+		gAssetRegistry->LogMemoryReport("shutdown");
+		delete gAssetRegistry;
+		gAssetRegistry = nullptr;
+	}
 }
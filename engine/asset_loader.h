@@ -15,7 +15,7 @@ namespace AssetLoader
 		{
 			if (mdata)
 			{
-				delete mdata;
+				delete[] mdata;
 				mdata = nullptr;
 			}
 		}
@@ -40,7 +40,8 @@ namespace AssetLoader
 
 		virtual std::vector<ECS::StaticMesh>& LoadAssetFromFile(std::string_view InFileName) { return mStaticMeshes; };
 
-		const std::unordered_map<std::string, TextureData*> GetTextureMap() { return mTextureMap; };
+		//Hands the textures loaded since the last call over to the caller,which becomes their owner.
+		std::unordered_map<std::string, TextureData*> TakeTextureMap() { return std::exchange(mTextureMap, {}); };
 
 	protected:
         std::vector<ECS::StaticMesh> mStaticMeshes;
@@ -0,0 +1,54 @@
+#include "asset_registry.h"
+
+size_t AssetLoader::GetCpuBytes(const ECS::StaticMeshAsset& InAsset)
+{
+	return InAsset.mVertices.capacity() * sizeof(Renderer::Vertex) +
+		InAsset.mIndices.capacity() * sizeof(uint32_t) +
+		InAsset.mMeshlets.capacity() * sizeof(InAsset.mMeshlets[0]) +
+		InAsset.mMeshletsVerticesPosition.capacity() * sizeof(DirectX::XMFLOAT3) +
+		InAsset.mMeshletPrimditives.capacity() * sizeof(DirectX::MeshletTriangle) +
+		InAsset.mMeshletsIndices.capacity() * sizeof(uint32_t) +
+		InAsset.mMeshletCullData.capacity() * sizeof(DirectX::CullData);
+}
+
+size_t AssetLoader::GetCpuBytes(const TextureData& InAsset)
+{
+	return InAsset.mdata ? size_t(InAsset.mWidth) * InAsset.mHeight * InAsset.mComponent : 0;
+}
+
+AssetLoader::AssetRegistry::AssetRegistry()
+{
+
+}
+
+AssetLoader::AssetRegistry::~AssetRegistry()
+{
+	auto lMeshes = mMeshes.GetStats();
+	auto lTextures = mTextures.GetStats();
+	if (lMeshes.mLive || lTextures.mLive)
+	{
+		gLogger->warn("AssetRegistry destroyed with {} meshes and {} textures still referenced", lMeshes.mLive, lTextures.mLive);
+	}
+}
+
+AssetLoader::AssetPool<ECS::StaticMeshAsset>& AssetLoader::AssetRegistry::GetMeshes()
+{
+	return mMeshes;
+}
+
+AssetLoader::AssetPool<AssetLoader::TextureData>& AssetLoader::AssetRegistry::GetTextures()
+{
+	return mTextures;
+}
+
+void AssetLoader::AssetRegistry::LogMemoryReport(std::string_view InLabel) const
+{
+	auto lLog = [](std::string_view InPool, const AssetPoolStats& InStats)
+		{
+			gLogger->info("  {}: {} live,{} cpu resident ({:.2f} MB),{} gpu resident,{} free slots", InPool,
+				InStats.mLive, InStats.mCpuResident, InStats.mCpuBytes / (1024.0 * 1024.0), InStats.mGpuResident, InStats.mFreeSlots);
+		};
+	gLogger->info("Asset memory report: {}", InLabel);
+	lLog("Meshes", mMeshes.GetStats());
+	lLog("Textures", mTextures.GetStats());
+}
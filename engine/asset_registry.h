@@ -0,0 +1,235 @@
+#pragma once
+#include "asset_loader.h"
+#include <mutex>
+#include <deque>
+
+namespace AssetLoader
+{
+	enum class Residency : uint8_t
+	{
+		CPU = 0,
+		GPU,
+		COUNT
+	};
+
+	struct AssetPoolStats
+	{
+		uint32_t mLive = 0;
+		uint32_t mCpuResident = 0;
+		uint32_t mGpuResident = 0;
+		uint32_t mFreeSlots = 0;
+		size_t mCpuBytes = 0;
+	};
+
+	size_t GetCpuBytes(const ECS::StaticMeshAsset& InAsset);
+
+	size_t GetCpuBytes(const TextureData& InAsset);
+
+	//Generation checked slot array with separate CPU and GPU reference counts.
+	//The CPU copy is freed when the last CPU reference goes away,the GPU release callback runs
+	//when the last GPU reference goes away and the slot is recycled once both counts are zero.
+	template<typename T>
+	class AssetPool
+	{
+	public:
+		using Handle = AssetHandle<T>;
+		using ReleaseCallback = std::function<void(Handle, const std::string&)>;
+
+		AssetPool() {};
+
+		~AssetPool() {};
+
+		//Takes ownership of InData,the caller holds the first CPU reference.
+		Handle Add(std::string_view InName, std::unique_ptr<T> InData)
+		{
+			std::lock_guard lLock(mMutex);
+			uint32_t lIndex;
+			if (!mFreeSlots.empty())
+			{
+				lIndex = mFreeSlots.back();
+				mFreeSlots.pop_back();
+			}
+			else
+			{
+				lIndex = (uint32_t)mSlots.size();
+				mSlots.emplace_back();
+			}
+			auto& lSlot = mSlots[lIndex];
+			lSlot.mData = std::move(InData);
+			lSlot.mName = InName;
+			lSlot.mRefs = { 1, 0 };
+			lSlot.mLive = true;
+			return { lIndex, lSlot.mGeneration };
+		}
+
+		//Does not add a reference,returns an invalid handle when no live asset has InName.
+		Handle Find(std::string_view InName) const
+		{
+			std::lock_guard lLock(mMutex);
+			for (uint32_t i = 0; i < mSlots.size(); ++i)
+			{
+				if (mSlots[i].mLive && mSlots[i].mName == InName)
+				{
+					return { i, mSlots[i].mGeneration };
+				}
+			}
+			return {};
+		}
+
+		bool IsAlive(Handle InHandle) const
+		{
+			std::lock_guard lLock(mMutex);
+			return Resolve(InHandle) != nullptr;
+		}
+
+		//Null when the handle is stale or the CPU copy has already been dropped.
+		//Callers must hold a CPU reference for as long as they use the returned pointer.
+		T* Get(Handle InHandle) const
+		{
+			std::lock_guard lLock(mMutex);
+			auto lSlot = Resolve(InHandle);
+			return lSlot ? lSlot->mData.get() : nullptr;
+		}
+
+		std::string GetName(Handle InHandle) const
+		{
+			std::lock_guard lLock(mMutex);
+			auto lSlot = Resolve(InHandle);
+			return lSlot ? lSlot->mName : std::string();
+		}
+
+		//Returns false when the handle is stale,no reference is taken then.
+		//A CPU reference taken after the CPU copy was dropped only keeps the slot and its GPU copy alive.
+		bool AddRef(Handle InHandle, Residency InResidency)
+		{
+			std::lock_guard lLock(mMutex);
+			auto lSlot = Resolve(InHandle);
+			if (!lSlot)
+			{
+				return false;
+			}
+			lSlot->mRefs[(size_t)InResidency]++;
+			return true;
+		}
+
+		void Release(Handle InHandle, Residency InResidency)
+		{
+			std::unique_ptr<T> lFreedData;
+			std::string lGpuReleasedName;
+			bool lGpuReleased = false;
+			{
+				std::lock_guard lLock(mMutex);
+				auto lSlot = Resolve(InHandle);
+				Expects(lSlot && lSlot->mRefs[(size_t)InResidency] > 0);
+				auto& lRefs = lSlot->mRefs[(size_t)InResidency];
+				if (--lRefs > 0)
+				{
+					return;
+				}
+				if (InResidency == Residency::CPU)
+				{
+					lFreedData = std::move(lSlot->mData);
+				}
+				else
+				{
+					lGpuReleased = true;
+					lGpuReleasedName = lSlot->mName;
+				}
+				if (lSlot->mRefs[(size_t)Residency::CPU] == 0 && lSlot->mRefs[(size_t)Residency::GPU] == 0)
+				{
+					lSlot->mLive = false;
+					lSlot->mGeneration++;
+					lSlot->mName.clear();
+					mFreeSlots.push_back(InHandle.mIndex);
+				}
+			}
+			//Run outside the lock,the renderer may look other assets up from the callback.
+			if (lGpuReleased && mGpuReleaseCallback)
+			{
+				mGpuReleaseCallback(InHandle, lGpuReleasedName);
+			}
+		}
+
+		void SetGpuReleaseCallback(ReleaseCallback InCallback)
+		{
+			mGpuReleaseCallback = std::move(InCallback);
+		}
+
+		AssetPoolStats GetStats() const
+		{
+			std::lock_guard lLock(mMutex);
+			AssetPoolStats lStats;
+			lStats.mFreeSlots = (uint32_t)mFreeSlots.size();
+			for (const auto& slot : mSlots)
+			{
+				if (!slot.mLive)
+				{
+					continue;
+				}
+				lStats.mLive++;
+				if (slot.mData)
+				{
+					lStats.mCpuResident++;
+					lStats.mCpuBytes += GetCpuBytes(*slot.mData);
+				}
+				if (slot.mRefs[(size_t)Residency::GPU] > 0)
+				{
+					lStats.mGpuResident++;
+				}
+			}
+			return lStats;
+		}
+
+	private:
+		struct Slot
+		{
+			std::unique_ptr<T> mData;
+			std::string mName;
+			uint32_t mGeneration = 0;
+			std::array<uint32_t, (size_t)Residency::COUNT> mRefs = {};
+			bool mLive = false;
+		};
+
+		const Slot* Resolve(Handle InHandle) const
+		{
+			if (InHandle.mIndex >= mSlots.size())
+			{
+				return nullptr;
+			}
+			const auto& lSlot = mSlots[InHandle.mIndex];
+			return lSlot.mLive && lSlot.mGeneration == InHandle.mGeneration ? &lSlot : nullptr;
+		}
+
+		Slot* Resolve(Handle InHandle)
+		{
+			return const_cast<Slot*>(std::as_const(*this).Resolve(InHandle));
+		}
+
+		mutable std::mutex mMutex;
+		//Deque so slots never move while a callback or a Get result is still in use.
+		std::deque<Slot> mSlots;
+		std::vector<uint32_t> mFreeSlots;
+		ReleaseCallback mGpuReleaseCallback;
+	};
+
+	//Single owner of mesh and texture assets shared by every scene and renderer.
+	class AssetRegistry
+	{
+	public:
+		AssetRegistry();
+
+		~AssetRegistry();
+
+		AssetPool<ECS::StaticMeshAsset>& GetMeshes();
+
+		AssetPool<TextureData>& GetTextures();
+
+		void LogMemoryReport(std::string_view InLabel) const;
+
+	private:
+		AssetPool<ECS::StaticMeshAsset> mMeshes;
+		AssetPool<TextureData> mTextures;
+	};
+
+	inline AssetRegistry* gAssetRegistry;
+}
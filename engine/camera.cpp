@@ -100,6 +100,11 @@ DirectX::SimpleMath::Matrix Gameplay::BaseCamera::GetClipToView(bool UploadToGpu
 	return UploadToGpu ? mClipToView.Transpose(): mClipToView;
 }
 
+const DirectX::SimpleMath::Vector3& Gameplay::BaseCamera::GetEye() const
+{
+	return mEye;
+}
+
 void Gameplay::BaseCamera::Forward(float InSpeed)
 {
 	auto forwardVec = mCenter - mEye;
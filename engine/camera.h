@@ -16,6 +16,7 @@ namespace Gameplay
 		//virtual void KeyDown(int key, int scancode, int action, int mods);
         virtual void KeyDown(Keyboard::State InState);
 		SimpleMath::Matrix GetClipToView(bool UploadToGpu = true);
+		const SimpleMath::Vector3& GetEye() const;
 	protected:
 		void Forward(float InSpeed);
 		void Right(float InSpeed);
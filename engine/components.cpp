@@ -2,33 +2,15 @@
 #include <span>
 #include <d3d12.h>
 
-ECS::System::System()
+ECS::StaticMeshAsset::StaticMeshAsset(StaticMesh&& InMesh):
+mVertices(std::move(InMesh.mVertices)),
+mIndices(std::move(InMesh.mIndices)),
+mName(InMesh.mName)
 {
 
 }
 
-ECS::System::~System()
-{
-
-}
-
-ECS::StaticMeshComponent::StaticMeshComponent(StaticMesh&& InMesh):
-mVertices(InMesh.mVertices),
-mIndices(InMesh.mIndices),
-mIndexCount(InMesh.mIndices.size()),
-mVertexCount(InMesh.mVertices.size()),
-StartIndexLocation(0),
-BaseVertexLocation(0),
-mSubMeshes(InMesh.mSubmeshMap),
-mName(InMesh.mName),
-mMatBaseColorName(InMesh.mMatBaseColorName),
-mMatNormalMapName(InMesh.mMatNormalMapName),
-mBaseColor(InMesh.mDiffuseColor)
-{
-	
-}
-
-HRESULT ECS::StaticMeshComponent::ConvertToMeshlets(size_t maxVerticesPerMeshlet, size_t maxIndicesPerMeshlet)
+HRESULT ECS::StaticMeshAsset::ConvertToMeshlets(size_t maxVerticesPerMeshlet, size_t maxIndicesPerMeshlet)
 {
     // Convert vertices to DirectXMesh format
     mMeshletsVerticesPosition.resize(mVertices.size());
@@ -77,7 +59,21 @@ HRESULT ECS::StaticMeshComponent::ConvertToMeshlets(size_t maxVerticesPerMeshlet
         // Handle error
         return hr;
     }
-    return S_OK;
+
+    // Bounding sphere and normal cone of every meshlet for amplification shader culling.
+    // The engine is left handed with clockwise front faces,so the default winding gives outward normals.
+    mMeshletCullData.resize(lMeshlets.size());
+    return DirectX::ComputeCullData(
+        mMeshletsVerticesPosition.data(),
+        mMeshletsVerticesPosition.size(),
+        lMeshlets.data(),
+        lMeshlets.size(),
+        mMeshletsIndices.data(),
+        mMeshletsIndices.size(),
+        mMeshletPrimditives.data(),
+        mMeshletPrimditives.size(),
+        mMeshletCullData.data()
+    );
 }
 
  ECS::TransformComponent::TransformComponent(StaticMesh&& InMesh) : 
@@ -1,17 +1,25 @@
 #pragma once
 #include <DirectXMesh.h>
+#include "asset_handle.h"
 
 using ROTATION_AXIS = DirectX::SimpleMath::Vector3;
 const ROTATION_AXIS X_AXIS = DirectX::SimpleMath::Vector3(1.0f,0.0f,0.0f);
 const ROTATION_AXIS Y_AXIS = DirectX::SimpleMath::Vector3(0.0f, 1.0f, 0.0f);
 const ROTATION_AXIS Z_AXIS = DirectX::SimpleMath::Vector3(0.0f, 0.0f, 1.0f);
 constexpr int ROOT_PARA_FRAME_DATA_CBV = 0;
-constexpr int ROOT_PARA_FRAME_SOURCE_TABLE = 1;//lights,clusters
+constexpr int ROOT_PARA_FRAME_SOURCE_TABLE = 1;//clusters,cluster light indices
 constexpr int ROOT_PARA_COMPONENT_DATA = 2;
-constexpr int ROOT_PARA_DIFFUSE_COLOR_TEXTURE = 3;
+constexpr int ROOT_PARA_BINDLESS_TEXTURES = 3;//unbounded table from the heap start,indexed by the materials
 constexpr int ROOT_PARA_SHADOW_MAP = 4;
-constexpr int ROOT_PARA_NORMAL_MAP_TEXTURE = 5;
+constexpr int ROOT_PARA_MATERIALS = 5;
+constexpr int ROOT_PARA_ZBINS = 6;
+constexpr int ROOT_PARA_ZBIN_LIGHT_ORDER = 7;
+constexpr int ROOT_PARA_ZBIN_TILE_MASKS = 8;
+constexpr int ROOT_PARA_DRAW_DATA = 9;//material index
+constexpr int ROOT_PARA_LIGHTS = 10;
 constexpr int MAX_MESHLET_PER_THREAD_GROUP = 128;
+//Meshes up to this size are rasterized as software occluders without a simplified proxy.
+constexpr int MAX_AUTO_OCCLUDER_TRIANGLES = 4096;
 
 namespace ECS
 {
@@ -48,11 +56,29 @@ namespace ECS
 		std::string mName;
 	};
 
+	enum class LightType : uint32_t
+	{
+		POINT,
+		//Cone around direction,fades from the inner to the outer half angle.
+		SPOT,
+		//Tube light,a segment of length centered on pos along direction.
+		CAPSULE
+	};
+
+	//GPU light format,mirrored by Light in shader_common.hlsli.
 	struct LigthData
 	{
 		DirectX::XMFLOAT4 color;
 		DirectX::XMFLOAT4 pos;
+		//x is the range from the light's shape.
 		DirectX::XMFLOAT4 radius_attenu;
+		//Unit spot or capsule axis,world space.
+		DirectX::XMFLOAT3 direction;
+		LightType type;
+		//Spot:cos outer,cos inner,sin outer.Capsule:half length.
+		DirectX::XMFLOAT4 shape;
+		//World space bounding sphere,xyz center and w radius.Culling tests it before the exact shape.
+		DirectX::XMFLOAT4 bounds;
 	};
 
 	struct Component 
@@ -74,41 +100,94 @@ namespace ECS
 	};
 
 
-	struct StaticMeshComponent : public Component
+	struct StaticMeshAsset;
+	using MeshHandle = AssetLoader::AssetHandle<StaticMeshAsset>;
+	using MaterialId = uint32_t;
+
+	//An invalid or stale texture handle falls back to the renderer default texture.
+	struct MaterialDesc
+	{
+		AssetLoader::TextureHandle mBaseColor;
+		AssetLoader::TextureHandle mNormalMap;
+		//Multiplies the base color texture.
+		DirectX::SimpleMath::Vector4 mBaseColorFactor = { 1.0f, 1.0f, 1.0f, 1.0f };
+		bool operator==(const MaterialDesc&) const = default;
+	};
+
+	//Index range drawn with one material,flattened in the MeshStore.
+	struct SubMeshRange
 	{
-		
+		uint32_t IndexOffset = 0;
+		uint32_t IndexCount = 0;
+		MaterialId Material = 0;
+	};
+
+	//Cold mesh data,owned by the MeshStore and only touched when loading,uploading or building meshlets.
+	struct StaticMeshAsset
+	{
+		StaticMeshAsset(StaticMesh&& InMesh);
 		std::vector<Renderer::Vertex> mVertices;
 		std::vector<uint32_t> mIndices;
-		UINT mVertexCount;
-		UINT mIndexCount;
-		UINT StartIndexLocation;
-		INT BaseVertexLocation;
-        std::unordered_map<MaterialIndex, SubMesh> mSubMeshes;
-		std::unordered_map<MaterialIndex, std::string> mMatBaseColorName;
-		std::unordered_map<MaterialIndex, std::string> mMatNormalMapName;
-		StaticMeshComponent(StaticMesh&& InMesh);
-		DirectX::XMFLOAT3 mBaseColor;
-		MaterialName MatName;
-		MaterialName NormalMap;
 		std::string mName;
-		uint32_t mMeshletOffsetWithInThreadGroup = 0;
-		StaticMeshComponentMeshOffset mMeshOffsetWithinScene;
 		//Meshlet data 128 meshlets per thread group max
 		std::vector<std::array<DirectX::Meshlet, MAX_MESHLET_PER_THREAD_GROUP>> mMeshlets;
 		std::vector<DirectX::XMFLOAT3> mMeshletsVerticesPosition;
 		std::vector<DirectX::MeshletTriangle> mMeshletPrimditives;
 		std::vector<uint32_t> mMeshletsIndices;
+		//One per meshlet,not padded to thread groups.
+		std::vector<DirectX::CullData> mMeshletCullData;
 		HRESULT ConvertToMeshlets(size_t maxVerticesPerMeshlet, size_t maxIndicesPerMeshlet);
 	};
 
+	//Hot render data,only what the cull and draw loops read.
+	struct StaticMeshComponent
+	{
+		MeshHandle mMesh;
+		uint32_t mVertexCount = 0;
+		uint32_t mIndexCount = 0;
+		uint32_t StartIndexLocation = 0;
+		int32_t BaseVertexLocation = 0;
+		//The locations above own a range of the shared vertex and index buffers until the renderer releases the mesh.
+		bool mGeometryResident = false;
+		//StartIndexLocation is in the 16 bit index buffer.
+		bool m16BitIndices = false;
+		//Range in MeshStore::GetSubMeshes
+		uint32_t mFirstSubMesh = 0;
+		uint32_t mSubMeshCount = 0;
+		//Meshlets of the mesh,MAX_MESHLET_PER_THREAD_GROUP of them are culled by one amplification group.
+		uint32_t mMeshletCount = 0;
+		//mMeshOffsetWithinScene owns ranges of the mesh shader buffers.
+		bool mMeshletsResident = false;
+		DirectX::XMFLOAT3 mBaseColor = {};
+		bool mCastShadow = true;
+		//Object space bounds of the mesh vertices.
+		DirectX::BoundingBox mBoundingBox;
+		StaticMeshComponentMeshOffset mMeshOffsetWithinScene;
+	};
+	static_assert(std::is_trivially_copyable_v<StaticMeshComponent>);
+
+	//Marks an entity as a CPU occluder candidate.
+	//Leave the geometry empty to rasterize the StaticMeshComponent itself,or provide a simplified mesh.
+	struct OccluderComponent : public Component
+	{
+		std::vector<DirectX::XMFLOAT3> mPositions;
+		std::vector<uint32_t> mIndices;
+	};
+
+	//Point,spot or capsule light,change it through registry patch or replace so the renderer uploads it.
 	struct LightComponent : public Component
 	{
-		//std::array<float, 4> color;
-		//std::array<float, 4> pos;
-		//std::array<float, 4> radius_attenu;
 		DirectX::XMFLOAT4 color;
 		DirectX::XMFLOAT4 pos;
 		DirectX::XMFLOAT4 radius_attenu;
+		LightType type = LightType::POINT;
+		//Spot or capsule axis,world space,normalized on upload.
+		DirectX::XMFLOAT3 direction = { 0.0f, -1.0f, 0.0f };
+		//Spot half angles in radians.Cones of 90 degrees or wider are culled by their bounding sphere only.
+		float spotInnerAngle = 0.3f;
+		float spotOuterAngle = 0.5f;
+		//Capsule segment length.
+		float length = 0.0f;
 	};
 
 	struct TransformComponent : public Component
@@ -128,13 +207,4 @@ namespace ECS
         DirectX::SimpleMath::Vector3 mTranslation;
         DirectX::SimpleMath::Matrix mMat = {};
 	};
-
-	class System
-	{
-	public:
-		System();
-		virtual ~System();
-
-	protected:
-	};
 }
\ No newline at end of file
@@ -8,6 +8,7 @@ engine::GameEngine::GameEngine()
 
 	InitLog();
 	AssetLoader::InitAssetLoader();
+	mExecutor = std::make_unique<tf::Executor>();
 }
 
 engine::GameEngine::~GameEngine()
@@ -15,6 +16,11 @@ engine::GameEngine::~GameEngine()
 
 }
 
+tf::Executor& engine::GameEngine::GetExecutor()
+{
+	return *mExecutor;
+}
+
 void engine::InitGameEngine()
 {
 	gGameEngine = new GameEngine;
@@ -1,5 +1,10 @@
 #pragma once
 
+namespace tf
+{
+	class Executor;
+}
+
 namespace engine
 {
 
@@ -9,7 +14,11 @@ namespace engine
 		GameEngine();
 		virtual ~GameEngine();
 
+		//Worker pool shared by the scene systems and the renderer.
+		tf::Executor& GetExecutor();
+
 	private:
+		std::unique_ptr<tf::Executor> mExecutor;
 
 	};
 
@@ -0,0 +1,115 @@
+#include "entity_command_buffer.h"
+
+ECS::EntityCommandBuffer::EntityCommandBuffer()
+{
+
+}
+
+ECS::EntityCommandBuffer::~EntityCommandBuffer()
+{
+
+}
+
+ECS::DeferredEntity ECS::EntityCommandBuffer::Create()
+{
+	DeferredEntity lEntity = { mCreateCount++ };
+	Record([lEntity](entt::registry& InRegistry, std::span<entt::entity> InCreated)
+		{
+			//Playback sizes InCreated up front,the slot is filled here so later commands can resolve it.
+			InCreated[lEntity.mIndex] = InRegistry.create();
+		});
+	return lEntity;
+}
+
+void ECS::EntityCommandBuffer::Destroy(EntityTarget InEntity)
+{
+	Record([InEntity](entt::registry& InRegistry, std::span<entt::entity> InCreated)
+		{
+			auto lEntity = InEntity.Resolve(InCreated);
+			if (InRegistry.valid(lEntity))
+			{
+				InRegistry.destroy(lEntity);
+			}
+		});
+}
+
+void ECS::EntityCommandBuffer::Playback(entt::registry& InRegistry, std::vector<entt::entity>& OutCreated)
+{
+	std::vector<entt::entity> lCreated(mCreateCount, entt::entity(entt::null));
+	for (auto& command : mCommands)
+	{
+		command->Execute(InRegistry, lCreated);
+	}
+	for (auto entity : lCreated)
+	{
+		if (InRegistry.valid(entity))
+		{
+			OutCreated.push_back(entity);
+		}
+	}
+	mCommands.clear();
+	mCreateCount = 0;
+}
+
+ECS::EntityCommandQueue::EntityCommandQueue()
+{
+
+}
+
+ECS::EntityCommandQueue::~EntityCommandQueue()
+{
+	Discard();
+}
+
+void ECS::EntityCommandQueue::Submit(EntityCommandBuffer&& InBuffer)
+{
+	if (InBuffer.Empty())
+	{
+		return;
+	}
+	Node* lNode = new Node{ std::move(InBuffer) };
+	lNode->mNext = mHead.load(std::memory_order_relaxed);
+	while (!mHead.compare_exchange_weak(lNode->mNext, lNode, std::memory_order_release, std::memory_order_relaxed))
+	{
+	}
+}
+
+std::vector<entt::entity> ECS::EntityCommandQueue::Playback(entt::registry& InRegistry)
+{
+	std::vector<entt::entity> lCreated;
+	Node* lNode = TakeAll();
+	while (lNode)
+	{
+		lNode->mBuffer.Playback(InRegistry, lCreated);
+		Node* lNext = lNode->mNext;
+		delete lNode;
+		lNode = lNext;
+	}
+	return lCreated;
+}
+
+void ECS::EntityCommandQueue::Discard()
+{
+	Node* lNode = TakeAll();
+	while (lNode)
+	{
+		Node* lNext = lNode->mNext;
+		delete lNode;
+		lNode = lNext;
+	}
+}
+
+ECS::EntityCommandQueue::Node* ECS::EntityCommandQueue::TakeAll()
+{
+	//The stack pops newest first,reverse it so buffers play back in submission order.
+	Node* lNode = mHead.exchange(nullptr, std::memory_order_acquire);
+	Node* lOrdered = nullptr;
+	while (lNode)
+	{
+		Node* lNext = lNode->mNext;
+		lNode->mNext = lOrdered;
+		lOrdered = lNode;
+		lNode = lNext;
+	}
+	return lOrdered;
+}
@@ -0,0 +1,140 @@
+#pragma once
+#include <atomic>
+
+namespace ECS
+{
+	//Entity created by a command buffer,only meaningful inside the buffer that created it.
+	struct DeferredEntity
+	{
+		uint32_t mIndex = UINT32_MAX;
+	};
+
+	//Either an existing entity or one created earlier in the same command buffer.
+	struct EntityTarget
+	{
+		EntityTarget(entt::entity InEntity) : mEntity(InEntity) {};
+		EntityTarget(DeferredEntity InEntity) : mDeferred(InEntity.mIndex) {};
+		entt::entity Resolve(std::span<const entt::entity> InCreated) const
+		{
+			return mDeferred == UINT32_MAX ? mEntity : InCreated[mDeferred];
+		}
+		entt::entity mEntity = entt::null;
+		uint32_t mDeferred = UINT32_MAX;
+	};
+
+	//Records registry mutations on any thread without touching the registry.
+	//A buffer is owned by one thread while recording,it is handed to an EntityCommandQueue and played back at the frame sync point.
+	//Commands on an entity that no longer exists at playback are dropped.
+	class EntityCommandBuffer
+	{
+	public:
+		EntityCommandBuffer();
+
+		~EntityCommandBuffer();
+
+		EntityCommandBuffer(EntityCommandBuffer&&) = default;
+
+		EntityCommandBuffer& operator=(EntityCommandBuffer&&) = default;
+
+		DeferredEntity Create();
+
+		void Destroy(EntityTarget InEntity);
+
+		template<typename T, typename... Args>
+		void Emplace(EntityTarget InEntity, Args&&... InArgs)
+		{
+			Record([InEntity, lComponent = T(std::forward<Args>(InArgs)...)](entt::registry& InRegistry, std::span<entt::entity> InCreated) mutable
+				{
+					auto lEntity = InEntity.Resolve(InCreated);
+					if (InRegistry.valid(lEntity))
+					{
+						InRegistry.emplace_or_replace<T>(lEntity, std::move(lComponent));
+					}
+				});
+		}
+
+		//InPatch is called with a reference to the component if the entity still has one at playback.
+		template<typename T, typename F>
+		void Patch(EntityTarget InEntity, F&& InPatch)
+		{
+			Record([InEntity, lPatch = std::forward<F>(InPatch)](entt::registry& InRegistry, std::span<entt::entity> InCreated) mutable
+				{
+					auto lEntity = InEntity.Resolve(InCreated);
+					if (InRegistry.valid(lEntity) && InRegistry.all_of<T>(lEntity))
+					{
+						InRegistry.patch<T>(lEntity, lPatch);
+					}
+				});
+		}
+
+		//Arbitrary work that has to run on the playback thread,e.g. updating tables next to the registry.
+		//InCreated holds the entities this buffer created so far.
+		template<typename F>
+		void Run(F&& InCallback)
+		{
+			Record(std::forward<F>(InCallback));
+		}
+
+		//Apply the commands in record order,OutCreated receives the entities this buffer created.
+		void Playback(entt::registry& InRegistry, std::vector<entt::entity>& OutCreated);
+
+		bool Empty() const { return mCommands.empty(); }
+
+		size_t Size() const { return mCommands.size(); }
+
+	private:
+		struct Command
+		{
+			virtual ~Command() {};
+			virtual void Execute(entt::registry& InRegistry, std::span<entt::entity> InCreated) = 0;
+		};
+
+		//Move only storage so commands can own components that are not copyable.
+		template<typename F>
+		struct CallbackCommand final : public Command
+		{
+			template<typename U>
+			CallbackCommand(U&& InCallback) : mCallback(std::forward<U>(InCallback)) {};
+			void Execute(entt::registry& InRegistry, std::span<entt::entity> InCreated) override { mCallback(InRegistry, InCreated); }
+			F mCallback;
+		};
+
+		template<typename F>
+		void Record(F&& InCallback)
+		{
+			mCommands.push_back(std::make_unique<CallbackCommand<std::decay_t<F>>>(std::forward<F>(InCallback)));
+		}
+
+		std::vector<std::unique_ptr<Command>> mCommands;
+		uint32_t mCreateCount = 0;
+	};
+
+	//Multi producer single consumer queue of recorded buffers.
+	//Submit is a lock free push,Playback drains everything submitted so far in submission order.
+	class EntityCommandQueue
+	{
+	public:
+		EntityCommandQueue();
+
+		~EntityCommandQueue();
+
+		void Submit(EntityCommandBuffer&& InBuffer);
+
+		//Must only be called from the thread that owns InRegistry,returns every entity created by the played back buffers.
+		std::vector<entt::entity> Playback(entt::registry& InRegistry);
+
+		//Drop everything submitted so far without applying it.
+		void Discard();
+
+	private:
+		struct Node
+		{
+			EntityCommandBuffer mBuffer;
+			Node* mNext = nullptr;
+		};
+
+		Node* TakeAll();
+
+		std::atomic<Node*> mHead = nullptr;
+	};
+}
@@ -7,45 +7,241 @@
 GAS::GameScene::GameScene():
 	mRegistery({})
 {
-	
+	mLightAnimation = mSystems.Register<ECS::LightAnimationSystem>();
+	mLightAnimation->mEnabled = false;
 
 }
 
 GAS::GameScene::~GameScene()
 {
+    //Let in flight loads finish and apply them so their asset references are released below.
+    mPendingLoads.clear();
+    mCommandQueue.Playback(mRegistery);
+    ReleaseTextures();
+}
+
+void GAS::GameScene::CreateEntitiesWithMesh(const std::string InMeshFilePath) {
+    std::unordered_map<std::string, AssetLoader::TextureHandle> textureHandles;
+    auto models = LoadModelFile(InMeshFilePath, textureHandles);
+	Ensures(!models.empty());
 
+    using namespace ECS;
+    EntityCommandBuffer commands;
+    commands.Run([this, textureHandles](entt::registry&, std::span<entt::entity>)
+        {
+            MergeTextures(textureHandles);
+        });
+    RecordMeshEntities(commands, models, textureHandles);
+    commands.Run([this](entt::registry&, std::span<entt::entity>)
+        {
+            mLoaded = true;
+        });
+    Submit(std::move(commands));
 }
 
-std::vector<entt::entity> GAS::GameScene::CreateEntitiesWithMesh(const std::string InMeshFilePath) {
-	//Todo: Thread Safe 
+std::vector<ECS::StaticMesh> GAS::GameScene::LoadModelFile(const std::string& InMeshFilePath, std::unordered_map<std::string, AssetLoader::TextureHandle>& OutTextures)
+{
     std::vector<ECS::StaticMesh> models;
-    AssetLoader::ModelAssetLoader* loader = nullptr;
-    std::wstring extension = std::filesystem::path(InMeshFilePath).extension().wstring();
-    std::transform(extension.begin(), extension.end(), extension.begin(), ::towlower);
-    if (extension == L".obj")
-	{
-        loader = AssetLoader::gObjModelLoader;
-    } else if (extension == L".fbx") {
-        loader = AssetLoader::gFbxModelLoader;
+    std::unordered_map<std::string, AssetLoader::TextureData*> textures;
+    {
+        std::lock_guard lock(mLoadMutex);
+        AssetLoader::ModelAssetLoader* loader = nullptr;
+        std::wstring extension = std::filesystem::path(InMeshFilePath).extension().wstring();
+        std::transform(extension.begin(), extension.end(), extension.begin(), ::towlower);
+        if (extension == L".obj")
+        {
+            loader = AssetLoader::gObjModelLoader;
+        } else if (extension == L".fbx") {
+            loader = AssetLoader::gFbxModelLoader;
+        }
+        models = loader->LoadAssetFromFile(InMeshFilePath);
+        textures = loader->TakeTextureMap();
     }
-    models = loader->LoadAssetFromFile(InMeshFilePath);
-	mTextureMap = loader->GetTextureMap();
-	Ensures(!models.empty());
-    std::vector<entt::entity> res;
-	for (auto& mesh : models)
+    for (auto [textureName, textureData] : textures)
+    {
+        OutTextures[textureName] = AcquireTexture(textureName, std::unique_ptr<AssetLoader::TextureData>(textureData));
+    }
+    return models;
+}
+
+std::vector<ECS::StaticMeshComponent> GAS::GameScene::RecordMeshEntities(ECS::EntityCommandBuffer& OutCommands, std::vector<ECS::StaticMesh>& InModels,
+    const std::unordered_map<std::string, AssetLoader::TextureHandle>& InTextures)
+{
+    using namespace ECS;
+    std::vector<StaticMeshComponent> meshes;
+	for (auto& mesh : InModels)
 	{
-        using namespace ECS;
-        auto entity = mRegistery.create();
-        res.push_back(entity);
-        mRegistery.emplace_or_replace<StaticMeshComponent>(entity, std::move(mesh));
-        mRegistery.emplace_or_replace<TransformComponent>(entity, std::move(mesh));
+        auto entity = OutCommands.Create();
+        OutCommands.Emplace<TransformComponent>(entity, std::move(mesh));
+        auto meshComponent = mMeshStore.Add(std::move(mesh), InTextures);
+        if (meshComponent.mIndexCount / 3 <= MAX_AUTO_OCCLUDER_TRIANGLES)
+        {
+            OutCommands.Emplace<OccluderComponent>(entity);
+        }
+        OutCommands.Emplace<StaticMeshComponent>(entity, meshComponent);
+        meshes.push_back(meshComponent);
 	}
-    mLoaded = true;
+    return meshes;
+}
+
+void GAS::GameScene::OpenWorldPartition(const std::string InMeshFilePath, const StreamingSettings& InSettings /*= {}*/)
+{
+    mPendingLoads.push_back(std::async(std::launch::async, [this, InMeshFilePath, InSettings]()
+        {
+            std::unordered_map<std::string, AssetLoader::TextureHandle> textureHandles;
+            auto models = LoadModelFile(InMeshFilePath, textureHandles);
+            auto cookDirectory = std::filesystem::temp_directory_path() / "Re3D" / std::filesystem::path(InMeshFilePath).stem();
+            //The source meshes are dropped once cooked,cells read their meshes back from the cooked files.
+            auto cells = WorldPartition::Cook(std::move(models), cookDirectory, InSettings.mCellSize);
+            ECS::EntityCommandBuffer commands;
+            commands.Run([this, textureHandles, cells = std::move(cells), InSettings](entt::registry&, std::span<entt::entity>) mutable
+                {
+                    MergeTextures(textureHandles);
+                    mPartition.Open(std::move(cells), InSettings);
+                    mLoaded = true;
+                });
+            Submit(std::move(commands));
+        }));
+}
+
+void GAS::GameScene::SetStreamingFocus(const DirectX::SimpleMath::Vector3& InFocus)
+{
+    mStreamingFocus = InFocus;
+}
+
+GAS::WorldPartition& GAS::GameScene::GetWorldPartition()
+{
+    return mPartition;
+}
+
+void GAS::GameScene::UpdateStreaming()
+{
+    auto plan = mPartition.Plan(mStreamingFocus);
+    for (auto coord : plan.mUnload)
+    {
+        auto cell = mPartition.GetCell(coord);
+        RemoveEntities(cell->mEntities);
+        auto meshes = mPartition.OnCellUnloaded(coord);
+        mMeshStore.Remove(meshes);
+    }
+    for (auto coord : plan.mLoad)
+    {
+        //Snapshot the texture table here,the loader thread must not read it while playback merges into it.
+        mPendingLoads.push_back(std::async(std::launch::async, &GameScene::LoadCell, this, coord, mPartition.GetCell(coord)->mFile, mTextureMap));
+    }
+}
+
+void GAS::GameScene::LoadCell(CellCoord InCoord, std::filesystem::path InFile, std::unordered_map<std::string, AssetLoader::TextureHandle> InTextures)
+{
+    auto models = WorldPartition::ReadCell(InFile);
+    ECS::EntityCommandBuffer commands;
+    auto meshes = RecordMeshEntities(commands, models, InTextures);
+    commands.Run([this, InCoord, meshes = std::move(meshes)](entt::registry&, std::span<entt::entity> InCreated) mutable
+        {
+            mPartition.OnCellLoaded(InCoord, std::vector<entt::entity>(InCreated.begin(), InCreated.end()), std::move(meshes));
+        });
+    Submit(std::move(commands));
+}
+
+void GAS::GameScene::RemoveEntities(std::span<const entt::entity> InEntities)
+{
+    for (auto ldelegate : sOnEntitiesRemoved)
+    {
+        ldelegate(shared_from_this(), InEntities);
+    }
+    for (auto entity : InEntities)
+    {
+        if (mRegistery.valid(entity))
+        {
+            mRegistery.destroy(entity);
+        }
+    }
+}
+
+void GAS::GameScene::CreateEntitiesWithMeshAsync(const std::string InMeshFilePath)
+{
+    mPendingLoads.push_back(std::async(std::launch::async, [this, InMeshFilePath]()
+        {
+            CreateEntitiesWithMesh(InMeshFilePath);
+        }));
+}
+
+void GAS::GameScene::Submit(ECS::EntityCommandBuffer&& InCommands)
+{
+    mCommandQueue.Submit(std::move(InCommands));
+}
+
+void GAS::GameScene::PlaybackCommands()
+{
+    std::erase_if(mPendingLoads, [](const std::future<void>& InLoad)
+        {
+            return InLoad.wait_for(std::chrono::seconds(0)) == std::future_status::ready;
+        });
+    auto created = mCommandQueue.Playback(mRegistery);
+    if (created.empty())
+    {
+        return;
+    }
     for (auto ldelegate : sOnNewEntityAdded)
     {
-        ldelegate(shared_from_this(), res);
+        ldelegate(shared_from_this(), created);
     }
-    return res;
+}
+
+void GAS::GameScene::Update(float InDelta)
+{
+    auto streamingStart = std::chrono::steady_clock::now();
+    PlaybackCommands();
+    if (mPartition.IsOpen())
+    {
+        UpdateStreaming();
+        mPartition.EndFrame(std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - streamingStart).count());
+    }
+    mSystems.Run(mRegistery, mCommandQueue, InDelta);
+}
+
+ECS::SystemScheduler& GAS::GameScene::GetSystems()
+{
+    return mSystems;
+}
+
+void GAS::GameScene::CreateRandomPointLights(uint32_t InCount, float InExtent /*= 65.0f*/)
+{
+    CreateRandomLights(InCount, ECS::LightType::POINT, InExtent);
+}
+
+void GAS::GameScene::CreateRandomLights(uint32_t InCount, ECS::LightType InType, float InExtent /*= 65.0f*/)
+{
+    constexpr const char* TYPE_NAMES[] = { "PointLight", "SpotLight", "CapsuleLight" };
+    auto random = [] { return float(rand()) / RAND_MAX; };
+    ECS::EntityCommandBuffer commands;
+    for (uint32_t i = 0; i < InCount; ++i)
+    {
+        ECS::LightComponent light = {};
+        light.mName = TYPE_NAMES[(uint32_t)InType] + std::to_string(i);
+        light.pos = { (random() - 0.5f) * 2.0f * InExtent, random() * 15.0f, (random() - 0.5f) * 2.0f * InExtent, 1.0f };
+        light.color = { random(), random(), random(), 0.0f };
+        light.radius_attenu = { 55.0f, 0.0f, random() * 1.2f, random() * 1.2f };
+        light.type = InType;
+        if (InType == ECS::LightType::SPOT)
+        {
+            light.direction = { random() - 0.5f, -1.0f, random() - 0.5f };
+            light.spotOuterAngle = 0.3f + random() * 0.5f;
+            light.spotInnerAngle = light.spotOuterAngle * 0.7f;
+        }
+        else if (InType == ECS::LightType::CAPSULE)
+        {
+            light.direction = { random() - 0.5f, 0.0f, random() - 0.5f };
+            light.length = 5.0f + random() * 20.0f;
+        }
+        commands.Emplace<ECS::LightComponent>(commands.Create(), std::move(light));
+    }
+    Submit(std::move(commands));
+}
+
+ECS::LightAnimationSystem* GAS::GameScene::GetLightAnimation()
+{
+    return mLightAnimation;
 }
 
 entt::registry& GAS::GameScene::GetRegistery()
@@ -57,11 +253,72 @@ std::atomic_bool& GAS::GameScene::IsSceneReady() {
     return mLoaded;
 }
 
-const std::unordered_map<std::string, AssetLoader::TextureData*>& GAS::GameScene::GetTextureMap()
+const std::unordered_map<std::string, AssetLoader::TextureHandle>& GAS::GameScene::GetTextureMap()
 {
     return mTextureMap;
 }
 
+void GAS::GameScene::Unload()
+{
+    //Wait for cell and file loads so nothing is submitted into the unloaded scene.
+    mPendingLoads.clear();
+    PlaybackCommands();
+    for (auto ldelegate : sOnSceneUnload)
+    {
+        ldelegate(shared_from_this());
+    }
+    mLoaded = false;
+    mRegistery.clear();
+    mPartition.Close();
+    mMeshStore.Clear();
+    ReleaseTextures();
+    AssetLoader::gAssetRegistry->LogMemoryReport("scene unloaded");
+}
+
+AssetLoader::TextureHandle GAS::GameScene::AcquireTexture(const std::string& InName, std::unique_ptr<AssetLoader::TextureData> InData)
+{
+    auto& textures = AssetLoader::gAssetRegistry->GetTextures();
+    //Share a texture another scene or the renderer already loaded,the fresh copy is dropped.
+    auto handle = textures.Find(InName);
+    if (!handle.IsValid() || !textures.AddRef(handle, AssetLoader::Residency::CPU))
+    {
+        handle = textures.Add(InName, std::move(InData));
+    }
+    return handle;
+}
+
+void GAS::GameScene::MergeTextures(const std::unordered_map<std::string, AssetLoader::TextureHandle>& InTextures)
+{
+    for (auto& [name, handle] : InTextures)
+    {
+        if (mTextureMap.contains(name))
+        {
+            AssetLoader::gAssetRegistry->GetTextures().Release(handle, AssetLoader::Residency::CPU);
+        }
+        else
+        {
+            mTextureMap[name] = handle;
+        }
+    }
+}
+
+void GAS::GameScene::ReleaseTextures()
+{
+    if (AssetLoader::gAssetRegistry)
+    {
+        for (auto& [name, handle] : mTextureMap)
+        {
+            AssetLoader::gAssetRegistry->GetTextures().Release(handle, AssetLoader::Residency::CPU);
+        }
+    }
+    mTextureMap.clear();
+}
+
+ECS::MeshStore& GAS::GameScene::GetMeshStore()
+{
+    return mMeshStore;
+}
+
 void GAS::GameScene::SceneScale(float InScale)
 {
     mScale = InScale;
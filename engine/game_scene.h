@@ -1,9 +1,9 @@
 #pragma once
-
-namespace AssetLoader
-{
-	struct TextureData;
-}
+#include "mesh_store.h"
+#include "entity_command_buffer.h"
+#include "system_scheduler.h"
+#include "world_partition.h"
+#include "light_animation_system.h"
 
 namespace GAS
 {
@@ -14,7 +14,41 @@ namespace GAS
 
 		virtual ~GameScene();
 
-		std::vector<entt::entity> CreateEntitiesWithMesh(const std::string InMeshFilePath);
+		//Safe to call from any thread,the entities are created at the next PlaybackCommands.
+		void CreateEntitiesWithMesh(const std::string InMeshFilePath);
+
+		//Load on a worker thread,the caller thread must be the one calling PlaybackCommands.
+		void CreateEntitiesWithMeshAsync(const std::string InMeshFilePath);
+
+		//Cook InMeshFilePath into grid cells on a worker thread and stream the cells around the focus from then on.
+		//Textures stay resident for the whole partition,only meshes are streamed.
+		void OpenWorldPartition(const std::string InMeshFilePath, const StreamingSettings& InSettings = {});
+
+		//Usually the camera position,cells are loaded and unloaded by their distance to it.
+		void SetStreamingFocus(const DirectX::SimpleMath::Vector3& InFocus);
+
+		WorldPartition& GetWorldPartition();
+
+		//Hand a recorded buffer over for playback,lock free and callable from any thread.
+		void Submit(ECS::EntityCommandBuffer&& InCommands);
+
+		//Frame sync point:applies every submitted buffer and notifies sOnNewEntityAdded.
+		//Call it from the thread that owns the registry before any system reads it this frame.
+		void PlaybackCommands();
+
+		//Per frame tick:plays back pending commands then runs the scene systems,their commands are applied next frame.
+		void Update(float InDelta);
+
+		ECS::SystemScheduler& GetSystems();
+
+		//Scatter InCount point lights over a square of InExtent around the origin,created at the next PlaybackCommands.
+		void CreateRandomPointLights(uint32_t InCount, float InExtent = 65.0f);
+
+		//Same distribution,spot lights point down with random tilts and capsules lie in random directions.
+		void CreateRandomLights(uint32_t InCount, ECS::LightType InType, float InExtent = 65.0f);
+
+		//Disabled by default.
+		ECS::LightAnimationSystem* GetLightAnimation();
 
 		entt::registry& GetRegistery();
 
@@ -23,18 +57,68 @@ namespace GAS
 		using DelegateOnNewEntityAdded = std::function<void(std::shared_ptr<GameScene>, std::span<entt::entity>)>;
 		inline static std::vector<DelegateOnNewEntityAdded> sOnNewEntityAdded;
 
-		const std::unordered_map<std::string, AssetLoader::TextureData*>& GetTextureMap();
+		//Called on the scene thread right before InEntities are destroyed,e.g. when a streamed cell unloads.
+		using DelegateOnEntitiesRemoved = std::function<void(std::shared_ptr<GameScene>, std::span<const entt::entity>)>;
+		inline static std::vector<DelegateOnEntitiesRemoved> sOnEntitiesRemoved;
+
+		//Called before the scene drops its entities and asset references,GPU users release theirs here.
+		using DelegateOnSceneUnload = std::function<void(std::shared_ptr<GameScene>)>;
+		inline static std::vector<DelegateOnSceneUnload> sOnSceneUnload;
+
+		//Destroy every entity and release the scene's meshes and textures.
+		void Unload();
+
+		const std::unordered_map<std::string, AssetLoader::TextureHandle>& GetTextureMap();
 
 		void SceneScale(float InScale);
+
+		ECS::MeshStore& GetMeshStore();
 	protected:
+		//Record one entity per mesh,the meshes move into the MeshStore.Returns the added components in record order.
+		std::vector<ECS::StaticMeshComponent> RecordMeshEntities(ECS::EntityCommandBuffer& OutCommands, std::vector<ECS::StaticMesh>& InModels,
+			const std::unordered_map<std::string, AssetLoader::TextureHandle>& InTextures);
+
+		//Parse InMeshFilePath and take a CPU reference on every texture it uses.
+		std::vector<ECS::StaticMesh> LoadModelFile(const std::string& InMeshFilePath, std::unordered_map<std::string, AssetLoader::TextureHandle>& OutTextures);
+
+		void UpdateStreaming();
+
+		void LoadCell(CellCoord InCoord, std::filesystem::path InFile, std::unordered_map<std::string, AssetLoader::TextureHandle> InTextures);
+
+		void RemoveEntities(std::span<const entt::entity> InEntities);
+
+		//Returns a handle holding one CPU reference,shared with a live texture of the same name if there is one.
+		AssetLoader::TextureHandle AcquireTexture(const std::string& InName, std::unique_ptr<AssetLoader::TextureData> InData);
+
+		//Playback side of a load,adopts the textures this scene does not know yet and drops the extra references.
+		void MergeTextures(const std::unordered_map<std::string, AssetLoader::TextureHandle>& InTextures);
+
+		void ReleaseTextures();
+
 		entt::registry mRegistery;
 
+		//The model loaders keep per file state,only one file is parsed at a time.
 		std::mutex mLoadMutex;
+
+		ECS::EntityCommandQueue mCommandQueue;
+
+		std::vector<std::future<void>> mPendingLoads;
 		
 		std::atomic_bool mLoaded = false;
 
-		std::unordered_map<std::string, AssetLoader::TextureData*> mTextureMap;
+		//Scene textures by name,the scene holds one CPU reference on each.
+		std::unordered_map<std::string, AssetLoader::TextureHandle> mTextureMap;
 
 		float mScale = 1.0f;
+
+		ECS::MeshStore mMeshStore;
+
+		ECS::SystemScheduler mSystems;
+
+		ECS::LightAnimationSystem* mLightAnimation = nullptr;
+
+		WorldPartition mPartition;
+
+		DirectX::SimpleMath::Vector3 mStreamingFocus = {};
 	};
 }
\ No newline at end of file
@@ -11,16 +11,28 @@ namespace Renderer
 		std::array<float, 2> textureCoord;
 	};
 
+	//Range of a cluster's lights in the compacted light index list.
 	struct Cluster
 	{
-		std::array<uint32_t, 8> light;
+		uint32_t offset;
+		uint32_t count;
 	};
 
 	constexpr int VERTEX_SIZE_IN_BYTE = sizeof(Renderer::Vertex);
-	constexpr int MAX_ELE_COUNT = 1 * 1024 * 1024 * 1024 / VERTEX_SIZE_IN_BYTE;
 	constexpr int MAX_LIGHT_PER_TYPE = 32;
+	//Default cluster grid,the grid in use is chosen at runtime and passed through FrameData.
 	constexpr int CLUSTER_X = 32;
 	constexpr int CLUSTER_Y = 16;
 	constexpr int CLUSTER_Z = 16;
+	//Largest runtime grid,the cluster buffers are sized for it.
+	constexpr int MAX_CLUSTER_X = 64;
+	constexpr int MAX_CLUSTER_Y = 32;
+	constexpr int MAX_CLUSTER_Z = 64;
+	constexpr int MAX_CLUSTER_COUNT = MAX_CLUSTER_X * MAX_CLUSTER_Y * MAX_CLUSTER_Z;
+	//Shared by all clusters,assignments past this are dropped.
+	constexpr int MAX_CLUSTER_LIGHT_INDICES = CLUSTER_X * CLUSTER_Y * CLUSTER_Z * 128;
+	//Z-binned light culling:linear depth bins up to the far plane and square screen tiles in pixels.
+	constexpr int ZBIN_COUNT = 1024;
+	constexpr int ZBIN_TILE_SIZE = 16;
 	inline constexpr int SWAP_CHAIN_BUFFER_COUNT = 3;
 }
\ No newline at end of file
@@ -0,0 +1,34 @@
+#include "light_animation_system.h"
+
+ECS::LightAnimationSystem::LightAnimationSystem():System("LightAnimation")
+{
+	Writes<LightComponent>();
+}
+
+ECS::LightAnimationSystem::~LightAnimationSystem()
+{
+
+}
+
+void ECS::LightAnimationSystem::Update(entt::registry& InRegistry, EntityCommandBuffer& OutCommands, float InDelta)
+{
+	const float lSin = std::sin(mAngularSpeed * InDelta);
+	const float lCos = std::cos(mAngularSpeed * InDelta);
+	auto lLights = InRegistry.view<LightComponent>();
+	for (auto entity : lLights)
+	{
+		//Patch so the renderer light buffer sees the change.
+		InRegistry.patch<LightComponent>(entity, [lSin, lCos](LightComponent& InLight)
+			{
+				float x = InLight.pos.x;
+				float z = InLight.pos.z;
+				InLight.pos.x = x * lCos - z * lSin;
+				InLight.pos.z = x * lSin + z * lCos;
+				//Spot and capsule axes turn with the orbit.
+				float dx = InLight.direction.x;
+				float dz = InLight.direction.z;
+				InLight.direction.x = dx * lCos - dz * lSin;
+				InLight.direction.z = dx * lSin + dz * lCos;
+			});
+	}
+}
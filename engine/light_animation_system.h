@@ -0,0 +1,19 @@
+#pragma once
+#include "system_scheduler.h"
+
+namespace ECS
+{
+	//Orbits every point light around the world Y axis,used to exercise the per frame light upload.
+	class LightAnimationSystem final : public System
+	{
+	public:
+		LightAnimationSystem();
+
+		~LightAnimationSystem();
+
+		void Update(entt::registry& InRegistry, EntityCommandBuffer& OutCommands, float InDelta) override;
+
+		//Radians per second.
+		float mAngularSpeed = 0.5f;
+	};
+}
@@ -0,0 +1,191 @@
+#include "mesh_store.h"
+
+ECS::MeshStore::MeshStore()
+{
+
+}
+
+ECS::MeshStore::~MeshStore()
+{
+	Clear();
+}
+
+ECS::StaticMeshComponent ECS::MeshStore::Add(StaticMesh&& InMesh, const std::unordered_map<std::string, AssetLoader::TextureHandle>& InTextures /*= {}*/)
+{
+	StaticMeshComponent lComponent = {};
+	lComponent.mVertexCount = (uint32_t)InMesh.mVertices.size();
+	lComponent.mIndexCount = (uint32_t)InMesh.mIndices.size();
+	lComponent.mBaseColor = InMesh.mDiffuseColor;
+	DirectX::BoundingBox::CreateFromPoints(lComponent.mBoundingBox, InMesh.mVertices.size(),
+		reinterpret_cast<const DirectX::XMFLOAT3*>(InMesh.mVertices.data()), sizeof(Renderer::Vertex));
+
+	//Keep submeshes in material index order so draw order does not depend on hash map iteration.
+	std::vector<std::pair<MaterialIndex, SubMesh>> lSubMeshes(InMesh.mSubmeshMap.begin(), InMesh.mSubmeshMap.end());
+	std::sort(lSubMeshes.begin(), lSubMeshes.end(), [](const auto& a, const auto& b) { return a.first < b.first; });
+
+	auto lFindTexture = [&InTextures](const std::unordered_map<MaterialIndex, std::string>& InNames, MaterialIndex InMatId)
+		{
+			auto lName = InNames.find(InMatId);
+			if (lName == InNames.end())
+			{
+				return AssetLoader::TextureHandle();
+			}
+			auto lTexture = InTextures.find(lName->second);
+			return lTexture == InTextures.end() ? AssetLoader::TextureHandle() : lTexture->second;
+		};
+
+	std::unique_lock lLock(mMutex);
+	lComponent.mSubMeshCount = (uint32_t)lSubMeshes.size();
+	lComponent.mFirstSubMesh = AllocateSubMeshesLocked(lComponent.mSubMeshCount);
+	uint32_t lSubMesh = lComponent.mFirstSubMesh;
+	for (const auto& [matid, subMesh] : lSubMeshes)
+	{
+		MaterialDesc lMaterial = { lFindTexture(InMesh.mMatBaseColorName, matid), lFindTexture(InMesh.mMatNormalMapName, matid) };
+		mSubMeshes[lSubMesh++] = { (uint32_t)subMesh.IndexOffset, (uint32_t)subMesh.TriangleCount * 3, FindOrAddMaterialLocked(lMaterial) };
+	}
+	auto lName = InMesh.mName;
+	lComponent.mMesh = AssetLoader::gAssetRegistry->GetMeshes().Add(lName, std::make_unique<StaticMeshAsset>(std::move(InMesh)));
+	mMeshes.push_back(lComponent.mMesh);
+	return lComponent;
+}
+
+ECS::StaticMeshAsset& ECS::MeshStore::GetMesh(MeshHandle InMesh) const
+{
+	//The store holds a CPU reference on every mesh it added,so the asset stays alive until Clear.
+	auto lAsset = AssetLoader::gAssetRegistry->GetMeshes().Get(InMesh);
+	Expects(lAsset);
+	return *lAsset;
+}
+
+void ECS::MeshStore::Clear()
+{
+	std::unique_lock lLock(mMutex);
+	//Guards against a store outliving DestroyAssetLoader,the registry then reports the leaked references itself.
+	if (AssetLoader::gAssetRegistry)
+	{
+		for (auto mesh : mMeshes)
+		{
+			AssetLoader::gAssetRegistry->GetMeshes().Release(mesh, AssetLoader::Residency::CPU);
+		}
+	}
+	mMeshes.clear();
+	mSubMeshes.clear();
+	mFreeSubMeshes.clear();
+	mMaterials.clear();
+}
+
+void ECS::MeshStore::Remove(std::span<const StaticMeshComponent> InComponents)
+{
+	std::unique_lock lLock(mMutex);
+	for (const auto& component : InComponents)
+	{
+		auto lMesh = std::find(mMeshes.begin(), mMeshes.end(), component.mMesh);
+		Expects(lMesh != mMeshes.end());
+		*lMesh = mMeshes.back();
+		mMeshes.pop_back();
+		AssetLoader::gAssetRegistry->GetMeshes().Release(component.mMesh, AssetLoader::Residency::CPU);
+		FreeSubMeshesLocked(component.mFirstSubMesh, component.mSubMeshCount);
+	}
+}
+
+std::shared_lock<std::shared_mutex> ECS::MeshStore::ReadLock() const
+{
+	return std::shared_lock(mMutex);
+}
+
+std::span<const ECS::SubMeshRange> ECS::MeshStore::GetSubMeshes(const StaticMeshComponent& InComponent) const
+{
+	Expects(InComponent.mFirstSubMesh + InComponent.mSubMeshCount <= mSubMeshes.size());
+	return { mSubMeshes.data() + InComponent.mFirstSubMesh, InComponent.mSubMeshCount };
+}
+
+std::span<const ECS::MaterialDesc> ECS::MeshStore::GetMaterials() const
+{
+	return mMaterials;
+}
+
+ECS::MaterialId ECS::MeshStore::FindOrAddMaterial(const MaterialDesc& InMaterial)
+{
+	std::unique_lock lLock(mMutex);
+	return FindOrAddMaterialLocked(InMaterial);
+}
+
+void ECS::MeshStore::SetTexture(const StaticMeshComponent& InComponent, TextureSlot InSlot, AssetLoader::TextureHandle InTexture)
+{
+	std::unique_lock lLock(mMutex);
+	Expects(InComponent.mFirstSubMesh + InComponent.mSubMeshCount <= mSubMeshes.size());
+	for (uint32_t i = InComponent.mFirstSubMesh; i < InComponent.mFirstSubMesh + InComponent.mSubMeshCount; ++i)
+	{
+		MaterialDesc lMaterial = mMaterials[mSubMeshes[i].Material];
+		(InSlot == TextureSlot::BASE_COLOR ? lMaterial.mBaseColor : lMaterial.mNormalMap) = InTexture;
+		mSubMeshes[i].Material = FindOrAddMaterialLocked(lMaterial);
+	}
+}
+
+ECS::MaterialId ECS::MeshStore::FindOrAddMaterialLocked(const MaterialDesc& InMaterial)
+{
+	auto lMaterial = std::find(mMaterials.begin(), mMaterials.end(), InMaterial);
+	if (lMaterial != mMaterials.end())
+	{
+		return MaterialId(lMaterial - mMaterials.begin());
+	}
+	mMaterials.push_back(InMaterial);
+	return MaterialId(mMaterials.size() - 1);
+}
+
+uint32_t ECS::MeshStore::AllocateSubMeshesLocked(uint32_t InCount)
+{
+	if (InCount == 0)
+	{
+		return 0;
+	}
+	auto lRange = std::find_if(mFreeSubMeshes.begin(), mFreeSubMeshes.end(), [InCount](const FreeRange& InRange) { return InRange.mCount >= InCount; });
+	if (lRange == mFreeSubMeshes.end())
+	{
+		uint32_t lFirst = (uint32_t)mSubMeshes.size();
+		mSubMeshes.resize(mSubMeshes.size() + InCount);
+		return lFirst;
+	}
+	uint32_t lFirst = lRange->mFirst;
+	lRange->mFirst += InCount;
+	lRange->mCount -= InCount;
+	if (lRange->mCount == 0)
+	{
+		mFreeSubMeshes.erase(lRange);
+	}
+	return lFirst;
+}
+
+void ECS::MeshStore::FreeSubMeshesLocked(uint32_t InFirst, uint32_t InCount)
+{
+	if (InCount == 0)
+	{
+		return;
+	}
+	Expects(InFirst + InCount <= mSubMeshes.size());
+	auto lNext = std::lower_bound(mFreeSubMeshes.begin(), mFreeSubMeshes.end(), InFirst, [](const FreeRange& InRange, uint32_t InValue) { return InRange.mFirst < InValue; });
+	Expects(lNext == mFreeSubMeshes.end() || InFirst + InCount <= lNext->mFirst);
+	FreeRange lRange = { InFirst, InCount };
+	if (lNext != mFreeSubMeshes.end() && lNext->mFirst == lRange.mFirst + lRange.mCount)
+	{
+		lRange.mCount += lNext->mCount;
+		lNext = mFreeSubMeshes.erase(lNext);
+	}
+	if (lNext != mFreeSubMeshes.begin())
+	{
+		auto lPrevious = std::prev(lNext);
+		Expects(lPrevious->mFirst + lPrevious->mCount <= lRange.mFirst);
+		if (lPrevious->mFirst + lPrevious->mCount == lRange.mFirst)
+		{
+			lRange.mFirst = lPrevious->mFirst;
+			lRange.mCount += lPrevious->mCount;
+			lNext = mFreeSubMeshes.erase(lPrevious);
+		}
+	}
+	if (lRange.mFirst + lRange.mCount == mSubMeshes.size())
+	{
+		mSubMeshes.resize(lRange.mFirst);
+		return;
+	}
+	mFreeSubMeshes.insert(lNext, lRange);
+}
@@ -0,0 +1,71 @@
+#pragma once
+#include "asset_registry.h"
+#include <shared_mutex>
+
+namespace ECS
+{
+	enum class TextureSlot
+	{
+		BASE_COLOR,
+		NORMAL_MAP
+	};
+
+	//Holds a CPU reference on the cold side of its static meshes in the AssetRegistry and owns the flattened submesh and material tables.
+	//Entities only keep a StaticMeshComponent referencing into this store.
+	class MeshStore
+	{
+	public:
+		MeshStore();
+
+		~MeshStore();
+
+		//Moves the heavy data of InMesh into the registry and returns the render component referencing it.
+		//Material texture names are resolved through InTextures,unknown names leave the slot on the default texture.
+		StaticMeshComponent Add(StaticMesh&& InMesh, const std::unordered_map<std::string, AssetLoader::TextureHandle>& InTextures = {});
+
+		StaticMeshAsset& GetMesh(MeshHandle InMesh) const;
+
+		//Release every mesh reference and reset the submesh and material tables.
+		void Clear();
+
+		//Release the meshes of InComponents and recycle their submesh ranges for later Adds.
+		//The components must no longer be drawn,their submesh ranges are handed out again.
+		void Remove(std::span<const StaticMeshComponent> InComponents);
+
+		std::span<const MeshHandle> GetMeshHandles() const { return mMeshes; }
+
+		//Hold a read lock while iterating submeshes or materials,the loader thread appends to them.
+		std::shared_lock<std::shared_mutex> ReadLock() const;
+
+		std::span<const SubMeshRange> GetSubMeshes(const StaticMeshComponent& InComponent) const;
+
+		std::span<const MaterialDesc> GetMaterials() const;
+
+		MaterialId FindOrAddMaterial(const MaterialDesc& InMaterial);
+
+		//Point every submesh of InComponent at a material with InSlot replaced.
+		void SetTexture(const StaticMeshComponent& InComponent, TextureSlot InSlot, AssetLoader::TextureHandle InTexture);
+
+	private:
+		struct FreeRange
+		{
+			uint32_t mFirst = 0;
+			uint32_t mCount = 0;
+		};
+
+		MaterialId FindOrAddMaterialLocked(const MaterialDesc& InMaterial);
+
+		//First fit in the free ranges,appends to mSubMeshes when none is large enough.
+		uint32_t AllocateSubMeshesLocked(uint32_t InCount);
+
+		//Merges with the neighbouring free ranges and trims mSubMeshes when the range ends up at its tail.
+		void FreeSubMeshesLocked(uint32_t InFirst, uint32_t InCount);
+
+		mutable std::shared_mutex mMutex;
+		std::vector<MeshHandle> mMeshes;
+		std::vector<SubMeshRange> mSubMeshes;
+		//Sorted by mFirst,never adjacent to each other or to the end of mSubMeshes.
+		std::vector<FreeRange> mFreeSubMeshes;
+		std::vector<MaterialDesc> mMaterials;
+	};
+}
@@ -24,4 +24,5 @@
 #include "logger.h"
 #include <algorithm>
 #include "DirectXMesh.h"
+#include <taskflow/taskflow.hpp>
 
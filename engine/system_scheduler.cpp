@@ -0,0 +1,106 @@
+#include "system_scheduler.h"
+#include "engine.h"
+
+bool ECS::ComponentAccess::Conflicts(const ComponentAccess& InOther) const
+{
+	auto lOverlaps = [](const std::vector<entt::id_type>& InA, const std::vector<entt::id_type>& InB)
+		{
+			return std::any_of(InA.begin(), InA.end(), [&InB](entt::id_type id) { return std::find(InB.begin(), InB.end(), id) != InB.end(); });
+		};
+	return lOverlaps(mWrites, InOther.mWrites) || lOverlaps(mWrites, InOther.mReads) || lOverlaps(mReads, InOther.mWrites);
+}
+
+ECS::System::System(std::string_view InName):mName(InName)
+{
+
+}
+
+ECS::System::~System()
+{
+
+}
+
+ECS::SystemScheduler::SystemScheduler()
+{
+
+}
+
+ECS::SystemScheduler::~SystemScheduler()
+{
+
+}
+
+void ECS::SystemScheduler::Run(entt::registry& InRegistry, EntityCommandQueue& InCommandQueue, float InDelta)
+{
+	Run(InRegistry, InCommandQueue, InDelta, engine::gGameEngine->GetExecutor());
+}
+
+void ECS::SystemScheduler::Run(entt::registry& InRegistry, EntityCommandQueue& InCommandQueue, float InDelta, tf::Executor& InExecutor)
+{
+	if (mSystems.empty())
+	{
+		return;
+	}
+	bool lEnabledChanged = mEnabledWhenBuilt.size() != mSystems.size();
+	for (size_t i = 0; !lEnabledChanged && i < mSystems.size(); ++i)
+	{
+		lEnabledChanged = mEnabledWhenBuilt[i] != mSystems[i].mSystem->mEnabled;
+	}
+	if (mDirty || lEnabledChanged || mRegistry != &InRegistry)
+	{
+		BuildGraph(InRegistry);
+	}
+	mDelta = InDelta;
+	InExecutor.run(*mFlow).wait();
+	//Submit in registration order so playback order does not depend on which worker finished first.
+	for (auto& entry : mSystems)
+	{
+		InCommandQueue.Submit(std::move(entry.mCommands));
+		entry.mCommands = {};
+	}
+}
+
+std::string ECS::SystemScheduler::DumpSchedule()
+{
+	if (!mFlow)
+	{
+		return {};
+	}
+	return mFlow->dump();
+}
+
+void ECS::SystemScheduler::BuildGraph(entt::registry& InRegistry)
+{
+	mRegistry = &InRegistry;
+	mFlow = std::make_unique<tf::Taskflow>("Systems");
+	mEnabledWhenBuilt.assign(mSystems.size(), false);
+	std::vector<std::optional<tf::Task>> lTasks(mSystems.size());
+	for (size_t i = 0; i < mSystems.size(); ++i)
+	{
+		auto& lSystem = *mSystems[i].mSystem;
+		if (!lSystem.mEnabled)
+		{
+			continue;
+		}
+		mEnabledWhenBuilt[i] = true;
+		for (auto assure : lSystem.GetAccess().mAssurePools)
+		{
+			assure(InRegistry);
+		}
+		lTasks[i] = mFlow->emplace([this, i]()
+			{
+				auto& lEntry = mSystems[i];
+				lEntry.mSystem->Update(*mRegistry, lEntry.mCommands, mDelta);
+			}).name(lSystem.GetName());
+		//An earlier conflicting system always runs first,the order systems were registered in is the tie breaker.
+		for (size_t j = 0; j < i; ++j)
+		{
+			if (lTasks[j] && mSystems[j].mSystem->GetAccess().Conflicts(lSystem.GetAccess()))
+			{
+				lTasks[j]->precede(*lTasks[i]);
+			}
+		}
+	}
+	mDirty = false;
+	gLogger->info("System schedule rebuilt:{} systems", std::count(mEnabledWhenBuilt.begin(), mEnabledWhenBuilt.end(), true));
+}
@@ -0,0 +1,107 @@
+#pragma once
+#include "entity_command_buffer.h"
+
+namespace ECS
+{
+	//Component pools a system touches,used to decide which systems may run at the same time.
+	struct ComponentAccess
+	{
+		std::vector<entt::id_type> mReads;
+		std::vector<entt::id_type> mWrites;
+		//Creates the declared pools up front,entt creates missing pools lazily which is not thread safe.
+		std::vector<void(*)(entt::registry&)> mAssurePools;
+
+		//Two systems conflict when either one writes a pool the other one reads or writes.
+		bool Conflicts(const ComponentAccess& InOther) const;
+	};
+
+	//A unit of per frame engine logic.
+	//Systems declare their component access in the constructor and must not create or destroy entities directly,
+	//structural changes go through the command buffer and are applied at the next scene sync point.
+	class System
+	{
+	public:
+		System(std::string_view InName);
+
+		virtual ~System();
+
+		virtual void Update(entt::registry& InRegistry, EntityCommandBuffer& OutCommands, float InDelta) = 0;
+
+		const std::string& GetName() const { return mName; }
+
+		const ComponentAccess& GetAccess() const { return mAccess; }
+
+		bool mEnabled = true;
+
+	protected:
+		template<typename... T>
+		void Reads()
+		{
+			(Declare<T>(mAccess.mReads), ...);
+		}
+
+		template<typename... T>
+		void Writes()
+		{
+			(Declare<T>(mAccess.mWrites), ...);
+		}
+
+	private:
+		template<typename T>
+		void Declare(std::vector<entt::id_type>& OutAccess)
+		{
+			OutAccess.push_back(entt::type_hash<T>::value());
+			mAccess.mAssurePools.push_back([](entt::registry& InRegistry) { InRegistry.storage<T>(); });
+		}
+
+		std::string mName;
+		ComponentAccess mAccess;
+	};
+
+	//Runs the registered systems on the engine's taskflow executor.
+	//Conflicting systems keep their registration order,everything else runs in parallel.
+	class SystemScheduler
+	{
+	public:
+		SystemScheduler();
+
+		~SystemScheduler();
+
+		template<typename T, typename... Args>
+		T* Register(Args&&... InArgs)
+		{
+			auto lSystem = std::make_unique<T>(std::forward<Args>(InArgs)...);
+			T* lResult = lSystem.get();
+			mSystems.push_back({ std::move(lSystem), {} });
+			mDirty = true;
+			return lResult;
+		}
+
+		//Build the dependency graph if the enabled set changed,run it and submit the recorded commands to InCommandQueue.
+		void Run(entt::registry& InRegistry, EntityCommandQueue& InCommandQueue, float InDelta);
+
+		//Same as above on InExecutor instead of the engine's,for tools and benchmarks that run without a GameEngine.
+		void Run(entt::registry& InRegistry, EntityCommandQueue& InCommandQueue, float InDelta, tf::Executor& InExecutor);
+
+		//Graphviz dot of the current schedule.
+		std::string DumpSchedule();
+
+		size_t Size() const { return mSystems.size(); }
+
+	private:
+		void BuildGraph(entt::registry& InRegistry);
+
+		struct Entry
+		{
+			std::unique_ptr<System> mSystem;
+			EntityCommandBuffer mCommands;
+		};
+
+		std::vector<Entry> mSystems;
+		std::vector<bool> mEnabledWhenBuilt;
+		std::unique_ptr<tf::Taskflow> mFlow;
+		entt::registry* mRegistry = nullptr;
+		float mDelta = 0.0f;
+		bool mDirty = true;
+	};
+}
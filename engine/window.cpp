@@ -60,6 +60,14 @@ namespace Window
 		return mHeight;
 	}
 
+	float BaseWindow::TickDelta()
+	{
+		auto lNow = std::chrono::steady_clock::now();
+		float lDelta = mLastTick ? std::chrono::duration<float>(lNow - *mLastTick).count() : 0.0f;
+		mLastTick = lNow;
+		return lDelta;
+	}
+
 	void BaseWindow::SetRenderFunc(std::function<void(float)> InFunc)
 	{
 		mRenderFunc = InFunc;
@@ -163,7 +171,7 @@ namespace Window
                 if (msg.message == WM_QUIT)
                     done = true;
             }
-            mRenderFunc(0.0f);
+            mRenderFunc(TickDelta());
             if (done)
                 break;
         } while (mRenderFunc);  // Returns false to quit loop
@@ -217,7 +225,7 @@ void Window::GlfwWindow::WindowLoop()
 		/* Render here */
 		if (mRenderFunc)
 		{
-			mRenderFunc(0.0f);
+			mRenderFunc(TickDelta());
 		}
 		/* Swap front and back buffers */
 		glfwSwapBuffers(mWindow);
@@ -23,6 +23,9 @@ namespace Window
 		virtual void WindowLoop() = 0;
 		void SetRenderFunc(std::function<void(float)> InFunc);
 	protected:
+		//Seconds since the previous call,0 on the first frame.
+		float TickDelta();
+		std::optional<std::chrono::steady_clock::time_point> mLastTick;
 		int mWidth;
 		int mHeight;
 		std::function<void(float)> mRenderFunc;
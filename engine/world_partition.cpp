@@ -0,0 +1,350 @@
+#include "world_partition.h"
+#include <fstream>
+
+namespace
+{
+	//"R3DC" in file byte order.
+	constexpr uint32_t CELL_FILE_MAGIC = 0x43443352;
+	constexpr uint32_t CELL_FILE_VERSION = 1;
+
+	template<typename T>
+	void Write(std::ofstream& InFile, const T& InValue)
+	{
+		static_assert(std::is_trivially_copyable_v<T>);
+		InFile.write(reinterpret_cast<const char*>(&InValue), sizeof(T));
+	}
+
+	template<typename T>
+	void WriteArray(std::ofstream& InFile, const std::vector<T>& InValues)
+	{
+		static_assert(std::is_trivially_copyable_v<T>);
+		Write(InFile, (uint32_t)InValues.size());
+		InFile.write(reinterpret_cast<const char*>(InValues.data()), InValues.size() * sizeof(T));
+	}
+
+	void WriteString(std::ofstream& InFile, const std::string& InValue)
+	{
+		Write(InFile, (uint32_t)InValue.size());
+		InFile.write(InValue.data(), InValue.size());
+	}
+
+	void WriteNames(std::ofstream& InFile, const std::unordered_map<ECS::MaterialIndex, std::string>& InNames)
+	{
+		Write(InFile, (uint32_t)InNames.size());
+		for (const auto& [matid, name] : InNames)
+		{
+			Write(InFile, matid);
+			WriteString(InFile, name);
+		}
+	}
+
+	template<typename T>
+	T Read(std::ifstream& InFile)
+	{
+		T lValue = {};
+		InFile.read(reinterpret_cast<char*>(&lValue), sizeof(T));
+		return lValue;
+	}
+
+	template<typename T>
+	void ReadArray(std::ifstream& InFile, std::vector<T>& OutValues)
+	{
+		OutValues.resize(Read<uint32_t>(InFile));
+		InFile.read(reinterpret_cast<char*>(OutValues.data()), OutValues.size() * sizeof(T));
+	}
+
+	std::string ReadString(std::ifstream& InFile)
+	{
+		std::string lValue(Read<uint32_t>(InFile), '\0');
+		InFile.read(lValue.data(), lValue.size());
+		return lValue;
+	}
+
+	void ReadNames(std::ifstream& InFile, std::unordered_map<ECS::MaterialIndex, std::string>& OutNames)
+	{
+		auto lCount = Read<uint32_t>(InFile);
+		for (uint32_t i = 0; i < lCount; ++i)
+		{
+			auto lMatId = Read<ECS::MaterialIndex>(InFile);
+			OutNames[lMatId] = ReadString(InFile);
+		}
+	}
+
+	void WriteMesh(std::ofstream& InFile, const ECS::StaticMesh& InMesh)
+	{
+		WriteString(InFile, InMesh.mName);
+		WriteArray(InFile, InMesh.mVertices);
+		WriteArray(InFile, InMesh.mIndices);
+		Write(InFile, (uint32_t)InMesh.mSubmeshMap.size());
+		for (const auto& [matid, subMesh] : InMesh.mSubmeshMap)
+		{
+			Write(InFile, matid);
+			Write(InFile, subMesh);
+		}
+		WriteNames(InFile, InMesh.mMatBaseColorName);
+		WriteNames(InFile, InMesh.mMatNormalMapName);
+		Write(InFile, InMesh.mDiffuseColor);
+		Write(InFile, std::array<bool, 5>{ InMesh.mHasNormal, InMesh.mHasUV, InMesh.mAllByControlPoint, InMesh.mHasTangent, InMesh.mHasBitangent });
+		Write(InFile, InMesh.Rotation);
+		Write(InFile, InMesh.Scale);
+		Write(InFile, InMesh.Translation);
+	}
+
+	ECS::StaticMesh ReadMesh(std::ifstream& InFile)
+	{
+		ECS::StaticMesh lMesh = {};
+		lMesh.mName = ReadString(InFile);
+		ReadArray(InFile, lMesh.mVertices);
+		ReadArray(InFile, lMesh.mIndices);
+		auto lSubMeshCount = Read<uint32_t>(InFile);
+		for (uint32_t i = 0; i < lSubMeshCount; ++i)
+		{
+			auto lMatId = Read<ECS::MaterialIndex>(InFile);
+			lMesh.mSubmeshMap[lMatId] = Read<ECS::SubMesh>(InFile);
+		}
+		ReadNames(InFile, lMesh.mMatBaseColorName);
+		ReadNames(InFile, lMesh.mMatNormalMapName);
+		lMesh.mDiffuseColor = Read<DirectX::XMFLOAT3>(InFile);
+		auto lFlags = Read<std::array<bool, 5>>(InFile);
+		lMesh.mHasNormal = lFlags[0];
+		lMesh.mHasUV = lFlags[1];
+		lMesh.mAllByControlPoint = lFlags[2];
+		lMesh.mHasTangent = lFlags[3];
+		lMesh.mHasBitangent = lFlags[4];
+		lMesh.Rotation = Read<DirectX::SimpleMath::Vector3>(InFile);
+		lMesh.Scale = Read<DirectX::SimpleMath::Vector3>(InFile);
+		lMesh.Translation = Read<DirectX::SimpleMath::Vector3>(InFile);
+		return lMesh;
+	}
+}
+
+GAS::WorldPartition::WorldPartition()
+{
+
+}
+
+GAS::WorldPartition::~WorldPartition()
+{
+
+}
+
+std::vector<GAS::WorldPartition::Cell> GAS::WorldPartition::Cook(std::vector<ECS::StaticMesh>&& InMeshes, const std::filesystem::path& InCookDirectory, float InCellSize)
+{
+	Expects(InCellSize > 0.0f);
+	std::filesystem::create_directories(InCookDirectory);
+	std::unordered_map<CellCoord, std::pair<Cell, std::vector<ECS::StaticMesh*>>, CellCoordHash> lCells;
+	for (auto& mesh : InMeshes)
+	{
+		DirectX::BoundingBox lBounds;
+		DirectX::BoundingBox::CreateFromPoints(lBounds, mesh.mVertices.size(),
+			reinterpret_cast<const DirectX::XMFLOAT3*>(mesh.mVertices.data()), sizeof(Renderer::Vertex));
+		//Only reads the transform,mesh stays intact.
+		lBounds.Transform(lBounds, ECS::TransformComponent(std::move(mesh)).GetModelMatrix(false));
+		CellCoord lCoord = { (int32_t)std::floor(lBounds.Center.x / InCellSize), (int32_t)std::floor(lBounds.Center.z / InCellSize) };
+		auto [lEntry, lAdded] = lCells.try_emplace(lCoord);
+		auto& [lCell, lMeshes] = lEntry->second;
+		if (lAdded)
+		{
+			lCell.mCoord = lCoord;
+			lCell.mBounds = lBounds;
+		}
+		else
+		{
+			DirectX::BoundingBox::CreateMerged(lCell.mBounds, lCell.mBounds, lBounds);
+		}
+		lMeshes.push_back(&mesh);
+	}
+
+	std::vector<Cell> lResult;
+	for (auto& [coord, entry] : lCells)
+	{
+		auto& [lCell, lMeshes] = entry;
+		lCell.mFile = InCookDirectory / ("cell_" + std::to_string(coord.x) + "_" + std::to_string(coord.z) + ".bin");
+		std::ofstream lFile(lCell.mFile, std::ios::binary | std::ios::trunc);
+		Write(lFile, CELL_FILE_MAGIC);
+		Write(lFile, CELL_FILE_VERSION);
+		Write(lFile, (uint32_t)lMeshes.size());
+		for (auto mesh : lMeshes)
+		{
+			WriteMesh(lFile, *mesh);
+		}
+		lCell.mBytes = (size_t)lFile.tellp();
+		Ensures(lFile.good());
+		lResult.push_back(std::move(lCell));
+	}
+	InMeshes.clear();
+	gLogger->info("Cooked {} cells into {}", lResult.size(), InCookDirectory.string());
+	return lResult;
+}
+
+std::vector<ECS::StaticMesh> GAS::WorldPartition::ReadCell(const std::filesystem::path& InFile)
+{
+	std::ifstream lFile(InFile, std::ios::binary);
+	if (Read<uint32_t>(lFile) != CELL_FILE_MAGIC || Read<uint32_t>(lFile) != CELL_FILE_VERSION)
+	{
+		gLogger->error("{} is not a cooked cell", InFile.string());
+		return {};
+	}
+	std::vector<ECS::StaticMesh> lMeshes(Read<uint32_t>(lFile));
+	for (auto& mesh : lMeshes)
+	{
+		mesh = ReadMesh(lFile);
+	}
+	if (!lFile.good())
+	{
+		gLogger->error("{} is truncated", InFile.string());
+		return {};
+	}
+	return lMeshes;
+}
+
+void GAS::WorldPartition::Open(std::vector<Cell>&& InCells, const StreamingSettings& InSettings)
+{
+	Expects(mCells.empty());
+	mSettings = InSettings;
+	mStats = {};
+	for (auto& cell : InCells)
+	{
+		auto lCoord = cell.mCoord;
+		mCells.emplace(lCoord, std::move(cell));
+	}
+	mStats.mCells = (uint32_t)mCells.size();
+	mWindowStart = std::chrono::steady_clock::now();
+}
+
+void GAS::WorldPartition::Close()
+{
+	mCells.clear();
+	mInFlightBytes = 0;
+	mWindowBytes = 0;
+	mStats = {};
+}
+
+GAS::WorldPartition::StreamingPlan GAS::WorldPartition::Plan(const DirectX::SimpleMath::Vector3& InFocus)
+{
+	StreamingPlan lPlan;
+	std::vector<std::pair<float, Cell*>> lWanted;
+	//Loaded cells between the load and unload radius,the first ones to go when the budget is tight.
+	std::vector<std::pair<float, Cell*>> lEvictable;
+	size_t lLoadingCount = 0;
+	for (auto& [coord, cell] : mCells)
+	{
+		float lDistance = DistanceTo(cell, InFocus);
+		switch (cell.mState)
+		{
+		case CellState::UNLOADED:
+			if (lDistance < mSettings.mLoadRadius)
+			{
+				lWanted.push_back({ lDistance, &cell });
+			}
+			break;
+		case CellState::LOADING:
+			lLoadingCount++;
+			break;
+		case CellState::LOADED:
+			if (lDistance > mSettings.mUnloadRadius)
+			{
+				lPlan.mUnload.push_back(coord);
+			}
+			else if (lDistance > mSettings.mLoadRadius)
+			{
+				lEvictable.push_back({ lDistance, &cell });
+			}
+			break;
+		}
+	}
+
+	size_t lCommitted = mStats.mResidentBytes + mInFlightBytes;
+	for (auto coord : lPlan.mUnload)
+	{
+		lCommitted -= mCells[coord].mBytes;
+	}
+	std::sort(lWanted.begin(), lWanted.end(), [](const auto& a, const auto& b) { return a.first < b.first; });
+	std::sort(lEvictable.begin(), lEvictable.end(), [](const auto& a, const auto& b) { return a.first > b.first; });
+	auto lEvict = lEvictable.begin();
+	for (auto [distance, cell] : lWanted)
+	{
+		if (lLoadingCount >= mSettings.mMaxConcurrentLoads)
+		{
+			break;
+		}
+		while (lCommitted + cell->mBytes > mSettings.mMemoryBudget && lEvict != lEvictable.end())
+		{
+			lPlan.mUnload.push_back(lEvict->second->mCoord);
+			lCommitted -= lEvict->second->mBytes;
+			++lEvict;
+		}
+		if (lCommitted + cell->mBytes > mSettings.mMemoryBudget)
+		{
+			mStats.mBudgetDeferrals++;
+			continue;
+		}
+		cell->mState = CellState::LOADING;
+		lCommitted += cell->mBytes;
+		mInFlightBytes += cell->mBytes;
+		lLoadingCount++;
+		lPlan.mLoad.push_back(cell->mCoord);
+	}
+	mStats.mLoadingCells = (uint32_t)lLoadingCount;
+	return lPlan;
+}
+
+GAS::WorldPartition::Cell* GAS::WorldPartition::GetCell(CellCoord InCoord)
+{
+	auto lCell = mCells.find(InCoord);
+	return lCell == mCells.end() ? nullptr : &lCell->second;
+}
+
+void GAS::WorldPartition::OnCellLoaded(CellCoord InCoord, std::vector<entt::entity>&& InEntities, std::vector<ECS::StaticMeshComponent>&& InMeshes)
+{
+	auto lCell = GetCell(InCoord);
+	Expects(lCell && lCell->mState == CellState::LOADING);
+	lCell->mState = CellState::LOADED;
+	lCell->mEntities = std::move(InEntities);
+	lCell->mMeshes = std::move(InMeshes);
+	mInFlightBytes -= lCell->mBytes;
+	mStats.mResidentBytes += lCell->mBytes;
+	mStats.mBytesStreamed += lCell->mBytes;
+	mWindowBytes += lCell->mBytes;
+	mStats.mResidentCells++;
+	mStats.mLoadingCells--;
+	mStats.mCellLoads++;
+}
+
+std::vector<ECS::StaticMeshComponent> GAS::WorldPartition::OnCellUnloaded(CellCoord InCoord)
+{
+	auto lCell = GetCell(InCoord);
+	Expects(lCell && lCell->mState == CellState::LOADED);
+	lCell->mState = CellState::UNLOADED;
+	lCell->mEntities.clear();
+	mStats.mResidentBytes -= lCell->mBytes;
+	mStats.mResidentCells--;
+	mStats.mCellUnloads++;
+	return std::exchange(lCell->mMeshes, {});
+}
+
+void GAS::WorldPartition::EndFrame(float InStreamingMs)
+{
+	mStats.mLastFrameMs = InStreamingMs;
+	mStats.mMaxFrameMs = std::max(mStats.mMaxFrameMs, InStreamingMs);
+	if (InStreamingMs > mSettings.mHitchThresholdMs)
+	{
+		mStats.mHitches++;
+	}
+	auto lNow = std::chrono::steady_clock::now();
+	float lWindowSeconds = std::chrono::duration<float>(lNow - mWindowStart).count();
+	if (lWindowSeconds >= 1.0f)
+	{
+		mStats.mBandwidthMBs = mWindowBytes / lWindowSeconds / (1024.0f * 1024.0f);
+		mWindowBytes = 0;
+		mWindowStart = lNow;
+	}
+}
+
+float GAS::WorldPartition::DistanceTo(const Cell& InCell, const DirectX::SimpleMath::Vector3& InFocus) const
+{
+	//Distance on the XZ plane to the cell mesh bounds,0 inside.
+	float lDx = std::max(std::abs(InFocus.x - InCell.mBounds.Center.x) - InCell.mBounds.Extents.x, 0.0f);
+	float lDz = std::max(std::abs(InFocus.z - InCell.mBounds.Center.z) - InCell.mBounds.Extents.z, 0.0f);
+	return std::sqrt(lDx * lDx + lDz * lDz);
+}
@@ -0,0 +1,138 @@
+#pragma once
+#include "components.h"
+
+namespace GAS
+{
+	//Cell index on the XZ grid.
+	struct CellCoord
+	{
+		int32_t x = 0;
+		int32_t z = 0;
+		bool operator==(const CellCoord&) const = default;
+	};
+
+	struct CellCoordHash
+	{
+		size_t operator()(const CellCoord& InCoord) const
+		{
+			return std::hash<uint64_t>()((uint64_t(uint32_t(InCoord.x)) << 32) | uint32_t(InCoord.z));
+		}
+	};
+
+	struct StreamingSettings
+	{
+		float mCellSize = 32.0f;
+		//Cells closer than mLoadRadius are requested,loaded cells are only dropped past mUnloadRadius.
+		float mLoadRadius = 64.0f;
+		float mUnloadRadius = 96.0f;
+		//Upper bound for the CPU bytes of resident and in flight cells.
+		size_t mMemoryBudget = 512ull * 1024 * 1024;
+		uint32_t mMaxConcurrentLoads = 2;
+		//Frames whose streaming work on the scene thread takes longer than this count as hitches.
+		float mHitchThresholdMs = 2.0f;
+	};
+
+	struct StreamingStats
+	{
+		uint32_t mCells = 0;
+		uint32_t mResidentCells = 0;
+		uint32_t mLoadingCells = 0;
+		size_t mResidentBytes = 0;
+		uint64_t mBytesStreamed = 0;
+		uint32_t mCellLoads = 0;
+		uint32_t mCellUnloads = 0;
+		//Cells skipped in a frame because they did not fit the memory budget.
+		uint32_t mBudgetDeferrals = 0;
+		//Bytes read per second over the last second.
+		float mBandwidthMBs = 0.0f;
+		float mLastFrameMs = 0.0f;
+		float mMaxFrameMs = 0.0f;
+		uint32_t mHitches = 0;
+	};
+
+	//Grid of cooked cells and their streaming state.
+	//Cooking splits a scene into one file per cell so a cell can be read back without parsing the source asset.
+	//All methods except ReadCell must be called from the scene thread.
+	class WorldPartition
+	{
+	public:
+		enum class CellState : uint8_t
+		{
+			UNLOADED,
+			LOADING,
+			LOADED
+		};
+
+		struct Cell
+		{
+			CellCoord mCoord;
+			std::filesystem::path mFile;
+			//Union of the world bounds of the cell meshes,a mesh belongs to the cell holding its bounds center.
+			DirectX::BoundingBox mBounds;
+			//Size of the cooked file,the cell meshes take about as much CPU memory once loaded.
+			size_t mBytes = 0;
+			CellState mState = CellState::UNLOADED;
+			std::vector<entt::entity> mEntities;
+			//What the cell added to the MeshStore,handed back on unload so the store can recycle it.
+			std::vector<ECS::StaticMeshComponent> mMeshes;
+		};
+
+		struct StreamingPlan
+		{
+			std::vector<CellCoord> mLoad;
+			std::vector<CellCoord> mUnload;
+		};
+
+		WorldPartition();
+
+		~WorldPartition();
+
+		//Split InMeshes into cells and write one file per cell into InCookDirectory,returns the cell table.
+		static std::vector<Cell> Cook(std::vector<ECS::StaticMesh>&& InMeshes, const std::filesystem::path& InCookDirectory, float InCellSize);
+
+		//Safe to call from any thread.
+		static std::vector<ECS::StaticMesh> ReadCell(const std::filesystem::path& InFile);
+
+		void Open(std::vector<Cell>&& InCells, const StreamingSettings& InSettings);
+
+		void Close();
+
+		bool IsOpen() const { return !mCells.empty(); }
+
+		//Decide which cells start loading and which ones unload this frame,the returned load cells are marked LOADING.
+		StreamingPlan Plan(const DirectX::SimpleMath::Vector3& InFocus);
+
+		Cell* GetCell(CellCoord InCoord);
+
+		void OnCellLoaded(CellCoord InCoord, std::vector<entt::entity>&& InEntities, std::vector<ECS::StaticMeshComponent>&& InMeshes);
+
+		//Returns the meshes the cell held so the caller can remove them from the MeshStore.
+		std::vector<ECS::StaticMeshComponent> OnCellUnloaded(CellCoord InCoord);
+
+		//Called once per frame with the time spent on streaming work on the scene thread.
+		void EndFrame(float InStreamingMs);
+
+		StreamingSettings& GetSettings() { return mSettings; }
+
+		const StreamingStats& GetStats() const { return mStats; }
+
+		template<typename F>
+		void ForEachCell(F&& InFunc) const
+		{
+			for (const auto& [coord, cell] : mCells)
+			{
+				InFunc(cell);
+			}
+		}
+
+	private:
+		float DistanceTo(const Cell& InCell, const DirectX::SimpleMath::Vector3& InFocus) const;
+
+		std::unordered_map<CellCoord, Cell, CellCoordHash> mCells;
+		StreamingSettings mSettings;
+		StreamingStats mStats;
+		size_t mInFlightBytes = 0;
+		uint64_t mWindowBytes = 0;
+		std::chrono::steady_clock::time_point mWindowStart;
+	};
+}
@@ -21,6 +21,9 @@ int WINAPI wWinMain(_In_ HINSTANCE hInstance, _In_opt_ HINSTANCE /*hPrevInstance
 
 	//Game Scene 
 	std::shared_ptr<GAS::GameScene> newScene = std::make_shared<GAS::GameScene>();
+	newScene->CreateRandomPointLights(256);
+	newScene->CreateRandomLights(64, ECS::LightType::SPOT);
+	newScene->CreateRandomLights(32, ECS::LightType::CAPSULE);
 	//1.Renderer
 #ifdef USE_DXR_RENDERER
 	std::shared_ptr<Renderer::DXRRenderer> renderer = std::make_shared<Renderer::DXRRenderer>();
@@ -42,6 +45,9 @@ int WINAPI wWinMain(_In_ HINSTANCE hInstance, _In_opt_ HINSTANCE /*hPrevInstance
 	//4.Window Message Loop
 	Window::gMainWindow->WindowLoop();
 	delete Window::gMainWindow;
+	//Scenes and renderers release their asset references before the registry goes away.
+	renderer.reset();
+	newScene.reset();
 	AssetLoader::DestroyAssetLoader();
 	return 0;
 }
\ No newline at end of file
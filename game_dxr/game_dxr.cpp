@@ -41,6 +41,9 @@ int WINAPI wWinMain(_In_ HINSTANCE hInstance, _In_opt_ HINSTANCE /*hPrevInstance
 	//4.Window Message Loop
 	Window::gMainWindow->WindowLoop();
 	delete Window::gMainWindow;
+	//Scenes and renderers release their asset references before the registry goes away.
+	renderer.reset();
+	newScene.reset();
 	AssetLoader::DestroyAssetLoader();
 	return 0;
 }
\ No newline at end of file
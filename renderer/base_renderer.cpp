@@ -5,15 +5,40 @@ Renderer::BaseRenderer::BaseRenderer():
 	mDeviceManager(std::make_unique<DeviceManager>()),
 	mCmdManager(mDeviceManager->GetCmdManager()),
 	mBatchUploader(std::make_unique<ResourceUploadBatch>(g_Device)),
-	mGraphicsFenceValue(1),
 	mCurrentScene(nullptr)
 {
-	
+	AssetLoader::gAssetRegistry->GetTextures().SetGpuReleaseCallback([this](AssetLoader::TextureHandle InTexture, const std::string& InName)
+		{
+			OnTextureGpuReleased(InTexture, InName);
+		});
+	GAS::GameScene::sOnSceneUnload.push_back([this](std::shared_ptr<GAS::GameScene> InScene)
+		{
+			ReleaseSceneGpuAssets(InScene);
+		});
+	GAS::GameScene::sOnEntitiesRemoved.push_back([this](std::shared_ptr<GAS::GameScene> InScene, std::span<const entt::entity> InEntities)
+		{
+			ReleaseEntityGpuAssets(InScene, InEntities);
+		});
 }
 
 Renderer::BaseRenderer::~BaseRenderer()
 {
-
+	if (mLightBuffer)
+	{
+		mLightBuffer->Track(nullptr);
+	}
+	if (!AssetLoader::gAssetRegistry)
+	{
+		return;
+	}
+	AssetLoader::gAssetRegistry->GetTextures().SetGpuReleaseCallback(nullptr);
+	for (uint32_t i = 0; i < mGpuTextures.size(); ++i)
+	{
+		if (mGpuTextures[i].mTexture)
+		{
+			AssetLoader::gAssetRegistry->GetTextures().Release({ i, mGpuTextures[i].mGeneration }, AssetLoader::Residency::GPU);
+		}
+	}
 }
 
 void Renderer::BaseRenderer::SetTargetWindowAndCreateSwapChain(HWND InWindow, int InWidth, int InHeight)
@@ -34,20 +59,192 @@ void Renderer::BaseRenderer::SetTargetWindowAndCreateSwapChain(HWND InWindow, in
 void Renderer::BaseRenderer::LoadGameScene(std::shared_ptr<GAS::GameScene> InGameScene)
 {
 	mCurrentScene = InGameScene;
-	entt::registry& sceneRegistery = mCurrentScene->GetRegistery();
-	mLoadResourceFuture = std::async(std::launch::async, [&]()
+	mLightBuffer->Track(&mCurrentScene->GetRegistery());
+	//Snapshot on this thread,the loader thread never touches the live registry and sends the offsets back as patches.
+	std::vector<std::pair<entt::entity, ECS::StaticMeshComponent>> lMeshes;
+	mCurrentScene->GetRegistery().view<ECS::StaticMeshComponent>().each([&lMeshes](auto entity, ECS::StaticMeshComponent& renderComponent) {
+		lMeshes.push_back({ entity, renderComponent });
+		});
+	auto lTextures = mCurrentScene->GetTextureMap();
+	mLoadResourceFuture = std::async(std::launch::async, [this, lMeshes = std::move(lMeshes), lTextures = std::move(lTextures)]() mutable
 		{
-			auto allStaticMeshComponents = sceneRegistery.view<ECS::StaticMeshComponent>();
-			allStaticMeshComponents.each([this](auto entity, ECS::StaticMeshComponent& renderComponent) {
-				GetContext()->LoadStaticMeshToGpu(renderComponent);
-				});
-			for (auto [textureName, textureData] : mCurrentScene->GetTextureMap())
+			ECS::EntityCommandBuffer lCommands;
+			//Size the geometry pools for the whole scene up front.
+			GeometryDemand lDemand;
+			for (auto& [entity, renderComponent] : lMeshes)
+			{
+				lDemand.Add(mCurrentScene->GetMeshStore().GetMesh(renderComponent.mMesh));
+			}
+			GetContext()->ReserveGeometry(lDemand);
+			for (auto& [entity, renderComponent] : lMeshes)
+			{
+				GetContext()->LoadStaticMeshToGpu(renderComponent, mCurrentScene->GetMeshStore().GetMesh(renderComponent.mMesh));
+				lCommands.Patch<ECS::StaticMeshComponent>(entity, [lUploaded = renderComponent](ECS::StaticMeshComponent& InComponent)
+					{
+						InComponent.StartIndexLocation = lUploaded.StartIndexLocation;
+						InComponent.BaseVertexLocation = lUploaded.BaseVertexLocation;
+						InComponent.mGeometryResident = lUploaded.mGeometryResident;
+						InComponent.m16BitIndices = lUploaded.m16BitIndices;
+					});
+			}
+			//The patched offsets are only drawn from once the geometry landed.
+			GetContext()->FlushUploads();
+			mCurrentScene->Submit(std::move(lCommands));
+			for (auto [textureName, texture] : lTextures)
 			{
-				LoadMaterial(textureName, textureData);
+				LoadMaterial(texture);
 			}
 		});
 }
 
+void Renderer::BaseRenderer::ReleaseSceneGpuAssets(std::shared_ptr<GAS::GameScene> InScene)
+{
+	const uint64_t lReleaseAfter = mRetireFrame + SWAP_CHAIN_BUFFER_COUNT;
+	auto lContext = GetContext();
+	InScene->GetRegistery().view<ECS::StaticMeshComponent>().each([this, &lContext, lReleaseAfter](auto entity, ECS::StaticMeshComponent& renderComponent)
+		{
+			if (lContext)
+			{
+				lContext->ReleaseStaticMesh(renderComponent, lReleaseAfter);
+			}
+			MeshShaderReleaseStaticmeshComponent(renderComponent, lReleaseAfter);
+		});
+	//Only textures uploaded for a scene,files loaded from the material panel stay resident.
+	std::vector<AssetLoader::TextureHandle> lSceneTextures;
+	{
+		std::lock_guard lock(mTextureMutex);
+		for (auto [textureName, texture] : InScene->GetTextureMap())
+		{
+			if (mSceneGpuTextures.erase(texture.mIndex))
+			{
+				lSceneTextures.push_back(texture);
+			}
+		}
+	}
+	for (auto texture : lSceneTextures)
+	{
+		AssetLoader::gAssetRegistry->GetTextures().Release(texture, AssetLoader::Residency::GPU);
+	}
+}
+
+void Renderer::BaseRenderer::ReleaseEntityGpuAssets(std::shared_ptr<GAS::GameScene> InScene, std::span<const entt::entity> InEntities)
+{
+	auto lContext = GetContext();
+	//The frames in flight may still draw the entities,their geometry is reused only after the pacer waited for them.
+	const uint64_t lReleaseAfter = mRetireFrame + SWAP_CHAIN_BUFFER_COUNT;
+	auto& lRegistry = InScene->GetRegistery();
+	for (auto entity : InEntities)
+	{
+		if (auto lRenderComponent = lRegistry.try_get<ECS::StaticMeshComponent>(entity))
+		{
+			if (lContext)
+			{
+				lContext->ReleaseStaticMesh(*lRenderComponent, lReleaseAfter);
+			}
+			MeshShaderReleaseStaticmeshComponent(*lRenderComponent, lReleaseAfter);
+		}
+	}
+}
+
+void Renderer::BaseRenderer::OnTextureGpuReleased(AssetLoader::TextureHandle InTexture, const std::string& InName)
+{
+	std::lock_guard lock(mTextureMutex);
+	if (InTexture.mIndex >= mGpuTextures.size() || mGpuTextures[InTexture.mIndex].mGeneration != InTexture.mGeneration)
+	{
+		return;
+	}
+	mSceneGpuTextures.erase(InTexture.mIndex);
+	auto& lTexture = mGpuTextures[InTexture.mIndex].mTexture;
+	if (auto lNamed = mTextureMap.find(InName); lNamed != mTextureMap.end() && lNamed->second == lTexture)
+	{
+		mTextureMap.erase(lNamed);
+	}
+	//The frames in flight may still sample it,keep it until the pacer has waited for all of them.
+	mRetiredTextures.push_back({ mRetireFrame + SWAP_CHAIN_BUFFER_COUNT, std::move(lTexture) });
+}
+
+void Renderer::BaseRenderer::BeginFrame()
+{
+	auto& lPacer = mDeviceManager->GetFramePacer();
+	lPacer.SetFramesInFlight(mFramesInFlight);
+	mDeviceManager->BeginFrame();
+	mFramePacerStats = lPacer.GetStats();
+	ReleaseRetiredResources();
+}
+
+void Renderer::BaseRenderer::ReleaseRetiredResources()
+{
+	std::lock_guard lock(mTextureMutex);
+	mRetireFrame++;
+	std::erase_if(mRetiredTextures, [this](const RetiredTexture& InRetired) { return InRetired.mReleaseAfter <= mRetireFrame; });
+	if (auto lContext = GetContext())
+	{
+		lContext->ReleaseRetiredGeometry(mRetireFrame);
+	}
+}
+
+void Renderer::BaseRenderer::DefragmentGeometry()
+{
+	auto lContext = GetContext();
+	//A running load still has to patch the offsets it allocated,its patches must not land after the remap.
+	if (!lContext || !mCurrentScene || (mLoadResourceFuture.valid() && mLoadResourceFuture.wait_for(std::chrono::seconds(0)) != std::future_status::ready))
+	{
+		return;
+	}
+	//The components switch at the next playback,the frame recorded until then still draws from the old ranges.
+	auto lRelocations = lContext->DefragmentGeometry(MAX_GEOMETRY_MOVES, mRetireFrame + SWAP_CHAIN_BUFFER_COUNT + 1);
+	if (lRelocations.mVertices.empty() && lRelocations.mIndices.empty() && lRelocations.mIndices16.empty())
+	{
+		return;
+	}
+	std::unordered_map<uint32_t, uint32_t> lVertexMoves;
+	std::array<std::unordered_map<uint32_t, uint32_t>, 2> lIndexMoves;
+	for (const auto& move : lRelocations.mVertices)
+	{
+		lVertexMoves.emplace(move.mFrom, move.mTo);
+	}
+	for (const auto& move : lRelocations.mIndices)
+	{
+		lIndexMoves[0].emplace(move.mFrom, move.mTo);
+	}
+	for (const auto& move : lRelocations.mIndices16)
+	{
+		lIndexMoves[1].emplace(move.mFrom, move.mTo);
+	}
+	//Queued behind the patches of finished loads,so every resident component is remapped.
+	ECS::EntityCommandBuffer lCommands;
+	lCommands.Run([lVertexMoves = std::move(lVertexMoves), lIndexMoves = std::move(lIndexMoves)](entt::registry& InRegistry, std::span<entt::entity>)
+		{
+			InRegistry.view<ECS::StaticMeshComponent>().each([&](auto entity, ECS::StaticMeshComponent& renderComponent)
+				{
+					if (!renderComponent.mGeometryResident)
+					{
+						return;
+					}
+					if (auto lVertex = lVertexMoves.find((uint32_t)renderComponent.BaseVertexLocation); lVertex != lVertexMoves.end())
+					{
+						renderComponent.BaseVertexLocation = (int32_t)lVertex->second;
+					}
+					auto& lMoves = lIndexMoves[renderComponent.m16BitIndices];
+					if (auto lIndex = lMoves.find(renderComponent.StartIndexLocation); lIndex != lMoves.end())
+					{
+						renderComponent.StartIndexLocation = lIndex->second;
+					}
+				});
+		});
+	mCurrentScene->Submit(std::move(lCommands));
+}
+
+std::shared_ptr<Renderer::Resource::Texture> Renderer::BaseRenderer::GetTexture(AssetLoader::TextureHandle InTexture)
+{
+	std::lock_guard lock(mTextureMutex);
+	if (!InTexture.IsValid() || InTexture.mIndex >= mGpuTextures.size() || mGpuTextures[InTexture.mIndex].mGeneration != InTexture.mGeneration)
+	{
+		return nullptr;
+	}
+	return mGpuTextures[InTexture.mIndex].mTexture;
+}
+
 void Renderer::BaseRenderer::Update(float delta)
 {
 
@@ -67,32 +264,21 @@ void Renderer::BaseRenderer::TransitState(ID3D12GraphicsCommandList* InCmd, ID3D
 
 std::shared_ptr<Renderer::Resource::Texture> Renderer::BaseRenderer::LoadMaterial(std::string_view InTextureName, std::string_view InMatName /*= {}*/, const std::wstring& InDebugName /*= L""*/)
 {
+	std::string lName = InMatName.empty() ? std::filesystem::path(InTextureName).filename().string() : std::string(InMatName);
+	auto& textures = AssetLoader::gAssetRegistry->GetTextures();
+	if (auto lResident = GetTexture(textures.Find(lName)))
+	{
+		return lResident;
+	}
 	auto newTextureData = AssetLoader::gStbTextureLoader->LoadTextureFromFile(InTextureName);
 	if (!newTextureData.has_value())
 	{
 		return nullptr;
 	}
-
-	std::shared_ptr<Resource::Texture> newTexture = std::make_shared<Resource::Texture>();
-	auto RowPitchBytes = newTextureData.value()->mWidth * newTextureData.value()->mComponent;
-	newTexture->Create2D(RowPitchBytes, newTextureData.value()->mWidth, newTextureData.value()->mHeight, DXGI_FORMAT_R8G8B8A8_UNORM, nullptr);
-	mBatchUploader->Begin(D3D12_COMMAND_LIST_TYPE_COPY);
-	D3D12_SUBRESOURCE_DATA sourceData = {};
-	sourceData.pData = newTextureData.value()->mdata;
-	sourceData.RowPitch = RowPitchBytes;
-	sourceData.SlicePitch = RowPitchBytes * newTextureData.value()->mHeight;
-	mBatchUploader->Upload(newTexture->GetResource(), 0, &sourceData, 1);
-	mBatchUploader->Transition(newTexture->GetResource(), D3D12_RESOURCE_STATE_COPY_DEST, D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE);
-	mBatchUploader->End(mCmdManager->GetQueue(D3D12_COMMAND_LIST_TYPE_COPY));
-	newTexture->GetResource()->SetName(InDebugName.c_str());
-	if (!InMatName.empty())
-	{
-		mTextureMap[std::string(InMatName)] = newTexture;
-	}
-	else
-	{
-		mTextureMap[std::filesystem::path(InTextureName).filename().string()] = newTexture;
-	}
+	auto lHandle = textures.Add(lName, std::unique_ptr<AssetLoader::TextureData>(newTextureData.value()));
+	auto newTexture = UploadTexture(lHandle, lName, InDebugName);
+	//Nothing else needs the pixels once they are on the GPU.
+	textures.Release(lHandle, AssetLoader::Residency::CPU);
 	return newTexture;
 }
 
@@ -101,6 +287,11 @@ std::unordered_map<std::string, std::shared_ptr<Renderer::Resource::Texture>>& R
 	return mTextureMap;
 }
 
+const Renderer::LightUploadStats& Renderer::BaseRenderer::GetLightUploadStats() const
+{
+	return mLightBuffer->GetStats();
+}
+
 void Renderer::BaseRenderer::CreateBuffers()
 {
 	for (auto i = 0; i < SWAP_CHAIN_BUFFER_COUNT; ++i)
@@ -118,66 +309,15 @@ void Renderer::BaseRenderer::CreateBuffers()
 	}
 
 
-	mLightUploadBuffer = std::make_shared<Resource::UploadBuffer>();
-	mLightUploadBuffer->Create(L"LightUploadBuffer", sizeof(ECS::LigthData) * mLights.size());
-
-	float size = 65.0f;
-
-	for (auto& light : mLights)
-	{
-		light.pos.x = ((float(rand()) / RAND_MAX) - 0.5f) * 2.0f;
-		light.pos.y = float(rand()) / RAND_MAX;
-		light.pos.z = ((float(rand()) / RAND_MAX) - 0.5f) * 2.0f;
-
-		light.pos.x *= size;
-		light.pos.y *= 15.0;
-		light.pos.z *= size;
-		light.pos.w = 1.0f;
-
-		light.color.x = float(rand()) / RAND_MAX;
-		light.color.y = float(rand()) / RAND_MAX;
-		light.color.z = float(rand()) / RAND_MAX;
-		light.radius_attenu.x = 55.0f;
-		//light.radius_attenu.y = float(rand()) * 1.2f / RAND_MAX;
-		light.radius_attenu.z = float(rand()) * 1.2f / RAND_MAX;
-		light.radius_attenu.w = float(rand()) * 1.2f / RAND_MAX;
-	}
-
-	//mLights[0].pos = { 0.0, 1.0, 0.0, 1.0f };
-	//mLights[0].radius_attenu = { 20.0, 0.0, 0.0, 1.0f };
-	//mLights[0].color = {1.0f,0.0f,0.0f,1.0f};
-
-	//mLights[1].pos = { -5.0, 0.0, 0.0, 1.0f };
-	//mLights[1].radius_attenu = { 200.0, 0.0, 0.0, 1.0f };
-	//mLights[1].color = { 0.0f,1.0f,0.0f,1.0f };
-	//
-	//mLights[3].pos = { 0.0, 0.0, 5.0, 1.0f };
-	//mLights[3].radius_attenu = { 50.0, 0.0, 0.0, 1.0f };
-	//mLights[3].color = { 1.0f,1.0f,0.0f,1.0f };
-	//
-	//mLights[2].pos = { 5.0, 0.0, 0.0, 1.0f };
-	//mLights[2].radius_attenu = { 10.0, 0.0, 0.0, 1.0f };
-	//mLights[2].color = { 1.0f,1.0f,1.0f,1.0f };
-
-
-	//
-	mLightUploadBuffer->UploadData<ECS::LigthData>(mLights);
-
-	//mDummyBuffer = std::make_unique<Resource::StructuredBuffer>();
-	//mDummyBuffer->Create(L"Dummy", 1, sizeof(uint8_t), nullptr);
-	//mDummyBuffer->CreateSRV();
-
-	//FrameResource Table
-	mLightBuffer = std::make_unique<Resource::StructuredBuffer>();
-	mLightBuffer->Create(L"LightBuffer", (UINT32)mLights.size(), sizeof(ECS::LigthData));
-
+	mLightBuffer = std::make_unique<LightBuffer>();
 }
 
 void Renderer::BaseRenderer::UpdataFrameData()
 {
-	auto frameDataCpuIndex = mFrameIndexCpu % SWAP_CHAIN_BUFFER_COUNT;
+	//The slot of the frame begun last,the pacer made sure its previous user finished.
+	auto frameDataCpuIndex = mDeviceManager->GetFrameSlot();
 
-	auto gridParas = Utils::GetLightGridZParams(mDefaultCamera->GetNear(), mDefaultCamera->GetFar());
+	auto gridParas = Utils::GetLightGridZParams(mDefaultCamera->GetNear(), mDefaultCamera->GetFar(), mClusterGrid.mZ, mClusterGrid.mDistributionScale);
 	mFrameData[frameDataCpuIndex].PrjView = mDefaultCamera->GetPrjView();
 	mFrameData[frameDataCpuIndex].View = mDefaultCamera->GetView();
 	mFrameData[frameDataCpuIndex].Prj = mDefaultCamera->GetPrj();
@@ -196,6 +336,14 @@ void Renderer::BaseRenderer::UpdataFrameData()
 	mFrameData[frameDataCpuIndex].ClipToView = mDefaultCamera->GetClipToView();
 	mFrameData[frameDataCpuIndex].ViewMatrix = mDefaultCamera->GetView();
 	mFrameData[frameDataCpuIndex].InvDeviceZToWorldZTransform = Utils::CreateInvDeviceZToWorldZTransform(mDefaultCamera->GetPrj(false));
+	mFrameData[frameDataCpuIndex].LightCount = mLightBuffer->GetCount();
+	mFrameData[frameDataCpuIndex].LightCullMode = (uint32_t)mLightCullMode;
+	mFrameData[frameDataCpuIndex].ZBinTileCountX = ZBinLightCuller::GetTileCount(mWidth);
+	mFrameData[frameDataCpuIndex].ZBinWordsPerTile = ZBinLightCuller::GetWordsPerTile(mLightBuffer->GetCount());
+	mFrameData[frameDataCpuIndex].ZBinScale = ZBIN_COUNT / mDefaultCamera->GetFar();
+	mFrameData[frameDataCpuIndex].ClusterCountX = mClusterGrid.mX;
+	mFrameData[frameDataCpuIndex].ClusterCountY = mClusterGrid.mY;
+	mFrameData[frameDataCpuIndex].ClusterCountZ = mClusterGrid.mZ;
 	mFrameDataCPU[frameDataCpuIndex]->UpdataData<FrameData>(mFrameData[frameDataCpuIndex]);
 	//Advance CPU Frame Index
 	mFrameIndexCpu++;
@@ -203,18 +351,12 @@ void Renderer::BaseRenderer::UpdataFrameData()
 
 void Renderer::BaseRenderer::PrepairForRendering()
 {
-	mCmdManager->AllocateCmdAndFlush(D3D12_COMMAND_LIST_TYPE_DIRECT, [=](ID3D12GraphicsCommandList* lcmd,ID3D12CommandAllocator* allocator)
-		{
-			TransitState(lcmd, mLightUploadBuffer->GetResource(), D3D12_RESOURCE_STATE_COMMON, D3D12_RESOURCE_STATE_COPY_SOURCE);
-			TransitState(lcmd, mLightBuffer->GetResource(), D3D12_RESOURCE_STATE_COMMON, D3D12_RESOURCE_STATE_COPY_DEST);
-			lcmd->CopyResource(mLightBuffer->GetResource(), mLightUploadBuffer->GetResource());
-			TransitState(lcmd, mLightBuffer->GetResource(), D3D12_RESOURCE_STATE_COPY_DEST, D3D12_RESOURCE_STATE_ALL_SHADER_RESOURCE);
-		});
+	//Lights are uploaded per frame by LightBuffer::RecordUpload.
 }
 
 void Renderer::BaseRenderer::FirstFrame()
 {
-	auto gridParas = Utils::GetLightGridZParams(mDefaultCamera->GetFar(), mDefaultCamera->GetNear());
+	auto gridParas = Utils::GetLightGridZParams(mDefaultCamera->GetFar(), mDefaultCamera->GetNear(), mClusterGrid.mZ, mClusterGrid.mDistributionScale);
 	mFrameData[0].LightGridZParams = SimpleMath::Vector4(gridParas.x, gridParas.y, gridParas.z, 0.0f);
 	mFrameData[0].ClipToView = mDefaultCamera->GetClipToView();
 	mFrameData[0].ViewMatrix = mDefaultCamera->GetView();
@@ -222,11 +364,28 @@ void Renderer::BaseRenderer::FirstFrame()
 
 }
 
-std::shared_ptr<Renderer::Resource::Texture> Renderer::BaseRenderer::LoadMaterial(std::string_view InTextureName, AssetLoader::TextureData* textureData, const std::wstring& InDebugName /*= L""*/)
+std::shared_ptr<Renderer::Resource::Texture> Renderer::BaseRenderer::LoadMaterial(AssetLoader::TextureHandle InTexture, const std::wstring& InDebugName /*= L""*/)
+{
+	if (auto lResident = GetTexture(InTexture))
+	{
+		return lResident;
+	}
+	auto newTexture = UploadTexture(InTexture, AssetLoader::gAssetRegistry->GetTextures().GetName(InTexture), InDebugName);
+	if (newTexture)
+	{
+		std::lock_guard lock(mTextureMutex);
+		mSceneGpuTextures.insert(InTexture.mIndex);
+	}
+	return newTexture;
+}
+
+std::shared_ptr<Renderer::Resource::Texture> Renderer::BaseRenderer::UploadTexture(AssetLoader::TextureHandle InTexture, const std::string& InName, const std::wstring& InDebugName)
 {
-	if (mTextureMap.find(InTextureName.data()) != mTextureMap.end())
+	auto& textures = AssetLoader::gAssetRegistry->GetTextures();
+	auto textureData = textures.Get(InTexture);
+	if (!textureData || !textures.AddRef(InTexture, AssetLoader::Residency::GPU))
 	{
-		return mTextureMap[InTextureName.data()];
+		return nullptr;
 	}
 	std::shared_ptr<Resource::Texture> newTexture = std::make_shared<Resource::Texture>();
 
@@ -251,13 +410,12 @@ std::shared_ptr<Renderer::Resource::Texture> Renderer::BaseRenderer::LoadMateria
 	}
 
 	newTexture->GetResource()->SetName(InDebugName.c_str());
-	if (!InTextureName.empty())
-	{
-		mTextureMap[std::string(InTextureName)] = newTexture;
-	}
-	else
+	std::lock_guard lock(mTextureMutex);
+	if (mGpuTextures.size() <= InTexture.mIndex)
 	{
-		mTextureMap[std::filesystem::path(InTextureName).filename().string()] = newTexture;
+		mGpuTextures.resize(InTexture.mIndex + 1);
 	}
+	mGpuTextures[InTexture.mIndex] = { InTexture.mGeneration, newTexture };
+	mTextureMap[InName] = newTexture;
 	return newTexture;
 }
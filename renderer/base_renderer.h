@@ -1,7 +1,19 @@
 #pragma once
 #include "camera.h"
 #include "game_scene.h"
-#include <asset_loader.h>
+#include <asset_registry.h>
+#include "occlusion_culling.h"
+#include "shadow_culling.h"
+#include "draw_packet.h"
+#include "gpu_cull.h"
+#include "meshlet_cull.h"
+#include "light_buffer.h"
+#include "cluster_light_cull.h"
+#include "zbin_light_cull.h"
+#include "cluster_grid_tuner.h"
+#include "render_graph.h"
+#include "frame_timeline.h"
+#include <unordered_set>
 
 namespace Renderer
 {
@@ -22,13 +34,19 @@ namespace Renderer
 		
 		std::shared_ptr<Resource::Texture> LoadMaterial(std::string_view InTextureName, std::string_view InMatName = {}, const std::wstring& InDebugName = L"");
 		
-		std::shared_ptr<Resource::Texture> LoadMaterial(std::string_view InTextureName, AssetLoader::TextureData* textureData, const std::wstring& InDebugName = L"");
+		//Upload a registry texture once,the renderer holds a GPU reference until the owning scene unloads.
+		std::shared_ptr<Resource::Texture> LoadMaterial(AssetLoader::TextureHandle InTexture, const std::wstring& InDebugName = L"");
+
+		//Null when the texture is not resident or the handle is stale.
+		std::shared_ptr<Resource::Texture> GetTexture(AssetLoader::TextureHandle InTexture);
 
 		std::unordered_map<std::string, std::shared_ptr<Resource::Texture>>& GetSceneTextureMap();
+		const LightUploadStats& GetLightUploadStats() const;
 
 
 		//Todo: Remove this temp code for mesh shader
-		virtual void MeshShaderNewStaticmeshComponent(ECS::StaticMeshComponent& InStaticMeshComponent) {};
+		virtual void MeshShaderNewStaticmeshComponent(ECS::StaticMeshComponent& InStaticMeshComponent, ECS::StaticMeshAsset& InAsset) {};
+		virtual void MeshShaderReleaseStaticmeshComponent(ECS::StaticMeshComponent& InStaticMeshComponent, uint64_t InReleaseAfter) {};
 
 	public:
 		//Tone Mapping Settings
@@ -45,12 +63,85 @@ namespace Renderer
 		float mbloomBaseSaturation = 1.0f;
 		std::array<float, 3> mSunLightDir = { 1.0,1.0,1.0 };
 		float mSunLightIntensity = 1.0;
+
+		//Occlusion Culling Settings
+		bool mUseOcclusionCulling = true;
+		int mMaxOccluders = 32;
+		OcclusionCullStats mOcclusionCullStats;
+
+		//Shadow Settings
+		bool mUseShadowCasterCulling = true;
+		ShadowCullStats mShadowCullStats;
+
+		DrawPacketStats mDrawPacketStats;
+		//Split large draw passes over worker command lists.
+		bool mUseParallelRecording = true;
+		//Set by the GUI,the renderer runs the benchmark before its next frame and clears it.
+		bool mRunDrawRecordBenchmark = false;
+		//Set by the GUI,the renderer compacts the shared vertex and index buffers before its next frame and clears it.
+		bool mRunGeometryDefragment = false;
+
+		//GPU Driven Drawing Settings
+		//Cull a persistent instance buffer in compute and draw the survivors through ExecuteIndirect instead of recording packets.
+		bool mUseGpuDrivenDrawing = false;
+		//Diff the GPU culled draws of every pass against GpuCullReference once their frame slot comes around again.
+		bool mValidateGpuCulling = false;
+		GpuCullStats mGpuCullStats;
+
+		//Meshlet Culling Settings,read by the mesh shader renderer
+		bool mUseMeshletFrustumCulling = true;
+		//Drop meshlets whose normal cone faces away from the camera.
+		bool mUseMeshletConeCulling = true;
+		bool mUseMeshletSizeCulling = true;
+		//Bounding sphere diameter in pixels below which a meshlet is dropped.
+		float mMeshletMinPixels = 1.0f;
+		//Count the survivors of every frame with MeshletCullReference and diff them against the GPU once the frame slot comes around again.
+		bool mValidateMeshletCulling = false;
+		MeshletCullStats mMeshletCullStats;
+
+		//Light Culling Settings
+		//Bin lights on the CPU and upload the masks instead of running the compute pass.
+		bool mUseCpuLightCulling = false;
+		//Read the GPU masks back and diff them against the CPU reference every frame.
+		bool mValidateLightCulling = false;
+		ClusterCullStats mClusterCullStats;
+		//Cull only the clusters holding a depth prepass sample.
+		bool mUseActiveClusters = true;
+		ActiveClusterStats mActiveClusterStats;
+		ClusterGrid mClusterGrid;
+		//Let the renderer pick mClusterGrid every few frames.
+		bool mAutoTuneClusterGrid = false;
+		//Cost model estimate for mClusterGrid,filled by the tuner.
+		ClusterGridEstimate mClusterGridEstimate;
+		LightCullMode mLightCullMode = LightCullMode::CLUSTERS;
+		ZBinCullStats mZBinCullStats;
+		//Set by the GUI,the renderer runs the benchmark before its next frame and clears it.
+		bool mRunLightCullBenchmark = false;
+		//Post processing graph of the last frame.
+		RenderGraphStats mRenderGraphStats;
+		//Frames the CPU may record ahead of the GPU,applied at the start of the next frame.
+		int mFramesInFlight = FramePacer::DEFAULT_FRAMES_IN_FLIGHT;
+		FramePacerStats mFramePacerStats;
 		virtual void CreateBuffers();
 		virtual void UpdataFrameData();
 		virtual void PrepairForRendering();
 		virtual void FirstFrame();
 		virtual std::shared_ptr<class RendererContext> GetContext() { return nullptr; };
 	protected:
+		std::shared_ptr<Resource::Texture> UploadTexture(AssetLoader::TextureHandle InTexture, const std::string& InName, const std::wstring& InDebugName);
+		void ReleaseSceneGpuAssets(std::shared_ptr<GAS::GameScene> InScene);
+		void ReleaseEntityGpuAssets(std::shared_ptr<GAS::GameScene> InScene, std::span<const entt::entity> InEntities);
+		void OnTextureGpuReleased(AssetLoader::TextureHandle InTexture, const std::string& InName);
+		//Wait for a free frame slot and release what the finished frames retired,call before UpdataFrameData.
+		void BeginFrame();
+		//Free textures and geometry no frame in flight can read anymore.
+		virtual void ReleaseRetiredResources();
+		//Move up to MAX_GEOMETRY_MOVES meshes per buffer into lower holes and remap their components.
+		void DefragmentGeometry();
+
+		//Bounds the copies and the wait of one defragment step.
+		static constexpr uint32_t MAX_GEOMETRY_MOVES = 256;
+
 		int mWidth;
 		int mHeight;
 		HWND mWindow;
@@ -61,18 +152,32 @@ namespace Renderer
 		D3D12_RECT mRect;
 		std::shared_ptr<class CmdManager> mCmdManager;
 		std::unique_ptr<DirectX::ResourceUploadBatch> mBatchUploader;
-		uint64_t mGraphicsFenceValue;
 		std::shared_ptr<GAS::GameScene> mCurrentScene;
 		std::future<void> mLoadResourceFuture;
 		std::unordered_map<std::string, std::shared_ptr<Resource::Texture>> mTextureMap;
+		struct GpuTexture
+		{
+			uint32_t mGeneration = 0;
+			std::shared_ptr<Resource::Texture> mTexture;
+		};
+		//Indexed by TextureHandle::mIndex,each resident entry holds one GPU reference in the registry.
+		std::vector<GpuTexture> mGpuTextures;
+		//Slots uploaded for a scene,released when that scene unloads.
+		std::unordered_set<uint32_t> mSceneGpuTextures;
+		struct RetiredTexture
+		{
+			uint64_t mReleaseAfter;
+			std::shared_ptr<Resource::Texture> mTexture;
+		};
+		std::vector<RetiredTexture> mRetiredTextures;
+		uint64_t mRetireFrame = 0;
+		std::mutex mTextureMutex;
 		std::shared_ptr<class Gui> mGui;
 		std::array<FrameData, SWAP_CHAIN_BUFFER_COUNT> mFrameData;
 		std::array<std::shared_ptr<Resource::UploadBuffer>, SWAP_CHAIN_BUFFER_COUNT> mFrameDataCPU;
 		std::array<std::unique_ptr<Resource::VertexBuffer>, SWAP_CHAIN_BUFFER_COUNT> mFrameDataGPU;
-		std::unique_ptr<Resource::StructuredBuffer> mLightBuffer;
-		std::shared_ptr<Resource::UploadBuffer> mLightUploadBuffer;
+		std::unique_ptr<LightBuffer> mLightBuffer;
 		int mFrameIndexCpu = 0;
-		std::array<ECS::LigthData, 256> mLights;
 		std::mutex mLoadResourceMutex;
 	};
 }
\ No newline at end of file
@@ -0,0 +1,197 @@
+#include "cluster_grid_tuner.h"
+
+using namespace DirectX;
+
+namespace
+{
+	//Relative weights,one unit is one light against cluster test.Shading a light costs far more ALU than testing it.
+	constexpr float SHADE_COST = 4.0f;
+	//CountLights and WriteLightIndices both test every light.
+	constexpr float TEST_COST = 2.0f;
+	//One group per cluster in both passes plus the scan.
+	constexpr float CLUSTER_COST = 64.0f;
+
+	constexpr uint32_t TILE_SIZES[] = { 32, 48, 64, 96, 128 };
+	constexpr uint32_t SLICE_COUNTS[] = { 8, 16, 24, 32, 48, 64 };
+	constexpr float DISTRIBUTION_SCALES[] = { 2.0f, 3.0f, 4.05f, 6.0f };
+
+	//Tiles of an NDC range on one axis,the y flip does not change the count.
+	uint32_t TileSpan(float InMin, float InMax, uint32_t InTiles)
+	{
+		auto lTile = [InTiles](float InNdc)
+			{
+				float lTile = std::floor((InNdc + 1.0f) * 0.5f * InTiles);
+				return (uint32_t)std::clamp(lTile, 0.0f, float(InTiles - 1));
+			};
+		return lTile(InMax) - lTile(InMin) + 1;
+	}
+}
+
+Renderer::ClusterGridTuneInput Renderer::ClusterGridTuneInput::Capture(const FrameData& InFrame, std::span<const ECS::LigthData> InLights,
+	std::span<const float> InDeviceDepth, uint32_t InWidth, uint32_t InHeight, float InNear, float InFar)
+{
+	ClusterGridTuneInput lInput;
+	lInput.mWidth = InWidth;
+	lInput.mHeight = InHeight;
+	lInput.mNear = InNear;
+	lInput.mFar = InFar;
+	lInput.mLightCount = std::min(InFrame.LightCount, (uint32_t)InLights.size());
+
+	const float lScaleX = InFrame.Prj._11;
+	const float lScaleY = InFrame.Prj._22;
+	for (uint32_t i = 0; i < lInput.mLightCount; ++i)
+	{
+		//Bounding sphere,spot and capsule footprints are approximated by it.
+		const auto& lBounds = InLights[i].bounds;
+		XMFLOAT4 lViewPos = Utils::ShaderMul(XMFLOAT4(lBounds.x, lBounds.y, lBounds.z, 1.0f), InFrame.ViewMatrix);
+		float lRadius = lBounds.w;
+		if (lViewPos.z + lRadius < InNear)
+		{
+			continue;
+		}
+		Light lLight = { lViewPos.z - lRadius, lViewPos.z + lRadius, -1.0f, -1.0f, 1.0f, 1.0f };
+		//Spheres reaching the near plane may cover any part of the screen.
+		if (lLight.mMinDepth > InNear)
+		{
+			//Extent at the nearest depth bounds the sphere's projection.
+			float lCenterX = lViewPos.x * lScaleX / lViewPos.z;
+			float lCenterY = lViewPos.y * lScaleY / lViewPos.z;
+			float lExtentX = lRadius * lScaleX / lLight.mMinDepth;
+			float lExtentY = lRadius * lScaleY / lLight.mMinDepth;
+			if (lCenterX + lExtentX < -1.0f || lCenterX - lExtentX > 1.0f || lCenterY + lExtentY < -1.0f || lCenterY - lExtentY > 1.0f)
+			{
+				continue;
+			}
+			lLight.mMinX = std::max(lCenterX - lExtentX, -1.0f);
+			lLight.mMaxX = std::min(lCenterX + lExtentX, 1.0f);
+			lLight.mMinY = std::max(lCenterY - lExtentY, -1.0f);
+			lLight.mMaxY = std::min(lCenterY + lExtentY, 1.0f);
+		}
+		lInput.mLights.push_back(lLight);
+	}
+
+	//ConvertFromDeviceZ in ForwardPS.hlsl.
+	const auto& lToView = InFrame.InvDeviceZToWorldZTransform;
+	const float lLogRange = std::log2(InFar / InNear);
+	uint32_t lCovered = 0;
+	for (float deviceZ : InDeviceDepth)
+	{
+		if (deviceZ <= 0.0f)
+		{
+			continue;
+		}
+		float lDepth = deviceZ * lToView.x + lToView.y + 1.0f / (deviceZ * lToView.z - lToView.w);
+		float lBin = std::log2(std::max(lDepth, InNear) / InNear) / lLogRange * DEPTH_BINS;
+		lInput.mDepthHistogram[(uint32_t)std::clamp(lBin, 0.0f, float(DEPTH_BINS - 1))] += 1.0f;
+		lCovered++;
+	}
+	if (lCovered == 0)
+	{
+		//Nothing rasterized,e.g. occlusion culling is off.Assume the whole depth range is covered.
+		lInput.mDepthHistogram.fill(1.0f / DEPTH_BINS);
+		lInput.mCoverage = 1.0f;
+	}
+	else
+	{
+		for (auto& bin : lInput.mDepthHistogram)
+		{
+			bin /= lCovered;
+		}
+		lInput.mCoverage = float(lCovered) / InDeviceDepth.size();
+	}
+	return lInput;
+}
+
+float Renderer::ClusterGridTuneInput::GetBinDepth(uint32_t InBin) const
+{
+	return mNear * std::exp2((InBin + 0.5f) / DEPTH_BINS * std::log2(mFar / mNear));
+}
+
+Renderer::ClusterGridEstimate Renderer::ClusterGridTuner::Evaluate(const ClusterGridTuneInput& InInput, const ClusterGrid& InGrid)
+{
+	const auto lParams = Utils::GetLightGridZParams(InInput.mNear, InInput.mFar, InGrid.mZ, InGrid.mDistributionScale);
+	//ComputeLightGridCellCoordinate in ForwardPS.hlsl.
+	auto lSlice = [&lParams, &InGrid](float InDepth)
+		{
+			float lLinear = InDepth * lParams.x + lParams.y;
+			float lSlice = lLinear > 1.0f ? std::log2(lLinear) * lParams.z : 0.0f;
+			return (uint32_t)std::min(lSlice, float(InGrid.mZ - 1));
+		};
+
+	std::vector<float> lSlicePixels(InGrid.mZ, 0.0f);
+	for (uint32_t b = 0; b < ClusterGridTuneInput::DEPTH_BINS; ++b)
+	{
+		lSlicePixels[lSlice(InInput.GetBinDepth(b))] += InInput.mDepthHistogram[b];
+	}
+	//Average lights per cluster of each slice.
+	std::vector<float> lSliceLights(InGrid.mZ, 0.0f);
+	const float lInvTiles = 1.0f / float(InGrid.mX * InGrid.mY);
+	ClusterGridEstimate lEstimate;
+	for (const auto& light : InInput.mLights)
+	{
+		uint32_t lTiles = TileSpan(light.mMinX, light.mMaxX, InGrid.mX) * TileSpan(light.mMinY, light.mMaxY, InGrid.mY);
+		uint32_t lFirst = lSlice(std::max(light.mMinDepth, 0.0f));
+		uint32_t lLast = lSlice(light.mMaxDepth);
+		for (uint32_t s = lFirst; s <= lLast; ++s)
+		{
+			lSliceLights[s] += lTiles * lInvTiles;
+		}
+		lEstimate.mAssignments += uint64_t(lLast - lFirst + 1) * lTiles;
+	}
+
+	uint32_t lOccupiedSlices = 0;
+	float lOccupiedLights = 0.0f;
+	for (uint32_t s = 0; s < InGrid.mZ; ++s)
+	{
+		lEstimate.mLightsPerPixel += lSlicePixels[s] * lSliceLights[s];
+		if (lSlicePixels[s] > 0.0f)
+		{
+			lOccupiedSlices++;
+			lOccupiedLights += lSliceLights[s];
+		}
+	}
+	lEstimate.mOccupiedClusters = lOccupiedSlices * InGrid.mX * InGrid.mY;
+	lEstimate.mLightsPerOccupiedCluster = lOccupiedSlices ? lOccupiedLights / lOccupiedSlices : 0.0f;
+
+	const float lPixels = float(InInput.mWidth) * InInput.mHeight * InInput.mCoverage;
+	const float lClusters = float(InGrid.GetCount());
+	lEstimate.mCost = SHADE_COST * lPixels * lEstimate.mLightsPerPixel + TEST_COST * lClusters * InInput.mLightCount + CLUSTER_COST * lClusters;
+	if (lEstimate.mAssignments > (uint64_t)MAX_CLUSTER_LIGHT_INDICES)
+	{
+		//Lights would be dropped.
+		lEstimate.mCost = FLT_MAX;
+	}
+	return lEstimate;
+}
+
+Renderer::ClusterGrid Renderer::ClusterGridTuner::Tune(const ClusterGridTuneInput& InInput, const ClusterGrid& InCurrent)
+{
+	mCurrentEstimate = Evaluate(InInput, InCurrent);
+	mBestGrid = InCurrent;
+	mBestEstimate = mCurrentEstimate;
+	for (auto tileSize : TILE_SIZES)
+	{
+		ClusterGrid lGrid;
+		lGrid.mX = std::clamp((InInput.mWidth + tileSize - 1) / tileSize, 1u, (uint32_t)MAX_CLUSTER_X);
+		lGrid.mY = std::clamp((InInput.mHeight + tileSize - 1) / tileSize, 1u, (uint32_t)MAX_CLUSTER_Y);
+		for (auto slices : SLICE_COUNTS)
+		{
+			lGrid.mZ = slices;
+			for (auto scale : DISTRIBUTION_SCALES)
+			{
+				lGrid.mDistributionScale = scale;
+				auto lEstimate = Evaluate(InInput, lGrid);
+				if (lEstimate.mCost < mBestEstimate.mCost)
+				{
+					mBestEstimate = lEstimate;
+					mBestGrid = lGrid;
+				}
+			}
+		}
+	}
+	if (mBestEstimate.mCost < mCurrentEstimate.mCost * (1.0f - HYSTERESIS))
+	{
+		return mBestGrid;
+	}
+	return InCurrent;
+}
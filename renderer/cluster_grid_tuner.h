@@ -0,0 +1,83 @@
+#pragma once
+#include "renderer_common.h"
+
+namespace Renderer
+{
+	//Cost model output for one grid.
+	struct ClusterGridEstimate
+	{
+		//Relative cost,see ClusterGridTuner::Evaluate.
+		float mCost = 0.0f;
+		//Lights a shaded pixel loops over,averaged over the covered pixels.
+		float mLightsPerPixel = 0.0f;
+		float mLightsPerOccupiedCluster = 0.0f;
+		uint32_t mOccupiedClusters = 0;
+		//Light and cluster overlaps,grids past MAX_CLUSTER_LIGHT_INDICES are rejected.
+		uint64_t mAssignments = 0;
+	};
+
+	//Everything the cost model reads,captured from one frame.
+	//It holds no GPU state,so a recorded capture can be evaluated offline against any grid.
+	struct ClusterGridTuneInput
+	{
+		static constexpr uint32_t DEPTH_BINS = 64;
+
+		//Screen footprint and depth range of a light,NDC x and y.
+		struct Light
+		{
+			float mMinDepth;
+			float mMaxDepth;
+			float mMinX;
+			float mMinY;
+			float mMaxX;
+			float mMaxY;
+		};
+
+		uint32_t mWidth = 0;
+		uint32_t mHeight = 0;
+		float mNear = 0.0f;
+		float mFar = 0.0f;
+		//Every light is tested against every cluster,including the ones off screen.
+		uint32_t mLightCount = 0;
+		//On screen lights only.
+		std::vector<Light> mLights;
+		//Fraction of the covered pixels per bin,bins are spaced logarithmically from mNear to mFar.
+		std::array<float, DEPTH_BINS> mDepthHistogram = {};
+		//Fraction of the screen covered by geometry,the rest is sky and shades no lights.
+		float mCoverage = 1.0f;
+
+		//InDeviceDepth is a reversed Z depth buffer of any resolution,cleared pixels count as sky.
+		//InFrame is the GPU copy,matrices are transposed exactly as the shaders read them.
+		static ClusterGridTuneInput Capture(const FrameData& InFrame, std::span<const ECS::LigthData> InLights,
+			std::span<const float> InDeviceDepth, uint32_t InWidth, uint32_t InHeight, float InNear, float InFar);
+
+		float GetBinDepth(uint32_t InBin) const;
+	};
+
+	//Picks the cluster grid and slice distribution from resolution,lights and the depth histogram.
+	//Cost = shading (pixels * lights per pixel) + culling (clusters * lights for the count and write passes) + per cluster overhead.
+	//Finer grids shrink the first term and grow the others,the cheapest candidate wins.
+	class ClusterGridTuner
+	{
+	public:
+		//A new grid must beat the current one by this fraction,so the grid does not flicker between near equal candidates.
+		static constexpr float HYSTERESIS = 0.1f;
+
+		//Pure function of the capture,the estimate for the current grid is also what the tuner compares against.
+		static ClusterGridEstimate Evaluate(const ClusterGridTuneInput& InInput, const ClusterGrid& InGrid);
+
+		//Best candidate,or InCurrent when nothing beats it by HYSTERESIS.
+		ClusterGrid Tune(const ClusterGridTuneInput& InInput, const ClusterGrid& InCurrent);
+
+		const ClusterGridEstimate& GetCurrentEstimate() const { return mCurrentEstimate; }
+
+		const ClusterGridEstimate& GetBestEstimate() const { return mBestEstimate; }
+
+		const ClusterGrid& GetBestGrid() const { return mBestGrid; }
+
+	private:
+		ClusterGridEstimate mCurrentEstimate;
+		ClusterGridEstimate mBestEstimate;
+		ClusterGrid mBestGrid;
+	};
+}
@@ -0,0 +1,503 @@
+#include "cluster_light_cull.h"
+
+using namespace DirectX;
+
+namespace
+{
+	float ComputeCellNearViewDepthFromZSlice(const Renderer::FrameData& InFrame, uint32_t InZSlice)
+	{
+		const auto& lParams = InFrame.LightGridZParams;
+		float lSliceDepth = (exp2f(float(InZSlice) / lParams.z) - lParams.y) / lParams.x;
+		if (InZSlice == InFrame.ClusterCountZ)
+		{
+			lSliceDepth = 2000000.0f;
+		}
+		if (InZSlice == 0)
+		{
+			lSliceDepth = 0.0f;
+		}
+		return lSliceDepth;
+	}
+
+	float ConvertToDeviceZ(const Renderer::FrameData& InFrame, float InSceneDepth)
+	{
+		return 1.0f / ((InSceneDepth + InFrame.InvDeviceZToWorldZTransform.w) * InFrame.InvDeviceZToWorldZTransform.z);
+	}
+
+	float ConvertFromDeviceZ(const Renderer::FrameData& InFrame, float InDeviceZ)
+	{
+		const auto& lToView = InFrame.InvDeviceZToWorldZTransform;
+		return InDeviceZ * lToView.x + lToView.y + 1.0f / (InDeviceZ * lToView.z - lToView.w);
+	}
+
+	float ComputeZSlice(const Renderer::FrameData& InFrame, float InSceneDepth)
+	{
+		const auto& lParams = InFrame.LightGridZParams;
+		return std::max(0.0f, std::log2(InSceneDepth * lParams.x + lParams.y) * lParams.z);
+	}
+
+	//SLICE_EPSILON in LightCull.hlsl.
+	constexpr float SLICE_EPSILON = 0.01f;
+
+	float Dot(const XMFLOAT3& InA, const XMFLOAT3& InB)
+	{
+		return InA.x * InB.x + InA.y * InB.y + InA.z * InB.z;
+	}
+
+	//Port of SpotIntersectsSphere.
+	bool SpotIntersectsSphere(const XMFLOAT3& InOrigin, const XMFLOAT3& InAxis, float InRange, float InCosOuter, float InSinOuter, const XMFLOAT3& InSphereCenter, float InSphereRadius)
+	{
+		const XMFLOAT3 lV = { InSphereCenter.x - InOrigin.x, InSphereCenter.y - InOrigin.y, InSphereCenter.z - InOrigin.z };
+		const float lVLenSq = Dot(lV, lV);
+		const float lV1Len = Dot(lV, InAxis);
+		const float lDistanceClosestPoint = InCosOuter * std::sqrt(std::max(lVLenSq - lV1Len * lV1Len, 0.0f)) - lV1Len * InSinOuter;
+		const bool lAngleCull = lDistanceClosestPoint > InSphereRadius;
+		const bool lFrontCull = lV1Len > InSphereRadius + InRange;
+		const bool lBackCull = lV1Len < -InSphereRadius;
+		return !(lAngleCull || lFrontCull || lBackCull);
+	}
+
+	//Port of SegmentIntersectsBox.
+	bool SegmentIntersectsBox(const XMFLOAT3& InStart, const XMFLOAT3& InEnd, const XMFLOAT3& InBoxMin, const XMFLOAT3& InBoxMax)
+	{
+		const float lStart[3] = { InStart.x, InStart.y, InStart.z };
+		const float lDirection[3] = { InEnd.x - InStart.x, InEnd.y - InStart.y, InEnd.z - InStart.z };
+		const float lBoxMin[3] = { InBoxMin.x, InBoxMin.y, InBoxMin.z };
+		const float lBoxMax[3] = { InBoxMax.x, InBoxMax.y, InBoxMax.z };
+		float lTMin = 0.0f;
+		float lTMax = 1.0f;
+		for (int axis = 0; axis < 3; ++axis)
+		{
+			if (std::abs(lDirection[axis]) < 1e-6f)
+			{
+				if (lStart[axis] < lBoxMin[axis] || lStart[axis] > lBoxMax[axis])
+				{
+					return false;
+				}
+			}
+			else
+			{
+				const float lInvDirection = 1.0f / lDirection[axis];
+				const float lT0 = (lBoxMin[axis] - lStart[axis]) * lInvDirection;
+				const float lT1 = (lBoxMax[axis] - lStart[axis]) * lInvDirection;
+				lTMin = std::max(lTMin, std::min(lT0, lT1));
+				lTMax = std::min(lTMax, std::max(lT0, lT1));
+			}
+		}
+		return lTMin <= lTMax;
+	}
+}
+
+Renderer::ClusterLightCuller::ClusterLightCuller(tf::Executor& InExecutor) :
+	mExecutor(InExecutor),
+	mFrame{}
+{
+
+}
+
+Renderer::ClusterLightCuller::~ClusterLightCuller()
+{
+
+}
+
+void Renderer::ClusterLightCuller::Cull(const FrameData& InFrame, std::span<const ECS::LigthData> InLights, bool InActiveOnly)
+{
+	auto lStart = std::chrono::steady_clock::now();
+	mFrame = InFrame;
+	mStats = {};
+	const uint32_t lClusterCount = InFrame.ClusterCountX * InFrame.ClusterCountY * InFrame.ClusterCountZ;
+	const uint32_t lRows = InFrame.ClusterCountY * InFrame.ClusterCountZ;
+	Expects(lClusterCount > 0 && lClusterCount <= MAX_CLUSTER_COUNT);
+	mClusters.resize(lClusterCount);
+	if (!InActiveOnly)
+	{
+		mActiveFlags.assign(lClusterCount, 1);
+	}
+	Expects(mActiveFlags.size() == lClusterCount);
+	mActiveClusters.clear();
+	for (uint32_t i = 0; i < lClusterCount; ++i)
+	{
+		if (mActiveFlags[i])
+		{
+			mActiveClusters.push_back(i);
+		}
+	}
+	mClusterCounts.resize(lClusterCount);
+	mRowStarts.resize(lClusterCount);
+	mRowLights.resize(lRows);
+	if (!mFlow || mFlowRows != lRows)
+	{
+		mFlow = std::make_unique<tf::Taskflow>("ClusterLightCull");
+		auto lBin = mFlow->for_each_index(0u, lRows, 1u, [this](uint32_t InRow) { BinRow(InRow); });
+		auto lCompact = mFlow->emplace([this]() { CompactOffsets(); });
+		auto lWrite = mFlow->for_each_index(0u, lRows, 1u, [this](uint32_t InRow) { WriteRow(InRow); });
+		lBin.precede(lCompact);
+		lCompact.precede(lWrite);
+		mFlowRows = lRows;
+	}
+	uint32_t lCount = std::min(InFrame.LightCount, (uint32_t)InLights.size());
+	uint32_t lPadded = (lCount + 3) & ~3u;
+	mLightX.assign(lPadded, 0.0f);
+	mLightY.assign(lPadded, 0.0f);
+	mLightZ.assign(lPadded, 0.0f);
+	//Padding never passes the distance < radius^2 test.
+	mLightRadiusSq.assign(lPadded, -1.0f);
+	mViewLights.resize(lCount);
+	//The shader transforms the light in every group,the result is the same so it is done once here.
+	for (uint32_t i = 0; i < lCount; ++i)
+	{
+		const auto& lLight = InLights[i];
+		XMFLOAT4 lViewCenter = Utils::ShaderMul(XMFLOAT4(lLight.bounds.x, lLight.bounds.y, lLight.bounds.z, 1.0f), InFrame.ViewMatrix);
+		float lRadius = lLight.bounds.w;
+		mLightX[i] = lViewCenter.x;
+		mLightY[i] = lViewCenter.y;
+		mLightZ[i] = lViewCenter.z;
+		mLightRadiusSq[i] = lRadius * lRadius;
+
+		XMFLOAT4 lViewPos = Utils::ShaderMul(lLight.pos, InFrame.ViewMatrix);
+		XMFLOAT4 lViewAxis = Utils::ShaderMul(XMFLOAT4(lLight.direction.x, lLight.direction.y, lLight.direction.z, 0.0f), InFrame.ViewMatrix);
+		mViewLights[i] = { { lViewPos.x, lViewPos.y, lViewPos.z }, { lViewAxis.x, lViewAxis.y, lViewAxis.z }, lLight.radius_attenu.x, lLight.type, lLight.shape };
+	}
+	//The renderer calls this from a task of the same executor,a blocking wait there could starve the pool.
+	if (mExecutor.this_worker_id() >= 0)
+	{
+		mExecutor.corun(*mFlow);
+	}
+	else
+	{
+		mExecutor.run(*mFlow).wait();
+	}
+
+	mStats.mLights = lCount;
+	mStats.mClusters = lClusterCount;
+	mStats.mActiveClusters = (uint32_t)mActiveClusters.size();
+	mStats.mAssignments = (uint32_t)mLightIndices.size();
+	for (const auto& cluster : mClusters)
+	{
+		mStats.mEmptyClusters += cluster.count == 0;
+		mStats.mMaxClusterLights = std::max(mStats.mMaxClusterLights, cluster.count);
+	}
+	mStats.mListBytes = uint32_t(mClusters.size() * sizeof(Cluster) + mLightIndices.size() * sizeof(uint32_t));
+	mStats.mMaskBytes = lClusterCount * ((lCount + 31) / 32) * (uint32_t)sizeof(uint32_t);
+	mStats.mCullMs = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - lStart).count();
+}
+
+void Renderer::ClusterLightCuller::ComputeCellViewAABB(const FrameData& InFrame, uint32_t InX, uint32_t InY, uint32_t InZ, XMFLOAT3& OutViewTileMin, XMFLOAT3& OutViewTileMax)
+{
+	const auto& lViewSize = InFrame.ViewSizeAndInvSize;
+	const float lGridPixelSizeX = lViewSize.x / InFrame.ClusterCountX;
+	const float lGridPixelSizeY = lViewSize.y / InFrame.ClusterCountY;
+	const float lInvCulledGridSizeX = lGridPixelSizeX * lViewSize.z;
+	const float lInvCulledGridSizeY = lGridPixelSizeY * lViewSize.w;
+	const float lTileSizeX = 2.0f * lInvCulledGridSizeX;
+	const float lTileSizeY = -2.0f * lInvCulledGridSizeY;
+
+	const float lUnitPlaneTileMinX = float(InX) * lTileSizeX + -1.0f;
+	const float lUnitPlaneTileMinY = float(InY) * lTileSizeY + 1.0f;
+	const float lUnitPlaneTileMaxX = float(InX + 1) * lTileSizeX + -1.0f;
+	const float lUnitPlaneTileMaxY = float(InY + 1) * lTileSizeY + 1.0f;
+
+	const float lMinTileZ = ComputeCellNearViewDepthFromZSlice(InFrame, InZ);
+	const float lMaxTileZ = ComputeCellNearViewDepthFromZSlice(InFrame, InZ + 1);
+
+	//Same corner order as the shader,min and max are order independent but the corners are not.
+	const float lDeviceZ[2] = { ConvertToDeviceZ(InFrame, lMinTileZ), ConvertToDeviceZ(InFrame, lMaxTileZ) };
+	XMFLOAT2 lCorners[8];
+	for (int d = 0; d < 2; ++d)
+	{
+		const XMFLOAT4 lClip[4] =
+		{
+			{ lUnitPlaneTileMinX, lUnitPlaneTileMinY, lDeviceZ[d], 1.0f },
+			{ lUnitPlaneTileMaxX, lUnitPlaneTileMaxY, lDeviceZ[d], 1.0f },
+			{ lUnitPlaneTileMinX, lUnitPlaneTileMaxY, lDeviceZ[d], 1.0f },
+			{ lUnitPlaneTileMaxX, lUnitPlaneTileMinY, lDeviceZ[d], 1.0f },
+		};
+		for (int c = 0; c < 4; ++c)
+		{
+			XMFLOAT4 lView = Utils::ShaderMul(lClip[c], InFrame.ClipToView);
+			lCorners[d * 4 + c] = { lView.x / lView.w, lView.y / lView.w };
+		}
+	}
+
+	OutViewTileMin = { std::min(lCorners[0].x, lCorners[1].x), std::min(lCorners[0].y, lCorners[1].y), lMinTileZ };
+	OutViewTileMax = { std::max(lCorners[0].x, lCorners[1].x), std::max(lCorners[0].y, lCorners[1].y), lMaxTileZ };
+	for (int c = 2; c < 8; ++c)
+	{
+		OutViewTileMin.x = std::min(OutViewTileMin.x, lCorners[c].x);
+		OutViewTileMin.y = std::min(OutViewTileMin.y, lCorners[c].y);
+		OutViewTileMax.x = std::max(OutViewTileMax.x, lCorners[c].x);
+		OutViewTileMax.y = std::max(OutViewTileMax.y, lCorners[c].y);
+	}
+}
+
+uint32_t Renderer::ClusterLightCuller::Compare(std::span<const Cluster> InGpuClusters, std::span<const uint32_t> InGpuLightIndices)
+{
+	Expects(InGpuClusters.size() >= mClusters.size());
+	mStats.mMismatchedClusters = 0;
+	mStats.mMismatchedLights = 0;
+	for (size_t i = 0; i < mClusters.size(); ++i)
+	{
+		const auto& lCpu = mClusters[i];
+		const auto& lGpu = InGpuClusters[i];
+		if (lGpu.offset + lGpu.count > InGpuLightIndices.size())
+		{
+			mStats.mMismatchedClusters++;
+			mStats.mMismatchedLights += std::max(lCpu.count, lGpu.count);
+			continue;
+		}
+		//Both lists are ascending,count the lights present on only one side.
+		auto lCpuLights = std::span(mLightIndices).subspan(lCpu.offset, lCpu.count);
+		auto lGpuLights = InGpuLightIndices.subspan(lGpu.offset, lGpu.count);
+		uint32_t lDifferent = 0;
+		size_t a = 0, b = 0;
+		while (a < lCpuLights.size() && b < lGpuLights.size())
+		{
+			if (lCpuLights[a] == lGpuLights[b])
+			{
+				a++;
+				b++;
+			}
+			else
+			{
+				lDifferent++;
+				lCpuLights[a] < lGpuLights[b] ? a++ : b++;
+			}
+		}
+		lDifferent += uint32_t(lCpuLights.size() - a + lGpuLights.size() - b);
+		mStats.mMismatchedClusters += lDifferent != 0;
+		mStats.mMismatchedLights += lDifferent;
+	}
+	return mStats.mMismatchedClusters;
+}
+
+void Renderer::ClusterLightCuller::MarkActiveClusters(const FrameData& InFrame, std::span<const XMFLOAT2> InPixelDepthRanges, uint32_t InWidth)
+{
+	Expects(InWidth > 0 && InPixelDepthRanges.size() % InWidth == 0);
+	const uint32_t lCountX = InFrame.ClusterCountX;
+	const uint32_t lCountY = InFrame.ClusterCountY;
+	const uint32_t lCountZ = InFrame.ClusterCountZ;
+	mActiveFlags.assign(size_t(lCountX) * lCountY * lCountZ, 0);
+	const float lTileWidth = InFrame.ViewSizeAndInvSize.x / float(lCountX);
+	const float lTileHeight = InFrame.ViewSizeAndInvSize.y / float(lCountY);
+	const uint32_t lHeight = uint32_t(InPixelDepthRanges.size() / InWidth);
+	for (uint32_t y = 0; y < lHeight; ++y)
+	{
+		const uint32_t lTileY = std::min(uint32_t(float(y) / lTileHeight), lCountY - 1);
+		for (uint32_t x = 0; x < InWidth; ++x)
+		{
+			const auto& lRange = InPixelDepthRanges[size_t(y) * InWidth + x];
+			if (lRange.y <= 0.0f)
+			{
+				continue;
+			}
+			const uint32_t lTileX = std::min(uint32_t(float(x) / lTileWidth), lCountX - 1);
+			const float lNearSlice = ComputeZSlice(InFrame, ConvertFromDeviceZ(InFrame, lRange.y));
+			const float lFarSlice = ComputeZSlice(InFrame, ConvertFromDeviceZ(InFrame, lRange.x));
+			const uint32_t lFirst = std::min(uint32_t(std::max(lNearSlice - SLICE_EPSILON, 0.0f)), lCountZ - 1);
+			const uint32_t lLast = std::min(uint32_t(lFarSlice + SLICE_EPSILON), lCountZ - 1);
+			for (uint32_t z = lFirst; z <= lLast; ++z)
+			{
+				mActiveFlags[(size_t(z) * lCountY + lTileY) * lCountX + lTileX] = 1;
+			}
+		}
+	}
+}
+
+uint32_t Renderer::ClusterLightCuller::CompareActiveClusters(std::span<const uint32_t> InGpuActiveClusters)
+{
+	//Both lists are ascending,count the clusters present on only one side.
+	uint32_t lDifferent = 0;
+	size_t a = 0, b = 0;
+	while (a < mActiveClusters.size() && b < InGpuActiveClusters.size())
+	{
+		if (mActiveClusters[a] == InGpuActiveClusters[b])
+		{
+			a++;
+			b++;
+		}
+		else
+		{
+			lDifferent++;
+			mActiveClusters[a] < InGpuActiveClusters[b] ? a++ : b++;
+		}
+	}
+	lDifferent += uint32_t(mActiveClusters.size() - a + InGpuActiveClusters.size() - b);
+	mStats.mMismatchedActiveClusters = lDifferent;
+	return lDifferent;
+}
+
+bool Renderer::ClusterLightCuller::ShapeIntersectsCell(const ViewLight& InLight, const XMFLOAT3& InCenter, const XMFLOAT3& InExtent)
+{
+	switch (InLight.mType)
+	{
+	case ECS::LightType::SPOT:
+		return InLight.mShape.x <= 0.0f || SpotIntersectsSphere(InLight.mPos, InLight.mAxis, InLight.mRange, InLight.mShape.x, InLight.mShape.z, InCenter, std::sqrt(Dot(InExtent, InExtent)));
+	case ECS::LightType::CAPSULE:
+	{
+		const float lHalf = InLight.mShape.x;
+		const float lRange = InLight.mRange;
+		const XMFLOAT3 lHalfSegment = { InLight.mAxis.x * lHalf, InLight.mAxis.y * lHalf, InLight.mAxis.z * lHalf };
+		return SegmentIntersectsBox(
+			{ InLight.mPos.x - lHalfSegment.x, InLight.mPos.y - lHalfSegment.y, InLight.mPos.z - lHalfSegment.z },
+			{ InLight.mPos.x + lHalfSegment.x, InLight.mPos.y + lHalfSegment.y, InLight.mPos.z + lHalfSegment.z },
+			{ InCenter.x - InExtent.x - lRange, InCenter.y - InExtent.y - lRange, InCenter.z - InExtent.z - lRange },
+			{ InCenter.x + InExtent.x + lRange, InCenter.y + InExtent.y + lRange, InCenter.z + InExtent.z + lRange });
+	}
+	default:
+		return true;
+	}
+}
+
+bool Renderer::ClusterLightCuller::ShapeContains(const ViewLight& InLight, const XMFLOAT3& InPoint)
+{
+	XMFLOAT3 lDelta = { InPoint.x - InLight.mPos.x, InPoint.y - InLight.mPos.y, InPoint.z - InLight.mPos.z };
+	if (InLight.mType == ECS::LightType::CAPSULE)
+	{
+		//Offset from the closest point of the segment.
+		const float lT = std::clamp(Dot(lDelta, InLight.mAxis), -InLight.mShape.x, InLight.mShape.x);
+		lDelta = { lDelta.x - InLight.mAxis.x * lT, lDelta.y - InLight.mAxis.y * lT, lDelta.z - InLight.mAxis.z * lT };
+	}
+	const float lDistanceSq = Dot(lDelta, lDelta);
+	if (lDistanceSq >= InLight.mRange * InLight.mRange)
+	{
+		return false;
+	}
+	if (InLight.mType == ECS::LightType::SPOT)
+	{
+		return Dot(lDelta, InLight.mAxis) >= InLight.mShape.x * std::sqrt(lDistanceSq);
+	}
+	return true;
+}
+
+Renderer::LightCullAccuracy Renderer::ClusterLightCuller::MeasureFalsePositives(std::span<const ECS::LigthData> InLights, uint32_t InSamplesPerAxis) const
+{
+	Expects(InSamplesPerAxis >= 2 && InLights.size() >= mViewLights.size());
+	LightCullAccuracy lAccuracy;
+	const float lStep = 1.0f / float(InSamplesPerAxis - 1);
+	for (uint32_t c = 0; c < (uint32_t)mClusters.size(); ++c)
+	{
+		const auto& lCluster = mClusters[c];
+		if (lCluster.count == 0)
+		{
+			continue;
+		}
+		const uint32_t lX = c % mFrame.ClusterCountX;
+		const uint32_t lY = (c / mFrame.ClusterCountX) % mFrame.ClusterCountY;
+		const uint32_t lZ = c / (mFrame.ClusterCountX * mFrame.ClusterCountY);
+		XMFLOAT3 lTileMin, lTileMax;
+		ComputeCellViewAABB(mFrame, lX, lY, lZ, lTileMin, lTileMax);
+		for (uint32_t i = 0; i < lCluster.count; ++i)
+		{
+			const uint32_t lLight = mLightIndices[lCluster.offset + i];
+			const auto& lViewLight = mViewLights[lLight];
+			bool lReached = false;
+			//Corners and faces are sampled too,lights grazing the cell still reach it.
+			for (uint32_t sz = 0; sz < InSamplesPerAxis && !lReached; ++sz)
+			{
+				for (uint32_t sy = 0; sy < InSamplesPerAxis && !lReached; ++sy)
+				{
+					for (uint32_t sx = 0; sx < InSamplesPerAxis && !lReached; ++sx)
+					{
+						const XMFLOAT3 lPoint =
+						{
+							lTileMin.x + (lTileMax.x - lTileMin.x) * (sx * lStep),
+							lTileMin.y + (lTileMax.y - lTileMin.y) * (sy * lStep),
+							lTileMin.z + (lTileMax.z - lTileMin.z) * (sz * lStep),
+						};
+						lReached = ShapeContains(lViewLight, lPoint);
+					}
+				}
+			}
+			const uint32_t lType = std::min((uint32_t)InLights[lLight].type, 2u);
+			lAccuracy.mAssignments++;
+			lAccuracy.mTypeAssignments[lType]++;
+			if (!lReached)
+			{
+				lAccuracy.mFalsePositives++;
+				lAccuracy.mTypeFalsePositives[lType]++;
+			}
+		}
+	}
+	return lAccuracy;
+}
+
+void Renderer::ClusterLightCuller::BinRow(uint32_t InRow)
+{
+	const uint32_t lY = InRow % mFrame.ClusterCountY;
+	const uint32_t lZ = InRow / mFrame.ClusterCountY;
+	const XMVECTOR lZero = XMVectorZero();
+	const uint32_t lCount = (uint32_t)mLightRadiusSq.size();
+	auto& lRowLights = mRowLights[InRow];
+	lRowLights.clear();
+	for (uint32_t x = 0; x < mFrame.ClusterCountX; ++x)
+	{
+		XMFLOAT3 lTileMin, lTileMax;
+		ComputeCellViewAABB(mFrame, x, lY, lZ, lTileMin, lTileMax);
+		XMFLOAT3 lCenter = { .5f * (lTileMin.x + lTileMax.x), .5f * (lTileMin.y + lTileMax.y), .5f * (lTileMin.z + lTileMax.z) };
+		XMFLOAT3 lExtent = { lTileMax.x - lCenter.x, lTileMax.y - lCenter.y, lTileMax.z - lCenter.z };
+		const XMVECTOR lCenterX = XMVectorReplicate(lCenter.x);
+		const XMVECTOR lCenterY = XMVectorReplicate(lCenter.y);
+		const XMVECTOR lCenterZ = XMVectorReplicate(lCenter.z);
+		const XMVECTOR lExtentX = XMVectorReplicate(lExtent.x);
+		const XMVECTOR lExtentY = XMVectorReplicate(lExtent.y);
+		const XMVECTOR lExtentZ = XMVectorReplicate(lExtent.z);
+
+		const uint32_t lCluster = InRow * mFrame.ClusterCountX + x;
+		mRowStarts[lCluster] = (uint32_t)lRowLights.size();
+		if (!mActiveFlags[lCluster])
+		{
+			mClusterCounts[lCluster] = 0;
+			continue;
+		}
+		//Four lights per step,ComputeSquaredDistanceFromBoxToPoint without fused multiply add.
+		for (uint32_t i = 0; i < lCount; i += 4)
+		{
+			XMVECTOR lDx = XMVectorMax(XMVectorSubtract(XMVectorAbs(XMVectorSubtract(XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(&mLightX[i])), lCenterX)), lExtentX), lZero);
+			XMVECTOR lDy = XMVectorMax(XMVectorSubtract(XMVectorAbs(XMVectorSubtract(XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(&mLightY[i])), lCenterY)), lExtentY), lZero);
+			XMVECTOR lDz = XMVectorMax(XMVectorSubtract(XMVectorAbs(XMVectorSubtract(XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(&mLightZ[i])), lCenterZ)), lExtentZ), lZero);
+			XMVECTOR lDistanceSq = XMVectorAdd(XMVectorAdd(XMVectorMultiply(lDx, lDx), XMVectorMultiply(lDy, lDy)), XMVectorMultiply(lDz, lDz));
+			XMVECTOR lInside = XMVectorLess(lDistanceSq, XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(&mLightRadiusSq[i])));
+			if (XMVector4EqualInt(lInside, XMVectorFalseInt()))
+			{
+				continue;
+			}
+			//The mask bits as they are,XMStoreUInt4 would convert the all ones lanes as floats.
+			uint32_t lLaneMask[4];
+			XMStoreInt4(lLaneMask, lInside);
+			for (uint32_t k = 0; k < 4; ++k)
+			{
+				if (lLaneMask[k] && (mSphereBoundsOnly || ShapeIntersectsCell(mViewLights[i + k], lCenter, lExtent)))
+				{
+					lRowLights.push_back(i + k);
+				}
+			}
+		}
+		mClusterCounts[lCluster] = (uint32_t)lRowLights.size() - mRowStarts[lCluster];
+	}
+}
+
+void Renderer::ClusterLightCuller::CompactOffsets()
+{
+	const uint32_t lCapacity = MAX_CLUSTER_LIGHT_INDICES;
+	uint64_t lOffset = 0;
+	for (uint32_t i = 0; i < (uint32_t)mClusters.size(); ++i)
+	{
+		uint32_t lClampedOffset = (uint32_t)std::min<uint64_t>(lOffset, lCapacity);
+		mClusters[i].offset = lClampedOffset;
+		mClusters[i].count = std::min(mClusterCounts[i], lCapacity - lClampedOffset);
+		mStats.mDroppedAssignments += mClusterCounts[i] - mClusters[i].count;
+		lOffset += mClusterCounts[i];
+	}
+	mLightIndices.resize((size_t)std::min<uint64_t>(lOffset, lCapacity));
+}
+
+void Renderer::ClusterLightCuller::WriteRow(uint32_t InRow)
+{
+	const auto& lRowLights = mRowLights[InRow];
+	for (uint32_t x = 0; x < mFrame.ClusterCountX; ++x)
+	{
+		const uint32_t lCluster = InRow * mFrame.ClusterCountX + x;
+		const auto& lRange = mClusters[lCluster];
+		std::copy_n(lRowLights.begin() + mRowStarts[lCluster], lRange.count, mLightIndices.begin() + lRange.offset);
+	}
+}
@@ -0,0 +1,142 @@
+#pragma once
+#include "renderer_common.h"
+
+namespace Renderer
+{
+	struct ClusterCullStats
+	{
+		uint32_t mLights = 0;
+		uint32_t mClusters = 0;
+		//Entries in the compacted light index list,i.e. light and cluster overlaps.
+		uint32_t mAssignments = 0;
+		//Assignments dropped because the list was full.
+		uint32_t mDroppedAssignments = 0;
+		uint32_t mEmptyClusters = 0;
+		uint32_t mMaxClusterLights = 0;
+		//Bytes read by the color pass:cluster ranges plus the used part of the index list.
+		uint32_t mListBytes = 0;
+		//Bytes a per cluster bit mask over the same lights would take.
+		uint32_t mMaskBytes = 0;
+		float mCullMs = 0.0f;
+		//Clusters tested against the lights,every cluster unless only the active ones are culled.
+		uint32_t mActiveClusters = 0;
+		//Filled by validation against the GPU buffers.
+		uint32_t mMismatchedClusters = 0;
+		uint32_t mMismatchedLights = 0;
+		uint32_t mMismatchedActiveClusters = 0;
+	};
+
+	//Assignments the exact light volume does not reach,see ClusterLightCuller::MeasureFalsePositives.
+	struct LightCullAccuracy
+	{
+		uint32_t mAssignments = 0;
+		uint32_t mFalsePositives = 0;
+		//Indexed by ECS::LightType.
+		std::array<uint32_t, 3> mTypeAssignments = {};
+		std::array<uint32_t, 3> mTypeFalsePositives = {};
+	};
+
+	//Read back from the GPU every frame the cluster grid is culled on the GPU.
+	struct ActiveClusterStats
+	{
+		uint32_t mActiveClusters = 0;
+		uint32_t mTotalClusters = 0;
+	};
+
+	//CPU port of LightCull.hlsl,builds the same cluster ranges and light index list from the same FrameData,
+	//including its cluster grid.
+	//Every float op follows the shader's order and indices are written in ascending light order on both sides,
+	//so the result can be diffed exactly against the GPU buffers.
+	//Used to validate the compute passes,to profile culling without a GPU and as a fallback for it.
+	class ClusterLightCuller
+	{
+	public:
+		ClusterLightCuller(tf::Executor& InExecutor);
+
+		~ClusterLightCuller();
+
+		//InFrame is the GPU copy,matrices are transposed exactly as the shader reads them.
+		//With InActiveOnly only the clusters marked by the last MarkActiveClusters are culled,the others stay empty.
+		void Cull(const FrameData& InFrame, std::span<const ECS::LigthData> InLights, bool InActiveOnly = false);
+
+		//Port of MarkActiveClusters.InPixelDepthRanges holds the min and max device depth over the samples of every pixel,
+		//row major with InWidth pixels per row,as the shader writes it for validation.
+		void MarkActiveClusters(const FrameData& InFrame, std::span<const DirectX::XMFLOAT2> InPixelDepthRanges, uint32_t InWidth);
+
+		//Port of ComputeCellViewAABB.
+		static void ComputeCellViewAABB(const FrameData& InFrame, uint32_t InX, uint32_t InY, uint32_t InZ,
+			DirectX::XMFLOAT3& OutViewTileMin, DirectX::XMFLOAT3& OutViewTileMax);
+
+		//Diff against the buffers read back from the GPU,the result is also written to the stats.
+		//InGpuClusters may be larger than the grid,only the grid's clusters are compared.
+		uint32_t Compare(std::span<const Cluster> InGpuClusters, std::span<const uint32_t> InGpuLightIndices);
+
+		//Diff against the compacted active list read back from the GPU,call after Cull.
+		uint32_t CompareActiveClusters(std::span<const uint32_t> InGpuActiveClusters);
+
+		std::span<const Cluster> GetClusters() const { return mClusters; }
+
+		//Test the bounding spheres only,the culling every light got before the shape tests.
+		//The result no longer matches the GPU,this is for measuring what the shape tests save.
+		void SetSphereBoundsOnly(bool InSphereBoundsOnly) { mSphereBoundsOnly = InSphereBoundsOnly; }
+
+		//Samples InSamplesPerAxis^3 points over the view AABB of every assigned cluster against the light's exact volume,
+		//call after Cull.Lights reaching a cell between the samples count as false positives,so the rate is an upper bound.
+		LightCullAccuracy MeasureFalsePositives(std::span<const ECS::LigthData> InLights, uint32_t InSamplesPerAxis) const;
+
+		//Ascending cluster indices,port of CompactActiveClusters.
+		std::span<const uint32_t> GetActiveClusters() const { return mActiveClusters; }
+
+		std::span<const uint32_t> GetLightIndices() const { return mLightIndices; }
+
+		const ClusterCullStats& GetStats() const { return mStats; }
+
+	private:
+		//Light in view space as LightIntersectsCell transforms it.
+		struct ViewLight
+		{
+			DirectX::XMFLOAT3 mPos;
+			DirectX::XMFLOAT3 mAxis;
+			float mRange;
+			ECS::LightType mType;
+			DirectX::XMFLOAT4 mShape;
+		};
+
+		//Port of the shape tests of LightIntersectsCell,after the bounding sphere passed.
+		static bool ShapeIntersectsCell(const ViewLight& InLight, const DirectX::XMFLOAT3& InCenter, const DirectX::XMFLOAT3& InExtent);
+
+		static bool ShapeContains(const ViewLight& InLight, const DirectX::XMFLOAT3& InPoint);
+
+		//Test every light against the clusters of one row,indices go to the row scratch list.
+		void BinRow(uint32_t InRow);
+
+		//Exclusive prefix sum of the counts,clamped to MAX_CLUSTER_LIGHT_INDICES like CompactOffsets.
+		void CompactOffsets();
+
+		void WriteRow(uint32_t InRow);
+
+		tf::Executor& mExecutor;
+		//Bin rows in parallel,compact,then write rows in parallel.Rebuilt when the row count changes.
+		std::unique_ptr<tf::Taskflow> mFlow;
+		uint32_t mFlowRows = 0;
+		FrameData mFrame;
+		std::vector<Cluster> mClusters;
+		std::vector<uint32_t> mLightIndices;
+		//One flag per cluster of the grid,set by MarkActiveClusters or by Cull for every cluster.
+		std::vector<uint8_t> mActiveFlags;
+		std::vector<uint32_t> mActiveClusters;
+		//Per row of ClusterCountX clusters,the lights of each cluster back to back.
+		std::vector<std::vector<uint32_t>> mRowLights;
+		//Unclamped count and start in the row list per cluster.
+		std::vector<uint32_t> mClusterCounts;
+		std::vector<uint32_t> mRowStarts;
+		//View space bounding sphere centers and squared radii,SoA padded to a multiple of 4 for the SIMD test.
+		std::vector<float> mLightX;
+		std::vector<float> mLightY;
+		std::vector<float> mLightZ;
+		std::vector<float> mLightRadiusSq;
+		std::vector<ViewLight> mViewLights;
+		bool mSphereBoundsOnly = false;
+		ClusterCullStats mStats;
+	};
+}
@@ -0,0 +1,83 @@
+#include "descriptor_allocator.h"
+
+Renderer::DescriptorAllocator::DescriptorAllocator(uint32_t InPersistent, uint32_t InTransient):
+	mPersistentCapacity(InPersistent),
+	mTransientCapacity(InTransient),
+	mPersistent(InPersistent),
+	mTransient(InTransient ? std::make_unique<StagingRing>(InTransient) : nullptr)
+{
+
+}
+
+Renderer::DescriptorAllocator::~DescriptorAllocator()
+{
+
+}
+
+uint32_t Renderer::DescriptorAllocator::Allocate(uint32_t InCount)
+{
+	const uint32_t lIndex = mPersistent.Allocate(InCount);
+	if (lIndex == GeometryAllocator::INVALID_OFFSET)
+	{
+		mFailedAllocations++;
+		return INVALID_INDEX;
+	}
+	return lIndex;
+}
+
+void Renderer::DescriptorAllocator::Free(uint32_t InIndex)
+{
+	Expects(InIndex < mPersistentCapacity);
+	mPendingFrees.push_back(InIndex);
+}
+
+uint32_t Renderer::DescriptorAllocator::AllocateTransient(uint32_t InCount)
+{
+	Expects(mTransient && InCount <= mTransientCapacity);
+	const uint64_t lOffset = mTransient->Allocate(InCount, 1);
+	if (lOffset == UINT64_MAX)
+	{
+		mFailedAllocations++;
+		return INVALID_INDEX;
+	}
+	return mPersistentCapacity + (uint32_t)lOffset;
+}
+
+void Renderer::DescriptorAllocator::Retire(uint64_t InFenceValue)
+{
+	Expects(mRetiredFrees.empty() || mRetiredFrees.back().mFenceValue <= InFenceValue);
+	for (uint32_t index : mPendingFrees)
+	{
+		mRetiredFrees.push_back({ InFenceValue, index });
+	}
+	mPendingFrees.clear();
+	if (mTransient)
+	{
+		mTransient->Retire(InFenceValue);
+	}
+}
+
+void Renderer::DescriptorAllocator::Reclaim(uint64_t InCompletedValue)
+{
+	while (!mRetiredFrees.empty() && mRetiredFrees.front().mFenceValue <= InCompletedValue)
+	{
+		mPersistent.Free(mRetiredFrees.front().mIndex);
+		mRetiredFrees.pop_front();
+	}
+	if (mTransient)
+	{
+		mTransient->Reclaim(InCompletedValue);
+	}
+}
+
+Renderer::DescriptorAllocatorStats Renderer::DescriptorAllocator::GetStats() const
+{
+	DescriptorAllocatorStats lStats;
+	lStats.mPersistentCapacity = mPersistentCapacity;
+	lStats.mPersistentUsed = mPersistent.GetStats().mUsed;
+	lStats.mPendingFrees = uint32_t(mPendingFrees.size() + mRetiredFrees.size());
+	lStats.mTransientCapacity = mTransientCapacity;
+	lStats.mTransientUsed = mTransient ? (uint32_t)mTransient->GetUsed() : 0;
+	lStats.mFailedAllocations = mFailedAllocations;
+	return lStats;
+}
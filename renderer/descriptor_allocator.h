@@ -0,0 +1,69 @@
+#pragma once
+#include "geometry_allocator.h"
+#include "staging_ring.h"
+
+namespace Renderer
+{
+	struct DescriptorAllocatorStats
+	{
+		uint32_t mPersistentCapacity = 0;
+		uint32_t mPersistentUsed = 0;
+		//Freed but waiting for the frames that may still read them.
+		uint32_t mPendingFrees = 0;
+		uint32_t mTransientCapacity = 0;
+		uint32_t mTransientUsed = 0;
+		uint32_t mFailedAllocations = 0;
+	};
+
+	//Allocation policy of one descriptor heap,only hands out indices so it runs without a device.
+	//The first InPersistent descriptors live as long as a resource:free list allocation,a freed range is reused
+	//once the frame that ended after the free completed.The InTransient descriptors behind them form a ring
+	//for descriptors written and read within one frame,a frame's allocations are reclaimed together.
+	//Not thread safe.
+	class DescriptorAllocator
+	{
+	public:
+		static constexpr uint32_t INVALID_INDEX = UINT32_MAX;
+
+		DescriptorAllocator(uint32_t InPersistent, uint32_t InTransient);
+
+		~DescriptorAllocator();
+
+		//First of InCount consecutive persistent descriptors,INVALID_INDEX if no free range is large enough.
+		uint32_t Allocate(uint32_t InCount);
+
+		//InIndex has to come from Allocate.Frames recorded so far may still read it,reused after the next Retire completed.
+		void Free(uint32_t InIndex);
+
+		//First of InCount consecutive descriptors valid until the current frame completed,INVALID_INDEX while the ring is full.
+		uint32_t AllocateTransient(uint32_t InCount);
+
+		//End of a frame,frees and transient allocations since the last call are released once InFenceValue completed.
+		void Retire(uint64_t InFenceValue);
+
+		//Release everything retired up to InCompletedValue.
+		void Reclaim(uint64_t InCompletedValue);
+
+		uint32_t GetCapacity() const { return mPersistentCapacity + mTransientCapacity; }
+
+		DescriptorAllocatorStats GetStats() const;
+
+	private:
+		struct RetiredFree
+		{
+			uint64_t mFenceValue;
+			uint32_t mIndex;
+		};
+
+		uint32_t mPersistentCapacity;
+		uint32_t mTransientCapacity;
+		GeometryAllocator mPersistent;
+		//Null without transient descriptors.
+		std::unique_ptr<StagingRing> mTransient;
+		//Freed since the last Retire.
+		std::vector<uint32_t> mPendingFrees;
+		//In fence order.
+		std::deque<RetiredFree> mRetiredFrees;
+		uint32_t mFailedAllocations = 0;
+	};
+}
@@ -7,7 +7,8 @@
 constexpr static bool RequireDXRSupport = true;
 static bool g_bTypedUAVLoadSupport_R11G11B10_FLOAT = false;
 static bool g_bTypedUAVLoadSupport_R16G16B16A16_FLOAT = false;
-constexpr int MAX_DESC_NUM = 1024;
+//Behind the persistent descriptors of the shader visible CBV_SRV_UAV heap.
+constexpr int MAX_TRANSIENT_DESC_NUM = 1024;
 bool useDebug = false;
 
 // Check adapter support for DirectX Ray tracing.
@@ -22,14 +23,13 @@ bool IsDirectXRaytracingSupported(ID3D12Device* testDevice)
 }
 
 Renderer::DeviceManager::DeviceManager():
-mCurrentBackbufferIndex(0),
-mFrameFenceValue(1),
-mFrameFence(nullptr)
+mCurrentBackbufferIndex(0)
 {
 	CreateD3DDevice();
 	CreateCmdManager();
-	mFrameDoneEvent = CreateEvent(nullptr, false, true, nullptr);
-	Ensures(g_Device->CreateFence(0, D3D12_FENCE_FLAG_NONE, IID_PPV_ARGS(&mFrameFence)) == S_OK);
+	mGraphicsTimeline = std::make_unique<D3D12TimelineQueue>(mCmdManager->GetQueue(D3D12_COMMAND_LIST_TYPE_DIRECT), L"GraphicsTimeline");
+	mComputeTimeline = std::make_unique<D3D12TimelineQueue>(mCmdManager->GetQueue(D3D12_COMMAND_LIST_TYPE_COMPUTE), L"ComputeTimeline");
+	mFramePacer = std::make_unique<FramePacer>(*mGraphicsTimeline);
 }
 
 void Renderer::DeviceManager::CreateD3DDevice()
@@ -259,6 +259,8 @@ void Renderer::DeviceManager::CreateD3DDevice()
 
 Renderer::DeviceManager::~DeviceManager()
 {
+	//Frames in flight may still use the descriptor heaps.
+	WaitForIdle();
 	for (int i = 0; i < D3D12_DESCRIPTOR_HEAP_TYPE_NUM_TYPES; ++i)
 	{
 		if (g_DescHeap[i])
@@ -279,26 +281,44 @@ void Renderer::DeviceManager::SetTargetWindowAndCreateSwapChain(HWND InWindow, i
 
 void Renderer::DeviceManager::BeginFrame()
 {
-	//Wait for preview frame done
+	mFramePacer->BeginFrame();
+	const uint64_t lCompleted = mGraphicsTimeline->GetCompletedValue();
+	for (auto heap : g_DescHeap)
+	{
+		heap->Reclaim(lCompleted);
+	}
 	if (!s_SwapChain1)
 	{
 		return;
 	}
 	mCurrentBackbufferIndex = static_cast<IDXGISwapChain4*>(s_SwapChain1)->GetCurrentBackBufferIndex();
-	WaitForSingleObject(mFrameDoneEvent, INFINITE);
 }
 
-void Renderer::DeviceManager::EndFrame()
+uint64_t Renderer::DeviceManager::EndFrame()
 {
-	if (!s_SwapChain1)
+	const uint64_t lFrameValue = mFramePacer->EndFrame();
+	//Descriptors freed while the frame was recorded may be read until it completed.
+	for (auto heap : g_DescHeap)
 	{
-		return;
+		heap->Retire(lFrameValue);
 	}
-	mCmdManager->GetQueue(D3D12_COMMAND_LIST_TYPE_DIRECT)->Signal(mFrameFence, mFrameFenceValue);
-	mFrameFence->SetEventOnCompletion(mFrameFenceValue, mFrameDoneEvent);
-	mFrameFenceValue++;
-	//Present
-	static_cast<IDXGISwapChain4*>(s_SwapChain1)->Present(0, 0);
+	if (s_SwapChain1)
+	{
+		static_cast<IDXGISwapChain4*>(s_SwapChain1)->Present(0, 0);
+	}
+	return lFrameValue;
+}
+
+void Renderer::DeviceManager::WaitForIdle()
+{
+	mGraphicsTimeline->WaitForIdle();
+	mComputeTimeline->WaitForIdle();
+}
+
+Renderer::TimelineQueue& Renderer::DeviceManager::GetTimeline(D3D12_COMMAND_LIST_TYPE InType)
+{
+	Expects(InType == D3D12_COMMAND_LIST_TYPE_DIRECT || InType == D3D12_COMMAND_LIST_TYPE_COMPUTE);
+	return InType == D3D12_COMMAND_LIST_TYPE_DIRECT ? *mGraphicsTimeline : *mComputeTimeline;
 }
 
 const int& Renderer::DeviceManager::GetCurrentFrameIndex()
@@ -502,11 +522,12 @@ void Renderer::CommandAllocatorPool::DiscardAllocator(uint64_t FenceValue, ID3D1
 
 Renderer::DescHeap::DescHeap(D3D12_DESCRIPTOR_HEAP_TYPE Type):
 	mDescSize(0),
-	mCurrentIndex(0)
+	mGpuStart{},
+	mAllocator(std::make_unique<DescriptorAllocator>(MAX_DESC_NUM, Type == D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV ? MAX_TRANSIENT_DESC_NUM : 0))
 {
 	D3D12_DESCRIPTOR_HEAP_DESC lHeapDesc = {};
 	lHeapDesc.Type = Type;
-	lHeapDesc.NumDescriptors = MAX_DESC_NUM;
+	lHeapDesc.NumDescriptors = mAllocator->GetCapacity();
 	lHeapDesc.Flags = D3D12_DESCRIPTOR_HEAP_FLAG_SHADER_VISIBLE;
 	if (Type == D3D12_DESCRIPTOR_HEAP_TYPE_RTV || Type == D3D12_DESCRIPTOR_HEAP_TYPE_DSV)
 	{
@@ -519,7 +540,12 @@ Renderer::DescHeap::DescHeap(D3D12_DESCRIPTOR_HEAP_TYPE Type):
 		mGpuStart = mDescHeap->GetGPUDescriptorHandleForHeapStart();
 	}
 	mCpuStart = mDescHeap->GetCPUDescriptorHandleForHeapStart();
-
+	if (Type == D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV)
+	{
+		//ImGui writes its font SRV at the heap start.
+		const uint32_t lImGuiIndex = mAllocator->Allocate(IMGUI_DESC_HEAP_ONLY);
+		Ensures(lImGuiIndex == 0);
+	}
 }
 
 Renderer::DescHeap::~DescHeap()
@@ -528,12 +554,55 @@ Renderer::DescHeap::~DescHeap()
 }
 
 std::tuple<D3D12_CPU_DESCRIPTOR_HANDLE, D3D12_GPU_DESCRIPTOR_HANDLE> Renderer::DescHeap::Allocate(int count)
+{
+	std::lock_guard lock(mMutex);
+	const uint32_t lIndex = mAllocator->Allocate(count);
+	if (lIndex == DescriptorAllocator::INVALID_INDEX)
+	{
+		gLogger->error("Out of descriptors for {} more,{} of {} in use", count, mAllocator->GetStats().mPersistentUsed, MAX_DESC_NUM);
+	}
+	Ensures(lIndex != DescriptorAllocator::INVALID_INDEX);
+	return GetHandles(lIndex);
+}
+
+void Renderer::DescHeap::Free(D3D12_CPU_DESCRIPTOR_HANDLE InHandle)
+{
+	std::lock_guard lock(mMutex);
+	mAllocator->Free(CalcHandleOffset(InHandle));
+}
+
+std::tuple<D3D12_CPU_DESCRIPTOR_HANDLE, D3D12_GPU_DESCRIPTOR_HANDLE> Renderer::DescHeap::AllocateTransient(int count)
+{
+	std::lock_guard lock(mMutex);
+	const uint32_t lIndex = mAllocator->AllocateTransient(count);
+	Ensures(lIndex != DescriptorAllocator::INVALID_INDEX);
+	return GetHandles(lIndex);
+}
+
+void Renderer::DescHeap::Retire(uint64_t InFrameValue)
+{
+	std::lock_guard lock(mMutex);
+	mAllocator->Retire(InFrameValue);
+}
+
+void Renderer::DescHeap::Reclaim(uint64_t InCompletedValue)
+{
+	std::lock_guard lock(mMutex);
+	mAllocator->Reclaim(InCompletedValue);
+}
+
+Renderer::DescriptorAllocatorStats Renderer::DescHeap::GetStats()
+{
+	std::lock_guard lock(mMutex);
+	return mAllocator->GetStats();
+}
+
+std::tuple<D3D12_CPU_DESCRIPTOR_HANDLE, D3D12_GPU_DESCRIPTOR_HANDLE> Renderer::DescHeap::GetHandles(uint32_t InIndex) const
 {
 	auto cpuHandle = mCpuStart;
 	auto gpuHandle = mGpuStart;
-	cpuHandle.ptr = mCpuStart.ptr + mCurrentIndex * mDescSize;
-	gpuHandle.ptr = mGpuStart.ptr + mCurrentIndex * mDescSize;
-	mCurrentIndex += count;
+	cpuHandle.ptr = mCpuStart.ptr + InIndex * mDescSize;
+	gpuHandle.ptr = mGpuStart.ptr + InIndex * mDescSize;
 	return {cpuHandle,gpuHandle};
 }
 
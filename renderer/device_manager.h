@@ -1,6 +1,8 @@
 #pragma once
 #include "gpu_resource.h"
 #include "graphics_common.h"
+#include "frame_timeline.h"
+#include "descriptor_allocator.h"
 
 
 namespace Renderer
@@ -12,21 +14,35 @@ namespace Renderer
 	inline DXGI_FORMAT g_ColorBufferFormat = DXGI_FORMAT_R16G16B16A16_FLOAT;
 	//IMGUI Needs 3 desc to work.
 	constexpr int IMGUI_DESC_HEAP_ONLY = 3;
+	//Persistent descriptors per heap,in the CBV_SRV_UAV heap also the bindless texture range.
+	constexpr int MAX_DESC_NUM = 1024;
 
+	//Descriptor heap with persistent descriptors that are freed again and a per frame ring of transient ones,
+	//see DescriptorAllocator.DeviceManager retires and reclaims every heap against the frame fence.Safe from any thread.
 	class DescHeap
 	{
 	public:
 		DescHeap(D3D12_DESCRIPTOR_HEAP_TYPE Type);
 		~DescHeap();
 		std::tuple<D3D12_CPU_DESCRIPTOR_HANDLE, D3D12_GPU_DESCRIPTOR_HANDLE> Allocate(int count = 1);
+		//InHandle has to come from Allocate,it is reused once the frames in flight stopped reading it.
+		void Free(D3D12_CPU_DESCRIPTOR_HANDLE InHandle);
+		//Valid until the frame recording now completed.
+		std::tuple<D3D12_CPU_DESCRIPTOR_HANDLE, D3D12_GPU_DESCRIPTOR_HANDLE> AllocateTransient(int count = 1);
+		void Retire(uint64_t InFrameValue);
+		void Reclaim(uint64_t InCompletedValue);
+		DescriptorAllocatorStats GetStats();
 		int CalcHandleOffset(D3D12_CPU_DESCRIPTOR_HANDLE InHandle);
 		ID3D12DescriptorHeap* GetDescHeap();
 	private:
+		std::tuple<D3D12_CPU_DESCRIPTOR_HANDLE, D3D12_GPU_DESCRIPTOR_HANDLE> GetHandles(uint32_t InIndex) const;
+
 		ID3D12DescriptorHeap* mDescHeap;
 		uint64_t mDescSize;
 		D3D12_CPU_DESCRIPTOR_HANDLE mCpuStart;
 		D3D12_GPU_DESCRIPTOR_HANDLE mGpuStart;
-		uint64_t mCurrentIndex;
+		std::unique_ptr<DescriptorAllocator> mAllocator;
+		std::mutex mMutex;
 	};
 
 	class CommandAllocatorPool
@@ -82,9 +98,18 @@ namespace Renderer
 		};
 		void SetTargetWindowAndCreateSwapChain(HWND InWindow,int InWidth,int InHeight);
 		IDXGISwapChain1* GetSwapChain() { return s_SwapChain1; }
+		//Waits until a frame slot is free,see FramePacer.
 		void BeginFrame();
-		void EndFrame();
+		//Signals the end of the frame on the direct queue and presents,returns the signaled value.
+		uint64_t EndFrame();
 		const int& GetCurrentFrameIndex();
+		//Index of the per frame resources of the frame being recorded.
+		uint32_t GetFrameSlot() const { return mFramePacer->GetSlot(); }
+		//Direct or compute queue timeline.
+		TimelineQueue& GetTimeline(D3D12_COMMAND_LIST_TYPE InType);
+		FramePacer& GetFramePacer() { return *mFramePacer; }
+		//Block until both queues finished everything submitted.
+		void WaitForIdle();
 	private:
 		void CreateSwapChain();
 		void CreateCmdManager();
@@ -96,10 +121,10 @@ namespace Renderer
 		int mWidth = 0;
 		int mHeight = 0;
 		HWND mWindow = nullptr;
-		ID3D12Fence* mFrameFence;
 		int mCurrentBackbufferIndex;
-		uint64_t mFrameFenceValue;
-		HANDLE mFrameDoneEvent;
+		std::unique_ptr<D3D12TimelineQueue> mGraphicsTimeline;
+		std::unique_ptr<D3D12TimelineQueue> mComputeTimeline;
+		std::unique_ptr<FramePacer> mFramePacer;
 	};
 
 	
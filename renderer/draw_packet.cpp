@@ -0,0 +1,198 @@
+#include "draw_packet.h"
+#include <bit>
+
+namespace
+{
+	constexpr int KEY_PASS_SHIFT = 60;
+	constexpr int KEY_PIPELINE_SHIFT = 52;
+	constexpr int KEY_MATERIAL_SHIFT = 32;
+	constexpr uint64_t KEY_MATERIAL_MASK = (1ull << 20) - 1;
+}
+
+uint64_t Renderer::DrawKey::Make(DrawPass InPass, DrawPipeline InPipeline, uint32_t InMaterial, float InViewDepth)
+{
+	//Non negative floats keep their order when compared as integers,so front to back is ascending.
+	uint32_t lDepthBits = std::bit_cast<uint32_t>(std::max(InViewDepth, 0.0f));
+	return (uint64_t(InPass) << KEY_PASS_SHIFT) |
+		(uint64_t(InPipeline) << KEY_PIPELINE_SHIFT) |
+		((uint64_t(InMaterial) & KEY_MATERIAL_MASK) << KEY_MATERIAL_SHIFT) |
+		uint64_t(lDepthBits);
+}
+
+Renderer::DrawPass Renderer::DrawKey::GetPass(uint64_t InKey)
+{
+	return DrawPass(InKey >> KEY_PASS_SHIFT);
+}
+
+Renderer::DrawPipeline Renderer::DrawKey::GetPipeline(uint64_t InKey)
+{
+	return DrawPipeline((InKey >> KEY_PIPELINE_SHIFT) & 0xff);
+}
+
+Renderer::DrawPacketStats& Renderer::DrawPacketStats::operator+=(const DrawPacketStats& InOther)
+{
+	mPackets += InOther.mPackets;
+	mPipelineChanges += InOther.mPipelineChanges;
+	mMaterialChanges += InOther.mMaterialChanges;
+	mConstantChanges += InOther.mConstantChanges;
+	mIndexBufferChanges += InOther.mIndexBufferChanges;
+	return *this;
+}
+
+Renderer::DrawPacketList::DrawPacketList()
+{
+
+}
+
+Renderer::DrawPacketList::~DrawPacketList()
+{
+
+}
+
+void Renderer::DrawPacketList::Clear()
+{
+	mPackets.clear();
+	mObjects.clear();
+	mItems[0].clear();
+	mItems[1].clear();
+	mSource = 0;
+}
+
+uint32_t Renderer::DrawPacketList::AddObject(const OjbectData& InObject)
+{
+	mObjects.push_back(InObject);
+	return uint32_t(mObjects.size() - 1);
+}
+
+void Renderer::DrawPacketList::Add(uint64_t InKey, const DrawPacket& InPacket)
+{
+	Expects(InPacket.mObjectIndex < mObjects.size());
+	mItems[0].push_back({ InKey, uint32_t(mPackets.size()) });
+	mPackets.push_back(InPacket);
+}
+
+void Renderer::DrawPacketList::Sort()
+{
+	BeginSort();
+	for (int pass = 0; pass < RADIX_PASSES; ++pass)
+	{
+		for (int chunk = 0; chunk < SORT_CHUNKS; ++chunk)
+		{
+			Histogram(pass, chunk);
+		}
+		Scan(pass);
+		for (int chunk = 0; chunk < SORT_CHUNKS; ++chunk)
+		{
+			Scatter(pass, chunk);
+		}
+		FinishPass(pass);
+	}
+}
+
+std::pair<tf::Task, tf::Task> Renderer::DrawPacketList::EmplaceSortTasks(tf::FlowBuilder& InFlow)
+{
+	tf::Task lBegin = InFlow.emplace([this]() { BeginSort(); });
+	tf::Task lPrevious = lBegin;
+	for (int pass = 0; pass < RADIX_PASSES; ++pass)
+	{
+		tf::Task lScan = InFlow.emplace([this, pass]() { Scan(pass); });
+		tf::Task lFinish = InFlow.emplace([this, pass]() { FinishPass(pass); });
+		for (int chunk = 0; chunk < SORT_CHUNKS; ++chunk)
+		{
+			tf::Task lHistogram = InFlow.emplace([this, pass, chunk]() { Histogram(pass, chunk); });
+			tf::Task lScatter = InFlow.emplace([this, pass, chunk]() { Scatter(pass, chunk); });
+			lHistogram.succeed(lPrevious).precede(lScan);
+			lScatter.succeed(lScan).precede(lFinish);
+		}
+		lPrevious = lFinish;
+	}
+	return { lBegin, lPrevious };
+}
+
+void Renderer::DrawPacketList::SplitRanges(std::span<const SortItem> InItems, uint32_t InMaxRanges, uint32_t InMinPackets,
+	std::vector<std::span<const SortItem>>& OutRanges)
+{
+	OutRanges.clear();
+	const size_t lRanges = std::clamp<size_t>(InItems.size() / std::max(InMinPackets, 1u), 1, std::max(InMaxRanges, 1u));
+	for (size_t i = 0; i < lRanges; ++i)
+	{
+		const size_t lBegin = InItems.size() * i / lRanges;
+		const size_t lEnd = InItems.size() * (i + 1) / lRanges;
+		OutRanges.push_back(InItems.subspan(lBegin, lEnd - lBegin));
+	}
+}
+
+std::span<const Renderer::DrawPacketList::SortItem> Renderer::DrawPacketList::GetSortedRange(DrawPass InPass) const
+{
+	const auto& lItems = mItems[mSource];
+	auto lPassOf = [](const SortItem& InItem) { return DrawKey::GetPass(InItem.mKey); };
+	auto lBegin = std::partition_point(lItems.begin(), lItems.end(), [&](const SortItem& i) { return lPassOf(i) < InPass; });
+	auto lEnd = std::partition_point(lBegin, lItems.end(), [&](const SortItem& i) { return lPassOf(i) == InPass; });
+	return { lBegin, lEnd };
+}
+
+void Renderer::DrawPacketList::BeginSort()
+{
+	mSource = 0;
+	mItems[1].resize(mItems[0].size());
+}
+
+void Renderer::DrawPacketList::Histogram(int InPass, int InChunk)
+{
+	auto& lCounts = mOffsets[InChunk];
+	lCounts.fill(0);
+	const auto& lSrc = mItems[mSource];
+	const int lShift = InPass * RADIX_BITS;
+	for (size_t i = ChunkBegin(InChunk), end = ChunkBegin(InChunk + 1); i < end; ++i)
+	{
+		lCounts[(lSrc[i].mKey >> lShift) & (RADIX_SIZE - 1)]++;
+	}
+}
+
+void Renderer::DrawPacketList::Scan(int InPass)
+{
+	//Digit major,chunk minor exclusive scan keeps the sort stable across chunks.
+	const uint32_t lCount = uint32_t(mItems[mSource].size());
+	uint32_t lSum = 0;
+	mSkipPass[InPass] = false;
+	for (int digit = 0; digit < RADIX_SIZE; ++digit)
+	{
+		uint32_t lDigitTotal = 0;
+		for (int chunk = 0; chunk < SORT_CHUNKS; ++chunk)
+		{
+			uint32_t lChunkCount = mOffsets[chunk][digit];
+			mOffsets[chunk][digit] = lSum;
+			lSum += lChunkCount;
+			lDigitTotal += lChunkCount;
+		}
+		//Every key shares this digit,e.g. the pass and pipeline bytes,nothing would move.
+		if (lDigitTotal == lCount)
+		{
+			mSkipPass[InPass] = true;
+		}
+	}
+}
+
+void Renderer::DrawPacketList::Scatter(int InPass, int InChunk)
+{
+	if (mSkipPass[InPass])
+	{
+		return;
+	}
+	auto& lOffsets = mOffsets[InChunk];
+	const auto& lSrc = mItems[mSource];
+	auto& lDst = mItems[mSource ^ 1];
+	const int lShift = InPass * RADIX_BITS;
+	for (size_t i = ChunkBegin(InChunk), end = ChunkBegin(InChunk + 1); i < end; ++i)
+	{
+		lDst[lOffsets[(lSrc[i].mKey >> lShift) & (RADIX_SIZE - 1)]++] = lSrc[i];
+	}
+}
+
+void Renderer::DrawPacketList::FinishPass(int InPass)
+{
+	if (!mSkipPass[InPass])
+	{
+		mSource ^= 1;
+	}
+}
@@ -0,0 +1,229 @@
+#pragma once
+#include "renderer_common.h"
+
+namespace tf
+{
+	class FlowBuilder;
+	class Task;
+}
+
+namespace Renderer
+{
+	enum class DrawPass : uint8_t
+	{
+		DEPTH_ONLY = 0,
+		SHADOW_MAP,
+		COLOR,
+		COUNT
+	};
+
+	enum class DrawPipeline : uint8_t
+	{
+		DEPTH_ONLY = 0,
+		SHADOW_MAP,
+		COLOR_MSAA,
+		COUNT
+	};
+
+	//Everything needed to record one submesh draw,no pointers back into the registry.
+	struct DrawPacket
+	{
+		uint32_t mIndexCount;
+		uint32_t mStartIndexLocation;
+		int32_t mBaseVertexLocation;
+		uint32_t mObjectIndex;
+		//Index into the material buffer,NO_MATERIAL for passes without textures.
+		uint32_t mMaterial;
+		//Indexes the 16 bit index buffer instead of the 32 bit one.
+		bool m16BitIndices;
+	};
+	static_assert(std::is_trivially_copyable_v<DrawPacket>);
+	constexpr uint32_t NO_MATERIAL = UINT32_MAX;
+
+	struct DrawPacketStats
+	{
+		uint32_t mPackets = 0;
+		uint32_t mPipelineChanges = 0;
+		uint32_t mMaterialChanges = 0;
+		uint32_t mConstantChanges = 0;
+		uint32_t mIndexBufferChanges = 0;
+		//Graphics command lists of the last submitted frame and how long the draw packets took to record,the wait for the workers included.
+		uint32_t mCommandLists = 0;
+		float mRecordMs = 0.0f;
+
+		DrawPacketStats& operator+=(const DrawPacketStats& InOther);
+	};
+
+	//64 bit sort key,most significant first:pass(4) | pipeline(8) | material(20) | view depth(32).
+	namespace DrawKey
+	{
+		uint64_t Make(DrawPass InPass, DrawPipeline InPipeline, uint32_t InMaterial, float InViewDepth);
+		DrawPass GetPass(uint64_t InKey);
+		DrawPipeline GetPipeline(uint64_t InKey);
+	}
+
+	//Per frame packet array sorted with an 8 bit LSD radix sort.
+	//The sort is split into chunks so it can run serially or as taskflow tasks with the same code.
+	class DrawPacketList
+	{
+	public:
+		struct SortItem
+		{
+			uint64_t mKey;
+			uint32_t mPacket;
+		};
+
+		static constexpr int SORT_CHUNKS = 8;
+		static constexpr int RADIX_BITS = 8;
+		static constexpr int RADIX_SIZE = 1 << RADIX_BITS;
+		static constexpr int RADIX_PASSES = 64 / RADIX_BITS;
+
+		DrawPacketList();
+
+		~DrawPacketList();
+
+		void Clear();
+
+		uint32_t AddObject(const OjbectData& InObject);
+
+		void Add(uint64_t InKey, const DrawPacket& InPacket);
+
+		void Sort();
+
+		//Emplace the parallel sort into InFlow,returns the entry and exit task so it can be chained with other stages.
+		std::pair<tf::Task, tf::Task> EmplaceSortTasks(tf::FlowBuilder& InFlow);
+
+		//Valid after sorting.
+		std::span<const SortItem> GetSortedRange(DrawPass InPass) const;
+
+		const DrawPacket& GetPacket(uint32_t InIndex) const { return mPackets[InIndex]; }
+
+		const OjbectData& GetObjectData(uint32_t InIndex) const { return mObjects[InIndex]; }
+
+		size_t Size() const { return mPackets.size(); }
+
+		//Split InItems into at most InMaxRanges contiguous ranges of at least InMinPackets packets,fewer when there are not enough.
+		static void SplitRanges(std::span<const SortItem> InItems, uint32_t InMaxRanges, uint32_t InMinPackets,
+			std::vector<std::span<const SortItem>>& OutRanges);
+
+		//Record a sorted range into InCmd,either an ID3D12GraphicsCommandList or CountingCommandList.
+		//InCmd must have InBoundPipeline,InIndexBuffers[0] and every other pass state set,state changes are only issued between packets.
+		//InIndexBuffers holds the 32 and the 16 bit index buffer.
+		template<class CmdList>
+		DrawPacketStats Record(CmdList* InCmd, std::span<const SortItem> InItems,
+			std::span<ID3D12PipelineState* const> InPipelines, DrawPipeline InBoundPipeline,
+			std::span<const D3D12_INDEX_BUFFER_VIEW, 2> InIndexBuffers) const;
+
+	private:
+		void BeginSort();
+		void Histogram(int InPass, int InChunk);
+		void Scan(int InPass);
+		void Scatter(int InPass, int InChunk);
+		void FinishPass(int InPass);
+		size_t ChunkBegin(int InChunk) const { return mItems[0].size() * InChunk / SORT_CHUNKS; }
+
+		std::vector<DrawPacket> mPackets;
+		std::vector<OjbectData> mObjects;
+		//Ping-pong buffers,mSource is the one holding the current order.
+		std::array<std::vector<SortItem>, 2> mItems;
+		int mSource = 0;
+		std::array<std::array<uint32_t, RADIX_SIZE>, SORT_CHUNKS> mOffsets;
+		std::array<bool, RADIX_PASSES> mSkipPass;
+	};
+
+	//Stands in for ID3D12GraphicsCommandList when benchmarking recording without a device.
+	//Counts the calls Record makes and writes each as a command of the same size into a buffer,
+	//so recording still costs a memory write per call.
+	class CountingCommandList
+	{
+	public:
+		void Reset() { mCommands.clear(); mDraws = 0; mStateChanges = 0; }
+
+		void SetPipelineState(ID3D12PipelineState* InPipeline) { Push(&InPipeline, sizeof(InPipeline)); mStateChanges++; }
+
+		void SetGraphicsRoot32BitConstants(UINT InRootParameter, UINT InCount, const void* InData, UINT InOffset)
+		{
+			Push(&InRootParameter, sizeof(InRootParameter));
+			Push(InData, InCount * sizeof(uint32_t));
+			mStateChanges++;
+		}
+
+		void SetGraphicsRoot32BitConstant(UINT InRootParameter, UINT InData, UINT InOffset)
+		{
+			Push(&InRootParameter, sizeof(InRootParameter));
+			Push(&InData, sizeof(InData));
+			mStateChanges++;
+		}
+
+		void IASetIndexBuffer(const D3D12_INDEX_BUFFER_VIEW* InView) { Push(InView, sizeof(*InView)); mStateChanges++; }
+
+		void DrawIndexedInstanced(UINT InIndexCount, UINT InInstanceCount, UINT InStartIndex, INT InBaseVertex, UINT InStartInstance)
+		{
+			const uint32_t lArgs[] = { InIndexCount, InInstanceCount, InStartIndex, uint32_t(InBaseVertex), InStartInstance };
+			Push(lArgs, sizeof(lArgs));
+			mDraws++;
+		}
+
+		uint32_t GetDraws() const { return mDraws; }
+
+		uint32_t GetStateChanges() const { return mStateChanges; }
+
+		size_t GetBytes() const { return mCommands.size(); }
+
+	private:
+		void Push(const void* InData, size_t InSize)
+		{
+			auto* lBytes = static_cast<const uint8_t*>(InData);
+			mCommands.insert(mCommands.end(), lBytes, lBytes + InSize);
+		}
+
+		std::vector<uint8_t> mCommands;
+		uint32_t mDraws = 0;
+		uint32_t mStateChanges = 0;
+	};
+
+	template<class CmdList>
+	DrawPacketStats DrawPacketList::Record(CmdList* InCmd, std::span<const SortItem> InItems,
+		std::span<ID3D12PipelineState* const> InPipelines, DrawPipeline InBoundPipeline,
+		std::span<const D3D12_INDEX_BUFFER_VIEW, 2> InIndexBuffers) const
+	{
+		constexpr int objSize = sizeof(OjbectData) / 4;
+		DrawPacketStats lStats;
+		auto lPipeline = InBoundPipeline;
+		uint32_t lObject = UINT32_MAX;
+		uint32_t lMaterial = NO_MATERIAL;
+		bool l16BitIndices = false;
+		lStats.mPackets = (uint32_t)InItems.size();
+		for (const auto& item : InItems)
+		{
+			const auto& lPacket = mPackets[item.mPacket];
+			auto lPacketPipeline = DrawKey::GetPipeline(item.mKey);
+			if (lPacketPipeline != lPipeline)
+			{
+				lPipeline = lPacketPipeline;
+				InCmd->SetPipelineState(InPipelines[(size_t)lPipeline]);
+				lStats.mPipelineChanges++;
+			}
+			if (lPacket.mObjectIndex != lObject)
+			{
+				lObject = lPacket.mObjectIndex;
+				InCmd->SetGraphicsRoot32BitConstants(ROOT_PARA_COMPONENT_DATA, objSize, &mObjects[lObject], 0);
+				lStats.mConstantChanges++;
+			}
+			if (lPacket.mMaterial != NO_MATERIAL && lPacket.mMaterial != lMaterial)
+			{
+				lMaterial = lPacket.mMaterial;
+				InCmd->SetGraphicsRoot32BitConstant(ROOT_PARA_DRAW_DATA, lMaterial, 0);
+				lStats.mMaterialChanges++;
+			}
+			if (lPacket.m16BitIndices != l16BitIndices)
+			{
+				l16BitIndices = lPacket.m16BitIndices;
+				InCmd->IASetIndexBuffer(&InIndexBuffers[l16BitIndices]);
+				lStats.mIndexBufferChanges++;
+			}
+			InCmd->DrawIndexedInstanced(lPacket.mIndexCount, 1, lPacket.mStartIndexLocation, lPacket.mBaseVertexLocation, 0);
+		}
+		return lStats;
+	}
+}
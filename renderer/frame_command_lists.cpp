@@ -0,0 +1,79 @@
+#include "frame_command_lists.h"
+
+Renderer::FrameCommandLists::FrameCommandLists(std::shared_ptr<CmdManager> InCmdManager):
+	mCmdManager(InCmdManager)
+{
+
+}
+
+Renderer::FrameCommandLists::~FrameCommandLists()
+{
+	for (auto* list : mLists)
+	{
+		list->Release();
+	}
+}
+
+void Renderer::FrameCommandLists::BeginFrame(uint64_t InCompletedValue)
+{
+	Expects(mUsedLists == 0);
+	mCompletedValue = InCompletedValue;
+}
+
+ID3D12GraphicsCommandList* Renderer::FrameCommandLists::OpenNext(ID3D12PipelineState* InPipeline)
+{
+	if (mUsedLists == mLists.size())
+	{
+		mLists.push_back(mCmdManager->AllocateCmdList(D3D12_COMMAND_LIST_TYPE_DIRECT));
+	}
+	auto* lAllocator = mCmdManager->RequestAllocator(D3D12_COMMAND_LIST_TYPE_DIRECT, mCompletedValue);
+	mAllocators.push_back(lAllocator);
+	auto* lList = mLists[mUsedLists++];
+	Ensures(lList->Reset(lAllocator, InPipeline) == S_OK);
+	return lList;
+}
+
+ID3D12GraphicsCommandList* Renderer::FrameCommandLists::Open(ID3D12PipelineState* InPipeline)
+{
+	Expects(mCurrent == nullptr);
+	mCurrent = OpenNext(InPipeline);
+	return mCurrent;
+}
+
+std::span<ID3D12GraphicsCommandList* const> Renderer::FrameCommandLists::Fork(uint32_t InCount)
+{
+	Expects(mCurrent && InCount > 0);
+	const uint32_t lFirst = mUsedLists;
+	for (uint32_t i = 0; i < InCount; ++i)
+	{
+		OpenNext(nullptr);
+	}
+	mCurrent = OpenNext(nullptr);
+	return std::span(mLists).subspan(lFirst, InCount);
+}
+
+void Renderer::FrameCommandLists::Submit(ID3D12CommandQueue* InQueue)
+{
+	Expects(mCurrent);
+	mSubmitScratch.clear();
+	for (uint32_t i = mFirstPending; i < mUsedLists; ++i)
+	{
+		Ensures(mLists[i]->Close() == S_OK);
+		mSubmitScratch.push_back(mLists[i]);
+	}
+	InQueue->ExecuteCommandLists((UINT)mSubmitScratch.size(), mSubmitScratch.data());
+	mFirstPending = mUsedLists;
+	mCurrent = nullptr;
+}
+
+void Renderer::FrameCommandLists::EndFrame(uint64_t InRetireValue)
+{
+	Expects(mCurrent == nullptr && mFirstPending == mUsedLists);
+	for (auto* allocator : mAllocators)
+	{
+		mCmdManager->Discard(D3D12_COMMAND_LIST_TYPE_DIRECT, allocator, InRetireValue);
+	}
+	mAllocators.clear();
+	mUsedLists = 0;
+	mFirstPending = 0;
+}
@@ -0,0 +1,54 @@
+#pragma once
+#include "device_manager.h"
+
+namespace Renderer
+{
+	//Direct command lists of one frame,executed in the order they were opened.
+	//The render chain records into the current list.A pass split across workers forks:the current list is queued,
+	//one list per worker range follows it and a new current list continues after them,so the submission order
+	//matches the recording order no matter which worker finishes first.
+	//Every list gets its own allocator,they go back to the pool at the end of the frame.
+	class FrameCommandLists
+	{
+	public:
+		FrameCommandLists(std::shared_ptr<CmdManager> InCmdManager);
+
+		~FrameCommandLists();
+
+		//Allocators are only reused once the direct queue completed the value they were retired against.
+		void BeginFrame(uint64_t InCompletedValue);
+
+		//Open a new current list,call once per frame and after every Submit.
+		ID3D12GraphicsCommandList* Open(ID3D12PipelineState* InPipeline);
+
+		//Queue the current list and open InCount lists for the workers followed by a new current list.
+		//The worker lists start without any state and are closed by Submit.
+		std::span<ID3D12GraphicsCommandList* const> Fork(uint32_t InCount);
+
+		ID3D12GraphicsCommandList* Current() const { return mCurrent; }
+
+		//Close and execute everything queued up to the current list,there is no current list afterwards.
+		void Submit(ID3D12CommandQueue* InQueue);
+
+		//Return the allocators of the frame,free again once the direct queue reaches InRetireValue.
+		//Every list must have been submitted.
+		void EndFrame(uint64_t InRetireValue);
+
+		//Lists opened this frame.
+		uint32_t GetListCount() const { return mUsedLists; }
+
+	private:
+		ID3D12GraphicsCommandList* OpenNext(ID3D12PipelineState* InPipeline);
+
+		std::shared_ptr<CmdManager> mCmdManager;
+		//Grows to the most lists a frame used,a list is reset once the frame that executed it was submitted.
+		std::vector<ID3D12GraphicsCommandList*> mLists;
+		std::vector<ID3D12CommandAllocator*> mAllocators;
+		uint32_t mUsedLists = 0;
+		//Lists opened but not yet submitted,the current one last.
+		uint32_t mFirstPending = 0;
+		ID3D12GraphicsCommandList* mCurrent = nullptr;
+		std::vector<ID3D12CommandList*> mSubmitScratch;
+		uint64_t mCompletedValue = 0;
+	};
+}
@@ -0,0 +1,97 @@
+#include "frame_timeline.h"
+
+Renderer::D3D12TimelineQueue::D3D12TimelineQueue(ID3D12CommandQueue* InQueue, const wchar_t* InName):
+	mQueue(InQueue)
+{
+	Ensures(g_Device->CreateFence(0, D3D12_FENCE_FLAG_NONE, IID_PPV_ARGS(&mFence)) == S_OK);
+	mFence->SetName(InName);
+	mEvent = CreateEvent(nullptr, false, false, nullptr);
+}
+
+Renderer::D3D12TimelineQueue::~D3D12TimelineQueue()
+{
+	if (mFence)
+	{
+		mFence->Release();
+	}
+	CloseHandle(mEvent);
+}
+
+uint64_t Renderer::D3D12TimelineQueue::Signal()
+{
+	Ensures(mQueue->Signal(mFence, ++mLastSignaled) == S_OK);
+	return mLastSignaled;
+}
+
+void Renderer::D3D12TimelineQueue::Wait(const TimelineQueue& InOther, uint64_t InValue)
+{
+	Expects(InValue <= InOther.GetLastSignaled());
+	//Timelines of different backends are never mixed.
+	Ensures(mQueue->Wait(static_cast<const D3D12TimelineQueue&>(InOther).mFence, InValue) == S_OK);
+}
+
+uint64_t Renderer::D3D12TimelineQueue::GetCompletedValue() const
+{
+	return mFence->GetCompletedValue();
+}
+
+void Renderer::D3D12TimelineQueue::WaitForValue(uint64_t InValue)
+{
+	Expects(InValue <= mLastSignaled);
+	if (IsComplete(InValue))
+	{
+		return;
+	}
+	Ensures(mFence->SetEventOnCompletion(InValue, mEvent) == S_OK);
+	WaitForSingleObject(mEvent, INFINITE);
+}
+
+Renderer::FramePacer::FramePacer(TimelineQueue& InQueue, uint32_t InFramesInFlight):
+	mQueue(InQueue)
+{
+	SetFramesInFlight(InFramesInFlight);
+}
+
+Renderer::FramePacer::~FramePacer()
+{
+
+}
+
+void Renderer::FramePacer::SetFramesInFlight(uint32_t InFramesInFlight)
+{
+	mFramesInFlight = std::clamp<uint32_t>(InFramesInFlight, 1, MAX_FRAMES_IN_FLIGHT);
+}
+
+void Renderer::FramePacer::BeginFrame()
+{
+	Expects(!mInFrame);
+	mInFrame = true;
+	const uint64_t lCompleted = mQueue.GetCompletedValue();
+	mStats = {};
+	for (uint64_t value : mSlotValues)
+	{
+		mStats.mGpuFramesInFlight += value > lCompleted;
+	}
+	if (mFrame < mFramesInFlight)
+	{
+		return;
+	}
+	//No frame after F-N shares its slot,so the slot still holds its end value.
+	const uint64_t lOldest = mSlotValues[(mFrame - mFramesInFlight) % MAX_FRAMES_IN_FLIGHT];
+	if (lOldest > lCompleted)
+	{
+		auto lStart = std::chrono::steady_clock::now();
+		mQueue.WaitForValue(lOldest);
+		mStats.mWaitMs = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - lStart).count();
+	}
+}
+
+uint64_t Renderer::FramePacer::EndFrame()
+{
+	Expects(mInFrame);
+	mInFrame = false;
+	mLastFrameValue = mQueue.Signal();
+	mSlotValues[GetSlot()] = mLastFrameValue;
+	mFrame++;
+	return mLastFrameValue;
+}
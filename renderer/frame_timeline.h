@@ -0,0 +1,112 @@
+#pragma once
+#include "graphics_common.h"
+
+namespace Renderer
+{
+	//Monotonic fence of one queue.A value is signaled after everything submitted before it and
+	//completes once the queue has executed that far.Values start at 1,0 is always complete.
+	class TimelineQueue
+	{
+	public:
+		virtual ~TimelineQueue() {}
+
+		//Queue a signal behind the work submitted so far,returns the value it will reach.
+		virtual uint64_t Signal() = 0;
+
+		//Work submitted to this queue afterwards waits until InOther reaches InValue,the CPU does not block.
+		virtual void Wait(const TimelineQueue& InOther, uint64_t InValue) = 0;
+
+		virtual uint64_t GetCompletedValue() const = 0;
+
+		//Block the CPU until InValue completed.
+		virtual void WaitForValue(uint64_t InValue) = 0;
+
+		uint64_t GetLastSignaled() const { return mLastSignaled; }
+
+		bool IsComplete(uint64_t InValue) const { return InValue <= GetCompletedValue(); }
+
+		//Everything submitted so far has finished.
+		void WaitForIdle() { WaitForValue(mLastSignaled); }
+
+	protected:
+		uint64_t mLastSignaled = 0;
+	};
+
+	class D3D12TimelineQueue final : public TimelineQueue
+	{
+	public:
+		D3D12TimelineQueue(ID3D12CommandQueue* InQueue, const wchar_t* InName);
+
+		~D3D12TimelineQueue();
+
+		uint64_t Signal() override;
+
+		//InOther has to be a D3D12TimelineQueue,the queue waits on its fence.
+		void Wait(const TimelineQueue& InOther, uint64_t InValue) override;
+
+		uint64_t GetCompletedValue() const override;
+
+		void WaitForValue(uint64_t InValue) override;
+
+		ID3D12CommandQueue* GetQueue() const { return mQueue; }
+
+	private:
+		ID3D12CommandQueue* mQueue;
+		ID3D12Fence* mFence = nullptr;
+		HANDLE mEvent;
+	};
+
+	struct FramePacerStats
+	{
+		//Earlier frames still executing when the current one began.
+		uint32_t mGpuFramesInFlight = 0;
+		//Time BeginFrame blocked on the oldest frame.
+		float mWaitMs = 0.0f;
+	};
+
+	//Lets the CPU record up to N frames ahead of the GPU.Frame F begins once frame F-N has completed on the queue,
+	//so anything indexed by GetSlot() is free to be rewritten:its previous user,frame F-MAX_FRAMES_IN_FLIGHT,is
+	//never newer than F-N.Only talks to the TimelineQueue interface,a simulated queue drives it as well as a D3D12 one.
+	class FramePacer
+	{
+	public:
+		//Per frame resources are sliced by the swap chain length,more frames than that would overwrite a slice in use.
+		static constexpr uint32_t MAX_FRAMES_IN_FLIGHT = SWAP_CHAIN_BUFFER_COUNT;
+		static constexpr uint32_t DEFAULT_FRAMES_IN_FLIGHT = 2;
+
+		FramePacer(TimelineQueue& InQueue, uint32_t InFramesInFlight = DEFAULT_FRAMES_IN_FLIGHT);
+
+		~FramePacer();
+
+		//Clamped to [1,MAX_FRAMES_IN_FLIGHT],1 waits for the previous frame before recording the next.Takes effect at the next BeginFrame.
+		void SetFramesInFlight(uint32_t InFramesInFlight);
+
+		uint32_t GetFramesInFlight() const { return mFramesInFlight; }
+
+		//Block until the frame N behind the new one has completed.
+		void BeginFrame();
+
+		//Signal the end of the current frame on the queue,returns the value its resources retire against.
+		uint64_t EndFrame();
+
+		//Frame being recorded between BeginFrame and EndFrame,counts from 0.
+		uint64_t GetFrame() const { return mFrame; }
+
+		uint32_t GetSlot() const { return uint32_t(mFrame % MAX_FRAMES_IN_FLIGHT); }
+
+		//End value of the last frame that called EndFrame,0 before the first one.
+		uint64_t GetLastFrameValue() const { return mLastFrameValue; }
+
+		const FramePacerStats& GetStats() const { return mStats; }
+
+	private:
+		TimelineQueue& mQueue;
+		uint32_t mFramesInFlight;
+		uint64_t mFrame = 0;
+		bool mInFrame = false;
+		//End value of the last frame that used each slot.
+		std::array<uint64_t, MAX_FRAMES_IN_FLIGHT> mSlotValues = {};
+		uint64_t mLastFrameValue = 0;
+		FramePacerStats mStats;
+	};
+}
@@ -0,0 +1,300 @@
+#include "geometry_allocator.h"
+#include <bit>
+#include <algorithm>
+
+Renderer::GeometryAllocator::GeometryAllocator(uint32_t InCapacity):
+	mCapacity(InCapacity)
+{
+	Expects(InCapacity > 0);
+	for (auto& heads : mFreeHeads)
+	{
+		heads.fill(INVALID_BLOCK);
+	}
+	//Block 0 always starts the physical list,merges keep the lower block.
+	const uint32_t lBlock = NewBlock();
+	mBlocks[lBlock].mSize = InCapacity;
+	InsertFree(lBlock);
+}
+
+Renderer::GeometryAllocator::~GeometryAllocator()
+{
+
+}
+
+void Renderer::GeometryAllocator::Mapping(uint32_t InSize, uint32_t& OutFl, uint32_t& OutSl)
+{
+	if (InSize < SL_COUNT)
+	{
+		OutFl = 0;
+		OutSl = InSize;
+		return;
+	}
+	const uint32_t lMsb = std::bit_width(InSize) - 1;
+	OutFl = lMsb - SL_BITS + 1;
+	OutSl = (InSize >> (lMsb - SL_BITS)) - SL_COUNT;
+}
+
+uint32_t Renderer::GeometryAllocator::FindFree(uint32_t InSize) const
+{
+	uint64_t lRounded = InSize;
+	if (InSize >= SL_COUNT)
+	{
+		lRounded += (1ull << (std::bit_width(InSize) - 1 - SL_BITS)) - 1;
+	}
+	if (lRounded > UINT32_MAX)
+	{
+		return INVALID_BLOCK;
+	}
+	uint32_t lFl, lSl;
+	Mapping((uint32_t)lRounded, lFl, lSl);
+	uint32_t lSlMap = mSlBitmaps[lFl] & (~0u << lSl);
+	if (!lSlMap)
+	{
+		const uint32_t lFlMap = lFl + 1 < 32 ? mFlBitmap & (~0u << (lFl + 1)) : 0;
+		if (!lFlMap)
+		{
+			return INVALID_BLOCK;
+		}
+		lFl = std::countr_zero(lFlMap);
+		lSlMap = mSlBitmaps[lFl];
+	}
+	return mFreeHeads[lFl][std::countr_zero(lSlMap)];
+}
+
+void Renderer::GeometryAllocator::InsertFree(uint32_t InBlock)
+{
+	uint32_t lFl, lSl;
+	Mapping(mBlocks[InBlock].mSize, lFl, lSl);
+	auto& lHead = mFreeHeads[lFl][lSl];
+	auto& lBlock = mBlocks[InBlock];
+	lBlock.mFree = true;
+	lBlock.mPrevFree = INVALID_BLOCK;
+	lBlock.mNextFree = lHead;
+	if (lHead != INVALID_BLOCK)
+	{
+		mBlocks[lHead].mPrevFree = InBlock;
+	}
+	lHead = InBlock;
+	mSlBitmaps[lFl] |= 1u << lSl;
+	mFlBitmap |= 1u << lFl;
+	mFreeBlocks++;
+}
+
+void Renderer::GeometryAllocator::RemoveFree(uint32_t InBlock)
+{
+	uint32_t lFl, lSl;
+	auto& lBlock = mBlocks[InBlock];
+	Mapping(lBlock.mSize, lFl, lSl);
+	if (lBlock.mPrevFree != INVALID_BLOCK)
+	{
+		mBlocks[lBlock.mPrevFree].mNextFree = lBlock.mNextFree;
+	}
+	if (lBlock.mNextFree != INVALID_BLOCK)
+	{
+		mBlocks[lBlock.mNextFree].mPrevFree = lBlock.mPrevFree;
+	}
+	auto& lHead = mFreeHeads[lFl][lSl];
+	if (lHead == InBlock)
+	{
+		lHead = lBlock.mNextFree;
+		if (lHead == INVALID_BLOCK)
+		{
+			mSlBitmaps[lFl] &= ~(1u << lSl);
+			if (!mSlBitmaps[lFl])
+			{
+				mFlBitmap &= ~(1u << lFl);
+			}
+		}
+	}
+	lBlock.mFree = false;
+	lBlock.mPrevFree = INVALID_BLOCK;
+	lBlock.mNextFree = INVALID_BLOCK;
+	mFreeBlocks--;
+}
+
+uint32_t Renderer::GeometryAllocator::NewBlock()
+{
+	if (mUnusedBlocks.empty())
+	{
+		mBlocks.emplace_back();
+		return (uint32_t)mBlocks.size() - 1;
+	}
+	const uint32_t lBlock = mUnusedBlocks.back();
+	mUnusedBlocks.pop_back();
+	mBlocks[lBlock] = {};
+	return lBlock;
+}
+
+uint32_t Renderer::GeometryAllocator::Carve(uint32_t InBlock, uint32_t InSize)
+{
+	RemoveFree(InBlock);
+	if (mBlocks[InBlock].mSize > InSize)
+	{
+		//NewBlock may grow mBlocks,index only after it.
+		const uint32_t lRest = NewBlock();
+		auto& lBlock = mBlocks[InBlock];
+		auto& lRestBlock = mBlocks[lRest];
+		lRestBlock.mOffset = lBlock.mOffset + InSize;
+		lRestBlock.mSize = lBlock.mSize - InSize;
+		lRestBlock.mPrevPhysical = InBlock;
+		lRestBlock.mNextPhysical = lBlock.mNextPhysical;
+		if (lBlock.mNextPhysical != INVALID_BLOCK)
+		{
+			mBlocks[lBlock.mNextPhysical].mPrevPhysical = lRest;
+		}
+		lBlock.mNextPhysical = lRest;
+		lBlock.mSize = InSize;
+		InsertFree(lRest);
+	}
+	const uint32_t lOffset = mBlocks[InBlock].mOffset;
+	mAllocated.emplace(lOffset, InBlock);
+	mUsed += InSize;
+	return lOffset;
+}
+
+void Renderer::GeometryAllocator::Merge(uint32_t InBlock, uint32_t InNext)
+{
+	auto& lBlock = mBlocks[InBlock];
+	auto& lNext = mBlocks[InNext];
+	lBlock.mSize += lNext.mSize;
+	lBlock.mNextPhysical = lNext.mNextPhysical;
+	if (lNext.mNextPhysical != INVALID_BLOCK)
+	{
+		mBlocks[lNext.mNextPhysical].mPrevPhysical = InBlock;
+	}
+	mUnusedBlocks.push_back(InNext);
+}
+
+uint32_t Renderer::GeometryAllocator::Allocate(uint32_t InCount)
+{
+	Expects(InCount > 0);
+	const uint32_t lBlock = FindFree(InCount);
+	if (lBlock == INVALID_BLOCK)
+	{
+		return INVALID_OFFSET;
+	}
+	return Carve(lBlock, InCount);
+}
+
+void Renderer::GeometryAllocator::Free(uint32_t InOffset)
+{
+	auto lAllocated = mAllocated.find(InOffset);
+	Expects(lAllocated != mAllocated.end());
+	uint32_t lBlock = lAllocated->second;
+	mAllocated.erase(lAllocated);
+	mUsed -= mBlocks[lBlock].mSize;
+	const uint32_t lNext = mBlocks[lBlock].mNextPhysical;
+	if (lNext != INVALID_BLOCK && mBlocks[lNext].mFree)
+	{
+		RemoveFree(lNext);
+		Merge(lBlock, lNext);
+	}
+	const uint32_t lPrev = mBlocks[lBlock].mPrevPhysical;
+	if (lPrev != INVALID_BLOCK && mBlocks[lPrev].mFree)
+	{
+		RemoveFree(lPrev);
+		Merge(lPrev, lBlock);
+		lBlock = lPrev;
+	}
+	InsertFree(lBlock);
+}
+
+void Renderer::GeometryAllocator::Grow(uint32_t InCapacity)
+{
+	Expects(InCapacity >= mCapacity);
+	if (InCapacity == mCapacity)
+	{
+		return;
+	}
+	uint32_t lLast = 0;
+	while (mBlocks[lLast].mNextPhysical != INVALID_BLOCK)
+	{
+		lLast = mBlocks[lLast].mNextPhysical;
+	}
+	const uint32_t lExtra = InCapacity - mCapacity;
+	mCapacity = InCapacity;
+	if (mBlocks[lLast].mFree)
+	{
+		//Its size class changes with the size.
+		RemoveFree(lLast);
+		mBlocks[lLast].mSize += lExtra;
+		InsertFree(lLast);
+		return;
+	}
+	const uint32_t lBlock = NewBlock();
+	mBlocks[lBlock].mOffset = mBlocks[lLast].mOffset + mBlocks[lLast].mSize;
+	mBlocks[lBlock].mSize = lExtra;
+	mBlocks[lBlock].mPrevPhysical = lLast;
+	mBlocks[lLast].mNextPhysical = lBlock;
+	InsertFree(lBlock);
+}
+
+uint32_t Renderer::GeometryAllocator::GetSize(uint32_t InOffset) const
+{
+	auto lAllocated = mAllocated.find(InOffset);
+	return lAllocated == mAllocated.end() ? 0 : mBlocks[lAllocated->second].mSize;
+}
+
+std::vector<Renderer::GeometryMove> Renderer::GeometryAllocator::PlanDefragment(uint32_t InMaxMoves)
+{
+	std::vector<GeometryMove> lMoves;
+	if (mFreeBlocks == 0)
+	{
+		return lMoves;
+	}
+	if (mFreeBlocks == 1)
+	{
+		//A single free block at the end of the range has no allocation above it to pull down.
+		const uint32_t lFl = std::countr_zero(mFlBitmap);
+		const uint32_t lOnlyFree = mFreeHeads[lFl][std::countr_zero(mSlBitmaps[lFl])];
+		if (mBlocks[lOnlyFree].mNextPhysical == INVALID_BLOCK)
+		{
+			return lMoves;
+		}
+	}
+	std::vector<uint32_t> lCandidates;
+	lCandidates.reserve(mAllocated.size());
+	for (auto [offset, block] : mAllocated)
+	{
+		lCandidates.push_back(offset);
+	}
+	std::sort(lCandidates.begin(), lCandidates.end(), std::greater<>());
+	for (uint32_t offset : lCandidates)
+	{
+		if (lMoves.size() >= InMaxMoves)
+		{
+			break;
+		}
+		const uint32_t lSize = mBlocks[mAllocated[offset]].mSize;
+		//Lowest hole in front of the allocation,address order instead of the size classes keeps the bottom packed.
+		for (uint32_t block = 0; block != INVALID_BLOCK && mBlocks[block].mOffset < offset; block = mBlocks[block].mNextPhysical)
+		{
+			if (mBlocks[block].mFree && mBlocks[block].mSize >= lSize)
+			{
+				lMoves.push_back({ offset, Carve(block, lSize), lSize });
+				break;
+			}
+		}
+	}
+	return lMoves;
+}
+
+Renderer::GeometryAllocatorStats Renderer::GeometryAllocator::GetStats() const
+{
+	GeometryAllocatorStats lStats;
+	lStats.mCapacity = mCapacity;
+	lStats.mUsed = mUsed;
+	lStats.mAllocations = (uint32_t)mAllocated.size();
+	lStats.mFreeBlocks = mFreeBlocks;
+	if (mFlBitmap)
+	{
+		//The largest block sits in the highest non empty class.
+		const uint32_t lFl = 31 - std::countl_zero(mFlBitmap);
+		const uint32_t lSl = 31 - std::countl_zero(mSlBitmaps[lFl]);
+		for (uint32_t block = mFreeHeads[lFl][lSl]; block != INVALID_BLOCK; block = mBlocks[block].mNextFree)
+		{
+			lStats.mLargestFree = std::max(lStats.mLargestFree, mBlocks[block].mSize);
+		}
+	}
+	return lStats;
+}
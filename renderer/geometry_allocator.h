@@ -0,0 +1,103 @@
+#pragma once
+#include <cstdint>
+#include <array>
+#include <vector>
+#include <unordered_map>
+
+namespace Renderer
+{
+	struct GeometryAllocatorStats
+	{
+		uint32_t mCapacity = 0;
+		uint32_t mUsed = 0;
+		uint32_t mAllocations = 0;
+		uint32_t mFreeBlocks = 0;
+		//A request larger than this fails even if enough space is free in total.
+		uint32_t mLargestFree = 0;
+	};
+
+	//Relocation of one allocation,the caller copies mCount elements and frees mFrom once nothing reads it anymore.
+	struct GeometryMove
+	{
+		uint32_t mFrom;
+		uint32_t mTo;
+		uint32_t mCount;
+	};
+
+	//Two level segregated fit (TLSF) allocator over a range of elements,e.g. the vertices of a shared vertex buffer.
+	//Allocate and Free are O(1):free blocks sit in size class lists found through two bitmaps,freed blocks merge with free neighbours.
+	//A block in the size class rounded up from the request always fits,so a request may fail while a block
+	//in its own class would have fitted,at most 1/SL_COUNT of the request is lost that way.
+	//Only bookkeeping,no GPU memory is touched,Allocate returns element offsets.Not thread safe.
+	class GeometryAllocator
+	{
+	public:
+		static constexpr uint32_t INVALID_OFFSET = UINT32_MAX;
+
+		GeometryAllocator(uint32_t InCapacity);
+
+		~GeometryAllocator();
+
+		//Offset of InCount consecutive elements,INVALID_OFFSET if no free block is large enough.
+		uint32_t Allocate(uint32_t InCount);
+
+		//InOffset has to come from Allocate and not be freed yet.
+		void Free(uint32_t InOffset);
+
+		//Extend the range to InCapacity elements,the new space joins the free block at the end if there is one.
+		void Grow(uint32_t InCapacity);
+
+		uint32_t GetCapacity() const { return mCapacity; }
+
+		//Elements allocated at InOffset,0 if nothing is allocated there.
+		uint32_t GetSize(uint32_t InOffset) const;
+
+		//Move up to InMaxMoves allocations from the top of the range into the lowest free blocks they fit.
+		//Each target is allocated already,the source stays allocated until the caller frees mFrom.
+		std::vector<GeometryMove> PlanDefragment(uint32_t InMaxMoves);
+
+		GeometryAllocatorStats GetStats() const;
+
+	private:
+		static constexpr uint32_t SL_BITS = 4;
+		static constexpr uint32_t SL_COUNT = 1 << SL_BITS;
+		static constexpr uint32_t FL_COUNT = 32 - SL_BITS + 1;
+		static constexpr uint32_t INVALID_BLOCK = UINT32_MAX;
+
+		struct Block
+		{
+			uint32_t mOffset = 0;
+			uint32_t mSize = 0;
+			//Neighbours in address order.
+			uint32_t mPrevPhysical = INVALID_BLOCK;
+			uint32_t mNextPhysical = INVALID_BLOCK;
+			//Neighbours in the size class list while free.
+			uint32_t mPrevFree = INVALID_BLOCK;
+			uint32_t mNextFree = INVALID_BLOCK;
+			bool mFree = false;
+		};
+
+		//Size class holding blocks of InSize elements.
+		static void Mapping(uint32_t InSize, uint32_t& OutFl, uint32_t& OutSl);
+		//Head of the first non empty class whose blocks all hold InSize elements,INVALID_BLOCK if there is none.
+		uint32_t FindFree(uint32_t InSize) const;
+		void InsertFree(uint32_t InBlock);
+		void RemoveFree(uint32_t InBlock);
+		uint32_t NewBlock();
+		//Cut InSize elements off the front of the free block InBlock and mark them allocated.
+		uint32_t Carve(uint32_t InBlock, uint32_t InSize);
+		//Merge InNext into its physical predecessor InBlock,both free and out of the class lists.
+		void Merge(uint32_t InBlock, uint32_t InNext);
+
+		uint32_t mCapacity;
+		std::vector<Block> mBlocks;
+		std::vector<uint32_t> mUnusedBlocks;
+		uint32_t mFlBitmap = 0;
+		std::array<uint32_t, FL_COUNT> mSlBitmaps = {};
+		std::array<std::array<uint32_t, SL_COUNT>, FL_COUNT> mFreeHeads;
+		//Allocated offset to its block.
+		std::unordered_map<uint32_t, uint32_t> mAllocated;
+		uint32_t mUsed = 0;
+		uint32_t mFreeBlocks = 0;
+	};
+}
@@ -0,0 +1,154 @@
+#include "geometry_pool.h"
+#include "components.h"
+
+namespace
+{
+	uint32_t PageElements(uint64_t InPages, uint32_t InStride)
+	{
+		const uint64_t lElements = InPages * Renderer::GeometryPool::PAGE_BYTES / InStride;
+		Ensures(lElements <= UINT32_MAX);
+		return (uint32_t)lElements;
+	}
+
+	//TLSF rounds a request up by at most 1/16th,the slack keeps the last allocation of a reservation from growing again.
+	uint64_t WithSlack(uint64_t InCount)
+	{
+		return InCount + InCount / 8 + 1;
+	}
+}
+
+void Renderer::GeometryDemand::Add(const ECS::StaticMeshAsset& InAsset)
+{
+	mVertices += InAsset.mVertices.size();
+	(Uses16BitIndices(InAsset.mVertices.size()) ? mIndices16 : mIndices) += InAsset.mIndices.size();
+}
+
+Renderer::GeometryPool::GeometryPool(const std::wstring& InName, uint32_t InStride, StagingUploader& InUploader):
+	mName(InName),
+	mStride(InStride),
+	mUploader(InUploader),
+	mBuffer(std::make_unique<Resource::VertexBuffer>()),
+	mAllocator(GetPageCapacity(InStride))
+{
+	mBuffer->Create(mName, mAllocator.GetCapacity(), mStride);
+}
+
+Renderer::GeometryPool::~GeometryPool()
+{
+
+}
+
+void Renderer::GeometryPool::Reserve(uint64_t InCount)
+{
+	const uint32_t lCapacity = GetReservedCapacity(mAllocator, InCount, mStride);
+	if (lCapacity > mAllocator.GetCapacity())
+	{
+		Grow(lCapacity);
+	}
+}
+
+uint32_t Renderer::GeometryPool::Allocate(uint32_t InCount)
+{
+	uint32_t lOffset = mAllocator.Allocate(InCount);
+	if (lOffset == GeometryAllocator::INVALID_OFFSET)
+	{
+		//At least half again,so a stream of small loads resizes a logarithmic number of times.
+		Grow(GetGrownCapacity(mAllocator.GetCapacity(), std::max<uint64_t>(InCount, mAllocator.GetCapacity() / 2), mStride));
+		lOffset = mAllocator.Allocate(InCount);
+	}
+	Ensures(lOffset != GeometryAllocator::INVALID_OFFSET);
+	return lOffset;
+}
+
+void Renderer::GeometryPool::Upload(uint32_t InOffset, const void* InData, uint32_t InCount)
+{
+	mUploader.Stage(mBuffer->GetResource(), uint64_t(InOffset) * mStride, InData, uint64_t(InCount) * mStride);
+}
+
+void Renderer::GeometryPool::Free(uint32_t InOffset, uint64_t InReleaseAfter)
+{
+	mRetiredRanges.push_back({ InReleaseAfter, InOffset });
+}
+
+void Renderer::GeometryPool::ReleaseRetired(uint64_t InFrame)
+{
+	mFrame = InFrame;
+	std::erase_if(mRetiredRanges, [this, InFrame](const RetiredRange& InRetired)
+		{
+			if (InRetired.mReleaseAfter > InFrame)
+			{
+				return false;
+			}
+			mAllocator.Free(InRetired.mOffset);
+			return true;
+		});
+	std::erase_if(mRetiredBuffers, [InFrame](const RetiredBuffer& InRetired) { return InRetired.mReleaseAfter <= InFrame; });
+}
+
+std::vector<Renderer::GeometryMove> Renderer::GeometryPool::Defragment(uint32_t InMaxMoves, uint64_t InReleaseAfter)
+{
+	auto lMoves = mAllocator.PlanDefragment(InMaxMoves);
+	for (const auto& move : lMoves)
+	{
+		mUploader.Copy(mBuffer->GetResource(), uint64_t(move.mTo) * mStride, mBuffer->GetResource(), uint64_t(move.mFrom) * mStride, uint64_t(move.mCount) * mStride);
+		Free(move.mFrom, InReleaseAfter);
+	}
+	return lMoves;
+}
+
+void Renderer::GeometryPool::Grow(uint32_t InCapacity)
+{
+	auto lBuffer = std::make_unique<Resource::VertexBuffer>();
+	lBuffer->Create(mName, InCapacity, mStride);
+	//Staged writes into the old buffer have to land before it is copied,and the copy before the new one is handed out.
+	mUploader.Flush();
+	mUploader.Copy(lBuffer->GetResource(), 0, mBuffer->GetResource(), 0, uint64_t(mAllocator.GetCapacity()) * mStride);
+	mUploader.Flush();
+	//A frame recorded before the swap may still bind the old buffer.
+	mRetiredBuffers.push_back({ mFrame + SWAP_CHAIN_BUFFER_COUNT + 1, std::move(mBuffer) });
+	mBuffer = std::move(lBuffer);
+	mAllocator.Grow(InCapacity);
+	mGrows++;
+}
+
+D3D12_VERTEX_BUFFER_VIEW Renderer::GeometryPool::GetVertexBufferView() const
+{
+	return mBuffer->VertexBufferView();
+}
+
+D3D12_INDEX_BUFFER_VIEW Renderer::GeometryPool::GetIndexBufferView() const
+{
+	Expects(mStride == sizeof(uint16_t) || mStride == sizeof(uint32_t));
+	return mBuffer->IndexBufferView(0, (uint32_t)mBuffer->GetBufferSize(), mStride == sizeof(uint32_t));
+}
+
+Renderer::GeometryPoolStats Renderer::GeometryPool::GetStats() const
+{
+	GeometryPoolStats lStats;
+	lStats.mAllocator = mAllocator.GetStats();
+	lStats.mStride = mStride;
+	lStats.mBufferBytes = mBuffer->GetBufferSize();
+	lStats.mGrows = mGrows;
+	return lStats;
+}
+
+uint32_t Renderer::GeometryPool::GetPageCapacity(uint32_t InStride)
+{
+	return PageElements(1, InStride);
+}
+
+uint32_t Renderer::GeometryPool::GetGrownCapacity(uint32_t InCapacity, uint64_t InCount, uint32_t InStride)
+{
+	const uint64_t lBytes = (uint64_t(InCapacity) + WithSlack(InCount)) * InStride;
+	return PageElements((lBytes + PAGE_BYTES - 1) / PAGE_BYTES, InStride);
+}
+
+uint32_t Renderer::GeometryPool::GetReservedCapacity(const GeometryAllocator& InAllocator, uint64_t InCount, uint32_t InStride)
+{
+	//The whole reservation has to fit one free block with the slack.
+	if (InCount == 0 || WithSlack(InCount) <= InAllocator.GetStats().mLargestFree)
+	{
+		return InAllocator.GetCapacity();
+	}
+	return GetGrownCapacity(InAllocator.GetCapacity(), InCount, InStride);
+}
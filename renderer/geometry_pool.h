@@ -0,0 +1,109 @@
+#pragma once
+#include "geometry_allocator.h"
+#include "staging_ring.h"
+
+namespace ECS
+{
+	struct StaticMeshAsset;
+}
+
+namespace Renderer
+{
+	//Meshes with fewer vertices than this index into the 16 bit pool.
+	constexpr size_t MAX_16BIT_INDEX_VERTICES = 1 << 16;
+
+	inline bool Uses16BitIndices(size_t InVertexCount) { return InVertexCount < MAX_16BIT_INDEX_VERTICES; }
+
+	//Elements a batch of meshes needs in each geometry pool.
+	struct GeometryDemand
+	{
+		uint64_t mVertices = 0;
+		uint64_t mIndices = 0;
+		uint64_t mIndices16 = 0;
+
+		void Add(const ECS::StaticMeshAsset& InAsset);
+	};
+
+	struct GeometryPoolStats
+	{
+		GeometryAllocatorStats mAllocator;
+		uint32_t mStride = 0;
+		uint64_t mBufferBytes = 0;
+		uint32_t mGrows = 0;
+	};
+
+	//Shared GPU buffer of fixed stride elements,sub-allocated by a GeometryAllocator.
+	//Starts at one page and grows in whole pages:a larger buffer is created,the old one copied over on the copy queue
+	//and kept alive until the frames that may still bind it completed.Ranges are freed the same way.
+	//Not thread safe,the owner serializes every call.
+	class GeometryPool
+	{
+	public:
+		static constexpr uint64_t PAGE_BYTES = 4ull * 1024 * 1024;
+
+		GeometryPool(const std::wstring& InName, uint32_t InStride, StagingUploader& InUploader);
+
+		~GeometryPool();
+
+		//Grow so InCount more elements fit without another resize,e.g. the whole of a scene before loading it.
+		void Reserve(uint64_t InCount);
+
+		//Offset of InCount elements,grows the buffer when no free block fits.
+		uint32_t Allocate(uint32_t InCount);
+
+		//Stage InCount elements at InOffset,part of the next uploader flush.
+		void Upload(uint32_t InOffset, const void* InData, uint32_t InCount);
+
+		//The range is reused once ReleaseRetired reaches InReleaseAfter.
+		void Free(uint32_t InOffset, uint64_t InReleaseAfter);
+
+		//Free what was retired up to InFrame,InFrame also dates the buffers replaced by later grows.
+		void ReleaseRetired(uint64_t InFrame);
+
+		//Copy up to InMaxMoves allocations into lower holes,the sources retire at InReleaseAfter.
+		//The copies are recorded only,flush the uploader before drawing from the new offsets.
+		std::vector<GeometryMove> Defragment(uint32_t InMaxMoves, uint64_t InReleaseAfter);
+
+		D3D12_VERTEX_BUFFER_VIEW GetVertexBufferView() const;
+
+		//16 or 32 bit by the stride.
+		D3D12_INDEX_BUFFER_VIEW GetIndexBufferView() const;
+
+		GeometryPoolStats GetStats() const;
+
+		//Elements in one page,every pool starts at one.
+		static uint32_t GetPageCapacity(uint32_t InStride);
+
+		//Capacity after adding at least InCount elements to InCapacity,whole pages with room for the TLSF rounding.
+		static uint32_t GetGrownCapacity(uint32_t InCapacity, uint64_t InCount, uint32_t InStride);
+
+		//Capacity Reserve(InCount) resizes InAllocator to,the current one when InCount more elements fit already.
+		static uint32_t GetReservedCapacity(const GeometryAllocator& InAllocator, uint64_t InCount, uint32_t InStride);
+
+	private:
+		//Resize to InCapacity elements.
+		void Grow(uint32_t InCapacity);
+
+		struct RetiredRange
+		{
+			uint64_t mReleaseAfter;
+			uint32_t mOffset;
+		};
+
+		struct RetiredBuffer
+		{
+			uint64_t mReleaseAfter;
+			std::unique_ptr<Resource::VertexBuffer> mBuffer;
+		};
+
+		std::wstring mName;
+		uint32_t mStride;
+		StagingUploader& mUploader;
+		std::unique_ptr<Resource::VertexBuffer> mBuffer;
+		GeometryAllocator mAllocator;
+		std::vector<RetiredRange> mRetiredRanges;
+		std::vector<RetiredBuffer> mRetiredBuffers;
+		uint64_t mFrame = 0;
+		uint32_t mGrows = 0;
+	};
+}
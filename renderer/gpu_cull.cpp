@@ -0,0 +1,341 @@
+#include "gpu_cull.h"
+
+using namespace DirectX;
+
+namespace
+{
+	XMFLOAT4 TransformCorner(const XMFLOAT4* InRows, float InX, float InY, float InZ)
+	{
+		//Same operation order as the shader,no fused multiply adds there either.
+		return XMFLOAT4(
+			InX * InRows[0].x + InY * InRows[1].x + InZ * InRows[2].x + InRows[3].x,
+			InX * InRows[0].y + InY * InRows[1].y + InZ * InRows[2].y + InRows[3].y,
+			InX * InRows[0].z + InY * InRows[1].z + InZ * InRows[2].z + InRows[3].z,
+			InX * InRows[0].w + InY * InRows[1].w + InZ * InRows[2].w + InRows[3].w);
+	}
+
+	XMFLOAT4 BoxCorner(const XMFLOAT4* InRows, const Renderer::GpuInstance& InInstance, uint32_t InCorner)
+	{
+		const float lX = InInstance.mBoundsCenter.x + ((InCorner & 1) ? InInstance.mBoundsExtents.x : -InInstance.mBoundsExtents.x);
+		const float lY = InInstance.mBoundsCenter.y + ((InCorner & 2) ? InInstance.mBoundsExtents.y : -InInstance.mBoundsExtents.y);
+		const float lZ = InInstance.mBoundsCenter.z + ((InCorner & 4) ? InInstance.mBoundsExtents.z : -InInstance.mBoundsExtents.z);
+		return TransformCorner(InRows, lX, lY, lZ);
+	}
+
+	uint32_t LevelWidth(uint32_t InWidth, uint32_t InLevel)
+	{
+		for (uint32_t i = 0; i < InLevel; ++i)
+		{
+			InWidth = (InWidth + 1) / 2;
+		}
+		return InWidth;
+	}
+}
+
+Renderer::GpuInstanceTable::GpuInstanceTable()
+{
+
+}
+
+Renderer::GpuInstanceTable::~GpuInstanceTable()
+{
+
+}
+
+void Renderer::GpuInstanceTable::Begin()
+{
+	mCursor = 0;
+}
+
+void Renderer::GpuInstanceTable::Add(const GpuInstance& InInstance)
+{
+	if (mCursor < mInstances.size())
+	{
+		if (std::memcmp(&mInstances[mCursor], &InInstance, sizeof(GpuInstance)) == 0)
+		{
+			mCursor++;
+			return;
+		}
+		mInstances[mCursor] = InInstance;
+	}
+	else
+	{
+		mInstances.push_back(InInstance);
+	}
+	if (IsDirty())
+	{
+		mDirtyBegin = std::min(mDirtyBegin, mCursor);
+		mDirtyEnd = std::max(mDirtyEnd, mCursor + 1);
+	}
+	else
+	{
+		mDirtyBegin = mCursor;
+		mDirtyEnd = mCursor + 1;
+	}
+	mCursor++;
+}
+
+void Renderer::GpuInstanceTable::End()
+{
+	//Draws past the instance count are never read,shrinking needs no upload.
+	mInstances.resize(mCursor);
+	mDirtyEnd = std::min(mDirtyEnd, mCursor);
+	mDirtyBegin = std::min(mDirtyBegin, mDirtyEnd);
+}
+
+void Renderer::GpuInstanceTable::MarkAllDirty()
+{
+	mDirtyBegin = 0;
+	mDirtyEnd = (uint32_t)mInstances.size();
+}
+
+void Renderer::GpuInstanceTable::ClearDirty()
+{
+	mDirtyBegin = 0;
+	mDirtyEnd = 0;
+}
+
+Renderer::GpuCullReference::GpuCullReference()
+{
+
+}
+
+Renderer::GpuCullReference::~GpuCullReference()
+{
+
+}
+
+uint32_t Renderer::GpuCullReference::InitHiZLayout(GpuCullConstants& InOutConstants, uint32_t InDepthWidth, uint32_t InDepthHeight)
+{
+	Expects(InDepthWidth > 0 && InDepthHeight > 0);
+	InOutConstants.mDepthWidth = InDepthWidth;
+	InOutConstants.mDepthHeight = InDepthHeight;
+	InOutConstants.mHiZWidth = (InDepthWidth + HIZ_TILE_SIZE - 1) / HIZ_TILE_SIZE;
+	InOutConstants.mHiZHeight = (InDepthHeight + HIZ_TILE_SIZE - 1) / HIZ_TILE_SIZE;
+
+	uint32_t lWidth = InOutConstants.mHiZWidth;
+	uint32_t lHeight = InOutConstants.mHiZHeight;
+	uint32_t lTexels = 0;
+	uint32_t lLevels = 0;
+	while (lLevels < GpuCullConstants::MAX_HIZ_LEVELS)
+	{
+		InOutConstants.mHiZOffsets[lLevels++] = lTexels;
+		lTexels += lWidth * lHeight;
+		if (lWidth == 1 && lHeight == 1)
+		{
+			break;
+		}
+		lWidth = (lWidth + 1) / 2;
+		lHeight = (lHeight + 1) / 2;
+	}
+	InOutConstants.mHiZLevels = lLevels;
+	for (uint32_t i = lLevels; i < GpuCullConstants::MAX_HIZ_LEVELS; ++i)
+	{
+		InOutConstants.mHiZOffsets[i] = lTexels;
+	}
+	return lTexels;
+}
+
+void Renderer::GpuCullReference::BuildHiZ(const GpuCullConstants& InConstants, std::span<const float> InDepth, std::vector<float>& OutHiZ)
+{
+	Expects(InDepth.size() == size_t(InConstants.mDepthWidth) * InConstants.mDepthHeight);
+	Expects(InConstants.mHiZLevels > 0);
+	OutHiZ.resize(InConstants.mHiZOffsets[InConstants.mHiZLevels - 1] + 1);
+
+	//Level 0:the farthest depth of each tile,tiles on the right and bottom edge are cut off by the image.
+	for (uint32_t y = 0; y < InConstants.mHiZHeight; ++y)
+	{
+		for (uint32_t x = 0; x < InConstants.mHiZWidth; ++x)
+		{
+			const uint32_t lX1 = std::min((x + 1) * HIZ_TILE_SIZE, InConstants.mDepthWidth);
+			const uint32_t lY1 = std::min((y + 1) * HIZ_TILE_SIZE, InConstants.mDepthHeight);
+			float lFarthest = 1.0f;
+			for (uint32_t py = y * HIZ_TILE_SIZE; py < lY1; ++py)
+			{
+				for (uint32_t px = x * HIZ_TILE_SIZE; px < lX1; ++px)
+				{
+					lFarthest = std::min(lFarthest, InDepth[size_t(py) * InConstants.mDepthWidth + px]);
+				}
+			}
+			OutHiZ[size_t(y) * InConstants.mHiZWidth + x] = lFarthest;
+		}
+	}
+
+	uint32_t lSrcWidth = InConstants.mHiZWidth;
+	uint32_t lSrcHeight = InConstants.mHiZHeight;
+	for (uint32_t level = 1; level < InConstants.mHiZLevels; ++level)
+	{
+		const uint32_t lWidth = (lSrcWidth + 1) / 2;
+		const uint32_t lHeight = (lSrcHeight + 1) / 2;
+		const float* lSrc = OutHiZ.data() + InConstants.mHiZOffsets[level - 1];
+		float* lDst = OutHiZ.data() + InConstants.mHiZOffsets[level];
+		for (uint32_t y = 0; y < lHeight; ++y)
+		{
+			for (uint32_t x = 0; x < lWidth; ++x)
+			{
+				const uint32_t lX1 = std::min(x * 2 + 1, lSrcWidth - 1);
+				const uint32_t lY1 = std::min(y * 2 + 1, lSrcHeight - 1);
+				float lFarthest = std::min(lSrc[size_t(y * 2) * lSrcWidth + x * 2], lSrc[size_t(y * 2) * lSrcWidth + lX1]);
+				lFarthest = std::min(lFarthest, std::min(lSrc[size_t(lY1) * lSrcWidth + x * 2], lSrc[size_t(lY1) * lSrcWidth + lX1]));
+				lDst[size_t(y) * lWidth + x] = lFarthest;
+			}
+		}
+		lSrcWidth = lWidth;
+		lSrcHeight = lHeight;
+	}
+}
+
+bool Renderer::GpuCullReference::IsFrustumCulled(const GpuCullConstants& InConstants, const GpuInstance& InInstance)
+{
+	//Culled when all corners are outside of the same plane.
+	uint32_t lAllOutside = InConstants.mClipPlanes;
+	for (uint32_t corner = 0; corner < 8; ++corner)
+	{
+		const XMFLOAT4 lClip = BoxCorner(InConstants.mViewPrj, InInstance, corner);
+		uint32_t lOutside = 0;
+		lOutside |= lClip.x < -lClip.w ? 0x1u : 0u;
+		lOutside |= lClip.x > lClip.w ? 0x2u : 0u;
+		lOutside |= lClip.y < -lClip.w ? 0x4u : 0u;
+		lOutside |= lClip.y > lClip.w ? 0x8u : 0u;
+		lOutside |= lClip.z > lClip.w ? GPU_CULL_NEAR_PLANE : 0u;
+		lAllOutside &= lOutside;
+	}
+	return lAllOutside != 0;
+}
+
+bool Renderer::GpuCullReference::IsOcclusionCulled(const GpuCullConstants& InConstants, const GpuInstance& InInstance, std::span<const float> InHiZ)
+{
+	float lMinX = FLT_MAX;
+	float lMinY = FLT_MAX;
+	float lMaxX = -FLT_MAX;
+	float lMaxY = -FLT_MAX;
+	float lNearest = 0.0f;
+	for (uint32_t corner = 0; corner < 8; ++corner)
+	{
+		const XMFLOAT4 lClip = BoxCorner(InConstants.mOcclusionViewPrj, InInstance, corner);
+		//Crosses the near plane of the view the Hi-Z was rendered from.
+		if (lClip.z > lClip.w)
+		{
+			return false;
+		}
+		const float lInvW = 1.0f / lClip.w;
+		const float lX = (lClip.x * lInvW * 0.5f + 0.5f) * InConstants.mDepthWidth;
+		const float lY = (0.5f - lClip.y * lInvW * 0.5f) * InConstants.mDepthHeight;
+		lMinX = std::min(lMinX, lX);
+		lMaxX = std::max(lMaxX, lX);
+		lMinY = std::min(lMinY, lY);
+		lMaxY = std::max(lMaxY, lY);
+		lNearest = std::max(lNearest, lClip.z * lInvW);
+	}
+	//Nothing of the Hi-Z to test against,the frustum test decides.
+	if (lMaxX < 0.0f || lMaxY < 0.0f || lMinX >= (float)InConstants.mDepthWidth || lMinY >= (float)InConstants.mDepthHeight)
+	{
+		return false;
+	}
+
+	const uint32_t lTileX0 = (uint32_t)std::floor(std::max(lMinX, 0.0f)) / HIZ_TILE_SIZE;
+	const uint32_t lTileY0 = (uint32_t)std::floor(std::max(lMinY, 0.0f)) / HIZ_TILE_SIZE;
+	const uint32_t lTileX1 = (uint32_t)std::floor(std::min(lMaxX, float(InConstants.mDepthWidth - 1))) / HIZ_TILE_SIZE;
+	const uint32_t lTileY1 = (uint32_t)std::floor(std::min(lMaxY, float(InConstants.mDepthHeight - 1))) / HIZ_TILE_SIZE;
+
+	//The finest level the rectangle covers at most 2x2 texels of.
+	uint32_t lLevel = 0;
+	while (lLevel + 1 < InConstants.mHiZLevels &&
+		((lTileX1 >> lLevel) - (lTileX0 >> lLevel) > 1 || (lTileY1 >> lLevel) - (lTileY0 >> lLevel) > 1))
+	{
+		lLevel++;
+	}
+
+	const uint32_t lWidth = LevelWidth(InConstants.mHiZWidth, lLevel);
+	const float* lHiZ = InHiZ.data() + InConstants.mHiZOffsets[lLevel];
+	for (uint32_t y = lTileY0 >> lLevel; y <= (lTileY1 >> lLevel); ++y)
+	{
+		for (uint32_t x = lTileX0 >> lLevel; x <= (lTileX1 >> lLevel); ++x)
+		{
+			if (lHiZ[size_t(y) * lWidth + x] <= lNearest)
+			{
+				return false;
+			}
+		}
+	}
+	return true;
+}
+
+Renderer::IndirectDraw Renderer::GpuCullReference::MakeDraw(const GpuCullConstants& InConstants, const GpuInstance& InInstance, uint32_t InInstanceIndex)
+{
+	IndirectDraw lDraw = {};
+	lDraw.mIndexBuffer = InConstants.mIndexBuffers[(InInstance.mFlags & GPU_INSTANCE_16BIT_INDICES) ? 1 : 0];
+	lDraw.mObject = InInstance.mObject;
+	lDraw.mMaterial = InInstance.mMaterial;
+	lDraw.mDraw.IndexCountPerInstance = InInstance.mIndexCount;
+	lDraw.mDraw.InstanceCount = 1;
+	lDraw.mDraw.StartIndexLocation = InInstance.mStartIndexLocation;
+	lDraw.mDraw.BaseVertexLocation = InInstance.mBaseVertexLocation;
+	lDraw.mDraw.StartInstanceLocation = InInstanceIndex;
+	return lDraw;
+}
+
+void Renderer::GpuCullReference::Cull(const GpuCullConstants& InConstants, std::span<const GpuInstance> InInstances, std::span<const float> InHiZ)
+{
+	Expects(InInstances.size() >= InConstants.mInstanceCount);
+	mCounts = {};
+	mDraws.clear();
+	for (uint32_t i = 0; i < InConstants.mInstanceCount; ++i)
+	{
+		const GpuInstance& lInstance = InInstances[i];
+		if ((lInstance.mFlags & InConstants.mPassFlag) == 0)
+		{
+			continue;
+		}
+		mCounts.mTested++;
+		if (IsFrustumCulled(InConstants, lInstance))
+		{
+			mCounts.mFrustumCulled++;
+		}
+		else if (InConstants.mUseOcclusion && IsOcclusionCulled(InConstants, lInstance, InHiZ))
+		{
+			mCounts.mOcclusionCulled++;
+		}
+		else
+		{
+			mDraws.push_back(MakeDraw(InConstants, lInstance, i));
+		}
+	}
+	mCounts.mDraws = (uint32_t)mDraws.size();
+}
+
+uint32_t Renderer::GpuCullReference::Compare(const GpuCullCounts& InGpuCounts, std::span<const IndirectDraw> InGpuDraws)
+{
+	mCountsMatch = InGpuCounts == mCounts;
+	mSortedGpuDraws.assign(InGpuDraws.begin(), InGpuDraws.end());
+	std::sort(mSortedGpuDraws.begin(), mSortedGpuDraws.end(), [](const IndirectDraw& InA, const IndirectDraw& InB)
+		{
+			return InA.mDraw.StartInstanceLocation < InB.mDraw.StartInstanceLocation;
+		});
+
+	mMismatchedDraws = 0;
+	size_t lGpu = 0;
+	size_t lReference = 0;
+	while (lGpu < mSortedGpuDraws.size() && lReference < mDraws.size())
+	{
+		const uint32_t lGpuInstance = mSortedGpuDraws[lGpu].mDraw.StartInstanceLocation;
+		const uint32_t lReferenceInstance = mDraws[lReference].mDraw.StartInstanceLocation;
+		if (lGpuInstance == lReferenceInstance)
+		{
+			if (std::memcmp(&mSortedGpuDraws[lGpu], &mDraws[lReference], sizeof(IndirectDraw)) != 0)
+			{
+				mMismatchedDraws++;
+			}
+			lGpu++;
+			lReference++;
+		}
+		else
+		{
+			//Drawn by only one of them.
+			mMismatchedDraws++;
+			lGpuInstance < lReferenceInstance ? lGpu++ : lReference++;
+		}
+	}
+	mMismatchedDraws += uint32_t(mSortedGpuDraws.size() - lGpu + mDraws.size() - lReference);
+	return mMismatchedDraws;
+}
@@ -0,0 +1,183 @@
+#pragma once
+#include "draw_packet.h"
+
+namespace Renderer
+{
+	//GpuInstance::mFlags.
+	//Drawn by the depth prepass and the color pass.
+	constexpr uint32_t GPU_INSTANCE_CAMERA = 0x1;
+	constexpr uint32_t GPU_INSTANCE_SHADOW_CASTER = 0x2;
+	//Indexes the 16 bit index buffer instead of the 32 bit one.
+	constexpr uint32_t GPU_INSTANCE_16BIT_INDICES = 0x4;
+
+	//GpuCullConstants::mClipPlanes,planes a box has to be fully outside of to be culled.
+	constexpr uint32_t GPU_CULL_SIDE_PLANES = 0xf;
+	//Reversed Z near plane,the shadow pass keeps casters between the light and its frustum.
+	constexpr uint32_t GPU_CULL_NEAR_PLANE = 0x10;
+
+	//One submesh draw of the persistent instance buffer,GpuInstance in InstanceCull.hlsl.
+	struct GpuInstance
+	{
+		//Copied into the draw arguments as is.
+		OjbectData mObject;
+		uint32_t mMaterial;
+		//World space bounds.
+		DirectX::XMFLOAT3 mBoundsCenter;
+		uint32_t mFlags;
+		DirectX::XMFLOAT3 mBoundsExtents;
+		uint32_t mIndexCount;
+		uint32_t mStartIndexLocation;
+		int32_t mBaseVertexLocation;
+		uint32_t mPadding[2];
+	};
+	static_assert(sizeof(GpuInstance) == 128);
+
+	//One ExecuteIndirect command:index buffer,root constants of ROOT_PARA_COMPONENT_DATA and ROOT_PARA_DRAW_DATA,then the draw.
+	//StartInstanceLocation holds the instance index,so GPU and reference draws can be matched up.
+	struct IndirectDraw
+	{
+		D3D12_INDEX_BUFFER_VIEW mIndexBuffer;
+		OjbectData mObject;
+		uint32_t mMaterial;
+		D3D12_DRAW_INDEXED_ARGUMENTS mDraw;
+		uint32_t mPadding;
+	};
+	static_assert(sizeof(IndirectDraw) == 120);
+
+	//Head of every per pass argument buffer,the draws follow it.mDraws is the ExecuteIndirect count.
+	struct GpuCullCounts
+	{
+		uint32_t mDraws = 0;
+		uint32_t mTested = 0;
+		uint32_t mFrustumCulled = 0;
+		uint32_t mOcclusionCulled = 0;
+
+		bool operator==(const GpuCullCounts&) const = default;
+	};
+	static_assert(sizeof(GpuCullCounts) == 16);
+
+	//Constants of one culling or Hi-Z dispatch,GpuCullConstants in InstanceCull.hlsl.
+	struct GpuCullConstants
+	{
+		//Enough for a 16K depth buffer.
+		static constexpr uint32_t MAX_HIZ_LEVELS = 12;
+
+		//Rows of a row vector matrix,clip = x * row0 + y * row1 + z * row2 + row3.
+		DirectX::XMFLOAT4 mViewPrj[4];
+		//The view projection the Hi-Z was rendered with.
+		DirectX::XMFLOAT4 mOcclusionViewPrj[4];
+		//32 and 16 bit index buffer.
+		D3D12_INDEX_BUFFER_VIEW mIndexBuffers[2];
+		uint32_t mInstanceCount;
+		//Instance flag a draw needs for the pass.
+		uint32_t mPassFlag;
+		uint32_t mClipPlanes;
+		uint32_t mUseOcclusion;
+		uint32_t mDepthWidth;
+		uint32_t mDepthHeight;
+		//Level 0,every further level halves it rounding up.
+		uint32_t mHiZWidth;
+		uint32_t mHiZHeight;
+		uint32_t mHiZLevels;
+		uint32_t mPadding[3];
+		//First texel of each level in the Hi-Z buffer.
+		uint32_t mHiZOffsets[MAX_HIZ_LEVELS];
+	};
+	static_assert(sizeof(GpuCullConstants) == 256);
+
+	struct GpuCullStats
+	{
+		uint32_t mInstances = 0;
+		//Instance records copied to the GPU in the last frame.
+		uint32_t mUploadedInstances = 0;
+		//Of the frame that last used the frame slot,read back once it completed.
+		std::array<GpuCullCounts, (size_t)DrawPass::COUNT> mPasses;
+		//Filled by validation against the C++ reference.
+		uint32_t mMismatchedDraws = 0;
+		uint32_t mMismatchedCounts = 0;
+	};
+
+	//CPU copy of the persistent instance buffer.Rewritten in full every frame,but only the records that changed
+	//since the last upload are copied to the GPU,so static scenes upload nothing.
+	class GpuInstanceTable
+	{
+	public:
+		GpuInstanceTable();
+
+		~GpuInstanceTable();
+
+		void Begin();
+
+		void Add(const GpuInstance& InInstance);
+
+		//Drop the records past the last Add.
+		void End();
+
+		std::span<const GpuInstance> GetInstances() const { return mInstances; }
+
+		bool IsDirty() const { return mDirtyBegin < mDirtyEnd; }
+
+		//Instances [GetDirtyBegin,GetDirtyEnd) changed since ClearDirty.
+		uint32_t GetDirtyBegin() const { return mDirtyBegin; }
+		uint32_t GetDirtyEnd() const { return mDirtyEnd; }
+
+		//The GPU buffer was replaced,upload everything again.
+		void MarkAllDirty();
+
+		void ClearDirty();
+
+	private:
+		std::vector<GpuInstance> mInstances;
+		uint32_t mCursor = 0;
+		uint32_t mDirtyBegin = 0;
+		uint32_t mDirtyEnd = 0;
+	};
+
+	//C++ port of InstanceCull.hlsl:the same tests in the same order on the same data,
+	//so culling and compaction can be checked against the GPU and measured without a device.
+	//Depth follows the renderer convention:reversed Z,0 is the far plane.
+	class GpuCullReference
+	{
+	public:
+		static constexpr uint32_t HIZ_TILE_SIZE = 8;
+
+		GpuCullReference();
+
+		~GpuCullReference();
+
+		//Fill the depth size and Hi-Z layout of InOutConstants,returns the texels of all levels.
+		static uint32_t InitHiZLayout(GpuCullConstants& InOutConstants, uint32_t InDepthWidth, uint32_t InDepthHeight);
+
+		//BuildHiZ and DownsampleHiZ,InDepth holds the minimum of each pixel's samples.
+		static void BuildHiZ(const GpuCullConstants& InConstants, std::span<const float> InDepth, std::vector<float>& OutHiZ);
+
+		static bool IsFrustumCulled(const GpuCullConstants& InConstants, const GpuInstance& InInstance);
+
+		static bool IsOcclusionCulled(const GpuCullConstants& InConstants, const GpuInstance& InInstance, std::span<const float> InHiZ);
+
+		static IndirectDraw MakeDraw(const GpuCullConstants& InConstants, const GpuInstance& InInstance, uint32_t InInstanceIndex);
+
+		//Cull every instance for the pass of InConstants and compact the visible ones in instance order.
+		//InHiZ is only read when InConstants.mUseOcclusion is set.
+		void Cull(const GpuCullConstants& InConstants, std::span<const GpuInstance> InInstances, std::span<const float> InHiZ);
+
+		//Diff against what the GPU wrote,its draws are appended in any order.Returns the mismatched draws.
+		uint32_t Compare(const GpuCullCounts& InGpuCounts, std::span<const IndirectDraw> InGpuDraws);
+
+		const GpuCullCounts& GetCounts() const { return mCounts; }
+
+		std::span<const IndirectDraw> GetDraws() const { return mDraws; }
+
+		uint32_t GetMismatchedDraws() const { return mMismatchedDraws; }
+
+		bool CountsMatch() const { return mCountsMatch; }
+
+	private:
+		GpuCullCounts mCounts;
+		std::vector<IndirectDraw> mDraws;
+		//Scratch:GPU draws in instance order.
+		std::vector<IndirectDraw> mSortedGpuDraws;
+		uint32_t mMismatchedDraws = 0;
+		bool mCountsMatch = true;
+	};
+}
@@ -0,0 +1,161 @@
+#include "gpu_cull_pass.h"
+#include "components.h"
+
+
+
+Renderer::GpuCullPass::GpuCullPass(std::shared_ptr<RendererContext> InGraphicsContext, ID3D12RootSignature* InDrawRootSignature):
+	BaseRenderPass("", "", InGraphicsContext)
+{
+	mVertexShader = Utils::ReadShader("InstanceCull.hlsl", "CullInstances", "cs_6_5");
+	mClearShader = Utils::ReadShader("InstanceCull.hlsl", "ClearDrawCounts", "cs_6_5");
+	mBuildHiZShader = Utils::ReadShader("InstanceCull.hlsl", "BuildHiZ", "cs_6_5");
+	mDownsampleHiZShader = Utils::ReadShader("InstanceCull.hlsl", "DownsampleHiZ", "cs_6_5");
+	CreateRS();
+	CreatePipelineState();
+
+	//Matches IndirectDraw:index buffer,object and material root constants,then the draw.
+	D3D12_INDIRECT_ARGUMENT_DESC lDrawArgs[4] = {};
+	lDrawArgs[0].Type = D3D12_INDIRECT_ARGUMENT_TYPE_INDEX_BUFFER_VIEW;
+	lDrawArgs[1].Type = D3D12_INDIRECT_ARGUMENT_TYPE_CONSTANT;
+	lDrawArgs[1].Constant.RootParameterIndex = ROOT_PARA_COMPONENT_DATA;
+	lDrawArgs[1].Constant.Num32BitValuesToSet = sizeof(OjbectData) / sizeof(uint32_t);
+	lDrawArgs[2].Type = D3D12_INDIRECT_ARGUMENT_TYPE_CONSTANT;
+	lDrawArgs[2].Constant.RootParameterIndex = ROOT_PARA_DRAW_DATA;
+	lDrawArgs[2].Constant.Num32BitValuesToSet = 1;
+	lDrawArgs[3].Type = D3D12_INDIRECT_ARGUMENT_TYPE_DRAW_INDEXED;
+	D3D12_COMMAND_SIGNATURE_DESC lSignatureDesc = {};
+	lSignatureDesc.ByteStride = sizeof(IndirectDraw);
+	lSignatureDesc.NumArgumentDescs = (UINT)std::size(lDrawArgs);
+	lSignatureDesc.pArgumentDescs = lDrawArgs;
+	Ensures(g_Device->CreateCommandSignature(&lSignatureDesc, InDrawRootSignature, IID_PPV_ARGS(&mDrawSignature)) == S_OK);
+}
+
+Renderer::GpuCullPass::~GpuCullPass()
+{
+
+}
+
+void Renderer::GpuCullPass::Cull(ID3D12Resource* InArgs, uint32_t InInstances)
+{
+	auto lUavBarrier = CD3DX12_RESOURCE_BARRIER::UAV(nullptr);
+	mGraphicsCmd->SetPipelineState(mClearPipelineState);
+	mGraphicsCmd->Dispatch(1, 1, 1);
+	mGraphicsCmd->ResourceBarrier(1, &lUavBarrier);
+	mGraphicsCmd->SetPipelineState(mPipelineState);
+	mGraphicsCmd->Dispatch((InInstances + CULL_GROUP_SIZE - 1) / CULL_GROUP_SIZE, 1, 1);
+	//The dispatches promoted the arguments to UNORDERED_ACCESS,the counts are copied out for the stats.
+	auto lToArgs = CD3DX12_RESOURCE_BARRIER::Transition(InArgs, D3D12_RESOURCE_STATE_UNORDERED_ACCESS,
+		D3D12_RESOURCE_STATE_INDIRECT_ARGUMENT | D3D12_RESOURCE_STATE_COPY_SOURCE);
+	mGraphicsCmd->ResourceBarrier(1, &lToArgs);
+}
+
+void Renderer::GpuCullPass::BuildHiZ(const GpuCullConstants& InConstants)
+{
+	auto lUavBarrier = CD3DX12_RESOURCE_BARRIER::UAV(nullptr);
+	//A cull before may still read the previous Hi-Z.
+	mGraphicsCmd->ResourceBarrier(1, &lUavBarrier);
+	mGraphicsCmd->SetPipelineState(mBuildHiZPipelineState);
+	mGraphicsCmd->Dispatch((InConstants.mHiZWidth + HIZ_GROUP_SIZE - 1) / HIZ_GROUP_SIZE, (InConstants.mHiZHeight + HIZ_GROUP_SIZE - 1) / HIZ_GROUP_SIZE, 1);
+	mGraphicsCmd->SetPipelineState(mDownsampleHiZPipelineState);
+	uint32_t lWidth = InConstants.mHiZWidth;
+	uint32_t lHeight = InConstants.mHiZHeight;
+	for (uint32_t level = 1; level < InConstants.mHiZLevels; ++level)
+	{
+		lWidth = (lWidth + 1) / 2;
+		lHeight = (lHeight + 1) / 2;
+		mGraphicsCmd->ResourceBarrier(1, &lUavBarrier);
+		mGraphicsCmd->SetComputeRoot32BitConstant(4, level, 0);
+		mGraphicsCmd->Dispatch((lWidth + HIZ_GROUP_SIZE - 1) / HIZ_GROUP_SIZE, (lHeight + HIZ_GROUP_SIZE - 1) / HIZ_GROUP_SIZE, 1);
+	}
+	mGraphicsCmd->ResourceBarrier(1, &lUavBarrier);
+}
+
+void Renderer::GpuCullPass::Draw(ID3D12GraphicsCommandList* InCmdList, ID3D12Resource* InArgs, uint32_t InInstances)
+{
+	if (InInstances == 0)
+	{
+		return;
+	}
+	InCmdList->ExecuteIndirect(mDrawSignature, InInstances, InArgs, DRAW_ARGS_OFFSET, InArgs, 0);
+}
+
+void Renderer::GpuCullPass::RenderScene(ID3D12GraphicsCommandList* InCmdList)
+{
+
+}
+
+void Renderer::GpuCullPass::CreatePipelineState()
+{
+	D3D12_COMPUTE_PIPELINE_STATE_DESC lDesc = {};
+	lDesc.CS = mVertexShader;
+	lDesc.pRootSignature = mRS;
+	g_Device->CreateComputePipelineState(&lDesc, IID_PPV_ARGS(&mPipelineState));
+	mPipelineState->SetName(L"mGpuCullPass");
+
+	lDesc.CS = mClearShader;
+	g_Device->CreateComputePipelineState(&lDesc, IID_PPV_ARGS(&mClearPipelineState));
+	mClearPipelineState->SetName(L"mGpuCullClearPass");
+
+	lDesc.CS = mBuildHiZShader;
+	g_Device->CreateComputePipelineState(&lDesc, IID_PPV_ARGS(&mBuildHiZPipelineState));
+	mBuildHiZPipelineState->SetName(L"mGpuCullBuildHiZPass");
+
+	lDesc.CS = mDownsampleHiZShader;
+	g_Device->CreateComputePipelineState(&lDesc, IID_PPV_ARGS(&mDownsampleHiZPipelineState));
+	mDownsampleHiZPipelineState->SetName(L"mGpuCullDownsampleHiZPass");
+}
+
+void Renderer::GpuCullPass::CreateRS()
+{
+	CD3DX12_ROOT_SIGNATURE_DESC lDesc;
+	D3D12_ROOT_PARAMETER constants = {};
+	constants.ParameterType = D3D12_ROOT_PARAMETER_TYPE_CBV;
+	constants.Descriptor.RegisterSpace = 0;
+	constants.Descriptor.ShaderRegister = 0;
+	constants.ShaderVisibility = D3D12_SHADER_VISIBILITY_ALL;
+
+	D3D12_ROOT_PARAMETER instances = {};
+	instances.ParameterType = D3D12_ROOT_PARAMETER_TYPE_SRV;
+	instances.Descriptor.RegisterSpace = 0;
+	instances.Descriptor.ShaderRegister = 0;
+	instances.ShaderVisibility = D3D12_SHADER_VISIBILITY_ALL;
+
+	D3D12_ROOT_PARAMETER drawArgs = {};
+	drawArgs.ParameterType = D3D12_ROOT_PARAMETER_TYPE_UAV;
+	drawArgs.Descriptor.RegisterSpace = 0;
+	drawArgs.Descriptor.ShaderRegister = 0;
+	drawArgs.ShaderVisibility = D3D12_SHADER_VISIBILITY_ALL;
+
+	D3D12_ROOT_PARAMETER hiZ = {};
+	hiZ.ParameterType = D3D12_ROOT_PARAMETER_TYPE_UAV;
+	hiZ.Descriptor.RegisterSpace = 0;
+	hiZ.Descriptor.ShaderRegister = 1;
+	hiZ.ShaderVisibility = D3D12_SHADER_VISIBILITY_ALL;
+
+	D3D12_ROOT_PARAMETER hiZLevel = {};
+	hiZLevel.ParameterType = D3D12_ROOT_PARAMETER_TYPE_32BIT_CONSTANTS;
+	hiZLevel.Constants.RegisterSpace = 0;
+	hiZLevel.Constants.ShaderRegister = 1;
+	hiZLevel.Constants.Num32BitValues = 1;
+	hiZLevel.ShaderVisibility = D3D12_SHADER_VISIBILITY_ALL;
+
+	CD3DX12_DESCRIPTOR_RANGE depthRange;
+	depthRange.Init(D3D12_DESCRIPTOR_RANGE_TYPE_SRV, 1, 1);
+	CD3DX12_ROOT_PARAMETER sceneDepth;
+	sceneDepth.InitAsDescriptorTable(1, &depthRange);
+
+	std::vector<D3D12_ROOT_PARAMETER> parameters = { constants,instances,drawArgs,hiZ,hiZLevel,sceneDepth };
+	lDesc.Init((UINT)parameters.size(), parameters.data(), 0, nullptr, D3D12_ROOT_SIGNATURE_FLAG_NONE);
+
+	ID3DBlob* signature;
+	ID3DBlob* error;
+	D3D12SerializeRootSignature(&lDesc, D3D_ROOT_SIGNATURE_VERSION_1, &signature, &error);
+	g_Device->CreateRootSignature(0, signature->GetBufferPointer(), signature->GetBufferSize(), IID_PPV_ARGS(&mRS));
+}
+
+void Renderer::GpuCullPass::SetRenderPassStates(ID3D12GraphicsCommandList* InCmdList)
+{
+	mGraphicsCmd = InCmdList;
+	mGraphicsCmd->SetPipelineState(mPipelineState);
+	mGraphicsCmd->SetComputeRootSignature(mRS);
+}
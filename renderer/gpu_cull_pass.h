@@ -0,0 +1,54 @@
+#pragma once
+#include "render_pass.h"
+#include "gpu_cull.h"
+
+
+namespace Renderer
+{
+	//GPU driven drawing:culls the instance buffer into compacted ExecuteIndirect arguments and builds the Hi-Z the culling tests against.
+	//Root parameters:0 GpuCullConstants CBV,1 instance SRV,2 argument UAV,3 Hi-Z UAV,4 Hi-Z level constant,5 depth SRV table.
+	class GpuCullPass final : public BaseRenderPass
+	{
+	public:
+		static constexpr uint32_t CULL_GROUP_SIZE = 64;
+		static constexpr uint32_t HIZ_GROUP_SIZE = 8;
+		//GpuCullCounts come first in every argument buffer.
+		static constexpr uint32_t DRAW_ARGS_OFFSET = sizeof(GpuCullCounts);
+
+		//InDrawRootSignature is the root signature the indirect draws run with.
+		GpuCullPass(std::shared_ptr<RendererContext> InGraphicsContext, ID3D12RootSignature* InDrawRootSignature);
+
+		~GpuCullPass();
+
+		//Bytes of an argument buffer holding up to InInstances draws.
+		static uint32_t GetArgsBytes(uint32_t InInstances) { return DRAW_ARGS_OFFSET + InInstances * (uint32_t)sizeof(IndirectDraw); }
+
+		//Clear the counts of InArgs and cull InInstances instances into it.InArgs is left in INDIRECT_ARGUMENT and COPY_SOURCE.
+		//Set the root parameters before calling.
+		void Cull(ID3D12Resource* InArgs, uint32_t InInstances);
+
+		//Rebuild every Hi-Z level from the bound depth buffer.Set the root parameters before calling.
+		void BuildHiZ(const GpuCullConstants& InConstants);
+
+		//Draw what Cull wrote to InArgs,the states of the pass have to be set on InCmdList.
+		void Draw(ID3D12GraphicsCommandList* InCmdList, ID3D12Resource* InArgs, uint32_t InInstances);
+
+		void RenderScene(ID3D12GraphicsCommandList* InCmdList) override;
+
+		void CreatePipelineState() override;
+
+		void CreateRS() override;
+
+		void SetRenderPassStates(ID3D12GraphicsCommandList* InCmdList) override;
+
+	private:
+		//mPipelineState culls the instances.
+		ID3D12PipelineState* mClearPipelineState = nullptr;
+		ID3D12PipelineState* mBuildHiZPipelineState = nullptr;
+		ID3D12PipelineState* mDownsampleHiZPipelineState = nullptr;
+		ID3D12CommandSignature* mDrawSignature = nullptr;
+		D3D12_SHADER_BYTECODE mClearShader;
+		D3D12_SHADER_BYTECODE mBuildHiZShader;
+		D3D12_SHADER_BYTECODE mDownsampleHiZShader;
+	};
+}
@@ -510,6 +510,39 @@ namespace Renderer
 			CreateDerivedViews(g_Device, Format, 1, NumMips);
 		}
 		
+		D3D12_RESOURCE_DESC ColorBuffer::DescribePlaced(uint32_t Width, uint32_t Height, DXGI_FORMAT Format)
+		{
+			D3D12_RESOURCE_DESC ResourceDesc = DescribeTex2D(Width, Height, 1, 1, Format, CombineResourceFlags());
+			ResourceDesc.SampleDesc.Count = m_SampleCount;
+			ResourceDesc.SampleDesc.Quality = 0;
+			return ResourceDesc;
+		}
+
+		void ColorBuffer::CreatePlaced(const std::wstring& Name, uint32_t Width, uint32_t Height, DXGI_FORMAT Format,
+			ID3D12Heap* Heap, uint64_t HeapOffset)
+		{
+			Destroy();
+			D3D12_RESOURCE_DESC ResourceDesc = DescribePlaced(Width, Height, Format);
+
+			D3D12_CLEAR_VALUE ClearValue = {};
+			ClearValue.Format = Format;
+			ClearValue.Color[0] = m_ClearColor.R();
+			ClearValue.Color[1] = m_ClearColor.G();
+			ClearValue.Color[2] = m_ClearColor.B();
+			ClearValue.Color[3] = m_ClearColor.A();
+
+			Ensures(g_Device->CreatePlacedResource(Heap, HeapOffset, &ResourceDesc, D3D12_RESOURCE_STATE_COMMON, &ClearValue, MY_IID_PPV_ARGS(&m_pResource)) == S_OK);
+			m_UsageState = D3D12_RESOURCE_STATE_COMMON;
+			m_GpuVirtualAddress = D3D12_GPU_VIRTUAL_ADDRESS_NULL;
+
+#ifndef RELEASE
+			m_pResource->SetName(Name.c_str());
+#else
+			(Name);
+#endif
+			CreateDerivedViews(g_Device, Format, 1, 1);
+		}
+
 		void ColorBuffer::CreateArray(const std::wstring& Name, uint32_t Width, uint32_t Height, uint32_t ArrayCount,
 			DXGI_FORMAT Format, D3D12_GPU_VIRTUAL_ADDRESS VidMem)
 		{
@@ -872,12 +905,74 @@ namespace Renderer
 			return static_cast<uint8_t*>(Memory);
 		}
 
+		uint8_t* UploadBuffer::MapPersistent()
+		{
+			void* Memory;
+			//Empty read range,the CPU never reads write combined memory back.
+			auto range = CD3DX12_RANGE(0, 0);
+			m_pResource->Map(0, &range, &Memory);
+			return static_cast<uint8_t*>(Memory);
+		}
+
 		void UploadBuffer::Unmap(size_t begin /*= 0*/, size_t end /*= -1*/)
 		{
 			auto range = CD3DX12_RANGE(begin, std::min(end, m_BufferSize));
 			m_pResource->Unmap(0, &range);
 		}
 
+		void ReadbackBuffer::Create(const std::wstring& name, size_t BufferSize)
+		{
+			Destroy();
+
+			m_BufferSize = BufferSize;
+
+			D3D12_HEAP_PROPERTIES HeapProps;
+			HeapProps.Type = D3D12_HEAP_TYPE_READBACK;
+			HeapProps.CPUPageProperty = D3D12_CPU_PAGE_PROPERTY_UNKNOWN;
+			HeapProps.MemoryPoolPreference = D3D12_MEMORY_POOL_UNKNOWN;
+			HeapProps.CreationNodeMask = 1;
+			HeapProps.VisibleNodeMask = 1;
+
+			D3D12_RESOURCE_DESC ResourceDesc = {};
+			ResourceDesc.Dimension = D3D12_RESOURCE_DIMENSION_BUFFER;
+			ResourceDesc.Width = m_BufferSize;
+			ResourceDesc.Height = 1;
+			ResourceDesc.DepthOrArraySize = 1;
+			ResourceDesc.MipLevels = 1;
+			ResourceDesc.Format = DXGI_FORMAT_UNKNOWN;
+			ResourceDesc.SampleDesc.Count = 1;
+			ResourceDesc.SampleDesc.Quality = 0;
+			ResourceDesc.Layout = D3D12_TEXTURE_LAYOUT_ROW_MAJOR;
+			ResourceDesc.Flags = D3D12_RESOURCE_FLAG_NONE;
+
+			//Readback heaps must start in COPY_DEST.
+			Ensures(g_Device->CreateCommittedResource(&HeapProps, D3D12_HEAP_FLAG_NONE, &ResourceDesc,
+				D3D12_RESOURCE_STATE_COPY_DEST, nullptr, MY_IID_PPV_ARGS(&m_pResource)) == S_OK);
+
+			m_GpuVirtualAddress = m_pResource->GetGPUVirtualAddress();
+
+#ifdef RELEASE
+			(name);
+#else
+			m_pResource->SetName(name.c_str());
+#endif
+		}
+
+		const uint8_t* ReadbackBuffer::Map(size_t InOffset, size_t InReadSize)
+		{
+			void* Memory;
+			auto range = CD3DX12_RANGE(InOffset, InOffset + InReadSize);
+			m_pResource->Map(0, &range, &Memory);
+			return static_cast<const uint8_t*>(Memory);
+		}
+
+		void ReadbackBuffer::Unmap()
+		{
+			//Nothing was written by the CPU.
+			auto range = CD3DX12_RANGE(0, 0);
+			m_pResource->Unmap(0, &range);
+		}
+
 		void DepthBuffer::Create(const std::wstring& Name, uint32_t Width, uint32_t Height, DXGI_FORMAT Format, D3D12_GPU_VIRTUAL_ADDRESS VidMemPtr)
 		{
 			Create(Name, Width, Height, m_SampleCount, Format, VidMemPtr);
@@ -992,6 +1087,28 @@ namespace Renderer
 		//	return (UINT)BitsPerPixel(Format) / 8;
 		//};
 
+		void Texture::Destroy()
+		{
+			GpuResource::Destroy();
+			if (m_OwnsDescriptor && g_DescHeap[D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV])
+			{
+				g_DescHeap[D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV]->Free(m_hCpuDescriptorHandle);
+			}
+			m_OwnsDescriptor = false;
+			m_hCpuDescriptorHandle.ptr = D3D12_GPU_VIRTUAL_ADDRESS_UNKNOWN;
+		}
+
+		void Texture::AllocateDescriptor()
+		{
+			if (m_hCpuDescriptorHandle.ptr == D3D12_GPU_VIRTUAL_ADDRESS_UNKNOWN)
+			{
+				auto [cpuHandle, gpuHandle] = g_DescHeap[D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV]->Allocate();
+				m_hCpuDescriptorHandle = cpuHandle;
+				m_hGpuDescriptorHandle = gpuHandle;
+				m_OwnsDescriptor = true;
+			}
+		}
+
 		void Texture::Create2D(size_t RowPitchBytes, size_t Width, size_t Height, DXGI_FORMAT Format, const void* InitialData)
 		{
 			Destroy();
@@ -1034,13 +1151,7 @@ namespace Renderer
 
 			//CommandContext::InitializeTexture(*this, 1, &texResource);
 
-			if (m_hCpuDescriptorHandle.ptr == D3D12_GPU_VIRTUAL_ADDRESS_UNKNOWN)
-			{
-				auto [cpuHandle, gpuHandle] = g_DescHeap[D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV]->Allocate();
-				m_hCpuDescriptorHandle = cpuHandle;
-				m_hGpuDescriptorHandle = gpuHandle;
-
-			}
+			AllocateDescriptor();
 			g_Device->CreateShaderResourceView(m_pResource, nullptr, m_hCpuDescriptorHandle);
 		}
 
@@ -1085,12 +1196,7 @@ namespace Renderer
 
 			//CommandContext::InitializeTexture(*this, 1, &texResource);
 
-			if (m_hCpuDescriptorHandle.ptr == D3D12_GPU_VIRTUAL_ADDRESS_UNKNOWN)
-			{
-				auto [cpuHandle, gpuHandle] = g_DescHeap[D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV]->Allocate();
-				m_hCpuDescriptorHandle = cpuHandle;
-				m_hGpuDescriptorHandle = gpuHandle;
-			}
+			AllocateDescriptor();
 
 			D3D12_SHADER_RESOURCE_VIEW_DESC srvDesc;
 			srvDesc.Format = Format;
@@ -1178,23 +1284,11 @@ namespace Renderer
 
 
 			ResourceUploadBatch resourceUpload(g_Device);
-			if (m_hCpuDescriptorHandle.ptr == D3D12_GPU_VIRTUAL_ADDRESS_UNKNOWN)
-			{
-				auto [cpuHandle, gpuHandle] = g_DescHeap[D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV]->Allocate();
-				m_hCpuDescriptorHandle = cpuHandle;
-				m_hGpuDescriptorHandle = gpuHandle;
-			}
+			AllocateDescriptor();
 
 
 			resourceUpload.Begin();
 			CreateDDSTextureFromFile(g_Device, resourceUpload, utf8ToUtf16(InFileName).c_str(),&m_pResource);
-			if (m_hCpuDescriptorHandle.ptr == D3D12_GPU_VIRTUAL_ADDRESS_UNKNOWN)
-			{
-				auto [cpuHandle, gpuHandle] = g_DescHeap[D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV]->Allocate();
-				m_hCpuDescriptorHandle = cpuHandle;
-				m_hGpuDescriptorHandle = gpuHandle;
-
-			}
 			g_Device->CreateShaderResourceView(m_pResource, nullptr, m_hCpuDescriptorHandle);
 			// Upload the resources to the GPU.
 			auto uploadResourcesFinished = resourceUpload.End(InCmdQueue);
@@ -123,6 +123,14 @@ namespace Renderer
 			void CreateArray(const std::wstring& Name, uint32_t Width, uint32_t Height, uint32_t ArrayCount,
 				DXGI_FORMAT Format, D3D12_GPU_VIRTUAL_ADDRESS VidMemPtr = D3D12_GPU_VIRTUAL_ADDRESS_UNKNOWN);
 
+			// Create a single mip color buffer in an existing heap.  Buffers placed in overlapping
+			// ranges alias each other, the caller issues the aliasing barriers.
+			void CreatePlaced(const std::wstring& Name, uint32_t Width, uint32_t Height, DXGI_FORMAT Format,
+				ID3D12Heap* Heap, uint64_t HeapOffset);
+
+			// Resource description CreatePlaced uses, for sizing the heap.
+			D3D12_RESOURCE_DESC DescribePlaced(uint32_t Width, uint32_t Height, DXGI_FORMAT Format);
+
 			// Get pre-created CPU-visible descriptor handles
 			const D3D12_CPU_DESCRIPTOR_HANDLE& GetSRV(void) const { return m_SRVHandle; }
 			const D3D12_CPU_DESCRIPTOR_HANDLE& GetRTV(void) const { return m_RTVHandle; }
@@ -207,6 +215,8 @@ namespace Renderer
 				Unmap();
 			}
 			size_t GetOffset() const { return mOffset; }
+			//Map once and keep the pointer,upload heaps may stay mapped while the GPU reads them.
+			uint8_t* MapPersistent();
 		protected:
 
 			size_t m_BufferSize;
@@ -219,6 +229,34 @@ namespace Renderer
 
 		};
 
+		class ReadbackBuffer : public GpuResource
+		{
+		public:
+			virtual ~ReadbackBuffer() { Destroy(); }
+
+			void Create(const std::wstring& name, size_t BufferSize);
+
+			size_t GetBufferSize() const { return m_BufferSize; }
+
+			//Only valid after the copy into this buffer has completed on the GPU.
+			template<class T>
+			void ReadData(std::span<T> OutData, size_t InOffset = 0)
+			{
+				auto sizeToRead = OutData.size_bytes();
+				Ensures(m_BufferSize >= sizeToRead + InOffset);
+				memcpy(OutData.data(), Map(InOffset, sizeToRead) + InOffset, sizeToRead);
+				Unmap();
+			}
+		protected:
+
+			size_t m_BufferSize;
+
+			const uint8_t* Map(size_t InOffset, size_t InReadSize);
+
+			void Unmap();
+
+		};
+
 		class GpuBuffer : public GpuResource
 		{
 		public:
@@ -408,6 +446,7 @@ namespace Renderer
 
 			Texture() { m_hCpuDescriptorHandle.ptr = D3D12_GPU_VIRTUAL_ADDRESS_UNKNOWN; }
 			Texture(D3D12_CPU_DESCRIPTOR_HANDLE Handle) : m_hCpuDescriptorHandle(Handle) {}
+			~Texture() { Destroy(); }
 
 			// Create a 1-level textures
 			void Create2D(size_t RowPitchBytes, size_t Width, size_t Height, DXGI_FORMAT Format, const void* InitData);
@@ -418,11 +457,8 @@ namespace Renderer
 			bool CreateDDSFromFile(std::string InFileName,ID3D12CommandQueue* InCmdQueue, bool sRGB);
 			void CreatePIXImageFromMemory(const void* memBuffer, size_t fileSize);
 
-			virtual void Destroy() override
-			{
-				GpuResource::Destroy();
-				m_hCpuDescriptorHandle.ptr = D3D12_GPU_VIRTUAL_ADDRESS_UNKNOWN;
-			}
+			// Hands the SRV back to the heap if the texture allocated it.
+			virtual void Destroy() override;
 
 			const D3D12_CPU_DESCRIPTOR_HANDLE& GetSRV() const { return m_hCpuDescriptorHandle; }
 			const D3D12_GPU_DESCRIPTOR_HANDLE& GetSRVGpu() const { return m_hGpuDescriptorHandle; }
@@ -437,8 +473,13 @@ namespace Renderer
 			uint32_t m_Height;
 			uint32_t m_Depth;
 
+			// Allocate the SRV unless the texture has one.
+			void AllocateDescriptor();
+
 			D3D12_CPU_DESCRIPTOR_HANDLE m_hCpuDescriptorHandle;
 			D3D12_GPU_DESCRIPTOR_HANDLE m_hGpuDescriptorHandle;
+			// False for a handle passed to the constructor.
+			bool m_OwnsDescriptor = false;
 
 		};
 	}
@@ -57,7 +57,7 @@ void Renderer::Gui::Render() {
 
     if (mRenderer.lock())
     {
-		//ImGui::Checkbox("Tone Mapping", &mRenderer.lock()->mUseToneMapping);
+		ImGui::Checkbox("Tone Mapping", &mRenderer.lock()->mUseToneMapping);
         ImGui::SliderFloat("Tone Mapping Exposure", &mRenderer.lock()->mExposure, 0.0f, 1.0f);
 		ImGui::SliderFloat("Bloom: Threshold", &mRenderer.lock()->mBloomThreshold, 0.0f, 1.0f);
 		ImGui::SliderFloat("Bloom: Kernel Size", &mRenderer.lock()->mBloomBlurKernelSize, 0.0f, 10.0f);
@@ -67,6 +67,155 @@ void Renderer::Gui::Render() {
 		ImGui::SliderFloat("Bloom: base intensity", &mRenderer.lock()->mbaseIntensity, 0.0, 10.0f);
 		ImGui::SliderFloat("Bloom: bloom saturation", &mRenderer.lock()->mbloomSaturation, 0.0, 10.0f);
 		ImGui::SliderFloat("Bloom: base saturation", &mRenderer.lock()->mbloomBaseSaturation, 0.0, 10.0f);
+		const auto& graphStats = mRenderer.lock()->mRenderGraphStats;
+		ImGui::Text("Post Graph: Passes: %u Culled: %u Transients: %u Transitions: %u Aliasing: %u Compile: %.3f ms",
+			graphStats.mPasses, graphStats.mCulledPasses, graphStats.mTransients, graphStats.mTransitions, graphStats.mAliasingBarriers, graphStats.mCompileMs);
+		ImGui::Text("Post Graph Heap: %llu KB Unaliased: %llu KB", graphStats.mHeapBytes / 1024, graphStats.mUnaliasedBytes / 1024);
+
+		ImGui::Checkbox("Occlusion Culling", &mRenderer.lock()->mUseOcclusionCulling);
+		ImGui::SliderInt("Occlusion Culling: Max Occluders", &mRenderer.lock()->mMaxOccluders, 0, 128);
+		const auto& cullStats = mRenderer.lock()->mOcclusionCullStats;
+		ImGui::Text("Entities: %u Frustum Culled: %u Occlusion Culled: %u", cullStats.mTested, cullStats.mFrustumCulled, cullStats.mOcclusionCulled);
+		ImGui::Text("Occluders: %u Occluder Triangles: %u", cullStats.mOccluders, cullStats.mOccluderTriangles);
+
+		ImGui::Checkbox("Shadow Caster Culling", &mRenderer.lock()->mUseShadowCasterCulling);
+		const auto& shadowStats = mRenderer.lock()->mShadowCullStats;
+		ImGui::Text("Shadow Casters: %u Culled: %u Opted Out: %u", shadowStats.mCasters, shadowStats.mCulled, shadowStats.mOptedOut);
+		const auto& packetStats = mRenderer.lock()->mDrawPacketStats;
+		ImGui::Text("Draw Packets: %u PSO Changes: %u Material Changes: %u Constant Changes: %u Index Buffer Changes: %u",
+			packetStats.mPackets, packetStats.mPipelineChanges, packetStats.mMaterialChanges, packetStats.mConstantChanges, packetStats.mIndexBufferChanges);
+		ImGui::Checkbox("Parallel Recording", &mRenderer.lock()->mUseParallelRecording);
+		ImGui::Text("Command Lists: %u Record: %.3f ms", packetStats.mCommandLists, packetStats.mRecordMs);
+		if (ImGui::Button("Benchmark Draw Recording"))
+		{
+			mRenderer.lock()->mRunDrawRecordBenchmark = true;
+		}
+		ImGui::Checkbox("GPU Driven Drawing", &mRenderer.lock()->mUseGpuDrivenDrawing);
+		if (mRenderer.lock()->mUseGpuDrivenDrawing)
+		{
+			ImGui::Checkbox("Validate GPU Culling", &mRenderer.lock()->mValidateGpuCulling);
+			const auto& gpuCullStats = mRenderer.lock()->mGpuCullStats;
+			ImGui::Text("Instances: %u Uploaded: %u", gpuCullStats.mInstances, gpuCullStats.mUploadedInstances);
+			const char* passNames[] = { "Depth", "Shadow", "Color" };
+			static_assert(std::size(passNames) == (size_t)Renderer::DrawPass::COUNT);
+			for (size_t i = 0; i < std::size(passNames); ++i)
+			{
+				const auto& passStats = gpuCullStats.mPasses[i];
+				ImGui::Text("%s: Draws: %u Tested: %u Frustum Culled: %u Occlusion Culled: %u", passNames[i],
+					passStats.mDraws, passStats.mTested, passStats.mFrustumCulled, passStats.mOcclusionCulled);
+			}
+			if (mRenderer.lock()->mValidateGpuCulling)
+			{
+				ImGui::Text("GPU Mismatch: %u draws %u passes", gpuCullStats.mMismatchedDraws, gpuCullStats.mMismatchedCounts);
+			}
+		}
+		//Only the mesh shader renderer fills the meshlet stats.
+		const auto& meshletStats = mRenderer.lock()->mMeshletCullStats;
+		if (meshletStats.mInstances > 0)
+		{
+			ImGui::Checkbox("Meshlet Frustum Culling", &mRenderer.lock()->mUseMeshletFrustumCulling);
+			ImGui::Checkbox("Meshlet Cone Culling", &mRenderer.lock()->mUseMeshletConeCulling);
+			ImGui::Checkbox("Meshlet Size Culling", &mRenderer.lock()->mUseMeshletSizeCulling);
+			ImGui::SliderFloat("Meshlet Size Culling: Min Pixels", &mRenderer.lock()->mMeshletMinPixels, 0.0f, 8.0f);
+			ImGui::Checkbox("Validate Meshlet Culling", &mRenderer.lock()->mValidateMeshletCulling);
+			ImGui::Text("Meshlet Instances: %u Groups: %u Dispatches: %u", meshletStats.mInstances, meshletStats.mGroups, meshletStats.mDispatches);
+			ImGui::Text("Meshlets: %u Frustum Culled: %u Small Culled: %u Cone Culled: %u Visible: %u", meshletStats.mCounts.mMeshlets,
+				meshletStats.mCounts.mFrustumCulled, meshletStats.mCounts.mSmallCulled, meshletStats.mCounts.mConeCulled, meshletStats.mCounts.mVisible);
+			if (mRenderer.lock()->mValidateMeshletCulling)
+			{
+				ImGui::Text("Expected: Frustum Culled: %u Small Culled: %u Cone Culled: %u Visible: %u Mismatched Frames: %u",
+					meshletStats.mExpected.mFrustumCulled, meshletStats.mExpected.mSmallCulled, meshletStats.mExpected.mConeCulled,
+					meshletStats.mExpected.mVisible, meshletStats.mMismatchedFrames);
+			}
+		}
+		ImGui::SliderInt("Frames In Flight", &mRenderer.lock()->mFramesInFlight, 1, Renderer::FramePacer::MAX_FRAMES_IN_FLIGHT);
+		const auto& pacerStats = mRenderer.lock()->mFramePacerStats;
+		ImGui::Text("GPU Frames Behind: %u Frame Wait: %.3f ms", pacerStats.mGpuFramesInFlight, pacerStats.mWaitMs);
+		const auto descStats = Renderer::g_DescHeap[D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV]->GetStats();
+		ImGui::Text("Descriptors Used: %u/%u Pending Free: %u Transient: %u/%u Failed: %u",
+			descStats.mPersistentUsed, descStats.mPersistentCapacity, descStats.mPendingFrees,
+			descStats.mTransientUsed, descStats.mTransientCapacity, descStats.mFailedAllocations);
+		if (mRenderer.lock()->GetContext())
+		{
+			const auto geometryStats = mRenderer.lock()->GetContext()->GetUploadStats();
+			ImGui::Text("Geometry Staged: %llu bytes Copies: %u Submits: %u Waits: %u",
+				geometryStats.mStagedBytes, geometryStats.mCopies, geometryStats.mSubmits, geometryStats.mWaits);
+			const Renderer::GeometryPoolStats poolStats[] = { mRenderer.lock()->GetContext()->GetVertexStats(),
+				mRenderer.lock()->GetContext()->GetIndexStats(false), mRenderer.lock()->GetContext()->GetIndexStats(true) };
+			const char* poolNames[] = { "Vertices", "Indices", "Indices16" };
+			for (int i = 0; i < 3; ++i)
+			{
+				const auto& allocStats = poolStats[i].mAllocator;
+				ImGui::Text("%s Used: %u/%u Meshes: %u Holes: %u Largest Free: %u Buffer: %.1f MB Grows: %u", poolNames[i],
+					allocStats.mUsed, allocStats.mCapacity, allocStats.mAllocations, allocStats.mFreeBlocks, allocStats.mLargestFree,
+					poolStats[i].mBufferBytes / (1024.0 * 1024.0), poolStats[i].mGrows);
+			}
+			if (ImGui::Button("Defragment Geometry"))
+			{
+				mRenderer.lock()->mRunGeometryDefragment = true;
+			}
+		}
+		const auto& lightStats = mRenderer.lock()->GetLightUploadStats();
+		ImGui::Text("Lights: %u Uploaded: %u Copies: %u Bytes: %u Record: %.3f ms",
+			lightStats.mLights, lightStats.mDirtyLights, lightStats.mCopies, lightStats.mUploadBytes, lightStats.mRecordMs);
+		int lightCullMode = (int)mRenderer.lock()->mLightCullMode;
+		if (ImGui::Combo("Light Culling", &lightCullMode, "Clusters\0Z-Bins\0"))
+		{
+			mRenderer.lock()->mLightCullMode = (LightCullMode)lightCullMode;
+		}
+		ImGui::Checkbox("CPU Light Culling", &mRenderer.lock()->mUseCpuLightCulling);
+		ImGui::Checkbox("Validate Light Culling", &mRenderer.lock()->mValidateLightCulling);
+		if (ImGui::Button("Benchmark Light Culling"))
+		{
+			mRenderer.lock()->mRunLightCullBenchmark = true;
+		}
+		if (mRenderer.lock()->mLightCullMode == LightCullMode::ZBINS)
+		{
+			const auto& zbinStats = mRenderer.lock()->mZBinCullStats;
+			ImGui::Text("Binned Lights: %u Used Bins: %u Tiles: %u Words Per Tile: %u Tile Assignments: %u",
+				zbinStats.mLights, zbinStats.mUsedBins, zbinStats.mTiles, zbinStats.mWordsPerTile, zbinStats.mTileAssignments);
+			ImGui::Text("Bins And Masks: %u KB CPU Cull: %.3f ms", zbinStats.mMemoryBytes / 1024, zbinStats.mCullMs);
+			ImGui::Text("GPU Mismatch: %u tiles %u bits", zbinStats.mMismatchedTiles, zbinStats.mMismatchedBits);
+		}
+		else
+		{
+			auto& grid = mRenderer.lock()->mClusterGrid;
+			ImGui::Checkbox("Auto Tune Cluster Grid", &mRenderer.lock()->mAutoTuneClusterGrid);
+			const uint32_t minCount = 1, maxX = MAX_CLUSTER_X, maxY = MAX_CLUSTER_Y, maxZ = MAX_CLUSTER_Z;
+			ImGui::SliderScalar("Cluster Grid X", ImGuiDataType_U32, &grid.mX, &minCount, &maxX);
+			ImGui::SliderScalar("Cluster Grid Y", ImGuiDataType_U32, &grid.mY, &minCount, &maxY);
+			ImGui::SliderScalar("Cluster Grid Z", ImGuiDataType_U32, &grid.mZ, &minCount, &maxZ);
+			ImGui::SliderFloat("Cluster Slice Distribution", &grid.mDistributionScale, 1.0f, 8.0f);
+			ImGui::Checkbox("Cull Active Clusters Only", &mRenderer.lock()->mUseActiveClusters);
+			if (!mRenderer.lock()->mUseCpuLightCulling)
+			{
+				const auto& activeStats = mRenderer.lock()->mActiveClusterStats;
+				ImGui::Text("Active Clusters: %u / %u (%.1f%%)", activeStats.mActiveClusters, activeStats.mTotalClusters,
+					activeStats.mTotalClusters ? 100.0f * activeStats.mActiveClusters / activeStats.mTotalClusters : 0.0f);
+			}
+			if (mRenderer.lock()->mAutoTuneClusterGrid)
+			{
+				const auto& estimate = mRenderer.lock()->mClusterGridEstimate;
+				ImGui::Text("Predicted: %.2f lights per pixel %.2f per occupied cluster %u occupied clusters",
+					estimate.mLightsPerPixel, estimate.mLightsPerOccupiedCluster, estimate.mOccupiedClusters);
+			}
+		}
+		if (mRenderer.lock()->mLightCullMode == LightCullMode::CLUSTERS && (mRenderer.lock()->mUseCpuLightCulling || mRenderer.lock()->mValidateLightCulling))
+		{
+			const auto& clusterStats = mRenderer.lock()->mClusterCullStats;
+			ImGui::Text("Binned Lights: %u Assignments: %u Dropped: %u Empty Clusters: %u Max Per Cluster: %u",
+				clusterStats.mLights, clusterStats.mAssignments, clusterStats.mDroppedAssignments, clusterStats.mEmptyClusters, clusterStats.mMaxClusterLights);
+			ImGui::Text("Light List: %u KB Bit Mask Equivalent: %u KB CPU Cull: %.3f ms",
+				clusterStats.mListBytes / 1024, clusterStats.mMaskBytes / 1024, clusterStats.mCullMs);
+			ImGui::Text("GPU Mismatch: %u clusters %u lights %u active clusters",
+				clusterStats.mMismatchedClusters, clusterStats.mMismatchedLights, clusterStats.mMismatchedActiveClusters);
+			const uint32_t occupiedClusters = clusterStats.mClusters - clusterStats.mEmptyClusters;
+			ImGui::Text("Measured: %.2f lights per occupied cluster", occupiedClusters ? float(clusterStats.mAssignments) / occupiedClusters : 0.0f);
+		}
+		if (mCurrentScene)
+		{
+			ImGui::Checkbox("Animate Lights", &mCurrentScene->GetLightAnimation()->mEnabled);
+		}
     }
     if (mCurrentScene)
     {
@@ -112,16 +261,18 @@ void Renderer::Gui::SetCurrentScene(std::shared_ptr<GAS::GameScene> InGameScene)
 {
     mCurrentScene = InGameScene;
     auto& sceneRegistry = mCurrentScene->GetRegistery();
-    for (auto entt: sceneRegistry.view<entt::entity>()) {
+    for (auto entt: sceneRegistry.view<ECS::TransformComponent>()) {
         mEntities.push_back(entt);
     }
 
     if (!mEntities.empty())
     {
-        GameSceneUpdate(InGameScene, mEntities);
+        //The renderer's scene load uploads the geometry of the entities present at load.
+        AddEntities(InGameScene, mEntities, false);
 		//mCurrentEntity = mEntities[0];
     }
 	GAS::GameScene::sOnNewEntityAdded.push_back(std::bind(&Gui::GameSceneUpdate, this, std::placeholders::_1, std::placeholders::_2));
+	GAS::GameScene::sOnEntitiesRemoved.push_back(std::bind(&Gui::GameSceneEntitiesRemoved, this, std::placeholders::_1, std::placeholders::_2));
 }
 
 void Renderer::Gui::SetRenderer(std::weak_ptr<BaseRenderer> InRenderer)
@@ -138,10 +289,30 @@ void Renderer::Gui::SceneUpdate()
                 auto extension = InFilePath.extension();
                 if (extension.string() == ".fbx" || extension.string() == ".FBX")
                 {
-                    auto newEntities =  mCurrentScene->CreateEntitiesWithMesh(InFilePath.string());
+                    mCurrentScene->CreateEntitiesWithMeshAsync(InFilePath.string());
                 }
             });
     }
+    ImGui::SameLine();
+    if (ImGui::Button("Open World Partition"))
+    {
+        AddFile([this](const std::filesystem::path& InFilePath)
+            {
+                mCurrentScene->OpenWorldPartition(InFilePath.string());
+            });
+    }
+    ImGui::SameLine();
+    if (mCurrentScene && ImGui::Button("Unload Scene"))
+    {
+        mCurrentScene->Unload();
+        mEntities.clear();
+        mEntitiesDisplayName.clear();
+        mCurrentEntity = entt::null;
+    }
+    if (mCurrentScene && ImGui::Button("Dump System Schedule"))
+    {
+        gLogger->info("System schedule:\n{}", mCurrentScene->GetSystems().DumpSchedule());
+    }
     if (mCurrentScene)
     {
 		ImGui::DragFloat("Scene Scale", &mCurrentSceneScale);
@@ -185,34 +356,87 @@ void Renderer::Gui::SceneUpdate()
         }
         ImGui::EndListBox();
     }
+    StreamingPanel();
 	SceneMaterials();
 }
 
+void Renderer::Gui::StreamingPanel()
+{
+    auto& partition = mCurrentScene->GetWorldPartition();
+    if (!partition.IsOpen() || !ImGui::TreeNode("World Partition"))
+    {
+        return;
+    }
+    auto& settings = partition.GetSettings();
+    ImGui::DragFloat("Load Radius", &settings.mLoadRadius, 1.0f, 0.0f, 10000.0f);
+    ImGui::DragFloat("Unload Radius", &settings.mUnloadRadius, 1.0f, settings.mLoadRadius, 10000.0f);
+    const auto& stats = partition.GetStats();
+    ImGui::Text("Cells: %u Resident: %u Loading: %u Resident Memory: %.2f MB", stats.mCells, stats.mResidentCells, stats.mLoadingCells,
+        stats.mResidentBytes / (1024.0f * 1024.0f));
+    ImGui::Text("Loads: %u Unloads: %u Budget Deferrals: %u Bandwidth: %.2f MB/s", stats.mCellLoads, stats.mCellUnloads, stats.mBudgetDeferrals, stats.mBandwidthMBs);
+    ImGui::Text("Streaming Frame: %.2f ms Max: %.2f ms Hitches: %u", stats.mLastFrameMs, stats.mMaxFrameMs, stats.mHitches);
+    ImGui::TreePop();
+}
+
 void Renderer::Gui::GameSceneUpdate(std::shared_ptr<GAS::GameScene> InGameScene, std::span<entt::entity> InEntities)
+{
+    AddEntities(InGameScene, InEntities, true);
+}
+
+void Renderer::Gui::AddEntities(std::shared_ptr<GAS::GameScene> InGameScene, std::span<entt::entity> InEntities, bool InUploadGeometry)
 {
 	int n = 0;
     auto& sceneRegistry = InGameScene->GetRegistery();
    
     for (auto entity : InEntities)
     {
+        //Lights and other entities without a transform are not listed.
+        if (!sceneRegistry.all_of<ECS::TransformComponent>(entity))
+        {
+            continue;
+        }
 		auto name = std::string("Entity") + std::to_string(n);
 		if (ECS::StaticMeshComponent* lStaticComponent = sceneRegistry.try_get<ECS::StaticMeshComponent>(entity))
 		{
-			name += "-" + lStaticComponent->mName;
-            if (mRenderer.lock()->GetContext())
+			auto& lAsset = InGameScene->GetMeshStore().GetMesh(lStaticComponent->mMesh);
+			name += "-" + lAsset.mName;
+            if (InUploadGeometry && mRenderer.lock()->GetContext())
             {
-                mRenderer.lock()->GetContext()->LoadStaticMeshToGpu(*lStaticComponent);
+                mRenderer.lock()->GetContext()->LoadStaticMeshToGpu(*lStaticComponent, lAsset);
             }
-			mRenderer.lock()->MeshShaderNewStaticmeshComponent(*lStaticComponent);
+			mRenderer.lock()->MeshShaderNewStaticmeshComponent(*lStaticComponent, lAsset);
 		}
-		for (auto [textureName, textureData] : mCurrentScene->GetTextureMap())
+		for (auto [textureName, texture] : mCurrentScene->GetTextureMap())
 		{
-            mRenderer.lock()->LoadMaterial(textureName, textureData);
+            mRenderer.lock()->LoadMaterial(texture);
 		}
 		mEntitiesDisplayName.push_back(name);
         mEntities.push_back(entity);
 		n++;
     }
+    if (InUploadGeometry && mRenderer.lock()->GetContext())
+    {
+        mRenderer.lock()->GetContext()->FlushUploads();
+    }
+}
+
+void Renderer::Gui::GameSceneEntitiesRemoved(std::shared_ptr<GAS::GameScene> InGameScene, std::span<const entt::entity> InEntities)
+{
+    for (auto entity : InEntities)
+    {
+        auto lEntity = std::find(mEntities.begin(), mEntities.end(), entity);
+        if (lEntity == mEntities.end())
+        {
+            continue;
+        }
+        auto lIndex = lEntity - mEntities.begin();
+        mEntities.erase(lEntity);
+        mEntitiesDisplayName.erase(mEntitiesDisplayName.begin() + lIndex);
+        if (mCurrentEntity == entity)
+        {
+            mCurrentEntity = entt::null;
+        }
+    }
 }
 
 void Renderer::Gui::EntityPanel(entt::entity e) 
@@ -241,12 +465,13 @@ void Renderer::Gui::EntityPanel(entt::entity e)
 			auto& meshComponent = registry.get<ECS::StaticMeshComponent>(e);
             if (ImGui::Button("Apply Diffuse Texture"))
             {
-                meshComponent.MatName = mSelectedMatName;
+                mCurrentScene->GetMeshStore().SetTexture(meshComponent, ECS::TextureSlot::BASE_COLOR, AssetLoader::gAssetRegistry->GetTextures().Find(mSelectedMatName));
             }
 			if (ImGui::Button("Apply Normal Texture"))
 			{
-				meshComponent.NormalMap = mSelectedMatName;
+				mCurrentScene->GetMeshStore().SetTexture(meshComponent, ECS::TextureSlot::NORMAL_MAP, AssetLoader::gAssetRegistry->GetTextures().Find(mSelectedMatName));
 			}
+			ImGui::Checkbox("Cast Shadow", &meshComponent.mCastShadow);
             ImGui::EndTabItem();
         }
         ImGui::EndTabBar();
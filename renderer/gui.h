@@ -29,6 +29,10 @@ namespace Renderer
     private:
         void SceneUpdate();
         void GameSceneUpdate(std::shared_ptr<GAS::GameScene> InGameScene, std::span<entt::entity> InEntities);
+        //List the entities,InUploadGeometry also loads their meshes into the shared geometry buffers.
+        void AddEntities(std::shared_ptr<GAS::GameScene> InGameScene, std::span<entt::entity> InEntities, bool InUploadGeometry);
+        void GameSceneEntitiesRemoved(std::shared_ptr<GAS::GameScene> InGameScene, std::span<const entt::entity> InEntities);
+        void StreamingPanel();
         void EntityPanel(entt::entity e);
         void Property(std::string name,float* value,float min,float max);
         std::shared_ptr < GAS::GameScene> mCurrentScene;
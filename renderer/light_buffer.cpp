@@ -0,0 +1,236 @@
+#include "light_buffer.h"
+
+Renderer::LightBuffer::LightBuffer()
+{
+	Grow(INITIAL_CAPACITY);
+}
+
+Renderer::LightBuffer::~LightBuffer()
+{
+	Track(nullptr);
+}
+
+ECS::LigthData Renderer::LightBuffer::ToLightData(const ECS::LightComponent& InLight)
+{
+	using namespace DirectX;
+	ECS::LigthData lData = {};
+	lData.color = InLight.color;
+	lData.pos = InLight.pos;
+	lData.radius_attenu = InLight.radius_attenu;
+	lData.type = InLight.type;
+	XMStoreFloat3(&lData.direction, XMVector3Normalize(XMLoadFloat3(&InLight.direction)));
+	const float lRange = InLight.radius_attenu.x;
+	lData.bounds = { InLight.pos.x, InLight.pos.y, InLight.pos.z, lRange };
+	switch (InLight.type)
+	{
+	case ECS::LightType::SPOT:
+	{
+		const float lOuter = std::clamp(InLight.spotOuterAngle, 0.0f, XM_PI);
+		const float lInner = std::clamp(InLight.spotInnerAngle, 0.0f, lOuter);
+		const float lCosOuter = std::cos(lOuter);
+		lData.shape = { lCosOuter, std::cos(lInner), std::sin(lOuter), 0.0f };
+		//Smallest sphere around the cone,the apex sphere is already the tightest past 90 degrees.
+		if (lOuter <= XM_PIDIV4)
+		{
+			const float lRadius = lRange / (2.0f * lCosOuter);
+			lData.bounds = { lData.pos.x + lData.direction.x * lRadius, lData.pos.y + lData.direction.y * lRadius, lData.pos.z + lData.direction.z * lRadius, lRadius };
+		}
+		else if (lOuter < XM_PIDIV2)
+		{
+			const float lOffset = lRange * lCosOuter;
+			lData.bounds = { lData.pos.x + lData.direction.x * lOffset, lData.pos.y + lData.direction.y * lOffset, lData.pos.z + lData.direction.z * lOffset, lRange * std::sin(lOuter) };
+		}
+		break;
+	}
+	case ECS::LightType::CAPSULE:
+		lData.shape = { 0.5f * std::max(InLight.length, 0.0f), 0.0f, 0.0f, 0.0f };
+		lData.bounds.w = lData.shape.x + lRange;
+		break;
+	default:
+		break;
+	}
+	return lData;
+}
+
+void Renderer::LightBuffer::CoalesceCopies(std::vector<uint32_t>& InOutDirtySlots, uint32_t InLightCount, std::vector<LightCopy>& OutCopies)
+{
+	if (InOutDirtySlots.size() > InLightCount / 2)
+	{
+		OutCopies.push_back({ 0, InLightCount });
+		return;
+	}
+	std::sort(InOutDirtySlots.begin(), InOutDirtySlots.end());
+	for (size_t i = 0; i < InOutDirtySlots.size();)
+	{
+		size_t lEnd = i + 1;
+		while (lEnd < InOutDirtySlots.size() && InOutDirtySlots[lEnd] == InOutDirtySlots[lEnd - 1] + 1)
+		{
+			lEnd++;
+		}
+		OutCopies.push_back({ InOutDirtySlots[i], uint32_t(lEnd - i) });
+		i = lEnd;
+	}
+}
+
+void Renderer::LightBuffer::Track(entt::registry* InRegistry)
+{
+	if (mRegistry)
+	{
+		mRegistry->on_construct<ECS::LightComponent>().disconnect(this);
+		mRegistry->on_update<ECS::LightComponent>().disconnect(this);
+		mRegistry->on_destroy<ECS::LightComponent>().disconnect(this);
+	}
+	Reset();
+	mRegistry = InRegistry;
+	if (!mRegistry)
+	{
+		return;
+	}
+	mRegistry->on_construct<ECS::LightComponent>().connect<&LightBuffer::OnLightConstructed>(*this);
+	mRegistry->on_update<ECS::LightComponent>().connect<&LightBuffer::OnLightUpdated>(*this);
+	mRegistry->on_destroy<ECS::LightComponent>().connect<&LightBuffer::OnLightDestroyed>(*this);
+	for (auto entity : mRegistry->view<ECS::LightComponent>())
+	{
+		OnLightConstructed(*mRegistry, entity);
+	}
+}
+
+void Renderer::LightBuffer::RecordUpload(ID3D12GraphicsCommandList* InCmd, uint32_t InFrameIndex)
+{
+	auto lStart = std::chrono::steady_clock::now();
+	mUploadCount++;
+	std::erase_if(mRetired, [this](const RetiredBuffers& InRetired) { return InRetired.mReleaseAfter <= mUploadCount; });
+
+	auto lCount = GetCount();
+	if (lCount > mCapacity)
+	{
+		Grow(std::bit_ceil(lCount));
+	}
+	mStats = {};
+	mStats.mLights = lCount;
+	std::erase_if(mDirtySlots, [this, lCount](uint32_t InSlot)
+		{
+			mSlotDirty[InSlot] = 0;
+			return InSlot >= lCount;
+		});
+	if (lCount == 0 || (!mFullUpload && mDirtySlots.empty()))
+	{
+		mDirtySlots.clear();
+		return;
+	}
+
+	constexpr uint32_t lStride = sizeof(ECS::LigthData);
+	const size_t lSliceOffset = size_t(InFrameIndex % SWAP_CHAIN_BUFFER_COUNT) * mCapacity * lStride;
+	uint8_t* lSlice = mUploadRingData + lSliceOffset;
+	mStats.mDirtyLights = mFullUpload ? lCount : (uint32_t)mDirtySlots.size();
+	mCopies.clear();
+	if (mFullUpload)
+	{
+		mCopies.push_back({ 0, lCount });
+	}
+	else
+	{
+		CoalesceCopies(mDirtySlots, lCount, mCopies);
+	}
+	//The slice is packed in copy order.
+	uint32_t lWritten = 0;
+	for (const auto& copy : mCopies)
+	{
+		uint32_t lBytes = copy.mCount * lStride;
+		memcpy(lSlice + lWritten, &mLights[copy.mFirstSlot], lBytes);
+		InCmd->CopyBufferRegion(mBuffer->GetResource(), uint64_t(copy.mFirstSlot) * lStride, mUploadRing->GetResource(), lSliceOffset + lWritten, lBytes);
+		lWritten += lBytes;
+	}
+	mStats.mCopies = (uint32_t)mCopies.size();
+	mStats.mUploadBytes = lWritten;
+	//The buffer idles in COMMON,the copy promoted it to COPY_DEST and it decays back after the frame.
+	auto lBarrier = CD3DX12_RESOURCE_BARRIER::Transition(mBuffer->GetResource(), D3D12_RESOURCE_STATE_COPY_DEST, D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE);
+	InCmd->ResourceBarrier(1, &lBarrier);
+	mDirtySlots.clear();
+	mFullUpload = false;
+	mStats.mRecordMs = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - lStart).count();
+}
+
+D3D12_GPU_VIRTUAL_ADDRESS Renderer::LightBuffer::GetGpuVirtualAddress() const
+{
+	return mBuffer->GetGpuVirtualAddress();
+}
+
+void Renderer::LightBuffer::OnLightConstructed(entt::registry& InRegistry, entt::entity InEntity)
+{
+	auto lIndex = entt::to_entity(InEntity);
+	if (lIndex >= mEntitySlot.size())
+	{
+		mEntitySlot.resize(lIndex + 1, UINT32_MAX);
+	}
+	uint32_t lSlot = (uint32_t)mLights.size();
+	mEntitySlot[lIndex] = lSlot;
+	mLights.push_back(ToLightData(InRegistry.get<ECS::LightComponent>(InEntity)));
+	mSlotEntity.push_back(InEntity);
+	MarkDirty(lSlot);
+}
+
+void Renderer::LightBuffer::OnLightUpdated(entt::registry& InRegistry, entt::entity InEntity)
+{
+	uint32_t lSlot = mEntitySlot[entt::to_entity(InEntity)];
+	mLights[lSlot] = ToLightData(InRegistry.get<ECS::LightComponent>(InEntity));
+	MarkDirty(lSlot);
+}
+
+void Renderer::LightBuffer::OnLightDestroyed(entt::registry& InRegistry, entt::entity InEntity)
+{
+	auto lIndex = entt::to_entity(InEntity);
+	uint32_t lSlot = mEntitySlot[lIndex];
+	uint32_t lLast = (uint32_t)mLights.size() - 1;
+	//Keep the array dense,the last light moves into the hole.
+	if (lSlot != lLast)
+	{
+		mLights[lSlot] = mLights[lLast];
+		mSlotEntity[lSlot] = mSlotEntity[lLast];
+		mEntitySlot[entt::to_entity(mSlotEntity[lSlot])] = lSlot;
+		MarkDirty(lSlot);
+	}
+	mLights.pop_back();
+	mSlotEntity.pop_back();
+	mEntitySlot[lIndex] = UINT32_MAX;
+}
+
+void Renderer::LightBuffer::MarkDirty(uint32_t InSlot)
+{
+	if (InSlot >= mSlotDirty.size())
+	{
+		mSlotDirty.resize(std::max<size_t>(InSlot + 1, mSlotDirty.size() * 2), 0);
+	}
+	if (!mSlotDirty[InSlot])
+	{
+		mSlotDirty[InSlot] = 1;
+		mDirtySlots.push_back(InSlot);
+	}
+}
+
+void Renderer::LightBuffer::Reset()
+{
+	mLights.clear();
+	mSlotEntity.clear();
+	mEntitySlot.clear();
+	mDirtySlots.clear();
+	mSlotDirty.clear();
+	mFullUpload = true;
+}
+
+void Renderer::LightBuffer::Grow(uint32_t InCapacity)
+{
+	//Frames in flight may still read the old buffer or copy from the old ring.
+	if (mBuffer)
+	{
+		mRetired.push_back({ mUploadCount + SWAP_CHAIN_BUFFER_COUNT, std::move(mBuffer), std::move(mUploadRing) });
+	}
+	mCapacity = InCapacity;
+	mBuffer = std::make_unique<Resource::StructuredBuffer>();
+	mBuffer->Create(L"LightBuffer", mCapacity, sizeof(ECS::LigthData));
+
+	mUploadRing = std::make_unique<Resource::UploadBuffer>();
+	mUploadRing->Create(L"LightUploadRing", size_t(mCapacity) * sizeof(ECS::LigthData) * SWAP_CHAIN_BUFFER_COUNT);
+	mUploadRingData = mUploadRing->MapPersistent();
+	mFullUpload = true;
+}
@@ -0,0 +1,99 @@
+#pragma once
+#include "renderer_common.h"
+
+namespace Renderer
+{
+	struct LightUploadStats
+	{
+		uint32_t mLights = 0;
+		uint32_t mDirtyLights = 0;
+		uint32_t mCopies = 0;
+		uint32_t mUploadBytes = 0;
+		float mRecordMs = 0.0f;
+	};
+
+	//One CopyBufferRegion of mCount lights starting at mFirstSlot.
+	struct LightCopy
+	{
+		uint32_t mFirstSlot = 0;
+		uint32_t mCount = 0;
+	};
+
+	//GPU mirror of every ECS::LightComponent in a registry.
+	//Registry signals keep a dense CPU copy and a dirty list up to date,only the changed lights are copied each frame.
+	//Lights must be changed through patch or replace,writes through a plain reference are not seen.
+	class LightBuffer
+	{
+	public:
+		static constexpr uint32_t INITIAL_CAPACITY = 256;
+
+		LightBuffer();
+
+		~LightBuffer();
+
+		//GPU format of a light,normalizes the axis and derives the shape constants and the bounding sphere.
+		static ECS::LigthData ToLightData(const ECS::LightComponent& InLight);
+
+		//Sorts InOutDirtySlots and merges adjacent slots into one copy each.
+		//Past half of InLightCount dirty a single copy of every light is cheaper and is returned instead.
+		static void CoalesceCopies(std::vector<uint32_t>& InOutDirtySlots, uint32_t InLightCount, std::vector<LightCopy>& OutCopies);
+
+		//Mirror the lights of InRegistry,stops tracking the previous registry.
+		void Track(entt::registry* InRegistry);
+
+		//Copy the dirty lights into this frame's slice of the upload ring and record the copies on InCmd.
+		//Grows the GPU buffer first if needed,the replaced buffer stays alive until the frames in flight are done with it.
+		void RecordUpload(ID3D12GraphicsCommandList* InCmd, uint32_t InFrameIndex);
+
+		uint32_t GetCount() const { return (uint32_t)mLights.size(); }
+
+		//CPU copy in GPU order,matches the buffer once the frame's upload has been recorded.
+		std::span<const ECS::LigthData> GetLights() const { return mLights; }
+
+		//Changes when the buffer grows,bind it as a root SRV every frame.
+		D3D12_GPU_VIRTUAL_ADDRESS GetGpuVirtualAddress() const;
+
+		const LightUploadStats& GetStats() const { return mStats; }
+
+	private:
+		void OnLightConstructed(entt::registry& InRegistry, entt::entity InEntity);
+
+		void OnLightUpdated(entt::registry& InRegistry, entt::entity InEntity);
+
+		void OnLightDestroyed(entt::registry& InRegistry, entt::entity InEntity);
+
+		void MarkDirty(uint32_t InSlot);
+
+		void Reset();
+
+		void Grow(uint32_t InCapacity);
+
+		entt::registry* mRegistry = nullptr;
+		//Dense light data in GPU order,mSlotEntity[i] owns mLights[i].
+		std::vector<ECS::LigthData> mLights;
+		std::vector<entt::entity> mSlotEntity;
+		//Indexed by entity index.
+		std::vector<uint32_t> mEntitySlot;
+		std::vector<uint32_t> mDirtySlots;
+		std::vector<uint8_t> mSlotDirty;
+		std::vector<LightCopy> mCopies;
+		//Everything is copied after a grow.
+		bool mFullUpload = true;
+
+		uint32_t mCapacity = 0;
+		std::unique_ptr<Resource::StructuredBuffer> mBuffer;
+		//One slice per frame in flight,persistently mapped.
+		std::unique_ptr<Resource::UploadBuffer> mUploadRing;
+		uint8_t* mUploadRingData = nullptr;
+		//Replaced buffers stay alive until the frames that may still read them are done.
+		struct RetiredBuffers
+		{
+			uint64_t mReleaseAfter;
+			std::unique_ptr<Resource::StructuredBuffer> mBuffer;
+			std::unique_ptr<Resource::UploadBuffer> mUploadRing;
+		};
+		std::vector<RetiredBuffers> mRetired;
+		uint64_t mUploadCount = 0;
+		LightUploadStats mStats;
+	};
+}
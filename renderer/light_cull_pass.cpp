@@ -5,9 +5,23 @@
 Renderer::LightCullPass::LightCullPass(std::shared_ptr<RendererContext> InGraphicsContext):
 	BaseRenderPass("", "", InGraphicsContext)
 {
-	mVertexShader = Utils::ReadShader("LightCull.hlsl", "main", "cs_6_5");
+	mCountShader = Utils::ReadShader("LightCull.hlsl", "CountLights", "cs_6_5");
+	mOffsetsShader = Utils::ReadShader("LightCull.hlsl", "CompactOffsets", "cs_6_5");
+	mVertexShader = Utils::ReadShader("LightCull.hlsl", "WriteLightIndices", "cs_6_5");
+	mClearActiveShader = Utils::ReadShader("LightCull.hlsl", "ClearActiveClusters", "cs_6_5");
+	mMarkActiveShader = Utils::ReadShader("LightCull.hlsl", "MarkActiveClusters", "cs_6_5");
+	mCompactActiveShader = Utils::ReadShader("LightCull.hlsl", "CompactActiveClusters", "cs_6_5");
 	CreateRS();
 	CreatePipelineState();
+
+	//Plain dispatches,nothing in the root signature changes between them.
+	D3D12_INDIRECT_ARGUMENT_DESC lDispatchArg = {};
+	lDispatchArg.Type = D3D12_INDIRECT_ARGUMENT_TYPE_DISPATCH;
+	D3D12_COMMAND_SIGNATURE_DESC lSignatureDesc = {};
+	lSignatureDesc.ByteStride = ACTIVE_ARGS_BYTES;
+	lSignatureDesc.NumArgumentDescs = 1;
+	lSignatureDesc.pArgumentDescs = &lDispatchArg;
+	Ensures(g_Device->CreateCommandSignature(&lSignatureDesc, nullptr, IID_PPV_ARGS(&mDispatchSignature)) == S_OK);
 }
 
 Renderer::LightCullPass::~LightCullPass()
@@ -15,10 +29,45 @@ Renderer::LightCullPass::~LightCullPass()
 
 }
 
-void Renderer::LightCullPass::RenderScene(ID3D12GraphicsCommandList* InCmdList)
+void Renderer::LightCullPass::SetActiveClusters(ID3D12Resource* InArgs, bool InMarkFromDepth, bool InWriteDepthRanges, uint32_t InWidth, uint32_t InHeight)
 {
-	mGraphicsCmd->Dispatch(CLUSTER_X, CLUSTER_Y, CLUSTER_Z);
+	mActiveArgs = InArgs;
+	mMarkFromDepth = InMarkFromDepth;
+	mWriteDepthRanges = InWriteDepthRanges;
+	mDepthWidth = InWidth;
+	mDepthHeight = InHeight;
+}
 
+void Renderer::LightCullPass::RenderScene(ID3D12GraphicsCommandList* InCmdList)
+{
+	Expects(mActiveArgs);
+	//Every pass reads what the previous one wrote to the cluster buffers.
+	auto lUavBarrier = CD3DX12_RESOURCE_BARRIER::UAV(nullptr);
+	mGraphicsCmd->SetComputeRoot32BitConstant(4, mMarkFromDepth ? 0 : 1, 0);
+	mGraphicsCmd->SetComputeRoot32BitConstant(4, mWriteDepthRanges ? 1 : 0, 1);
+	mGraphicsCmd->SetPipelineState(mClearActivePipelineState);
+	mGraphicsCmd->Dispatch((mGrid.GetCount() + 63) / 64, 1, 1);
+	mGraphicsCmd->ResourceBarrier(1, &lUavBarrier);
+	if (mMarkFromDepth)
+	{
+		mGraphicsCmd->SetPipelineState(mMarkActivePipelineState);
+		mGraphicsCmd->Dispatch((mDepthWidth + 7) / 8, (mDepthHeight + 7) / 8, 1);
+		mGraphicsCmd->ResourceBarrier(1, &lUavBarrier);
+	}
+	mGraphicsCmd->SetPipelineState(mCompactActivePipelineState);
+	mGraphicsCmd->Dispatch(1, 1, 1);
+	mGraphicsCmd->ResourceBarrier(1, &lUavBarrier);
+	//The compaction promoted the arguments to UNORDERED_ACCESS.
+	auto lToArgs = CD3DX12_RESOURCE_BARRIER::Transition(mActiveArgs, D3D12_RESOURCE_STATE_UNORDERED_ACCESS, D3D12_RESOURCE_STATE_INDIRECT_ARGUMENT);
+	mGraphicsCmd->ResourceBarrier(1, &lToArgs);
+	mGraphicsCmd->SetPipelineState(mCountPipelineState);
+	mGraphicsCmd->ExecuteIndirect(mDispatchSignature, 1, mActiveArgs, 0, nullptr, 0);
+	mGraphicsCmd->ResourceBarrier(1, &lUavBarrier);
+	mGraphicsCmd->SetPipelineState(mOffsetsPipelineState);
+	mGraphicsCmd->Dispatch(1, 1, 1);
+	mGraphicsCmd->ResourceBarrier(1, &lUavBarrier);
+	mGraphicsCmd->SetPipelineState(mPipelineState);
+	mGraphicsCmd->ExecuteIndirect(mDispatchSignature, 1, mActiveArgs, 0, nullptr, 0);
 }
 
 void Renderer::LightCullPass::CreatePipelineState()
@@ -29,6 +78,26 @@ void Renderer::LightCullPass::CreatePipelineState()
 	lightCullPassDesc.pRootSignature = mRS;
 	g_Device->CreateComputePipelineState(&lightCullPassDesc, IID_PPV_ARGS(&mPipelineState));
 	mPipelineState->SetName(L"mLightCullPass");
+
+	lightCullPassDesc.CS = mCountShader;
+	g_Device->CreateComputePipelineState(&lightCullPassDesc, IID_PPV_ARGS(&mCountPipelineState));
+	mCountPipelineState->SetName(L"mLightCullCountPass");
+
+	lightCullPassDesc.CS = mOffsetsShader;
+	g_Device->CreateComputePipelineState(&lightCullPassDesc, IID_PPV_ARGS(&mOffsetsPipelineState));
+	mOffsetsPipelineState->SetName(L"mLightCullOffsetsPass");
+
+	lightCullPassDesc.CS = mClearActiveShader;
+	g_Device->CreateComputePipelineState(&lightCullPassDesc, IID_PPV_ARGS(&mClearActivePipelineState));
+	mClearActivePipelineState->SetName(L"mLightCullClearActivePass");
+
+	lightCullPassDesc.CS = mMarkActiveShader;
+	g_Device->CreateComputePipelineState(&lightCullPassDesc, IID_PPV_ARGS(&mMarkActivePipelineState));
+	mMarkActivePipelineState->SetName(L"mLightCullMarkActivePass");
+
+	lightCullPassDesc.CS = mCompactActiveShader;
+	g_Device->CreateComputePipelineState(&lightCullPassDesc, IID_PPV_ARGS(&mCompactActivePipelineState));
+	mCompactActivePipelineState->SetName(L"mLightCullCompactActivePass");
 }
 
 void Renderer::LightCullPass::CreateRS()
@@ -46,15 +115,44 @@ void Renderer::LightCullPass::CreateRS()
 	clusterBuffer.Descriptor.ShaderRegister = 2;
 	clusterBuffer.ShaderVisibility = D3D12_SHADER_VISIBILITY_ALL;
 
+	D3D12_ROOT_PARAMETER lightIndexBuffer = {};
+	lightIndexBuffer.ParameterType = D3D12_ROOT_PARAMETER_TYPE_UAV;
+	lightIndexBuffer.Descriptor.RegisterSpace = 0;
+	lightIndexBuffer.Descriptor.ShaderRegister = 3;
+	lightIndexBuffer.ShaderVisibility = D3D12_SHADER_VISIBILITY_ALL;
+
 	D3D12_ROOT_PARAMETER lightCullViewData = {};
 	lightCullViewData.ParameterType = D3D12_ROOT_PARAMETER_TYPE_CBV;
 	lightCullViewData.Descriptor.RegisterSpace = 0;
 	lightCullViewData.Descriptor.ShaderRegister = 0;
 	lightCullViewData.ShaderVisibility = D3D12_SHADER_VISIBILITY_ALL;
 
+	D3D12_ROOT_PARAMETER activeParams = {};
+	activeParams.ParameterType = D3D12_ROOT_PARAMETER_TYPE_32BIT_CONSTANTS;
+	activeParams.Constants.RegisterSpace = 0;
+	activeParams.Constants.ShaderRegister = 1;
+	activeParams.Constants.Num32BitValues = 2;
+	activeParams.ShaderVisibility = D3D12_SHADER_VISIBILITY_ALL;
+
+	//u4 active flags,u5 active list,u6 indirect arguments,u7 pixel depth ranges.
+	D3D12_ROOT_PARAMETER activeBuffers[4] = {};
+	for (UINT i = 0; i < 4; ++i)
+	{
+		activeBuffers[i].ParameterType = D3D12_ROOT_PARAMETER_TYPE_UAV;
+		activeBuffers[i].Descriptor.RegisterSpace = 0;
+		activeBuffers[i].Descriptor.ShaderRegister = 4 + i;
+		activeBuffers[i].ShaderVisibility = D3D12_SHADER_VISIBILITY_ALL;
+	}
+
+	CD3DX12_DESCRIPTOR_RANGE depthRange;
+	depthRange.Init(D3D12_DESCRIPTOR_RANGE_TYPE_SRV, 1, 0);
+	CD3DX12_ROOT_PARAMETER sceneDepth;
+	sceneDepth.InitAsDescriptorTable(1, &depthRange);
+
 	std::vector<D3D12_ROOT_PARAMETER> parameters =
 	{
-		lightCullViewData,lightBuffer,clusterBuffer
+		lightCullViewData,lightBuffer,clusterBuffer,lightIndexBuffer,activeParams,
+		activeBuffers[0],activeBuffers[1],activeBuffers[2],activeBuffers[3],sceneDepth
 	};
 	lightCullRootSignatureDesc.Init((UINT)parameters.size(), parameters.data(), 0, nullptr, D3D12_ROOT_SIGNATURE_FLAG_NONE);
 
@@ -72,3 +170,72 @@ void Renderer::LightCullPass::SetRenderPassStates(ID3D12GraphicsCommandList* InC
 	mGraphicsCmd->SetComputeRootSignature(mRS);
 }
 
+Renderer::ZBinTileMaskPass::ZBinTileMaskPass(std::shared_ptr<RendererContext> InGraphicsContext) :
+	BaseRenderPass("", "", InGraphicsContext)
+{
+	mVertexShader = Utils::ReadShader("ZBinCull.hlsl", "main", "cs_6_5");
+	CreateRS();
+	CreatePipelineState();
+}
+
+Renderer::ZBinTileMaskPass::~ZBinTileMaskPass()
+{
+
+}
+
+void Renderer::ZBinTileMaskPass::Dispatch(uint32_t InTileCountX, uint32_t InTileCountY, uint32_t InWordsPerTile)
+{
+	mGraphicsCmd->Dispatch((InTileCountX * InWordsPerTile + 63) / 64, InTileCountY, 1);
+}
+
+void Renderer::ZBinTileMaskPass::RenderScene(ID3D12GraphicsCommandList* InCmdList)
+{
+
+}
+
+void Renderer::ZBinTileMaskPass::CreatePipelineState()
+{
+	D3D12_COMPUTE_PIPELINE_STATE_DESC lDesc = {};
+	lDesc.CS = mVertexShader;
+	lDesc.pRootSignature = mRS;
+	g_Device->CreateComputePipelineState(&lDesc, IID_PPV_ARGS(&mPipelineState));
+	mPipelineState->SetName(L"mZBinTileMaskPass");
+}
+
+void Renderer::ZBinTileMaskPass::CreateRS()
+{
+	CD3DX12_ROOT_SIGNATURE_DESC lDesc;
+	D3D12_ROOT_PARAMETER constants = {};
+	constants.ParameterType = D3D12_ROOT_PARAMETER_TYPE_32BIT_CONSTANTS;
+	constants.Constants.RegisterSpace = 0;
+	constants.Constants.ShaderRegister = 0;
+	constants.Constants.Num32BitValues = 4;
+	constants.ShaderVisibility = D3D12_SHADER_VISIBILITY_ALL;
+
+	D3D12_ROOT_PARAMETER tileRects = {};
+	tileRects.ParameterType = D3D12_ROOT_PARAMETER_TYPE_SRV;
+	tileRects.Descriptor.RegisterSpace = 0;
+	tileRects.Descriptor.ShaderRegister = 0;
+	tileRects.ShaderVisibility = D3D12_SHADER_VISIBILITY_ALL;
+
+	D3D12_ROOT_PARAMETER tileMasks = {};
+	tileMasks.ParameterType = D3D12_ROOT_PARAMETER_TYPE_UAV;
+	tileMasks.Descriptor.RegisterSpace = 0;
+	tileMasks.Descriptor.ShaderRegister = 0;
+	tileMasks.ShaderVisibility = D3D12_SHADER_VISIBILITY_ALL;
+
+	std::vector<D3D12_ROOT_PARAMETER> parameters = { constants,tileRects,tileMasks };
+	lDesc.Init((UINT)parameters.size(), parameters.data(), 0, nullptr, D3D12_ROOT_SIGNATURE_FLAG_NONE);
+
+	ID3DBlob* signature;
+	ID3DBlob* error;
+	D3D12SerializeRootSignature(&lDesc, D3D_ROOT_SIGNATURE_VERSION_1, &signature, &error);
+	g_Device->CreateRootSignature(0, signature->GetBufferPointer(), signature->GetBufferSize(), IID_PPV_ARGS(&mRS));
+}
+
+void Renderer::ZBinTileMaskPass::SetRenderPassStates(ID3D12GraphicsCommandList* InCmdList)
+{
+	mGraphicsCmd = InCmdList;
+	mGraphicsCmd->SetPipelineState(mPipelineState);
+	mGraphicsCmd->SetComputeRootSignature(mRS);
+}
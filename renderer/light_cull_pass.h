@@ -4,13 +4,29 @@
 
 namespace Renderer
 {
+	//Builds the compacted cluster light lists:active cluster marking and compaction,then count,prefix sum and write passes
+	//over the active clusters through indirect dispatches.
+	//Root parameters:0 frame data CBV,1 light SRV,2 cluster UAV,3 light index UAV,4 active cluster constants,
+	//5 active flag UAV,6 active list UAV,7 indirect argument UAV,8 pixel depth range UAV,9 depth SRV table.
 	class LightCullPass final : public BaseRenderPass
 	{
 	public:
+		//Groups per row of the indirect dispatches,ACTIVE_GROUP_WIDTH in LightCull.hlsl.
+		static constexpr uint32_t ACTIVE_GROUP_WIDTH = 1024;
+		//Dispatch arguments followed by the active cluster count.
+		static constexpr uint32_t ACTIVE_ARGS_BYTES = 4 * sizeof(uint32_t);
+
 		LightCullPass(std::shared_ptr<RendererContext> InGraphicsContext);
 
 		~LightCullPass();
 
+		//Must match the grid in the bound frame data.
+		void SetClusterGrid(const ClusterGrid& InGrid) { mGrid = InGrid; }
+
+		//InArgs is the buffer bound at root parameter 7.Without InMarkFromDepth every cluster is active and the depth is not read.
+		//InWriteDepthRanges fills the pixel depth range buffer for the CPU reference,InWidth and InHeight are the depth buffer size.
+		void SetActiveClusters(ID3D12Resource* InArgs, bool InMarkFromDepth, bool InWriteDepthRanges, uint32_t InWidth, uint32_t InHeight);
+
 		void RenderScene(ID3D12GraphicsCommandList* InCmdList) override;
 
 		void CreatePipelineState() override;
@@ -20,6 +36,44 @@ namespace Renderer
 		void SetRenderPassStates(ID3D12GraphicsCommandList* InCmdList) override;
 
 	private:
+		//mPipelineState writes the indices.
+		ID3D12PipelineState* mCountPipelineState = nullptr;
+		ID3D12PipelineState* mOffsetsPipelineState = nullptr;
+		ID3D12PipelineState* mClearActivePipelineState = nullptr;
+		ID3D12PipelineState* mMarkActivePipelineState = nullptr;
+		ID3D12PipelineState* mCompactActivePipelineState = nullptr;
+		ID3D12CommandSignature* mDispatchSignature = nullptr;
+		D3D12_SHADER_BYTECODE mCountShader;
+		D3D12_SHADER_BYTECODE mOffsetsShader;
+		D3D12_SHADER_BYTECODE mClearActiveShader;
+		D3D12_SHADER_BYTECODE mMarkActiveShader;
+		D3D12_SHADER_BYTECODE mCompactActiveShader;
+		ClusterGrid mGrid;
+		ID3D12Resource* mActiveArgs = nullptr;
+		bool mMarkFromDepth = false;
+		bool mWriteDepthRanges = false;
+		uint32_t mDepthWidth = 0;
+		uint32_t mDepthHeight = 0;
+	};
+
+	//Z-binned light culling:expands the CPU built tile rects into per tile light masks.
+	//Root parameters:0 constants (tile count x,tile count y,words per tile,light count),1 tile rect SRV,2 tile mask UAV.
+	class ZBinTileMaskPass final : public BaseRenderPass
+	{
+	public:
+		ZBinTileMaskPass(std::shared_ptr<RendererContext> InGraphicsContext);
+
+		~ZBinTileMaskPass();
 
+		//Set the root parameters before calling.
+		void Dispatch(uint32_t InTileCountX, uint32_t InTileCountY, uint32_t InWordsPerTile);
+
+		void RenderScene(ID3D12GraphicsCommandList* InCmdList) override;
+
+		void CreatePipelineState() override;
+
+		void CreateRS() override;
+
+		void SetRenderPassStates(ID3D12GraphicsCommandList* InCmdList) override;
 	};
 }
\ No newline at end of file
@@ -0,0 +1,35 @@
+#include "material_table.h"
+
+Renderer::MaterialTable::MaterialTable()
+{
+
+}
+
+Renderer::MaterialTable::~MaterialTable()
+{
+
+}
+
+void Renderer::MaterialTable::SetDefaultTextures(uint32_t InBaseColor, uint32_t InNormal)
+{
+	mDefaultBaseColor = InBaseColor;
+	mDefaultNormal = InNormal;
+}
+
+void Renderer::MaterialTable::Pack(std::span<const ECS::MaterialDesc> InMaterials, const ResolveTexture& InResolve)
+{
+	auto lResolve = [&InResolve](AssetLoader::TextureHandle InTexture, uint32_t InDefault)
+		{
+			const uint32_t lIndex = InResolve(InTexture);
+			return lIndex == INVALID_TEXTURE ? InDefault : lIndex;
+		};
+	mMaterials.resize(InMaterials.size());
+	for (size_t i = 0; i < InMaterials.size(); ++i)
+	{
+		auto& lMaterial = mMaterials[i];
+		lMaterial = {};
+		lMaterial.mBaseColorTexture = lResolve(InMaterials[i].mBaseColor, mDefaultBaseColor);
+		lMaterial.mNormalTexture = lResolve(InMaterials[i].mNormalMap, mDefaultNormal);
+		lMaterial.mBaseColorFactor = InMaterials[i].mBaseColorFactor;
+	}
+}
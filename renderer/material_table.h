@@ -0,0 +1,43 @@
+#pragma once
+#include "components.h"
+
+namespace Renderer
+{
+	//One material as the color pass reads it,MaterialData in shader_common.hlsli.
+	struct GpuMaterial
+	{
+		//Indices into the bindless texture range,the persistent descriptors of the CBV_SRV_UAV heap.
+		uint32_t mBaseColorTexture;
+		uint32_t mNormalTexture;
+		uint32_t mPadding[2];
+		DirectX::XMFLOAT4 mBaseColorFactor;
+	};
+	static_assert(sizeof(GpuMaterial) == 32);
+
+	//Packs the MeshStore materials into GpuMaterials indexed by MaterialId,so a draw only passes its material index.
+	//Texture handles are resolved through a callback,so packing runs without a device.
+	class MaterialTable
+	{
+	public:
+		static constexpr uint32_t INVALID_TEXTURE = UINT32_MAX;
+
+		//Maps a texture to its descriptor index,INVALID_TEXTURE when it is not resident.
+		using ResolveTexture = std::function<uint32_t(AssetLoader::TextureHandle)>;
+
+		MaterialTable();
+
+		~MaterialTable();
+
+		//Indices a material gets for a texture that does not resolve.
+		void SetDefaultTextures(uint32_t InBaseColor, uint32_t InNormal);
+
+		void Pack(std::span<const ECS::MaterialDesc> InMaterials, const ResolveTexture& InResolve);
+
+		std::span<const GpuMaterial> GetMaterials() const { return mMaterials; }
+
+	private:
+		uint32_t mDefaultBaseColor = 0;
+		uint32_t mDefaultNormal = 0;
+		std::vector<GpuMaterial> mMaterials;
+	};
+}
@@ -26,6 +26,18 @@ void Renderer::MeshShaderPass::RenderScene(ID3D12GraphicsCommandList* InCmdList)
 	
 }
 
+uint32_t Renderer::MeshShaderPass::Draw(ID3D12GraphicsCommandList6* InCmdList, uint32_t InGroups)
+{
+	uint32_t lDispatches = 0;
+	for (uint32_t lFirst = 0; lFirst < InGroups; lFirst += MAX_GROUPS_PER_DISPATCH)
+	{
+		InCmdList->SetGraphicsRoot32BitConstant(MESH_FIRST_GROUP_ROOT_PARAMETER_INDEX, lFirst, 0);
+		InCmdList->DispatchMesh(std::min(InGroups - lFirst, MAX_GROUPS_PER_DISPATCH), 1, 1);
+		lDispatches++;
+	}
+	return lDispatches;
+}
+
 void Renderer::MeshShaderPass::CreatePipelineState()
 {
 	D3DX12_MESH_SHADER_PIPELINE_STATE_DESC psoDesc = {};
@@ -58,7 +70,7 @@ void Renderer::MeshShaderPass::CreateRS()
 {
 	// Define the root signature
 	std::vector<CD3DX12_ROOT_PARAMETER1> rootParameters;
-	rootParameters.resize(3);
+	rootParameters.resize(8);
 	D3D12_DESCRIPTOR_RANGE1 ranges[4];
 
 	for (size_t i = 0; i < 4; i++)
@@ -71,8 +83,13 @@ void Renderer::MeshShaderPass::CreateRS()
 		ranges[i].Flags = D3D12_DESCRIPTOR_RANGE_FLAG_NONE;
 	}
 	rootParameters[0].InitAsDescriptorTable(4, ranges);
-	rootParameters[1].InitAsConstants(MESH_CONSTANTS_32BITS_NUM, 0);
-	rootParameters[2].InitAsConstantBufferView(1);
+	rootParameters[MESH_CULL_CONSTANTS_ROOT_PARAMETER_INDEX].InitAsConstantBufferView(0);
+	rootParameters[MESH_FRAME_DATA_ROOT_PARAMETER_INDEX].InitAsConstantBufferView(1);
+	rootParameters[MESH_CULL_BOUNDS_ROOT_PARAMETER_INDEX].InitAsShaderResourceView(4);
+	rootParameters[MESH_INSTANCES_ROOT_PARAMETER_INDEX].InitAsShaderResourceView(5);
+	rootParameters[MESH_GROUPS_ROOT_PARAMETER_INDEX].InitAsShaderResourceView(6);
+	rootParameters[MESH_CULL_COUNTS_ROOT_PARAMETER_INDEX].InitAsUnorderedAccessView(0);
+	rootParameters[MESH_FIRST_GROUP_ROOT_PARAMETER_INDEX].InitAsConstants(1, 2);
 	// Create the root signature
 	CD3DX12_VERSIONED_ROOT_SIGNATURE_DESC rootSignatureDesc;
 	rootSignatureDesc.Init_1_1(rootParameters.size(), rootParameters.data(), 0, nullptr, D3D12_ROOT_SIGNATURE_FLAG_ALLOW_INPUT_ASSEMBLER_INPUT_LAYOUT);
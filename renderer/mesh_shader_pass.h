@@ -1,24 +1,35 @@
 #include "render_pass.h"
+#include "meshlet_cull.h"
 
 namespace Renderer
 {
-	struct MeshShaderConstants
-	{
-		DirectX::SimpleMath::Matrix mModelMatrix;
-		ECS::StaticMeshComponentMeshOffset mMeshOffsets;
-	};
 	constexpr int MESH_VERTEX_ROOT_PARAMETER_INDEX = 0;
-	constexpr int MESH_CONSTANTS_ROOT_PARAMETER_INDEX = 1;
+	//MeshletCullConstants
+	constexpr int MESH_CULL_CONSTANTS_ROOT_PARAMETER_INDEX = 1;
 	constexpr int MESH_FRAME_DATA_ROOT_PARAMETER_INDEX = 2;
-	constexpr int MESH_CONSTANTS_32BITS_NUM = sizeof(MeshShaderConstants) / 4;
+	//MeshletCullBounds of every meshlet in the scene
+	constexpr int MESH_CULL_BOUNDS_ROOT_PARAMETER_INDEX = 3;
+	constexpr int MESH_INSTANCES_ROOT_PARAMETER_INDEX = 4;
+	constexpr int MESH_GROUPS_ROOT_PARAMETER_INDEX = 5;
+	//MeshletCullCounts UAV
+	constexpr int MESH_CULL_COUNTS_ROOT_PARAMETER_INDEX = 6;
+	//First MeshletGroup of a dispatch
+	constexpr int MESH_FIRST_GROUP_ROOT_PARAMETER_INDEX = 7;
 	
 
 	class MeshShaderPass : public BaseRenderPass
 	{
 	public:
+		//Amplification groups one DispatchMesh may launch.
+		static constexpr uint32_t MAX_GROUPS_PER_DISPATCH = 65535;
+
 		MeshShaderPass(std::string_view InAmplifyShader,std::string_view InMeshShader, std::string_view InPixelShader, std::shared_ptr<RendererContext> InGraphicsContext);
 		~MeshShaderPass();
 
+		//Cull and draw InGroups groups of the bound MeshletGroup table,in as few dispatches as the limit allows.
+		//The states and the other root parameters have to be set on InCmdList.Returns the dispatches issued.
+		uint32_t Draw(ID3D12GraphicsCommandList6* InCmdList, uint32_t InGroups);
+
 	public:
 		// Inherited via BaseRenderPass
 		void RenderScene(ID3D12GraphicsCommandList* InCmdList) override;
@@ -0,0 +1,189 @@
+#include "meshlet_cull.h"
+
+using namespace DirectX;
+
+namespace
+{
+	XMFLOAT3 TransformPoint(const XMFLOAT4* InRows, const XMFLOAT3& InPoint)
+	{
+		//Same operation order as the shader,no fused multiply adds there either.
+		return XMFLOAT3(
+			InPoint.x * InRows[0].x + InPoint.y * InRows[1].x + InPoint.z * InRows[2].x + InRows[3].x,
+			InPoint.x * InRows[0].y + InPoint.y * InRows[1].y + InPoint.z * InRows[2].y + InRows[3].y,
+			InPoint.x * InRows[0].z + InPoint.y * InRows[1].z + InPoint.z * InRows[2].z + InRows[3].z);
+	}
+
+	float Dot(const XMFLOAT3& InA, const XMFLOAT3& InB)
+	{
+		return InA.x * InB.x + InA.y * InB.y + InA.z * InB.z;
+	}
+
+	XMFLOAT3 UnpackConeAxis(uint32_t InCone)
+	{
+		constexpr float lScale = 2.0f / 255.0f;
+		return XMFLOAT3(float(InCone & 0xff) * lScale - 1.0f, float((InCone >> 8) & 0xff) * lScale - 1.0f, float((InCone >> 16) & 0xff) * lScale - 1.0f);
+	}
+}
+
+Renderer::MeshletCullReference::MeshletCullReference()
+{
+
+}
+
+Renderer::MeshletCullReference::~MeshletCullReference()
+{
+
+}
+
+Renderer::MeshletCullBounds Renderer::MeshletCullReference::MakeBounds(const DirectX::CullData& InCullData)
+{
+	MeshletCullBounds lBounds = {};
+	lBounds.mCenter = InCullData.BoundingSphere.Center;
+	lBounds.mRadius = InCullData.BoundingSphere.Radius;
+	lBounds.mCone = InCullData.NormalCone.v;
+	//apex = center - axis * offset,with the quantized axis the shader tests against.
+	const XMFLOAT3 lConeAxis = UnpackConeAxis(lBounds.mCone);
+	const XMVECTOR lAxis = XMVector3Normalize(XMLoadFloat3(&lConeAxis));
+	XMStoreFloat3(&lBounds.mConeApex, XMVectorSubtract(XMLoadFloat3(&lBounds.mCenter), XMVectorScale(lAxis, InCullData.ApexOffset)));
+	return lBounds;
+}
+
+Renderer::MeshletInstance Renderer::MeshletCullReference::MakeInstance(const DirectX::SimpleMath::Matrix& InModelMatrix, const ECS::StaticMeshComponentMeshOffset& InOffsets)
+{
+	MeshletInstance lInstance = {};
+	for (int i = 0; i < 4; ++i)
+	{
+		lInstance.mModelMatrix[i] = XMFLOAT4(InModelMatrix.m[i]);
+	}
+	lInstance.mOffsets = InOffsets;
+	float lMinScale = FLT_MAX;
+	for (int i = 0; i < 3; ++i)
+	{
+		const float lScale = XMVectorGetX(XMVector3Length(XMLoadFloat4(&lInstance.mModelMatrix[i])));
+		lInstance.mScale = std::max(lInstance.mScale, lScale);
+		lMinScale = std::min(lMinScale, lScale);
+	}
+	//A non uniform scale bends the normals,their cones no longer bound them.
+	if (lInstance.mScale - lMinScale <= lInstance.mScale * 1e-3f)
+	{
+		lInstance.mFlags |= MESHLET_INSTANCE_CONE_CULL;
+	}
+	return lInstance;
+}
+
+Renderer::MeshletCullConstants Renderer::MeshletCullReference::MakeConstants(const DirectX::SimpleMath::Matrix& InViewPrj, const DirectX::SimpleMath::Matrix& InPrj,
+	const DirectX::SimpleMath::Vector3& InEye, float InViewHeight, uint32_t InFlags, float InMinPixels)
+{
+	MeshletCullConstants lConstants = {};
+	for (int i = 0; i < 4; ++i)
+	{
+		lConstants.mViewPrj[i] = XMFLOAT4(InViewPrj.m[i]);
+	}
+	auto lColumn = [&InViewPrj](int InColumn)
+		{
+			return XMVectorSet(InViewPrj.m[0][InColumn], InViewPrj.m[1][InColumn], InViewPrj.m[2][InColumn], InViewPrj.m[3][InColumn]);
+		};
+	//Inside is -w <= x <= w,-w <= y <= w and z <= w,the far plane is left out.
+	const XMVECTOR lPlanes[MeshletCullConstants::PLANE_COUNT] = {
+		XMVectorAdd(lColumn(3), lColumn(0)),
+		XMVectorSubtract(lColumn(3), lColumn(0)),
+		XMVectorAdd(lColumn(3), lColumn(1)),
+		XMVectorSubtract(lColumn(3), lColumn(1)),
+		XMVectorSubtract(lColumn(3), lColumn(2)) };
+	for (uint32_t i = 0; i < MeshletCullConstants::PLANE_COUNT; ++i)
+	{
+		XMStoreFloat4(&lConstants.mPlanes[i], XMPlaneNormalize(lPlanes[i]));
+	}
+	lConstants.mEye = InEye;
+	lConstants.mFlags = InFlags;
+	lConstants.mProjScale = InPrj.m[1][1] * InViewHeight * 0.5f;
+	lConstants.mMinPixels = InMinPixels;
+	return lConstants;
+}
+
+bool Renderer::MeshletCullReference::IsFrustumCulled(const MeshletCullConstants& InConstants, const DirectX::XMFLOAT3& InCenter, float InRadius)
+{
+	for (const auto& plane : InConstants.mPlanes)
+	{
+		if (InCenter.x * plane.x + InCenter.y * plane.y + InCenter.z * plane.z + plane.w < -InRadius)
+		{
+			return true;
+		}
+	}
+	return false;
+}
+
+bool Renderer::MeshletCullReference::IsSmallCulled(const MeshletCullConstants& InConstants, const DirectX::XMFLOAT3& InCenter, float InRadius)
+{
+	const XMFLOAT4* lRows = InConstants.mViewPrj;
+	const float lW = InCenter.x * lRows[0].w + InCenter.y * lRows[1].w + InCenter.z * lRows[2].w + lRows[3].w;
+	//Never true behind the eye,w is not positive there.
+	return 2.0f * InRadius * InConstants.mProjScale < InConstants.mMinPixels * lW;
+}
+
+bool Renderer::MeshletCullReference::IsConeCulled(const MeshletCullConstants& InConstants, const MeshletInstance& InInstance, const MeshletCullBounds& InBounds)
+{
+	//A cutoff of 0xff marks a cone wider than a hemisphere.
+	if (!(InInstance.mFlags & MESHLET_INSTANCE_CONE_CULL) || (InBounds.mCone >> 24) == 0xff)
+	{
+		return false;
+	}
+	const XMFLOAT3 lLocalAxis = UnpackConeAxis(InBounds.mCone);
+	const float lCutoff = float(InBounds.mCone >> 24) * (1.0f / 255.0f);
+	const XMFLOAT4* lRows = InInstance.mModelMatrix;
+	const XMFLOAT3 lAxis(
+		lLocalAxis.x * lRows[0].x + lLocalAxis.y * lRows[1].x + lLocalAxis.z * lRows[2].x,
+		lLocalAxis.x * lRows[0].y + lLocalAxis.y * lRows[1].y + lLocalAxis.z * lRows[2].y,
+		lLocalAxis.x * lRows[0].z + lLocalAxis.y * lRows[1].z + lLocalAxis.z * lRows[2].z);
+	const XMFLOAT3 lApex = TransformPoint(lRows, InBounds.mConeApex);
+	const XMFLOAT3 lView(InConstants.mEye.x - lApex.x, InConstants.mEye.y - lApex.y, InConstants.mEye.z - lApex.z);
+	//dot(normalize(view),-normalize(axis)) > cutoff,squared so neither side needs a square root.
+	const float lFacing = -Dot(lView, lAxis);
+	return lFacing > 0.0f && lFacing * lFacing > lCutoff * lCutoff * Dot(lView, lView) * Dot(lAxis, lAxis);
+}
+
+void Renderer::MeshletCullReference::AddMesh(uint32_t InMeshletOffset, std::span<const MeshletCullBounds> InBounds)
+{
+	mMeshes[InMeshletOffset].assign(InBounds.begin(), InBounds.end());
+}
+
+void Renderer::MeshletCullReference::RemoveMesh(uint32_t InMeshletOffset)
+{
+	mMeshes.erase(InMeshletOffset);
+}
+
+void Renderer::MeshletCullReference::Cull(const MeshletCullConstants& InConstants, std::span<const MeshletInstance> InInstances, std::span<const MeshletGroup> InGroups)
+{
+	mCounts = {};
+	for (const auto& group : InGroups)
+	{
+		const auto& lInstance = InInstances[group.mInstance];
+		auto lMesh = mMeshes.find(lInstance.mOffsets.MeshletOffset);
+		Expects(lMesh != mMeshes.end());
+		const uint32_t lFirst = group.mFirstMeshlet - lInstance.mOffsets.MeshletOffset;
+		Expects(lFirst + group.mMeshletCount <= lMesh->second.size());
+		for (uint32_t i = 0; i < group.mMeshletCount; ++i)
+		{
+			const auto& lBounds = lMesh->second[lFirst + i];
+			const XMFLOAT3 lCenter = TransformPoint(lInstance.mModelMatrix, lBounds.mCenter);
+			const float lRadius = lBounds.mRadius * lInstance.mScale;
+			mCounts.mMeshlets++;
+			if ((InConstants.mFlags & MESHLET_CULL_FRUSTUM) && IsFrustumCulled(InConstants, lCenter, lRadius))
+			{
+				mCounts.mFrustumCulled++;
+			}
+			else if ((InConstants.mFlags & MESHLET_CULL_SMALL) && IsSmallCulled(InConstants, lCenter, lRadius))
+			{
+				mCounts.mSmallCulled++;
+			}
+			else if ((InConstants.mFlags & MESHLET_CULL_CONE) && IsConeCulled(InConstants, lInstance, lBounds))
+			{
+				mCounts.mConeCulled++;
+			}
+			else
+			{
+				mCounts.mVisible++;
+			}
+		}
+	}
+}
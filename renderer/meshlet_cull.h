@@ -0,0 +1,133 @@
+#pragma once
+#include "components.h"
+
+namespace Renderer
+{
+	//MeshletCullConstants::mFlags,the tests the amplification shader runs.
+	constexpr uint32_t MESHLET_CULL_FRUSTUM = 0x1;
+	constexpr uint32_t MESHLET_CULL_CONE = 0x2;
+	constexpr uint32_t MESHLET_CULL_SMALL = 0x4;
+
+	//MeshletInstance::mFlags.
+	//Uniformly scaled,the normal cones of its meshlets stay valid in world space.
+	constexpr uint32_t MESHLET_INSTANCE_CONE_CULL = 0x1;
+
+	//Object space culling data of one meshlet,MeshletCullBounds in meshlet_common.hlsli.
+	//Built from DirectX::CullData when the mesh is uploaded,so the shader needs no square root.
+	struct MeshletCullBounds
+	{
+		DirectX::XMFLOAT3 mCenter;
+		float mRadius;
+		DirectX::XMFLOAT3 mConeApex;
+		//DirectX::CullData::NormalCone,axis in xyz as unorm bytes,the cutoff in w.
+		uint32_t mCone;
+	};
+	static_assert(sizeof(MeshletCullBounds) == 32);
+
+	//One entity of the mesh shader batch,MeshletInstance in meshlet_common.hlsli.
+	struct MeshletInstance
+	{
+		//Rows of a row vector matrix,world = x * row0 + y * row1 + z * row2 + row3.
+		DirectX::XMFLOAT4 mModelMatrix[4];
+		ECS::StaticMeshComponentMeshOffset mOffsets;
+		//Largest axis scale of the model matrix,applied to the bounding spheres.
+		float mScale;
+		uint32_t mFlags;
+		uint32_t mPadding[2];
+	};
+	static_assert(sizeof(MeshletInstance) == 96);
+
+	//Up to MAX_MESHLET_PER_THREAD_GROUP meshlets of one instance,culled by one amplification group.
+	struct MeshletGroup
+	{
+		uint32_t mInstance;
+		//In the scene meshlet buffer.
+		uint32_t mFirstMeshlet;
+		uint32_t mMeshletCount;
+		uint32_t mPadding;
+	};
+	static_assert(sizeof(MeshletGroup) == 16);
+
+	//Constants of the batch,MeshletCullConstants in meshlet_common.hlsli.
+	struct MeshletCullConstants
+	{
+		static constexpr uint32_t PLANE_COUNT = 5;
+
+		//Rows of a row vector matrix,clip = x * row0 + y * row1 + z * row2 + row3.
+		DirectX::XMFLOAT4 mViewPrj[4];
+		//Left,right,bottom,top and the reversed Z near plane,normalized so xyz * p + w is the distance to the inside.
+		DirectX::XMFLOAT4 mPlanes[PLANE_COUNT];
+		DirectX::XMFLOAT3 mEye;
+		uint32_t mFlags;
+		//A sphere of radius r at clip w is r * mProjScale / w pixels tall.
+		float mProjScale;
+		//Meshlets whose bounding sphere is less than this many pixels across are culled.
+		float mMinPixels;
+		uint32_t mPadding[2];
+	};
+	static_assert(sizeof(MeshletCullConstants) == 176);
+
+	//Written by the amplification shader,every tested meshlet is counted by the first test culling it.
+	struct MeshletCullCounts
+	{
+		uint32_t mMeshlets = 0;
+		uint32_t mFrustumCulled = 0;
+		uint32_t mSmallCulled = 0;
+		uint32_t mConeCulled = 0;
+		//Mesh shader groups launched.
+		uint32_t mVisible = 0;
+
+		bool operator==(const MeshletCullCounts&) const = default;
+	};
+	static_assert(sizeof(MeshletCullCounts) == 20);
+
+	struct MeshletCullStats
+	{
+		uint32_t mInstances = 0;
+		uint32_t mGroups = 0;
+		uint32_t mDispatches = 0;
+		//Of the frame that last used the frame slot,read back once it completed.
+		MeshletCullCounts mCounts;
+		//Filled by validation against MeshletCullReference.
+		MeshletCullCounts mExpected;
+		uint32_t mMismatchedFrames = 0;
+	};
+
+	//C++ port of the culling in AmplifyShader.hlsl:the same tests in the same order on the same data,
+	//so the survivor counts of the GPU can be checked and the tests measured without a device.
+	class MeshletCullReference
+	{
+	public:
+		MeshletCullReference();
+
+		~MeshletCullReference();
+
+		static MeshletCullBounds MakeBounds(const DirectX::CullData& InCullData);
+
+		static MeshletInstance MakeInstance(const DirectX::SimpleMath::Matrix& InModelMatrix, const ECS::StaticMeshComponentMeshOffset& InOffsets);
+
+		//InViewPrj and InPrj are row vector matrices,InViewHeight is in pixels.
+		static MeshletCullConstants MakeConstants(const DirectX::SimpleMath::Matrix& InViewPrj, const DirectX::SimpleMath::Matrix& InPrj,
+			const DirectX::SimpleMath::Vector3& InEye, float InViewHeight, uint32_t InFlags, float InMinPixels);
+
+		static bool IsFrustumCulled(const MeshletCullConstants& InConstants, const DirectX::XMFLOAT3& InCenter, float InRadius);
+
+		static bool IsSmallCulled(const MeshletCullConstants& InConstants, const DirectX::XMFLOAT3& InCenter, float InRadius);
+
+		static bool IsConeCulled(const MeshletCullConstants& InConstants, const MeshletInstance& InInstance, const MeshletCullBounds& InBounds);
+
+		//Keep a copy of the bounds of a mesh uploaded at InMeshletOffset of the scene meshlet buffer.
+		void AddMesh(uint32_t InMeshletOffset, std::span<const MeshletCullBounds> InBounds);
+
+		void RemoveMesh(uint32_t InMeshletOffset);
+
+		//Cull every group of the batch,every mesh of InInstances has to be added.
+		void Cull(const MeshletCullConstants& InConstants, std::span<const MeshletInstance> InInstances, std::span<const MeshletGroup> InGroups);
+
+		const MeshletCullCounts& GetCounts() const { return mCounts; }
+
+	private:
+		std::unordered_map<uint32_t, std::vector<MeshletCullBounds>> mMeshes;
+		MeshletCullCounts mCounts;
+	};
+}
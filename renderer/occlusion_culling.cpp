@@ -0,0 +1,261 @@
+#include "occlusion_culling.h"
+
+using namespace DirectX;
+
+Renderer::SoftwareOcclusionCuller::SoftwareOcclusionCuller(int InWidth, int InHeight):
+	mWidth(InWidth),
+	mHeight(InHeight),
+	mTilesX(InWidth / HIZ_TILE_SIZE),
+	mTilesY(InHeight / HIZ_TILE_SIZE)
+{
+	//Rows are processed 4 pixels at a time and tiles must cover the buffer exactly.
+	Expects(InWidth > 0 && InHeight > 0);
+	Expects(InWidth % HIZ_TILE_SIZE == 0 && InHeight % HIZ_TILE_SIZE == 0);
+	mDepth.resize(size_t(mWidth) * mHeight, 0.0f);
+	mHiZ.resize(size_t(mTilesX) * mTilesY, 0.0f);
+}
+
+Renderer::SoftwareOcclusionCuller::~SoftwareOcclusionCuller()
+{
+
+}
+
+void Renderer::SoftwareOcclusionCuller::BeginFrame(const DirectX::SimpleMath::Matrix& InViewPrj)
+{
+	mViewPrj = InViewPrj;
+	std::fill(mDepth.begin(), mDepth.end(), 0.0f);
+	std::fill(mHiZ.begin(), mHiZ.end(), 0.0f);
+	mRasterizedTriangles = 0;
+}
+
+void Renderer::SoftwareOcclusionCuller::RasterizeOccluder(const void* InPositions, size_t InStride, size_t InVertexCount,
+	std::span<const uint32_t> InIndices, const DirectX::SimpleMath::Matrix& InModel)
+{
+	XMMATRIX lModelViewPrj = XMMatrixMultiply(InModel, mViewPrj);
+	mClipVertices.resize(InVertexCount);
+	XMVector3TransformStream(mClipVertices.data(), sizeof(XMFLOAT4),
+		reinterpret_cast<const XMFLOAT3*>(InPositions), InStride, InVertexCount, lModelViewPrj);
+
+	const XMVECTOR lScale = XMVectorSet(0.5f * mWidth, -0.5f * mHeight, 1.0f, 1.0f);
+	const XMVECTOR lOffset = XMVectorSet(0.5f * mWidth, 0.5f * mHeight, 0.0f, 0.0f);
+	for (size_t i = 0; i + 2 < InIndices.size(); i += 3)
+	{
+		XMVECTOR lClip[3];
+		bool lBehindNear = false;
+		for (int v = 0; v < 3; ++v)
+		{
+			uint32_t lIndex = InIndices[i + v];
+			if (lIndex >= InVertexCount)
+			{
+				lBehindNear = true;
+				break;
+			}
+			lClip[v] = XMLoadFloat4(&mClipVertices[lIndex]);
+			//Reversed infinite projection:z is the near plane distance,anything with z > w is in front of the near plane.
+			if (XMVectorGetZ(lClip[v]) > XMVectorGetW(lClip[v]))
+			{
+				lBehindNear = true;
+			}
+		}
+		//Dropping a near clipped occluder triangle only makes the buffer less occluding,never wrong.
+		if (lBehindNear)
+		{
+			continue;
+		}
+		XMVECTOR lScreen[3];
+		for (int v = 0; v < 3; ++v)
+		{
+			XMVECTOR lNdc = XMVectorDivide(lClip[v], XMVectorSplatW(lClip[v]));
+			lScreen[v] = XMVectorMultiplyAdd(lNdc, lScale, lOffset);
+		}
+		RasterizeTriangle(lScreen[0], lScreen[1], lScreen[2]);
+	}
+}
+
+void Renderer::SoftwareOcclusionCuller::RasterizeTriangle(DirectX::FXMVECTOR InV0, DirectX::FXMVECTOR InV1, DirectX::FXMVECTOR InV2)
+{
+	XMFLOAT3 v0, v1, v2;
+	XMStoreFloat3(&v0, InV0);
+	XMStoreFloat3(&v1, InV1);
+	XMStoreFloat3(&v2, InV2);
+
+	//Clockwise in screen space (y down) is front facing,same as the default D3D12 rasterizer state.
+	float lArea = (v1.x - v0.x) * (v2.y - v0.y) - (v2.x - v0.x) * (v1.y - v0.y);
+	if (lArea <= 0.0f)
+	{
+		return;
+	}
+
+	int lMinX = std::max(0, int(std::floor(std::min({ v0.x, v1.x, v2.x }))));
+	int lMaxX = std::min(mWidth - 1, int(std::floor(std::max({ v0.x, v1.x, v2.x }))));
+	int lMinY = std::max(0, int(std::floor(std::min({ v0.y, v1.y, v2.y }))));
+	int lMaxY = std::min(mHeight - 1, int(std::floor(std::max({ v0.y, v1.y, v2.y }))));
+	if (lMinX > lMaxX || lMinY > lMaxY)
+	{
+		return;
+	}
+	lMinX &= ~3;
+	mRasterizedTriangles++;
+
+	//Flat conservative depth:the farthest vertex,so the occluder never claims to be nearer than it is.
+	float lDepth = std::clamp(std::min({ v0.z, v1.z, v2.z }), 0.0f, 1.0f);
+
+	//Edge function E(p) = A * px + B * py + C,inside when all three are >= 0.
+	const float A0 = v0.y - v1.y, B0 = v1.x - v0.x, C0 = (v1.y - v0.y) * v0.x - (v1.x - v0.x) * v0.y;
+	const float A1 = v1.y - v2.y, B1 = v2.x - v1.x, C1 = (v2.y - v1.y) * v1.x - (v2.x - v1.x) * v1.y;
+	const float A2 = v2.y - v0.y, B2 = v0.x - v2.x, C2 = (v0.y - v2.y) * v2.x - (v0.x - v2.x) * v2.y;
+
+	const XMVECTOR lPixelCenters = XMVectorSet(0.5f, 1.5f, 2.5f, 3.5f);
+	const XMVECTOR lA0 = XMVectorReplicate(A0);
+	const XMVECTOR lA1 = XMVectorReplicate(A1);
+	const XMVECTOR lA2 = XMVectorReplicate(A2);
+	const XMVECTOR lTriDepth = XMVectorReplicate(lDepth);
+	const XMVECTOR lZero = XMVectorZero();
+
+	for (int y = lMinY; y <= lMaxY; ++y)
+	{
+		float py = float(y) + 0.5f;
+		XMVECTOR lRow0 = XMVectorReplicate(B0 * py + C0);
+		XMVECTOR lRow1 = XMVectorReplicate(B1 * py + C1);
+		XMVECTOR lRow2 = XMVectorReplicate(B2 * py + C2);
+		float* lDepthRow = mDepth.data() + size_t(y) * mWidth;
+		for (int x = lMinX; x <= lMaxX; x += 4)
+		{
+			XMVECTOR px = XMVectorAdd(XMVectorReplicate(float(x)), lPixelCenters);
+			XMVECTOR e0 = XMVectorMultiplyAdd(lA0, px, lRow0);
+			XMVECTOR e1 = XMVectorMultiplyAdd(lA1, px, lRow1);
+			XMVECTOR e2 = XMVectorMultiplyAdd(lA2, px, lRow2);
+			XMVECTOR lInside = XMVectorAndInt(XMVectorAndInt(XMVectorGreaterOrEqual(e0, lZero), XMVectorGreaterOrEqual(e1, lZero)),
+				XMVectorGreaterOrEqual(e2, lZero));
+			if (XMVector4EqualInt(lInside, XMVectorFalseInt()))
+			{
+				continue;
+			}
+			XMFLOAT4* lDst = reinterpret_cast<XMFLOAT4*>(lDepthRow + x);
+			XMVECTOR lOld = XMLoadFloat4(lDst);
+			XMStoreFloat4(lDst, XMVectorSelect(lOld, XMVectorMax(lOld, lTriDepth), lInside));
+		}
+	}
+}
+
+void Renderer::SoftwareOcclusionCuller::BuildHierarchy()
+{
+	for (int ty = 0; ty < mTilesY; ++ty)
+	{
+		for (int tx = 0; tx < mTilesX; ++tx)
+		{
+			XMVECTOR lMin = XMVectorReplicate(1.0f);
+			for (int y = ty * HIZ_TILE_SIZE; y < (ty + 1) * HIZ_TILE_SIZE; ++y)
+			{
+				const float* lRow = mDepth.data() + size_t(y) * mWidth + tx * HIZ_TILE_SIZE;
+				for (int x = 0; x < HIZ_TILE_SIZE; x += 4)
+				{
+					lMin = XMVectorMin(lMin, XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(lRow + x)));
+				}
+			}
+			XMFLOAT4 lLanes;
+			XMStoreFloat4(&lLanes, lMin);
+			mHiZ[size_t(ty) * mTilesX + tx] = std::min({ lLanes.x, lLanes.y, lLanes.z, lLanes.w });
+		}
+	}
+}
+
+Renderer::ScreenRect Renderer::SoftwareOcclusionCuller::ProjectBounds(const DirectX::BoundingBox& InWorldBounds) const
+{
+	ScreenRect lRect = {};
+	XMFLOAT3 lCorners[BoundingBox::CORNER_COUNT];
+	InWorldBounds.GetCorners(lCorners);
+	XMFLOAT4 lClip[BoundingBox::CORNER_COUNT];
+	XMVector3TransformStream(lClip, sizeof(XMFLOAT4), lCorners, sizeof(XMFLOAT3), BoundingBox::CORNER_COUNT, mViewPrj);
+
+	//Outcodes against left,right,bottom,top and near,the infinite projection has no far plane.
+	uint32_t lAllOutside = 0x1f;
+	float lMinX = FLT_MAX, lMinY = FLT_MAX, lMaxX = -FLT_MAX, lMaxY = -FLT_MAX;
+	for (const auto& c : lClip)
+	{
+		uint32_t lCode = 0;
+		lCode |= c.x < -c.w ? 0x1 : 0;
+		lCode |= c.x > c.w ? 0x2 : 0;
+		lCode |= c.y < -c.w ? 0x4 : 0;
+		lCode |= c.y > c.w ? 0x8 : 0;
+		lCode |= c.z > c.w ? 0x10 : 0;
+		lAllOutside &= lCode;
+		if (lCode & 0x10)
+		{
+			lRect.mCrossNearPlane = true;
+			continue;
+		}
+		float lInvW = 1.0f / c.w;
+		float sx = (c.x * lInvW * 0.5f + 0.5f) * mWidth;
+		float sy = (0.5f - c.y * lInvW * 0.5f) * mHeight;
+		lMinX = std::min(lMinX, sx);
+		lMaxX = std::max(lMaxX, sx);
+		lMinY = std::min(lMinY, sy);
+		lMaxY = std::max(lMaxY, sy);
+		lRect.mNearestDepth = std::max(lRect.mNearestDepth, c.z * lInvW);
+	}
+	if (lAllOutside != 0)
+	{
+		lRect.mOutsideFrustum = true;
+		return lRect;
+	}
+	if (lRect.mCrossNearPlane)
+	{
+		lRect.mMinX = 0;
+		lRect.mMinY = 0;
+		lRect.mMaxX = mWidth - 1;
+		lRect.mMaxY = mHeight - 1;
+		lRect.mNearestDepth = 1.0f;
+		return lRect;
+	}
+	lRect.mMinX = std::max(0, int(std::floor(lMinX)));
+	lRect.mMinY = std::max(0, int(std::floor(lMinY)));
+	lRect.mMaxX = std::min(mWidth - 1, int(std::floor(lMaxX)));
+	lRect.mMaxY = std::min(mHeight - 1, int(std::floor(lMaxY)));
+	lRect.mOutsideFrustum = lRect.mMinX > lRect.mMaxX || lRect.mMinY > lRect.mMaxY;
+	return lRect;
+}
+
+bool Renderer::SoftwareOcclusionCuller::IsVisible(const DirectX::BoundingBox& InWorldBounds) const
+{
+	return IsVisible(ProjectBounds(InWorldBounds));
+}
+
+bool Renderer::SoftwareOcclusionCuller::IsVisible(const ScreenRect& InRect) const
+{
+	if (InRect.mOutsideFrustum)
+	{
+		return false;
+	}
+	if (InRect.mCrossNearPlane)
+	{
+		return true;
+	}
+	for (int ty = InRect.mMinY / HIZ_TILE_SIZE; ty <= InRect.mMaxY / HIZ_TILE_SIZE; ++ty)
+	{
+		for (int tx = InRect.mMinX / HIZ_TILE_SIZE; tx <= InRect.mMaxX / HIZ_TILE_SIZE; ++tx)
+		{
+			//The whole tile is strictly in front of the nearest point of the box.
+			if (mHiZ[size_t(ty) * mTilesX + tx] > InRect.mNearestDepth)
+			{
+				continue;
+			}
+			int lX0 = std::max(InRect.mMinX, tx * HIZ_TILE_SIZE);
+			int lX1 = std::min(InRect.mMaxX, (tx + 1) * HIZ_TILE_SIZE - 1);
+			int lY0 = std::max(InRect.mMinY, ty * HIZ_TILE_SIZE);
+			int lY1 = std::min(InRect.mMaxY, (ty + 1) * HIZ_TILE_SIZE - 1);
+			for (int y = lY0; y <= lY1; ++y)
+			{
+				const float* lRow = mDepth.data() + size_t(y) * mWidth;
+				for (int x = lX0; x <= lX1; ++x)
+				{
+					if (lRow[x] <= InRect.mNearestDepth)
+					{
+						return true;
+					}
+				}
+			}
+		}
+	}
+	return false;
+}
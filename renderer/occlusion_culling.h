@@ -0,0 +1,76 @@
+#pragma once
+
+namespace Renderer
+{
+	struct OcclusionCullStats
+	{
+		uint32_t mOccluders = 0;
+		uint32_t mOccluderTriangles = 0;
+		uint32_t mTested = 0;
+		uint32_t mFrustumCulled = 0;
+		uint32_t mOcclusionCulled = 0;
+	};
+
+	//Screen space footprint of a bounding box, pixels are in depth buffer resolution.
+	struct ScreenRect
+	{
+		int mMinX = 0;
+		int mMinY = 0;
+		int mMaxX = -1;
+		int mMaxY = -1;
+		//Reversed Z,the largest depth is the nearest point of the box.
+		float mNearestDepth = 0.0f;
+		bool mOutsideFrustum = false;
+		bool mCrossNearPlane = false;
+		int Area() const { return mMaxX < mMinX || mMaxY < mMinY ? 0 : (mMaxX - mMinX + 1) * (mMaxY - mMinY + 1); }
+	};
+
+	//Low resolution software depth buffer,occluders are rasterized with DirectXMath SIMD (4 pixels per step)
+	//and entity bounds are tested against a min-depth hierarchy before any draw is recorded.
+	//Depth follows the renderer convention:reversed Z,cleared to 0 (far),1 at the near plane.
+	class SoftwareOcclusionCuller
+	{
+	public:
+		static constexpr int DEFAULT_WIDTH = 256;
+		static constexpr int DEFAULT_HEIGHT = 128;
+		static constexpr int HIZ_TILE_SIZE = 8;
+
+		SoftwareOcclusionCuller(int InWidth = DEFAULT_WIDTH, int InHeight = DEFAULT_HEIGHT);
+
+		~SoftwareOcclusionCuller();
+
+		//InViewPrj is the row vector view projection matrix,i.e. GetPrjView(false).
+		void BeginFrame(const DirectX::SimpleMath::Matrix& InViewPrj);
+
+		//Positions are read with InStride so both Renderer::Vertex and XMFLOAT3 arrays can be rasterized.
+		void RasterizeOccluder(const void* InPositions, size_t InStride, size_t InVertexCount,
+			std::span<const uint32_t> InIndices, const DirectX::SimpleMath::Matrix& InModel);
+
+		//Rebuild the min depth tiles,must be called after the last occluder and before any query.
+		void BuildHierarchy();
+
+		ScreenRect ProjectBounds(const DirectX::BoundingBox& InWorldBounds) const;
+
+		bool IsVisible(const DirectX::BoundingBox& InWorldBounds) const;
+
+		bool IsVisible(const ScreenRect& InRect) const;
+
+		int GetWidth() const { return mWidth; }
+		int GetHeight() const { return mHeight; }
+		std::span<const float> GetDepth() const { return mDepth; }
+		uint32_t GetRasterizedTriangles() const { return mRasterizedTriangles; }
+
+	private:
+		void RasterizeTriangle(DirectX::FXMVECTOR InV0, DirectX::FXMVECTOR InV1, DirectX::FXMVECTOR InV2);
+
+		int mWidth;
+		int mHeight;
+		int mTilesX;
+		int mTilesY;
+		DirectX::SimpleMath::Matrix mViewPrj;
+		std::vector<float> mDepth;
+		std::vector<float> mHiZ;
+		std::vector<DirectX::XMFLOAT4> mClipVertices;
+		uint32_t mRasterizedTriangles = 0;
+	};
+}
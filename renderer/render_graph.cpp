@@ -0,0 +1,279 @@
+#include "render_graph.h"
+
+namespace
+{
+	uint64_t AlignUp(uint64_t InValue, uint64_t InAlignment)
+	{
+		return (InValue + InAlignment - 1) / InAlignment * InAlignment;
+	}
+}
+
+void Renderer::RenderGraph::PassBuilder::Read(RGTextureHandle InTexture, RGAccess InAccess)
+{
+	mGraph.AddAccess(mPass, InTexture, InAccess, false);
+}
+
+void Renderer::RenderGraph::PassBuilder::Write(RGTextureHandle InTexture, RGAccess InAccess)
+{
+	mGraph.AddAccess(mPass, InTexture, InAccess, true);
+}
+
+void Renderer::RenderGraph::PassBuilder::SetSideEffects()
+{
+	mGraph.mPasses[mPass].mSideEffects = true;
+}
+
+Renderer::RenderGraph::RenderGraph()
+{
+
+}
+
+Renderer::RenderGraph::~RenderGraph()
+{
+
+}
+
+Renderer::RGTextureHandle Renderer::RenderGraph::Import(std::string_view InName, const RGTextureDesc& InDesc, RGAccess InInitial, RGAccess InFinal)
+{
+	Expects(InInitial != RGAccess::NONE && InFinal != RGAccess::NONE);
+	Texture lTexture;
+	lTexture.mName = InName;
+	lTexture.mDesc = InDesc;
+	lTexture.mImported = true;
+	lTexture.mInitial = InInitial;
+	lTexture.mFinal = InFinal;
+	mTextures.push_back(std::move(lTexture));
+	return { (uint32_t)mTextures.size() - 1 };
+}
+
+Renderer::RGTextureHandle Renderer::RenderGraph::Create(std::string_view InName, const RGTextureDesc& InDesc)
+{
+	Texture lTexture;
+	lTexture.mName = InName;
+	lTexture.mDesc = InDesc;
+	mTextures.push_back(std::move(lTexture));
+	return { (uint32_t)mTextures.size() - 1 };
+}
+
+void Renderer::RenderGraph::AddPass(std::string_view InName, const std::function<void(PassBuilder&)>& InSetup, std::function<void()> InExecute)
+{
+	Pass lPass;
+	lPass.mName = InName;
+	lPass.mExecute = std::move(InExecute);
+	mPasses.push_back(std::move(lPass));
+	PassBuilder lBuilder(*this, (uint32_t)mPasses.size() - 1);
+	InSetup(lBuilder);
+}
+
+void Renderer::RenderGraph::AddAccess(uint32_t InPass, RGTextureHandle InTexture, RGAccess InAccess, bool InWrite)
+{
+	Expects(InTexture.mIndex < mTextures.size() && InAccess != RGAccess::NONE && InAccess != RGAccess::COUNT);
+	auto& lAccesses = mPasses[InPass].mAccesses;
+	Expects(std::none_of(lAccesses.begin(), lAccesses.end(), [InTexture](const Access& InOther) { return InOther.mTexture == InTexture; }));
+	lAccesses.push_back({ InTexture, InAccess, InWrite });
+}
+
+void Renderer::RenderGraph::Compile(RenderGraphBackend& InBackend)
+{
+	auto lStart = std::chrono::steady_clock::now();
+	mStats = {};
+	mStats.mPasses = (uint32_t)mPasses.size();
+	CullPasses();
+	ComputeLifetimes();
+	PlaceTransients(InBackend);
+	BuildBarriers();
+	mStats.mCompileMs = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - lStart).count();
+}
+
+void Renderer::RenderGraph::Execute(RenderGraphBackend& InBackend)
+{
+	InBackend.Realize(*this);
+	for (auto& pass : mPasses)
+	{
+		if (pass.mCulled)
+		{
+			continue;
+		}
+		if (!pass.mBarriers.empty())
+		{
+			InBackend.Barriers(pass.mBarriers);
+		}
+		pass.mExecute();
+	}
+	if (!mFinalBarriers.empty())
+	{
+		InBackend.Barriers(mFinalBarriers);
+	}
+}
+
+void Renderer::RenderGraph::Reset()
+{
+	mPasses.clear();
+	mTextures.clear();
+	mFinalBarriers.clear();
+	mHeapSize = 0;
+}
+
+void Renderer::RenderGraph::CullPasses()
+{
+	//Backwards from the outputs:a pass is kept when a later kept pass reads what it writes,or it writes an import.
+	//Handles are not versioned,so a read keeps every earlier writer of the texture.Writes are not assumed to cover
+	//the whole texture and never end a dependency,which keeps read modify write chains intact.
+	std::vector<uint8_t> lNeeded(mTextures.size(), 0);
+	for (uint32_t t = 0; t < (uint32_t)mTextures.size(); ++t)
+	{
+		lNeeded[t] = mTextures[t].mImported;
+	}
+	for (uint32_t p = (uint32_t)mPasses.size(); p-- > 0;)
+	{
+		auto& lPass = mPasses[p];
+		bool lLive = lPass.mSideEffects;
+		for (const auto& access : lPass.mAccesses)
+		{
+			lLive |= access.mWrite && lNeeded[access.mTexture.mIndex];
+		}
+		lPass.mCulled = !lLive;
+		if (!lLive)
+		{
+			mStats.mCulledPasses++;
+			continue;
+		}
+		for (const auto& access : lPass.mAccesses)
+		{
+			if (!access.mWrite)
+			{
+				lNeeded[access.mTexture.mIndex] = 1;
+			}
+		}
+	}
+}
+
+void Renderer::RenderGraph::ComputeLifetimes()
+{
+	for (auto& texture : mTextures)
+	{
+		texture.mFirstPass = UINT32_MAX;
+		texture.mLastPass = 0;
+		texture.mPlacement = {};
+		texture.mAliased = false;
+	}
+	for (uint32_t p = 0; p < (uint32_t)mPasses.size(); ++p)
+	{
+		if (mPasses[p].mCulled)
+		{
+			continue;
+		}
+		for (const auto& access : mPasses[p].mAccesses)
+		{
+			auto& lTexture = mTextures[access.mTexture.mIndex];
+			lTexture.mFirstPass = std::min(lTexture.mFirstPass, p);
+			lTexture.mLastPass = std::max(lTexture.mLastPass, p);
+		}
+	}
+}
+
+void Renderer::RenderGraph::PlaceTransients(RenderGraphBackend& InBackend)
+{
+	std::vector<uint32_t> lTransients;
+	std::vector<RGAllocationInfo> lInfos(mTextures.size());
+	for (uint32_t t = 0; t < (uint32_t)mTextures.size(); ++t)
+	{
+		if (IsAllocated({ t }))
+		{
+			lInfos[t] = InBackend.GetAllocationInfo(mTextures[t].mDesc);
+			lTransients.push_back(t);
+			mStats.mUnaliasedBytes += AlignUp(lInfos[t].mSize, lInfos[t].mAlignment);
+		}
+	}
+	mStats.mTransients = (uint32_t)lTransients.size();
+	//Largest first,each at the lowest offset free of every placed transient alive at the same time.
+	std::stable_sort(lTransients.begin(), lTransients.end(), [&lInfos](uint32_t InA, uint32_t InB) { return lInfos[InA].mSize > lInfos[InB].mSize; });
+	std::vector<uint32_t> lPlaced;
+	std::vector<RGPlacement> lOccupied;
+	mHeapSize = 0;
+	for (uint32_t t : lTransients)
+	{
+		auto& lTexture = mTextures[t];
+		lOccupied.clear();
+		for (uint32_t other : lPlaced)
+		{
+			const auto& lOther = mTextures[other];
+			if (lOther.mFirstPass <= lTexture.mLastPass && lTexture.mFirstPass <= lOther.mLastPass)
+			{
+				lOccupied.push_back(lOther.mPlacement);
+			}
+		}
+		std::sort(lOccupied.begin(), lOccupied.end(), [](const RGPlacement& InA, const RGPlacement& InB) { return InA.mOffset < InB.mOffset; });
+		uint64_t lOffset = 0;
+		for (const auto& range : lOccupied)
+		{
+			if (lOffset + lInfos[t].mSize <= range.mOffset)
+			{
+				break;
+			}
+			lOffset = std::max(lOffset, AlignUp(range.mOffset + range.mSize, lInfos[t].mAlignment));
+		}
+		lTexture.mPlacement = { lOffset, lInfos[t].mSize };
+		mHeapSize = std::max(mHeapSize, lOffset + lInfos[t].mSize);
+		lPlaced.push_back(t);
+	}
+	//Any overlap in memory means another texture may have written the range since this one's last use,
+	//earlier this frame or in the previous one.
+	for (uint32_t a : lPlaced)
+	{
+		for (uint32_t b : lPlaced)
+		{
+			const auto& lA = mTextures[a].mPlacement;
+			const auto& lB = mTextures[b].mPlacement;
+			if (a != b && lA.mOffset < lB.mOffset + lB.mSize && lB.mOffset < lA.mOffset + lA.mSize)
+			{
+				mTextures[a].mAliased = true;
+				break;
+			}
+		}
+	}
+	mStats.mHeapBytes = mHeapSize;
+}
+
+void Renderer::RenderGraph::BuildBarriers()
+{
+	std::vector<RGAccess> lCurrent(mTextures.size());
+	for (uint32_t t = 0; t < (uint32_t)mTextures.size(); ++t)
+	{
+		lCurrent[t] = mTextures[t].mImported ? mTextures[t].mInitial : RGAccess::NONE;
+	}
+	for (uint32_t p = 0; p < (uint32_t)mPasses.size(); ++p)
+	{
+		auto& lPass = mPasses[p];
+		lPass.mBarriers.clear();
+		if (lPass.mCulled)
+		{
+			continue;
+		}
+		for (const auto& access : lPass.mAccesses)
+		{
+			const uint32_t t = access.mTexture.mIndex;
+			if (mTextures[t].mAliased && mTextures[t].mFirstPass == p)
+			{
+				lPass.mBarriers.push_back({ RGBarrier::Type::ALIASING, access.mTexture, RGAccess::NONE, RGAccess::NONE });
+				mStats.mAliasingBarriers++;
+			}
+			//Back to back UAV use still needs the writes ordered,see RGBarrier.
+			if (lCurrent[t] != access.mAccess || access.mAccess == RGAccess::UNORDERED_ACCESS)
+			{
+				lPass.mBarriers.push_back({ RGBarrier::Type::TRANSITION, access.mTexture, lCurrent[t], access.mAccess });
+				mStats.mTransitions++;
+			}
+			lCurrent[t] = access.mAccess;
+		}
+	}
+	mFinalBarriers.clear();
+	for (uint32_t t = 0; t < (uint32_t)mTextures.size(); ++t)
+	{
+		if (mTextures[t].mImported && lCurrent[t] != mTextures[t].mFinal)
+		{
+			mFinalBarriers.push_back({ RGBarrier::Type::TRANSITION, { t }, lCurrent[t], mTextures[t].mFinal });
+			mStats.mTransitions++;
+		}
+	}
+}
@@ -0,0 +1,226 @@
+#pragma once
+
+namespace Renderer
+{
+	//How a pass uses a texture,the backend maps it to its API states.
+	enum class RGAccess : uint32_t
+	{
+		//Contents undefined,only valid as the state before a transient's first use.
+		NONE,
+		RENDER_TARGET,
+		DEPTH_WRITE,
+		DEPTH_READ,
+		SHADER_READ,
+		UNORDERED_ACCESS,
+		COPY_SOURCE,
+		COPY_DEST,
+		RESOLVE_SOURCE,
+		RESOLVE_DEST,
+		PRESENT,
+		COUNT
+	};
+
+	//Transient texture description,mFormat holds the backend's format enum.
+	struct RGTextureDesc
+	{
+		uint32_t mWidth = 0;
+		uint32_t mHeight = 0;
+		uint32_t mFormat = 0;
+		uint32_t mSampleCount = 1;
+
+		bool operator==(const RGTextureDesc&) const = default;
+	};
+
+	struct RGTextureHandle
+	{
+		uint32_t mIndex = UINT32_MAX;
+
+		bool IsValid() const { return mIndex != UINT32_MAX; }
+
+		bool operator==(const RGTextureHandle&) const = default;
+	};
+
+	struct RGBarrier
+	{
+		enum class Type : uint8_t
+		{
+			TRANSITION,
+			//The heap range of a transient was used by another texture,its contents are undefined.
+			ALIASING
+		};
+		Type mType = Type::TRANSITION;
+		RGTextureHandle mTexture;
+		//NONE before a transient's first use,the backend knows the state the physical texture was left in.
+		//A transition from UNORDERED_ACCESS to itself orders the writes of consecutive passes.
+		RGAccess mBefore = RGAccess::NONE;
+		RGAccess mAfter = RGAccess::NONE;
+	};
+
+	struct RGAllocationInfo
+	{
+		uint64_t mSize = 0;
+		uint64_t mAlignment = 1;
+	};
+
+	//Offset of a transient in the shared heap.
+	struct RGPlacement
+	{
+		uint64_t mOffset = 0;
+		uint64_t mSize = 0;
+	};
+
+	struct RenderGraphStats
+	{
+		uint32_t mPasses = 0;
+		uint32_t mCulledPasses = 0;
+		uint32_t mTransients = 0;
+		uint32_t mTransitions = 0;
+		uint32_t mAliasingBarriers = 0;
+		//Shared heap size against one allocation per transient.
+		uint64_t mHeapBytes = 0;
+		uint64_t mUnaliasedBytes = 0;
+		float mCompileMs = 0.0f;
+	};
+
+	class RenderGraph;
+
+	//Everything the graph needs from a graphics API.Mock it to run the compiler without a device.
+	class RenderGraphBackend
+	{
+	public:
+		virtual ~RenderGraphBackend() = default;
+
+		virtual RGAllocationInfo GetAllocationInfo(const RGTextureDesc& InDesc) = 0;
+
+		//Create or reuse the heap and the transients at the placements of the compiled graph.
+		virtual void Realize(const RenderGraph& InGraph) = 0;
+
+		virtual void Barriers(std::span<const RGBarrier> InBarriers) = 0;
+	};
+
+	//Frame graph over textures:passes declare what they read and write,Compile culls the passes nothing depends on,
+	//places transients with disjoint lifetimes at overlapping heap offsets and derives every barrier.
+	//Passes run in the order they were added.Rebuilt every frame,building and compiling only touch CPU memory.
+	class RenderGraph
+	{
+	public:
+		class PassBuilder
+		{
+		public:
+			//One access per texture and pass.
+			void Read(RGTextureHandle InTexture, RGAccess InAccess);
+
+			void Write(RGTextureHandle InTexture, RGAccess InAccess);
+
+			//Never culled,e.g. the pass writes something outside the graph.
+			void SetSideEffects();
+
+		private:
+			friend class RenderGraph;
+			PassBuilder(RenderGraph& InGraph, uint32_t InPass) : mGraph(InGraph), mPass(InPass) {}
+
+			RenderGraph& mGraph;
+			uint32_t mPass;
+		};
+
+		RenderGraph();
+
+		~RenderGraph();
+
+		//Texture owned outside the graph.It is an output,passes writing it are kept.
+		//The graph transitions it from InInitial on first use and back to InFinal after the last pass.
+		RGTextureHandle Import(std::string_view InName, const RGTextureDesc& InDesc, RGAccess InInitial, RGAccess InFinal);
+
+		//Texture living between its first and last use,its heap range may be shared with other transients.
+		RGTextureHandle Create(std::string_view InName, const RGTextureDesc& InDesc);
+
+		//InSetup runs now and declares the accesses,InExecute runs during Execute unless the pass is culled.
+		void AddPass(std::string_view InName, const std::function<void(PassBuilder&)>& InSetup, std::function<void()> InExecute);
+
+		void Compile(RenderGraphBackend& InBackend);
+
+		//Realize,then barriers and passes in order.Call after Compile.
+		void Execute(RenderGraphBackend& InBackend);
+
+		//Drop the passes and textures,keeps the allocations for the next frame.
+		void Reset();
+
+		uint32_t GetPassCount() const { return (uint32_t)mPasses.size(); }
+
+		const std::string& GetPassName(uint32_t InPass) const { return mPasses[InPass].mName; }
+
+		bool IsCulled(uint32_t InPass) const { return mPasses[InPass].mCulled; }
+
+		//Barriers recorded before the pass runs.
+		std::span<const RGBarrier> GetPassBarriers(uint32_t InPass) const { return mPasses[InPass].mBarriers; }
+
+		//Transitions of the imports to their final state.
+		std::span<const RGBarrier> GetFinalBarriers() const { return mFinalBarriers; }
+
+		uint32_t GetTextureCount() const { return (uint32_t)mTextures.size(); }
+
+		const std::string& GetTextureName(RGTextureHandle InTexture) const { return mTextures[InTexture.mIndex].mName; }
+
+		const RGTextureDesc& GetTextureDesc(RGTextureHandle InTexture) const { return mTextures[InTexture.mIndex].mDesc; }
+
+		bool IsImported(RGTextureHandle InTexture) const { return mTextures[InTexture.mIndex].mImported; }
+
+		//Transients used by a pass that survived culling.
+		bool IsAllocated(RGTextureHandle InTexture) const { return mTextures[InTexture.mIndex].mFirstPass != UINT32_MAX && !mTextures[InTexture.mIndex].mImported; }
+
+		const RGPlacement& GetPlacement(RGTextureHandle InTexture) const { return mTextures[InTexture.mIndex].mPlacement; }
+
+		uint64_t GetHeapSize() const { return mHeapSize; }
+
+		const RenderGraphStats& GetStats() const { return mStats; }
+
+	private:
+		struct Access
+		{
+			RGTextureHandle mTexture;
+			RGAccess mAccess;
+			bool mWrite;
+		};
+
+		struct Pass
+		{
+			std::string mName;
+			std::vector<Access> mAccesses;
+			std::function<void()> mExecute;
+			std::vector<RGBarrier> mBarriers;
+			bool mSideEffects = false;
+			bool mCulled = false;
+		};
+
+		struct Texture
+		{
+			std::string mName;
+			RGTextureDesc mDesc;
+			bool mImported = false;
+			RGAccess mInitial = RGAccess::NONE;
+			RGAccess mFinal = RGAccess::NONE;
+			//Lifetime over the surviving passes,UINT32_MAX when unused.
+			uint32_t mFirstPass = UINT32_MAX;
+			uint32_t mLastPass = 0;
+			RGPlacement mPlacement;
+			//Shares heap memory with another transient,its first use starts with an aliasing barrier.
+			bool mAliased = false;
+		};
+
+		void AddAccess(uint32_t InPass, RGTextureHandle InTexture, RGAccess InAccess, bool InWrite);
+
+		void CullPasses();
+
+		void ComputeLifetimes();
+
+		void PlaceTransients(RenderGraphBackend& InBackend);
+
+		void BuildBarriers();
+
+		std::vector<Pass> mPasses;
+		std::vector<Texture> mTextures;
+		std::vector<RGBarrier> mFinalBarriers;
+		uint64_t mHeapSize = 0;
+		RenderGraphStats mStats;
+	};
+}
@@ -0,0 +1,222 @@
+#include "render_graph_d3d12.h"
+#include "device_manager.h"
+
+Renderer::D3D12RenderGraphBackend::D3D12RenderGraphBackend()
+{
+
+}
+
+Renderer::D3D12RenderGraphBackend::~D3D12RenderGraphBackend()
+{
+	mTextures.clear();
+	if (mHeap)
+	{
+		mHeap->Release();
+	}
+	for (auto& retired : mRetired)
+	{
+		retired.mTextures.clear();
+		if (retired.mHeap)
+		{
+			retired.mHeap->Release();
+		}
+	}
+}
+
+void Renderer::D3D12RenderGraphBackend::BindImported(RGTextureHandle InTexture, Resource::ColorBuffer* InBuffer)
+{
+	if (InTexture.mIndex >= mBound.size())
+	{
+		mBound.resize(InTexture.mIndex + 1, nullptr);
+		mBoundPhysical.resize(InTexture.mIndex + 1, UINT32_MAX);
+	}
+	mBound[InTexture.mIndex] = InBuffer;
+	mBoundPhysical[InTexture.mIndex] = UINT32_MAX;
+}
+
+Renderer::Resource::ColorBuffer* Renderer::D3D12RenderGraphBackend::GetTexture(RGTextureHandle InTexture) const
+{
+	Expects(InTexture.mIndex < mBound.size() && mBound[InTexture.mIndex]);
+	return mBound[InTexture.mIndex];
+}
+
+Renderer::RGTextureDesc Renderer::D3D12RenderGraphBackend::Describe(uint32_t InWidth, uint32_t InHeight, DXGI_FORMAT InFormat, uint32_t InSampleCount)
+{
+	return { InWidth, InHeight, (uint32_t)InFormat, InSampleCount };
+}
+
+Renderer::RGAllocationInfo Renderer::D3D12RenderGraphBackend::GetAllocationInfo(const RGTextureDesc& InDesc)
+{
+	Resource::ColorBuffer lBuffer;
+	lBuffer.SetMsaaMode(InDesc.mSampleCount);
+	auto lDesc = lBuffer.DescribePlaced(InDesc.mWidth, InDesc.mHeight, (DXGI_FORMAT)InDesc.mFormat);
+	auto lInfo = g_Device->GetResourceAllocationInfo(0, 1, &lDesc);
+	return { lInfo.SizeInBytes, lInfo.Alignment };
+}
+
+void Renderer::D3D12RenderGraphBackend::RetireTextures(ID3D12Heap* InHeap)
+{
+	mRetired.push_back({ mRealizeCount + SWAP_CHAIN_BUFFER_COUNT, InHeap, std::move(mTextures) });
+	mTextures.clear();
+}
+
+void Renderer::D3D12RenderGraphBackend::Realize(const RenderGraph& InGraph)
+{
+	mRealizeCount++;
+	std::erase_if(mRetired, [this](Retired& InRetired)
+		{
+			if (InRetired.mReleaseAfter > mRealizeCount)
+			{
+				return false;
+			}
+			InRetired.mTextures.clear();
+			if (InRetired.mHeap)
+			{
+				InRetired.mHeap->Release();
+			}
+			return true;
+		});
+
+	if (InGraph.GetHeapSize() > mHeapSize)
+	{
+		RetireTextures(mHeap);
+		mHeap = nullptr;
+		mHeapSize = (InGraph.GetHeapSize() + D3D12_DEFAULT_RESOURCE_PLACEMENT_ALIGNMENT - 1) / D3D12_DEFAULT_RESOURCE_PLACEMENT_ALIGNMENT * D3D12_DEFAULT_RESOURCE_PLACEMENT_ALIGNMENT;
+		D3D12_HEAP_DESC lDesc = {};
+		lDesc.SizeInBytes = mHeapSize;
+		lDesc.Properties = CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_DEFAULT);
+		lDesc.Alignment = D3D12_DEFAULT_MSAA_RESOURCE_PLACEMENT_ALIGNMENT;
+		lDesc.Flags = D3D12_HEAP_FLAG_ALLOW_ONLY_RT_DS_TEXTURES;
+		Ensures(g_Device->CreateHeap(&lDesc, IID_PPV_ARGS(&mHeap)) == S_OK);
+		mHeap->SetName(L"RenderGraphHeap");
+	}
+
+	const uint32_t lCount = InGraph.GetTextureCount();
+	mBound.resize(std::max<size_t>(mBound.size(), lCount), nullptr);
+	mBoundPhysical.resize(mBound.size(), UINT32_MAX);
+	auto lFind = [this, &InGraph](RGTextureHandle InTexture)
+		{
+			const auto& lDesc = InGraph.GetTextureDesc(InTexture);
+			const uint64_t lOffset = InGraph.GetPlacement(InTexture).mOffset;
+			auto lIt = std::find_if(mTextures.begin(), mTextures.end(), [&](const PhysicalTexture& InPhysical) { return InPhysical.mDesc == lDesc && InPhysical.mOffset == lOffset; });
+			return lIt == mTextures.end() ? UINT32_MAX : uint32_t(lIt - mTextures.begin());
+		};
+	size_t lMisses = 0;
+	for (uint32_t t = 0; t < lCount; ++t)
+	{
+		lMisses += InGraph.IsAllocated({ t }) && lFind({ t }) == UINT32_MAX;
+	}
+	if (lMisses && mTextures.size() + lMisses > MAX_CACHED_TEXTURES)
+	{
+		RetireTextures(nullptr);
+	}
+	for (uint32_t t = 0; t < lCount; ++t)
+	{
+		if (InGraph.IsImported({ t }))
+		{
+			continue;
+		}
+		mBound[t] = nullptr;
+		mBoundPhysical[t] = UINT32_MAX;
+		if (!InGraph.IsAllocated({ t }))
+		{
+			continue;
+		}
+		uint32_t lPhysical = lFind({ t });
+		if (lPhysical == UINT32_MAX)
+		{
+			const auto& lDesc = InGraph.GetTextureDesc({ t });
+			const auto& lName = InGraph.GetTextureName({ t });
+			PhysicalTexture lTexture = { lDesc, InGraph.GetPlacement({ t }).mOffset, std::make_unique<Resource::ColorBuffer>(), D3D12_RESOURCE_STATE_COMMON, true };
+			lTexture.mBuffer->SetMsaaMode(lDesc.mSampleCount);
+			lTexture.mBuffer->CreatePlaced(std::wstring(lName.begin(), lName.end()), lDesc.mWidth, lDesc.mHeight, (DXGI_FORMAT)lDesc.mFormat, mHeap, lTexture.mOffset);
+			lPhysical = (uint32_t)mTextures.size();
+			mTextures.push_back(std::move(lTexture));
+		}
+		mBound[t] = mTextures[lPhysical].mBuffer.get();
+		mBoundPhysical[t] = lPhysical;
+	}
+}
+
+D3D12_RESOURCE_STATES Renderer::D3D12RenderGraphBackend::ToState(RGAccess InAccess)
+{
+	switch (InAccess)
+	{
+	case RGAccess::RENDER_TARGET:
+		return D3D12_RESOURCE_STATE_RENDER_TARGET;
+	case RGAccess::DEPTH_WRITE:
+		return D3D12_RESOURCE_STATE_DEPTH_WRITE;
+	case RGAccess::DEPTH_READ:
+		return D3D12_RESOURCE_STATE_DEPTH_READ;
+	case RGAccess::SHADER_READ:
+		return D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE | D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE;
+	case RGAccess::UNORDERED_ACCESS:
+		return D3D12_RESOURCE_STATE_UNORDERED_ACCESS;
+	case RGAccess::COPY_SOURCE:
+		return D3D12_RESOURCE_STATE_COPY_SOURCE;
+	case RGAccess::COPY_DEST:
+		return D3D12_RESOURCE_STATE_COPY_DEST;
+	case RGAccess::RESOLVE_SOURCE:
+		return D3D12_RESOURCE_STATE_RESOLVE_SOURCE;
+	case RGAccess::RESOLVE_DEST:
+		return D3D12_RESOURCE_STATE_RESOLVE_DEST;
+	case RGAccess::PRESENT:
+		return D3D12_RESOURCE_STATE_PRESENT;
+	default:
+		return D3D12_RESOURCE_STATE_COMMON;
+	}
+}
+
+void Renderer::D3D12RenderGraphBackend::FlushBarriers()
+{
+	if (!mBarrierScratch.empty())
+	{
+		mCmd->ResourceBarrier((UINT)mBarrierScratch.size(), mBarrierScratch.data());
+		mBarrierScratch.clear();
+	}
+}
+
+void Renderer::D3D12RenderGraphBackend::Barriers(std::span<const RGBarrier> InBarriers)
+{
+	Expects(mCmd);
+	for (const auto& barrier : InBarriers)
+	{
+		auto* lBuffer = GetTexture(barrier.mTexture);
+		auto* lResource = lBuffer->GetResource();
+		const uint32_t lPhysical = mBoundPhysical[barrier.mTexture.mIndex];
+		if (barrier.mType == RGBarrier::Type::ALIASING)
+		{
+			mBarrierScratch.push_back(CD3DX12_RESOURCE_BARRIER::Aliasing(nullptr, lResource));
+			mTextures[lPhysical].mDiscard = true;
+			continue;
+		}
+		//Imports are tracked by the graph,transients by the physical texture they were placed as.
+		D3D12_RESOURCE_STATES lBefore = lPhysical == UINT32_MAX ? ToState(barrier.mBefore) : mTextures[lPhysical].mState;
+		const D3D12_RESOURCE_STATES lAfter = ToState(barrier.mAfter);
+		if (lPhysical != UINT32_MAX && mTextures[lPhysical].mDiscard)
+		{
+			//A placed render target has to be cleared,copied to or discarded before anything reads it.
+			if (lBefore != D3D12_RESOURCE_STATE_RENDER_TARGET)
+			{
+				mBarrierScratch.push_back(CD3DX12_RESOURCE_BARRIER::Transition(lResource, lBefore, D3D12_RESOURCE_STATE_RENDER_TARGET));
+				lBefore = D3D12_RESOURCE_STATE_RENDER_TARGET;
+			}
+			FlushBarriers();
+			mCmd->DiscardResource(lResource, nullptr);
+			mTextures[lPhysical].mDiscard = false;
+		}
+		if (lBefore != lAfter)
+		{
+			mBarrierScratch.push_back(CD3DX12_RESOURCE_BARRIER::Transition(lResource, lBefore, lAfter));
+		}
+		else if (lAfter == D3D12_RESOURCE_STATE_UNORDERED_ACCESS)
+		{
+			mBarrierScratch.push_back(CD3DX12_RESOURCE_BARRIER::UAV(lResource));
+		}
+		if (lPhysical != UINT32_MAX)
+		{
+			mTextures[lPhysical].mState = lAfter;
+		}
+	}
+	FlushBarriers();
+}
@@ -0,0 +1,73 @@
+#pragma once
+#include "render_graph.h"
+#include "gpu_resource.h"
+
+namespace Renderer
+{
+	//Places the transients of a compiled RenderGraph in one heap and records its barriers on a D3D12 command list.
+	//The heap only grows,physical textures are kept by description and offset so a graph that does not change
+	//from frame to frame creates nothing after its first frame.
+	class D3D12RenderGraphBackend final : public RenderGraphBackend
+	{
+	public:
+		D3D12RenderGraphBackend();
+
+		~D3D12RenderGraphBackend();
+
+		void SetCommandList(ID3D12GraphicsCommandList* InCmd) { mCmd = InCmd; }
+
+		//Texture behind an import of the current graph,its state is tracked by the graph,not by the ColorBuffer.
+		void BindImported(RGTextureHandle InTexture, Resource::ColorBuffer* InBuffer);
+
+		//Valid inside the passes of the graph last realized.
+		Resource::ColorBuffer* GetTexture(RGTextureHandle InTexture) const;
+
+		static RGTextureDesc Describe(uint32_t InWidth, uint32_t InHeight, DXGI_FORMAT InFormat, uint32_t InSampleCount = 1);
+
+		RGAllocationInfo GetAllocationInfo(const RGTextureDesc& InDesc) override;
+
+		void Realize(const RenderGraph& InGraph) override;
+
+		void Barriers(std::span<const RGBarrier> InBarriers) override;
+
+	private:
+		struct PhysicalTexture
+		{
+			RGTextureDesc mDesc;
+			uint64_t mOffset;
+			std::unique_ptr<Resource::ColorBuffer> mBuffer;
+			//Left by the last frame,the graph's NONE before a first use means this.
+			D3D12_RESOURCE_STATES mState;
+			//Newly placed or aliased,contents have to be discarded before the first use.
+			bool mDiscard;
+		};
+
+		//The GPU may still use a replaced heap and the textures in it for the frames in flight.
+		struct Retired
+		{
+			uint64_t mReleaseAfter;
+			ID3D12Heap* mHeap;
+			std::vector<PhysicalTexture> mTextures;
+		};
+
+		static D3D12_RESOURCE_STATES ToState(RGAccess InAccess);
+
+		void RetireTextures(ID3D12Heap* InHeap);
+
+		void FlushBarriers();
+
+		//More cached textures than this means the graph keeps changing shape,they are all retired and placed again.
+		static constexpr size_t MAX_CACHED_TEXTURES = 64;
+
+		ID3D12GraphicsCommandList* mCmd = nullptr;
+		ID3D12Heap* mHeap = nullptr;
+		uint64_t mHeapSize = 0;
+		std::vector<PhysicalTexture> mTextures;
+		std::vector<Retired> mRetired;
+		uint64_t mRealizeCount = 0;
+		//Per texture of the current graph:the ColorBuffer and,for transients,the index into mTextures.
+		std::vector<Resource::ColorBuffer*> mBound;
+		std::vector<uint32_t> mBoundPhysical;
+		std::vector<D3D12_RESOURCE_BARRIER> mBarrierScratch;
+	};
+}
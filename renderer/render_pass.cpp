@@ -45,12 +45,16 @@ void Renderer::BaseRenderPass::CreateRS()
 
 }
 
-void Renderer::BaseRenderPass::DrawObject(const ECS::StaticMeshComponent& InAsset)
+void Renderer::BaseRenderPass::DrawObject(const ECS::StaticMeshComponent& InAsset, std::span<const ECS::SubMeshRange> InSubMeshes)
 {
 	//Render 
-	for (const auto& subMesh : InAsset.mSubMeshes)
+	auto lVertexBuffer = mContext->GetVertexBufferView();
+	auto lIndexBuffer = mContext->GetIndexBufferView(InAsset.m16BitIndices);
+	mGraphicsCmd->IASetVertexBuffers(0, 1, &lVertexBuffer);
+	mGraphicsCmd->IASetIndexBuffer(&lIndexBuffer);
+	for (const auto& subMesh : InSubMeshes)
 	{
-		mGraphicsCmd->DrawIndexedInstanced((UINT)subMesh.second.TriangleCount * 3, 1, InAsset.StartIndexLocation + subMesh.second.IndexOffset,
+		mGraphicsCmd->DrawIndexedInstanced(subMesh.IndexCount, 1, InAsset.StartIndexLocation + subMesh.IndexOffset,
 			InAsset.BaseVertexLocation, 0);
 	}
 }
@@ -9,6 +9,7 @@ namespace DirectX
 namespace ECS
 {
 	struct StaticMeshComponent;
+	struct SubMeshRange;
 }
 
 namespace Renderer
@@ -25,7 +26,7 @@ namespace Renderer
 		ID3D12PipelineState* GetPipelineState() { return mPipelineState; };
 		ID3D12RootSignature* GetRS() { return mRS; };
 	protected:
-		virtual void DrawObject(const ECS::StaticMeshComponent& InAsset);
+		virtual void DrawObject(const ECS::StaticMeshComponent& InAsset, std::span<const ECS::SubMeshRange> InSubMeshes);
 	protected:
 		struct ID3D12PipelineState* mPipelineState;
 		struct ID3D12RootSignature* mRS;
@@ -67,7 +67,7 @@ D3D12_SHADER_BYTECODE Renderer::Utils::ReadShader(std::string_view ShaderPath,st
 	return CD3DX12_SHADER_BYTECODE(vertexShader);
 }
 
-SimpleMath::Vector3 Renderer::Utils::GetLightGridZParams(float NearPlane, float FarPlane)
+SimpleMath::Vector3 Renderer::Utils::GetLightGridZParams(float NearPlane, float FarPlane, uint32_t SliceCount /*= CLUSTER_Z*/, float DistributionScale /*= 4.05f*/)
 {
 	// S = distribution scale
 	// B, O are solved for given the z distances of the first+last slice, and the # of slices.
@@ -77,12 +77,12 @@ SimpleMath::Vector3 Renderer::Utils::GetLightGridZParams(float NearPlane, float
 	// Don't spend lots of resolution right in front of the near plane
 	float NearOffset = .095f * 100;
 	// Space out the slices so they aren't all clustered at the near plane
-	float S = 4.05f;
+	float S = DistributionScale;
 
 	float N = NearPlane;
 	float F = FarPlane;
 
-	float O = (F - N * exp2((CLUSTER_Z - 1) / S)) / (F - N);
+	float O = (F - N * exp2((SliceCount - 1) / S)) / (F - N);
 	float B = (1 - O) / N;
 
 	return SimpleMath::Vector3(B, O, S);
@@ -166,3 +166,15 @@ SimpleMath::Vector4 Renderer::Utils::CreateInvDeviceZToWorldZTransform(const Sim
 		);
 	}
 }
+
+DirectX::XMFLOAT4 Renderer::Utils::ShaderMul(const DirectX::XMFLOAT4& InV, const SimpleMath::Matrix& InGpuMatrix)
+{
+	//The transposed copy is read column major,so each output is one row of InGpuMatrix.
+	//Summed left to right without fused multiply add,like the shader's dot expansion.
+	float lOut[4];
+	for (int j = 0; j < 4; ++j)
+	{
+		lOut[j] = InV.x * InGpuMatrix.m[j][0] + InV.y * InGpuMatrix.m[j][1] + InV.z * InGpuMatrix.m[j][2] + InV.w * InGpuMatrix.m[j][3];
+	}
+	return { lOut[0], lOut[1], lOut[2], lOut[3] };
+}
@@ -5,7 +5,9 @@ namespace Renderer
 	namespace Utils
 	{
 		D3D12_SHADER_BYTECODE ReadShader(std::string_view ShaderPath, std::string_view EntryPoint, std::string_view Type);
-		SimpleMath::Vector3 GetLightGridZParams(float NearPlane, float FarPlane);
+		SimpleMath::Vector3 GetLightGridZParams(float NearPlane, float FarPlane, uint32_t SliceCount = CLUSTER_Z, float DistributionScale = 4.05f);
 		SimpleMath::Vector4 CreateInvDeviceZToWorldZTransform(const SimpleMath::Matrix& ProjMatrix);
+		//mul(InV,InGpuMatrix) as a shader evaluates it on a matrix uploaded transposed,for CPU ports of shader code.
+		DirectX::XMFLOAT4 ShaderMul(const DirectX::XMFLOAT4& InV, const SimpleMath::Matrix& InGpuMatrix);
 	}
 }
\ No newline at end of file
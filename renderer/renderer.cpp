@@ -12,16 +12,17 @@
 Renderer::ClusterForwardRenderer::ClusterForwardRenderer():
 	BaseRenderer(),
 	mIsFirstFrame(true),
-	mComputeFence(nullptr),
 	mGraphicsCmd(nullptr),
 	mSkyboxPass(nullptr),
-	mComputeFenceValue(1),
-	mContext(std::make_shared<RendererContext>(mCmdManager))
+	mContext(std::make_shared<RendererContext>(mCmdManager)),
+	mOcclusionCuller(std::make_unique<SoftwareOcclusionCuller>()),
+	mShadowCasterCuller(std::make_unique<ShadowCasterCuller>()),
+	mDrawPackets(std::make_unique<DrawPacketList>()),
+	mPostGraph(std::make_unique<RenderGraph>()),
+	mPostGraphBackend(std::make_unique<D3D12RenderGraphBackend>())
 {
 	Ensures(AssetLoader::gStbTextureLoader);
-	Ensures(g_Device->CreateFence(0, D3D12_FENCE_FLAG_NONE, IID_PPV_ARGS(&mComputeFence)) == S_OK);
-	mComputeFenceHandle = CreateEvent(nullptr, false, false, nullptr);
-	mGraphicsCmd = mCmdManager->AllocateCmdList(D3D12_COMMAND_LIST_TYPE_DIRECT);
+	mFrameCmds = std::make_unique<FrameCommandLists>(mCmdManager);
 	mComputeCmd = mCmdManager->AllocateCmdList(D3D12_COMMAND_LIST_TYPE_COMPUTE);
 	
 	CreateTextures();
@@ -31,12 +32,15 @@ Renderer::ClusterForwardRenderer::ClusterForwardRenderer():
 	CreateRenderTask();
 	mSkyboxPass = std::make_unique<SkyboxPass>(mContext);
 	mLightCullPass = std::make_unique<LightCullPass>(mContext);
+	mZBinTileMaskPass = std::make_unique<ZBinTileMaskPass>(mContext);
+	mGpuCullPass = std::make_unique<GpuCullPass>(mContext, mColorPassRootSignature);
 	InitPostProcess();
 }
 
 Renderer::ClusterForwardRenderer::~ClusterForwardRenderer()
 {
-	
+	//The frames in flight still reference the buffers and passes released with the members.
+	mDeviceManager->WaitForIdle();
 }
 
 
@@ -52,7 +56,35 @@ void Renderer::ClusterForwardRenderer::SetTargetWindowAndCreateSwapChain(HWND In
 
 void Renderer::ClusterForwardRenderer::Update(float delta)
 {
+	if (mCurrentScene)
+	{
+		mCurrentScene->SetStreamingFocus(mDefaultCamera->GetEye());
+		mCurrentScene->Update(delta);
+	}
+	if (mAutoTuneClusterGrid && ++mFramesSinceGridTune >= CLUSTER_GRID_TUNE_INTERVAL)
+	{
+		TuneClusterGrid();
+		mFramesSinceGridTune = 0;
+	}
+	if (mRunLightCullBenchmark)
+	{
+		BenchmarkLightCulling();
+		mRunLightCullBenchmark = false;
+	}
+	if (mRunDrawRecordBenchmark)
+	{
+		BenchmarkDrawRecording();
+		mRunDrawRecordBenchmark = false;
+	}
+	if (mRunGeometryDefragment)
+	{
+		DefragmentGeometry();
+		mRunGeometryDefragment = false;
+	}
+	//Blocks only while the GPU is more than mFramesInFlight frames behind,recording overlaps the frames before.
+	BeginFrame();
 	UpdataFrameData();
+	mGpuDrivenFrame = mUseGpuDrivenDrawing;
 	mRenderExecution->run(*mRenderFlow).wait();
 }
        
@@ -70,7 +102,7 @@ std::shared_ptr<Renderer::RendererContext> Renderer::ClusterForwardRenderer::Get
 void Renderer::ClusterForwardRenderer::CreateRenderTask()
 {
 	mRenderFlow = std::make_unique<tf::Taskflow>();
-	mRenderExecution = std::make_unique<tf::Executor>();
+	mRenderExecution = &engine::gGameEngine->GetExecutor();
 	auto SkyboxPass = [this]()
 		{
 			//Render Scene
@@ -79,7 +111,7 @@ void Renderer::ClusterForwardRenderer::CreateRenderTask()
 			{
 				return;
 			}
-			auto frameDataIndex = lCurrentBackbufferIndex % SWAP_CHAIN_BUFFER_COUNT;
+			auto frameDataIndex = mDeviceManager->GetFrameSlot();
 			TransitState(mGraphicsCmd, mContext->GetRenderTarget(RenderTarget::COLOR_OUTPUT_MSAA)->GetResource(), D3D12_RESOURCE_STATE_RESOLVE_SOURCE, D3D12_RESOURCE_STATE_RENDER_TARGET);
 			mSkyboxPass->SetRenderPassStates(mGraphicsCmd);
 			mGraphicsCmd->SetGraphicsRootConstantBufferView(0, mFrameDataGPU[frameDataIndex]->RootConstantBufferView());
@@ -92,13 +124,12 @@ void Renderer::ClusterForwardRenderer::CreateRenderTask()
 
 	auto DepthOnlyPass = [this]()
 		{
-			mDeviceManager->BeginFrame();
 			auto lCurrentBackbufferIndex = mDeviceManager->GetCurrentFrameIndex();
-			auto frameDataIndex = lCurrentBackbufferIndex % SWAP_CHAIN_BUFFER_COUNT;
+			auto frameDataIndex = mDeviceManager->GetFrameSlot();
 
 
-			mGraphicsCmdAllocator = mCmdManager->RequestAllocator(D3D12_COMMAND_LIST_TYPE_DIRECT, mGraphicsFenceValue);
-			mGraphicsCmd->Reset(mGraphicsCmdAllocator, mPipelineStateDepthOnly);
+			mFrameCmds->BeginFrame(mDeviceManager->GetTimeline(D3D12_COMMAND_LIST_TYPE_DIRECT).GetCompletedValue());
+			mGraphicsCmd = mFrameCmds->Open(mPipelineStateDepthOnly);
 			if (mIsFirstFrame)
 			{
 				FirstFrame();
@@ -114,46 +145,42 @@ void Renderer::ClusterForwardRenderer::CreateRenderTask()
 				D3D12_RESOURCE_STATE_VERTEX_AND_CONSTANT_BUFFER);
 
 
+			//The staged instances have to land in the persistent buffer even if the scene stopped being ready since.
+			if (mGpuCullPrepared)
+			{
+				RecordGpuInstanceUpload(frameDataIndex);
+			}
+
 			//Setup RenderTarget
 			TransitState(mGraphicsCmd, g_DisplayPlane[lCurrentBackbufferIndex].GetResource(), D3D12_RESOURCE_STATE_PRESENT, D3D12_RESOURCE_STATE_RENDER_TARGET);
-			mGraphicsCmd->OMSetRenderTargets(0, nullptr, true, &mContext->GetDepthBuffer()->GetDSV());
-			mGraphicsCmd->RSSetViewports(1, &mViewPort);
-			mGraphicsCmd->RSSetScissorRects(1, &mRect);
+			SetDrawPassStates(mGraphicsCmd, DrawPass::DEPTH_ONLY, frameDataIndex);
 			mGraphicsCmd->ClearDepthStencilView(mContext->GetDepthBuffer()->GetDSV(), D3D12_CLEAR_FLAG_DEPTH, 0.0f, 0, 1, &mRect);
-
-			//Set Resources
-			mGraphicsCmd->SetGraphicsRootSignature(mColorPassRootSignature);
-			mGraphicsCmd->IASetPrimitiveTopology(D3D12_PRIMITIVE_TOPOLOGY::D3D10_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
-			mGraphicsCmd->SetGraphicsRootConstantBufferView(ROOT_PARA_FRAME_DATA_CBV, mFrameDataGPU[frameDataIndex]->RootConstantBufferView());
-			auto vbview = mContext->GetVertexBuffer()->VertexBufferView();
-			mGraphicsCmd->IASetVertexBuffers(0, 1, &vbview);
-			auto ibview = mContext->GetIndexBuffer()->IndexBufferView();
-			mGraphicsCmd->IASetIndexBuffer(&ibview);
-			mGraphicsCmd->SetPipelineState(mPipelineStateDepthOnly);
 			using namespace ECS;
 			if (mCurrentScene && mCurrentScene->IsSceneReady())
 			{
-                auto& sceneRegistry = mCurrentScene->GetRegistery();
-                auto renderEntities = sceneRegistry.view<StaticMeshComponent, TransformComponent>();
-                //auto renderEntitiesCount = renderEntities.size();
-                renderEntities.each([=](auto entity, auto& renderComponent, auto& transformComponent) {
-                    auto modelMatrix = transformComponent.GetModelMatrix();
-                    mGraphicsCmd->SetGraphicsRoot32BitConstants(ROOT_PARA_COMPONENT_DATA, 16, &modelMatrix, 0);
-                    DrawObject(renderComponent);
-                });
+				if (mGpuCullPrepared)
+				{
+					RecordGpuDrivenPass(DrawPass::DEPTH_ONLY, frameDataIndex);
+					RecordHiZBuild(frameDataIndex);
+				}
+				else
+				{
+					RecordDrawPackets(DrawPass::DEPTH_ONLY, frameDataIndex);
+				}
 
 				//ShadowMap
 				auto shadowMap = mContext->GetShadowMap();
 				TransitState(mGraphicsCmd, shadowMap->GetResource(), D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE, D3D12_RESOURCE_STATE_DEPTH_WRITE);
-				mGraphicsCmd->SetPipelineState(mPipelineStateShadowMap);
-				mGraphicsCmd->OMSetRenderTargets(0, nullptr, true, &shadowMap->GetDSV());
+				SetDrawPassStates(mGraphicsCmd, DrawPass::SHADOW_MAP, frameDataIndex);
 				mGraphicsCmd->ClearDepthStencilView(shadowMap->GetDSV(), D3D12_CLEAR_FLAG_DEPTH, 0.0f, 0, 1, &mRect);
-				//auto renderEntitiesCount = renderEntities.size();
-				renderEntities.each([=](auto entity, auto& renderComponent, auto& transformComponent) {
-					auto modelMatrix = transformComponent.GetModelMatrix();
-					mGraphicsCmd->SetGraphicsRoot32BitConstants(ROOT_PARA_COMPONENT_DATA, 16, &modelMatrix, 0);
-					DrawObject(renderComponent);
-					});
+				if (mGpuCullPrepared)
+				{
+					RecordGpuDrivenPass(DrawPass::SHADOW_MAP, frameDataIndex);
+				}
+				else
+				{
+					RecordDrawPackets(DrawPass::SHADOW_MAP, frameDataIndex);
+				}
 				TransitState(mGraphicsCmd, shadowMap->GetResource(),D3D12_RESOURCE_STATE_DEPTH_WRITE, D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE);
 
 				
@@ -163,204 +190,187 @@ void Renderer::ClusterForwardRenderer::CreateRenderTask()
 	auto ColorPass = [this]()
 		{
 			auto lCurrentBackbufferIndex = mDeviceManager->GetCurrentFrameIndex();
-			auto frameDataIndex = lCurrentBackbufferIndex % SWAP_CHAIN_BUFFER_COUNT;
+			auto frameDataIndex = mDeviceManager->GetFrameSlot();
+			auto& lGraphicsTimeline = mDeviceManager->GetTimeline(D3D12_COMMAND_LIST_TYPE_DIRECT);
+			auto& lComputeTimeline = mDeviceManager->GetTimeline(D3D12_COMMAND_LIST_TYPE_COMPUTE);
+
+			const bool lCpuLightCull = mUseCpuLightCulling;
+			const bool lValidateLightCull = mValidateLightCulling && !lCpuLightCull;
+			const bool lZBins = (LightCullMode)mFrameData[frameDataIndex].LightCullMode == LightCullMode::ZBINS;
+			const bool lGpuClusterCull = !lZBins && !lCpuLightCull;
+			const bool lMarkFromDepth = lGpuClusterCull && mUseActiveClusters;
+			auto lDepthBuffer = mContext->GetDepthBuffer();
+			//The compute list rewrites the light and cluster buffers,the previous frame's color pass has to be done reading them.
+			uint64_t lGraphicsValue = mDeviceManager->GetFramePacer().GetLastFrameValue();
+			if (lMarkFromDepth)
+			{
+				//Submit the depth prepass so the compute queue can mark clusters from it,the color pass continues on a new list.
+				ID3D12CommandQueue* graphicsQueue = mCmdManager->GetQueue(D3D12_COMMAND_LIST_TYPE_DIRECT);
+				TransitState(mGraphicsCmd, lDepthBuffer->GetResource(), D3D12_RESOURCE_STATE_DEPTH_WRITE, D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE);
+				mFrameCmds->Submit(graphicsQueue);
+				lGraphicsValue = lGraphicsTimeline.Signal();
+				mGraphicsCmd = mFrameCmds->Open(nullptr);
+				//Recorded now,runs after the graphics queue waited for the compute list below.
+				TransitState(mGraphicsCmd, lDepthBuffer->GetResource(), D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE, D3D12_RESOURCE_STATE_DEPTH_WRITE);
+			}
 
-			ID3D12CommandAllocator* cmdAllcator = mDeviceManager->GetCmdManager()->RequestAllocator(D3D12_COMMAND_LIST_TYPE_COMPUTE, mComputeFenceValue);
+			ID3D12CommandAllocator* cmdAllcator = mDeviceManager->GetCmdManager()->RequestAllocator(D3D12_COMMAND_LIST_TYPE_COMPUTE, lComputeTimeline.GetCompletedValue());
 			mComputeCmd->Reset(cmdAllcator, nullptr);
-			mLightCullPass->SetRenderPassStates(mComputeCmd);
-			mComputeCmd->SetComputeRootConstantBufferView(0, mFrameDataGPU[frameDataIndex]->RootConstantBufferView());
-			mComputeCmd->SetComputeRootShaderResourceView(1, mLightBuffer->GetGpuVirtualAddress());
-			mComputeCmd->SetComputeRootUnorderedAccessView(2, mClusterBuffer->GetGpuVirtualAddress());
-			mLightCullPass->RenderScene(mComputeCmd);
-			ID3D12CommandQueue* queue = mDeviceManager->GetCmdManager()->GetQueue(D3D12_COMMAND_LIST_TYPE_COMPUTE);
-			ID3D12CommandList* lCmds = { mComputeCmd };
-			mComputeCmd->Close();
-			queue->ExecuteCommandLists(1, &lCmds);
-			queue->Signal(mComputeFence, mComputeFenceValue);
-			mDeviceManager->GetCmdManager()->Discard(D3D12_COMMAND_LIST_TYPE_COMPUTE, cmdAllcator, mComputeFenceValue);
-			mComputeFence->SetEventOnCompletion(mComputeFenceValue, mComputeFenceHandle);
-			mComputeFenceValue++;
-
-			//Render Scene
-			WaitForSingleObject(mComputeFenceHandle, INFINITE);
-#if 0
-			mGraphicsCmd->SetPipelineState(mColorPassPipelineState);
-#endif
-			mGraphicsCmd->SetPipelineState(mColorPassPipelineState8XMSAA);
-			mGraphicsCmd->SetGraphicsRootSignature(mColorPassRootSignature);
-			std::vector<ID3D12DescriptorHeap*> heaps = { g_DescHeap[D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV]->GetDescHeap() };
-			mGraphicsCmd->SetDescriptorHeaps((UINT)heaps.size(), heaps.data());
-			mGraphicsCmd->SetGraphicsRootConstantBufferView(ROOT_PARA_FRAME_DATA_CBV, mFrameDataGPU[frameDataIndex]->RootConstantBufferView());
-			mGraphicsCmd->SetGraphicsRootDescriptorTable(ROOT_PARA_FRAME_SOURCE_TABLE, mLightBuffer->GetSRVGpu());
-			//mGraphicsCmd->SetGraphicsRootConstantBufferView(3, mLightCullViewDataGpu->GetGpuVirtualAddress());
-#if 0
-			mGraphicsCmd->OMSetRenderTargets(1, &g_DisplayPlane[lCurrentBackbufferIndex].GetRTV(), true, &mContext->GetDepthBuffer()->GetDSV_ReadOnly());
-#endif
-			mGraphicsCmd->OMSetRenderTargets(1, &mContext->GetRenderTarget(RenderTarget::COLOR_OUTPUT_MSAA)->GetRTV(), true, &mContext->GetDepthBuffer()->GetDSV_ReadOnly());
-			mGraphicsCmd->SetGraphicsRootDescriptorTable(ROOT_PARA_SHADOW_MAP, mContext->GetShadowMap()->GetDepthSRVGPU());
-			using namespace ECS;
-            if (mCurrentScene && mCurrentScene->IsSceneReady()) 
+			mLightBuffer->RecordUpload(mComputeCmd, frameDataIndex);
+			if (!lZBins && lCpuLightCull)
 			{
-                auto& sceneRegistry = mCurrentScene->GetRegistery();
-                auto renderEntities = sceneRegistry.view<StaticMeshComponent, TransformComponent>();
-                renderEntities.each([=](auto entity, auto& renderComponent, auto& transformComponent) {
-                    auto modelMatrix = transformComponent.GetModelMatrix();
-					
-					
-					OjbectData objData = {};
-					objData.ModelMatrix = modelMatrix;
-					objData.DiffuseColor = renderComponent.mBaseColor;
-					constexpr int objSize = sizeof(OjbectData) / 4;
-                    mGraphicsCmd->SetGraphicsRoot32BitConstants(ROOT_PARA_COMPONENT_DATA, objSize, &objData, 0);
-					//Render 
-					for (const auto& [matid,subMesh] : renderComponent.mSubMeshes)
-					{
-						auto subMeshTextureName = renderComponent.mMatBaseColorName[matid];
-						auto subMeshNormalMapName = renderComponent.mMatNormalMapName[matid];
-
-						if (mTextureMap.find(subMeshTextureName) == mTextureMap.end())
-						{
-							mGraphicsCmd->SetGraphicsRootDescriptorTable(ROOT_PARA_DIFFUSE_COLOR_TEXTURE, mTextureMap["defaultTexture"]->GetSRVGpu());
-						}
-						else
-						{
-							mGraphicsCmd->SetGraphicsRootDescriptorTable(ROOT_PARA_DIFFUSE_COLOR_TEXTURE, mTextureMap[subMeshTextureName]->GetSRVGpu());
-						}
-
-						if (mTextureMap.find(subMeshNormalMapName) == mTextureMap.end())
-						{
-							mGraphicsCmd->SetGraphicsRootDescriptorTable(ROOT_PARA_NORMAL_MAP_TEXTURE, mTextureMap["defaultNormal"]->GetSRVGpu());
-						}
-						else
-						{
-							mGraphicsCmd->SetGraphicsRootDescriptorTable(ROOT_PARA_NORMAL_MAP_TEXTURE, mTextureMap[subMeshNormalMapName]->GetSRVGpu());
-						}
-
-						mGraphicsCmd->DrawIndexedInstanced((UINT)subMesh.TriangleCount * 3, 1, renderComponent.StartIndexLocation + subMesh.IndexOffset,
-							renderComponent.BaseVertexLocation, 0);
-					}
-				});
+				mCpuLightCuller->Cull(mFrameData[frameDataIndex], mLightBuffer->GetLights());
 			}
-
-			if (mUseToneMapping)
+			//Upload slices and the readback hold the cluster ranges of the largest grid followed by the whole index list.
+			const size_t lClusterBytes = mCLusters.size() * sizeof(Cluster);
+			const auto& lFrame = mFrameData[frameDataIndex];
+			const size_t lGridClusterBytes = size_t(lFrame.ClusterCountX) * lFrame.ClusterCountY * lFrame.ClusterCountZ * sizeof(Cluster);
+			const size_t lListBytes = lClusterBytes + mClusterLightIndices.size() * sizeof(uint32_t);
+			if (lZBins)
 			{
-				//Resolve MSAA RT to normal RT
-				TransitState(mGraphicsCmd, mContext->GetRenderTarget(RenderTarget::COLOR_OUTPUT_MSAA)->GetResource(), D3D12_RESOURCE_STATE_RENDER_TARGET, D3D12_RESOURCE_STATE_RESOLVE_SOURCE);
-				TransitState(mGraphicsCmd, mContext->GetRenderTarget(RenderTarget::COLOR_OUTPUT_RESOLVED)->GetResource(), D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE, D3D12_RESOURCE_STATE_RESOLVE_DEST);
-				mGraphicsCmd->ResolveSubresource(mContext->GetRenderTarget(RenderTarget::COLOR_OUTPUT_RESOLVED)->GetResource(), 0, mContext->GetRenderTarget(RenderTarget::COLOR_OUTPUT_MSAA)->GetResource(), 0, DXGI_FORMAT_R16G16B16A16_FLOAT);
-				TransitState(mGraphicsCmd, mContext->GetRenderTarget(RenderTarget::COLOR_OUTPUT_RESOLVED)->GetResource(), D3D12_RESOURCE_STATE_RESOLVE_DEST, D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE);
-				//Bloom
-
-				auto sceneTex = mContext->GetRenderTarget(RenderTarget::COLOR_OUTPUT_RESOLVED);
-				auto blurHalf = mContext->GetRenderTarget(RenderTarget::BLUR_HALF);
-				auto blurQuat = mContext->GetRenderTarget(RenderTarget::BLUR_QUAT);
-				auto bloomRes = mContext->GetRenderTarget(RenderTarget::BLOOM_RES);
-
-
-				// Bloom Pass 1 (scene -> blur1)
-				ppBloomExtract->SetSourceTexture(sceneTex->GetSRVGPU(),sceneTex->GetResource());
-				ppBloomExtract->SetBloomExtractParameter(mBloomThreshold);
-				mGraphicsCmd->OMSetRenderTargets(1, &blurHalf->GetRTV(), FALSE, nullptr);
-				SimpleMath::Viewport halfvp(mViewPort);
-				halfvp.height /= 2.f;
-				halfvp.width /= 2.f;
-				mGraphicsCmd->RSSetViewports(1, halfvp.Get12());
-				ppBloomExtract->Process(mGraphicsCmd);
-
-				// Pass 2 (blur1 -> blur2)
+				RecordZBinCull(frameDataIndex, lCpuLightCull, lValidateLightCull);
+			}
+			else if (lCpuLightCull)
+			{
+				//Fallback:upload the CPU lists in place of the dispatches.
+				if (!mClusterUploadRing)
 				{
-					auto barrier = CD3DX12_RESOURCE_BARRIER::Transition(blurHalf->GetResource(),
-						D3D12_RESOURCE_STATE_RENDER_TARGET,
-						D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE, 0);
-					mGraphicsCmd->ResourceBarrier(1, &barrier);
+					mClusterUploadRing = std::make_unique<Resource::UploadBuffer>();
+					mClusterUploadRing->Create(L"ClusterUploadRing", lListBytes * SWAP_CHAIN_BUFFER_COUNT);
+					mClusterUploadData = mClusterUploadRing->MapPersistent();
 				}
-				
-
-				ppBloomBlur->SetSourceTexture(blurHalf->GetSRVGPU(), blurHalf->GetResource());
-				ppBloomBlur->SetBloomBlurParameters(true, mBloomBlurKernelSize, mBloomBrightness);
-				mGraphicsCmd->OMSetRenderTargets(1, &blurQuat->GetRTV(), FALSE, nullptr);
-				ppBloomBlur->Process(mGraphicsCmd);
-
-
-				// Pass 3 (blur2 -> blur1)
+				auto lClusters = mCpuLightCuller->GetClusters();
+				auto lIndices = mCpuLightCuller->GetLightIndices();
+				const size_t lSliceOffset = frameDataIndex * lListBytes;
+				memcpy(mClusterUploadData + lSliceOffset, lClusters.data(), lClusters.size_bytes());
+				mComputeCmd->CopyBufferRegion(mClusterBuffer->GetResource(), 0, mClusterUploadRing->GetResource(), lSliceOffset, lClusters.size_bytes());
+				if (!lIndices.empty())
 				{
-					CD3DX12_RESOURCE_BARRIER barriers[2] =
-					{
-						CD3DX12_RESOURCE_BARRIER::Transition(blurHalf->GetResource(),
-						D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE,
-						D3D12_RESOURCE_STATE_RENDER_TARGET, 0),
-						CD3DX12_RESOURCE_BARRIER::Transition(blurQuat->GetResource(),
-						D3D12_RESOURCE_STATE_RENDER_TARGET,
-						D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE, 0),
-					};
-					mGraphicsCmd->ResourceBarrier(2, barriers);
+					memcpy(mClusterUploadData + lSliceOffset + lClusterBytes, lIndices.data(), lIndices.size_bytes());
+					mComputeCmd->CopyBufferRegion(mClusterLightIndexBuffer->GetResource(), 0, mClusterUploadRing->GetResource(), lSliceOffset + lClusterBytes, lIndices.size_bytes());
 				}
-				ppBloomBlur->SetSourceTexture(blurQuat->GetSRVGPU(), blurQuat->GetResource());
-				ppBloomBlur->SetBloomBlurParameters(false, mBloomBlurKernelSize, mBloomBrightness);
-				mGraphicsCmd->OMSetRenderTargets(1, &blurHalf->GetRTV(), FALSE, nullptr);
-				ppBloomBlur->Process(mGraphicsCmd);
-
-
-				// Pass 4 (scene+blur1 -> rt)
+			}
+			else
+			{
+				const uint32_t lDepthRangeCount = uint32_t(mWidth) * uint32_t(mHeight);
+				const bool lWriteDepthRanges = lValidateLightCull && lMarkFromDepth;
+				if (lWriteDepthRanges && (!mPixelDepthRangeBuffer || mPixelDepthRangeBuffer->GetElementCount() != lDepthRangeCount))
 				{
-					auto barrier = CD3DX12_RESOURCE_BARRIER::Transition(blurHalf->GetResource(),
-						D3D12_RESOURCE_STATE_RENDER_TARGET,
-						D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE, 0);
-					mGraphicsCmd->ResourceBarrier(1, &barrier);
+					mPixelDepthRangeBuffer = std::make_unique<Resource::StructuredBuffer>();
+					mPixelDepthRangeBuffer->Create(L"PixelDepthRangeBuffer", lDepthRangeCount, sizeof(DirectX::XMFLOAT2));
+					mPixelDepthRangeReadback = std::make_unique<Resource::ReadbackBuffer>();
+					mPixelDepthRangeReadback->Create(L"PixelDepthRangeReadback", lDepthRangeCount * sizeof(DirectX::XMFLOAT2));
+					mPixelDepthRanges.resize(lDepthRangeCount);
 				}
-
-				ppBloomCombine->SetSourceTexture(sceneTex->GetSRVGPU());
-				ppBloomCombine->SetSourceTexture2(blurHalf->GetSRVGPU());
-				ppBloomCombine->SetBloomCombineParameters(mbloomIntensity, mbaseIntensity, mbloomSaturation, mbloomBaseSaturation);
-				mGraphicsCmd->OMSetRenderTargets(1, &bloomRes->GetRTV(), FALSE, nullptr);
-				mGraphicsCmd->RSSetViewports(1, &mViewPort); 
-				ppBloomCombine->Process(mGraphicsCmd);
-
+				mLightCullPass->SetClusterGrid({ lFrame.ClusterCountX, lFrame.ClusterCountY, lFrame.ClusterCountZ });
+				mLightCullPass->SetActiveClusters(mActiveClusterArgsBuffer->GetResource(), lMarkFromDepth, lWriteDepthRanges, mWidth, mHeight);
+				mLightCullPass->SetRenderPassStates(mComputeCmd);
+				std::vector<ID3D12DescriptorHeap*> lHeaps = { g_DescHeap[D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV]->GetDescHeap() };
+				mComputeCmd->SetDescriptorHeaps((UINT)lHeaps.size(), lHeaps.data());
+				//The default heap copy is made by the graphics queue later in the frame,read the slot's upload buffer instead.
+				mComputeCmd->SetComputeRootConstantBufferView(0, mFrameDataCPU[frameDataIndex]->GetResource()->GetGPUVirtualAddress());
+				mComputeCmd->SetComputeRootShaderResourceView(1, mLightBuffer->GetGpuVirtualAddress());
+				mComputeCmd->SetComputeRootUnorderedAccessView(2, mClusterBuffer->GetGpuVirtualAddress());
+				mComputeCmd->SetComputeRootUnorderedAccessView(3, mClusterLightIndexBuffer->GetGpuVirtualAddress());
+				mComputeCmd->SetComputeRootUnorderedAccessView(5, mActiveClusterFlagBuffer->GetGpuVirtualAddress());
+				mComputeCmd->SetComputeRootUnorderedAccessView(6, mActiveClusterListBuffer->GetGpuVirtualAddress());
+				mComputeCmd->SetComputeRootUnorderedAccessView(7, mActiveClusterArgsBuffer->GetGpuVirtualAddress());
+				//Only written when validating,any valid address satisfies the root signature otherwise.
+				mComputeCmd->SetComputeRootUnorderedAccessView(8, lWriteDepthRanges ? mPixelDepthRangeBuffer->GetGpuVirtualAddress() : mActiveClusterFlagBuffer->GetGpuVirtualAddress());
+				mComputeCmd->SetComputeRootDescriptorTable(9, lDepthBuffer->GetDepthSRVGPU());
+				mLightCullPass->RenderScene(mComputeCmd);
+				//The arguments are left in INDIRECT_ARGUMENT,the count behind them feeds the stats.
+				//Each frame slot copies them to its own range,read once the compute queue got past it.
+				ReadActiveClusterStats(lComputeTimeline.GetCompletedValue());
+				TransitState(mComputeCmd, mActiveClusterArgsBuffer->GetResource(), D3D12_RESOURCE_STATE_INDIRECT_ARGUMENT, D3D12_RESOURCE_STATE_COPY_SOURCE);
+				mComputeCmd->CopyBufferRegion(mActiveClusterReadback->GetResource(), frameDataIndex * LightCullPass::ACTIVE_ARGS_BYTES, mActiveClusterArgsBuffer->GetResource(), 0, LightCullPass::ACTIVE_ARGS_BYTES);
+				if (lValidateLightCull)
 				{
-					CD3DX12_RESOURCE_BARRIER barriers[3] =
+					if (!mClusterReadback)
+					{
+						mClusterReadback = std::make_unique<Resource::ReadbackBuffer>();
+						mClusterReadback->Create(L"ClusterReadback", lListBytes);
+					}
+					//The dispatches promoted the buffers to UNORDERED_ACCESS,they decay back to COMMON after the list.
+					TransitState(mComputeCmd, mClusterBuffer->GetResource(), D3D12_RESOURCE_STATE_UNORDERED_ACCESS, D3D12_RESOURCE_STATE_COPY_SOURCE);
+					TransitState(mComputeCmd, mClusterLightIndexBuffer->GetResource(), D3D12_RESOURCE_STATE_UNORDERED_ACCESS, D3D12_RESOURCE_STATE_COPY_SOURCE);
+					TransitState(mComputeCmd, mActiveClusterListBuffer->GetResource(), D3D12_RESOURCE_STATE_UNORDERED_ACCESS, D3D12_RESOURCE_STATE_COPY_SOURCE);
+					mComputeCmd->CopyBufferRegion(mClusterReadback->GetResource(), 0, mClusterBuffer->GetResource(), 0, lGridClusterBytes);
+					mComputeCmd->CopyBufferRegion(mClusterReadback->GetResource(), lClusterBytes, mClusterLightIndexBuffer->GetResource(), 0, lListBytes - lClusterBytes);
+					mComputeCmd->CopyBufferRegion(mActiveClusterReadback->GetResource(), ACTIVE_CLUSTER_LIST_READBACK_OFFSET, mActiveClusterListBuffer->GetResource(), 0, lGridClusterBytes / sizeof(Cluster) * sizeof(uint32_t));
+					if (lWriteDepthRanges)
 					{
-						CD3DX12_RESOURCE_BARRIER::Transition(blurHalf->GetResource(),
-							D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE,
-							D3D12_RESOURCE_STATE_RENDER_TARGET, 0),
-						CD3DX12_RESOURCE_BARRIER::Transition(blurQuat->GetResource(),
-							D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE,
-							D3D12_RESOURCE_STATE_RENDER_TARGET, 0),
-						CD3DX12_RESOURCE_BARRIER::Transition(bloomRes->GetResource(),
-							D3D12_RESOURCE_STATE_RENDER_TARGET,
-							D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE, 0)
-					};
-					mGraphicsCmd->ResourceBarrier(3, barriers);
+						TransitState(mComputeCmd, mPixelDepthRangeBuffer->GetResource(), D3D12_RESOURCE_STATE_UNORDERED_ACCESS, D3D12_RESOURCE_STATE_COPY_SOURCE);
+						mComputeCmd->CopyBufferRegion(mPixelDepthRangeReadback->GetResource(), 0, mPixelDepthRangeBuffer->GetResource(), 0, lDepthRangeCount * sizeof(DirectX::XMFLOAT2));
+					}
 				}
+			}
+			ID3D12CommandQueue* queue = mDeviceManager->GetCmdManager()->GetQueue(D3D12_COMMAND_LIST_TYPE_COMPUTE);
+			ID3D12CommandList* lCmds = { mComputeCmd };
+			mComputeCmd->Close();
+			lComputeTimeline.Wait(lGraphicsTimeline, lGraphicsValue);
+			queue->ExecuteCommandLists(1, &lCmds);
+			const uint64_t lComputeValue = lComputeTimeline.Signal();
+			mDeviceManager->GetCmdManager()->Discard(D3D12_COMMAND_LIST_TYPE_COMPUTE, cmdAllcator, lComputeValue);
+			if (lGpuClusterCull)
+			{
+				mPendingClusterStats[frameDataIndex] = { lComputeValue, uint32_t(lGridClusterBytes / sizeof(Cluster)) };
+			}
+			//The color pass reads the culled lights,the graphics queue waits for them instead of the CPU.
+			lGraphicsTimeline.Wait(lComputeTimeline, lComputeValue);
 
-
-
-
-				//Tone Mapping
-				ppToneMap->SetHDRSourceTexture(bloomRes->GetSRVGPU());
-				mGraphicsCmd->OMSetRenderTargets(1, &g_DisplayPlane[lCurrentBackbufferIndex].GetRTV(), true, nullptr);
-				ppToneMap->SetExposure(mExposure);
-				ppToneMap->Process(mGraphicsCmd);
-
+			//Render Scene
+			//Validation compares this frame's GPU results on the CPU,only then does the CPU wait for the compute list.
+			if (lValidateLightCull)
+			{
+				lComputeTimeline.WaitForValue(lComputeValue);
+			}
+			if (lZBins)
+			{
+				if (lValidateLightCull)
 				{
-					auto barrier = CD3DX12_RESOURCE_BARRIER::Transition(bloomRes->GetResource(),
-						D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE,
-						D3D12_RESOURCE_STATE_RENDER_TARGET, 0);
-					mGraphicsCmd->ResourceBarrier(1, &barrier);
-
+					auto lGpuMasks = std::span(mZBinTileMasks).first(mZBinCuller->GetTileMasks().size());
+					mZBinReadback->ReadData(lGpuMasks);
+					mZBinCuller->Compare(lGpuMasks);
 				}
-				
-
+				mZBinCullStats = mZBinCuller->GetStats();
 			}
-			else
+			else if (lGpuClusterCull && lValidateLightCull)
+			{
+				ReadActiveClusterStats(lComputeValue);
+				//The reference needs the GPU's depth ranges,so it runs after the compute list.
+				if (lMarkFromDepth)
+				{
+					mPixelDepthRangeReadback->ReadData(std::span(mPixelDepthRanges));
+					mCpuLightCuller->MarkActiveClusters(lFrame, mPixelDepthRanges, mWidth);
+				}
+				mCpuLightCuller->Cull(lFrame, mLightBuffer->GetLights(), lMarkFromDepth);
+				auto lGpuActive = std::span(mActiveClusterList).first(std::min(mActiveClusterStats.mActiveClusters, mActiveClusterStats.mTotalClusters));
+				mActiveClusterReadback->ReadData(lGpuActive, ACTIVE_CLUSTER_LIST_READBACK_OFFSET);
+				mCpuLightCuller->CompareActiveClusters(lGpuActive);
+				mClusterReadback->ReadData(std::span(mCLusters).first(lGridClusterBytes / sizeof(Cluster)));
+				mClusterReadback->ReadData(std::span(mClusterLightIndices), lClusterBytes);
+				mCpuLightCuller->Compare(mCLusters, mClusterLightIndices);
+			}
+			if (!lZBins && (lCpuLightCull || lValidateLightCull))
 			{
-				//Resolve MSAA RT to swap chain back buffer
-				TransitState(mGraphicsCmd, g_DisplayPlane[lCurrentBackbufferIndex].GetResource(), D3D12_RESOURCE_STATE_RENDER_TARGET, D3D12_RESOURCE_STATE_RESOLVE_DEST);
-				TransitState(mGraphicsCmd, mContext->GetRenderTarget(RenderTarget::COLOR_OUTPUT_MSAA)->GetResource(), D3D12_RESOURCE_STATE_RENDER_TARGET, D3D12_RESOURCE_STATE_RESOLVE_SOURCE);
-				mGraphicsCmd->ResolveSubresource(g_DisplayPlane[lCurrentBackbufferIndex].GetResource(), 0, mContext->GetRenderTarget(RenderTarget::COLOR_OUTPUT_MSAA)->GetResource(), 0, DXGI_FORMAT_R16G16B16A16_FLOAT);
-				TransitState(mGraphicsCmd, g_DisplayPlane[lCurrentBackbufferIndex].GetResource(), D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE, D3D12_RESOURCE_STATE_RESOLVE_DEST);
-				TransitState(mGraphicsCmd, g_DisplayPlane[lCurrentBackbufferIndex].GetResource(), D3D12_RESOURCE_STATE_RESOLVE_DEST, D3D12_RESOURCE_STATE_RENDER_TARGET);
+				mClusterCullStats = mCpuLightCuller->GetStats();
 			}
-			
+			SetDrawPassStates(mGraphicsCmd, DrawPass::COLOR, frameDataIndex);
+			using namespace ECS;
+            if (mCurrentScene && mCurrentScene->IsSceneReady()) 
+			{
+				if (mGpuCullPrepared)
+				{
+					RecordGpuDrivenPass(DrawPass::COLOR, frameDataIndex);
+				}
+				else
+				{
+					RecordDrawPackets(DrawPass::COLOR, frameDataIndex);
+				}
+			}
+
+			RecordPostProcess(lCurrentBackbufferIndex);
 		};
 
 	auto GuiPass = [=] {
@@ -377,17 +387,36 @@ void Renderer::ClusterForwardRenderer::CreateRenderTask()
 			//Flush CmdList
 			auto lCurrentBackbufferIndex = mDeviceManager->GetCurrentFrameIndex();
 			TransitState(mGraphicsCmd, g_DisplayPlane[lCurrentBackbufferIndex].GetResource(), D3D12_RESOURCE_STATE_RENDER_TARGET, D3D12_RESOURCE_STATE_PRESENT);
-			mGraphicsCmd->Close();
-			ID3D12CommandList* cmds[] = { mGraphicsCmd };
 			ID3D12CommandQueue* graphicsQueue = mCmdManager->GetQueue(D3D12_COMMAND_LIST_TYPE_DIRECT);
-			graphicsQueue->ExecuteCommandLists(1, cmds);
-			//Wait For cmd finished to reclaim cmd
-			mCmdManager->Discard(D3D12_COMMAND_LIST_TYPE_DIRECT, mGraphicsCmdAllocator, mGraphicsFenceValue);
-			mGraphicsFenceValue++;
-			mDeviceManager->EndFrame();
+			mFrameCmds->Submit(graphicsQueue);
+			mDrawPacketStats.mCommandLists = mFrameCmds->GetListCount();
+			//Post process constants are recycled once the GPU is past this frame.
+			mGPUMemory->Commit(graphicsQueue);
+			//The allocators are reused once the GPU reached the end of frame signal.
+			mFrameCmds->EndFrame(mDeviceManager->EndFrame());
 		};
-    auto [depthOnlyPass, skyboxpass, colorPass, postRender, guiPass ] =
-            mRenderFlow->emplace(DepthOnlyPass, SkyboxPass, ColorPass, PostRender,GuiPass);
+	auto OcclusionCullPass = [this]()
+		{
+			OcclusionCull();
+		};
+
+	auto ShadowCasterCullPass = [this]()
+		{
+			ShadowCasterCull();
+		};
+
+	auto BuildDrawPacketsPass = [this]()
+		{
+			BuildDrawPackets();
+		};
+
+    auto [occlusionCullPass, shadowCasterCullPass, buildDrawPacketsPass, depthOnlyPass, skyboxpass, colorPass, postRender, guiPass ] =
+            mRenderFlow->emplace(OcclusionCullPass, ShadowCasterCullPass, BuildDrawPacketsPass, DepthOnlyPass, SkyboxPass, ColorPass, PostRender,GuiPass);
+	auto [sortDrawPacketsBegin, sortDrawPacketsEnd] = mDrawPackets->EmplaceSortTasks(*mRenderFlow);
+	shadowCasterCullPass.succeed(occlusionCullPass);
+	buildDrawPacketsPass.succeed(shadowCasterCullPass);
+	sortDrawPacketsBegin.succeed(buildDrawPacketsPass);
+	depthOnlyPass.succeed(sortDrawPacketsEnd);
 	skyboxpass.succeed(depthOnlyPass);
 	colorPass.succeed(skyboxpass);
 	guiPass.succeed(colorPass);
@@ -400,9 +429,260 @@ void Renderer::ClusterForwardRenderer::CreateBuffers()
 {
 	BaseRenderer::CreateBuffers();
 	mClusterBuffer = std::make_unique<Resource::StructuredBuffer>();
-	mCLusters.resize(CLUSTER_X * CLUSTER_Y * CLUSTER_Z);
+	mCLusters.resize(MAX_CLUSTER_COUNT);
 	mClusterBuffer->Create(L"ClusterBuffer", (UINT32)mCLusters.size(), sizeof(Cluster));
+	mClusterLightIndexBuffer = std::make_unique<Resource::StructuredBuffer>();
+	mClusterLightIndices.resize(MAX_CLUSTER_LIGHT_INDICES);
+	mClusterLightIndexBuffer->Create(L"ClusterLightIndexBuffer", (UINT32)mClusterLightIndices.size(), sizeof(uint32_t));
+	mActiveClusterFlagBuffer = std::make_unique<Resource::StructuredBuffer>();
+	mActiveClusterFlagBuffer->Create(L"ActiveClusterFlagBuffer", MAX_CLUSTER_COUNT, sizeof(uint32_t));
+	//Padded to whole rows of indirect groups,MAX_CLUSTER_COUNT is a multiple of the row width.
+	static_assert(MAX_CLUSTER_COUNT % LightCullPass::ACTIVE_GROUP_WIDTH == 0);
+	mActiveClusterListBuffer = std::make_unique<Resource::StructuredBuffer>();
+	mActiveClusterListBuffer->Create(L"ActiveClusterListBuffer", MAX_CLUSTER_COUNT, sizeof(uint32_t));
+	mActiveClusterArgsBuffer = std::make_unique<Resource::IndirectArgsBuffer>();
+	mActiveClusterArgsBuffer->Create(L"ActiveClusterArgsBuffer", LightCullPass::ACTIVE_ARGS_BYTES / sizeof(uint32_t), sizeof(uint32_t));
+	mActiveClusterList.resize(MAX_CLUSTER_COUNT);
+	mActiveClusterReadback = std::make_unique<Resource::ReadbackBuffer>();
+	mActiveClusterReadback->Create(L"ActiveClusterReadback", ACTIVE_CLUSTER_LIST_READBACK_OFFSET + mActiveClusterList.size() * sizeof(uint32_t));
+	mCpuLightCuller = std::make_unique<ClusterLightCuller>(engine::gGameEngine->GetExecutor());
+	mZBinCuller = std::make_unique<ZBinLightCuller>(engine::gGameEngine->GetExecutor());
+	mZBinBuffer = std::make_unique<Resource::StructuredBuffer>();
+	mZBinBuffer->Create(L"ZBinBuffer", ZBIN_COUNT, sizeof(ZBin));
+	//Created small so the color pass root SRVs are always valid,grown on the first z-binned frame.
+	EnsureZBinCapacity(1, 1);
+	EnsureMaterialCapacity(1);
+
+}
+
+void Renderer::ClusterForwardRenderer::EnsureZBinCapacity(uint32_t InLights, uint32_t InTiles)
+{
+	if (InLights <= mZBinLightCapacity && InTiles <= mZBinTileCapacity)
+	{
+		return;
+	}
+	if (mZBinLightOrderBuffer)
+	{
+		mRetiredZBinBuffers.push_back({ mZBinFrameCount + SWAP_CHAIN_BUFFER_COUNT,
+			std::move(mZBinLightOrderBuffer), std::move(mZBinTileRectBuffer), std::move(mZBinTileMaskBuffer), std::move(mZBinUploadRing) });
+	}
+	//At least one full mask word per tile.
+	mZBinLightCapacity = std::max({ mZBinLightCapacity, std::bit_ceil(InLights), 32u });
+	mZBinTileCapacity = std::max(mZBinTileCapacity, std::bit_ceil(InTiles));
+	const uint32_t lMaskWords = mZBinTileCapacity * ZBinLightCuller::GetWordsPerTile(mZBinLightCapacity);
+	mZBinLightOrderBuffer = std::make_unique<Resource::StructuredBuffer>();
+	mZBinLightOrderBuffer->Create(L"ZBinLightOrderBuffer", mZBinLightCapacity, sizeof(uint32_t));
+	mZBinTileRectBuffer = std::make_unique<Resource::StructuredBuffer>();
+	mZBinTileRectBuffer->Create(L"ZBinTileRectBuffer", mZBinLightCapacity, sizeof(ZBinTileRect));
+	mZBinTileMaskBuffer = std::make_unique<Resource::StructuredBuffer>();
+	mZBinTileMaskBuffer->Create(L"ZBinTileMaskBuffer", lMaskWords, sizeof(uint32_t));
+	const size_t lSliceBytes = ZBIN_COUNT * sizeof(ZBin) + size_t(mZBinLightCapacity) * (sizeof(uint32_t) + sizeof(ZBinTileRect)) + size_t(lMaskWords) * sizeof(uint32_t);
+	mZBinUploadRing = std::make_unique<Resource::UploadBuffer>();
+	mZBinUploadRing->Create(L"ZBinUploadRing", lSliceBytes * SWAP_CHAIN_BUFFER_COUNT);
+	mZBinUploadData = mZBinUploadRing->MapPersistent();
+	mZBinTileMasks.resize(lMaskWords);
+	//Recreated at the new size by the next validated frame.
+	mZBinReadback.reset();
+}
+
+void Renderer::ClusterForwardRenderer::EnsureMaterialCapacity(uint32_t InMaterials)
+{
+	if (InMaterials <= mMaterialCapacity)
+	{
+		return;
+	}
+	if (mMaterialRing)
+	{
+		mRetiredMaterialRings.push_back({ mRetireFrame + SWAP_CHAIN_BUFFER_COUNT, std::move(mMaterialRing) });
+	}
+	mMaterialCapacity = std::bit_ceil(InMaterials);
+	mMaterialRing = std::make_unique<Resource::UploadBuffer>();
+	mMaterialRing->Create(L"MaterialRing", size_t(mMaterialCapacity) * sizeof(GpuMaterial) * SWAP_CHAIN_BUFFER_COUNT);
+	mMaterialData = mMaterialRing->MapPersistent();
+	mMaterialAddress = mMaterialRing->GetGpuVirtualAddress();
+}
 
+void Renderer::ClusterForwardRenderer::UploadMaterials(uint32_t InFrameIndex)
+{
+	std::erase_if(mRetiredMaterialRings, [this](const RetiredMaterialRing& InRetired) { return InRetired.mReleaseAfter <= mRetireFrame; });
+	auto lMaterials = mMaterialTable.GetMaterials();
+	EnsureMaterialCapacity((uint32_t)lMaterials.size());
+	const size_t lSliceOffset = size_t(InFrameIndex) * mMaterialCapacity * sizeof(GpuMaterial);
+	if (!lMaterials.empty())
+	{
+		memcpy(mMaterialData + lSliceOffset, lMaterials.data(), lMaterials.size_bytes());
+	}
+	mMaterialAddress = mMaterialRing->GetGpuVirtualAddress() + lSliceOffset;
+}
+
+void Renderer::ClusterForwardRenderer::ReadActiveClusterStats(uint64_t InComputeCompleted)
+{
+	uint32_t lNewest = UINT32_MAX;
+	for (uint32_t slot = 0; slot < SWAP_CHAIN_BUFFER_COUNT; ++slot)
+	{
+		const auto& lPending = mPendingClusterStats[slot];
+		if (lPending.mComputeValue != 0 && lPending.mComputeValue <= InComputeCompleted &&
+			(lNewest == UINT32_MAX || lPending.mComputeValue > mPendingClusterStats[lNewest].mComputeValue))
+		{
+			lNewest = slot;
+		}
+	}
+	if (lNewest == UINT32_MAX)
+	{
+		return;
+	}
+	uint32_t lArgs[LightCullPass::ACTIVE_ARGS_BYTES / sizeof(uint32_t)];
+	mActiveClusterReadback->ReadData(std::span<uint32_t>(lArgs), lNewest * LightCullPass::ACTIVE_ARGS_BYTES);
+	mActiveClusterStats = { lArgs[3], mPendingClusterStats[lNewest].mTotalClusters };
+	//Older slots are superseded by the one just read.
+	for (auto& pending : mPendingClusterStats)
+	{
+		if (pending.mComputeValue <= InComputeCompleted)
+		{
+			pending = {};
+		}
+	}
+}
+
+void Renderer::ClusterForwardRenderer::RecordZBinCull(uint32_t InFrameIndex, bool InCpuMasks, bool InValidate)
+{
+	mZBinFrameCount++;
+	std::erase_if(mRetiredZBinBuffers, [this](const RetiredZBinBuffers& InRetired) { return InRetired.mReleaseAfter <= mZBinFrameCount; });
+
+	const uint32_t lTileCountX = ZBinLightCuller::GetTileCount(mWidth);
+	const uint32_t lTileCountY = ZBinLightCuller::GetTileCount(mHeight);
+	mZBinCuller->Cull(mFrameData[InFrameIndex], mLightBuffer->GetLights(), mWidth, mHeight, InCpuMasks || InValidate);
+	auto lBins = mZBinCuller->GetBins();
+	auto lOrder = mZBinCuller->GetLightOrder();
+	auto lRects = mZBinCuller->GetTileRects();
+	auto lMasks = mZBinCuller->GetTileMasks();
+	EnsureZBinCapacity((uint32_t)lOrder.size(), lTileCountX * lTileCountY);
+
+	//Slice layout matches EnsureZBinCapacity.
+	const size_t lBinBytes = lBins.size_bytes();
+	const size_t lOrderOffset = lBinBytes;
+	const size_t lRectOffset = lOrderOffset + size_t(mZBinLightCapacity) * sizeof(uint32_t);
+	const size_t lMaskOffset = lRectOffset + size_t(mZBinLightCapacity) * sizeof(ZBinTileRect);
+	const size_t lSliceBytes = lMaskOffset + mZBinTileMasks.size() * sizeof(uint32_t);
+	const size_t lSliceOffset = InFrameIndex * lSliceBytes;
+	uint8_t* lSlice = mZBinUploadData + lSliceOffset;
+	ID3D12Resource* lRing = mZBinUploadRing->GetResource();
+	memcpy(lSlice, lBins.data(), lBinBytes);
+	mComputeCmd->CopyBufferRegion(mZBinBuffer->GetResource(), 0, lRing, lSliceOffset, lBinBytes);
+	if (!lOrder.empty())
+	{
+		memcpy(lSlice + lOrderOffset, lOrder.data(), lOrder.size_bytes());
+		mComputeCmd->CopyBufferRegion(mZBinLightOrderBuffer->GetResource(), 0, lRing, lSliceOffset + lOrderOffset, lOrder.size_bytes());
+		memcpy(lSlice + lRectOffset, lRects.data(), lRects.size_bytes());
+		mComputeCmd->CopyBufferRegion(mZBinTileRectBuffer->GetResource(), 0, lRing, lSliceOffset + lRectOffset, lRects.size_bytes());
+	}
+	if (InCpuMasks)
+	{
+		//Fallback:upload the CPU masks in place of the dispatch.
+		memcpy(lSlice + lMaskOffset, lMasks.data(), lMasks.size_bytes());
+		mComputeCmd->CopyBufferRegion(mZBinTileMaskBuffer->GetResource(), 0, lRing, lSliceOffset + lMaskOffset, lMasks.size_bytes());
+		return;
+	}
+
+	const ZBinCullStats& lStats = mZBinCuller->GetStats();
+	if (!lOrder.empty())
+	{
+		auto lBarrier = CD3DX12_RESOURCE_BARRIER::Transition(mZBinTileRectBuffer->GetResource(), D3D12_RESOURCE_STATE_COPY_DEST, D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE);
+		mComputeCmd->ResourceBarrier(1, &lBarrier);
+	}
+	const uint32_t lConstants[4] = { lTileCountX, lTileCountY, lStats.mWordsPerTile, lStats.mLights };
+	mZBinTileMaskPass->SetRenderPassStates(mComputeCmd);
+	mComputeCmd->SetComputeRoot32BitConstants(0, 4, lConstants, 0);
+	mComputeCmd->SetComputeRootShaderResourceView(1, mZBinTileRectBuffer->GetGpuVirtualAddress());
+	mComputeCmd->SetComputeRootUnorderedAccessView(2, mZBinTileMaskBuffer->GetGpuVirtualAddress());
+	mZBinTileMaskPass->Dispatch(lTileCountX, lTileCountY, lStats.mWordsPerTile);
+	if (InValidate)
+	{
+		if (!mZBinReadback)
+		{
+			mZBinReadback = std::make_unique<Resource::ReadbackBuffer>();
+			mZBinReadback->Create(L"ZBinReadback", mZBinTileMasks.size() * sizeof(uint32_t));
+		}
+		TransitState(mComputeCmd, mZBinTileMaskBuffer->GetResource(), D3D12_RESOURCE_STATE_UNORDERED_ACCESS, D3D12_RESOURCE_STATE_COPY_SOURCE);
+		mComputeCmd->CopyBufferRegion(mZBinReadback->GetResource(), 0, mZBinTileMaskBuffer->GetResource(), 0, lMasks.size_bytes());
+	}
+}
+
+void Renderer::ClusterForwardRenderer::BenchmarkLightCulling()
+{
+	//Same distribution as GameScene::CreateRandomPointLights.
+	constexpr float EXTENT = 65.0f;
+	constexpr uint32_t LIGHT_COUNTS[] = { 256, 1024, 4096, 16384 };
+	auto random = [] { return float(rand()) / RAND_MAX; };
+	//Camera of the last updated frame.
+	FrameData lFrame = mFrameData[(mFrameIndexCpu + SWAP_CHAIN_BUFFER_COUNT - 1) % SWAP_CHAIN_BUFFER_COUNT];
+	lFrame.ZBinScale = ZBIN_COUNT / mDefaultCamera->GetFar();
+	auto randomLight = [&random](ECS::LightType InType)
+		{
+			ECS::LightComponent light = {};
+			light.pos = { (random() - 0.5f) * 2.0f * EXTENT, random() * 15.0f, (random() - 0.5f) * 2.0f * EXTENT, 1.0f };
+			light.color = { random(), random(), random(), 0.0f };
+			light.radius_attenu = { 55.0f, 0.0f, random() * 1.2f, random() * 1.2f };
+			light.type = InType;
+			light.direction = { random() - 0.5f, -random(), random() - 0.5f };
+			light.spotOuterAngle = 0.2f + random() * 0.6f;
+			light.spotInnerAngle = light.spotOuterAngle * 0.7f;
+			light.length = 5.0f + random() * 20.0f;
+			return LightBuffer::ToLightData(light);
+		};
+	std::vector<ECS::LigthData> lLights;
+	for (auto count : LIGHT_COUNTS)
+	{
+		while (lLights.size() < count)
+		{
+			lLights.push_back(randomLight(ECS::LightType::POINT));
+		}
+		lFrame.LightCount = count;
+		mCpuLightCuller->Cull(lFrame, lLights);
+		mZBinCuller->Cull(lFrame, lLights, mWidth, mHeight, true);
+		const auto& lClusterStats = mCpuLightCuller->GetStats();
+		const auto& lZBinStats = mZBinCuller->GetStats();
+		gLogger->info("Light culling benchmark {} lights:clusters {:.3f} ms {} KB ({} assignments,{} dropped),z-bins {:.3f} ms {} KB ({} tile assignments)",
+			count, lClusterStats.mCullMs, lClusterStats.mListBytes / 1024, lClusterStats.mAssignments, lClusterStats.mDroppedAssignments,
+			lZBinStats.mCullMs, lZBinStats.mMemoryBytes / 1024, lZBinStats.mTileAssignments);
+	}
+
+	//Shape tests against bounding spheres only,on a mix of point,spot and capsule lights.
+	constexpr uint32_t SHAPE_LIGHT_COUNT = 1024;
+	constexpr uint32_t FALSE_POSITIVE_SAMPLES = 4;
+	constexpr const char* TYPE_NAMES[] = { "point", "spot", "capsule" };
+	lLights.clear();
+	for (uint32_t i = 0; i < SHAPE_LIGHT_COUNT; ++i)
+	{
+		lLights.push_back(randomLight(ECS::LightType(i % 3)));
+	}
+	lFrame.LightCount = SHAPE_LIGHT_COUNT;
+	for (bool sphereOnly : { true, false })
+	{
+		mCpuLightCuller->SetSphereBoundsOnly(sphereOnly);
+		mCpuLightCuller->Cull(lFrame, lLights);
+		const auto& lClusterStats = mCpuLightCuller->GetStats();
+		auto lAccuracy = mCpuLightCuller->MeasureFalsePositives(lLights, FALSE_POSITIVE_SAMPLES);
+		gLogger->info("Light shape benchmark {} lights,{}:{:.3f} ms {} assignments,{:.1f}% false positives",
+			SHAPE_LIGHT_COUNT, sphereOnly ? "bounding spheres" : "shape tests", lClusterStats.mCullMs, lAccuracy.mAssignments,
+			100.0f * lAccuracy.mFalsePositives / std::max(lAccuracy.mAssignments, 1u));
+		for (uint32_t t = 0; t < 3; ++t)
+		{
+			gLogger->info("  {}:{} assignments,{:.1f}% false positives", TYPE_NAMES[t], lAccuracy.mTypeAssignments[t],
+				100.0f * lAccuracy.mTypeFalsePositives[t] / std::max(lAccuracy.mTypeAssignments[t], 1u));
+		}
+	}
+	mCpuLightCuller->SetSphereBoundsOnly(false);
+}
+
+void Renderer::ClusterForwardRenderer::TuneClusterGrid()
+{
+	//Camera of the last updated frame,depth from the software occlusion buffer of the last culled frame.
+	const auto& lFrame = mFrameData[(mFrameIndexCpu + SWAP_CHAIN_BUFFER_COUNT - 1) % SWAP_CHAIN_BUFFER_COUNT];
+	auto lInput = ClusterGridTuneInput::Capture(lFrame, mLightBuffer->GetLights(), mOcclusionCuller->GetDepth(),
+		mWidth, mHeight, mDefaultCamera->GetNear(), mDefaultCamera->GetFar());
+	mClusterGrid = mClusterGridTuner.Tune(lInput, mClusterGrid);
+	mClusterGridEstimate = mClusterGrid == mClusterGridTuner.GetBestGrid() ? mClusterGridTuner.GetBestEstimate() : mClusterGridTuner.GetCurrentEstimate();
 }
 
 void Renderer::ClusterForwardRenderer::CreateTextures()
@@ -412,6 +692,608 @@ void Renderer::ClusterForwardRenderer::CreateTextures()
 }
 
 
+void Renderer::ClusterForwardRenderer::OcclusionCull()
+{
+	using namespace ECS;
+	//Occluders covering fewer depth buffer pixels than this are not worth rasterizing.
+	constexpr int MIN_OCCLUDER_AREA = 64;
+	struct CullCandidate
+	{
+		entt::entity mEntity;
+		ScreenRect mRect;
+		DirectX::BoundingBox mWorldBounds;
+	};
+
+	mVisibleEntities.clear();
+	mVisibleBounds.clear();
+	mOcclusionCullStats = {};
+	//The GPU driven path culls every pass on the GPU.
+	if (!mCurrentScene || !mCurrentScene->IsSceneReady() || mGpuDrivenFrame)
+	{
+		return;
+	}
+	auto& sceneRegistry = mCurrentScene->GetRegistery();
+	auto renderEntities = sceneRegistry.view<StaticMeshComponent, TransformComponent>();
+	mOcclusionCuller->BeginFrame(mDefaultCamera->GetPrjView(false));
+
+	//Frustum cull and project every entity once,the rects are reused for both occluder selection and the HiZ test.
+	std::vector<CullCandidate> lCandidates;
+	lCandidates.reserve(renderEntities.size_hint());
+	renderEntities.each([&](auto entity, auto& renderComponent, auto& transformComponent) {
+		DirectX::BoundingBox lWorldBounds;
+		renderComponent.mBoundingBox.Transform(lWorldBounds, transformComponent.GetModelMatrix(false));
+		auto lRect = mOcclusionCuller->ProjectBounds(lWorldBounds);
+		mOcclusionCullStats.mTested++;
+		if (lRect.mOutsideFrustum)
+		{
+			mOcclusionCullStats.mFrustumCulled++;
+			return;
+		}
+		lCandidates.push_back({ entity, lRect, lWorldBounds });
+	});
+
+	if (mUseOcclusionCulling)
+	{
+		//Largest on screen occluders first.
+		std::vector<const CullCandidate*> lOccluders;
+		for (const auto& candidate : lCandidates)
+		{
+			if (sceneRegistry.all_of<OccluderComponent>(candidate.mEntity) && candidate.mRect.Area() >= MIN_OCCLUDER_AREA)
+			{
+				lOccluders.push_back(&candidate);
+			}
+		}
+		auto lOccluderCount = std::min<size_t>(lOccluders.size(), std::max(mMaxOccluders, 0));
+		std::partial_sort(lOccluders.begin(), lOccluders.begin() + lOccluderCount, lOccluders.end(),
+			[](const CullCandidate* a, const CullCandidate* b) { return a->mRect.Area() > b->mRect.Area(); });
+		for (size_t i = 0; i < lOccluderCount; ++i)
+		{
+			auto entity = lOccluders[i]->mEntity;
+			auto [renderComponent, transformComponent] = renderEntities.get<StaticMeshComponent, TransformComponent>(entity);
+			const auto& occluder = sceneRegistry.get<OccluderComponent>(entity);
+			auto modelMatrix = transformComponent.GetModelMatrix(false);
+			if (occluder.mPositions.empty())
+			{
+				const auto& mesh = mCurrentScene->GetMeshStore().GetMesh(renderComponent.mMesh);
+				mOcclusionCuller->RasterizeOccluder(mesh.mVertices.data(), sizeof(Vertex), mesh.mVertices.size(),
+					mesh.mIndices, modelMatrix);
+			}
+			else
+			{
+				mOcclusionCuller->RasterizeOccluder(occluder.mPositions.data(), sizeof(DirectX::XMFLOAT3), occluder.mPositions.size(),
+					occluder.mIndices, modelMatrix);
+			}
+		}
+		mOcclusionCuller->BuildHierarchy();
+		mOcclusionCullStats.mOccluders = (uint32_t)lOccluderCount;
+		mOcclusionCullStats.mOccluderTriangles = mOcclusionCuller->GetRasterizedTriangles();
+	}
+
+	for (const auto& candidate : lCandidates)
+	{
+		if (!mUseOcclusionCulling || mOcclusionCuller->IsVisible(candidate.mRect))
+		{
+			mVisibleEntities.push_back(candidate.mEntity);
+			mVisibleBounds.push_back(candidate.mWorldBounds);
+		}
+		else
+		{
+			mOcclusionCullStats.mOcclusionCulled++;
+		}
+	}
+}
+
+void Renderer::ClusterForwardRenderer::ShadowCasterCull()
+{
+	using namespace ECS;
+	mShadowCasters.clear();
+	mShadowCullStats = {};
+	if (!mCurrentScene || !mCurrentScene->IsSceneReady() || mGpuDrivenFrame)
+	{
+		return;
+	}
+	mShadowCasterCuller->BeginFrame(mShadowCamera->GetPrjView(false));
+	for (const auto& receiverBounds : mVisibleBounds)
+	{
+		mShadowCasterCuller->AddReceiver(receiverBounds);
+	}
+	auto& sceneRegistry = mCurrentScene->GetRegistery();
+	auto renderEntities = sceneRegistry.view<StaticMeshComponent, TransformComponent>();
+	renderEntities.each([&](auto entity, auto& renderComponent, auto& transformComponent) {
+		if (mShadowCasterCuller->AddCandidate(renderComponent.mBoundingBox, transformComponent.GetModelMatrix(false),
+			renderComponent.mCastShadow, mUseShadowCasterCulling))
+		{
+			mShadowCasters.push_back(entity);
+		}
+	});
+	mShadowCullStats = mShadowCasterCuller->GetStats();
+}
+
+void Renderer::ClusterForwardRenderer::BuildDrawPackets()
+{
+	using namespace ECS;
+	//The Hi-Z is only current if the previous frame built it.
+	const bool lHiZValid = std::exchange(mGpuCullPrepared, false);
+	mDrawPackets->Clear();
+	mVertexBufferView = mContext->GetVertexBufferView();
+	mIndexBufferViews = { mContext->GetIndexBufferView(false), mContext->GetIndexBufferView(true) };
+	//The list count is only known once the frame is submitted,keep the last frame's.
+	mDrawPacketStats = { .mCommandLists = mDrawPacketStats.mCommandLists };
+	if (!mCurrentScene || !mCurrentScene->IsSceneReady())
+	{
+		return;
+	}
+	auto& sceneRegistry = mCurrentScene->GetRegistery();
+	auto renderEntities = sceneRegistry.view<StaticMeshComponent, TransformComponent>();
+	auto lView = mDefaultCamera->GetView(false);
+	auto lShadowView = mShadowCamera->GetView(false);
+	auto* lHeap = g_DescHeap[D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV];
+	mMaterialTable.SetDefaultTextures(lHeap->CalcHandleOffset(mTextureMap["defaultTexture"]->GetSRV()),
+		lHeap->CalcHandleOffset(mTextureMap["defaultNormal"]->GetSRV()));
+
+	const auto& lMeshStore = mCurrentScene->GetMeshStore();
+	auto lLock = lMeshStore.ReadLock();
+	//Resolve textures once per material,the packets only carry the material id.
+	mMaterialTable.Pack(lMeshStore.GetMaterials(), [this, lHeap](AssetLoader::TextureHandle InTexture)
+		{
+			auto lTexture = GetTexture(InTexture);
+			return lTexture ? (uint32_t)lHeap->CalcHandleOffset(lTexture->GetSRV()) : MaterialTable::INVALID_TEXTURE;
+		});
+	UploadMaterials(mDeviceManager->GetFrameSlot());
+	if (mGpuDrivenFrame)
+	{
+		PrepareGpuCull(mDeviceManager->GetFrameSlot(), lHiZValid);
+		return;
+	}
+
+	for (size_t i = 0; i < mVisibleEntities.size(); ++i)
+	{
+		auto [renderComponent, transformComponent] = renderEntities.get<StaticMeshComponent, TransformComponent>(mVisibleEntities[i]);
+		uint32_t lObjectIndex = mDrawPackets->AddObject({ transformComponent.GetModelMatrix(), renderComponent.mBaseColor });
+		float lViewDepth = DirectX::SimpleMath::Vector3::Transform(mVisibleBounds[i].Center, lView).z;
+		for (const auto& subMesh : lMeshStore.GetSubMeshes(renderComponent))
+		{
+			DrawPacket lPacket = {};
+			lPacket.mIndexCount = subMesh.IndexCount;
+			lPacket.mStartIndexLocation = renderComponent.StartIndexLocation + subMesh.IndexOffset;
+			lPacket.mBaseVertexLocation = renderComponent.BaseVertexLocation;
+			lPacket.mObjectIndex = lObjectIndex;
+			lPacket.m16BitIndices = renderComponent.m16BitIndices;
+			lPacket.mMaterial = NO_MATERIAL;
+			mDrawPackets->Add(DrawKey::Make(DrawPass::DEPTH_ONLY, DrawPipeline::DEPTH_ONLY, 0, lViewDepth), lPacket);
+
+			lPacket.mMaterial = subMesh.Material;
+			mDrawPackets->Add(DrawKey::Make(DrawPass::COLOR, DrawPipeline::COLOR_MSAA, subMesh.Material, lViewDepth), lPacket);
+		}
+	}
+
+	for (auto entity : mShadowCasters)
+	{
+		auto [renderComponent, transformComponent] = renderEntities.get<StaticMeshComponent, TransformComponent>(entity);
+		uint32_t lObjectIndex = mDrawPackets->AddObject({ transformComponent.GetModelMatrix(), renderComponent.mBaseColor });
+		auto lCenter = DirectX::SimpleMath::Vector3::Transform(renderComponent.mBoundingBox.Center, transformComponent.GetModelMatrix(false));
+		float lLightDepth = DirectX::SimpleMath::Vector3::Transform(lCenter, lShadowView).z;
+		for (const auto& subMesh : lMeshStore.GetSubMeshes(renderComponent))
+		{
+			DrawPacket lPacket = {};
+			lPacket.mIndexCount = subMesh.IndexCount;
+			lPacket.mStartIndexLocation = renderComponent.StartIndexLocation + subMesh.IndexOffset;
+			lPacket.mBaseVertexLocation = renderComponent.BaseVertexLocation;
+			lPacket.mObjectIndex = lObjectIndex;
+			lPacket.m16BitIndices = renderComponent.m16BitIndices;
+			lPacket.mMaterial = NO_MATERIAL;
+			mDrawPackets->Add(DrawKey::Make(DrawPass::SHADOW_MAP, DrawPipeline::SHADOW_MAP, 0, lLightDepth), lPacket);
+		}
+	}
+}
+
+void Renderer::ClusterForwardRenderer::EnsureGpuCullCapacity(uint32_t InInstances, bool InValidate)
+{
+	if (!mGpuCullReadback)
+	{
+		mGpuCullReadback = std::make_unique<Resource::ReadbackBuffer>();
+		mGpuCullReadback->Create(L"GpuCullReadback", sizeof(GpuCullCounts) * (size_t)DrawPass::COUNT * SWAP_CHAIN_BUFFER_COUNT);
+		mHiZTexels = GpuCullReference::InitHiZLayout(mHiZLayout, (uint32_t)mWidth, (uint32_t)mHeight);
+		mHiZBuffer = std::make_unique<Resource::StructuredBuffer>();
+		mHiZBuffer->Create(L"HiZBuffer", mHiZTexels, sizeof(float));
+		mGpuCullHiZ.resize(mHiZTexels);
+	}
+	if (InInstances > mGpuInstanceCapacity || !mGpuInstanceBuffer)
+	{
+		if (mGpuInstanceBuffer)
+		{
+			mRetiredGpuCullBuffers.push_back({ mRetireFrame + SWAP_CHAIN_BUFFER_COUNT,
+				std::move(mGpuInstanceBuffer), std::move(mGpuDrawArgs), std::move(mGpuCullUploadRing), std::move(mGpuCullValidationReadback) });
+		}
+		mGpuInstanceCapacity = std::max(std::bit_ceil(InInstances), MIN_GPU_INSTANCES);
+		mGpuInstanceBuffer = std::make_unique<Resource::StructuredBuffer>();
+		mGpuInstanceBuffer->Create(L"GpuInstanceBuffer", mGpuInstanceCapacity, sizeof(GpuInstance));
+		const wchar_t* lArgsNames[] = { L"GpuDepthDrawArgs", L"GpuShadowDrawArgs", L"GpuColorDrawArgs" };
+		static_assert(std::size(lArgsNames) == (size_t)DrawPass::COUNT);
+		for (size_t i = 0; i < mGpuDrawArgs.size(); ++i)
+		{
+			mGpuDrawArgs[i] = std::make_unique<Resource::IndirectArgsBuffer>();
+			mGpuDrawArgs[i]->Create(lArgsNames[i], GpuCullPass::GetArgsBytes(mGpuInstanceCapacity) / sizeof(uint32_t), sizeof(uint32_t));
+		}
+		mGpuCullUploadRing = std::make_unique<Resource::UploadBuffer>();
+		mGpuCullUploadRing->Create(L"GpuCullUploadRing", (GPU_CULL_CONSTANTS_BYTES + size_t(mGpuInstanceCapacity) * sizeof(GpuInstance)) * SWAP_CHAIN_BUFFER_COUNT);
+		mGpuCullUploadData = mGpuCullUploadRing->MapPersistent();
+		mGpuInstances.MarkAllDirty();
+		//The frames in flight copied their results into the retired buffers.
+		mPendingGpuCull.fill({});
+	}
+	if (InValidate && !mGpuCullValidationReadback)
+	{
+		mGpuCullValidationReadback = std::make_unique<Resource::ReadbackBuffer>();
+		mGpuCullValidationReadback->Create(L"GpuCullValidationReadback", GetGpuCullValidationOffset(SWAP_CHAIN_BUFFER_COUNT));
+		mGpuCullDraws.resize(mGpuInstanceCapacity);
+	}
+}
+
+size_t Renderer::ClusterForwardRenderer::GetGpuCullValidationOffset(uint32_t InFrameIndex) const
+{
+	const size_t lSlotBytes = size_t(mGpuInstanceCapacity) * sizeof(IndirectDraw) * (size_t)DrawPass::COUNT + size_t(mHiZTexels) * sizeof(float) * 2;
+	return lSlotBytes * InFrameIndex;
+}
+
+void Renderer::ClusterForwardRenderer::PrepareGpuCull(uint32_t InFrameIndex, bool InHiZValid)
+{
+	using namespace ECS;
+	std::erase_if(mRetiredGpuCullBuffers, [this](const RetiredGpuCullBuffers& InRetired) { return InRetired.mReleaseAfter <= mRetireFrame; });
+	//BeginFrame waited for the last frame of this slot.
+	ReadGpuCullResults(InFrameIndex);
+
+	//Called with the mesh store read lock held.
+	const auto& lMeshStore = mCurrentScene->GetMeshStore();
+	auto renderEntities = mCurrentScene->GetRegistery().view<StaticMeshComponent, TransformComponent>();
+	mGpuInstances.Begin();
+	renderEntities.each([&](auto& renderComponent, auto& transformComponent) {
+		if (!renderComponent.mGeometryResident)
+		{
+			return;
+		}
+		DirectX::BoundingBox lWorldBounds;
+		renderComponent.mBoundingBox.Transform(lWorldBounds, transformComponent.GetModelMatrix(false));
+		GpuInstance lInstance = {};
+		lInstance.mObject = { transformComponent.GetModelMatrix(), renderComponent.mBaseColor };
+		lInstance.mBoundsCenter = lWorldBounds.Center;
+		lInstance.mBoundsExtents = lWorldBounds.Extents;
+		lInstance.mFlags = GPU_INSTANCE_CAMERA;
+		lInstance.mFlags |= renderComponent.mCastShadow ? GPU_INSTANCE_SHADOW_CASTER : 0;
+		lInstance.mFlags |= renderComponent.m16BitIndices ? GPU_INSTANCE_16BIT_INDICES : 0;
+		lInstance.mBaseVertexLocation = renderComponent.BaseVertexLocation;
+		for (const auto& subMesh : lMeshStore.GetSubMeshes(renderComponent))
+		{
+			lInstance.mMaterial = subMesh.Material;
+			lInstance.mIndexCount = subMesh.IndexCount;
+			lInstance.mStartIndexLocation = renderComponent.StartIndexLocation + subMesh.IndexOffset;
+			mGpuInstances.Add(lInstance);
+		}
+	});
+	mGpuInstances.End();
+	auto lInstances = mGpuInstances.GetInstances();
+	EnsureGpuCullCapacity((uint32_t)lInstances.size(), mValidateGpuCulling);
+
+	auto lSetRows = [](DirectX::XMFLOAT4* OutRows, const DirectX::SimpleMath::Matrix& InMatrix)
+		{
+			for (int i = 0; i < 4; ++i)
+			{
+				OutRows[i] = DirectX::XMFLOAT4(InMatrix.m[i]);
+			}
+		};
+	const auto lViewPrj = mDefaultCamera->GetPrjView(false);
+	GpuCullConstants lConstants = mHiZLayout;
+	lConstants.mIndexBuffers[0] = mIndexBufferViews[0];
+	lConstants.mIndexBuffers[1] = mIndexBufferViews[1];
+	lConstants.mInstanceCount = (uint32_t)lInstances.size();
+
+	//The prepass tests against the previous frame's Hi-Z,the color pass against the one the prepass just built.
+	auto& lDepthConstants = mGpuCullConstants[(size_t)DrawPass::DEPTH_ONLY];
+	lDepthConstants = lConstants;
+	lSetRows(lDepthConstants.mViewPrj, lViewPrj);
+	lSetRows(lDepthConstants.mOcclusionViewPrj, mHiZViewPrj);
+	lDepthConstants.mPassFlag = GPU_INSTANCE_CAMERA;
+	lDepthConstants.mClipPlanes = GPU_CULL_SIDE_PLANES | GPU_CULL_NEAR_PLANE;
+	lDepthConstants.mUseOcclusion = mUseOcclusionCulling && InHiZValid;
+
+	auto& lColorConstants = mGpuCullConstants[(size_t)DrawPass::COLOR];
+	lColorConstants = lDepthConstants;
+	lSetRows(lColorConstants.mOcclusionViewPrj, lViewPrj);
+	lColorConstants.mUseOcclusion = mUseOcclusionCulling;
+	mHiZViewPrj = lViewPrj;
+
+	//Casters behind the light's near plane still throw shadows into the frustum.
+	auto& lShadowConstants = mGpuCullConstants[(size_t)DrawPass::SHADOW_MAP];
+	lShadowConstants = lConstants;
+	lSetRows(lShadowConstants.mViewPrj, mShadowCamera->GetPrjView(false));
+	lShadowConstants.mPassFlag = GPU_INSTANCE_SHADOW_CASTER;
+	lShadowConstants.mClipPlanes = GPU_CULL_SIDE_PLANES;
+	lShadowConstants.mUseOcclusion = 0;
+
+	uint8_t* lSlice = mGpuCullUploadData + size_t(InFrameIndex) * (GPU_CULL_CONSTANTS_BYTES + size_t(mGpuInstanceCapacity) * sizeof(GpuInstance));
+	memcpy(lSlice, mGpuCullConstants.data(), GPU_CULL_CONSTANTS_BYTES);
+	mGpuUploadBegin = mGpuInstances.GetDirtyBegin();
+	mGpuUploadEnd = mGpuInstances.GetDirtyEnd();
+	if (mGpuInstances.IsDirty())
+	{
+		memcpy(lSlice + GPU_CULL_CONSTANTS_BYTES + size_t(mGpuUploadBegin) * sizeof(GpuInstance), lInstances.data() + mGpuUploadBegin,
+			size_t(mGpuUploadEnd - mGpuUploadBegin) * sizeof(GpuInstance));
+	}
+	mGpuInstances.ClearDirty();
+	mGpuCullStats.mInstances = (uint32_t)lInstances.size();
+	mGpuCullStats.mUploadedInstances = mGpuUploadEnd - mGpuUploadBegin;
+
+	auto& lPending = mPendingGpuCull[InFrameIndex];
+	lPending.mRecorded = true;
+	lPending.mValidate = mValidateGpuCulling;
+	lPending.mConstants = mGpuCullConstants;
+	if (lPending.mValidate)
+	{
+		lPending.mInstances.assign(lInstances.begin(), lInstances.end());
+	}
+	mGpuCullPrepared = true;
+}
+
+void Renderer::ClusterForwardRenderer::RecordGpuInstanceUpload(uint32_t InFrameIndex)
+{
+	if (mGpuUploadBegin >= mGpuUploadEnd)
+	{
+		return;
+	}
+	const size_t lSliceOffset = size_t(InFrameIndex) * (GPU_CULL_CONSTANTS_BYTES + size_t(mGpuInstanceCapacity) * sizeof(GpuInstance));
+	//Decayed to COMMON after the last frame,the copy promotes it.
+	mGraphicsCmd->CopyBufferRegion(mGpuInstanceBuffer->GetResource(), size_t(mGpuUploadBegin) * sizeof(GpuInstance), mGpuCullUploadRing->GetResource(),
+		lSliceOffset + GPU_CULL_CONSTANTS_BYTES + size_t(mGpuUploadBegin) * sizeof(GpuInstance), size_t(mGpuUploadEnd - mGpuUploadBegin) * sizeof(GpuInstance));
+	TransitState(mGraphicsCmd, mGpuInstanceBuffer->GetResource(), D3D12_RESOURCE_STATE_COPY_DEST, D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE);
+}
+
+void Renderer::ClusterForwardRenderer::SetGpuCullStates(DrawPass InPass, uint32_t InFrameIndex)
+{
+	const size_t lSliceOffset = size_t(InFrameIndex) * (GPU_CULL_CONSTANTS_BYTES + size_t(mGpuInstanceCapacity) * sizeof(GpuInstance));
+	mGpuCullPass->SetRenderPassStates(mGraphicsCmd);
+	ID3D12DescriptorHeap* lHeaps[] = { g_DescHeap[D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV]->GetDescHeap() };
+	mGraphicsCmd->SetDescriptorHeaps(1, lHeaps);
+	mGraphicsCmd->SetComputeRootConstantBufferView(0, mGpuCullUploadRing->GetGpuVirtualAddress() + lSliceOffset + (size_t)InPass * sizeof(GpuCullConstants));
+	mGraphicsCmd->SetComputeRootShaderResourceView(1, mGpuInstanceBuffer->GetGpuVirtualAddress());
+	mGraphicsCmd->SetComputeRootUnorderedAccessView(2, mGpuDrawArgs[(size_t)InPass]->GetGpuVirtualAddress());
+	mGraphicsCmd->SetComputeRootUnorderedAccessView(3, mHiZBuffer->GetGpuVirtualAddress());
+	mGraphicsCmd->SetComputeRootDescriptorTable(5, mContext->GetDepthBuffer()->GetDepthSRVGPU());
+}
+
+void Renderer::ClusterForwardRenderer::RecordGpuDrivenPass(DrawPass InPass, uint32_t InFrameIndex)
+{
+	const auto& lConstants = mGpuCullConstants[(size_t)InPass];
+	auto* lArgs = mGpuDrawArgs[(size_t)InPass]->GetResource();
+	const bool lValidate = mPendingGpuCull[InFrameIndex].mValidate;
+	if (lValidate && InPass == DrawPass::DEPTH_ONLY)
+	{
+		//The Hi-Z the prepass tests against,before it is rebuilt.The first use in the frame,so still in COMMON.
+		TransitState(mGraphicsCmd, mHiZBuffer->GetResource(), D3D12_RESOURCE_STATE_COMMON, D3D12_RESOURCE_STATE_COPY_SOURCE);
+		mGraphicsCmd->CopyBufferRegion(mGpuCullValidationReadback->GetResource(), GetGpuCullValidationOffset(InFrameIndex) + size_t(mGpuInstanceCapacity) * sizeof(IndirectDraw) * (size_t)DrawPass::COUNT,
+			mHiZBuffer->GetResource(), 0, size_t(mHiZTexels) * sizeof(float));
+		TransitState(mGraphicsCmd, mHiZBuffer->GetResource(), D3D12_RESOURCE_STATE_COPY_SOURCE, D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
+	}
+	SetGpuCullStates(InPass, InFrameIndex);
+	mGpuCullPass->Cull(lArgs, lConstants.mInstanceCount);
+	mGraphicsCmd->CopyBufferRegion(mGpuCullReadback->GetResource(), (size_t(InFrameIndex) * (size_t)DrawPass::COUNT + (size_t)InPass) * sizeof(GpuCullCounts),
+		lArgs, 0, sizeof(GpuCullCounts));
+	if (lValidate && lConstants.mInstanceCount > 0)
+	{
+		mGraphicsCmd->CopyBufferRegion(mGpuCullValidationReadback->GetResource(), GetGpuCullValidationOffset(InFrameIndex) + size_t(mGpuInstanceCapacity) * sizeof(IndirectDraw) * (size_t)InPass,
+			lArgs, GpuCullPass::DRAW_ARGS_OFFSET, size_t(lConstants.mInstanceCount) * sizeof(IndirectDraw));
+	}
+	//The dispatches replaced the pipeline,restore what the draws of the pass expect.
+	SetDrawPassStates(mGraphicsCmd, InPass, InFrameIndex);
+	mGpuCullPass->Draw(mGraphicsCmd, lArgs, lConstants.mInstanceCount);
+}
+
+void Renderer::ClusterForwardRenderer::RecordHiZBuild(uint32_t InFrameIndex)
+{
+	auto lDepthBuffer = mContext->GetDepthBuffer();
+	TransitState(mGraphicsCmd, lDepthBuffer->GetResource(), D3D12_RESOURCE_STATE_DEPTH_WRITE, D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE);
+	SetGpuCullStates(DrawPass::COLOR, InFrameIndex);
+	mGpuCullPass->BuildHiZ(mGpuCullConstants[(size_t)DrawPass::COLOR]);
+	TransitState(mGraphicsCmd, lDepthBuffer->GetResource(), D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE, D3D12_RESOURCE_STATE_DEPTH_WRITE);
+	if (mPendingGpuCull[InFrameIndex].mValidate)
+	{
+		TransitState(mGraphicsCmd, mHiZBuffer->GetResource(), D3D12_RESOURCE_STATE_UNORDERED_ACCESS, D3D12_RESOURCE_STATE_COPY_SOURCE);
+		mGraphicsCmd->CopyBufferRegion(mGpuCullValidationReadback->GetResource(),
+			GetGpuCullValidationOffset(InFrameIndex) + size_t(mGpuInstanceCapacity) * sizeof(IndirectDraw) * (size_t)DrawPass::COUNT + size_t(mHiZTexels) * sizeof(float),
+			mHiZBuffer->GetResource(), 0, size_t(mHiZTexels) * sizeof(float));
+		TransitState(mGraphicsCmd, mHiZBuffer->GetResource(), D3D12_RESOURCE_STATE_COPY_SOURCE, D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
+	}
+}
+
+void Renderer::ClusterForwardRenderer::ReadGpuCullResults(uint32_t InFrameIndex)
+{
+	auto& lPending = mPendingGpuCull[InFrameIndex];
+	if (!lPending.mRecorded)
+	{
+		return;
+	}
+	std::array<GpuCullCounts, (size_t)DrawPass::COUNT> lCounts;
+	mGpuCullReadback->ReadData(std::span<GpuCullCounts>(lCounts), size_t(InFrameIndex) * sizeof(lCounts));
+	mGpuCullStats.mPasses = lCounts;
+	if (lPending.mValidate)
+	{
+		mGpuCullStats.mMismatchedDraws = 0;
+		mGpuCullStats.mMismatchedCounts = 0;
+		const size_t lSlotOffset = GetGpuCullValidationOffset(InFrameIndex);
+		const size_t lHiZOffset = lSlotOffset + size_t(mGpuInstanceCapacity) * sizeof(IndirectDraw) * (size_t)DrawPass::COUNT;
+		for (size_t pass = 0; pass < (size_t)DrawPass::COUNT; ++pass)
+		{
+			const auto& lConstants = lPending.mConstants[pass];
+			if (lConstants.mUseOcclusion)
+			{
+				//The prepass read the Hi-Z before the rebuild,the color pass after it.
+				const size_t lOffset = lHiZOffset + (pass == (size_t)DrawPass::DEPTH_ONLY ? 0 : size_t(mHiZTexels) * sizeof(float));
+				mGpuCullValidationReadback->ReadData(std::span(mGpuCullHiZ), lOffset);
+			}
+			mGpuCullReference.Cull(lConstants, lPending.mInstances, mGpuCullHiZ);
+			auto lGpuDraws = std::span(mGpuCullDraws).first(std::min(lCounts[pass].mDraws, lConstants.mInstanceCount));
+			mGpuCullValidationReadback->ReadData(lGpuDraws, lSlotOffset + size_t(mGpuInstanceCapacity) * sizeof(IndirectDraw) * pass);
+			mGpuCullStats.mMismatchedDraws += mGpuCullReference.Compare(lCounts[pass], lGpuDraws);
+			mGpuCullStats.mMismatchedCounts += mGpuCullReference.CountsMatch() ? 0 : 1;
+		}
+	}
+	lPending = {};
+}
+
+void Renderer::ClusterForwardRenderer::SetDrawPassStates(ID3D12GraphicsCommandList* InCmd, DrawPass InPass, uint32_t InFrameDataIndex)
+{
+	InCmd->SetGraphicsRootSignature(mColorPassRootSignature);
+	ID3D12DescriptorHeap* lHeaps[] = { g_DescHeap[D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV]->GetDescHeap() };
+	InCmd->SetDescriptorHeaps(1, lHeaps);
+	InCmd->SetGraphicsRootConstantBufferView(ROOT_PARA_FRAME_DATA_CBV, mFrameDataGPU[InFrameDataIndex]->RootConstantBufferView());
+	InCmd->RSSetViewports(1, &mViewPort);
+	InCmd->RSSetScissorRects(1, &mRect);
+	InCmd->IASetPrimitiveTopology(D3D12_PRIMITIVE_TOPOLOGY::D3D10_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
+	InCmd->IASetVertexBuffers(0, 1, &mVertexBufferView);
+	InCmd->IASetIndexBuffer(&mIndexBufferViews[0]);
+	InCmd->SetPipelineState(mPipelineTable[(size_t)PASS_PIPELINES[(size_t)InPass]]);
+	switch (InPass)
+	{
+	case DrawPass::DEPTH_ONLY:
+		InCmd->OMSetRenderTargets(0, nullptr, true, &mContext->GetDepthBuffer()->GetDSV());
+		break;
+	case DrawPass::SHADOW_MAP:
+		InCmd->OMSetRenderTargets(0, nullptr, true, &mContext->GetShadowMap()->GetDSV());
+		break;
+	case DrawPass::COLOR:
+		InCmd->SetGraphicsRootDescriptorTable(ROOT_PARA_FRAME_SOURCE_TABLE, mClusterBuffer->GetUAVGpu());
+		InCmd->SetGraphicsRootShaderResourceView(ROOT_PARA_LIGHTS, mLightBuffer->GetGpuVirtualAddress());
+		InCmd->SetGraphicsRootShaderResourceView(ROOT_PARA_ZBINS, mZBinBuffer->GetGpuVirtualAddress());
+		InCmd->SetGraphicsRootShaderResourceView(ROOT_PARA_ZBIN_LIGHT_ORDER, mZBinLightOrderBuffer->GetGpuVirtualAddress());
+		InCmd->SetGraphicsRootShaderResourceView(ROOT_PARA_ZBIN_TILE_MASKS, mZBinTileMaskBuffer->GetGpuVirtualAddress());
+		InCmd->OMSetRenderTargets(1, &mContext->GetRenderTarget(RenderTarget::COLOR_OUTPUT_MSAA)->GetRTV(), true, &mContext->GetDepthBuffer()->GetDSV_ReadOnly());
+		InCmd->SetGraphicsRootDescriptorTable(ROOT_PARA_SHADOW_MAP, mContext->GetShadowMap()->GetDepthSRVGPU());
+		InCmd->SetGraphicsRootDescriptorTable(ROOT_PARA_BINDLESS_TEXTURES, lHeaps[0]->GetGPUDescriptorHandleForHeapStart());
+		InCmd->SetGraphicsRootShaderResourceView(ROOT_PARA_MATERIALS, mMaterialAddress);
+		break;
+	default:
+		break;
+	}
+}
+
+void Renderer::ClusterForwardRenderer::RecordDrawPackets(DrawPass InPass, uint32_t InFrameDataIndex)
+{
+	auto lStart = std::chrono::steady_clock::now();
+	auto lItems = mDrawPackets->GetSortedRange(InPass);
+	auto& lJob = mParallelDraws[(size_t)InPass];
+	const uint32_t lMaxRanges = mUseParallelRecording ? (uint32_t)mRenderExecution->num_workers() : 1u;
+	DrawPacketList::SplitRanges(lItems, lMaxRanges, MIN_PACKETS_PER_LIST, lJob.mRanges);
+	const uint32_t lRanges = (uint32_t)lJob.mRanges.size();
+	if (lRanges <= 1)
+	{
+		mDrawPacketStats += mDrawPackets->Record(mGraphicsCmd, lItems, mPipelineTable, PASS_PIPELINES[(size_t)InPass], mIndexBufferViews);
+	}
+	else
+	{
+		//The ranges go to their own lists between the list recorded so far and the one continuing the pass.
+		lJob.mLists = mFrameCmds->Fork(lRanges);
+		lJob.mFrameDataIndex = InFrameDataIndex;
+		lJob.mStats.assign(lRanges, {});
+		if (!lJob.mFlow || lJob.mFlowRanges != lRanges)
+		{
+			lJob.mFlow = std::make_unique<tf::Taskflow>("RecordDrawPackets");
+			lJob.mFlow->for_each_index(0u, lRanges, 1u, [this, InPass](uint32_t InRange) { RecordDrawRange(InPass, InRange); });
+			lJob.mFlowRanges = lRanges;
+		}
+		//Called from a task of the render flow,a blocking wait there could starve the pool.
+		if (mRenderExecution->this_worker_id() >= 0)
+		{
+			mRenderExecution->corun(*lJob.mFlow);
+		}
+		else
+		{
+			mRenderExecution->run(*lJob.mFlow).wait();
+		}
+		for (const auto& stats : lJob.mStats)
+		{
+			mDrawPacketStats += stats;
+		}
+		//Leave the new current list in the state recording inline would have,the pass may continue on it.
+		mGraphicsCmd = mFrameCmds->Current();
+		SetDrawPassStates(mGraphicsCmd, InPass, InFrameDataIndex);
+	}
+	mDrawPacketStats.mRecordMs += std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - lStart).count();
+}
+
+void Renderer::ClusterForwardRenderer::RecordDrawRange(DrawPass InPass, uint32_t InRange)
+{
+	auto& lJob = mParallelDraws[(size_t)InPass];
+	auto* lCmd = lJob.mLists[InRange];
+	SetDrawPassStates(lCmd, InPass, lJob.mFrameDataIndex);
+	lJob.mStats[InRange] = mDrawPackets->Record(lCmd, lJob.mRanges[InRange], mPipelineTable, PASS_PIPELINES[(size_t)InPass], mIndexBufferViews);
+}
+
+void Renderer::ClusterForwardRenderer::BenchmarkDrawRecording()
+{
+	constexpr uint32_t PACKET_COUNTS[] = { 4096, 16384, 65536 };
+	//Submeshes per object and materials,roughly what the sponza scene sorts into.
+	constexpr uint32_t PACKETS_PER_OBJECT = 4;
+	constexpr uint32_t MATERIALS = 64;
+	constexpr uint32_t REPEATS = 8;
+	auto random = [] { return float(rand()) / RAND_MAX; };
+	const uint32_t lMaxWorkers = (uint32_t)mRenderExecution->num_workers();
+	std::vector<CountingCommandList> lLists(lMaxWorkers);
+	std::vector<std::span<const DrawPacketList::SortItem>> lRanges;
+	//Never bound,the mock only copies the pointers.
+	std::array<ID3D12PipelineState*, (size_t)DrawPipeline::COUNT> lPipelines = {};
+	std::array<D3D12_INDEX_BUFFER_VIEW, 2> lIndexBuffers = {};
+	DrawPacketList lPackets;
+	for (auto count : PACKET_COUNTS)
+	{
+		lPackets.Clear();
+		for (uint32_t i = 0; i < count; ++i)
+		{
+			if (i % PACKETS_PER_OBJECT == 0)
+			{
+				lPackets.AddObject({});
+			}
+			const uint32_t lMaterial = rand() % MATERIALS;
+			DrawPacket lPacket = {};
+			lPacket.mIndexCount = 3 * (64 + rand() % 1024);
+			lPacket.mStartIndexLocation = rand();
+			lPacket.mObjectIndex = uint32_t(lPackets.Size() / PACKETS_PER_OBJECT);
+			lPacket.mMaterial = lMaterial;
+			lPackets.Add(DrawKey::Make(DrawPass::COLOR, DrawPipeline::COLOR_MSAA, lMaterial, random() * 100.0f), lPacket);
+		}
+		lPackets.Sort();
+		auto lItems = lPackets.GetSortedRange(DrawPass::COLOR);
+		float lSerialMs = 0.0f;
+		for (uint32_t workers = 1; workers <= lMaxWorkers; workers *= 2)
+		{
+			DrawPacketList::SplitRanges(lItems, workers, 1, lRanges);
+			tf::Taskflow lFlow;
+			lFlow.for_each_index(size_t(0), lRanges.size(), size_t(1), [&](size_t InRange)
+				{
+					lLists[InRange].Reset();
+					lPackets.Record(&lLists[InRange], lRanges[InRange], lPipelines, DrawPipeline::COLOR_MSAA, lIndexBuffers);
+				});
+			auto lStart = std::chrono::steady_clock::now();
+			for (uint32_t r = 0; r < REPEATS; ++r)
+			{
+				mRenderExecution->run(lFlow).wait();
+			}
+			const float lMs = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - lStart).count() / REPEATS;
+			lSerialMs = workers == 1 ? lMs : lSerialMs;
+			uint32_t lDraws = 0;
+			uint32_t lStateChanges = 0;
+			size_t lBytes = 0;
+			for (size_t i = 0; i < lRanges.size(); ++i)
+			{
+				lDraws += lLists[i].GetDraws();
+				lStateChanges += lLists[i].GetStateChanges();
+				lBytes += lLists[i].GetBytes();
+			}
+			//Every range starts without state,so more lists cost a few redundant state changes.
+			gLogger->info("Draw recording benchmark {} packets,{} lists:{:.3f} ms ({:.2f}x),{} draws,{} state changes,{} KB",
+				count, lRanges.size(), lMs, lSerialMs / std::max(lMs, 1e-6f), lDraws, lStateChanges, lBytes / 1024);
+		}
+	}
+}
+
 void Renderer::ClusterForwardRenderer::DepthOnlyPass(const ECS::StaticMeshComponent& InAsset)
 {
 	
@@ -446,6 +1328,133 @@ void Renderer::ClusterForwardRenderer::InitPostProcess()
 	//mImageBlit = std::make_unique<BasicPostProcess>(g_Device, imageBlit, BasicPostProcess::Copy);
 }
 
+void Renderer::ClusterForwardRenderer::RecordPostProcess(uint32_t InBackbufferIndex)
+{
+	auto lSceneColor = mContext->GetRenderTarget(RenderTarget::COLOR_OUTPUT_MSAA);
+	const uint32_t lWidth = lSceneColor->GetWidth();
+	const uint32_t lHeight = lSceneColor->GetHeight();
+	auto& lGraph = *mPostGraph;
+	auto& lBackend = *mPostGraphBackend;
+	lGraph.Reset();
+	//SkyboxPass moves the scene color back to RENDER_TARGET next frame.
+	auto lMsaa = lGraph.Import("SceneColorMSAA", D3D12RenderGraphBackend::Describe(lWidth, lHeight, g_ColorBufferFormat, 8), RGAccess::RENDER_TARGET, RGAccess::RESOLVE_SOURCE);
+	auto lBackBuffer = lGraph.Import("BackBuffer", D3D12RenderGraphBackend::Describe(lWidth, lHeight, g_DisplayFormat), RGAccess::RENDER_TARGET, RGAccess::RENDER_TARGET);
+	auto lResolved = lGraph.Create("SceneColorResolved", D3D12RenderGraphBackend::Describe(lWidth, lHeight, g_ColorBufferFormat));
+	auto lBlurHalf = lGraph.Create("BlurHalf", D3D12RenderGraphBackend::Describe(lWidth / 2, lHeight / 2, g_ColorBufferFormat));
+	auto lBlurQuat = lGraph.Create("BlurQuat", D3D12RenderGraphBackend::Describe(lWidth / 2, lHeight / 2, g_ColorBufferFormat));
+	auto lBloomRes = lGraph.Create("BloomRes", D3D12RenderGraphBackend::Describe(lWidth, lHeight, g_ColorBufferFormat));
+	SimpleMath::Viewport lHalfViewport(mViewPort);
+	lHalfViewport.height /= 2.f;
+	lHalfViewport.width /= 2.f;
+
+	lGraph.AddPass("ResolveSceneColor",
+		[&](RenderGraph::PassBuilder& InBuilder)
+		{
+			InBuilder.Read(lMsaa, RGAccess::RESOLVE_SOURCE);
+			InBuilder.Write(lResolved, RGAccess::RESOLVE_DEST);
+		},
+		[=, &lBackend]
+		{
+			mGraphicsCmd->ResolveSubresource(lBackend.GetTexture(lResolved)->GetResource(), 0, lBackend.GetTexture(lMsaa)->GetResource(), 0, DXGI_FORMAT_R16G16B16A16_FLOAT);
+		});
+	lGraph.AddPass("BloomExtract",
+		[&](RenderGraph::PassBuilder& InBuilder)
+		{
+			InBuilder.Read(lResolved, RGAccess::SHADER_READ);
+			InBuilder.Write(lBlurHalf, RGAccess::RENDER_TARGET);
+		},
+		[=, &lBackend]
+		{
+			auto lSource = lBackend.GetTexture(lResolved);
+			ppBloomExtract->SetSourceTexture(lSource->GetSRVGPU(), lSource->GetResource());
+			ppBloomExtract->SetBloomExtractParameter(mBloomThreshold);
+			mGraphicsCmd->OMSetRenderTargets(1, &lBackend.GetTexture(lBlurHalf)->GetRTV(), FALSE, nullptr);
+			mGraphicsCmd->RSSetViewports(1, lHalfViewport.Get12());
+			ppBloomExtract->Process(mGraphicsCmd);
+		});
+	lGraph.AddPass("BloomBlurH",
+		[&](RenderGraph::PassBuilder& InBuilder)
+		{
+			InBuilder.Read(lBlurHalf, RGAccess::SHADER_READ);
+			InBuilder.Write(lBlurQuat, RGAccess::RENDER_TARGET);
+		},
+		[=, &lBackend]
+		{
+			auto lSource = lBackend.GetTexture(lBlurHalf);
+			ppBloomBlur->SetSourceTexture(lSource->GetSRVGPU(), lSource->GetResource());
+			ppBloomBlur->SetBloomBlurParameters(true, mBloomBlurKernelSize, mBloomBrightness);
+			mGraphicsCmd->OMSetRenderTargets(1, &lBackend.GetTexture(lBlurQuat)->GetRTV(), FALSE, nullptr);
+			ppBloomBlur->Process(mGraphicsCmd);
+		});
+	lGraph.AddPass("BloomBlurV",
+		[&](RenderGraph::PassBuilder& InBuilder)
+		{
+			InBuilder.Read(lBlurQuat, RGAccess::SHADER_READ);
+			InBuilder.Write(lBlurHalf, RGAccess::RENDER_TARGET);
+		},
+		[=, &lBackend]
+		{
+			auto lSource = lBackend.GetTexture(lBlurQuat);
+			ppBloomBlur->SetSourceTexture(lSource->GetSRVGPU(), lSource->GetResource());
+			ppBloomBlur->SetBloomBlurParameters(false, mBloomBlurKernelSize, mBloomBrightness);
+			mGraphicsCmd->OMSetRenderTargets(1, &lBackend.GetTexture(lBlurHalf)->GetRTV(), FALSE, nullptr);
+			ppBloomBlur->Process(mGraphicsCmd);
+		});
+	lGraph.AddPass("BloomCombine",
+		[&](RenderGraph::PassBuilder& InBuilder)
+		{
+			InBuilder.Read(lResolved, RGAccess::SHADER_READ);
+			InBuilder.Read(lBlurHalf, RGAccess::SHADER_READ);
+			InBuilder.Write(lBloomRes, RGAccess::RENDER_TARGET);
+		},
+		[=, &lBackend]
+		{
+			ppBloomCombine->SetSourceTexture(lBackend.GetTexture(lResolved)->GetSRVGPU());
+			ppBloomCombine->SetSourceTexture2(lBackend.GetTexture(lBlurHalf)->GetSRVGPU());
+			ppBloomCombine->SetBloomCombineParameters(mbloomIntensity, mbaseIntensity, mbloomSaturation, mbloomBaseSaturation);
+			mGraphicsCmd->OMSetRenderTargets(1, &lBackend.GetTexture(lBloomRes)->GetRTV(), FALSE, nullptr);
+			mGraphicsCmd->RSSetViewports(1, &mViewPort);
+			ppBloomCombine->Process(mGraphicsCmd);
+		});
+	//Without tone mapping nothing reads the bloom chain and the graph culls it.
+	if (mUseToneMapping)
+	{
+		lGraph.AddPass("ToneMap",
+			[&](RenderGraph::PassBuilder& InBuilder)
+			{
+				InBuilder.Read(lBloomRes, RGAccess::SHADER_READ);
+				InBuilder.Write(lBackBuffer, RGAccess::RENDER_TARGET);
+			},
+			[=, &lBackend]
+			{
+				ppToneMap->SetHDRSourceTexture(lBackend.GetTexture(lBloomRes)->GetSRVGPU());
+				mGraphicsCmd->OMSetRenderTargets(1, &lBackend.GetTexture(lBackBuffer)->GetRTV(), true, nullptr);
+				ppToneMap->SetExposure(mExposure);
+				ppToneMap->Process(mGraphicsCmd);
+			});
+	}
+	else
+	{
+		lGraph.AddPass("ResolveToBackBuffer",
+			[&](RenderGraph::PassBuilder& InBuilder)
+			{
+				InBuilder.Read(lMsaa, RGAccess::RESOLVE_SOURCE);
+				InBuilder.Write(lBackBuffer, RGAccess::RESOLVE_DEST);
+			},
+			[=, &lBackend]
+			{
+				mGraphicsCmd->ResolveSubresource(lBackend.GetTexture(lBackBuffer)->GetResource(), 0, lBackend.GetTexture(lMsaa)->GetResource(), 0, DXGI_FORMAT_R16G16B16A16_FLOAT);
+			});
+	}
+
+	lGraph.Compile(lBackend);
+	lBackend.SetCommandList(mGraphicsCmd);
+	lBackend.BindImported(lMsaa, lSceneColor.get());
+	lBackend.BindImported(lBackBuffer, &g_DisplayPlane[InBackbufferIndex]);
+	lGraph.Execute(lBackend);
+	mRenderGraphStats = lGraph.GetStats();
+}
+
 void Renderer::ClusterForwardRenderer::FirstFrame()
 {
 	BaseRenderer::FirstFrame();
@@ -519,6 +1528,10 @@ void Renderer::ClusterForwardRenderer::CreatePipelineState()
 	lDesc.RasterizerState.CullMode = D3D12_CULL_MODE_FRONT;
 	g_Device->CreateGraphicsPipelineState(&lDesc, IID_PPV_ARGS(&mPipelineStateShadowMap));
 	mPipelineStateShadowMap->SetName(L"mPipelineStateShadowMap");
+
+	mPipelineTable[(size_t)DrawPipeline::DEPTH_ONLY] = mPipelineStateDepthOnly;
+	mPipelineTable[(size_t)DrawPipeline::SHADOW_MAP] = mPipelineStateShadowMap;
+	mPipelineTable[(size_t)DrawPipeline::COLOR_MSAA] = mColorPassPipelineState8XMSAA;
 }
 
 void Renderer::ClusterForwardRenderer::CreateRootSignature()
@@ -536,26 +1549,24 @@ void Renderer::ClusterForwardRenderer::CreateRootSignature()
 		D3D12_ROOT_PARAMETER frameResourceTable = {};
 		frameResourceTable.ParameterType = D3D12_ROOT_PARAMETER_TYPE_DESCRIPTOR_TABLE;
 
-		D3D12_DESCRIPTOR_RANGE light_buffer_range = {};
-		light_buffer_range.RangeType = D3D12_DESCRIPTOR_RANGE_TYPE_SRV;
-		light_buffer_range.NumDescriptors = 1;
-		light_buffer_range.BaseShaderRegister = 1;
-		light_buffer_range.RegisterSpace = 0;
-		light_buffer_range.OffsetInDescriptorsFromTableStart = 0;
-
 		D3D12_DESCRIPTOR_RANGE cluster_range = {};
 		cluster_range.RangeType = D3D12_DESCRIPTOR_RANGE_TYPE_UAV;
 		cluster_range.NumDescriptors = 1;
 		cluster_range.BaseShaderRegister = 2;
 		cluster_range.RegisterSpace = 0;
+		cluster_range.OffsetInDescriptorsFromTableStart = 0;
 		//warning !!! skip two descriptors than used by counter buffer within uav buffer
-		//offset is 3 = 2(counter buffer desc) + 1(light buffer desc)
 		auto cluster_offset = g_DescHeap[D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV]->CalcHandleOffset(mClusterBuffer->GetUAV());
-		auto light_offset = g_DescHeap[D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV]->CalcHandleOffset(mLightBuffer->GetSRV());
-		cluster_range.OffsetInDescriptorsFromTableStart = cluster_offset - light_offset;
-		
 
-		std::vector<D3D12_DESCRIPTOR_RANGE> frame_resource_ranges = { light_buffer_range,cluster_range };
+		D3D12_DESCRIPTOR_RANGE light_index_range = {};
+		light_index_range.RangeType = D3D12_DESCRIPTOR_RANGE_TYPE_UAV;
+		light_index_range.NumDescriptors = 1;
+		light_index_range.BaseShaderRegister = 3;
+		light_index_range.RegisterSpace = 0;
+		auto light_index_offset = g_DescHeap[D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV]->CalcHandleOffset(mClusterLightIndexBuffer->GetUAV());
+		light_index_range.OffsetInDescriptorsFromTableStart = light_index_offset - light_offset;
+
+		std::vector<D3D12_DESCRIPTOR_RANGE> frame_resource_ranges = { light_buffer_range,cluster_range,light_index_range };
 		frameResourceTable.DescriptorTable.NumDescriptorRanges = frame_resource_ranges.size();
 		frameResourceTable.DescriptorTable.pDescriptorRanges = frame_resource_ranges.data();
 		frameResourceTable.ShaderVisibility = D3D12_SHADER_VISIBILITY_ALL;
@@ -571,27 +1582,19 @@ void Renderer::ClusterForwardRenderer::CreateRootSignature()
 
 
 
-		D3D12_ROOT_PARAMETER diffuseColorTexture = {};
-		diffuseColorTexture.ParameterType = D3D12_ROOT_PARAMETER_TYPE_DESCRIPTOR_TABLE;
-		D3D12_DESCRIPTOR_RANGE diffuseRange = {};
-		//Texture table range
-		diffuseRange.RangeType = D3D12_DESCRIPTOR_RANGE_TYPE_SRV;
-		diffuseRange.NumDescriptors = 1;
-		diffuseRange.BaseShaderRegister = 5;
-		diffuseRange.RegisterSpace = 0;
-		diffuseRange.OffsetInDescriptorsFromTableStart = 0;
-
-		D3D12_DESCRIPTOR_RANGE roughnessRange = {};
-		roughnessRange.RangeType = D3D12_DESCRIPTOR_RANGE_TYPE_SRV;
-		roughnessRange.NumDescriptors = 1;
-		roughnessRange.BaseShaderRegister = 7;
-		roughnessRange.RegisterSpace = 0;
-		roughnessRange.OffsetInDescriptorsFromTableStart = D3D12_DESCRIPTOR_RANGE_OFFSET_APPEND;
-
-		std::vector<D3D12_DESCRIPTOR_RANGE> diffuseRanges = { diffuseRange,roughnessRange };
-		diffuseColorTexture.DescriptorTable.NumDescriptorRanges = (UINT)diffuseRanges.size();
-		diffuseColorTexture.DescriptorTable.pDescriptorRanges = diffuseRanges.data();
-		diffuseColorTexture.ShaderVisibility = D3D12_SHADER_VISIBILITY_PIXEL;
+		//Bindless textures:the persistent descriptors of the heap,materials index them.
+		D3D12_ROOT_PARAMETER bindlessTextures = {};
+		bindlessTextures.ParameterType = D3D12_ROOT_PARAMETER_TYPE_DESCRIPTOR_TABLE;
+		D3D12_DESCRIPTOR_RANGE bindlessRange = {};
+		bindlessRange.RangeType = D3D12_DESCRIPTOR_RANGE_TYPE_SRV;
+		//Unbounded,the shader array covers the heap from its start and the materials index it.
+		bindlessRange.NumDescriptors = UINT_MAX;
+		bindlessRange.BaseShaderRegister = 0;
+		bindlessRange.RegisterSpace = 1;
+		bindlessRange.OffsetInDescriptorsFromTableStart = 0;
+		bindlessTextures.DescriptorTable.NumDescriptorRanges = 1;
+		bindlessTextures.DescriptorTable.pDescriptorRanges = &bindlessRange;
+		bindlessTextures.ShaderVisibility = D3D12_SHADER_VISIBILITY_PIXEL;
 
 		D3D12_ROOT_PARAMETER shadowMap = {};
 		D3D12_DESCRIPTOR_RANGE shadowMapRange = {};
@@ -606,28 +1609,53 @@ void Renderer::ClusterForwardRenderer::CreateRootSignature()
 		shadowMap.DescriptorTable.pDescriptorRanges = shadowmapranges.data();
 		shadowMap.ShaderVisibility = D3D12_SHADER_VISIBILITY_PIXEL;
 
-		D3D12_ROOT_PARAMETER normalMapTexture = {};
-		normalMapTexture.ParameterType = D3D12_ROOT_PARAMETER_TYPE_DESCRIPTOR_TABLE;
-		D3D12_DESCRIPTOR_RANGE normalRange = {};
-		normalRange.RangeType = D3D12_DESCRIPTOR_RANGE_TYPE_SRV;
-		normalRange.NumDescriptors = 1;
-		normalRange.BaseShaderRegister = 6;
-		normalRange.RegisterSpace = 0;
-		normalRange.OffsetInDescriptorsFromTableStart = 0;
-		std::vector<D3D12_DESCRIPTOR_RANGE> normalMapRanges = { normalRange };
-		normalMapTexture.DescriptorTable.NumDescriptorRanges = (UINT)normalMapRanges.size();
-		normalMapTexture.DescriptorTable.pDescriptorRanges = normalMapRanges.data();
-		normalMapTexture.ShaderVisibility = D3D12_SHADER_VISIBILITY_PIXEL;
+		//Packed GpuMaterials of the frame.
+		D3D12_ROOT_PARAMETER materials = {};
+		materials.ParameterType = D3D12_ROOT_PARAMETER_TYPE_SRV;
+		materials.Descriptor.RegisterSpace = 0;
+		materials.Descriptor.ShaderRegister = 5;
+		materials.ShaderVisibility = D3D12_SHADER_VISIBILITY_PIXEL;
+
+		//Material index of the draw.
+		D3D12_ROOT_PARAMETER drawData = {};
+		drawData.ParameterType = D3D12_ROOT_PARAMETER_TYPE_32BIT_CONSTANTS;
+		drawData.Constants.RegisterSpace = 0;
+		drawData.Constants.ShaderRegister = 5;
+		drawData.Constants.Num32BitValues = 1;
+		drawData.ShaderVisibility = D3D12_SHADER_VISIBILITY_PIXEL;
+
+
+		//Z-bin buffers as root SRVs,they are recreated when the light count outgrows them.
+		D3D12_ROOT_PARAMETER zbinBuffers[3] = {};
+		for (UINT i = 0; i < 3; ++i)
+		{
+			zbinBuffers[i].ParameterType = D3D12_ROOT_PARAMETER_TYPE_SRV;
+			zbinBuffers[i].Descriptor.RegisterSpace = 0;
+			zbinBuffers[i].Descriptor.ShaderRegister = 9 + i;
+			zbinBuffers[i].ShaderVisibility = D3D12_SHADER_VISIBILITY_PIXEL;
+		}
 
+		//Lights as a root SRV too,the light buffer is replaced when it grows while earlier frames still read the old one
+		//and a version 1.0 root signature treats table descriptors as volatile.
+		D3D12_ROOT_PARAMETER lights = {};
+		lights.ParameterType = D3D12_ROOT_PARAMETER_TYPE_SRV;
+		lights.Descriptor.RegisterSpace = 0;
+		lights.Descriptor.ShaderRegister = 1;
+		lights.ShaderVisibility = D3D12_SHADER_VISIBILITY_PIXEL;
 
 		std::vector<D3D12_ROOT_PARAMETER> parameters =
 		{
 			frameDataCBV,//0
 			frameResourceTable,//1
             componentData,//2
-			diffuseColorTexture,//3
+			bindlessTextures,//3
 			shadowMap,//4,
-			normalMapTexture,
+			materials,
+			zbinBuffers[0],//6
+			zbinBuffers[1],
+			zbinBuffers[2],
+			drawData,//9
+			lights,//10
 		};
 
 		//Samplers
@@ -667,19 +1695,20 @@ void Renderer::ClusterForwardRenderer::OnGameSceneUpdated(std::shared_ptr<GAS::G
 	if (InScene == mCurrentScene)
 	{
 		auto& textureMap = mCurrentScene->GetTextureMap();
-		for (auto [textureName,textureData] : textureMap)
+		for (auto [textureName, texture] : textureMap)
 		{
-			LoadMaterial(textureName, textureData);
+			LoadMaterial(texture);
 		}
 	}
 }
 
-void Renderer::ClusterForwardRenderer::DrawObject(const ECS::StaticMeshComponent& InAsset)
+void Renderer::ClusterForwardRenderer::DrawObject(const ECS::StaticMeshComponent& InAsset, std::span<const ECS::SubMeshRange> InSubMeshes)
 {
 	//Render 
-	for (const auto& subMesh : InAsset.mSubMeshes)
+	mGraphicsCmd->IASetIndexBuffer(&mIndexBufferViews[InAsset.m16BitIndices]);
+	for (const auto& subMesh : InSubMeshes)
 	{
-		mGraphicsCmd->DrawIndexedInstanced((UINT)subMesh.second.TriangleCount * 3, 1, InAsset.StartIndexLocation + subMesh.second.IndexOffset,
+		mGraphicsCmd->DrawIndexedInstanced(subMesh.IndexCount, 1, InAsset.StartIndexLocation + subMesh.IndexOffset,
 			InAsset.BaseVertexLocation, 0);
 	}
 }
@@ -692,10 +1721,6 @@ void Renderer::ClusterForwardRenderer::PrepairForRendering()
 			TransitState(lcmd, mContext->GetShadowMap()->GetResource(), D3D12_RESOURCE_STATE_COMMON, D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE);
 			TransitState(lcmd, mContext->GetDepthBuffer()->GetResource(), D3D12_RESOURCE_STATE_COMMON, D3D12_RESOURCE_STATE_DEPTH_WRITE);
 			TransitState(lcmd, mContext->GetRenderTarget(RenderTarget::COLOR_OUTPUT_MSAA)->GetResource(), D3D12_RESOURCE_STATE_COMMON, D3D12_RESOURCE_STATE_RESOLVE_SOURCE);
-			TransitState(lcmd, mContext->GetRenderTarget(RenderTarget::COLOR_OUTPUT_RESOLVED)->GetResource(), D3D12_RESOURCE_STATE_COMMON, D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE);
-			TransitState(lcmd, mContext->GetRenderTarget(RenderTarget::BLUR_HALF)->GetResource(), D3D12_RESOURCE_STATE_COMMON, D3D12_RESOURCE_STATE_RENDER_TARGET);
-			TransitState(lcmd, mContext->GetRenderTarget(RenderTarget::BLUR_QUAT)->GetResource(), D3D12_RESOURCE_STATE_COMMON, D3D12_RESOURCE_STATE_RENDER_TARGET);
-			TransitState(lcmd, mContext->GetRenderTarget(RenderTarget::BLOOM_RES)->GetResource(), D3D12_RESOURCE_STATE_COMMON, D3D12_RESOURCE_STATE_RENDER_TARGET);
 
 			for (size_t cubeFace = 0; cubeFace < 6; cubeFace++)
 			{
@@ -4,6 +4,10 @@
 #include <camera.h>
 #include "game_scene.h"
 #include "base_renderer.h"
+#include "render_graph_d3d12.h"
+#include "frame_command_lists.h"
+#include "material_table.h"
+#include "gpu_cull_pass.h"
 
 
 namespace tf
@@ -49,16 +53,82 @@ namespace Renderer
 		virtual void CreateRootSignature();
 		void UpdataFrameData() override;
 		void OnGameSceneUpdated(std::shared_ptr<GAS::GameScene> InScene, std::span<entt::entity> InNewEntities);
-		virtual void DrawObject(const ECS::StaticMeshComponent& InAsset);
+		virtual void DrawObject(const ECS::StaticMeshComponent& InAsset, std::span<const ECS::SubMeshRange> InSubMeshes);
 		void PrepairForRendering() override;
+		void OcclusionCull();
+		void ShadowCasterCull();
+		void BuildDrawPackets();
+		//Root signature,frame resources,targets and pipeline every draw of InPass expects.
+		void SetDrawPassStates(ID3D12GraphicsCommandList* InCmd, DrawPass InPass, uint32_t InFrameDataIndex);
+		//Grow the instance buffer,argument buffers and upload ring of the GPU driven path,old ones are retired for the frames in flight.
+		void EnsureGpuCullCapacity(uint32_t InInstances, bool InValidate);
+		//Rewrite the instance table,stage its changed records and the cull constants of every pass in the slot of InFrameIndex.
+		//InHiZValid:the previous frame built the Hi-Z the depth prepass tests against.
+		void PrepareGpuCull(uint32_t InFrameIndex, bool InHiZValid);
+		//Compute states and root parameters of the culling and Hi-Z dispatches,InPass picks the constants and argument buffer.
+		void SetGpuCullStates(DrawPass InPass, uint32_t InFrameIndex);
+		//Slot of InFrameIndex in mGpuCullValidationReadback:the draws of every pass,then the Hi-Z before and after the rebuild.
+		size_t GetGpuCullValidationOffset(uint32_t InFrameIndex) const;
+		//Copy the instances PrepareGpuCull staged into the instance buffer.
+		void RecordGpuInstanceUpload(uint32_t InFrameIndex);
+		//Cull the instances for InPass and draw the survivors,the states of InPass must be set on mGraphicsCmd.
+		void RecordGpuDrivenPass(DrawPass InPass, uint32_t InFrameIndex);
+		//Rebuild the Hi-Z from the depth prepass,the color pass culls against it and the next frame's prepass too.
+		void RecordHiZBuild(uint32_t InFrameIndex);
+		//Counts of the last frame that used InFrameIndex and its validation against the reference,the slot is known to be complete.
+		void ReadGpuCullResults(uint32_t InFrameIndex);
+		//Record the sorted packets of InPass,split over worker command lists when there are enough.
+		//The states of InPass must be set on mGraphicsCmd,which may be a new list with the same states afterwards.
+		void RecordDrawPackets(DrawPass InPass, uint32_t InFrameDataIndex);
+		void RecordDrawRange(DrawPass InPass, uint32_t InRange);
+		//Time recording synthetic packets into counting command lists over 1 to all workers and log the results.
+		void BenchmarkDrawRecording();
+		//Grow the z-bin buffers and their upload ring to fit,old ones are retired for the frames in flight.
+		void EnsureZBinCapacity(uint32_t InLights, uint32_t InTiles);
+		//Sort and bin the lights on the CPU,upload them and expand the tile masks on the GPU or upload the CPU masks.
+		void RecordZBinCull(uint32_t InFrameIndex, bool InCpuMasks, bool InValidate);
+		//Grow the material upload ring to InMaterials per slot,the old one is retired for the frames in flight.
+		void EnsureMaterialCapacity(uint32_t InMaterials);
+		//Copy the packed materials into the slot of InFrameIndex,the color pass binds that slot.
+		void UploadMaterials(uint32_t InFrameIndex);
+		//Active cluster count of the newest frame whose compute list completed by InComputeCompleted,if not read yet.
+		void ReadActiveClusterStats(uint64_t InComputeCompleted);
+		//Time both CPU cullers over synthetic light counts and log the results.
+		void BenchmarkLightCulling();
+		//Run the cost model on the last frame and switch mClusterGrid if a candidate is clearly cheaper.
+		void TuneClusterGrid();
+		//Build,compile and record the post processing graph from the MSAA scene color to the back buffer.
+		void RecordPostProcess(uint32_t InBackbufferIndex);
 	protected:
+		//Frames between two auto tuning runs of the cluster grid.
+		static constexpr uint32_t CLUSTER_GRID_TUNE_INTERVAL = 30;
+		//Smaller ranges are not worth the state setup and submission of another command list.
+		static constexpr uint32_t MIN_PACKETS_PER_LIST = 256;
+		//Pipeline every range of a pass starts with.
+		static constexpr DrawPipeline PASS_PIPELINES[] = { DrawPipeline::DEPTH_ONLY, DrawPipeline::SHADOW_MAP, DrawPipeline::COLOR_MSAA };
+		static_assert(std::size(PASS_PIPELINES) == (size_t)DrawPass::COUNT);
+		//Head of every mGpuCullUploadRing slice,the instances follow.
+		static constexpr size_t GPU_CULL_CONSTANTS_BYTES = sizeof(GpuCullConstants) * (size_t)DrawPass::COUNT;
+		//Smallest instance capacity,keeps the ring slices 256 byte aligned for the constant buffer views.
+		static constexpr uint32_t MIN_GPU_INSTANCES = 64;
+		//Indirect arguments of every frame slot come first in mActiveClusterReadback,the active list of a validated frame after them.
+		static constexpr size_t ACTIVE_CLUSTER_LIST_READBACK_OFFSET = size_t(LightCullPass::ACTIVE_ARGS_BYTES) * SWAP_CHAIN_BUFFER_COUNT;
 		bool mIsFirstFrame;
-		uint64_t mComputeFenceValue;
-		HANDLE mComputeFenceHandle;
-		ID3D12Fence* mComputeFence;
 		ID3D12GraphicsCommandList* mComputeCmd;
+		//Current list of mFrameCmds,changes when a pass is split across workers or the depth prepass is submitted early.
 		ID3D12GraphicsCommandList* mGraphicsCmd;
-		ID3D12CommandAllocator* mGraphicsCmdAllocator;
+		std::unique_ptr<FrameCommandLists> mFrameCmds;
+		//A pass split across the workers,read by its cached taskflow.Rebuilt when the range count changes.
+		struct ParallelDraws
+		{
+			std::vector<std::span<const DrawPacketList::SortItem>> mRanges;
+			std::span<ID3D12GraphicsCommandList* const> mLists;
+			std::vector<DrawPacketStats> mStats;
+			uint32_t mFrameDataIndex = 0;
+			std::unique_ptr<tf::Taskflow> mFlow;
+			uint32_t mFlowRanges = 0;
+		};
+		std::array<ParallelDraws, (size_t)DrawPass::COUNT> mParallelDraws;
 		ID3D12PipelineState* mColorPassPipelineState;
 		ID3D12PipelineState* mColorPassPipelineState8XMSAA;
 		ID3D12PipelineState* mPipelineStateDepthOnly;
@@ -69,14 +139,140 @@ namespace Renderer
 		
 		
 		std::unique_ptr<class tf::Taskflow> mRenderFlow;
-		std::unique_ptr<class tf::Executor> mRenderExecution;
+		//Shared with the scene systems,owned by the game engine.
+		tf::Executor* mRenderExecution = nullptr;
 		
 		float mColorRGBA[4] = { 0.15f,0.25f,0.75f,1.0f };
 		
 		std::unique_ptr<Resource::StructuredBuffer> mClusterBuffer;
+		std::unique_ptr<Resource::StructuredBuffer> mClusterLightIndexBuffer;
+		//Readback targets when validating light culling.
 		std::vector<Cluster> mCLusters;
+		std::vector<uint32_t> mClusterLightIndices;
+		std::unique_ptr<ClusterLightCuller> mCpuLightCuller;
+		ClusterGridTuner mClusterGridTuner;
+		uint32_t mFramesSinceGridTune = 0;
+		//Created on first use.
+		std::unique_ptr<Resource::UploadBuffer> mClusterUploadRing;
+		uint8_t* mClusterUploadData = nullptr;
+		std::unique_ptr<Resource::ReadbackBuffer> mClusterReadback;
+		std::unique_ptr<Resource::StructuredBuffer> mActiveClusterFlagBuffer;
+		std::unique_ptr<Resource::StructuredBuffer> mActiveClusterListBuffer;
+		std::unique_ptr<Resource::IndirectArgsBuffer> mActiveClusterArgsBuffer;
+		//Indirect arguments per frame slot,followed by the active list when validating.
+		std::unique_ptr<Resource::ReadbackBuffer> mActiveClusterReadback;
+		//Compute value of the arguments copied into each slot and the cluster count of that frame's grid,cleared once read.
+		struct PendingClusterStats
+		{
+			uint64_t mComputeValue = 0;
+			uint32_t mTotalClusters = 0;
+		};
+		std::array<PendingClusterStats, SWAP_CHAIN_BUFFER_COUNT> mPendingClusterStats;
+		std::vector<uint32_t> mActiveClusterList;
+		//Per pixel sample depth range for the CPU reference,created on first use.
+		//Only the compute list touches it and the CPU waits for that list whenever it is written,so it is replaced in place on resize.
+		std::unique_ptr<Resource::StructuredBuffer> mPixelDepthRangeBuffer;
+		std::unique_ptr<Resource::ReadbackBuffer> mPixelDepthRangeReadback;
+		std::vector<DirectX::XMFLOAT2> mPixelDepthRanges;
 		std::unique_ptr<SkyboxPass> mSkyboxPass;
 		std::unique_ptr<LightCullPass> mLightCullPass;
+		std::unique_ptr<ZBinLightCuller> mZBinCuller;
+		std::unique_ptr<ZBinTileMaskPass> mZBinTileMaskPass;
+		std::unique_ptr<Resource::StructuredBuffer> mZBinBuffer;
+		std::unique_ptr<Resource::StructuredBuffer> mZBinLightOrderBuffer;
+		std::unique_ptr<Resource::StructuredBuffer> mZBinTileRectBuffer;
+		std::unique_ptr<Resource::StructuredBuffer> mZBinTileMaskBuffer;
+		//One slice per frame in flight:bins,light order,tile rects,then tile masks for the CPU path.
+		std::unique_ptr<Resource::UploadBuffer> mZBinUploadRing;
+		uint8_t* mZBinUploadData = nullptr;
+		std::unique_ptr<Resource::ReadbackBuffer> mZBinReadback;
+		std::vector<uint32_t> mZBinTileMasks;
+		uint32_t mZBinLightCapacity = 0;
+		uint32_t mZBinTileCapacity = 0;
+		//Replaced buffers stay alive until the frames that may still read them are done.
+		struct RetiredZBinBuffers
+		{
+			uint64_t mReleaseAfter;
+			std::unique_ptr<Resource::StructuredBuffer> mLightOrderBuffer;
+			std::unique_ptr<Resource::StructuredBuffer> mTileRectBuffer;
+			std::unique_ptr<Resource::StructuredBuffer> mTileMaskBuffer;
+			std::unique_ptr<Resource::UploadBuffer> mUploadRing;
+		};
+		std::vector<RetiredZBinBuffers> mRetiredZBinBuffers;
+		uint64_t mZBinFrameCount = 0;
+		std::unique_ptr<SoftwareOcclusionCuller> mOcclusionCuller;
+		std::vector<entt::entity> mVisibleEntities;
+		std::vector<DirectX::BoundingBox> mVisibleBounds;
+		std::unique_ptr<ShadowCasterCuller> mShadowCasterCuller;
+		std::vector<entt::entity> mShadowCasters;
+		//Bindless texture indices per MeshStore material id,repacked every frame.
+		MaterialTable mMaterialTable;
+		//One slice of mMaterialCapacity materials per frame in flight,read by the color pass straight from the upload heap.
+		std::unique_ptr<Resource::UploadBuffer> mMaterialRing;
+		uint8_t* mMaterialData = nullptr;
+		uint32_t mMaterialCapacity = 0;
+		D3D12_GPU_VIRTUAL_ADDRESS mMaterialAddress = 0;
+		struct RetiredMaterialRing
+		{
+			uint64_t mReleaseAfter;
+			std::unique_ptr<Resource::UploadBuffer> mRing;
+		};
+		std::vector<RetiredMaterialRing> mRetiredMaterialRings;
+		std::unique_ptr<DrawPacketList> mDrawPackets;
+		//GPU driven drawing,the buffers are created on first use.
+		std::unique_ptr<GpuCullPass> mGpuCullPass;
+		GpuInstanceTable mGpuInstances;
+		GpuCullReference mGpuCullReference;
+		std::unique_ptr<Resource::StructuredBuffer> mGpuInstanceBuffer;
+		//Counts then culled draws of every pass.
+		std::array<std::unique_ptr<Resource::IndirectArgsBuffer>, (size_t)DrawPass::COUNT> mGpuDrawArgs;
+		std::unique_ptr<Resource::StructuredBuffer> mHiZBuffer;
+		//One slice per frame in flight:the cull constants of every pass,then the instances.
+		std::unique_ptr<Resource::UploadBuffer> mGpuCullUploadRing;
+		uint8_t* mGpuCullUploadData = nullptr;
+		//Counts of every pass per frame slot.
+		std::unique_ptr<Resource::ReadbackBuffer> mGpuCullReadback;
+		//Draws of every pass and the Hi-Z before and after the rebuild per frame slot,created by the first validated frame.
+		std::unique_ptr<Resource::ReadbackBuffer> mGpuCullValidationReadback;
+		uint32_t mGpuInstanceCapacity = 0;
+		//Hi-Z layout of the depth buffer,the rest of the constants are filled per pass.
+		GpuCullConstants mHiZLayout = {};
+		uint32_t mHiZTexels = 0;
+		//Cull constants of the frame being recorded,indexed by DrawPass.
+		std::array<GpuCullConstants, (size_t)DrawPass::COUNT> mGpuCullConstants = {};
+		//Instance records PrepareGpuCull staged in the frame slot.
+		uint32_t mGpuUploadBegin = 0;
+		uint32_t mGpuUploadEnd = 0;
+		//Latched before the render flow runs,so every task of a frame takes the same path.
+		bool mGpuDrivenFrame = false;
+		//Set by PrepareGpuCull,the passes of the frame cull and draw on the GPU.
+		bool mGpuCullPrepared = false;
+		//The view projection mHiZBuffer was built with.
+		DirectX::SimpleMath::Matrix mHiZViewPrj;
+		//What a frame slot recorded,read back once the slot comes around again.
+		struct PendingGpuCull
+		{
+			bool mRecorded = false;
+			bool mValidate = false;
+			std::array<GpuCullConstants, (size_t)DrawPass::COUNT> mConstants = {};
+			std::vector<GpuInstance> mInstances;
+		};
+		std::array<PendingGpuCull, SWAP_CHAIN_BUFFER_COUNT> mPendingGpuCull;
+		std::vector<IndirectDraw> mGpuCullDraws;
+		std::vector<float> mGpuCullHiZ;
+		struct RetiredGpuCullBuffers
+		{
+			uint64_t mReleaseAfter;
+			std::unique_ptr<Resource::StructuredBuffer> mInstanceBuffer;
+			std::array<std::unique_ptr<Resource::IndirectArgsBuffer>, (size_t)DrawPass::COUNT> mDrawArgs;
+			std::unique_ptr<Resource::UploadBuffer> mUploadRing;
+			std::unique_ptr<Resource::ReadbackBuffer> mValidationReadback;
+		};
+		std::vector<RetiredGpuCullBuffers> mRetiredGpuCullBuffers;
+		//Geometry pool views of the frame,taken once so every list of the frame binds the same buffers.
+		D3D12_VERTEX_BUFFER_VIEW mVertexBufferView = {};
+		std::array<D3D12_INDEX_BUFFER_VIEW, 2> mIndexBufferViews = {};
+		std::array<ID3D12PipelineState*, (size_t)DrawPipeline::COUNT> mPipelineTable = {};
 
         bool mHasSkybox = true;
 
@@ -87,6 +283,9 @@ namespace Renderer
 		std::unique_ptr<DirectX::DX12::ToneMapPostProcess> ppToneMap;
 		std::unique_ptr<DirectX::DX12::BasicPostProcess> mImageBlit;
 		std::unique_ptr<DirectX::DX12::GraphicsMemory> mGPUMemory;
+		//Resolve,bloom and tone mapping,rebuilt every frame.The bloom targets are transients sharing one heap.
+		std::unique_ptr<RenderGraph> mPostGraph;
+		std::unique_ptr<D3D12RenderGraphBackend> mPostGraphBackend;
 		
 	};
 
@@ -6,6 +6,7 @@ namespace Renderer
 	{
 		class Texture;
 		class UploadBuffer;
+		class ReadbackBuffer;
 		class StructuredBuffer;
 		class VertexBuffer;
 		class ColorBuffer;
@@ -27,6 +28,39 @@ namespace Renderer
 		DirectX::SimpleMath::Matrix  ViewMatrix;
 		DirectX::SimpleMath::Vector4 LightGridZParams;
 		DirectX::SimpleMath::Vector4 InvDeviceZToWorldZTransform;
+		uint32_t LightCount;
+		//LightCullMode
+		uint32_t LightCullMode;
+		uint32_t ZBinTileCountX;
+		uint32_t ZBinWordsPerTile;
+		//Bins per unit of view depth.
+		float ZBinScale;
+		//Cluster grid in use,the slice distribution is in LightGridZParams.
+		uint32_t ClusterCountX;
+		uint32_t ClusterCountY;
+		uint32_t ClusterCountZ;
+	};
+
+	//Cluster grid dimensions and the depth distribution of its slices.
+	struct ClusterGrid
+	{
+		uint32_t mX = CLUSTER_X;
+		uint32_t mY = CLUSTER_Y;
+		uint32_t mZ = CLUSTER_Z;
+		//Slices per doubling of view depth,see Utils::GetLightGridZParams.
+		float mDistributionScale = 4.05f;
+
+		uint32_t GetCount() const { return mX * mY * mZ; }
+
+		bool operator==(const ClusterGrid&) const = default;
+	};
+
+	enum class LightCullMode : uint32_t
+	{
+		//Per cluster light lists,see LightCull.hlsl.
+		CLUSTERS,
+		//Depth sorted lights,per depth bin index ranges and per screen tile bit masks.
+		ZBINS
 	};
 
 	struct OjbectData
@@ -1,30 +1,28 @@
 #include "renderer_context.h"
-#include "components.h"
+#include "asset_registry.h"
 
 const int SHADOW_MAP_WIDTH = 1920;
 const int SHADOW_MAP_HEIGHT = 1080;
 
 Renderer::RendererContext::RendererContext(std::shared_ptr<class CmdManager> InCmdManager):
-	mCopyFenceValue(1),
-	mCmdManager(InCmdManager)
+	mCmdManager(InCmdManager),
+	mUploader(std::make_unique<StagingUploader>(InCmdManager))
 {
-	//1.Vertex Buffer
-	mVertexBuffer = std::make_shared<Resource::VertexBuffer>();
-	mVertexBuffer->Create(L"VertexBuffer", MAX_ELE_COUNT, VERTEX_SIZE_IN_BYTE);
-
-	mIndexBuffer = std::make_shared<Resource::VertexBuffer>();
-	mIndexBuffer->Create(L"IndexBuffer", MAX_ELE_COUNT, VERTEX_SIZE_IN_BYTE);
-
-	//2.Upload Buffer
-	mVertexBufferCpu = std::make_shared<VertexBufferRenderer<Vertex>>();
-	mIndexBufferCpu = std::make_shared<VertexBufferRenderer<uint32_t>>();
-	mCopyFenceHandle = CreateEvent(nullptr, false, false, nullptr);
-	mCopyCmd = mCmdManager->AllocateCmdList(D3D12_COMMAND_LIST_TYPE_COPY);
-	Ensures(g_Device->CreateFence(0, D3D12_FENCE_FLAG_NONE, IID_PPV_ARGS(&mCopyFence)) == S_OK);
+	//1.Geometry pools,a page each until a scene reserves what it needs
+	mVertexPool = std::make_unique<GeometryPool>(L"VertexBuffer", VERTEX_SIZE_IN_BYTE, *mUploader);
+	mIndexPool = std::make_unique<GeometryPool>(L"IndexBuffer", (uint32_t)sizeof(uint32_t), *mUploader);
+	mIndexPool16 = std::make_unique<GeometryPool>(L"IndexBuffer16", (uint32_t)sizeof(uint16_t), *mUploader);
 }
 
 Renderer::RendererContext::~RendererContext()
 {
+	if (AssetLoader::gAssetRegistry)
+	{
+		for (auto mesh : mGpuMeshes)
+		{
+			AssetLoader::gAssetRegistry->GetMeshes().Release(mesh, AssetLoader::Residency::GPU);
+		}
+	}
 }
 
 void Renderer::RendererContext::CreateWindowDependentResource(int InWindowWidth, int InWindowHeight)
@@ -37,53 +35,15 @@ void Renderer::RendererContext::CreateWindowDependentResource(int InWindowWidth,
 	CreateShadowMap(mWindowWidth, mWindowHeight);
 	CreateColorBuffer(mWindowWidth, mWindowHeight);
 
-	mColorAttachmentResolved = std::make_unique<Resource::ColorBuffer>();
-	mColorAttachmentResolved->Create(L"ColorAttachmentResolved", mWindowWidth, mWindowHeight, 1, g_ColorBufferFormat);
-
-	mBloomRes = std::make_unique<Resource::ColorBuffer>();
-	mBloomRes->Create(L"Bloom Res", mWindowWidth, mWindowHeight, 1, g_ColorBufferFormat);
-
-	mBloomBlurRTHalf = std::make_shared<Resource::ColorBuffer>();
-	mBloomBlurRTHalf->Create(L"BlurHalf", mWindowWidth/2, mWindowHeight/2, 1, g_ColorBufferFormat);
-
-	mBloomBlurRTQuater = std::make_shared<Resource::ColorBuffer>();
-	mBloomBlurRTQuater->Create(L"BlurQuater", mWindowWidth / 2, mWindowHeight / 2, 1, g_ColorBufferFormat);
-
 }
 
-void Renderer::RendererContext::UpdateDataToVertexBuffer(std::span<Vertex> InData)
-{
-	UploadDataToResource<Vertex>(mVertexBuffer->GetResource(), InData, mVertexBufferCpu);
-}
-
-void Renderer::RendererContext::UpdateDataToIndexBuffer(std::span<uint32_t> InData)
-{
-	UploadDataToResource<uint32_t>(mIndexBuffer->GetResource(), InData, mIndexBufferCpu);
-}
-
-
-
-
-
 std::shared_ptr<Renderer::Resource::ColorBuffer> Renderer::RendererContext::GetRenderTarget(RenderTarget InTarget)
 {
 	switch (InTarget)
 	{
-	case Renderer::RenderTarget::COLOR_OUTPUT_RESOLVED:
-		return mColorAttachmentResolved;
-		break;
-	case Renderer::RenderTarget::BLUR_HALF:
-		return mBloomBlurRTHalf;
-		break;
-	case Renderer::RenderTarget::BLUR_QUAT:
-		return mBloomBlurRTQuater;
-		break;
 	case RenderTarget::COLOR_OUTPUT_MSAA:
 		return mColorBufferMSAA;
 		break;
-	case RenderTarget::BLOOM_RES:
-		return mBloomRes;
-		break;
 	default:
 		return nullptr;
 		break;
@@ -95,44 +55,131 @@ std::shared_ptr<class Renderer::CmdManager> Renderer::RendererContext::GetCmdMan
 	return mCmdManager;
 }
 
-void Renderer::RendererContext::LoadStaticMeshToGpu(ECS::StaticMeshComponent& InComponent)
+void Renderer::RendererContext::LoadStaticMeshToGpu(ECS::StaticMeshComponent& InComponent, ECS::StaticMeshAsset& InAsset)
 {
-	auto& vertices = InComponent.mVertices;
-	auto& indices = InComponent.mIndices;
-	InComponent.BaseVertexLocation = GetVertexBufferCpu()->GetOffset();
-	InComponent.StartIndexLocation = GetIndexBufferCpu()->GetOffset();
-	UpdateDataToVertexBuffer(vertices);
-	UpdateDataToIndexBuffer(indices);
+	auto& vertices = InAsset.mVertices;
+	auto& indices = InAsset.mIndices;
+	Expects(!InComponent.mGeometryResident && !vertices.empty() && !indices.empty());
+	const bool l16Bit = Uses16BitIndices(vertices.size());
+	std::vector<uint16_t> lIndices16;
+	if (l16Bit)
+	{
+		lIndices16.assign(indices.begin(), indices.end());
+	}
+	{
+		//A pool may grow and swap its buffer,staging targets the buffer current at allocation.
+		std::lock_guard lock(mGeometryMutex);
+		auto& lIndexPool = l16Bit ? *mIndexPool16 : *mIndexPool;
+		const uint32_t lVertexOffset = mVertexPool->Allocate((uint32_t)vertices.size());
+		const uint32_t lIndexOffset = lIndexPool.Allocate((uint32_t)indices.size());
+		mVertexPool->Upload(lVertexOffset, vertices.data(), (uint32_t)vertices.size());
+		lIndexPool.Upload(lIndexOffset, l16Bit ? (const void*)lIndices16.data() : indices.data(), (uint32_t)indices.size());
+		InComponent.BaseVertexLocation = (int32_t)lVertexOffset;
+		InComponent.StartIndexLocation = lIndexOffset;
+	}
+	InComponent.m16BitIndices = l16Bit;
+	InComponent.mGeometryResident = true;
+	if (AssetLoader::gAssetRegistry->GetMeshes().AddRef(InComponent.mMesh, AssetLoader::Residency::GPU))
+	{
+		std::lock_guard lock(mGpuMeshMutex);
+		mGpuMeshes.push_back(InComponent.mMesh);
+	}
 }
 
-std::shared_ptr<Renderer::Resource::DepthBuffer> Renderer::RendererContext::GetDepthBuffer()
+void Renderer::RendererContext::ReserveGeometry(const GeometryDemand& InDemand)
 {
-	return mDepthBuffer;
+	std::lock_guard lock(mGeometryMutex);
+	mVertexPool->Reserve(InDemand.mVertices);
+	mIndexPool->Reserve(InDemand.mIndices);
+	mIndexPool16->Reserve(InDemand.mIndices16);
 }
 
-std::shared_ptr<Renderer::Resource::DepthBuffer> Renderer::RendererContext::GetShadowMap()
+void Renderer::RendererContext::FlushUploads()
 {
-	return mShadowMap;
+	mUploader->Flush();
 }
 
-std::shared_ptr<Renderer::Resource::VertexBuffer> Renderer::RendererContext::GetVertexBuffer()
+Renderer::StagingStats Renderer::RendererContext::GetUploadStats()
 {
-	return mVertexBuffer;
+	return mUploader->GetStats();
 }
 
-std::shared_ptr<Renderer::Resource::VertexBuffer> Renderer::RendererContext::GetIndexBuffer()
+void Renderer::RendererContext::ReleaseStaticMesh(ECS::StaticMeshComponent& InComponent, uint64_t InReleaseAfter)
 {
-	return mIndexBuffer;
+	if (InComponent.mGeometryResident)
+	{
+		std::lock_guard lock(mGeometryMutex);
+		mVertexPool->Free((uint32_t)InComponent.BaseVertexLocation, InReleaseAfter);
+		(InComponent.m16BitIndices ? mIndexPool16 : mIndexPool)->Free(InComponent.StartIndexLocation, InReleaseAfter);
+		InComponent.mGeometryResident = false;
+	}
+	{
+		std::lock_guard lock(mGpuMeshMutex);
+		auto lMesh = std::find(mGpuMeshes.begin(), mGpuMeshes.end(), InComponent.mMesh);
+		if (lMesh == mGpuMeshes.end())
+		{
+			return;
+		}
+		*lMesh = mGpuMeshes.back();
+		mGpuMeshes.pop_back();
+	}
+	AssetLoader::gAssetRegistry->GetMeshes().Release(InComponent.mMesh, AssetLoader::Residency::GPU);
+}
+
+void Renderer::RendererContext::ReleaseRetiredGeometry(uint64_t InFrame)
+{
+	std::lock_guard lock(mGeometryMutex);
+	mVertexPool->ReleaseRetired(InFrame);
+	mIndexPool->ReleaseRetired(InFrame);
+	mIndexPool16->ReleaseRetired(InFrame);
+}
+
+Renderer::GeometryRelocations Renderer::RendererContext::DefragmentGeometry(uint32_t InMaxMoves, uint64_t InReleaseAfter)
+{
+	GeometryRelocations lRelocations;
+	{
+		std::lock_guard lock(mGeometryMutex);
+		lRelocations.mVertices = mVertexPool->Defragment(InMaxMoves, InReleaseAfter);
+		lRelocations.mIndices = mIndexPool->Defragment(InMaxMoves, InReleaseAfter);
+		lRelocations.mIndices16 = mIndexPool16->Defragment(InMaxMoves, InReleaseAfter);
+	}
+	//The new ranges have to hold the geometry before any frame draws from them.
+	FlushUploads();
+	return lRelocations;
 }
 
-std::shared_ptr<Renderer::VertexBufferRenderer<Renderer::Vertex>> Renderer::RendererContext::GetVertexBufferCpu()
+D3D12_VERTEX_BUFFER_VIEW Renderer::RendererContext::GetVertexBufferView()
 {
-	return mVertexBufferCpu;
+	std::lock_guard lock(mGeometryMutex);
+	return mVertexPool->GetVertexBufferView();
 }
 
-std::shared_ptr<Renderer::VertexBufferRenderer<uint32_t>> Renderer::RendererContext::GetIndexBufferCpu()
+D3D12_INDEX_BUFFER_VIEW Renderer::RendererContext::GetIndexBufferView(bool In16Bit)
 {
-	return mIndexBufferCpu;
+	std::lock_guard lock(mGeometryMutex);
+	return (In16Bit ? mIndexPool16 : mIndexPool)->GetIndexBufferView();
+}
+
+Renderer::GeometryPoolStats Renderer::RendererContext::GetVertexStats()
+{
+	std::lock_guard lock(mGeometryMutex);
+	return mVertexPool->GetStats();
+}
+
+Renderer::GeometryPoolStats Renderer::RendererContext::GetIndexStats(bool In16Bit)
+{
+	std::lock_guard lock(mGeometryMutex);
+	return (In16Bit ? mIndexPool16 : mIndexPool)->GetStats();
+}
+
+std::shared_ptr<Renderer::Resource::DepthBuffer> Renderer::RendererContext::GetDepthBuffer()
+{
+	return mDepthBuffer;
+}
+
+std::shared_ptr<Renderer::Resource::DepthBuffer> Renderer::RendererContext::GetShadowMap()
+{
+	return mShadowMap;
 }
 
 void Renderer::RendererContext::CreateShadowMap(int InShadowMapWidth, int InShadowMapHeight)
@@ -147,68 +194,3 @@ void Renderer::RendererContext::CreateColorBuffer(int InShadowMapWidth, int InSh
 	mColorBufferMSAA->SetMsaaMode(MSAA_8X);
 	mColorBufferMSAA->Create(L"ColorBufferMSAA", mWindowWidth, mWindowHeight, 1, DXGI_FORMAT_R16G16B16A16_FLOAT);
 }
-
-void Renderer::RendererContext::UploadDataToResource(
-	ID3D12Resource* InDestResource,
-	const void* data,
-	uint64_t size,
-	uint64_t InDestOffset)
-{
-	if (mCopyQueueUploadResourceSize < size)
-	{
-		if (mCopyQueueUploadResource)
-		{
-			mCopyQueueUploadResource->Release();
-			mCopyQueueUploadResource = nullptr;
-		}
-		DirectX::CreateUploadBuffer(g_Device, data, size, 1, &mCopyQueueUploadResource);
-		mCopyQueueUploadResourceSize = size;
-	}
-	ID3D12CommandAllocator* copyCmdAllocator = mCmdManager->RequestAllocator(D3D12_COMMAND_LIST_TYPE_COPY, mCopyFenceValue);
-	mCopyCmd->Reset(copyCmdAllocator, nullptr);
-	void* Memory;
-	auto range = CD3DX12_RANGE(0, size);
-	mCopyQueueUploadResource->Map(0, &range, &Memory);
-	memcpy(Memory, data, size);
-	mCopyQueueUploadResource->Unmap(0, &range);
-	mCopyCmd->CopyBufferRegion(InDestResource, InDestOffset, mCopyQueueUploadResource, 0, size);
-
-	ID3D12CommandList* cmds[] = { mCopyCmd };
-	mCmdManager->GetQueue(D3D12_COMMAND_LIST_TYPE_COPY)->ExecuteCommandLists(1, cmds);
-	mCmdManager->Discard(D3D12_COMMAND_LIST_TYPE_COPY, copyCmdAllocator, mCopyFenceValue);
-	mCopyFenceValue++;
-}
-
-template<typename T>
-void Renderer::RendererContext::UploadDataToResource(ID3D12Resource* InDestResource, std::span<T> InData, std::shared_ptr<VertexBufferRenderer<T>> InCpuResource)
-{
-	void* data = InData.data();
-	uint64_t size = InData.size_bytes();
-	if (mCopyQueueUploadResourceSize < size)
-	{
-		if (mCopyQueueUploadResource)
-		{
-			mCopyQueueUploadResource->Release();
-			mCopyQueueUploadResource = nullptr;
-		}
-		DirectX::CreateUploadBuffer(g_Device, data, size, 1, &mCopyQueueUploadResource);
-		mCopyQueueUploadResourceSize = size;
-	}
-	ID3D12CommandAllocator* copyCmdAllocator = mCmdManager->RequestAllocator(D3D12_COMMAND_LIST_TYPE_COPY, mCopyFenceValue);
-	mCopyCmd->Reset(copyCmdAllocator, nullptr);
-	void* Memory;
-	auto range = CD3DX12_RANGE(0, size);
-	mCopyQueueUploadResource->Map(0, &range, &Memory);
-	memcpy(Memory, data, size);
-	mCopyQueueUploadResource->Unmap(0, &range);
-	mCopyCmd->CopyBufferRegion(InDestResource, InCpuResource->GetOffsetBytes(), mCopyQueueUploadResource, 0, size);
-	mCopyCmd->Close();
-	ID3D12CommandList* cmds[] = { mCopyCmd };
-	mCmdManager->GetQueue(D3D12_COMMAND_LIST_TYPE_COPY)->ExecuteCommandLists(1, cmds);
-	mCmdManager->GetQueue(D3D12_COMMAND_LIST_TYPE_COPY)->Signal(mCopyFence, mCopyFenceValue);
-	mCopyFence->SetEventOnCompletion(mCopyFenceValue, mCopyFenceHandle);
-	WaitForSingleObject(mCopyFenceHandle, INFINITE);
-	mCmdManager->Discard(D3D12_COMMAND_LIST_TYPE_COPY, copyCmdAllocator, mCopyFenceValue);
-	mCopyFenceValue++;
-	InCpuResource->UpdataDataOffset(InData);
-}
@@ -1,6 +1,8 @@
 #pragma once
 #include "BufferHelpers.h"
 #include "components.h"
+#include "staging_ring.h"
+#include "geometry_pool.h"
 
 
 namespace Renderer
@@ -14,29 +16,17 @@ namespace Renderer
 		class ColorBuffer;
 	}
 
-	template<typename T>
-	struct VertexBufferRenderer
+	//Allocations DefragmentGeometry moved,components drawing from a mFrom have to switch to its mTo.
+	struct GeometryRelocations
 	{
-		uint64_t GetOffset() { return mOffset; }
-		uint64_t GetOffsetBytes() { return mOffsetBytes; }
-
-		void UpdataDataOffset(std::span<T> InData)
-		{
-			mOffset += InData.size();
-			mOffsetBytes += InData.size_bytes();
-		};
-	private:
-		uint64_t mOffset = 0;
-		uint64_t mOffsetBytes = 0;
+		std::vector<GeometryMove> mVertices;
+		std::vector<GeometryMove> mIndices;
+		std::vector<GeometryMove> mIndices16;
 	};
 
 	enum class RenderTarget
 	{
-		COLOR_OUTPUT_MSAA,
-		COLOR_OUTPUT_RESOLVED,
-		BLOOM_RES,
-		BLUR_HALF,
-		BLUR_QUAT
+		COLOR_OUTPUT_MSAA
 	};
 
 	class RendererContext
@@ -47,27 +37,36 @@ namespace Renderer
 		//Getters
 		std::shared_ptr<Resource::DepthBuffer> GetDepthBuffer();
 		std::shared_ptr<Resource::DepthBuffer> GetShadowMap();
-		std::shared_ptr<Resource::VertexBuffer> GetVertexBuffer();
-		std::shared_ptr<Resource::VertexBuffer> GetIndexBuffer();
-		std::shared_ptr<VertexBufferRenderer<Vertex>> GetVertexBufferCpu();
-		std::shared_ptr<VertexBufferRenderer<uint32_t>> GetIndexBufferCpu();
+		//Views of the current pool buffers,a frame binds them once and they stay valid while it is in flight.
+		D3D12_VERTEX_BUFFER_VIEW GetVertexBufferView();
+		D3D12_INDEX_BUFFER_VIEW GetIndexBufferView(bool In16Bit);
+		GeometryPoolStats GetVertexStats();
+		GeometryPoolStats GetIndexStats(bool In16Bit);
 		void CreateWindowDependentResource(int InWindowWidth, int InWindowHeight);
-		void UpdateDataToVertexBuffer(std::span<Vertex> InData);
-		void UpdateDataToIndexBuffer(std::span<uint32_t> InData);
 		//std::shared_ptr<Resource::ColorBuffer> GetColorBuffer();
 		//std::shared_ptr<Resource::ColorBuffer> GetColorAttachment0();
 		std::shared_ptr<Resource::ColorBuffer> GetRenderTarget(RenderTarget InTarget);
 		std::shared_ptr<class CmdManager> GetCmdManager();
-		void LoadStaticMeshToGpu(ECS::StaticMeshComponent& InComponent);
-	private:
-		template<typename T>
-		void UploadDataToResource(ID3D12Resource* InDestResource, std::span<T> InData, std::shared_ptr<VertexBufferRenderer<T>> InCpuResource);
-		void UploadDataToResource(ID3D12Resource* InDestResource, const void* data, uint64_t size, uint64_t InDestOffset);
+		//Staged only,call FlushUploads before the GPU may read the mesh.Safe from any thread.
+		void LoadStaticMeshToGpu(ECS::StaticMeshComponent& InComponent, ECS::StaticMeshAsset& InAsset);
+		//Grow the pools once for a batch of meshes instead of step by step while loading it.
+		void ReserveGeometry(const GeometryDemand& InDemand);
+		//Submit the staged geometry and wait until it landed,once per batch of meshes.
+		void FlushUploads();
+		StagingStats GetUploadStats();
+		//Drop the GPU reference taken by LoadStaticMeshToGpu,its vertex and index ranges are reused once
+		//ReleaseRetiredGeometry reaches InReleaseAfter.
+		void ReleaseStaticMesh(ECS::StaticMeshComponent& InComponent, uint64_t InReleaseAfter);
+		//Free the ranges retired up to InFrame.
+		void ReleaseRetiredGeometry(uint64_t InFrame);
+		//Copy up to InMaxMoves allocations per buffer into lower holes on the copy queue and wait for the copies.
+		//The old ranges stay valid until InReleaseAfter,the caller points the components at the new ones before that.
+		GeometryRelocations DefragmentGeometry(uint32_t InMaxMoves, uint64_t InReleaseAfter);
 	private:
-		std::shared_ptr<Resource::VertexBuffer> mVertexBuffer;
-		std::shared_ptr<Resource::VertexBuffer> mIndexBuffer;
-		std::shared_ptr<VertexBufferRenderer<Vertex>> mVertexBufferCpu;
-		std::shared_ptr<VertexBufferRenderer<uint32_t>> mIndexBufferCpu;
+		//Created after mUploader,they stage through it.
+		std::unique_ptr<GeometryPool> mVertexPool;
+		std::unique_ptr<GeometryPool> mIndexPool;
+		std::unique_ptr<GeometryPool> mIndexPool16;
 		std::shared_ptr<Resource::DepthBuffer> mDepthBuffer;
 		std::shared_ptr<Resource::DepthBuffer> mShadowMap;
 		std::shared_ptr<Resource::ColorBuffer> mColorBufferMSAA;
@@ -75,21 +74,15 @@ namespace Renderer
 		void CreateColorBuffer(int InShadowMapWidth, int InShadowMapHeight);
 		int mWindowHeight;
 		int mWindowWidth;
-		uint64_t mCopyFenceValue;
-		ID3D12Fence* mCopyFence;
-		HANDLE mCopyFenceHandle;
-		ID3D12GraphicsCommandList* mCopyCmd;
-		ID3D12Resource* mCopyQueueUploadResource = nullptr;
-		uint64_t mCopyQueueUploadResourceSize = 0;
 		std::shared_ptr<class CmdManager> mCmdManager;
+		std::unique_ptr<StagingUploader> mUploader;
+		//Guards the pools,loads run on worker threads.
+		std::mutex mGeometryMutex;
 		enum 
 		{
 			MSAA_8X = 8,
 		};
-		std::shared_ptr<Resource::ColorBuffer> mColorAttachmentResolved;
-		std::shared_ptr<Resource::ColorBuffer> mBloomBlurRTHalf;
-		std::shared_ptr<Resource::ColorBuffer> mBloomBlurRTQuater;
-		std::shared_ptr<Resource::ColorBuffer> mBloomRes;
-
+		std::mutex mGpuMeshMutex;
+		std::vector<ECS::MeshHandle> mGpuMeshes;
 	};
 }
\ No newline at end of file
@@ -7,18 +7,25 @@ constexpr uint64_t GB = 1 << 30;
 constexpr uint64_t MB = 1 << 20;
 enum
 {
-	VERTEX_BUFFER_SIZE = 1 * GB,//1GB
 	MESHLET_SIZE = 100 * MB,//100MB
 	VERTEX_SIZE = 500 * MB,//500MB
 	INDEX_SIZE = 200 * MB,//200MB
 	PRIMITIVE_SIZE = 200 * MB,//200MB
+	//One MeshletCullBounds per meshlet slot,200MB
+	MESHLET_BOUNDS_SIZE = MESHLET_SIZE / sizeof(DirectX::Meshlet) * sizeof(Renderer::MeshletCullBounds),
+	//All of the above
+	VERTEX_BUFFER_SIZE = MESHLET_SIZE + VERTEX_SIZE + INDEX_SIZE + PRIMITIVE_SIZE + MESHLET_BOUNDS_SIZE,
 };
 
 struct Vertex {
 	std::array<float, 3> position;
 };
 
-Renderer::DXRRenderer::DXRRenderer()
+Renderer::DXRRenderer::DXRRenderer():
+	mMeshletAllocator(uint32_t(MESHLET_SIZE / sizeof(DirectX::Meshlet))),
+	mMeshletVertexAllocator(uint32_t(VERTEX_SIZE / sizeof(Renderer::Vertex))),
+	mMeshletPrimitiveAllocator(uint32_t(PRIMITIVE_SIZE / sizeof(DirectX::MeshletTriangle))),
+	mMeshletIndexAllocator(uint32_t(INDEX_SIZE / sizeof(uint32_t)))
 {
 	D3D12_FEATURE_DATA_D3D12_OPTIONS5 options5 = {};
 	Ensures(g_Device->CheckFeatureSupport(D3D12_FEATURE_D3D12_OPTIONS5,
@@ -31,7 +38,7 @@ Renderer::DXRRenderer::DXRRenderer()
 
 Renderer::DXRRenderer::~DXRRenderer()
 {
-
+	mDeviceManager->WaitForIdle();
 }
 
 void Renderer::DXRRenderer::SetTargetWindowAndCreateSwapChain(HWND InWindow, int InWidth, int InHeight)
@@ -62,12 +69,16 @@ void Renderer::DXRRenderer::LoadGameScene(std::shared_ptr<GAS::GameScene> InGame
 
 void Renderer::DXRRenderer::Update(float delta)
 {
-	
+	if (mCurrentScene)
+	{
+		mCurrentScene->SetStreamingFocus(mDefaultCamera->GetEye());
+		mCurrentScene->Update(delta);
+	}
+	BeginFrame();
 	UpdataFrameData();
-	mDeviceManager->BeginFrame();
 	auto lCurrentFrameIndex = mDeviceManager->GetCurrentFrameIndex();
-	auto frameDataIndex = lCurrentFrameIndex % SWAP_CHAIN_BUFFER_COUNT;
-	ID3D12CommandAllocator* lCmdAllocator =  mCmdManager->RequestAllocator(D3D12_COMMAND_LIST_TYPE_DIRECT, mGraphicsFenceValue);
+	auto frameDataIndex = mDeviceManager->GetFrameSlot();
+	ID3D12CommandAllocator* lCmdAllocator =  mCmdManager->RequestAllocator(D3D12_COMMAND_LIST_TYPE_DIRECT, mDeviceManager->GetTimeline(D3D12_COMMAND_LIST_TYPE_DIRECT).GetCompletedValue());
 	mGraphicsCmd->Reset(lCmdAllocator, nullptr);
 	TransitState(mGraphicsCmd, g_DisplayPlane[lCurrentFrameIndex].GetResource(), D3D12_RESOURCE_STATE_PRESENT, D3D12_RESOURCE_STATE_RENDER_TARGET);
 	mGraphicsCmd->OMSetRenderTargets(1, &g_DisplayPlane[lCurrentFrameIndex].GetRTV(), true, &mDepthBuffer->GetDSV());
@@ -78,6 +89,7 @@ void Renderer::DXRRenderer::Update(float delta)
 	mGraphicsCmd->SetDescriptorHeaps((UINT)heaps.size(), heaps.data());
 	mGraphicsCmd->RSSetViewports(1, &mViewPort);
 	mGraphicsCmd->RSSetScissorRects(1, &mRect);
+	PrepareMeshletCull(frameDataIndex);
 	mMeshShaderPass->RenderScene(mGraphicsCmd);
 
 	mGraphicsCmd->SetGraphicsRootDescriptorTable(0, mMeshletsBuffer.mSRVGpu);
@@ -92,29 +104,7 @@ void Renderer::DXRRenderer::Update(float delta)
 		D3D12_RESOURCE_STATE_VERTEX_AND_CONSTANT_BUFFER);
 	mGraphicsCmd->SetGraphicsRootConstantBufferView(MESH_FRAME_DATA_ROOT_PARAMETER_INDEX, mFrameDataGPU[frameDataIndex]->RootConstantBufferView());
 
-	entt::registry& sceneRegistery = mCurrentScene->GetRegistery();
-	auto allStaticMeshComponents = sceneRegistery.view<ECS::StaticMeshComponent, ECS::TransformComponent>();
-	constexpr int matrixSizeNum32Bits = sizeof(DirectX::SimpleMath::Matrix) / 4;
-	allStaticMeshComponents.each([this](auto entity, ECS::StaticMeshComponent& renderComponent, ECS::TransformComponent& transformComponent) {
-		//Dispatch meshlets
-		MeshShaderConstants meshConstants;
-		meshConstants.mModelMatrix = transformComponent.GetModelMatrix();
-		meshConstants.mMeshOffsets = renderComponent.mMeshOffsetWithinScene;
-		mGraphicsCmd->SetGraphicsRoot32BitConstants(MESH_CONSTANTS_ROOT_PARAMETER_INDEX, matrixSizeNum32Bits, &meshConstants, 0);
-		constexpr uint32_t meshletsPerGroup = 1;
-		constexpr uint32_t maxThreadGroups = 128;
-		ID3D12GraphicsCommandList6* meshCmd = static_cast<ID3D12GraphicsCommandList6*>(mGraphicsCmd);
-		int i = 0;
-		for (auto& meshlet : renderComponent.mMeshlets)
-		{
-			meshConstants.mMeshOffsets.MeshletOffset = renderComponent.mMeshOffsetWithinScene.MeshletOffset + i * MAX_MESHLET_PER_THREAD_GROUP;
-			constexpr int offsetDatToSetIn32Bits = MESH_CONSTANTS_32BITS_NUM - matrixSizeNum32Bits;
-			mGraphicsCmd->SetGraphicsRoot32BitConstants(MESH_CONSTANTS_ROOT_PARAMETER_INDEX, offsetDatToSetIn32Bits, &meshConstants.mMeshOffsets.MeshletOffset, matrixSizeNum32Bits);
-			//meshCmd->DispatchMesh(MAX_MESHLET_PER_THREAD_GROUP, 1, 1);
-			meshCmd->DispatchMesh(1, 1, 1);
-			i++;
-		}
-		});
+	RecordMeshletDraws(frameDataIndex);
 	
 	//Gui
 	mGui->BeginGui();
@@ -125,17 +115,46 @@ void Renderer::DXRRenderer::Update(float delta)
 	mGraphicsCmd->Close();
 	ID3D12CommandList* lCmdLists = { mGraphicsCmd };
 	mCmdManager->GetQueue(D3D12_COMMAND_LIST_TYPE_DIRECT)->ExecuteCommandLists(1,&lCmdLists);
-	mCmdManager->Discard(D3D12_COMMAND_LIST_TYPE_DIRECT, lCmdAllocator, mGraphicsFenceValue);
-	mGraphicsFenceValue++;
-	mDeviceManager->EndFrame();
+	mCmdManager->Discard(D3D12_COMMAND_LIST_TYPE_DIRECT, lCmdAllocator, mDeviceManager->EndFrame());
+}
+
+void Renderer::DXRRenderer::MeshShaderNewStaticmeshComponent(ECS::StaticMeshComponent& InStaticMeshComponent, ECS::StaticMeshAsset& InAsset)
+{
+	mLoadResourceFuture = std::async(std::launch::async, [this, &InStaticMeshComponent, &InAsset]()
+		{
+			InAsset.ConvertToMeshlets(64, 126);
+			UpdateScene(InStaticMeshComponent, InAsset);
+		});
+}
+
+void Renderer::DXRRenderer::MeshShaderReleaseStaticmeshComponent(ECS::StaticMeshComponent& InStaticMeshComponent, uint64_t InReleaseAfter)
+{
+	std::lock_guard<std::mutex> lock(mLoadResourceMutex);
+	if (!InStaticMeshComponent.mMeshletsResident)
+	{
+		return;
+	}
+	mRetiredMeshlets.push_back({ InReleaseAfter, InStaticMeshComponent.mMeshOffsetWithinScene });
+	InStaticMeshComponent.mMeshletsResident = false;
 }
 
-void Renderer::DXRRenderer::MeshShaderNewStaticmeshComponent(ECS::StaticMeshComponent& InStaticMeshComponent)
+void Renderer::DXRRenderer::ReleaseRetiredResources()
 {
-	mLoadResourceFuture = std::async(std::launch::async, [this, &InStaticMeshComponent]()
+	BaseRenderer::ReleaseRetiredResources();
+	std::erase_if(mRetiredMeshletCullRings, [this](const RetiredMeshletCullRing& InRetired) { return InRetired.mReleaseAfter <= mRetireFrame; });
+	std::lock_guard<std::mutex> lock(mLoadResourceMutex);
+	std::erase_if(mRetiredMeshlets, [this](const RetiredMeshlets& InRetired)
 		{
-			InStaticMeshComponent.ConvertToMeshlets(64, 126);
-			UpdateScene(InStaticMeshComponent);
+			if (InRetired.mReleaseAfter > mRetireFrame)
+			{
+				return false;
+			}
+			mMeshletCullReference.RemoveMesh(InRetired.mOffsets.MeshletOffset);
+			mMeshletAllocator.Free(InRetired.mOffsets.MeshletOffset);
+			mMeshletVertexAllocator.Free(InRetired.mOffsets.VertexOffset);
+			mMeshletPrimitiveAllocator.Free(InRetired.mOffsets.PrimitiveOffset);
+			mMeshletIndexAllocator.Free(InRetired.mOffsets.IndexOffset);
+			return true;
 		});
 }
 
@@ -176,6 +195,18 @@ void Renderer::DXRRenderer::CreateBuffers()
 		offset,
 		&lBufferDesc,
 		D3D12_RESOURCE_STATE_GENERIC_READ, nullptr, IID_PPV_ARGS(&mMeshletsPrimitivesBuffer.mBuffer));
+	offset += PRIMITIVE_SIZE;
+	lBufferDesc = CD3DX12_RESOURCE_DESC::Buffer(MESHLET_BOUNDS_SIZE);
+	g_Device->CreatePlacedResource(
+		mMasterHeap,
+		offset,
+		&lBufferDesc,
+		D3D12_RESOURCE_STATE_GENERIC_READ, nullptr, IID_PPV_ARGS(&mMeshletBoundsBuffer));
+
+	mMeshletCullCounts = std::make_unique<Resource::ByteAddressBuffer>();
+	mMeshletCullCounts->Create(L"MeshletCullCounts", sizeof(MeshletCullCounts) / sizeof(uint32_t), sizeof(uint32_t));
+	mMeshletCullReadback = std::make_unique<Resource::ReadbackBuffer>();
+	mMeshletCullReadback->Create(L"MeshletCullReadback", sizeof(MeshletCullCounts) * SWAP_CHAIN_BUFFER_COUNT);
 
 	// Create SRVs for the buffers
 	D3D12_SHADER_RESOURCE_VIEW_DESC srvDesc = {};
@@ -225,16 +256,22 @@ void Renderer::DXRRenderer::CreateBuffers()
 	}
 }
 
-HRESULT Renderer::DXRRenderer::UpdateScene(ECS::StaticMeshComponent& InStaticMeshComponent)
+HRESULT Renderer::DXRRenderer::UpdateScene(ECS::StaticMeshComponent& InStaticMeshComponent, ECS::StaticMeshAsset& InAsset)
 {
 	std::lock_guard<std::mutex> lock(mLoadResourceMutex);
 
-	InStaticMeshComponent.mMeshOffsetWithinScene = mCurrentMeshOffsets;
-
-	mCurrentMeshOffsets.MeshletOffset += InStaticMeshComponent.mMeshlets.size() * MAX_MESHLET_PER_THREAD_GROUP;
-	mCurrentMeshOffsets.VertexOffset += InStaticMeshComponent.mVertices.size();
-	mCurrentMeshOffsets.PrimitiveOffset += InStaticMeshComponent.mMeshletPrimditives.size();
-	mCurrentMeshOffsets.IndexOffset += InStaticMeshComponent.mMeshletsIndices.size();
+	auto& lOffsets = InStaticMeshComponent.mMeshOffsetWithinScene;
+	lOffsets.MeshletOffset = mMeshletAllocator.Allocate(uint32_t(InAsset.mMeshlets.size() * MAX_MESHLET_PER_THREAD_GROUP));
+	lOffsets.VertexOffset = mMeshletVertexAllocator.Allocate((uint32_t)InAsset.mVertices.size());
+	lOffsets.PrimitiveOffset = mMeshletPrimitiveAllocator.Allocate((uint32_t)InAsset.mMeshletPrimditives.size());
+	lOffsets.IndexOffset = mMeshletIndexAllocator.Allocate((uint32_t)InAsset.mMeshletsIndices.size());
+	Ensures(lOffsets.MeshletOffset != GeometryAllocator::INVALID_OFFSET && lOffsets.VertexOffset != GeometryAllocator::INVALID_OFFSET &&
+		lOffsets.PrimitiveOffset != GeometryAllocator::INVALID_OFFSET && lOffsets.IndexOffset != GeometryAllocator::INVALID_OFFSET);
+	std::vector<MeshletCullBounds> lBounds(InAsset.mMeshletCullData.size());
+	std::transform(InAsset.mMeshletCullData.begin(), InAsset.mMeshletCullData.end(), lBounds.begin(), MeshletCullReference::MakeBounds);
+	mMeshletCullReference.AddMesh(lOffsets.MeshletOffset, lBounds);
+	InStaticMeshComponent.mMeshletCount = (uint32_t)lBounds.size();
+	InStaticMeshComponent.mMeshletsResident = true;
 
 	// Create committed resources for meshlets, vertices, indices, and primitives
 	DirectX::ResourceUploadBatch resourceUpload(g_Device);
@@ -244,35 +281,38 @@ HRESULT Renderer::DXRRenderer::UpdateScene(ECS::StaticMeshComponent& InStaticMes
 	resourceUpload.Transition(mMeshletsVerticesBuffer.mBuffer, D3D12_RESOURCE_STATE_GENERIC_READ, D3D12_RESOURCE_STATE_COPY_DEST);
 	resourceUpload.Transition(mMeshletsIndicesBuffer.mBuffer, D3D12_RESOURCE_STATE_GENERIC_READ, D3D12_RESOURCE_STATE_COPY_DEST);
 	resourceUpload.Transition(mMeshletsPrimitivesBuffer.mBuffer, D3D12_RESOURCE_STATE_GENERIC_READ, D3D12_RESOURCE_STATE_COPY_DEST);
+	resourceUpload.Transition(mMeshletBoundsBuffer, D3D12_RESOURCE_STATE_GENERIC_READ, D3D12_RESOURCE_STATE_COPY_DEST);
 	
-	int dataSize = InStaticMeshComponent.mMeshlets.size() * MAX_MESHLET_PER_THREAD_GROUP * sizeof(DirectX::Meshlet);
+	int dataSize = InAsset.mMeshlets.size() * MAX_MESHLET_PER_THREAD_GROUP * sizeof(DirectX::Meshlet);
 	UpdateMeshShaderResource(mMeshletsBuffer.mBuffer, 
-		InStaticMeshComponent.mMeshlets.data(),dataSize,
-		mMeshletsBuffer.mBufferOffsetInByte);
-	mMeshletsBuffer.mBufferOffsetInByte += dataSize;
+		InAsset.mMeshlets.data(),dataSize,
+		lOffsets.MeshletOffset * sizeof(DirectX::Meshlet));
 
-	dataSize = InStaticMeshComponent.mVertices.size() * sizeof(Renderer::Vertex);
+	dataSize = InAsset.mVertices.size() * sizeof(Renderer::Vertex);
 	UpdateMeshShaderResource(mMeshletsVerticesBuffer.mBuffer, 
-		InStaticMeshComponent.mVertices.data(),dataSize,
-		mMeshletsVerticesBuffer.mBufferOffsetInByte);
-	mMeshletsVerticesBuffer.mBufferOffsetInByte += dataSize;
+		InAsset.mVertices.data(),dataSize,
+		lOffsets.VertexOffset * sizeof(Renderer::Vertex));
 
-	dataSize = InStaticMeshComponent.mMeshletsIndices.size() * sizeof(uint32_t);
+	dataSize = InAsset.mMeshletsIndices.size() * sizeof(uint32_t);
 	UpdateMeshShaderResource(mMeshletsIndicesBuffer.mBuffer, 
-		InStaticMeshComponent.mMeshletsIndices.data(),dataSize,
-		mMeshletsIndicesBuffer.mBufferOffsetInByte);
-	mMeshletsIndicesBuffer.mBufferOffsetInByte += dataSize;
+		InAsset.mMeshletsIndices.data(),dataSize,
+		lOffsets.IndexOffset * sizeof(uint32_t));
 
-	dataSize = InStaticMeshComponent.mMeshletPrimditives.size() * sizeof(DirectX::MeshletTriangle);
+	dataSize = InAsset.mMeshletPrimditives.size() * sizeof(DirectX::MeshletTriangle);
 	UpdateMeshShaderResource(mMeshletsPrimitivesBuffer.mBuffer, 
-		InStaticMeshComponent.mMeshletPrimditives.data(),dataSize,
-		mMeshletsPrimitivesBuffer.mBufferOffsetInByte);
-	mMeshletsPrimitivesBuffer.mBufferOffsetInByte += dataSize;
+		InAsset.mMeshletPrimditives.data(),dataSize,
+		lOffsets.PrimitiveOffset * sizeof(DirectX::MeshletTriangle));
+
+	dataSize = lBounds.size() * sizeof(MeshletCullBounds);
+	UpdateMeshShaderResource(mMeshletBoundsBuffer, 
+		lBounds.data(),dataSize,
+		lOffsets.MeshletOffset * sizeof(MeshletCullBounds));
 
 	resourceUpload.Transition(mMeshletsBuffer.mBuffer, D3D12_RESOURCE_STATE_COPY_DEST,D3D12_RESOURCE_STATE_GENERIC_READ);
 	resourceUpload.Transition(mMeshletsVerticesBuffer.mBuffer, D3D12_RESOURCE_STATE_COPY_DEST, D3D12_RESOURCE_STATE_GENERIC_READ);
 	resourceUpload.Transition(mMeshletsIndicesBuffer.mBuffer, D3D12_RESOURCE_STATE_COPY_DEST, D3D12_RESOURCE_STATE_GENERIC_READ);
 	resourceUpload.Transition(mMeshletsPrimitivesBuffer.mBuffer, D3D12_RESOURCE_STATE_COPY_DEST, D3D12_RESOURCE_STATE_GENERIC_READ);
+	resourceUpload.Transition(mMeshletBoundsBuffer, D3D12_RESOURCE_STATE_COPY_DEST, D3D12_RESOURCE_STATE_GENERIC_READ);
 
 	// End the upload process and wait for it to complete
 	auto uploadFinished = resourceUpload.End(mCmdManager->GetQueue(D3D12_COMMAND_LIST_TYPE_DIRECT));
@@ -280,6 +320,121 @@ HRESULT Renderer::DXRRenderer::UpdateScene(ECS::StaticMeshComponent& InStaticMes
 	return S_OK;
 }
 
+void Renderer::DXRRenderer::PrepareMeshletCull(uint32_t InFrameIndex)
+{
+	//BeginFrame waited for the last frame of this slot.
+	ReadMeshletCullResults(InFrameIndex);
+
+	std::lock_guard<std::mutex> lock(mLoadResourceMutex);
+	mMeshletInstances.clear();
+	mMeshletGroups.clear();
+	if (mCurrentScene)
+	{
+		auto allStaticMeshComponents = mCurrentScene->GetRegistery().view<ECS::StaticMeshComponent, ECS::TransformComponent>();
+		allStaticMeshComponents.each([this](ECS::StaticMeshComponent& renderComponent, ECS::TransformComponent& transformComponent) {
+			if (!renderComponent.mMeshletsResident)
+			{
+				return;
+			}
+			const uint32_t lInstance = (uint32_t)mMeshletInstances.size();
+			const auto& lOffsets = renderComponent.mMeshOffsetWithinScene;
+			mMeshletInstances.push_back(MeshletCullReference::MakeInstance(transformComponent.GetModelMatrix(false), lOffsets));
+			for (uint32_t first = 0; first < renderComponent.mMeshletCount; first += MAX_MESHLET_PER_THREAD_GROUP)
+			{
+				mMeshletGroups.push_back({ lInstance, lOffsets.MeshletOffset + first, std::min(renderComponent.mMeshletCount - first, (uint32_t)MAX_MESHLET_PER_THREAD_GROUP), 0 });
+			}
+			});
+	}
+	EnsureMeshletCullCapacity((uint32_t)mMeshletInstances.size(), (uint32_t)mMeshletGroups.size());
+
+	uint32_t lFlags = mUseMeshletFrustumCulling ? MESHLET_CULL_FRUSTUM : 0;
+	lFlags |= mUseMeshletConeCulling ? MESHLET_CULL_CONE : 0;
+	lFlags |= mUseMeshletSizeCulling ? MESHLET_CULL_SMALL : 0;
+	const auto lConstants = MeshletCullReference::MakeConstants(mDefaultCamera->GetPrjView(false), mDefaultCamera->GetPrj(false),
+		mDefaultCamera->GetEye(), (float)mHeight, lFlags, mMeshletMinPixels);
+	uint8_t* lSlice = mMeshletCullUploadData + size_t(InFrameIndex) * GetMeshletCullSliceBytes();
+	memcpy(lSlice, &lConstants, sizeof(lConstants));
+	//Copied over the counts before the dispatches.
+	memset(lSlice + sizeof(lConstants), 0, sizeof(MeshletCullCounts));
+	memcpy(lSlice + MESHLET_CULL_HEADER_BYTES, mMeshletInstances.data(), mMeshletInstances.size() * sizeof(MeshletInstance));
+	memcpy(lSlice + MESHLET_CULL_HEADER_BYTES + size_t(mMeshletInstanceCapacity) * sizeof(MeshletInstance), mMeshletGroups.data(), mMeshletGroups.size() * sizeof(MeshletGroup));
+	mMeshletCullStats.mInstances = (uint32_t)mMeshletInstances.size();
+	mMeshletCullStats.mGroups = (uint32_t)mMeshletGroups.size();
+
+	auto& lPending = mPendingMeshletCull[InFrameIndex];
+	lPending.mValidate = mValidateMeshletCulling;
+	if (lPending.mValidate)
+	{
+		mMeshletCullReference.Cull(lConstants, mMeshletInstances, mMeshletGroups);
+		lPending.mExpected = mMeshletCullReference.GetCounts();
+	}
+}
+
+void Renderer::DXRRenderer::EnsureMeshletCullCapacity(uint32_t InInstances, uint32_t InGroups)
+{
+	if (mMeshletCullUploadRing && InInstances <= mMeshletInstanceCapacity && InGroups <= mMeshletGroupCapacity)
+	{
+		return;
+	}
+	if (mMeshletCullUploadRing)
+	{
+		mRetiredMeshletCullRings.push_back({ mRetireFrame + SWAP_CHAIN_BUFFER_COUNT, std::move(mMeshletCullUploadRing) });
+	}
+	mMeshletInstanceCapacity = std::max({ std::bit_ceil(InInstances), mMeshletInstanceCapacity, MIN_MESHLET_TABLE_SIZE });
+	mMeshletGroupCapacity = std::max({ std::bit_ceil(InGroups), mMeshletGroupCapacity, MIN_MESHLET_TABLE_SIZE });
+	mMeshletCullUploadRing = std::make_unique<Resource::UploadBuffer>();
+	mMeshletCullUploadRing->Create(L"MeshletCullUploadRing", GetMeshletCullSliceBytes() * SWAP_CHAIN_BUFFER_COUNT);
+	mMeshletCullUploadData = mMeshletCullUploadRing->MapPersistent();
+}
+
+size_t Renderer::DXRRenderer::GetMeshletCullSliceBytes() const
+{
+	const size_t lBytes = MESHLET_CULL_HEADER_BYTES + size_t(mMeshletInstanceCapacity) * sizeof(MeshletInstance) + size_t(mMeshletGroupCapacity) * sizeof(MeshletGroup);
+	//Every slice starts with a constant buffer.
+	return (lBytes + MESHLET_CULL_HEADER_BYTES - 1) / MESHLET_CULL_HEADER_BYTES * MESHLET_CULL_HEADER_BYTES;
+}
+
+void Renderer::DXRRenderer::RecordMeshletDraws(uint32_t InFrameIndex)
+{
+	const size_t lSliceOffset = size_t(InFrameIndex) * GetMeshletCullSliceBytes();
+	const D3D12_GPU_VIRTUAL_ADDRESS lSlice = mMeshletCullUploadRing->GetGpuVirtualAddress() + lSliceOffset;
+	auto* lCounts = mMeshletCullCounts->GetResource();
+	//Decayed to COMMON after the last frame,the copy promotes it.
+	mGraphicsCmd->CopyBufferRegion(lCounts, 0, mMeshletCullUploadRing->GetResource(), lSliceOffset + sizeof(MeshletCullConstants), sizeof(MeshletCullCounts));
+	TransitState(mGraphicsCmd, lCounts, D3D12_RESOURCE_STATE_COPY_DEST, D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
+
+	mGraphicsCmd->SetGraphicsRootConstantBufferView(MESH_CULL_CONSTANTS_ROOT_PARAMETER_INDEX, lSlice);
+	mGraphicsCmd->SetGraphicsRootShaderResourceView(MESH_CULL_BOUNDS_ROOT_PARAMETER_INDEX, mMeshletBoundsBuffer->GetGPUVirtualAddress());
+	mGraphicsCmd->SetGraphicsRootShaderResourceView(MESH_INSTANCES_ROOT_PARAMETER_INDEX, lSlice + MESHLET_CULL_HEADER_BYTES);
+	mGraphicsCmd->SetGraphicsRootShaderResourceView(MESH_GROUPS_ROOT_PARAMETER_INDEX,
+		lSlice + MESHLET_CULL_HEADER_BYTES + size_t(mMeshletInstanceCapacity) * sizeof(MeshletInstance));
+	mGraphicsCmd->SetGraphicsRootUnorderedAccessView(MESH_CULL_COUNTS_ROOT_PARAMETER_INDEX, mMeshletCullCounts->GetGpuVirtualAddress());
+	ID3D12GraphicsCommandList6* meshCmd = static_cast<ID3D12GraphicsCommandList6*>(mGraphicsCmd);
+	mMeshletCullStats.mDispatches = mMeshShaderPass->Draw(meshCmd, (uint32_t)mMeshletGroups.size());
+
+	TransitState(mGraphicsCmd, lCounts, D3D12_RESOURCE_STATE_UNORDERED_ACCESS, D3D12_RESOURCE_STATE_COPY_SOURCE);
+	mGraphicsCmd->CopyBufferRegion(mMeshletCullReadback->GetResource(), size_t(InFrameIndex) * sizeof(MeshletCullCounts), lCounts, 0, sizeof(MeshletCullCounts));
+	mPendingMeshletCull[InFrameIndex].mRecorded = true;
+}
+
+void Renderer::DXRRenderer::ReadMeshletCullResults(uint32_t InFrameIndex)
+{
+	auto& lPending = mPendingMeshletCull[InFrameIndex];
+	if (!lPending.mRecorded)
+	{
+		return;
+	}
+	MeshletCullCounts lCounts;
+	mMeshletCullReadback->ReadData(std::span<MeshletCullCounts>(&lCounts, 1), size_t(InFrameIndex) * sizeof(MeshletCullCounts));
+	mMeshletCullStats.mCounts = lCounts;
+	if (lPending.mValidate)
+	{
+		mMeshletCullStats.mExpected = lPending.mExpected;
+		mMeshletCullStats.mMismatchedFrames += lCounts == lPending.mExpected ? 0 : 1;
+	}
+	lPending = {};
+}
+
 HRESULT Renderer::DXRRenderer::UpdateMeshShaderResource(
 	ID3D12Resource* destResource,
 	const void* srcData,
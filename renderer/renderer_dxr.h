@@ -1,6 +1,7 @@
 #pragma once
 #include "base_renderer.h"
 #include "mesh_shader_pass.h"
+#include "geometry_allocator.h"
 
 namespace Renderer
 {
@@ -9,7 +10,6 @@ namespace Renderer
 		ID3D12Resource* mBuffer;
 		D3D12_CPU_DESCRIPTOR_HANDLE mSRV;
 		D3D12_GPU_DESCRIPTOR_HANDLE mSRVGpu;
-		uint64_t mBufferOffsetInByte = 0;
 	};
 
 	class DXRRenderer final:public std::enable_shared_from_this<DXRRenderer>,public BaseRenderer
@@ -20,22 +20,75 @@ namespace Renderer
 		void SetTargetWindowAndCreateSwapChain(HWND InWindow, int InWidth, int InHeight) override;
 		void LoadGameScene(std::shared_ptr<GAS::GameScene> InGameScene) override;
 		void Update(float delta) override;
-		void MeshShaderNewStaticmeshComponent(ECS::StaticMeshComponent& InStaticMeshComponent) override;
+		void MeshShaderNewStaticmeshComponent(ECS::StaticMeshComponent& InStaticMeshComponent, ECS::StaticMeshAsset& InAsset) override;
+		void MeshShaderReleaseStaticmeshComponent(ECS::StaticMeshComponent& InStaticMeshComponent, uint64_t InReleaseAfter) override;
+	protected:
+		void ReleaseRetiredResources() override;
 	private:
 		void CreateBuffers() override;
 		HRESULT UpdateMeshShaderResource(ID3D12Resource* destResource,const void* srcData,size_t sizeInBytes,size_t destOffset);
-		HRESULT UpdateScene(ECS::StaticMeshComponent& InStaticMeshComponent);
+		HRESULT UpdateScene(ECS::StaticMeshComponent& InStaticMeshComponent, ECS::StaticMeshAsset& InAsset);
+		//Build the instance and meshlet group table of every resident entity and stage it with the constants in the frame slot.
+		void PrepareMeshletCull(uint32_t InFrameIndex);
+		void EnsureMeshletCullCapacity(uint32_t InInstances, uint32_t InGroups);
+		//One frame slot of mMeshletCullUploadRing.
+		size_t GetMeshletCullSliceBytes() const;
+		//Cull and draw the table PrepareMeshletCull staged,the mesh shader pass has to be set.
+		void RecordMeshletDraws(uint32_t InFrameIndex);
+		void ReadMeshletCullResults(uint32_t InFrameIndex);
 	private:
+		//Head of every mMeshletCullUploadRing slice:MeshletCullConstants and the zeroed counts,the instances and groups follow.
+		static constexpr size_t MESHLET_CULL_HEADER_BYTES = D3D12_CONSTANT_BUFFER_DATA_PLACEMENT_ALIGNMENT;
+		static_assert(sizeof(MeshletCullConstants) + sizeof(MeshletCullCounts) <= MESHLET_CULL_HEADER_BYTES);
+		static constexpr uint32_t MIN_MESHLET_TABLE_SIZE = 256;
+
 		ID3D12GraphicsCommandList4* mGraphicsCmd;
 		std::shared_ptr<MeshShaderPass> mMeshShaderPass;
 		MeshShaderBuffer mMeshletsBuffer;
 		MeshShaderBuffer mMeshletsVerticesBuffer;
 		MeshShaderBuffer mMeshletsIndicesBuffer;
 		MeshShaderBuffer mMeshletsPrimitivesBuffer;
+		//MeshletCullBounds at the indices of mMeshletsBuffer,bound as a root SRV.
+		ID3D12Resource* mMeshletBoundsBuffer;
 		bool sceneReady = false;
 		//The heap other meshlet buffer allocated from
 		ID3D12Heap* mMasterHeap;
-		ECS::StaticMeshComponentMeshOffset mCurrentMeshOffsets;
+		//Element ranges of the meshlet buffers,guarded by mLoadResourceMutex.
+		GeometryAllocator mMeshletAllocator;
+		GeometryAllocator mMeshletVertexAllocator;
+		GeometryAllocator mMeshletPrimitiveAllocator;
+		GeometryAllocator mMeshletIndexAllocator;
+		struct RetiredMeshlets
+		{
+			uint64_t mReleaseAfter;
+			ECS::StaticMeshComponentMeshOffset mOffsets;
+		};
+		std::vector<RetiredMeshlets> mRetiredMeshlets;
+		//Bounds of every resident mesh,guarded by mLoadResourceMutex.
+		MeshletCullReference mMeshletCullReference;
+		std::vector<MeshletInstance> mMeshletInstances;
+		std::vector<MeshletGroup> mMeshletGroups;
+		//Read by the GPU in place,one slice per frame slot.
+		std::unique_ptr<Resource::UploadBuffer> mMeshletCullUploadRing;
+		uint8_t* mMeshletCullUploadData = nullptr;
+		uint32_t mMeshletInstanceCapacity = 0;
+		uint32_t mMeshletGroupCapacity = 0;
+		std::unique_ptr<Resource::ByteAddressBuffer> mMeshletCullCounts;
+		//MeshletCullCounts of every frame slot.
+		std::unique_ptr<Resource::ReadbackBuffer> mMeshletCullReadback;
+		struct PendingMeshletCull
+		{
+			bool mRecorded = false;
+			bool mValidate = false;
+			MeshletCullCounts mExpected;
+		};
+		std::array<PendingMeshletCull, SWAP_CHAIN_BUFFER_COUNT> mPendingMeshletCull;
+		struct RetiredMeshletCullRing
+		{
+			uint64_t mReleaseAfter;
+			std::unique_ptr<Resource::UploadBuffer> mRing;
+		};
+		std::vector<RetiredMeshletCullRing> mRetiredMeshletCullRings;
 		std::shared_ptr<Resource::DepthBuffer> mDepthBuffer;
 		
 
@@ -1,28 +1,136 @@
-struct MeshShaderConstants
-{
-    float4x4 modelMatrix;
-    uint MeshletOffset;
-    uint VertexOffsetWithinScene;
-    uint PrimitiveOffset;
-    uint IndexOffsetWithinScene;
-};
+//Meshlet culling:one amplification group per MeshletGroup,the meshlets passing the frustum,size and normal cone tests
+//are compacted into the payload and only they launch mesh shader groups.
+//Mirrored by MeshletCullReference in meshlet_cull.cpp,keep both in sync.
+#include "meshlet_common.hlsli"
 
-struct Payload
+struct MeshletBatch
 {
-    uint meshletID[128];
+    //Group of the table the first amplification group of the dispatch culls.
+    uint FirstGroup;
 };
 
+ConstantBuffer<MeshletCullConstants> Constants : register(b0);
+ConstantBuffer<MeshletBatch> Batch : register(b2);
+StructuredBuffer<MeshletCullBounds> meshletBounds : register(t4);
+StructuredBuffer<MeshletGroup> meshletGroups : register(t6);
+//MeshletCullCounts
+RWByteAddressBuffer cullCounts : register(u0);
+
 groupshared Payload payload;
+groupshared uint visibleCount;
+
+float Dot3(float3 A, float3 B)
+{
+    //Spelled out,so the results match the C++ reference.
+    precise float Result = A.x * B.x + A.y * B.y + A.z * B.z;
+    return Result;
+}
 
-ConstantBuffer<MeshShaderConstants> ObjectConstants : register(b0);
+float3 TransformPoint(float4 Rows[4], float3 Position)
+{
+    precise float3 Result = Position.x * Rows[0].xyz + Position.y * Rows[1].xyz + Position.z * Rows[2].xyz + Rows[3].xyz;
+    return Result;
+}
 
+float3 UnpackConeAxis(uint Cone)
+{
+    precise float3 Axis = float3(Cone & 0xff, (Cone >> 8) & 0xff, (Cone >> 16) & 0xff) * (2.0f / 255.0f) - 1.0f;
+    return Axis;
+}
 
-[numthreads(128, 1, 1)]
+bool IsFrustumCulled(float3 Center, float Radius)
+{
+    [unroll]
+    for (uint i = 0; i < MESHLET_CULL_PLANES; ++i)
+    {
+        precise float Distance = Center.x * Constants.Planes[i].x + Center.y * Constants.Planes[i].y + Center.z * Constants.Planes[i].z + Constants.Planes[i].w;
+        if (Distance < -Radius)
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+bool IsSmallCulled(float3 Center, float Radius)
+{
+    precise float W = Center.x * Constants.ViewPrj[0].w + Center.y * Constants.ViewPrj[1].w + Center.z * Constants.ViewPrj[2].w + Constants.ViewPrj[3].w;
+    precise float Pixels = 2.0f * Radius * Constants.ProjScale;
+    precise float MinPixels = Constants.MinPixels * W;
+    return Pixels < MinPixels;
+}
+
+bool IsConeCulled(MeshletInstance Instance, MeshletCullBounds Bounds)
+{
+    //A cutoff of 0xff marks a cone wider than a hemisphere.
+    if ((Instance.Flags & MESHLET_INSTANCE_CONE_CULL) == 0 || (Bounds.Cone >> 24) == 0xff)
+    {
+        return false;
+    }
+    float3 LocalAxis = UnpackConeAxis(Bounds.Cone);
+    precise float Cutoff = float(Bounds.Cone >> 24) * (1.0f / 255.0f);
+    precise float3 Axis = LocalAxis.x * Instance.ModelMatrix[0].xyz + LocalAxis.y * Instance.ModelMatrix[1].xyz + LocalAxis.z * Instance.ModelMatrix[2].xyz;
+    precise float3 View = Constants.Eye - TransformPoint(Instance.ModelMatrix, Bounds.ConeApex);
+    //dot(normalize(View),-normalize(Axis)) > Cutoff,squared so neither side needs a square root.
+    precise float Facing = -Dot3(View, Axis);
+    precise float Limit = Cutoff * Cutoff * Dot3(View, View) * Dot3(Axis, Axis);
+    return Facing > 0.0f && Facing * Facing > Limit;
+}
+
+//One thread per meshlet of the group,every wave reserves its payload slots with a single atomic so the payload stays compact.
+[numthreads(MESHLET_GROUP_SIZE, 1, 1)]
 void as_main(
     in uint gtid : SV_GroupThreadID,
     in uint groupID : SV_GroupID
 )
 {
-    payload.meshletID[gtid] = ObjectConstants.MeshletOffset + gtid;
-    DispatchMesh(128, 1, 1, payload);
-}
\ No newline at end of file
+    if (gtid == 0)
+    {
+        visibleCount = 0;
+    }
+    GroupMemoryBarrierWithGroupSync();
+
+    MeshletGroup Group = meshletGroups[Batch.FirstGroup + groupID];
+    MeshletInstance Instance = meshletInstances[Group.Instance];
+    uint MeshletID = Group.FirstMeshlet + gtid;
+    bool Tested = gtid < Group.MeshletCount;
+    bool FrustumCulled = false;
+    bool SmallCulled = false;
+    bool ConeCulled = false;
+    if (Tested)
+    {
+        MeshletCullBounds Bounds = meshletBounds[MeshletID];
+        float3 Center = TransformPoint(Instance.ModelMatrix, Bounds.Center);
+        precise float Radius = Bounds.Radius * Instance.Scale;
+        FrustumCulled = (Constants.Flags & MESHLET_CULL_FRUSTUM) != 0 && IsFrustumCulled(Center, Radius);
+        SmallCulled = !FrustumCulled && (Constants.Flags & MESHLET_CULL_SMALL) != 0 && IsSmallCulled(Center, Radius);
+        ConeCulled = !FrustumCulled && !SmallCulled && (Constants.Flags & MESHLET_CULL_CONE) != 0 && IsConeCulled(Instance, Bounds);
+    }
+    bool Visible = Tested && !FrustumCulled && !SmallCulled && !ConeCulled;
+
+    //No early out above,every lane has to take part in the wave operations.
+    uint WaveVisible = WaveActiveCountBits(Visible);
+    uint4 WaveCounts = uint4(WaveActiveCountBits(Tested), WaveActiveCountBits(FrustumCulled), WaveActiveCountBits(SmallCulled), WaveActiveCountBits(ConeCulled));
+    uint WaveBase = 0;
+    if (WaveIsFirstLane())
+    {
+        InterlockedAdd(visibleCount, WaveVisible, WaveBase);
+        cullCounts.InterlockedAdd(0, WaveCounts.x);
+        cullCounts.InterlockedAdd(4, WaveCounts.y);
+        cullCounts.InterlockedAdd(8, WaveCounts.z);
+        cullCounts.InterlockedAdd(12, WaveCounts.w);
+        cullCounts.InterlockedAdd(16, WaveVisible);
+    }
+    WaveBase = WaveReadLaneFirst(WaveBase);
+    uint Slot = WaveBase + WavePrefixCountBits(Visible);
+    if (Visible)
+    {
+        payload.MeshletID[Slot] = MeshletID;
+    }
+    if (gtid == 0)
+    {
+        payload.Instance = Group.Instance;
+    }
+    GroupMemoryBarrierWithGroupSync();
+    DispatchMesh(visibleCount, 1, 1, payload);
+}
@@ -3,17 +3,27 @@
 ConstantBuffer<FrameData> frameData : register(b0);
 StructuredBuffer<Light> lights : register(t1);
 RWStructuredBuffer<Cluster> clusters : register(u2);
-Texture2D<float4> defaultTexture : register(t5);
-Texture2D<float4> normalTexture : register(t6);
-Texture2D<float4> roughnessTexture : register(t7);
+RWStructuredBuffer<uint> clusterLightIndices : register(u3);
+//Bindless textures,indexed through the material of the draw.
+Texture2D<float4> bindlessTextures[] : register(t0, space1);
+StructuredBuffer<MaterialData> materials : register(t5);
 Texture2D<float> shadowMap : register(t8);
+//Z-binned light culling,see ZBinCull.hlsl.
+StructuredBuffer<uint2> zbins : register(t9);
+StructuredBuffer<uint> zbinLightOrder : register(t10);
+StructuredBuffer<uint> zbinTileMasks : register(t11);
+
+cbuffer DrawData : register(b5)
+{
+    uint materialIndex;
+};
 
 SamplerState defaultSampler : register(s0);
 SamplerComparisonState shadowSampler : register(s1);
 
-static const int CLUSTER_X = 32;
-static const int CLUSTER_Y = 16;
-static const int CLUSTER_Z = 16;
+static const uint ZBIN_COUNT = 1024;
+static const uint ZBIN_TILE_SIZE = 16;
+static const uint LIGHT_CULL_MODE_ZBINS = 1;
 
 static float4 zliceColor[] = 
     {
@@ -100,13 +110,14 @@ float3 ApplyPointLight(
 uint3 ComputeLightGridCellCoordinate(uint2 PixelPos, float SceneDepth, uint EyeIndex)
 {
     uint ZSlice = (uint) (max(0, log2(SceneDepth * frameData.LightGridZParams.x + frameData.LightGridZParams.y) * frameData.LightGridZParams.z));
-    ZSlice = min(ZSlice, (uint) (CLUSTER_Z - 1));
-    return uint3(PixelPos.x / (frameData.ViewSizeAndInvSize.x / CLUSTER_X), PixelPos.y / (frameData.ViewSizeAndInvSize.y / CLUSTER_Y), ZSlice);
+    ZSlice = min(ZSlice, frameData.ClusterCountZ - 1);
+    uint2 Tile = uint2(PixelPos / (frameData.ViewSizeAndInvSize.xy / float2(frameData.ClusterCountX, frameData.ClusterCountY)));
+    return uint3(min(Tile, uint2(frameData.ClusterCountX, frameData.ClusterCountY) - 1), ZSlice);
 }
 
 uint ComputeLightGridCellIndex(uint3 GridCoordinate, uint EyeIndex)
 {
-    return (GridCoordinate.z * CLUSTER_Y + GridCoordinate.y) * CLUSTER_X + GridCoordinate.x;
+    return (GridCoordinate.z * frameData.ClusterCountY + GridCoordinate.y) * frameData.ClusterCountX + GridCoordinate.x;
 }
 
 uint ComputeLightGridCellIndex(uint2 PixelPos, float SceneDepth, uint EyeIndex)
@@ -119,6 +130,77 @@ uint ComputeLightGridCellIndex(uint2 PixelPos, float SceneDepth)
     return ComputeLightGridCellIndex(PixelPos, SceneDepth, 0);
 }
 
+float3 ShadeLight(uint i, float3 diffuseColor, float3 normalVS, float4 viewsSpacePos)
+{
+    Light light = lights[i];
+    float3 lightViewSpace = mul(light.pos, frameData.ViewMatrix).xyz;
+    float3 axisViewSpace = mul(float4(light.direction, 0.0), frameData.ViewMatrix).xyz;
+    if (light.type == LIGHT_TYPE_CAPSULE)
+    {
+        //The closest point of the segment stands in for the whole tube.
+        float3 segmentStart = lightViewSpace - axisViewSpace * light.shape.x;
+        float t = saturate(dot(viewsSpacePos.xyz - segmentStart, axisViewSpace) / max(2.0 * light.shape.x, 1e-4));
+        lightViewSpace = segmentStart + axisViewSpace * (2.0 * light.shape.x * t);
+    }
+    float3 lightDir = lightViewSpace - viewsSpacePos.xyz;
+    float d = length(lightDir);
+    if (d >= light.radius_attenu[0])
+    {
+        return float3(0.0, 0.0, 0.0);
+    }
+    float spotFactor = 1.0;
+    if (light.type == LIGHT_TYPE_SPOT)
+    {
+        float cosAngle = dot(-lightDir / max(d, 1e-4), axisViewSpace);
+        spotFactor = smoothstep(light.shape.x, light.shape.y, cosAngle);
+    }
+    return spotFactor * ApplyPointLight(
+        diffuseColor,
+        diffuseColor,
+        0, 0, normalVS,
+        viewsSpacePos.xyz,
+        viewsSpacePos.xyz,
+        lightViewSpace,
+        light.radius_attenu[0],
+        light.color.xyz);
+}
+
+//Walk the tile mask words inside the depth bin's range of sorted lights.
+float3 ShadeZBinLights(float4 position, float3 diffuseColor, float3 normalVS, float4 viewsSpacePos)
+{
+    float3 color = float3(0.0, 0.0, 0.0);
+    uint bin = min((uint) (max(position.w, 0.0) * frameData.ZBinScale), ZBIN_COUNT - 1);
+    uint2 range = zbins[bin];
+    if (range.x > range.y)
+    {
+        return color;
+    }
+    uint2 tile = uint2(position.xy) / ZBIN_TILE_SIZE;
+    uint tileBase = (tile.y * frameData.ZBinTileCountX + tile.x) * frameData.ZBinWordsPerTile;
+    uint firstWord = range.x / 32;
+    uint lastWord = range.y / 32;
+    for (uint w = firstWord; w <= lastWord; ++w)
+    {
+        uint mask = zbinTileMasks[tileBase + w];
+        //Clip the bits of the edge words to the bin's range.
+        if (w == firstWord)
+        {
+            mask &= ~0u << (range.x % 32);
+        }
+        if (w == lastWord)
+        {
+            mask &= ~0u >> (31 - range.y % 32);
+        }
+        while (mask != 0)
+        {
+            uint bit = firstbitlow(mask);
+            mask &= mask - 1;
+            color += ShadeLight(zbinLightOrder[w * 32 + bit], diffuseColor, normalVS, viewsSpacePos);
+        }
+    }
+    return color;
+}
+
 float ConvertFromDeviceZ(float DeviceZ)
 {
 	// Supports ortho and perspective, see CreateInvDeviceZToWorldZTransform()
@@ -136,14 +218,15 @@ float4 main(PSInput input) : SV_TARGET
      float4 colorAfterCorrection = pow(input.color, 1.0 / gamma);
     return (diffuse + ambient) * colorAfterCorrection;
 #else
+    MaterialData material = materials[materialIndex];
     float2 uvCoordFlip = float2(input.UVCoord.x, 1.0 - input.UVCoord.y);
-    float2 normalPacked = normalTexture.Sample(defaultSampler, uvCoordFlip).xy * 2.0f - 1.0f;
+    float2 normalPacked = bindlessTextures[material.NormalTexture].Sample(defaultSampler, uvCoordFlip).xy * 2.0f - 1.0f;
     float normal_z = sqrt(1.0f - normalPacked.x * normalPacked.x - normalPacked.y * normalPacked.y);
     float3 normal_normalized = normalize(float3(normalPacked.x, normalPacked.y, normal_z));
     float3x3 tbn = float3x3(normalize(input.tangent), normalize(input.bitangent), normalize(input.normal));
     float3 normalWS = normalize(mul(normal_normalized, tbn));
     float3 normalVS = mul(float4(normalWS, 0.0f), frameData.ViewMatrix).xyz;
-    float4 diffuseColor = defaultTexture.Sample(defaultSampler, uvCoordFlip);
+    float4 diffuseColor = bindlessTextures[material.BaseColorTexture].Sample(defaultSampler, uvCoordFlip) * material.BaseColorFactor;
     //float4 diffuseColor = float4(input.color);
     float4 DirLightViewSpace = mul(float4(input.DirectionalLightDir.xyz, 0.0), frameData.ViewMatrix);
     float3 directionalLight = ApplyLightCommon(
@@ -153,31 +236,19 @@ float4 main(PSInput input) : SV_TARGET
     DirLightViewSpace.xyz, input.DirectionalLightColor) * frameData.DirectionalLightDir.w;
     //return float4(directionalLight, 1.0f);
     float3 pointLight = float3(0.0,0.0,0.0);
-    uint GirdIndex = ComputeLightGridCellIndex(uint2(input.position.xy), input.position.w);
     uint3 GridCoord = ComputeLightGridCellCoordinate(uint2(input.position.xy), input.position.w, 0);
     
-    
-    for (uint i = 0; i < 256; ++i)
+    if (frameData.LightCullMode == LIGHT_CULL_MODE_ZBINS)
+    {
+        pointLight = ShadeZBinLights(input.position, diffuseColor.xyz, normalVS, input.viewsSpacePos);
+    }
+    else
     {
-        if (((clusters[GirdIndex].lightMask[i / 32] >> (i % 32)) & 0x1) == 1)
+        uint GirdIndex = ComputeLightGridCellIndex(uint2(input.position.xy), input.position.w);
+        Cluster cluster = clusters[GirdIndex];
+        for (uint n = 0; n < cluster.count; ++n)
         {
-            float4 lightViewSpace = mul(lights[i].pos, frameData.ViewMatrix);
-            float4 lightDir = lightViewSpace - input.viewsSpacePos;
-            float d = length(lightDir);
-            if (d < lights[i].radius_attenu[0])
-            {
-                pointLight += ApplyPointLight(
-                diffuseColor.xyz,
-                diffuseColor.xyz,
-                0, 0, normalVS,
-                input.viewsSpacePos.xyz,
-                input.viewsSpacePos.xyz,
-                lightViewSpace.xyz,
-                lights[i].radius_attenu[0],
-                lights[i].color.xyz);
-                //pointLight += lights[i].color.xyz;
-            }
-           
+            pointLight += ShadeLight(clusterLightIndices[cluster.offset + n], diffuseColor.xyz, normalVS, input.viewsSpacePos);
         }
     }
     pointLight += directionalLight;
@@ -0,0 +1,256 @@
+//GPU driven drawing:culls the persistent instance buffer for one pass and appends the survivors as ExecuteIndirect commands.
+//Mirrored by GpuCullReference in gpu_cull.cpp,keep both in sync.
+
+#define HIZ_TILE_SIZE 8
+#define CULL_GROUP_SIZE 64
+#define INSTANCE_16BIT_INDICES 0x4
+#define CULL_NEAR_PLANE 0x10
+//GpuCullCounts,followed by the IndirectDraw commands.
+#define COUNTS_BYTES 16
+#define DRAW_BYTES 120
+
+struct GpuCullConstants
+{
+    float4 ViewPrj[4];
+    //The view projection the Hi-Z was rendered with.
+    float4 OcclusionViewPrj[4];
+    //D3D12_INDEX_BUFFER_VIEW of the 32 and 16 bit index buffer.
+    uint4 IndexBuffers[2];
+    uint InstanceCount;
+    uint PassFlag;
+    uint ClipPlanes;
+    uint UseOcclusion;
+    uint2 DepthSize;
+    uint2 HiZSize;
+    uint HiZLevels;
+    uint3 Padding;
+    uint4 HiZOffsets[3];
+};
+
+struct GpuInstance
+{
+    float4 ModelMatrix[4];
+    float3 DiffuseColor;
+    uint Material;
+    float3 BoundsCenter;
+    uint Flags;
+    float3 BoundsExtents;
+    uint IndexCount;
+    uint StartIndexLocation;
+    int BaseVertexLocation;
+    uint2 Padding;
+};
+
+struct HiZParams
+{
+    //Level DownsampleHiZ writes.
+    uint Level;
+};
+
+ConstantBuffer<GpuCullConstants> Constants : register(b0);
+ConstantBuffer<HiZParams> HiZPass : register(b1);
+StructuredBuffer<GpuInstance> instances : register(t0);
+Texture2DMS<float> sceneDepth : register(t1);
+RWByteAddressBuffer drawArgs : register(u0);
+//Farthest depth of every tile,the levels follow each other.
+RWStructuredBuffer<float> hiZ : register(u1);
+
+uint GetHiZOffset(uint Level)
+{
+    return Constants.HiZOffsets[Level >> 2][Level & 3];
+}
+
+uint GetHiZWidth(uint Level)
+{
+    uint Width = Constants.HiZSize.x;
+    for (uint i = 0; i < Level; ++i)
+    {
+        Width = (Width + 1) / 2;
+    }
+    return Width;
+}
+
+float4 TransformCorner(float4 Rows[4], GpuInstance Instance, uint Corner)
+{
+    //precise keeps the compiler from fusing,so the results match the C++ reference.
+    precise float3 Position = Instance.BoundsCenter + Instance.BoundsExtents * float3((Corner & 1) ? 1 : -1, (Corner & 2) ? 1 : -1, (Corner & 4) ? 1 : -1);
+    precise float4 Clip = Position.x * Rows[0] + Position.y * Rows[1] + Position.z * Rows[2] + Rows[3];
+    return Clip;
+}
+
+bool IsFrustumCulled(GpuInstance Instance)
+{
+    uint AllOutside = Constants.ClipPlanes;
+    for (uint Corner = 0; Corner < 8; ++Corner)
+    {
+        float4 Clip = TransformCorner(Constants.ViewPrj, Instance, Corner);
+        uint Outside = 0;
+        Outside |= Clip.x < -Clip.w ? 0x1 : 0;
+        Outside |= Clip.x > Clip.w ? 0x2 : 0;
+        Outside |= Clip.y < -Clip.w ? 0x4 : 0;
+        Outside |= Clip.y > Clip.w ? 0x8 : 0;
+        Outside |= Clip.z > Clip.w ? CULL_NEAR_PLANE : 0;
+        AllOutside &= Outside;
+    }
+    return AllOutside != 0;
+}
+
+bool IsOcclusionCulled(GpuInstance Instance)
+{
+    float2 RectMin = float2(3.402823466e+38f, 3.402823466e+38f);
+    float2 RectMax = -RectMin;
+    float Nearest = 0.0f;
+    for (uint Corner = 0; Corner < 8; ++Corner)
+    {
+        float4 Clip = TransformCorner(Constants.OcclusionViewPrj, Instance, Corner);
+        //Crosses the near plane of the view the Hi-Z was rendered from.
+        if (Clip.z > Clip.w)
+        {
+            return false;
+        }
+        precise float InvW = 1.0f / Clip.w;
+        precise float2 Screen = float2((Clip.x * InvW * 0.5f + 0.5f) * Constants.DepthSize.x, (0.5f - Clip.y * InvW * 0.5f) * Constants.DepthSize.y);
+        RectMin = min(RectMin, Screen);
+        RectMax = max(RectMax, Screen);
+        precise float Depth = Clip.z * InvW;
+        Nearest = max(Nearest, Depth);
+    }
+    //Nothing of the Hi-Z to test against,the frustum test decides.
+    if (any(RectMax < 0.0f) || any(RectMin >= float2(Constants.DepthSize)))
+    {
+        return false;
+    }
+
+    uint2 Tile0 = uint2(floor(max(RectMin, 0.0f))) / HIZ_TILE_SIZE;
+    uint2 Tile1 = uint2(floor(min(RectMax, float2(Constants.DepthSize - 1)))) / HIZ_TILE_SIZE;
+    //The finest level the rectangle covers at most 2x2 texels of.
+    uint Level = 0;
+    while (Level + 1 < Constants.HiZLevels && any((Tile1 >> Level) - (Tile0 >> Level) > 1))
+    {
+        Level++;
+    }
+
+    uint Width = GetHiZWidth(Level);
+    uint Offset = GetHiZOffset(Level);
+    for (uint Y = Tile0.y >> Level; Y <= (Tile1.y >> Level); ++Y)
+    {
+        for (uint X = Tile0.x >> Level; X <= (Tile1.x >> Level); ++X)
+        {
+            if (hiZ[Offset + Y * Width + X] <= Nearest)
+            {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+void WriteDraw(uint Slot, GpuInstance Instance, uint InstanceIndex)
+{
+    uint Address = COUNTS_BYTES + Slot * DRAW_BYTES;
+    drawArgs.Store4(Address, Constants.IndexBuffers[(Instance.Flags & INSTANCE_16BIT_INDICES) ? 1 : 0]);
+    [unroll]
+    for (uint Row = 0; Row < 4; ++Row)
+    {
+        drawArgs.Store4(Address + 16 + Row * 16, asuint(Instance.ModelMatrix[Row]));
+    }
+    drawArgs.Store3(Address + 80, asuint(Instance.DiffuseColor));
+    drawArgs.Store(Address + 92, Instance.Material);
+    drawArgs.Store4(Address + 96, uint4(Instance.IndexCount, 1, Instance.StartIndexLocation, asuint(Instance.BaseVertexLocation)));
+    //StartInstanceLocation carries the instance index for validation.
+    drawArgs.Store2(Address + 112, uint2(InstanceIndex, 0));
+}
+
+[numthreads(1, 1, 1)]
+void ClearDrawCounts()
+{
+    drawArgs.Store4(0, uint4(0, 0, 0, 0));
+}
+
+//One thread per instance,every wave reserves its draws with a single atomic so the output stays compact.
+[numthreads(CULL_GROUP_SIZE, 1, 1)]
+void CullInstances(uint3 DispatchThreadId : SV_DispatchThreadID)
+{
+    uint InstanceIndex = DispatchThreadId.x;
+    bool Tested = false;
+    bool FrustumCulled = false;
+    bool OcclusionCulled = false;
+    GpuInstance Instance = (GpuInstance)0;
+    if (InstanceIndex < Constants.InstanceCount)
+    {
+        Instance = instances[InstanceIndex];
+        Tested = (Instance.Flags & Constants.PassFlag) != 0;
+    }
+    if (Tested)
+    {
+        FrustumCulled = IsFrustumCulled(Instance);
+        OcclusionCulled = !FrustumCulled && Constants.UseOcclusion != 0 && IsOcclusionCulled(Instance);
+    }
+    bool Visible = Tested && !FrustumCulled && !OcclusionCulled;
+
+    //No early out above,every lane has to take part in the wave operations.
+    uint4 WaveCounts = uint4(WaveActiveCountBits(Visible), WaveActiveCountBits(Tested), WaveActiveCountBits(FrustumCulled), WaveActiveCountBits(OcclusionCulled));
+    uint WaveBase = 0;
+    if (WaveIsFirstLane())
+    {
+        drawArgs.InterlockedAdd(0, WaveCounts.x, WaveBase);
+        drawArgs.InterlockedAdd(4, WaveCounts.y);
+        drawArgs.InterlockedAdd(8, WaveCounts.z);
+        drawArgs.InterlockedAdd(12, WaveCounts.w);
+    }
+    WaveBase = WaveReadLaneFirst(WaveBase);
+    uint Slot = WaveBase + WavePrefixCountBits(Visible);
+    if (Visible)
+    {
+        WriteDraw(Slot, Instance, InstanceIndex);
+    }
+}
+
+//Level 0:one thread per tile,the farthest depth of all its pixels and samples.
+[numthreads(8, 8, 1)]
+void BuildHiZ(uint3 DispatchThreadId : SV_DispatchThreadID)
+{
+    if (any(DispatchThreadId.xy >= Constants.HiZSize))
+    {
+        return;
+    }
+    uint Width, Height, Samples;
+    sceneDepth.GetDimensions(Width, Height, Samples);
+    uint2 PixelBegin = DispatchThreadId.xy * HIZ_TILE_SIZE;
+    uint2 PixelEnd = min(PixelBegin + HIZ_TILE_SIZE, Constants.DepthSize);
+    float Farthest = 1.0f;
+    for (uint Y = PixelBegin.y; Y < PixelEnd.y; ++Y)
+    {
+        for (uint X = PixelBegin.x; X < PixelEnd.x; ++X)
+        {
+            for (uint Sample = 0; Sample < Samples; ++Sample)
+            {
+                Farthest = min(Farthest, sceneDepth.Load(int2(X, Y), Sample));
+            }
+        }
+    }
+    hiZ[DispatchThreadId.y * Constants.HiZSize.x + DispatchThreadId.x] = Farthest;
+}
+
+//One thread per texel of HiZPass.Level,the farthest of the up to 2x2 texels below it.
+[numthreads(8, 8, 1)]
+void DownsampleHiZ(uint3 DispatchThreadId : SV_DispatchThreadID)
+{
+    uint SrcWidth = GetHiZWidth(HiZPass.Level - 1);
+    uint SrcHeight = Constants.HiZSize.y;
+    for (uint i = 1; i < HiZPass.Level; ++i)
+    {
+        SrcHeight = (SrcHeight + 1) / 2;
+    }
+    uint2 Size = uint2((SrcWidth + 1) / 2, (SrcHeight + 1) / 2);
+    if (any(DispatchThreadId.xy >= Size))
+    {
+        return;
+    }
+    uint Src = GetHiZOffset(HiZPass.Level - 1);
+    uint2 Src0 = DispatchThreadId.xy * 2;
+    uint2 Src1 = min(Src0 + 1, uint2(SrcWidth, SrcHeight) - 1);
+    float Farthest = min(hiZ[Src + Src0.y * SrcWidth + Src0.x], hiZ[Src + Src0.y * SrcWidth + Src1.x]);
+    Farthest = min(Farthest, min(hiZ[Src + Src1.y * SrcWidth + Src0.x], hiZ[Src + Src1.y * SrcWidth + Src1.x]));
+    hiZ[GetHiZOffset(HiZPass.Level) + DispatchThreadId.y * Size.x + DispatchThreadId.x] = Farthest;
+}
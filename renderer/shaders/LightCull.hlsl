@@ -3,10 +3,21 @@
 ConstantBuffer<FrameData> View : register(b0);
 StructuredBuffer<Light> lights : register(t1);
 RWStructuredBuffer<Cluster> clusters: register(u2);
+RWStructuredBuffer<uint> clusterLightIndices : register(u3);
+Texture2DMS<float> sceneDepth : register(t0);
+RWStructuredBuffer<uint> activeClusterFlags : register(u4);
+RWStructuredBuffer<uint> activeClusters : register(u5);
+RWByteAddressBuffer activeClusterArgs : register(u6);
+RWStructuredBuffer<float2> pixelDepthRanges : register(u7);
 
-static const int CLUSTER_X = 32;
-static const int CLUSTER_Y = 16;
-static const int CLUSTER_Z = 16;
+struct ActiveClusterParams
+{
+    //Mark every cluster instead of reading the depth buffer.
+    uint MarkAll;
+    //Write each pixel's sample depth range for the CPU reference.
+    uint WriteDepthRanges;
+};
+ConstantBuffer<ActiveClusterParams> ActiveParams : register(b1);
 
 //Use UE's impl
 //Todo: Compare with idTechs' impl
@@ -14,7 +25,7 @@ float ComputeCellNearViewDepthFromZSlice(uint ZSlice)
 {
     float SliceDepth = (exp2(ZSlice / View.LightGridZParams.z) - View.LightGridZParams.y) / View.LightGridZParams.x;
 
-    if (ZSlice == (uint) CLUSTER_Z)
+    if (ZSlice == View.ClusterCountZ)
     {
 		// Extend the last slice depth max out to world max
 		// This allows clamping the depth range to reasonable values, 
@@ -62,7 +73,7 @@ void ComputeCellViewAABB(uint3 GridCoordinate, out float3 ViewTileMin, out float
 {
 	// Compute extent of tiles in clip-space. Note that the last tile may extend a bit outside of view if view size is not evenly divisible tile size.
     //const float2 InvCulledGridSizeF = (1u << LightGridPixelSizeShift) * View.ViewSizeAndInvSize.zw;
-    const float2 GridPixelSize = float2(View.ViewSizeAndInvSize.x/CLUSTER_X,View.ViewSizeAndInvSize.y / CLUSTER_Y);
+    const float2 GridPixelSize = float2(View.ViewSizeAndInvSize.x / View.ClusterCountX, View.ViewSizeAndInvSize.y / View.ClusterCountY);
     const float2 InvCulledGridSizeF = GridPixelSize * View.ViewSizeAndInvSize.zw;
     const float2 TileSize = float2(2.0f, -2.0f) * InvCulledGridSizeF.xy;
     const float2 UnitPlaneMin = float2(-1.0f, 1.0f);
@@ -114,38 +125,332 @@ void ComputeCellViewAABB(uint3 GridCoordinate, out float3 ViewTileMin, out float
     ViewTileMin.z = MinTileZ;
     ViewTileMax.z = MaxTileZ;
 }
-//light max count 256
-//32 * 8
-[numthreads(32, 8, 1)]
-void main(
-    uint3 GroupId : SV_GroupID,
-	uint3 DispatchThreadId : SV_DispatchThreadID,
-	uint3 GroupThreadId : SV_GroupThreadID,
-    uint threadIndex:SV_GroupIndex)
+static const uint CULL_GROUP_SIZE = 64;
+static const uint SCAN_GROUP_SIZE = 1024;
+
+groupshared uint gClusterLightCount;
+groupshared uint gLightVisible[CULL_GROUP_SIZE];
+groupshared uint gScan[SCAN_GROUP_SIZE];
+
+//Groups per row of the indirect dispatches,keeps every dimension under the 65535 group limit.
+static const uint ACTIVE_GROUP_WIDTH = 1024;
+//Pads the active list to a whole row of groups.
+static const uint INVALID_CLUSTER = 0xffffffff;
+
+uint ComputeClusterCount()
+{
+    return View.ClusterCountX * View.ClusterCountY * View.ClusterCountZ;
+}
+
+uint3 ComputeClusterCoordinate(uint ClusterIndex)
+{
+    uint SliceSize = View.ClusterCountX * View.ClusterCountY;
+    return uint3(ClusterIndex % View.ClusterCountX, (ClusterIndex % SliceSize) / View.ClusterCountX, ClusterIndex / SliceSize);
+}
+
+//The count and write passes run one group per entry of the active list.
+uint LoadActiveCluster(uint3 GroupId)
+{
+    return activeClusters[GroupId.y * ACTIVE_GROUP_WIDTH + GroupId.x];
+}
+
+//Active clusters:mark the clusters holding a depth sample,then compact them into a list and the indirect arguments
+//of the count and write passes.Clusters no pixel can read are never tested against the lights.
+static const uint MARK_GROUP_SIZE = 8;
+//Slices are widened by this much on both sides.The pixel shader reads the interpolated depth at the pixel center,
+//which can differ slightly from the depth of the samples.
+static const float SLICE_EPSILON = 0.01f;
+
+//ConvertFromDeviceZ in ForwardPS.hlsl.
+float ConvertFromDeviceZ(float DeviceZ)
+{
+    return DeviceZ * View.InvDeviceZToWorldZTransform.x + View.InvDeviceZToWorldZTransform.y + 1.0f / (DeviceZ * View.InvDeviceZToWorldZTransform.z - View.InvDeviceZToWorldZTransform.w);
+}
+
+//ComputeLightGridCellCoordinate in ForwardPS.hlsl before truncation.
+float ComputeZSlice(float SceneDepth)
+{
+    return max(0, log2(SceneDepth * View.LightGridZParams.x + View.LightGridZParams.y) * View.LightGridZParams.z);
+}
+
+[numthreads(64, 1, 1)]
+void ClearActiveClusters(uint3 DispatchThreadId : SV_DispatchThreadID)
+{
+    if (DispatchThreadId.x < ComputeClusterCount())
+    {
+        activeClusterFlags[DispatchThreadId.x] = ActiveParams.MarkAll;
+    }
+}
+
+//One thread per pixel,every sample's cluster is marked.Reversed Z,cleared samples are sky.
+[numthreads(MARK_GROUP_SIZE, MARK_GROUP_SIZE, 1)]
+void MarkActiveClusters(uint3 DispatchThreadId : SV_DispatchThreadID)
 {
-    uint clusterID = GroupId.x + (GroupId.y) * CLUSTER_X + GroupId.z * (CLUSTER_X * CLUSTER_Y);
-    if (GroupThreadId.x == 0 && GroupThreadId.y == 0)
+    uint Width;
+    uint Height;
+    uint Samples;
+    sceneDepth.GetDimensions(Width, Height, Samples);
+    uint2 Pixel = DispatchThreadId.xy;
+    if (Pixel.x >= Width || Pixel.y >= Height)
     {
-        for (int i = 0; i < 8;++i)
+        return;
+    }
+    float MinDeviceZ = 1.0f;
+    float MaxDeviceZ = 0.0f;
+    for (uint s = 0; s < Samples; ++s)
+    {
+        float DeviceZ = sceneDepth.Load(Pixel, s);
+        if (DeviceZ > 0.0f)
         {
-            clusters[clusterID].lightMask[i] = 0;
+            MinDeviceZ = min(MinDeviceZ, DeviceZ);
+            MaxDeviceZ = max(MaxDeviceZ, DeviceZ);
         }
     }
-    GroupMemoryBarrier();
+    if (ActiveParams.WriteDepthRanges)
+    {
+        pixelDepthRanges[Pixel.y * Width + Pixel.x] = float2(MinDeviceZ, MaxDeviceZ);
+    }
+    if (MaxDeviceZ <= 0.0f)
+    {
+        return;
+    }
+    //Same tile as the pixel shader,the nearest sample has the largest device depth.
+    uint2 Tile = uint2(Pixel / (View.ViewSizeAndInvSize.xy / float2(View.ClusterCountX, View.ClusterCountY)));
+    Tile = min(Tile, uint2(View.ClusterCountX, View.ClusterCountY) - 1);
+    uint FirstSlice = min((uint) max(ComputeZSlice(ConvertFromDeviceZ(MaxDeviceZ)) - SLICE_EPSILON, 0), View.ClusterCountZ - 1);
+    uint LastSlice = min((uint) (ComputeZSlice(ConvertFromDeviceZ(MinDeviceZ)) + SLICE_EPSILON), View.ClusterCountZ - 1);
+    for (uint z = FirstSlice; z <= LastSlice; ++z)
+    {
+        activeClusterFlags[(z * View.ClusterCountY + Tile.y) * View.ClusterCountX + Tile.x] = 1;
+    }
+}
+
+//Single group scan of the flags like CompactOffsets.Active clusters are listed in ascending order,
+//inactive ones get an empty range so the offsets pass and the pixel shader see no lights.
+[numthreads(1024, 1, 1)]
+void CompactActiveClusters(uint GroupIndex : SV_GroupIndex)
+{
+    uint ClusterCount = ComputeClusterCount();
+    uint ScanItems = (ClusterCount + SCAN_GROUP_SIZE - 1) / SCAN_GROUP_SIZE;
+    uint Base = GroupIndex * ScanItems;
+    uint ItemCount = min(ScanItems, ClusterCount - min(Base, ClusterCount));
+    uint ThreadSum = 0;
+    for (uint i = 0; i < ItemCount; ++i)
+    {
+        ThreadSum += activeClusterFlags[Base + i] != 0 ? 1 : 0;
+    }
+    gScan[GroupIndex] = ThreadSum;
+    GroupMemoryBarrierWithGroupSync();
+    for (uint Stride = 1; Stride < SCAN_GROUP_SIZE; Stride <<= 1)
+    {
+        uint Value = GroupIndex >= Stride ? gScan[GroupIndex - Stride] : 0;
+        GroupMemoryBarrierWithGroupSync();
+        gScan[GroupIndex] += Value;
+        GroupMemoryBarrierWithGroupSync();
+    }
+
+    uint Slot = gScan[GroupIndex] - ThreadSum;
+    for (uint j = 0; j < ItemCount; ++j)
+    {
+        if (activeClusterFlags[Base + j] != 0)
+        {
+            activeClusters[Slot++] = Base + j;
+        }
+        else
+        {
+            clusters[Base + j].count = 0;
+        }
+    }
+    uint ActiveCount = gScan[SCAN_GROUP_SIZE - 1];
+    uint PaddedCount = (ActiveCount + ACTIVE_GROUP_WIDTH - 1) / ACTIVE_GROUP_WIDTH * ACTIVE_GROUP_WIDTH;
+    if (ActiveCount + GroupIndex < PaddedCount)
+    {
+        activeClusters[ActiveCount + GroupIndex] = INVALID_CLUSTER;
+    }
+    if (GroupIndex == 0)
+    {
+        //Dispatch arguments,then the count for the stats.
+        activeClusterArgs.Store4(0, uint4(min(ActiveCount, ACTIVE_GROUP_WIDTH), PaddedCount / ACTIVE_GROUP_WIDTH, 1, ActiveCount));
+    }
+}
+
+//Three passes over the active clusters:count the lights of every cluster,turn the counts into offsets with a prefix sum,
+//then write each cluster's light indices into its range of the compacted list.
+//Cone against a sphere,see Bart Wronski's cull that cone.Exact for cones narrower than 90 degrees.
+bool SpotIntersectsSphere(float3 Origin, float3 Axis, float Range, float CosOuter, float SinOuter, float3 SphereCenter, float SphereRadius)
+{
+    float3 V = SphereCenter - Origin;
+    float VLenSq = dot(V, V);
+    float V1Len = dot(V, Axis);
+    float DistanceClosestPoint = CosOuter * sqrt(max(VLenSq - V1Len * V1Len, 0.0f)) - V1Len * SinOuter;
+    bool AngleCull = DistanceClosestPoint > SphereRadius;
+    bool FrontCull = V1Len > SphereRadius + Range;
+    bool BackCull = V1Len < -SphereRadius;
+    return !(AngleCull || FrontCull || BackCull);
+}
+
+//Slab test of a segment against a box.
+bool SegmentIntersectsBox(float3 SegmentStart, float3 SegmentEnd, float3 BoxMin, float3 BoxMax)
+{
+    float3 Direction = SegmentEnd - SegmentStart;
+    float TMin = 0.0f;
+    float TMax = 1.0f;
+    for (uint Axis = 0; Axis < 3; ++Axis)
+    {
+        if (abs(Direction[Axis]) < 1e-6f)
+        {
+            if (SegmentStart[Axis] < BoxMin[Axis] || SegmentStart[Axis] > BoxMax[Axis])
+            {
+                return false;
+            }
+        }
+        else
+        {
+            float InvDirection = 1.0f / Direction[Axis];
+            float T0 = (BoxMin[Axis] - SegmentStart[Axis]) * InvDirection;
+            float T1 = (BoxMax[Axis] - SegmentStart[Axis]) * InvDirection;
+            TMin = max(TMin, min(T0, T1));
+            TMax = min(TMax, max(T0, T1));
+        }
+    }
+    return TMin <= TMax;
+}
+
+//Bounding sphere first,then the light's shape.
+bool LightIntersectsCell(uint LightIndex, float3 ViewTileCenter, float3 ViewTileExtent)
+{
+    Light L = lights[LightIndex];
+    float3 ViewSpaceBoundsCenter = mul(float4(L.bounds.xyz, 1.0f), View.ViewMatrix).xyz;
+    float BoxDistanceSq = ComputeSquaredDistanceFromBoxToPoint(ViewTileCenter, ViewTileExtent, ViewSpaceBoundsCenter);
+    if (BoxDistanceSq >= L.bounds.w * L.bounds.w)
+    {
+        return false;
+    }
+    if (L.type == LIGHT_TYPE_POINT)
+    {
+        return true;
+    }
+    float3 ViewSpaceLightPosition = mul(L.pos, View.ViewMatrix).xyz;
+    float3 ViewSpaceAxis = mul(float4(L.direction, 0.0f), View.ViewMatrix).xyz;
+    float LightRadius = L.radius_attenu[0];
+    if (L.type == LIGHT_TYPE_SPOT)
+    {
+        //The cone is tested against the cell's bounding sphere,cones of 90 degrees or wider keep the bounding sphere result.
+        return L.shape.x <= 0.0f || SpotIntersectsSphere(ViewSpaceLightPosition, ViewSpaceAxis, LightRadius, L.shape.x, L.shape.z, ViewTileCenter, length(ViewTileExtent));
+    }
+    //Capsule:the segment against the cell grown by the radius,conservative only around the grown box's corners.
+    float3 HalfSegment = ViewSpaceAxis * L.shape.x;
+    return SegmentIntersectsBox(ViewSpaceLightPosition - HalfSegment, ViewSpaceLightPosition + HalfSegment,
+        ViewTileCenter - ViewTileExtent - LightRadius, ViewTileCenter + ViewTileExtent + LightRadius);
+}
+
+//One group per active cluster,each thread tests every 64th light.
+[numthreads(64, 1, 1)]
+void CountLights(uint3 GroupId : SV_GroupID, uint GroupIndex : SV_GroupIndex)
+{
+    uint ClusterIndex = LoadActiveCluster(GroupId);
+    //Uniform across the group,so no thread is left waiting at a barrier.
+    if (ClusterIndex == INVALID_CLUSTER)
+    {
+        return;
+    }
+    if (GroupIndex == 0)
+    {
+        gClusterLightCount = 0;
+    }
+    GroupMemoryBarrierWithGroupSync();
+    float3 ViewTileMin;
+    float3 ViewTileMax;
+    ComputeCellViewAABB(ComputeClusterCoordinate(ClusterIndex), ViewTileMin, ViewTileMax);
+    float3 ViewTileCenter = .5f * (ViewTileMin + ViewTileMax);
+    float3 ViewTileExtent = ViewTileMax - ViewTileCenter;
+
+    uint LocalCount = 0;
+    for (uint LightIndex = GroupIndex; LightIndex < View.LightCount; LightIndex += CULL_GROUP_SIZE)
+    {
+        LocalCount += LightIntersectsCell(LightIndex, ViewTileCenter, ViewTileExtent) ? 1 : 0;
+    }
+    InterlockedAdd(gClusterLightCount, LocalCount);
+    GroupMemoryBarrierWithGroupSync();
+    if (GroupIndex == 0)
+    {
+        clusters[ClusterIndex].count = gClusterLightCount;
+    }
+}
+
+//Exclusive prefix sum of the counts in a single group,every thread owns ScanItems consecutive clusters.
+[numthreads(1024, 1, 1)]
+void CompactOffsets(uint GroupIndex : SV_GroupIndex)
+{
+    uint ClusterCount = ComputeClusterCount();
+    uint ScanItems = (ClusterCount + SCAN_GROUP_SIZE - 1) / SCAN_GROUP_SIZE;
+    uint Base = GroupIndex * ScanItems;
+    uint ItemCount = min(ScanItems, ClusterCount - min(Base, ClusterCount));
+    uint ThreadSum = 0;
+    for (uint i = 0; i < ItemCount; ++i)
+    {
+        ThreadSum += clusters[Base + i].count;
+    }
+    gScan[GroupIndex] = ThreadSum;
+    GroupMemoryBarrierWithGroupSync();
+    for (uint Stride = 1; Stride < SCAN_GROUP_SIZE; Stride <<= 1)
+    {
+        uint Value = GroupIndex >= Stride ? gScan[GroupIndex - Stride] : 0;
+        GroupMemoryBarrierWithGroupSync();
+        gScan[GroupIndex] += Value;
+        GroupMemoryBarrierWithGroupSync();
+    }
+
+    uint Capacity;
+    uint IndexStride;
+    clusterLightIndices.GetDimensions(Capacity, IndexStride);
+    uint Offset = gScan[GroupIndex] - ThreadSum;
+    for (uint j = 0; j < ItemCount; ++j)
+    {
+        uint Count = clusters[Base + j].count;
+        //Clusters past the capacity lose their lights instead of writing out of bounds.
+        uint ClampedOffset = min(Offset, Capacity);
+        clusters[Base + j].offset = ClampedOffset;
+        clusters[Base + j].count = min(Count, Capacity - ClampedOffset);
+        Offset += Count;
+    }
+}
+
+//One group per active cluster,lights are tested 64 at a time and written in ascending order.
+[numthreads(64, 1, 1)]
+void WriteLightIndices(uint3 GroupId : SV_GroupID, uint GroupIndex : SV_GroupIndex)
+{
+    uint ClusterIndex = LoadActiveCluster(GroupId);
+    if (ClusterIndex == INVALID_CLUSTER)
+    {
+        return;
+    }
     float3 ViewTileMin;
     float3 ViewTileMax;
-    ComputeCellViewAABB(GroupId, ViewTileMin, ViewTileMax);
-    
+    ComputeCellViewAABB(ComputeClusterCoordinate(ClusterIndex), ViewTileMin, ViewTileMax);
     float3 ViewTileCenter = .5f * (ViewTileMin + ViewTileMax);
     float3 ViewTileExtent = ViewTileMax - ViewTileCenter;
-   
-    uint LocalLightIndex = GroupThreadId.x + GroupThreadId.y * 32;
-    float3 ViewSpaceLightPosition = mul(lights[LocalLightIndex].pos,View.ViewMatrix).xyz;
-    float LightRadius = lights[LocalLightIndex].radius_attenu[0];
-    float BoxDistanceSq = ComputeSquaredDistanceFromBoxToPoint(ViewTileCenter, ViewTileExtent, ViewSpaceLightPosition);
-    if (BoxDistanceSq < LightRadius * LightRadius)
+
+    Cluster Range = clusters[ClusterIndex];
+    uint Written = 0;
+    //Written is the same in every thread,so the loop stays uniform around the barriers.
+    for (uint BatchBase = 0; BatchBase < View.LightCount && Written < Range.count; BatchBase += CULL_GROUP_SIZE)
     {
-        InterlockedOr(clusters[clusterID].lightMask[GroupThreadId.y], (0x1U << GroupThreadId.x));
+        uint LightIndex = BatchBase + GroupIndex;
+        gLightVisible[GroupIndex] = (LightIndex < View.LightCount && LightIntersectsCell(LightIndex, ViewTileCenter, ViewTileExtent)) ? 1 : 0;
+        GroupMemoryBarrierWithGroupSync();
+        uint Slot = Written;
+        uint BatchCount = 0;
+        for (uint i = 0; i < CULL_GROUP_SIZE; ++i)
+        {
+            Slot += i < GroupIndex ? gLightVisible[i] : 0;
+            BatchCount += gLightVisible[i];
+        }
+        if (gLightVisible[GroupIndex] && Slot < Range.count)
+        {
+            clusterLightIndices[Range.offset + Slot] = LightIndex;
+        }
+        GroupMemoryBarrierWithGroupSync();
+        Written += BatchCount;
     }
-   
-}
\ No newline at end of file
+}
@@ -1,4 +1,5 @@
 #include "shader_common.hlsli"
+#include "meshlet_common.hlsli"
 
 struct Meshlet
 {
@@ -13,16 +14,6 @@ StructuredBuffer<VSInput> Vertices : register(t1);
 ByteAddressBuffer UniqueVertexIndices : register(t2);
 StructuredBuffer<uint> PrimitiveIndices : register(t3);
 
-
-struct MeshShaderConstants
-{
-    float4x4 modelMatrix;
-    uint MeshletOffset;
-    uint VertexOffsetWithinScene;
-    uint PrimitiveOffset;
-    uint IndexOffsetWithinScene;
-};
-ConstantBuffer<MeshShaderConstants> ObjectConstants : register(b0);
 ConstantBuffer<FrameData> frameData : register(b1);
 
 struct VertexOut
@@ -49,15 +40,15 @@ uint3 UnpackPrimitive(uint primitive)
     return uint3(primitive & 0x3FF, (primitive >> 10) & 0x3FF, (primitive >> 20) & 0x3FF);
 }
 
-uint3 GetPrimitive(Meshlet m, uint index)
+uint3 GetPrimitive(MeshletInstance Instance, Meshlet m, uint index)
 {
-    return UnpackPrimitive(PrimitiveIndices[m.PrimOffset + ObjectConstants.PrimitiveOffset + index]);
+    return UnpackPrimitive(PrimitiveIndices[m.PrimOffset + Instance.PrimitiveOffset + index]);
 }
 
-uint GetVertexIndex(Meshlet m, uint localIndex)
+uint GetVertexIndex(MeshletInstance Instance, Meshlet m, uint localIndex)
 {
     localIndex = m.VertOffset + localIndex;
-    localIndex = localIndex + ObjectConstants.IndexOffsetWithinScene;
+    localIndex = localIndex + Instance.IndexOffsetWithinScene;
     return UniqueVertexIndices.Load(localIndex * 4);
     //if (MeshInfo.IndexBytes == 4) // 32-bit Vertex Indices
     //{
@@ -76,24 +67,6 @@ uint GetVertexIndex(Meshlet m, uint localIndex)
     //}
 }
 
-struct Payload
-{
-    uint meshletID[128];
-};
-
-groupshared Payload payload;
-
-[numthreads(128,1,1)]
-void as_main(
-    in uint gtid : SV_GroupThreadID,
-    in uint groupID : SV_GroupID
-)
-{
-    payload.meshletID[gtid] = ObjectConstants.MeshletOffset + gtid;
-    DispatchMesh(128, 1, 1, payload);
-}
-
-
 [numthreads(128, 1, 1)]
 [outputtopology("triangle")]
 void ms_main(
@@ -103,23 +76,24 @@ void ms_main(
     out vertices VertexOut vertices[64], // Max possible vertices
     out indices uint3 tris[126]) // Max possible triangles
 {
-    // Calculate the global meshlet ID
-    //uint meshletID = ObjectConstants.MeshletOffset + groupID;
-    uint meshletID = meshInput.meshletID[groupID];
+    // One group per meshlet the amplification shader kept
+    uint meshletID = meshInput.MeshletID[groupID];
+    MeshletInstance instance = meshletInstances[meshInput.Instance];
     Meshlet meshlet = Meshlets[meshletID];
     SetMeshOutputCounts(meshlet.VertCount, meshlet.PrimCount);
 
     // Each thread processes a single vertex
     if (gtid < meshlet.VertCount)
     {
-        uint vertexIndex = GetVertexIndex(meshlet, gtid) + ObjectConstants.VertexOffsetWithinScene;
-        float4 modelSpacePos = mul(Vertices[vertexIndex].pos, ObjectConstants.modelMatrix);
+        uint vertexIndex = GetVertexIndex(instance, meshlet, gtid) + instance.VertexOffsetWithinScene;
+        float4 pos = Vertices[vertexIndex].pos;
+        float4 modelSpacePos = pos.x * instance.ModelMatrix[0] + pos.y * instance.ModelMatrix[1] + pos.z * instance.ModelMatrix[2] + pos.w * instance.ModelMatrix[3];
         vertices[gtid].position = mul(modelSpacePos, frameData.ViewPrj);
         vertices[gtid].color = float4(Vertices[vertexIndex].normal, 1.0);
     }
     
     if (gtid < meshlet.PrimCount)
     {
-        tris[gtid] = GetPrimitive(meshlet, gtid);
+        tris[gtid] = GetPrimitive(instance, meshlet, gtid);
     }
 }
\ No newline at end of file
@@ -0,0 +1,40 @@
+//Expands the per light tile rects of the z-binned light culling into one bit per depth sorted light in every screen tile.
+//Sorting,depth bins and the rects themselves are built on the CPU,see zbin_light_cull.cpp.
+
+struct ZBinCullConstants
+{
+    uint TileCountX;
+    uint TileCountY;
+    uint WordsPerTile;
+    uint LightCount;
+};
+
+ConstantBuffer<ZBinCullConstants> Constants : register(b0);
+//Inclusive min and max tile per sorted light,empty when x > z.
+StructuredBuffer<int4> lightTileRects : register(t0);
+RWStructuredBuffer<uint> tileMasks : register(u0);
+
+//One thread per mask word,one row of groups per tile row.
+[numthreads(64, 1, 1)]
+void main(uint3 DispatchThreadId : SV_DispatchThreadID)
+{
+    uint RowWord = DispatchThreadId.x;
+    if (RowWord >= Constants.TileCountX * Constants.WordsPerTile)
+    {
+        return;
+    }
+    int2 TileCoord = int2(RowWord / Constants.WordsPerTile, DispatchThreadId.y);
+    uint Word = RowWord % Constants.WordsPerTile;
+    uint First = Word * 32;
+    uint Last = min(First + 32, Constants.LightCount);
+    uint Mask = 0;
+    for (uint SortedIndex = First; SortedIndex < Last; ++SortedIndex)
+    {
+        int4 Rect = lightTileRects[SortedIndex];
+        if (all(TileCoord >= Rect.xy) && all(TileCoord <= Rect.zw))
+        {
+            Mask |= 1u << (SortedIndex - First);
+        }
+    }
+    tileMasks[DispatchThreadId.y * Constants.TileCountX * Constants.WordsPerTile + RowWord] = Mask;
+}
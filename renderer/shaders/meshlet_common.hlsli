@@ -0,0 +1,58 @@
+//Shared by AmplifyShader.hlsl and MeshShader.hlsl,mirrors meshlet_cull.h.
+
+#define MESHLET_GROUP_SIZE 128
+#define MESHLET_CULL_FRUSTUM 0x1
+#define MESHLET_CULL_CONE 0x2
+#define MESHLET_CULL_SMALL 0x4
+#define MESHLET_INSTANCE_CONE_CULL 0x1
+#define MESHLET_CULL_PLANES 5
+
+struct MeshletCullBounds
+{
+    float3 Center;
+    float Radius;
+    float3 ConeApex;
+    //Axis in xyz as unorm bytes,the cutoff in w.
+    uint Cone;
+};
+
+struct MeshletInstance
+{
+    //Rows of a row vector matrix.
+    float4 ModelMatrix[4];
+    uint MeshletOffset;
+    uint VertexOffsetWithinScene;
+    uint PrimitiveOffset;
+    uint IndexOffsetWithinScene;
+    float Scale;
+    uint Flags;
+    uint2 Padding;
+};
+
+struct MeshletGroup
+{
+    uint Instance;
+    uint FirstMeshlet;
+    uint MeshletCount;
+    uint Padding;
+};
+
+struct MeshletCullConstants
+{
+    float4 ViewPrj[4];
+    float4 Planes[MESHLET_CULL_PLANES];
+    float3 Eye;
+    uint Flags;
+    float ProjScale;
+    float MinPixels;
+    uint2 Padding;
+};
+
+//The surviving meshlets of one amplification group,one mesh shader group each.
+struct Payload
+{
+    uint Instance;
+    uint MeshletID[MESHLET_GROUP_SIZE];
+};
+
+StructuredBuffer<MeshletInstance> meshletInstances : register(t5);
@@ -23,17 +23,29 @@ struct VSInput
 };
 
 
+static const uint LIGHT_TYPE_POINT = 0;
+static const uint LIGHT_TYPE_SPOT = 1;
+static const uint LIGHT_TYPE_CAPSULE = 2;
+
+//ECS::LigthData
 struct Light
 {
     float4 color;
     float4 pos;
     float4 radius_attenu;
+    float3 direction;
+    uint type;
+    //Spot:cos outer,cos inner,sin outer.Capsule:half length.
+    float4 shape;
+    //World space bounding sphere.
+    float4 bounds;
 };
 
 struct Cluster
 {
-    //32bit * 8
-    uint lightMask[8];
+    //Range in the compacted light index list
+    uint offset;
+    uint count;
 };
 
 
@@ -52,7 +64,14 @@ struct FrameData
     float4x4 ViewMatrix;
     float4 LightGridZParams;
     float4 InvDeviceZToWorldZTransform;
-    
+    uint LightCount;
+    uint LightCullMode;
+    uint ZBinTileCountX;
+    uint ZBinWordsPerTile;
+    float ZBinScale;
+    uint ClusterCountX;
+    uint ClusterCountY;
+    uint ClusterCountZ;
 };
 
 struct ObjectData
@@ -61,6 +80,15 @@ struct ObjectData
     float3 DiffuseColor;
 };
 
+//GpuMaterial in material_table.h.
+struct MaterialData
+{
+    uint BaseColorTexture;
+    uint NormalTexture;
+    uint2 Padding;
+    float4 BaseColorFactor;
+};
+
 struct SkyBoxPsInput
 {
     float4 pos : SV_Position;
@@ -0,0 +1,129 @@
+#include "shadow_culling.h"
+
+using namespace DirectX;
+
+Renderer::ShadowCasterCuller::ShadowCasterCuller()
+{
+	BeginFrame(SimpleMath::Matrix::Identity);
+}
+
+Renderer::ShadowCasterCuller::~ShadowCasterCuller()
+{
+
+}
+
+void Renderer::ShadowCasterCuller::BeginFrame(const DirectX::SimpleMath::Matrix& InLightViewPrj)
+{
+	mLightViewPrj = InLightViewPrj;
+	mReceiverMin = { FLT_MAX, FLT_MAX };
+	mReceiverMax = { -FLT_MAX, -FLT_MAX };
+	mReceiverFarthestDepth = FLT_MAX;
+	mHasReceivers = false;
+	mStats = {};
+}
+
+Renderer::ShadowCasterCuller::LightSpaceBounds Renderer::ShadowCasterCuller::Project(const DirectX::BoundingBox& InWorldBounds) const
+{
+	constexpr float MIN_W = 1e-5f;
+	LightSpaceBounds lBounds = { {FLT_MAX, FLT_MAX}, {-FLT_MAX, -FLT_MAX}, 0.0f, FLT_MAX, false, false, false };
+	XMFLOAT3 lCorners[BoundingBox::CORNER_COUNT];
+	InWorldBounds.GetCorners(lCorners);
+	XMFLOAT4 lClip[BoundingBox::CORNER_COUNT];
+	XMVector3TransformStream(lClip, sizeof(XMFLOAT4), lCorners, sizeof(XMFLOAT3), BoundingBox::CORNER_COUNT, mLightViewPrj);
+
+	//Side planes only,in homogeneous form so the test holds for corners behind the light too.
+	uint32_t lAllOutside = 0xf;
+	uint32_t lBehindCount = 0;
+	for (const auto& c : lClip)
+	{
+		uint32_t lCode = 0;
+		lCode |= c.x < -c.w ? 0x1 : 0;
+		lCode |= c.x > c.w ? 0x2 : 0;
+		lCode |= c.y < -c.w ? 0x4 : 0;
+		lCode |= c.y > c.w ? 0x8 : 0;
+		lAllOutside &= lCode;
+		if (c.w <= MIN_W)
+		{
+			lBehindCount++;
+			continue;
+		}
+		float lInvW = 1.0f / c.w;
+		lBounds.mMin.x = std::min(lBounds.mMin.x, c.x * lInvW);
+		lBounds.mMin.y = std::min(lBounds.mMin.y, c.y * lInvW);
+		lBounds.mMax.x = std::max(lBounds.mMax.x, c.x * lInvW);
+		lBounds.mMax.y = std::max(lBounds.mMax.y, c.y * lInvW);
+		//Reversed Z:larger is nearer to the light.
+		lBounds.mNearestDepth = std::max(lBounds.mNearestDepth, c.z * lInvW);
+		lBounds.mFarthestDepth = std::min(lBounds.mFarthestDepth, c.z * lInvW);
+	}
+	lBounds.mOutsideFrustum = lAllOutside != 0;
+	lBounds.mBehindLight = lBehindCount == BoundingBox::CORNER_COUNT;
+	lBounds.mCrossLightPlane = lBehindCount > 0 && !lBounds.mBehindLight;
+	return lBounds;
+}
+
+void Renderer::ShadowCasterCuller::AddReceiver(const DirectX::BoundingBox& InWorldBounds)
+{
+	auto lBounds = Project(InWorldBounds);
+	if (lBounds.mOutsideFrustum || lBounds.mBehindLight)
+	{
+		//Not covered by the shadow map,this receiver never samples it.
+		return;
+	}
+	mHasReceivers = true;
+	if (lBounds.mCrossLightPlane)
+	{
+		mReceiverMin = { -1.0f, -1.0f };
+		mReceiverMax = { 1.0f, 1.0f };
+		mReceiverFarthestDepth = 0.0f;
+		return;
+	}
+	mReceiverMin.x = std::max(-1.0f, std::min(mReceiverMin.x, lBounds.mMin.x));
+	mReceiverMin.y = std::max(-1.0f, std::min(mReceiverMin.y, lBounds.mMin.y));
+	mReceiverMax.x = std::min(1.0f, std::max(mReceiverMax.x, lBounds.mMax.x));
+	mReceiverMax.y = std::min(1.0f, std::max(mReceiverMax.y, lBounds.mMax.y));
+	mReceiverFarthestDepth = std::min(mReceiverFarthestDepth, lBounds.mFarthestDepth);
+}
+
+bool Renderer::ShadowCasterCuller::IsCasterRelevant(const DirectX::BoundingBox& InWorldBounds) const
+{
+	if (!mHasReceivers)
+	{
+		return false;
+	}
+	auto lBounds = Project(InWorldBounds);
+	if (lBounds.mOutsideFrustum || lBounds.mBehindLight)
+	{
+		return false;
+	}
+	if (lBounds.mCrossLightPlane)
+	{
+		return true;
+	}
+	if (lBounds.mMax.x < mReceiverMin.x || lBounds.mMin.x > mReceiverMax.x ||
+		lBounds.mMax.y < mReceiverMin.y || lBounds.mMin.y > mReceiverMax.y)
+	{
+		return false;
+	}
+	//Every point of the caster is farther from the light than every receiver.
+	return lBounds.mNearestDepth >= mReceiverFarthestDepth;
+}
+
+bool Renderer::ShadowCasterCuller::AddCandidate(const DirectX::BoundingBox& InLocalBounds, const DirectX::SimpleMath::Matrix& InModel, bool InCastShadow, bool InCullCasters)
+{
+	mStats.mCandidates++;
+	if (!InCastShadow)
+	{
+		mStats.mOptedOut++;
+		return false;
+	}
+	BoundingBox lWorldBounds;
+	InLocalBounds.Transform(lWorldBounds, InModel);
+	if (InCullCasters && !IsCasterRelevant(lWorldBounds))
+	{
+		mStats.mCulled++;
+		return false;
+	}
+	mStats.mCasters++;
+	return true;
+}
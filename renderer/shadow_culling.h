@@ -0,0 +1,60 @@
+#pragma once
+
+namespace Renderer
+{
+	struct ShadowCullStats
+	{
+		uint32_t mCandidates = 0;
+		uint32_t mCasters = 0;
+		uint32_t mCulled = 0;
+		uint32_t mOptedOut = 0;
+	};
+
+	//Rejects shadow casters in the light's clip space.
+	//Receivers (the entities visible to the main camera) are reduced to an xy rect and their farthest depth from the light,
+	//a caster is kept when its light space rect overlaps the receiver rect and it is not entirely behind every receiver.
+	//The near plane of the light is ignored so casters between the light and the shadow frustum are kept.
+	class ShadowCasterCuller
+	{
+	public:
+		ShadowCasterCuller();
+
+		~ShadowCasterCuller();
+
+		//InLightViewPrj is the row vector view projection matrix of the shadow camera,reversed Z.
+		void BeginFrame(const DirectX::SimpleMath::Matrix& InLightViewPrj);
+
+		void AddReceiver(const DirectX::BoundingBox& InWorldBounds);
+
+		bool HasReceivers() const { return mHasReceivers; }
+
+		bool IsCasterRelevant(const DirectX::BoundingBox& InWorldBounds) const;
+
+		//Count one mesh of the scene,returns true when it has to be drawn into the shadow map.
+		//Meshes that opted out of shadows are only counted as such,InCullCasters false keeps every other mesh.
+		bool AddCandidate(const DirectX::BoundingBox& InLocalBounds, const DirectX::SimpleMath::Matrix& InModel, bool InCastShadow, bool InCullCasters);
+
+		const ShadowCullStats& GetStats() const { return mStats; }
+
+	private:
+		struct LightSpaceBounds
+		{
+			DirectX::XMFLOAT2 mMin;
+			DirectX::XMFLOAT2 mMax;
+			float mNearestDepth;
+			float mFarthestDepth;
+			bool mOutsideFrustum;
+			bool mBehindLight;
+			bool mCrossLightPlane;
+		};
+
+		LightSpaceBounds Project(const DirectX::BoundingBox& InWorldBounds) const;
+
+		DirectX::SimpleMath::Matrix mLightViewPrj;
+		DirectX::XMFLOAT2 mReceiverMin;
+		DirectX::XMFLOAT2 mReceiverMax;
+		float mReceiverFarthestDepth;
+		bool mHasReceivers;
+		ShadowCullStats mStats;
+	};
+}
@@ -22,8 +22,9 @@ void Renderer::SkyboxPass::CreateMesh()
 	AssetLoader::ObjModelLoader* objLoader = AssetLoader::gObjModelLoader;
 	auto mesh = objLoader->LoadAssetFromFile("cube.obj");
 	Ensures(!mesh.empty());
-	mStaticMeshComponent = std::make_shared<ECS::StaticMeshComponent>(std::move(mesh[0]));
-	mContext->LoadStaticMeshToGpu(*mStaticMeshComponent);
+	mStaticMeshComponent = std::make_shared<ECS::StaticMeshComponent>(mMeshStore.Add(std::move(mesh[0])));
+	mContext->LoadStaticMeshToGpu(*mStaticMeshComponent, mMeshStore.GetMesh(mStaticMeshComponent->mMesh));
+	mContext->FlushUploads();
 }
 
 void Renderer::SkyboxPass::CreateTextures()
@@ -81,7 +82,7 @@ Renderer::SkyboxPass::~SkyboxPass()
 void Renderer::SkyboxPass::RenderScene(ID3D12GraphicsCommandList* InCmdList)
 {
 	mGraphicsCmd->SetGraphicsRootDescriptorTable(1, mSkyboxTexture->GetSRVGpu());
-	DrawObject(*mStaticMeshComponent);
+	DrawObject(*mStaticMeshComponent, mMeshStore.GetSubMeshes(*mStaticMeshComponent));
 }
 
 void Renderer::SkyboxPass::CreatePipelineState()
@@ -1,6 +1,6 @@
 #pragma once
 #include "render_pass.h"
-#include "components.h"
+#include "mesh_store.h"
 
 namespace DirectX
 {
@@ -39,6 +39,8 @@ namespace Renderer
 
 		std::shared_ptr<ECS::StaticMeshComponent> mStaticMeshComponent;
 
+		ECS::MeshStore mMeshStore;
+
 		std::shared_ptr<Resource::Texture> mSkyboxTexture;
 
 	};
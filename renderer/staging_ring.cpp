@@ -0,0 +1,167 @@
+#include "staging_ring.h"
+#include "device_manager.h"
+
+Renderer::StagingRing::StagingRing(uint64_t InCapacity):
+	mCapacity(InCapacity)
+{
+	Expects(InCapacity > 0);
+}
+
+Renderer::StagingRing::~StagingRing()
+{
+
+}
+
+uint64_t Renderer::StagingRing::Allocate(uint64_t InSize, uint64_t InAlignment)
+{
+	Expects(InSize > 0 && InSize <= mCapacity && InAlignment > 0 && mCapacity % InAlignment == 0);
+	if (GetUsed() == 0)
+	{
+		//Empty,start over at the front so the whole capacity is available.
+		mHead = mTail = mRetiredHead = (mHead + mCapacity - 1) / mCapacity * mCapacity;
+	}
+	const uint64_t lPosition = mHead % mCapacity;
+	uint64_t lOffset = (lPosition + InAlignment - 1) / InAlignment * InAlignment;
+	//No allocation straddles the end,the rest of the ring is skipped and freed with it.
+	if (lOffset + InSize > mCapacity)
+	{
+		lOffset = mCapacity;
+	}
+	const uint64_t lNeeded = lOffset - lPosition + InSize;
+	if (GetUsed() + lNeeded > mCapacity)
+	{
+		return UINT64_MAX;
+	}
+	mHead += lNeeded;
+	return lOffset % mCapacity;
+}
+
+void Renderer::StagingRing::Retire(uint64_t InFenceValue)
+{
+	if (!HasUnretired())
+	{
+		return;
+	}
+	Expects(mRetired.empty() || mRetired.back().mFenceValue <= InFenceValue);
+	mRetired.push_back({ InFenceValue, mHead });
+	mRetiredHead = mHead;
+}
+
+void Renderer::StagingRing::Reclaim(uint64_t InCompletedValue)
+{
+	while (!mRetired.empty() && mRetired.front().mFenceValue <= InCompletedValue)
+	{
+		mTail = mRetired.front().mEnd;
+		mRetired.pop_front();
+	}
+}
+
+Renderer::StagingUploader::StagingUploader(std::shared_ptr<CmdManager> InCmdManager, uint64_t InCapacity):
+	mCmdManager(InCmdManager),
+	mTimeline(std::make_unique<D3D12TimelineQueue>(InCmdManager->GetQueue(D3D12_COMMAND_LIST_TYPE_COPY), L"StagingTimeline")),
+	mBuffer(std::make_unique<Resource::UploadBuffer>()),
+	mRing(InCapacity)
+{
+	mBuffer->Create(L"StagingRing", InCapacity);
+	mData = mBuffer->MapPersistent();
+	mCmd = mCmdManager->AllocateCmdList(D3D12_COMMAND_LIST_TYPE_COPY);
+}
+
+Renderer::StagingUploader::~StagingUploader()
+{
+	Flush();
+	mCmd->Release();
+}
+
+void Renderer::StagingUploader::Stage(ID3D12Resource* InDest, uint64_t InDestOffset, const void* InData, uint64_t InSize)
+{
+	std::lock_guard lock(mMutex);
+	const uint8_t* lData = static_cast<const uint8_t*>(InData);
+	while (InSize > 0)
+	{
+		const uint64_t lChunk = std::min(InSize, MaxChunk());
+		mRing.Reclaim(mTimeline->GetCompletedValue());
+		uint64_t lOffset = mRing.Allocate(lChunk, COPY_ALIGNMENT);
+		while (lOffset == UINT64_MAX)
+		{
+			//Out of space:the batch so far goes to the queue and the CPU waits for the oldest batch to land.
+			if (mRing.HasUnretired())
+			{
+				SubmitLocked();
+			}
+			Ensures(mRing.GetOldestRetired() != 0);
+			mStats.mWaits++;
+			mTimeline->WaitForValue(mRing.GetOldestRetired());
+			mRing.Reclaim(mTimeline->GetCompletedValue());
+			lOffset = mRing.Allocate(lChunk, COPY_ALIGNMENT);
+		}
+		memcpy(mData + lOffset, lData, lChunk);
+		OpenBatch();
+		mCmd->CopyBufferRegion(InDest, InDestOffset, mBuffer->GetResource(), lOffset, lChunk);
+		mStats.mStagedBytes += lChunk;
+		mStats.mCopies++;
+		lData += lChunk;
+		InDestOffset += lChunk;
+		InSize -= lChunk;
+	}
+}
+
+void Renderer::StagingUploader::Copy(ID3D12Resource* InDest, uint64_t InDestOffset, ID3D12Resource* InSource, uint64_t InSourceOffset, uint64_t InSize)
+{
+	Expects(InDest != InSource || InDestOffset + InSize <= InSourceOffset || InSourceOffset + InSize <= InDestOffset);
+	std::lock_guard lock(mMutex);
+	OpenBatch();
+	mCmd->CopyBufferRegion(InDest, InDestOffset, InSource, InSourceOffset, InSize);
+	mStats.mCopies++;
+}
+
+void Renderer::StagingUploader::OpenBatch()
+{
+	if (mAllocator)
+	{
+		return;
+	}
+	mAllocator = mCmdManager->RequestAllocator(D3D12_COMMAND_LIST_TYPE_COPY, mTimeline->GetCompletedValue());
+	Ensures(mCmd->Reset(mAllocator, nullptr) == S_OK);
+}
+
+uint64_t Renderer::StagingUploader::Submit()
+{
+	std::lock_guard lock(mMutex);
+	return SubmitLocked();
+}
+
+uint64_t Renderer::StagingUploader::SubmitLocked()
+{
+	if (!mAllocator)
+	{
+		return mTimeline->GetLastSignaled();
+	}
+	Ensures(mCmd->Close() == S_OK);
+	ID3D12CommandList* lCmds[] = { mCmd };
+	mTimeline->GetQueue()->ExecuteCommandLists(1, lCmds);
+	const uint64_t lValue = mTimeline->Signal();
+	mCmdManager->Discard(D3D12_COMMAND_LIST_TYPE_COPY, mAllocator, lValue);
+	mAllocator = nullptr;
+	mRing.Retire(lValue);
+	mStats.mSubmits++;
+	return lValue;
+}
+
+void Renderer::StagingUploader::Flush()
+{
+	std::lock_guard lock(mMutex);
+	const uint64_t lValue = SubmitLocked();
+	if (!mTimeline->IsComplete(lValue))
+	{
+		mStats.mWaits++;
+		mTimeline->WaitForValue(lValue);
+	}
+	mRing.Reclaim(mTimeline->GetCompletedValue());
+}
+
+Renderer::StagingStats Renderer::StagingUploader::GetStats()
+{
+	std::lock_guard lock(mMutex);
+	return mStats;
+}
@@ -0,0 +1,119 @@
+#pragma once
+#include "frame_timeline.h"
+#include <deque>
+
+namespace Renderer
+{
+	namespace Resource
+	{
+		class UploadBuffer;
+	}
+
+	//Sub-allocates a fixed range front to back and wraps around.Space is handed back in the order it was allocated:
+	//Retire tags everything allocated since the previous call with a fence value,Reclaim frees the tagged spans
+	//whose value completed.Works on offsets only,fake fence values drive it as well as a TimelineQueue.
+	class StagingRing
+	{
+	public:
+		StagingRing(uint64_t InCapacity);
+
+		~StagingRing();
+
+		//Offset of InSize bytes aligned to InAlignment,UINT64_MAX while the free space cannot hold them.
+		//InAlignment has to divide the capacity.
+		uint64_t Allocate(uint64_t InSize, uint64_t InAlignment);
+
+		//Everything allocated since the last call is free once InFenceValue completed.
+		void Retire(uint64_t InFenceValue);
+
+		//Free the spans of every retirement up to InCompletedValue.
+		void Reclaim(uint64_t InCompletedValue);
+
+		//Fence value the oldest retired span waits for,0 when nothing is retired.
+		uint64_t GetOldestRetired() const { return mRetired.empty() ? 0 : mRetired.front().mFenceValue; }
+
+		//Allocated since the last Retire.
+		bool HasUnretired() const { return mHead != mRetiredHead; }
+
+		uint64_t GetCapacity() const { return mCapacity; }
+
+		//Bytes not yet reclaimed,including padding skipped at the end when an allocation wrapped.
+		uint64_t GetUsed() const { return mHead - mTail; }
+
+	private:
+		struct RetiredSpan
+		{
+			uint64_t mFenceValue;
+			uint64_t mEnd;
+		};
+
+		uint64_t mCapacity;
+		//Running byte counts,the ring position is the count modulo the capacity.
+		uint64_t mHead = 0;
+		uint64_t mTail = 0;
+		uint64_t mRetiredHead = 0;
+		std::deque<RetiredSpan> mRetired;
+	};
+
+	struct StagingStats
+	{
+		uint64_t mStagedBytes = 0;
+		uint32_t mCopies = 0;
+		uint32_t mSubmits = 0;
+		//CPU waits for ring space or for a flush.
+		uint32_t mWaits = 0;
+	};
+
+	//Copies into GPU buffers through a persistently mapped StagingRing on the copy queue.
+	//Stage only records the copy,copies are submitted in batches when the ring runs out of space or on Flush,
+	//so loading many meshes costs one submission and at most one wait per batch instead of one per mesh.
+	//Destinations must be in a state the copy queue can write,buffers in COMMON are promoted.
+	class StagingUploader
+	{
+	public:
+		static constexpr uint64_t DEFAULT_CAPACITY = 64ull * 1024 * 1024;
+
+		StagingUploader(std::shared_ptr<class CmdManager> InCmdManager, uint64_t InCapacity = DEFAULT_CAPACITY);
+
+		~StagingUploader();
+
+		//Copy InSize bytes to InDest at InDestOffset,larger uploads than the ring are split.Safe from any thread.
+		void Stage(ID3D12Resource* InDest, uint64_t InDestOffset, const void* InData, uint64_t InSize);
+
+		//Copy between GPU buffers in the same batch as the staged uploads.Ranges of one resource must not overlap.
+		void Copy(ID3D12Resource* InDest, uint64_t InDestOffset, ID3D12Resource* InSource, uint64_t InSourceOffset, uint64_t InSize);
+
+		//Submit what was staged,returns the copy timeline value it completes at.
+		uint64_t Submit();
+
+		//Submit and block until every staged copy landed.
+		void Flush();
+
+		TimelineQueue& GetTimeline() { return *mTimeline; }
+
+		StagingStats GetStats();
+
+	private:
+		//Caller holds mMutex.
+		uint64_t SubmitLocked();
+
+		//Caller holds mMutex.
+		void OpenBatch();
+
+		//Most of the ring one copy may take,keeps a wrapping split from waiting on itself.
+		uint64_t MaxChunk() const { return mRing.GetCapacity() / 2; }
+
+		static constexpr uint64_t COPY_ALIGNMENT = 16;
+
+		std::shared_ptr<class CmdManager> mCmdManager;
+		std::unique_ptr<D3D12TimelineQueue> mTimeline;
+		std::unique_ptr<Resource::UploadBuffer> mBuffer;
+		uint8_t* mData = nullptr;
+		StagingRing mRing;
+		ID3D12GraphicsCommandList* mCmd = nullptr;
+		//Open batch,null between submissions.
+		ID3D12CommandAllocator* mAllocator = nullptr;
+		StagingStats mStats;
+		std::mutex mMutex;
+	};
+}
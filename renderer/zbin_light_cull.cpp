@@ -0,0 +1,194 @@
+#include "zbin_light_cull.h"
+
+using namespace DirectX;
+
+namespace
+{
+	//Conservative tile rect of a view space sphere,the corners of its view space box are projected.
+	Renderer::ZBinTileRect ComputeTileRect(const Renderer::FrameData& InFrame, const XMFLOAT4& InViewPos, float InRadius,
+		uint32_t InWidth, uint32_t InHeight, uint32_t InTileCountX, uint32_t InTileCountY)
+	{
+		const Renderer::ZBinTileRect lFullScreen = { 0, 0, int32_t(InTileCountX) - 1, int32_t(InTileCountY) - 1 };
+		float lMinX = FLT_MAX, lMinY = FLT_MAX, lMaxX = -FLT_MAX, lMaxY = -FLT_MAX;
+		for (int c = 0; c < 8; ++c)
+		{
+			XMFLOAT4 lCorner = {
+				InViewPos.x + ((c & 1) ? InRadius : -InRadius),
+				InViewPos.y + ((c & 2) ? InRadius : -InRadius),
+				InViewPos.z + ((c & 4) ? InRadius : -InRadius),
+				1.0f };
+			XMFLOAT4 lClip = Renderer::Utils::ShaderMul(lCorner, InFrame.Prj);
+			//The box reaches behind the eye,its projection is unbounded.
+			if (lClip.w <= 0.0f)
+			{
+				return lFullScreen;
+			}
+			float lNdcX = lClip.x / lClip.w;
+			float lNdcY = lClip.y / lClip.w;
+			lMinX = std::min(lMinX, lNdcX);
+			lMaxX = std::max(lMaxX, lNdcX);
+			lMinY = std::min(lMinY, lNdcY);
+			lMaxY = std::max(lMaxY, lNdcY);
+		}
+		//NDC y points up,pixel y points down.
+		float lPixelMinX = (lMinX * 0.5f + 0.5f) * InWidth;
+		float lPixelMaxX = (lMaxX * 0.5f + 0.5f) * InWidth;
+		float lPixelMinY = (0.5f - lMaxY * 0.5f) * InHeight;
+		float lPixelMaxY = (0.5f - lMinY * 0.5f) * InHeight;
+		if (lPixelMaxX < 0.0f || lPixelMaxY < 0.0f || lPixelMinX >= InWidth || lPixelMinY >= InHeight)
+		{
+			return { 0, 0, -1, -1 };
+		}
+		//Clamp before converting,a box just in front of the eye projects far outside the screen.
+		lPixelMinX = std::max(lPixelMinX, 0.0f);
+		lPixelMinY = std::max(lPixelMinY, 0.0f);
+		lPixelMaxX = std::min(lPixelMaxX, float(InWidth - 1));
+		lPixelMaxY = std::min(lPixelMaxY, float(InHeight - 1));
+		return {
+			int32_t(lPixelMinX) / Renderer::ZBIN_TILE_SIZE,
+			int32_t(lPixelMinY) / Renderer::ZBIN_TILE_SIZE,
+			int32_t(lPixelMaxX) / Renderer::ZBIN_TILE_SIZE,
+			int32_t(lPixelMaxY) / Renderer::ZBIN_TILE_SIZE };
+	}
+}
+
+Renderer::ZBinLightCuller::ZBinLightCuller(tf::Executor& InExecutor) :
+	mExecutor(InExecutor),
+	mBins(ZBIN_COUNT)
+{
+
+}
+
+Renderer::ZBinLightCuller::~ZBinLightCuller()
+{
+
+}
+
+void Renderer::ZBinLightCuller::Cull(const FrameData& InFrame, std::span<const ECS::LigthData> InLights, uint32_t InWidth, uint32_t InHeight, bool InBuildMasks)
+{
+	auto lStart = std::chrono::steady_clock::now();
+	mStats = {};
+	const uint32_t lCount = std::min(InFrame.LightCount, (uint32_t)InLights.size());
+	mTileCountX = GetTileCount(InWidth);
+	mTileCountY = GetTileCount(InHeight);
+	mWordsPerTile = GetWordsPerTile(lCount);
+
+	//View depth is clip w,the same value the pixel shader reads from SV_Position.w.
+	std::vector<XMFLOAT4> lViewPositions(lCount);
+	mDepthMin.resize(lCount);
+	mDepthMax.resize(lCount);
+	for (uint32_t i = 0; i < lCount; ++i)
+	{
+		//Bins and tiles are conservative over the bounding sphere,spot and capsule shapes are not tested here.
+		const auto& lBounds = InLights[i].bounds;
+		lViewPositions[i] = Utils::ShaderMul(XMFLOAT4(lBounds.x, lBounds.y, lBounds.z, 1.0f), InFrame.ViewMatrix);
+		float lDepth = Utils::ShaderMul(lViewPositions[i], InFrame.Prj).w;
+		float lRadius = lBounds.w;
+		mDepthMin[i] = lDepth - lRadius;
+		mDepthMax[i] = lDepth + lRadius;
+	}
+	mLightOrder.resize(lCount);
+	std::iota(mLightOrder.begin(), mLightOrder.end(), 0u);
+	//Ties keep the light buffer order so the result does not depend on the sort implementation.
+	std::sort(mLightOrder.begin(), mLightOrder.end(), [this](uint32_t InA, uint32_t InB)
+		{
+			return mDepthMin[InA] != mDepthMin[InB] ? mDepthMin[InA] < mDepthMin[InB] : InA < InB;
+		});
+
+	std::fill(mBins.begin(), mBins.end(), ZBin{ UINT32_MAX, 0 });
+	mTileRects.resize(lCount);
+	for (uint32_t s = 0; s < lCount; ++s)
+	{
+		uint32_t lLight = mLightOrder[s];
+		if (mDepthMax[lLight] < 0.0f)
+		{
+			//Behind the eye.
+			mTileRects[s] = { 0, 0, -1, -1 };
+			continue;
+		}
+		//Same mapping as the pixel shader,depths past the far plane land in the last bin.
+		const float lLastBinF = float(ZBIN_COUNT - 1);
+		int32_t lFirstBin = int32_t(std::min(std::max(mDepthMin[lLight], 0.0f) * InFrame.ZBinScale, lLastBinF));
+		int32_t lLastBin = int32_t(std::min(mDepthMax[lLight] * InFrame.ZBinScale, lLastBinF));
+		for (int32_t b = lFirstBin; b <= lLastBin; ++b)
+		{
+			//Sorted positions only grow,so the first light to touch a bin is its minimum.
+			mBins[b].mMin = std::min(mBins[b].mMin, s);
+			mBins[b].mMax = s;
+		}
+		mTileRects[s] = ComputeTileRect(InFrame, lViewPositions[lLight], InLights[lLight].bounds.w, InWidth, InHeight, mTileCountX, mTileCountY);
+	}
+	for (const auto& bin : mBins)
+	{
+		mStats.mUsedBins += bin.mMin <= bin.mMax;
+	}
+
+	mTileMasks.resize(size_t(mTileCountX) * mTileCountY * mWordsPerTile);
+	if (InBuildMasks)
+	{
+		if (!mFlow || mFlowRows != mTileCountY)
+		{
+			mFlow = std::make_unique<tf::Taskflow>("ZBinLightCull");
+			mFlow->for_each_index(0u, mTileCountY, 1u, [this](uint32_t InTileY) { BuildMaskRow(InTileY); });
+			mFlowRows = mTileCountY;
+		}
+		//The renderer calls this from a task of the same executor,a blocking wait there could starve the pool.
+		if (mExecutor.this_worker_id() >= 0)
+		{
+			mExecutor.corun(*mFlow);
+		}
+		else
+		{
+			mExecutor.run(*mFlow).wait();
+		}
+		for (auto word : mTileMasks)
+		{
+			mStats.mTileAssignments += std::popcount(word);
+		}
+	}
+
+	mStats.mLights = lCount;
+	mStats.mTiles = mTileCountX * mTileCountY;
+	mStats.mWordsPerTile = mWordsPerTile;
+	mStats.mMemoryBytes = uint32_t(mBins.size() * sizeof(ZBin) + mLightOrder.size() * sizeof(uint32_t) + mTileMasks.size() * sizeof(uint32_t));
+	mStats.mCullMs = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - lStart).count();
+}
+
+uint32_t Renderer::ZBinLightCuller::Compare(std::span<const uint32_t> InGpuTileMasks)
+{
+	Expects(InGpuTileMasks.size() >= mTileMasks.size());
+	mStats.mMismatchedTiles = 0;
+	mStats.mMismatchedBits = 0;
+	for (size_t t = 0; t < mStats.mTiles; ++t)
+	{
+		uint32_t lBits = 0;
+		for (size_t w = 0; w < mWordsPerTile; ++w)
+		{
+			size_t lWord = t * mWordsPerTile + w;
+			lBits += std::popcount(mTileMasks[lWord] ^ InGpuTileMasks[lWord]);
+		}
+		mStats.mMismatchedTiles += lBits != 0;
+		mStats.mMismatchedBits += lBits;
+	}
+	return mStats.mMismatchedTiles;
+}
+
+void Renderer::ZBinLightCuller::BuildMaskRow(uint32_t InTileY)
+{
+	uint32_t* lRow = mTileMasks.data() + size_t(InTileY) * mTileCountX * mWordsPerTile;
+	std::fill_n(lRow, size_t(mTileCountX) * mWordsPerTile, 0u);
+	const int32_t lTileY = int32_t(InTileY);
+	for (uint32_t s = 0; s < (uint32_t)mTileRects.size(); ++s)
+	{
+		const auto& lRect = mTileRects[s];
+		if (lTileY < lRect.mMinY || lTileY > lRect.mMaxY)
+		{
+			continue;
+		}
+		const uint32_t lBit = 1u << (s % 32);
+		for (int32_t x = lRect.mMinX; x <= lRect.mMaxX; ++x)
+		{
+			lRow[size_t(x) * mWordsPerTile + s / 32] |= lBit;
+		}
+	}
+}
@@ -0,0 +1,92 @@
+#pragma once
+#include "renderer_common.h"
+
+namespace Renderer
+{
+	struct ZBinCullStats
+	{
+		uint32_t mLights = 0;
+		uint32_t mUsedBins = 0;
+		uint32_t mTiles = 0;
+		uint32_t mWordsPerTile = 0;
+		//Set tile mask bits,i.e. light and tile overlaps.Only counted when the masks are built on the CPU.
+		uint32_t mTileAssignments = 0;
+		//Bins,light order and tile masks.
+		uint32_t mMemoryBytes = 0;
+		float mCullMs = 0.0f;
+		//Filled by validation against the GPU tile masks.
+		uint32_t mMismatchedTiles = 0;
+		uint32_t mMismatchedBits = 0;
+	};
+
+	//Positions in the depth sorted light order touching one depth bin,empty when mMin > mMax.
+	struct ZBin
+	{
+		uint32_t mMin;
+		uint32_t mMax;
+	};
+
+	//Screen tiles covered by a light,inclusive,empty when mMinX > mMaxX.
+	struct ZBinTileRect
+	{
+		int32_t mMinX;
+		int32_t mMinY;
+		int32_t mMaxX;
+		int32_t mMaxY;
+	};
+
+	//Z-binned light culling,the alternative to the cluster grid.
+	//Lights are sorted by view depth,every depth bin stores the range of sorted positions it overlaps
+	//and every screen tile stores one bit per sorted light.A pixel walks the words of its tile mask inside its bin's range.
+	//Memory scales with tiles * lights / 32 instead of with the cluster count.
+	//Sorting,bins and tile rects are always built here,the tile masks are expanded from the rects on the GPU
+	//or here for validation and the CPU fallback.
+	class ZBinLightCuller
+	{
+	public:
+		ZBinLightCuller(tf::Executor& InExecutor);
+
+		~ZBinLightCuller();
+
+		//InFrame is the GPU copy,matrices are transposed exactly as the shaders read them.
+		void Cull(const FrameData& InFrame, std::span<const ECS::LigthData> InLights, uint32_t InWidth, uint32_t InHeight, bool InBuildMasks);
+
+		//Diff against tile masks read back from the GPU,the result is also written to the stats.
+		uint32_t Compare(std::span<const uint32_t> InGpuTileMasks);
+
+		static uint32_t GetWordsPerTile(uint32_t InLights) { return std::max(1u, (InLights + 31) / 32); }
+
+		static uint32_t GetTileCount(uint32_t InPixels) { return (InPixels + ZBIN_TILE_SIZE - 1) / ZBIN_TILE_SIZE; }
+
+		std::span<const ZBin> GetBins() const { return mBins; }
+
+		//Light buffer index per sorted position.
+		std::span<const uint32_t> GetLightOrder() const { return mLightOrder; }
+
+		//Per sorted position.
+		std::span<const ZBinTileRect> GetTileRects() const { return mTileRects; }
+
+		std::span<const uint32_t> GetTileMasks() const { return mTileMasks; }
+
+		const ZBinCullStats& GetStats() const { return mStats; }
+
+	private:
+		void BuildMaskRow(uint32_t InTileY);
+
+		tf::Executor& mExecutor;
+		//One task per tile row,rebuilt when the row count changes.
+		std::unique_ptr<tf::Taskflow> mFlow;
+		uint32_t mFlowRows = 0;
+		uint32_t mTileCountX = 0;
+		uint32_t mTileCountY = 0;
+		uint32_t mWordsPerTile = 0;
+		std::vector<ZBin> mBins;
+		std::vector<uint32_t> mLightOrder;
+		std::vector<ZBinTileRect> mTileRects;
+		std::vector<uint32_t> mTileMasks;
+		//Scratch:view depth range per light.
+		std::vector<float> mDepthMin;
+		std::vector<float> mDepthMax;
+		ZBinCullStats mStats;
+	};
+}
@@ -0,0 +1,203 @@
+#include "asset_registry.h"
+#include "game_scene.h"
+#include "synthetic_scene.h"
+#include <catch2/catch.hpp>
+#include <spdlog/sinks/ostream_sink.h>
+
+using namespace AssetLoader;
+
+namespace
+{
+	std::unique_ptr<TextureData> MakeTexture(int InSize)
+	{
+		auto lTexture = std::make_unique<TextureData>();
+		lTexture->mWidth = InSize;
+		lTexture->mHeight = InSize;
+		lTexture->mComponent = 4;
+		lTexture->mdata = new uint8_t[size_t(InSize) * InSize * 4];
+		return lTexture;
+	}
+
+	//Exposes the load steps GameScene runs for a model file,without a file to parse.
+	class LoadCycleScene : public GAS::GameScene
+	{
+	public:
+		using GameScene::RecordMeshEntities;
+		using GameScene::AcquireTexture;
+		using GameScene::MergeTextures;
+	};
+
+	//What CreateEntitiesWithMesh records:textures acquired on the loader side,merged and meshes added on playback.
+	void LoadFile(LoadCycleScene& InScene, uint32_t InMeshes, const std::vector<std::string>& InTextureNames)
+	{
+		std::unordered_map<std::string, TextureHandle> lTextures;
+		for (const auto& name : InTextureNames)
+		{
+			lTextures[name] = InScene.AcquireTexture(name, MakeTexture(8));
+		}
+		std::vector<ECS::StaticMesh> lModels;
+		for (uint32_t i = 0; i < InMeshes; ++i)
+		{
+			auto lMesh = Synthetic::MakeCubeStaticMesh(2, "mesh" + std::to_string(i));
+			lMesh.Scale = DirectX::SimpleMath::Vector3(1.0f, 1.0f, 1.0f);
+			lMesh.mMatBaseColorName[0] = InTextureNames[i % InTextureNames.size()];
+			lModels.push_back(std::move(lMesh));
+		}
+		ECS::EntityCommandBuffer lCommands;
+		lCommands.Run([&InScene, lTextures](entt::registry&, std::span<entt::entity>)
+			{
+				InScene.MergeTextures(lTextures);
+			});
+		InScene.RecordMeshEntities(lCommands, lModels, lTextures);
+		InScene.Submit(std::move(lCommands));
+	}
+
+	//Routes gLogger into a string for the lifetime of the capture.
+	struct ScopedLogCapture
+	{
+		ScopedLogCapture():
+			mPrevious(gLogger)
+		{
+			gLogger = std::make_shared<spdlog::logger>("capture", std::make_shared<spdlog::sinks::ostream_sink_st>(mStream));
+			gLogger->set_pattern("%v");
+		}
+
+		~ScopedLogCapture()
+		{
+			gLogger = mPrevious;
+		}
+
+		std::ostringstream mStream;
+		std::shared_ptr<spdlog::logger> mPrevious;
+	};
+}
+
+TEST_CASE("Asset pool references balance before the slot is freed", "[asset_registry]")
+{
+	AssetPool<TextureData> lPool;
+	auto lHandle = lPool.Add("albedo", MakeTexture(4));
+	REQUIRE(lHandle.IsValid());
+	CHECK(lPool.Find("albedo") == lHandle);
+	CHECK(lPool.GetName(lHandle) == "albedo");
+	CHECK(lPool.GetStats().mCpuBytes == 64);
+
+	REQUIRE(lPool.AddRef(lHandle, Residency::CPU));
+	REQUIRE(lPool.AddRef(lHandle, Residency::GPU));
+	lPool.Release(lHandle, Residency::CPU);
+	CHECK(lPool.Get(lHandle) != nullptr);
+
+	//The last CPU reference drops the CPU copy,the GPU reference keeps the slot.
+	lPool.Release(lHandle, Residency::CPU);
+	CHECK(lPool.IsAlive(lHandle));
+	CHECK(lPool.Get(lHandle) == nullptr);
+	auto lStats = lPool.GetStats();
+	CHECK(lStats.mLive == 1);
+	CHECK(lStats.mCpuResident == 0);
+	CHECK(lStats.mGpuResident == 1);
+	CHECK(lStats.mCpuBytes == 0);
+
+	lPool.Release(lHandle, Residency::GPU);
+	CHECK_FALSE(lPool.IsAlive(lHandle));
+	CHECK(lPool.GetStats().mLive == 0);
+	CHECK(lPool.GetStats().mFreeSlots == 1);
+	CHECK_FALSE(lPool.Find("albedo").IsValid());
+}
+
+TEST_CASE("Stale handles are rejected once the slot generation moves on", "[asset_registry]")
+{
+	Synthetic::ScopedAssetRegistry lAssets;
+	AssetPool<TextureData> lPool;
+	auto lOld = lPool.Add("first", MakeTexture(2));
+	lPool.Release(lOld, Residency::CPU);
+
+	//The freed slot is recycled with the next generation.
+	auto lNew = lPool.Add("second", MakeTexture(2));
+	CHECK(lNew.mIndex == lOld.mIndex);
+	CHECK(lNew.mGeneration == lOld.mGeneration + 1);
+
+	CHECK_FALSE(lPool.IsAlive(lOld));
+	CHECK(lPool.Get(lOld) == nullptr);
+	CHECK(lPool.GetName(lOld).empty());
+	CHECK_FALSE(lPool.AddRef(lOld, Residency::CPU));
+	CHECK_FALSE(lPool.AddRef(lOld, Residency::GPU));
+	CHECK_FALSE(lPool.IsAlive(TextureHandle()));
+	CHECK_FALSE(lPool.IsAlive(TextureHandle{ 100, 0 }));
+
+	//Nothing taken through the stale handle touched the new asset.
+	CHECK(lPool.GetName(lNew) == "second");
+	lPool.Release(lNew, Residency::CPU);
+	CHECK_FALSE(lPool.IsAlive(lNew));
+}
+
+TEST_CASE("The GPU release callback runs once per last GPU reference", "[asset_registry]")
+{
+	Synthetic::ScopedAssetRegistry lAssets;
+	auto& lPool = gAssetRegistry->GetTextures();
+	std::vector<std::pair<TextureHandle, std::string>> lReleased;
+	lPool.SetGpuReleaseCallback([&](TextureHandle InHandle, const std::string& InName)
+		{
+			//Runs outside the pool lock,looking the asset up again must not deadlock.
+			CHECK(lPool.GetName(InHandle) == InName);
+			lReleased.emplace_back(InHandle, InName);
+		});
+
+	auto lHandle = lPool.Add("normal", MakeTexture(2));
+	lPool.AddRef(lHandle, Residency::GPU);
+	lPool.AddRef(lHandle, Residency::GPU);
+	lPool.Release(lHandle, Residency::GPU);
+	CHECK(lReleased.empty());
+	lPool.Release(lHandle, Residency::GPU);
+	REQUIRE(lReleased.size() == 1);
+	CHECK(lReleased[0].first == lHandle);
+	CHECK(lReleased[0].second == "normal");
+	//Still CPU resident,so the slot stays live and can be uploaded again.
+	CHECK(lPool.IsAlive(lHandle));
+
+	//Dropping the CPU copy alone never calls back.
+	lPool.Release(lHandle, Residency::CPU);
+	CHECK(lReleased.size() == 1);
+	CHECK_FALSE(lPool.IsAlive(lHandle));
+}
+
+TEST_CASE("Scene load and unload cycles leave the asset pools empty", "[asset_registry][game_scene]")
+{
+	Synthetic::ScopedAssetRegistry lAssets;
+	ScopedLogCapture lLog;
+	auto lScene = std::make_shared<LoadCycleScene>();
+	auto& lTextures = gAssetRegistry->GetTextures();
+	auto& lMeshes = gAssetRegistry->GetMeshes();
+	for (int cycle = 0; cycle < 4; ++cycle)
+	{
+		//Both files use "brick",the second load shares the live texture and its extra reference is dropped on merge.
+		LoadFile(*lScene, 6, { "brick", "roof" });
+		LoadFile(*lScene, 4, { "brick", "glass" });
+		lScene->PlaybackCommands();
+		CHECK(lScene->GetTextureMap().size() == 3);
+		CHECK(lScene->GetMeshStore().GetMeshHandles().size() == 10);
+		const auto lLoadedTextures = lTextures.GetStats();
+		CHECK(lLoadedTextures.mLive == 3);
+		CHECK(lLoadedTextures.mCpuBytes == 3 * 8 * 8 * 4);
+		const auto lLoadedMeshes = lMeshes.GetStats();
+		CHECK(lLoadedMeshes.mLive == 10);
+		CHECK(lLoadedMeshes.mCpuBytes > 0);
+
+		lLog.mStream.str("");
+		lScene->Unload();
+		CHECK(lScene->GetTextureMap().empty());
+		CHECK(lScene->GetMeshStore().GetMeshHandles().empty());
+		for (const auto& stats : { lTextures.GetStats(), lMeshes.GetStats() })
+		{
+			CHECK(stats.mLive == 0);
+			CHECK(stats.mCpuResident == 0);
+			CHECK(stats.mGpuResident == 0);
+			CHECK(stats.mCpuBytes == 0);
+		}
+		const std::string lReport = lLog.mStream.str();
+		CHECK(lReport.find("Asset memory report: scene unloaded") != std::string::npos);
+		CHECK(lReport.find("Meshes: 0 live,0 cpu resident (0.00 MB),0 gpu resident") != std::string::npos);
+		CHECK(lReport.find("Textures: 0 live,0 cpu resident (0.00 MB),0 gpu resident") != std::string::npos);
+	}
+	//Every cycle reuses the slots freed by the one before.
+	CHECK(lTextures.GetStats().mFreeSlots == 3);
+	CHECK(lMeshes.GetStats().mFreeSlots == 10);
+}
@@ -0,0 +1,252 @@
+#include "cluster_grid_tuner.h"
+#include "light_buffer.h"
+#include "synthetic_scene.h"
+#include <catch2/catch.hpp>
+
+using namespace Renderer;
+using namespace DirectX;
+
+namespace
+{
+	constexpr uint32_t WIDTH = 1920;
+	constexpr uint32_t HEIGHT = 1080;
+	//Resolution of the software occlusion depth the renderer captures from.
+	constexpr uint32_t DEPTH_WIDTH = 240;
+	constexpr uint32_t DEPTH_HEIGHT = 136;
+	constexpr float NEAR_Z = 0.1f;
+	constexpr float FAR_Z = 120.0f;
+	//Eye height above the ground plane.
+	constexpr float EYE_HEIGHT = 2.0f;
+
+	FrameData MakeStreetFrame()
+	{
+		const SimpleMath::Vector3 lEye(0.0f, EYE_HEIGHT, 0.0f);
+		return Synthetic::MakeFrameData(WIDTH, HEIGHT, lEye, lEye + SimpleMath::Vector3(0.0f, 0.0f, 1.0f), {}, NEAR_Z, FAR_Z);
+	}
+
+	//Reversed Z depth of the ground plane seen from the street,the sky above the horizon and past the far plane is cleared to 0.
+	std::vector<float> MakeGroundDepth(const FrameData& InFrame)
+	{
+		std::vector<float> lDepth(size_t(DEPTH_WIDTH) * DEPTH_HEIGHT, 0.0f);
+		for (uint32_t y = 0; y < DEPTH_HEIGHT; ++y)
+		{
+			const float lNdcY = 1.0f - 2.0f * (y + 0.5f) / DEPTH_HEIGHT;
+			if (lNdcY >= 0.0f)
+			{
+				continue;
+			}
+			const float lViewZ = -EYE_HEIGHT * InFrame.Prj._22 / lNdcY;
+			if (lViewZ > FAR_Z)
+			{
+				continue;
+			}
+			for (uint32_t x = 0; x < DEPTH_WIDTH; ++x)
+			{
+				lDepth[y * DEPTH_WIDTH + x] = NEAR_Z / lViewZ;
+			}
+		}
+		return lDepth;
+	}
+
+	//Small point lights scattered over the street in front of the camera.
+	std::vector<ECS::LigthData> MakeStreetLights(uint32_t InCount, uint32_t InSeed)
+	{
+		std::mt19937 lRandom(InSeed);
+		std::uniform_real_distribution<float> lX(-40.0f, 40.0f);
+		std::uniform_real_distribution<float> lY(0.0f, 4.0f);
+		std::uniform_real_distribution<float> lZ(3.0f, 100.0f);
+		std::uniform_real_distribution<float> lRange(1.0f, 3.0f);
+		std::vector<ECS::LigthData> lLights;
+		for (uint32_t i = 0; i < InCount; ++i)
+		{
+			ECS::LightComponent lLight;
+			lLight.pos = { lX(lRandom), lY(lRandom), lZ(lRandom), 1.0f };
+			lLight.radius_attenu = { lRange(lRandom), 1.0f, 0.0f, 0.0f };
+			lLight.type = ECS::LightType::POINT;
+			lLights.push_back(LightBuffer::ToLightData(lLight));
+		}
+		return lLights;
+	}
+
+	ClusterGridTuneInput CaptureStreet(uint32_t InLightCount)
+	{
+		FrameData lFrame = MakeStreetFrame();
+		const auto lLights = MakeStreetLights(InLightCount, 3);
+		lFrame.LightCount = InLightCount;
+		return ClusterGridTuneInput::Capture(lFrame, lLights, MakeGroundDepth(lFrame), WIDTH, HEIGHT, NEAR_Z, FAR_Z);
+	}
+}
+
+TEST_CASE("Captured tune input follows the depth buffer and the lights in view", "[cluster_grid_tuner]")
+{
+	FrameData lFrame = MakeStreetFrame();
+	auto lLights = MakeStreetLights(64, 5);
+	//Behind the camera,culled before it reaches the cost model.
+	ECS::LightComponent lBehind;
+	lBehind.pos = { 0.0f, 1.0f, -20.0f, 1.0f };
+	lBehind.radius_attenu = { 2.0f, 1.0f, 0.0f, 0.0f };
+	lLights.push_back(LightBuffer::ToLightData(lBehind));
+	lFrame.LightCount = uint32_t(lLights.size());
+
+	const auto lDepth = MakeGroundDepth(lFrame);
+	const auto lInput = ClusterGridTuneInput::Capture(lFrame, lLights, lDepth, WIDTH, HEIGHT, NEAR_Z, FAR_Z);
+	CHECK(lInput.mLightCount == lLights.size());
+	CHECK(lInput.mLights.size() < lLights.size());
+	for (const auto& light : lInput.mLights)
+	{
+		CHECK(light.mMinDepth < light.mMaxDepth);
+		CHECK(light.mMaxDepth > NEAR_Z);
+		CHECK(light.mMinX <= light.mMaxX);
+		CHECK(light.mMinY <= light.mMaxY);
+	}
+
+	const auto lCovered = std::count_if(lDepth.begin(), lDepth.end(), [](float InDepth) { return InDepth > 0.0f; });
+	CHECK(lInput.mCoverage == Approx(float(lCovered) / lDepth.size()));
+	CHECK(std::accumulate(lInput.mDepthHistogram.begin(), lInput.mDepthHistogram.end(), 0.0f) == Approx(1.0f));
+
+	//A wall at one depth fills the bin around it.
+	const std::vector<float> lWall(lDepth.size(), NEAR_Z / 10.0f);
+	const auto lWallInput = ClusterGridTuneInput::Capture(lFrame, lLights, lWall, WIDTH, HEIGHT, NEAR_Z, FAR_Z);
+	CHECK(lWallInput.mCoverage == 1.0f);
+	const auto lBin = std::max_element(lWallInput.mDepthHistogram.begin(), lWallInput.mDepthHistogram.end()) - lWallInput.mDepthHistogram.begin();
+	CHECK(lWallInput.mDepthHistogram[lBin] == Approx(1.0f));
+	const float lBinRatio = std::exp2(std::log2(FAR_Z / NEAR_Z) / ClusterGridTuneInput::DEPTH_BINS);
+	CHECK(lWallInput.GetBinDepth(uint32_t(lBin)) / 10.0f < lBinRatio);
+	CHECK(10.0f / lWallInput.GetBinDepth(uint32_t(lBin)) < lBinRatio);
+
+	//Nothing rasterized,the whole depth range is assumed covered.
+	const std::vector<float> lCleared(lDepth.size(), 0.0f);
+	const auto lClearedInput = ClusterGridTuneInput::Capture(lFrame, lLights, lCleared, WIDTH, HEIGHT, NEAR_Z, FAR_Z);
+	CHECK(lClearedInput.mCoverage == 1.0f);
+	CHECK(lClearedInput.mDepthHistogram.front() == Approx(1.0f / ClusterGridTuneInput::DEPTH_BINS));
+}
+
+TEST_CASE("Evaluate prefers grids with fewer lights per occupied cluster", "[cluster_grid_tuner]")
+{
+	const ClusterGrid lCoarse = { 8, 4, 8, 4.05f };
+	const ClusterGrid lFine = { 16, 9, 16, 4.05f };
+
+	SECTION("Many small lights,shading dominates")
+	{
+		const auto lInput = CaptureStreet(512);
+		const auto lCoarseEstimate = ClusterGridTuner::Evaluate(lInput, lCoarse);
+		const auto lFineEstimate = ClusterGridTuner::Evaluate(lInput, lFine);
+		REQUIRE(lFineEstimate.mLightsPerOccupiedCluster < lCoarseEstimate.mLightsPerOccupiedCluster);
+		CHECK(lFineEstimate.mLightsPerPixel < lCoarseEstimate.mLightsPerPixel);
+		CHECK(lFineEstimate.mCost < lCoarseEstimate.mCost);
+		CHECK(lFineEstimate.mOccupiedClusters > lCoarseEstimate.mOccupiedClusters);
+		CHECK(lFineEstimate.mOccupiedClusters <= lFine.GetCount());
+	}
+
+	SECTION("Grids with the same cluster count")
+	{
+		//Same cluster count and light count,the test and cluster overhead is equal and the cheaper grid shades fewer lights.
+		const auto lInput = CaptureStreet(512);
+		const ClusterGrid lWide = { 40, 23, 16, 4.05f };
+		const ClusterGrid lDeep = { 20, 23, 32, 4.05f };
+		const ClusterGrid lSquare = { 10, 23, 64, 4.05f };
+		std::vector<ClusterGridEstimate> lEstimates;
+		for (const auto& grid : { lWide, lDeep, lSquare })
+		{
+			REQUIRE(grid.GetCount() == lWide.GetCount());
+			lEstimates.push_back(ClusterGridTuner::Evaluate(lInput, grid));
+		}
+		for (const auto& a : lEstimates)
+		{
+			for (const auto& b : lEstimates)
+			{
+				CHECK((a.mCost < b.mCost) == (a.mLightsPerPixel < b.mLightsPerPixel));
+			}
+		}
+	}
+
+	SECTION("A single light,cluster overhead dominates")
+	{
+		const auto lInput = CaptureStreet(1);
+		CHECK(ClusterGridTuner::Evaluate(lInput, lCoarse).mCost < ClusterGridTuner::Evaluate(lInput, lFine).mCost);
+	}
+}
+
+TEST_CASE("Evaluate rejects grids that overflow the light index list", "[cluster_grid_tuner]")
+{
+	//Recorded input:lights covering the whole screen from the near plane to past the far plane.
+	ClusterGridTuneInput lInput;
+	lInput.mWidth = WIDTH;
+	lInput.mHeight = HEIGHT;
+	lInput.mNear = NEAR_Z;
+	lInput.mFar = FAR_Z;
+	lInput.mLightCount = 16;
+	lInput.mLights.assign(lInput.mLightCount, { 0.0f, 2.0f * FAR_Z, -1.0f, -1.0f, 1.0f, 1.0f });
+	lInput.mDepthHistogram.fill(1.0f / ClusterGridTuneInput::DEPTH_BINS);
+	lInput.mCoverage = 1.0f;
+
+	const ClusterGrid lDefault;
+	const auto lDefaultEstimate = ClusterGridTuner::Evaluate(lInput, lDefault);
+	CHECK(lDefaultEstimate.mAssignments == uint64_t(lDefault.GetCount()) * lInput.mLightCount);
+	CHECK(lDefaultEstimate.mCost < FLT_MAX);
+
+	const ClusterGrid lMax = { MAX_CLUSTER_X, MAX_CLUSTER_Y, MAX_CLUSTER_Z, 4.05f };
+	const auto lMaxEstimate = ClusterGridTuner::Evaluate(lInput, lMax);
+	REQUIRE(lMaxEstimate.mAssignments > (uint64_t)MAX_CLUSTER_LIGHT_INDICES);
+	CHECK(lMaxEstimate.mCost == FLT_MAX);
+
+	//The tuner moves away from an overflowing grid and never picks one.
+	ClusterGridTuner lTuner;
+	const ClusterGrid lTuned = lTuner.Tune(lInput, lMax);
+	CHECK(lTuned != lMax);
+	CHECK(ClusterGridTuner::Evaluate(lInput, lTuned).mAssignments <= (uint64_t)MAX_CLUSTER_LIGHT_INDICES);
+}
+
+TEST_CASE("Tune only switches grids past the hysteresis band", "[cluster_grid_tuner]")
+{
+	const auto lInput = CaptureStreet(512);
+	ClusterGridTuner lTuner;
+
+	SECTION("A clearly worse grid is replaced")
+	{
+		const ClusterGrid lCoarse = { 8, 4, 8, 4.05f };
+		const ClusterGrid lTuned = lTuner.Tune(lInput, lCoarse);
+		REQUIRE(lTuner.GetBestEstimate().mCost < lTuner.GetCurrentEstimate().mCost * (1.0f - ClusterGridTuner::HYSTERESIS));
+		CHECK(lTuned == lTuner.GetBestGrid());
+		CHECK(lTuned != lCoarse);
+		CHECK(lTuner.GetBestEstimate().mCost == ClusterGridTuner::Evaluate(lInput, lTuned).mCost);
+
+		//Tuning again from the chosen grid keeps it.
+		CHECK(lTuner.Tune(lInput, lTuned) == lTuned);
+	}
+
+	SECTION("A grid within the band is kept")
+	{
+		const ClusterGrid lBest = lTuner.Tune(lInput, ClusterGrid{ 8, 4, 8, 4.05f });
+		//A nudged distribution is not a candidate,its cost is within a few percent of the best.
+		ClusterGrid lNear = lBest;
+		lNear.mDistributionScale *= 1.05f;
+		const auto lNearEstimate = ClusterGridTuner::Evaluate(lInput, lNear);
+		const auto lBestEstimate = ClusterGridTuner::Evaluate(lInput, lBest);
+		REQUIRE(lNearEstimate.mCost != lBestEstimate.mCost);
+		REQUIRE(lBestEstimate.mCost >= lNearEstimate.mCost * (1.0f - ClusterGridTuner::HYSTERESIS));
+
+		CHECK(lTuner.Tune(lInput, lNear) == lNear);
+		CHECK(lTuner.GetCurrentEstimate().mCost == lNearEstimate.mCost);
+	}
+
+	SECTION("The band is relative to the current cost")
+	{
+		const ClusterGrid lBest = lTuner.Tune(lInput, ClusterGrid{ 8, 4, 8, 4.05f });
+		const float lBestCost = lTuner.GetBestEstimate().mCost;
+		//Walk a candidate that is not in the search away from the best until it leaves the band.
+		ClusterGrid lCurrent = lBest;
+		bool lSwitched = false;
+		for (uint32_t slices = lBest.mZ + 1; slices <= MAX_CLUSTER_Z && !lSwitched; ++slices)
+		{
+			lCurrent.mZ = slices;
+			const float lCurrentCost = ClusterGridTuner::Evaluate(lInput, lCurrent).mCost;
+			const ClusterGrid lTuned = lTuner.Tune(lInput, lCurrent);
+			const bool lOutside = lTuner.GetBestEstimate().mCost < lCurrentCost * (1.0f - ClusterGridTuner::HYSTERESIS);
+			CHECK(lTuner.GetBestEstimate().mCost <= lBestCost);
+			CHECK((lTuned == lCurrent) == !lOutside);
+			lSwitched = lOutside;
+		}
+		CHECK(lSwitched);
+	}
+}
@@ -0,0 +1,368 @@
+#include "cluster_light_cull.h"
+#include "light_buffer.h"
+#include "synthetic_scene.h"
+#include <catch2/catch.hpp>
+
+using namespace Renderer;
+using namespace DirectX;
+
+namespace
+{
+	//Light in view space,transformed with SimpleMath rather than the culler's ShaderMul.
+	struct ReferenceLight
+	{
+		SimpleMath::Vector3 mPos;
+		SimpleMath::Vector3 mAxis;
+		float mRange;
+		ECS::LightType mType;
+		float mCosOuter;
+		float mHalfLength;
+	};
+
+	ReferenceLight ToReference(const ECS::LigthData& InLight, const SimpleMath::Matrix& InView)
+	{
+		ReferenceLight lLight;
+		lLight.mPos = SimpleMath::Vector3::Transform(SimpleMath::Vector3(InLight.pos.x, InLight.pos.y, InLight.pos.z), InView);
+		lLight.mAxis = SimpleMath::Vector3::TransformNormal(SimpleMath::Vector3(InLight.direction), InView);
+		lLight.mRange = InLight.radius_attenu.x;
+		lLight.mType = InLight.type;
+		lLight.mCosOuter = InLight.shape.x;
+		lLight.mHalfLength = InLight.shape.x;
+		return lLight;
+	}
+
+	bool Reaches(const ReferenceLight& InLight, const SimpleMath::Vector3& InPoint)
+	{
+		SimpleMath::Vector3 lDelta = InPoint - InLight.mPos;
+		if (InLight.mType == ECS::LightType::CAPSULE)
+		{
+			const float lT = std::clamp(lDelta.Dot(InLight.mAxis), -InLight.mHalfLength, InLight.mHalfLength);
+			lDelta -= InLight.mAxis * lT;
+		}
+		const float lDistance = lDelta.Length();
+		if (lDistance >= InLight.mRange)
+		{
+			return false;
+		}
+		return InLight.mType != ECS::LightType::SPOT || lDelta.Dot(InLight.mAxis) >= InLight.mCosOuter * lDistance;
+	}
+
+	//Points,spots and capsules scattered in front of the camera,a third each.
+	std::vector<ECS::LigthData> MakeLights(uint32_t InCount, uint32_t InSeed)
+	{
+		std::mt19937 lRandom(InSeed);
+		std::uniform_real_distribution<float> lX(-25.0f, 25.0f);
+		std::uniform_real_distribution<float> lY(-12.0f, 12.0f);
+		std::uniform_real_distribution<float> lZ(2.0f, 70.0f);
+		std::uniform_real_distribution<float> lUnit(-1.0f, 1.0f);
+		std::uniform_real_distribution<float> lRange(2.0f, 9.0f);
+		std::uniform_real_distribution<float> lAngle(0.2f, 1.2f);
+		std::vector<ECS::LigthData> lLights;
+		for (uint32_t i = 0; i < InCount; ++i)
+		{
+			ECS::LightComponent lLight;
+			lLight.pos = { lX(lRandom), lY(lRandom), lZ(lRandom), 1.0f };
+			lLight.radius_attenu = { lRange(lRandom), 1.0f, 0.0f, 0.0f };
+			lLight.type = ECS::LightType(i % 3);
+			lLight.direction = { lUnit(lRandom), lUnit(lRandom), lUnit(lRandom) };
+			if (SimpleMath::Vector3(lLight.direction).LengthSquared() < 0.01f)
+			{
+				lLight.direction = { 0.0f, -1.0f, 0.0f };
+			}
+			lLight.spotOuterAngle = lAngle(lRandom);
+			lLight.spotInnerAngle = lLight.spotOuterAngle * 0.5f;
+			lLight.length = 2.0f * lRange(lRandom);
+			lLights.push_back(LightBuffer::ToLightData(lLight));
+		}
+		return lLights;
+	}
+
+	std::span<const uint32_t> ClusterLights(const ClusterLightCuller& InCuller, uint32_t InCluster)
+	{
+		const auto& lCluster = InCuller.GetClusters()[InCluster];
+		return InCuller.GetLightIndices().subspan(lCluster.offset, lCluster.count);
+	}
+}
+
+TEST_CASE("Cell view AABBs follow the slice depths and the frustum", "[cluster_light_cull]")
+{
+	constexpr uint32_t WIDTH = 1280;
+	constexpr uint32_t HEIGHT = 720;
+	const ClusterGrid lGrid;
+	const auto lFrame = Synthetic::MakeFrameData(WIDTH, HEIGHT, { 0.0f, 0.0f, 0.0f }, { 0.0f, 0.0f, 1.0f }, lGrid);
+	const auto& lParams = lFrame.LightGridZParams;
+
+	XMFLOAT3 lMin, lMax;
+	float lPreviousFar = 0.0f;
+	for (uint32_t z = 0; z < lGrid.mZ; ++z)
+	{
+		ClusterLightCuller::ComputeCellViewAABB(lFrame, 0, 0, z, lMin, lMax);
+		//Slices share their boundary depth and follow slice = log2(depth * B + O) * S.
+		CHECK(lMin.z == lPreviousFar);
+		if (z > 0)
+		{
+			CHECK(std::log2(lMin.z * lParams.x + lParams.y) * lParams.z == Approx(float(z)).margin(1e-3));
+		}
+		lPreviousFar = lMax.z;
+	}
+	CHECK(lPreviousFar == 2000000.0f);
+
+	//Away from the unbounded first and last slices x and y are the tile edges scaled by depth,
+	//PerspectCamera sees 90 degrees horizontally.
+	const float lScaleY = float(WIDTH) / float(HEIGHT);
+	for (uint32_t z : { 1u, 5u, 14u })
+	{
+		for (auto [x, y] : { std::pair{ 0u, 0u }, std::pair{ 15u, 7u }, std::pair{ 16u, 8u }, std::pair{ 31u, 15u }, std::pair{ 3u, 12u } })
+		{
+			ClusterLightCuller::ComputeCellViewAABB(lFrame, x, y, z, lMin, lMax);
+			const float lEdgesX[2] = { -1.0f + 2.0f * x / lGrid.mX, -1.0f + 2.0f * (x + 1) / lGrid.mX };
+			const float lEdgesY[2] = { 1.0f - 2.0f * y / lGrid.mY, 1.0f - 2.0f * (y + 1) / lGrid.mY };
+			XMFLOAT3 lExpectedMin = { FLT_MAX, FLT_MAX, lMin.z };
+			XMFLOAT3 lExpectedMax = { -FLT_MAX, -FLT_MAX, lMax.z };
+			for (float depth : { lMin.z, lMax.z })
+			{
+				for (int i = 0; i < 2; ++i)
+				{
+					lExpectedMin.x = std::min(lExpectedMin.x, lEdgesX[i] * depth);
+					lExpectedMax.x = std::max(lExpectedMax.x, lEdgesX[i] * depth);
+					lExpectedMin.y = std::min(lExpectedMin.y, lEdgesY[i] * depth / lScaleY);
+					lExpectedMax.y = std::max(lExpectedMax.y, lEdgesY[i] * depth / lScaleY);
+				}
+			}
+			CHECK(lMin.x == Approx(lExpectedMin.x).margin(1e-4));
+			CHECK(lMin.y == Approx(lExpectedMin.y).margin(1e-4));
+			CHECK(lMax.x == Approx(lExpectedMax.x).margin(1e-4));
+			CHECK(lMax.y == Approx(lExpectedMax.y).margin(1e-4));
+		}
+	}
+}
+
+TEST_CASE("Every cluster a light volume reaches lists the light", "[cluster_light_cull]")
+{
+	constexpr uint32_t SAMPLES = 5;
+	const ClusterGrid lGrid = { 16, 8, 16 };
+	const SimpleMath::Vector3 lEye(3.0f, 2.0f, -5.0f);
+	const SimpleMath::Vector3 lTarget(0.0f, 0.0f, 30.0f);
+	auto lFrame = Synthetic::MakeFrameData(1280, 720, lEye, lTarget, lGrid);
+	const auto lLights = MakeLights(96, 11);
+	lFrame.LightCount = (uint32_t)lLights.size();
+	const SimpleMath::Matrix lView = XMMatrixLookAtLH(lEye, lTarget, SimpleMath::Vector3(0.0f, 1.0f, 0.0f));
+	std::vector<ReferenceLight> lReference;
+	for (const auto& light : lLights)
+	{
+		lReference.push_back(ToReference(light, lView));
+	}
+
+	tf::Executor lExecutor(2);
+	ClusterLightCuller lCuller(lExecutor);
+	lCuller.Cull(lFrame, lLights);
+	const auto& lStats = lCuller.GetStats();
+	CHECK(lStats.mClusters == lGrid.GetCount());
+	CHECK(lStats.mLights == lLights.size());
+	CHECK(lStats.mDroppedAssignments == 0);
+	REQUIRE(lStats.mAssignments > 0);
+
+	uint32_t lAssignments = 0;
+	uint32_t lReached = 0;
+	for (uint32_t z = 0; z < lGrid.mZ; ++z)
+	{
+		for (uint32_t y = 0; y < lGrid.mY; ++y)
+		{
+			for (uint32_t x = 0; x < lGrid.mX; ++x)
+			{
+				const uint32_t lCluster = (z * lGrid.mY + y) * lGrid.mX + x;
+				const auto lListed = ClusterLights(lCuller, lCluster);
+				REQUIRE(std::is_sorted(lListed.begin(), lListed.end()));
+				lAssignments += (uint32_t)lListed.size();
+
+				XMFLOAT3 lMin, lMax;
+				ClusterLightCuller::ComputeCellViewAABB(lFrame, x, y, z, lMin, lMax);
+				for (uint32_t i = 0; i < lReference.size(); ++i)
+				{
+					bool lInside = false;
+					for (uint32_t s = 0; s < SAMPLES * SAMPLES * SAMPLES && !lInside; ++s)
+					{
+						const float lU = float(s % SAMPLES) / (SAMPLES - 1);
+						const float lV = float(s / SAMPLES % SAMPLES) / (SAMPLES - 1);
+						const float lW = float(s / (SAMPLES * SAMPLES)) / (SAMPLES - 1);
+						lInside = Reaches(lReference[i], SimpleMath::Vector3(
+							lMin.x + (lMax.x - lMin.x) * lU, lMin.y + (lMax.y - lMin.y) * lV, lMin.z + (lMax.z - lMin.z) * lW));
+					}
+					if (lInside)
+					{
+						lReached++;
+						REQUIRE(std::binary_search(lListed.begin(), lListed.end(), i));
+					}
+				}
+			}
+		}
+	}
+	CHECK(lAssignments == lStats.mAssignments);
+	CHECK(lReached > 0);
+	CHECK(lReached <= lAssignments);
+}
+
+TEST_CASE("Spot and capsule shape tests only drop clusters their bounding sphere reaches in vain", "[cluster_light_cull]")
+{
+	const ClusterGrid lGrid = { 16, 8, 16 };
+	auto lFrame = Synthetic::MakeFrameData(1280, 720, { 0.0f, 3.0f, -2.0f }, { 0.0f, 0.0f, 40.0f }, lGrid);
+	const auto lLights = MakeLights(96, 23);
+	lFrame.LightCount = (uint32_t)lLights.size();
+
+	tf::Executor lExecutor(2);
+	ClusterLightCuller lShapes(lExecutor);
+	lShapes.Cull(lFrame, lLights);
+	const auto lShapeAccuracy = lShapes.MeasureFalsePositives(lLights, 4);
+	ClusterLightCuller lSpheres(lExecutor);
+	lSpheres.SetSphereBoundsOnly(true);
+	lSpheres.Cull(lFrame, lLights);
+	const auto lSphereAccuracy = lSpheres.MeasureFalsePositives(lLights, 4);
+
+	//The shape lists are a subset of the sphere lists,and point lights are culled the same either way.
+	for (uint32_t c = 0; c < lGrid.GetCount(); ++c)
+	{
+		const auto lShapeLights = ClusterLights(lShapes, c);
+		const auto lSphereLights = ClusterLights(lSpheres, c);
+		REQUIRE(std::includes(lSphereLights.begin(), lSphereLights.end(), lShapeLights.begin(), lShapeLights.end()));
+		for (auto light : lSphereLights)
+		{
+			if (lLights[light].type == ECS::LightType::POINT)
+			{
+				REQUIRE(std::binary_search(lShapeLights.begin(), lShapeLights.end(), light));
+			}
+		}
+	}
+	const uint32_t POINT = 0, SPOT = 1, CAPSULE = 2;
+	CHECK(lShapeAccuracy.mTypeAssignments[POINT] == lSphereAccuracy.mTypeAssignments[POINT]);
+	CHECK(lShapeAccuracy.mTypeAssignments[SPOT] < lSphereAccuracy.mTypeAssignments[SPOT]);
+	CHECK(lShapeAccuracy.mTypeAssignments[CAPSULE] < lSphereAccuracy.mTypeAssignments[CAPSULE]);
+	//Everything the shape tests dropped was a false positive of the sphere.
+	CHECK(lSphereAccuracy.mAssignments - lShapeAccuracy.mAssignments <= lSphereAccuracy.mFalsePositives - lShapeAccuracy.mFalsePositives);
+	CHECK(lShapeAccuracy.mTypeFalsePositives[SPOT] < lSphereAccuracy.mTypeFalsePositives[SPOT]);
+	CHECK(lShapeAccuracy.mTypeFalsePositives[CAPSULE] < lSphereAccuracy.mTypeFalsePositives[CAPSULE]);
+}
+
+TEST_CASE("Marked active clusters follow the per-pixel depth ranges", "[cluster_light_cull]")
+{
+	//8 x 8 pixel tiles.
+	constexpr uint32_t WIDTH = 64;
+	constexpr uint32_t HEIGHT = 32;
+	const ClusterGrid lGrid = { 8, 4, 8 };
+	const auto lFrame = Synthetic::MakeFrameData(WIDTH, HEIGHT, { 0.0f, 0.0f, 0.0f }, { 0.0f, 0.0f, 1.0f }, lGrid);
+	const auto& lParams = lFrame.LightGridZParams;
+	//Device depth of the middle of a slice,clear of the slice epsilon on both sides.
+	auto lSliceDepth = [&lParams](uint32_t InSlice)
+		{
+			const float lDepth = (std::exp2((InSlice + 0.5f) / lParams.z) - lParams.y) / lParams.x;
+			return 0.1f / lDepth;
+		};
+
+	//Cleared pixels mark nothing.
+	std::vector<XMFLOAT2> lRanges(WIDTH * HEIGHT, XMFLOAT2(0.0f, 0.0f));
+	auto lSet = [&lRanges](uint32_t InX, uint32_t InY, float InFarDevice, float InNearDevice)
+		{
+			lRanges[InY * WIDTH + InX] = XMFLOAT2(InFarDevice, InNearDevice);
+		};
+	//Tile (0,0) at slice 3.
+	lSet(0, 0, lSliceDepth(3), lSliceDepth(3));
+	//Tile (2,1),an edge pixel spanning slices 2 to 5.
+	lSet(23, 8, lSliceDepth(5), lSliceDepth(2));
+	//Tile (7,3) twice in slice 6,once in slice 1.
+	lSet(63, 31, lSliceDepth(6), lSliceDepth(6));
+	lSet(56, 24, lSliceDepth(6), lSliceDepth(6));
+	lSet(60, 28, lSliceDepth(1), lSliceDepth(1));
+	//Past the last slice clamps to it.
+	lSet(40, 16, 1e-7f, 1e-7f);
+
+	auto lIndex = [&lGrid](uint32_t InX, uint32_t InY, uint32_t InZ) { return (InZ * lGrid.mY + InY) * lGrid.mX + InX; };
+	std::vector<uint32_t> lExpected = { lIndex(0, 0, 3), lIndex(2, 1, 2), lIndex(2, 1, 3), lIndex(2, 1, 4), lIndex(2, 1, 5),
+		lIndex(7, 3, 6), lIndex(7, 3, 1), lIndex(5, 2, lGrid.mZ - 1) };
+	std::sort(lExpected.begin(), lExpected.end());
+
+	tf::Executor lExecutor(2);
+	ClusterLightCuller lCuller(lExecutor);
+	lCuller.MarkActiveClusters(lFrame, lRanges, WIDTH);
+	lCuller.Cull(lFrame, {}, true);
+	const auto lActive = lCuller.GetActiveClusters();
+	CHECK(std::vector<uint32_t>(lActive.begin(), lActive.end()) == lExpected);
+	CHECK(lCuller.GetStats().mActiveClusters == lExpected.size());
+
+	//Diff against a GPU list with one cluster missing and one extra.
+	CHECK(lCuller.CompareActiveClusters(lExpected) == 0);
+	CHECK(lCuller.GetStats().mMismatchedActiveClusters == 0);
+	std::vector<uint32_t> lGpu = lExpected;
+	lGpu.erase(lGpu.begin() + 2);
+	lGpu.push_back(lGrid.GetCount() - 1);
+	CHECK(lCuller.CompareActiveClusters(lGpu) == 2);
+	CHECK(lCuller.GetStats().mMismatchedActiveClusters == 2);
+	CHECK(lCuller.CompareActiveClusters({}) == lExpected.size());
+
+	//A full cull marks every cluster again.
+	lCuller.Cull(lFrame, {});
+	CHECK(lCuller.GetActiveClusters().size() == lGrid.GetCount());
+}
+
+TEST_CASE("Culling the active clusters only matches full culling on them", "[cluster_light_cull]")
+{
+	constexpr uint32_t WIDTH = 320;
+	constexpr uint32_t HEIGHT = 180;
+	const ClusterGrid lGrid = { 16, 8, 16 };
+	auto lFrame = Synthetic::MakeFrameData(WIDTH, HEIGHT, { 0.0f, 2.0f, -4.0f }, { 0.0f, 0.0f, 30.0f }, lGrid);
+	const auto lLights = MakeLights(96, 17);
+	lFrame.LightCount = (uint32_t)lLights.size();
+
+	//Blocks of 4 x 4 pixels share a depth range,a third of them cleared.
+	std::mt19937 lRandom(29);
+	std::uniform_real_distribution<float> lDepth(0.5f, 90.0f);
+	std::uniform_real_distribution<float> lSpread(1.0f, 1.5f);
+	std::vector<XMFLOAT2> lRanges(WIDTH * HEIGHT);
+	for (uint32_t by = 0; by < HEIGHT / 4; ++by)
+	{
+		for (uint32_t bx = 0; bx < WIDTH / 4; ++bx)
+		{
+			const float lNear = lDepth(lRandom);
+			const float lFar = lNear * lSpread(lRandom);
+			const XMFLOAT2 lRange = lRandom() % 3 == 0 ? XMFLOAT2(0.0f, 0.0f) : XMFLOAT2(0.1f / lFar, 0.1f / lNear);
+			for (uint32_t i = 0; i < 16; ++i)
+			{
+				lRanges[(by * 4 + i / 4) * WIDTH + bx * 4 + i % 4] = lRange;
+			}
+		}
+	}
+
+	tf::Executor lExecutor(2);
+	ClusterLightCuller lFull(lExecutor);
+	lFull.Cull(lFrame, lLights);
+	ClusterLightCuller lActiveOnly(lExecutor);
+	lActiveOnly.MarkActiveClusters(lFrame, lRanges, WIDTH);
+	lActiveOnly.Cull(lFrame, lLights, true);
+
+	const auto lActive = lActiveOnly.GetActiveClusters();
+	REQUIRE(!lActive.empty());
+	REQUIRE(lActive.size() < lGrid.GetCount());
+	REQUIRE(std::is_sorted(lActive.begin(), lActive.end()));
+	CHECK(lActiveOnly.GetStats().mActiveClusters == lActive.size());
+	CHECK(lActiveOnly.GetStats().mClusters == lGrid.GetCount());
+
+	uint32_t lAssignments = 0;
+	uint32_t lActiveAssignments = 0;
+	for (uint32_t c = 0; c < lGrid.GetCount(); ++c)
+	{
+		const auto lFullLights = ClusterLights(lFull, c);
+		const auto lActiveLights = ClusterLights(lActiveOnly, c);
+		if (std::binary_search(lActive.begin(), lActive.end(), c))
+		{
+			REQUIRE(std::equal(lActiveLights.begin(), lActiveLights.end(), lFullLights.begin(), lFullLights.end()));
+			lActiveAssignments += (uint32_t)lFullLights.size();
+		}
+		else
+		{
+			//Inactive clusters never get a light list.
+			REQUIRE(lActiveOnly.GetClusters()[c].count == 0);
+		}
+		lAssignments += (uint32_t)lFullLights.size();
+	}
+	CHECK(lActiveOnly.GetStats().mAssignments == lActiveAssignments);
+	CHECK(lActiveAssignments > 0);
+	CHECK(lActiveAssignments < lAssignments);
+}
@@ -0,0 +1,154 @@
+#include "descriptor_allocator.h"
+#include "device_manager.h"
+#include "synthetic_scene.h"
+#include <catch2/catch.hpp>
+
+using namespace Renderer;
+
+TEST_CASE("Freed descriptors are held until their frame completed", "[descriptor_allocator]")
+{
+	DescriptorAllocator lAllocator(8, 0);
+	std::vector<uint32_t> lIndices;
+	for (int i = 0; i < 8; ++i)
+	{
+		lIndices.push_back(lAllocator.Allocate(1));
+		REQUIRE(lIndices.back() == uint32_t(i));
+	}
+	CHECK(lAllocator.Allocate(1) == DescriptorAllocator::INVALID_INDEX);
+	CHECK(lAllocator.GetStats().mFailedAllocations == 1);
+
+	lAllocator.Free(lIndices[3]);
+	CHECK(lAllocator.GetStats().mPendingFrees == 1);
+	CHECK(lAllocator.GetStats().mPersistentUsed == 8);
+	//Not retired yet,any completed value leaves it alone.
+	lAllocator.Reclaim(100);
+	CHECK(lAllocator.Allocate(1) == DescriptorAllocator::INVALID_INDEX);
+
+	lAllocator.Retire(5);
+	lAllocator.Reclaim(4);
+	CHECK(lAllocator.GetStats().mPendingFrees == 1);
+	CHECK(lAllocator.Allocate(1) == DescriptorAllocator::INVALID_INDEX);
+	lAllocator.Reclaim(5);
+	CHECK(lAllocator.GetStats().mPendingFrees == 0);
+	CHECK(lAllocator.GetStats().mPersistentUsed == 7);
+	CHECK(lAllocator.Allocate(1) == lIndices[3]);
+
+	//Frees of later frames wait for their own value.
+	lAllocator.Free(lIndices[0]);
+	lAllocator.Retire(6);
+	lAllocator.Free(lIndices[1]);
+	lAllocator.Retire(7);
+	lAllocator.Reclaim(6);
+	CHECK(lAllocator.GetStats().mPendingFrees == 1);
+	CHECK(lAllocator.Allocate(1) == lIndices[0]);
+	CHECK(lAllocator.Allocate(1) == DescriptorAllocator::INVALID_INDEX);
+	lAllocator.Reclaim(7);
+	CHECK(lAllocator.Allocate(1) == lIndices[1]);
+	CHECK(lAllocator.GetStats().mFailedAllocations == 4);
+}
+
+TEST_CASE("Freed ranges merge back for larger allocations", "[descriptor_allocator]")
+{
+	DescriptorAllocator lAllocator(64, 0);
+	const uint32_t lA = lAllocator.Allocate(16);
+	const uint32_t lB = lAllocator.Allocate(16);
+	const uint32_t lC = lAllocator.Allocate(32);
+	REQUIRE(lC != DescriptorAllocator::INVALID_INDEX);
+	lAllocator.Free(lA);
+	lAllocator.Free(lB);
+	lAllocator.Retire(1);
+	lAllocator.Reclaim(1);
+	CHECK(lAllocator.Allocate(32) == 0);
+}
+
+TEST_CASE("Transient descriptors wrap around the ring behind the persistent range", "[descriptor_allocator]")
+{
+	constexpr uint32_t PERSISTENT = 16;
+	constexpr uint32_t TRANSIENT = 10;
+	DescriptorAllocator lAllocator(PERSISTENT, TRANSIENT);
+	CHECK(lAllocator.GetCapacity() == PERSISTENT + TRANSIENT);
+
+	CHECK(lAllocator.AllocateTransient(4) == PERSISTENT);
+	CHECK(lAllocator.AllocateTransient(4) == PERSISTENT + 4);
+	lAllocator.Retire(1);
+	CHECK(lAllocator.AllocateTransient(2) == PERSISTENT + 8);
+	CHECK(lAllocator.GetStats().mTransientUsed == 10);
+	//Full,nothing of frame 1 completed.
+	CHECK(lAllocator.AllocateTransient(1) == DescriptorAllocator::INVALID_INDEX);
+	CHECK(lAllocator.GetStats().mFailedAllocations == 1);
+	lAllocator.Retire(2);
+
+	lAllocator.Reclaim(1);
+	CHECK(lAllocator.GetStats().mTransientUsed == 2);
+	//Wraps to the front instead of straddling the end of the heap.
+	CHECK(lAllocator.AllocateTransient(5) == PERSISTENT);
+	CHECK(lAllocator.AllocateTransient(3) == PERSISTENT + 5);
+	CHECK(lAllocator.AllocateTransient(1) == DescriptorAllocator::INVALID_INDEX);
+	lAllocator.Retire(3);
+	lAllocator.Reclaim(3);
+	CHECK(lAllocator.GetStats().mTransientUsed == 0);
+	//Transient allocations never touch the persistent range.
+	CHECK(lAllocator.GetStats().mPersistentUsed == 0);
+	CHECK(lAllocator.Allocate(PERSISTENT) == 0);
+}
+
+TEST_CASE("Transient indices stay in the ring over many frames", "[descriptor_allocator]")
+{
+	constexpr uint32_t PERSISTENT = 32;
+	constexpr uint32_t TRANSIENT = 96;
+	DescriptorAllocator lAllocator(PERSISTENT, TRANSIENT);
+	std::mt19937 lRandom(13);
+	std::uniform_int_distribution<uint32_t> lCount(1, 12);
+	//Three frames in flight of up to 27 descriptors each,plus padding when one wraps.
+	uint64_t lFrame = 0;
+	for (; lFrame < 300; ++lFrame)
+	{
+		if (lFrame >= 3)
+		{
+			lAllocator.Reclaim(lFrame - 2);
+		}
+		uint32_t lFrameCount = 0;
+		while (lFrameCount < TRANSIENT / 6)
+		{
+			const uint32_t lSize = lCount(lRandom);
+			const uint32_t lIndex = lAllocator.AllocateTransient(lSize);
+			REQUIRE(lIndex != DescriptorAllocator::INVALID_INDEX);
+			REQUIRE(lIndex >= PERSISTENT);
+			REQUIRE(lIndex + lSize <= PERSISTENT + TRANSIENT);
+			lFrameCount += lSize;
+		}
+		lAllocator.Retire(lFrame + 1);
+	}
+	CHECK(lAllocator.GetStats().mFailedAllocations == 0);
+}
+
+TEST_CASE("The ImGui descriptors take the start of the CBV_SRV_UAV heap", "[descriptor_allocator]")
+{
+	//DescHeap reserves them first and ImGui writes its font SRV at the heap start.
+	DescriptorAllocator lAllocator(MAX_DESC_NUM, 1024);
+	REQUIRE(lAllocator.Allocate(IMGUI_DESC_HEAP_ONLY) == 0);
+	std::vector<uint32_t> lLive;
+	std::mt19937 lRandom(2);
+	for (uint64_t frame = 1; frame <= 200; ++frame)
+	{
+		for (int i = 0; i < 8; ++i)
+		{
+			const uint32_t lIndex = lAllocator.Allocate(std::uniform_int_distribution<uint32_t>(1, 4)(lRandom));
+			if (lIndex != DescriptorAllocator::INVALID_INDEX)
+			{
+				REQUIRE(lIndex >= uint32_t(IMGUI_DESC_HEAP_ONLY));
+				lLive.push_back(lIndex);
+			}
+		}
+		while (lLive.size() > 100)
+		{
+			const size_t lPick = std::uniform_int_distribution<size_t>(0, lLive.size() - 1)(lRandom);
+			lAllocator.Free(lLive[lPick]);
+			lLive[lPick] = lLive.back();
+			lLive.pop_back();
+		}
+		lAllocator.Retire(frame);
+		lAllocator.Reclaim(frame);
+	}
+	CHECK(lAllocator.GetStats().mPersistentUsed >= uint32_t(IMGUI_DESC_HEAP_ONLY));
+}
@@ -0,0 +1,198 @@
+#include "draw_packet.h"
+#include <catch2/catch.hpp>
+
+using namespace Renderer;
+
+namespace
+{
+	//InCount packets over InObjects objects with random passes,materials and depths,returns the keys in insertion order.
+	std::vector<uint64_t> FillPackets(DrawPacketList& OutPackets, uint32_t InCount, uint32_t InObjects, uint32_t InMaterials, uint32_t InSeed)
+	{
+		std::mt19937 lRandom(InSeed);
+		std::uniform_real_distribution<float> lDepth(0.0f, 500.0f);
+		std::vector<uint64_t> lKeys;
+		OutPackets.Clear();
+		for (uint32_t i = 0; i < InObjects; ++i)
+		{
+			OutPackets.AddObject({});
+		}
+		for (uint32_t i = 0; i < InCount; ++i)
+		{
+			DrawPacket lPacket = {};
+			lPacket.mIndexCount = 3;
+			lPacket.mStartIndexLocation = i;
+			lPacket.mObjectIndex = lRandom() % InObjects;
+			lPacket.mMaterial = lRandom() % InMaterials;
+			lPacket.m16BitIndices = (lRandom() & 1) != 0;
+			const auto lPass = DrawPass(lRandom() % uint32_t(DrawPass::COUNT));
+			const auto lPipeline = DrawPipeline(lRandom() % uint32_t(DrawPipeline::COUNT));
+			lKeys.push_back(DrawKey::Make(lPass, lPipeline, lPacket.mMaterial, lDepth(lRandom)));
+			OutPackets.Add(lKeys.back(), lPacket);
+		}
+		return lKeys;
+	}
+
+	std::vector<DrawPacketList::SortItem> GetSorted(const DrawPacketList& InPackets)
+	{
+		std::vector<DrawPacketList::SortItem> lItems;
+		for (int pass = 0; pass < int(DrawPass::COUNT); ++pass)
+		{
+			auto lRange = InPackets.GetSortedRange(DrawPass(pass));
+			for (const auto& item : lRange)
+			{
+				REQUIRE(DrawKey::GetPass(item.mKey) == DrawPass(pass));
+			}
+			lItems.insert(lItems.end(), lRange.begin(), lRange.end());
+		}
+		return lItems;
+	}
+}
+
+TEST_CASE("Draw keys order by pass,pipeline,material then front to back", "[draw_packet]")
+{
+	const auto lNear = DrawKey::Make(DrawPass::COLOR, DrawPipeline::COLOR_MSAA, 3, 1.0f);
+	const auto lFar = DrawKey::Make(DrawPass::COLOR, DrawPipeline::COLOR_MSAA, 3, 100.0f);
+	CHECK(lNear < lFar);
+	CHECK(DrawKey::Make(DrawPass::COLOR, DrawPipeline::COLOR_MSAA, 2, 100.0f) < lNear);
+	CHECK(DrawKey::Make(DrawPass::DEPTH_ONLY, DrawPipeline::COLOR_MSAA, 9, 100.0f) < lNear);
+	CHECK(DrawKey::Make(DrawPass::SHADOW_MAP, DrawPipeline::SHADOW_MAP, 9, 100.0f) < lNear);
+	//Behind the eye clamps to the front.
+	CHECK(DrawKey::Make(DrawPass::COLOR, DrawPipeline::COLOR_MSAA, 3, -5.0f) == DrawKey::Make(DrawPass::COLOR, DrawPipeline::COLOR_MSAA, 3, 0.0f));
+	CHECK(DrawKey::GetPass(lFar) == DrawPass::COLOR);
+	CHECK(DrawKey::GetPipeline(lFar) == DrawPipeline::COLOR_MSAA);
+}
+
+TEST_CASE("Radix sort matches a stable sort of the keys", "[draw_packet]")
+{
+	const uint32_t lCount = GENERATE(0u, 1u, 7u, 1000u, 100000u);
+	DrawPacketList lPackets;
+	const auto lKeys = FillPackets(lPackets, lCount, 64, 300, lCount);
+	std::vector<uint32_t> lExpected(lCount);
+	std::iota(lExpected.begin(), lExpected.end(), 0);
+	std::stable_sort(lExpected.begin(), lExpected.end(), [&](uint32_t a, uint32_t b) { return lKeys[a] < lKeys[b]; });
+
+	SECTION("serial")
+	{
+		lPackets.Sort();
+	}
+	SECTION("taskflow")
+	{
+		tf::Executor lExecutor(4);
+		tf::Taskflow lFlow;
+		lPackets.EmplaceSortTasks(lFlow);
+		lExecutor.run(lFlow).wait();
+	}
+	const auto lSorted = GetSorted(lPackets);
+	REQUIRE(lSorted.size() == lCount);
+	for (uint32_t i = 0; i < lCount; ++i)
+	{
+		REQUIRE(lSorted[i].mPacket == lExpected[i]);
+		REQUIRE(lSorted[i].mKey == lKeys[lExpected[i]]);
+	}
+}
+
+TEST_CASE("A sort where every key shares the high bytes skips those passes", "[draw_packet]")
+{
+	DrawPacketList lPackets;
+	lPackets.AddObject({});
+	std::vector<float> lDepths = { 5.0f, 1.0f, 3.0f, 1.0f, 0.5f };
+	for (uint32_t i = 0; i < lDepths.size(); ++i)
+	{
+		lPackets.Add(DrawKey::Make(DrawPass::COLOR, DrawPipeline::COLOR_MSAA, 7, lDepths[i]), { 3, i, 0, 0, 7, false });
+	}
+	lPackets.Sort();
+	auto lColor = lPackets.GetSortedRange(DrawPass::COLOR);
+	REQUIRE(lColor.size() == lDepths.size());
+	CHECK(lPackets.GetSortedRange(DrawPass::DEPTH_ONLY).empty());
+	CHECK(lPackets.GetSortedRange(DrawPass::SHADOW_MAP).empty());
+	std::vector<uint32_t> lOrder;
+	for (const auto& item : lColor)
+	{
+		lOrder.push_back(item.mPacket);
+	}
+	//Equal depths keep their insertion order.
+	CHECK(lOrder == std::vector<uint32_t>{ 4, 1, 3, 2, 0 });
+}
+
+TEST_CASE("Recording a sorted range only issues state that changes", "[draw_packet]")
+{
+	DrawPacketList lPackets;
+	const uint32_t lObjectA = lPackets.AddObject({});
+	const uint32_t lObjectB = lPackets.AddObject({});
+	//Two objects sharing a material,then a 16 bit mesh of B with another one.
+	lPackets.Add(DrawKey::Make(DrawPass::COLOR, DrawPipeline::COLOR_MSAA, 1, 1.0f), { 3, 0, 0, lObjectA, 1, false });
+	lPackets.Add(DrawKey::Make(DrawPass::COLOR, DrawPipeline::COLOR_MSAA, 1, 2.0f), { 3, 3, 0, lObjectA, 1, false });
+	lPackets.Add(DrawKey::Make(DrawPass::COLOR, DrawPipeline::COLOR_MSAA, 1, 3.0f), { 3, 6, 0, lObjectB, 1, false });
+	lPackets.Add(DrawKey::Make(DrawPass::COLOR, DrawPipeline::COLOR_MSAA, 2, 1.0f), { 3, 0, 0, lObjectB, 2, true });
+	lPackets.Add(DrawKey::Make(DrawPass::DEPTH_ONLY, DrawPipeline::DEPTH_ONLY, 0, 1.0f), { 3, 0, 0, lObjectA, NO_MATERIAL, false });
+	lPackets.Add(DrawKey::Make(DrawPass::DEPTH_ONLY, DrawPipeline::COLOR_MSAA, 0, 1.0f), { 3, 0, 0, lObjectB, NO_MATERIAL, false });
+	lPackets.Sort();
+
+	std::array<ID3D12PipelineState*, (size_t)DrawPipeline::COUNT> lPipelines = {};
+	std::array<D3D12_INDEX_BUFFER_VIEW, 2> lIndexBuffers = {};
+	CountingCommandList lCmd;
+	auto lColor = lPackets.Record(&lCmd, lPackets.GetSortedRange(DrawPass::COLOR), lPipelines, DrawPipeline::COLOR_MSAA, lIndexBuffers);
+	CHECK(lColor.mPackets == 4);
+	CHECK(lColor.mPipelineChanges == 0);
+	CHECK(lColor.mConstantChanges == 2);
+	CHECK(lColor.mMaterialChanges == 2);
+	CHECK(lColor.mIndexBufferChanges == 1);
+	CHECK(lCmd.GetDraws() == 4);
+	CHECK(lCmd.GetStateChanges() == 5);
+
+	lCmd.Reset();
+	auto lDepth = lPackets.Record(&lCmd, lPackets.GetSortedRange(DrawPass::DEPTH_ONLY), lPipelines, DrawPipeline::DEPTH_ONLY, lIndexBuffers);
+	CHECK(lDepth.mPipelineChanges == 1);
+	CHECK(lDepth.mMaterialChanges == 0);
+	CHECK(lCmd.GetDraws() == 2);
+}
+
+TEST_CASE("Split ranges cover the sorted packets in order and record every draw once", "[draw_packet]")
+{
+	DrawPacketList lPackets;
+	FillPackets(lPackets, 5000, 300, 40, 13);
+	lPackets.Sort();
+	const auto lItems = lPackets.GetSortedRange(DrawPass::COLOR);
+	REQUIRE(lItems.size() > 1000);
+
+	std::vector<std::span<const DrawPacketList::SortItem>> lRanges;
+	DrawPacketList::SplitRanges(lItems, 8, 64, lRanges);
+	CHECK(lRanges.size() == 8);
+	const auto* lNext = lItems.data();
+	for (const auto& range : lRanges)
+	{
+		REQUIRE(range.data() == lNext);
+		REQUIRE(range.size() >= 64);
+		lNext += range.size();
+	}
+	CHECK(lNext == lItems.data() + lItems.size());
+
+	//Too few packets for the minimum fall back to fewer ranges,never to an empty list.
+	DrawPacketList::SplitRanges(lItems.first(200), 8, 64, lRanges);
+	CHECK(lRanges.size() == 3);
+	DrawPacketList::SplitRanges(lItems.first(10), 8, 64, lRanges);
+	REQUIRE(lRanges.size() == 1);
+	CHECK(lRanges[0].size() == 10);
+	DrawPacketList::SplitRanges({}, 8, 64, lRanges);
+	REQUIRE(lRanges.size() == 1);
+	CHECK(lRanges[0].empty());
+
+	//Each list starts without state,so a split only adds state changes,the draws are the same.
+	std::array<ID3D12PipelineState*, (size_t)DrawPipeline::COUNT> lPipelines = {};
+	std::array<D3D12_INDEX_BUFFER_VIEW, 2> lIndexBuffers = {};
+	CountingCommandList lSerialCmd;
+	const auto lSerial = lPackets.Record(&lSerialCmd, lItems, lPipelines, DrawPipeline::COLOR_MSAA, lIndexBuffers);
+	DrawPacketList::SplitRanges(lItems, 8, 64, lRanges);
+	DrawPacketStats lSplit;
+	uint32_t lDraws = 0;
+	for (const auto& range : lRanges)
+	{
+		CountingCommandList lCmd;
+		lSplit += lPackets.Record(&lCmd, range, lPipelines, DrawPipeline::COLOR_MSAA, lIndexBuffers);
+		lDraws += lCmd.GetDraws();
+	}
+	CHECK(lDraws == lSerialCmd.GetDraws());
+	CHECK(lSplit.mPackets == lSerial.mPackets);
+	CHECK(lSplit.mMaterialChanges >= lSerial.mMaterialChanges);
+	CHECK(lSplit.mMaterialChanges <= lSerial.mMaterialChanges + lRanges.size());
+}
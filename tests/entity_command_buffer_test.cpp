@@ -0,0 +1,118 @@
+#include "entity_command_buffer.h"
+#include <catch2/catch.hpp>
+
+using namespace ECS;
+
+namespace
+{
+	struct ProducerTag
+	{
+		uint32_t mProducer = 0;
+		uint32_t mSequence = 0;
+	};
+}
+
+TEST_CASE("Deferred entities resolve inside the buffer that created them", "[entity_command_buffer]")
+{
+	entt::registry lRegistry;
+	auto lExisting = lRegistry.create();
+	EntityCommandBuffer lCommands;
+	auto lDeferred = lCommands.Create();
+	lCommands.Emplace<ProducerTag>(lDeferred, ProducerTag{ 1, 2 });
+	lCommands.Patch<ProducerTag>(lDeferred, [](ProducerTag& InTag) { InTag.mSequence++; });
+	//Patching a component the entity does not have is dropped.
+	lCommands.Patch<ProducerTag>(lExisting, [](ProducerTag& InTag) { InTag.mSequence = 100; });
+	lCommands.Destroy(lExisting);
+	//Commands on an entity that is already gone are dropped too.
+	lCommands.Emplace<ProducerTag>(lExisting, ProducerTag{ 3, 4 });
+	REQUIRE(lCommands.Size() == 6);
+
+	std::vector<entt::entity> lCreated;
+	lCommands.Playback(lRegistry, lCreated);
+	CHECK(lCommands.Empty());
+	REQUIRE(lCreated.size() == 1);
+	CHECK_FALSE(lRegistry.valid(lExisting));
+	CHECK(lRegistry.get<ProducerTag>(lCreated[0]).mProducer == 1);
+	CHECK(lRegistry.get<ProducerTag>(lCreated[0]).mSequence == 3);
+}
+
+TEST_CASE("Concurrent producers are applied exactly once and in per producer order", "[entity_command_buffer]")
+{
+	constexpr uint32_t PRODUCERS = 8;
+	constexpr uint32_t BUFFERS_PER_PRODUCER = 200;
+	constexpr uint32_t COMMANDS_PER_BUFFER = 16;
+
+	entt::registry lRegistry;
+	EntityCommandQueue lQueue;
+	std::vector<ProducerTag> lApplied;
+	std::atomic<uint32_t> lFinished = 0;
+
+	std::vector<std::thread> lProducers;
+	for (uint32_t producer = 0; producer < PRODUCERS; ++producer)
+	{
+		lProducers.emplace_back([&, producer]()
+			{
+				uint32_t lSequence = 0;
+				for (uint32_t buffer = 0; buffer < BUFFERS_PER_PRODUCER; ++buffer)
+				{
+					EntityCommandBuffer lCommands;
+					for (uint32_t i = 0; i < COMMANDS_PER_BUFFER; ++i, ++lSequence)
+					{
+						const ProducerTag lTag = { producer, lSequence };
+						//Every fourth command also creates an entity,the rest only log.
+						if (i % 4 == 0)
+						{
+							lCommands.Emplace<ProducerTag>(lCommands.Create(), lTag);
+						}
+						lCommands.Run([&lApplied, lTag](entt::registry&, std::span<entt::entity>) { lApplied.push_back(lTag); });
+					}
+					lQueue.Submit(std::move(lCommands));
+				}
+				lFinished++;
+			});
+	}
+
+	//The consumer drains while producers are still pushing,like the frame sync point does.
+	size_t lCreated = 0;
+	while (lFinished < PRODUCERS)
+	{
+		lCreated += lQueue.Playback(lRegistry).size();
+		std::this_thread::yield();
+	}
+	for (auto& producer : lProducers)
+	{
+		producer.join();
+	}
+	lCreated += lQueue.Playback(lRegistry).size();
+	CHECK(lQueue.Playback(lRegistry).empty());
+
+	constexpr uint32_t COMMANDS_PER_PRODUCER = BUFFERS_PER_PRODUCER * COMMANDS_PER_BUFFER;
+	REQUIRE(lApplied.size() == PRODUCERS * COMMANDS_PER_PRODUCER);
+	CHECK(lCreated == PRODUCERS * COMMANDS_PER_PRODUCER / 4);
+	std::vector<uint32_t> lNextSequence(PRODUCERS, 0);
+	for (const auto& tag : lApplied)
+	{
+		REQUIRE(tag.mProducer < PRODUCERS);
+		//Sequences are dense per producer,so in order also means nothing is lost or repeated.
+		REQUIRE(tag.mSequence == lNextSequence[tag.mProducer]);
+		lNextSequence[tag.mProducer]++;
+	}
+	CHECK(std::all_of(lNextSequence.begin(), lNextSequence.end(), [](uint32_t InNext) { return InNext == COMMANDS_PER_PRODUCER; }));
+
+	std::vector<uint32_t> lEntitiesPerProducer(PRODUCERS, 0);
+	lRegistry.view<ProducerTag>().each([&](const ProducerTag& InTag) { lEntitiesPerProducer[InTag.mProducer]++; });
+	CHECK(std::all_of(lEntitiesPerProducer.begin(), lEntitiesPerProducer.end(), [](uint32_t InCount) { return InCount == COMMANDS_PER_PRODUCER / 4; }));
+}
+
+TEST_CASE("Discarded buffers are never applied", "[entity_command_buffer]")
+{
+	entt::registry lRegistry;
+	EntityCommandQueue lQueue;
+	uint32_t lRuns = 0;
+	EntityCommandBuffer lCommands;
+	lCommands.Run([&lRuns](entt::registry&, std::span<entt::entity>) { lRuns++; });
+	lQueue.Submit(std::move(lCommands));
+	lQueue.Discard();
+	CHECK(lQueue.Playback(lRegistry).empty());
+	CHECK(lRuns == 0);
+}
@@ -0,0 +1,156 @@
+#include "frame_timeline.h"
+#include "synthetic_scene.h"
+#include <catch2/catch.hpp>
+
+using namespace Renderer;
+
+namespace
+{
+	//Queue that completes nothing on its own,the test retires values and every CPU wait is recorded.
+	class SimulatedQueue final : public TimelineQueue
+	{
+	public:
+		uint64_t Signal() override
+		{
+			return ++mLastSignaled;
+		}
+
+		void Wait(const TimelineQueue& InOther, uint64_t InValue) override
+		{
+
+		}
+
+		uint64_t GetCompletedValue() const override { return mCompleted; }
+
+		void WaitForValue(uint64_t InValue) override
+		{
+			REQUIRE(InValue <= mLastSignaled);
+			mWaits.push_back(InValue);
+			mCompleted = std::max(mCompleted, InValue);
+		}
+
+		void Complete(uint64_t InValue) { mCompleted = std::max(mCompleted, InValue); }
+
+		uint64_t mCompleted = 0;
+		std::vector<uint64_t> mWaits;
+	};
+}
+
+TEST_CASE("Frame pacer clamps the frames in flight", "[frame_pacer]")
+{
+	SimulatedQueue lQueue;
+	FramePacer lPacer(lQueue, 0);
+	CHECK(lPacer.GetFramesInFlight() == 1);
+	lPacer.SetFramesInFlight(FramePacer::MAX_FRAMES_IN_FLIGHT + 5);
+	CHECK(lPacer.GetFramesInFlight() == FramePacer::MAX_FRAMES_IN_FLIGHT);
+	lPacer.SetFramesInFlight(2);
+	CHECK(lPacer.GetFramesInFlight() == 2);
+	CHECK(FramePacer(lQueue).GetFramesInFlight() == FramePacer::DEFAULT_FRAMES_IN_FLIGHT);
+}
+
+TEST_CASE("Frame pacer waits on frame F-N before reusing a slot", "[frame_pacer]")
+{
+	for (uint32_t lFramesInFlight = 1; lFramesInFlight <= FramePacer::MAX_FRAMES_IN_FLIGHT; ++lFramesInFlight)
+	{
+		SimulatedQueue lQueue;
+		FramePacer lPacer(lQueue, lFramesInFlight);
+		std::vector<uint64_t> lFrameValues;
+		CHECK(lPacer.GetLastFrameValue() == 0);
+		for (uint64_t f = 0; f < 12; ++f)
+		{
+			const size_t lWaitsBefore = lQueue.mWaits.size();
+			lPacer.BeginFrame();
+			REQUIRE(lPacer.GetFrame() == f);
+			CHECK(lPacer.GetSlot() == f % FramePacer::MAX_FRAMES_IN_FLIGHT);
+			if (f < lFramesInFlight)
+			{
+				//The first N frames start without blocking.
+				CHECK(lQueue.mWaits.size() == lWaitsBefore);
+				CHECK(lPacer.GetStats().mGpuFramesInFlight == f);
+			}
+			else
+			{
+				//The GPU never completes anything on its own,so frame F blocks on exactly frame F-N.
+				REQUIRE(lQueue.mWaits.size() == lWaitsBefore + 1);
+				CHECK(lQueue.mWaits.back() == lFrameValues[f - lFramesInFlight]);
+				CHECK(lPacer.GetStats().mGpuFramesInFlight == lFramesInFlight);
+			}
+			//Whatever last used this slot has completed by now.
+			if (f >= FramePacer::MAX_FRAMES_IN_FLIGHT)
+			{
+				CHECK(lQueue.IsComplete(lFrameValues[f - FramePacer::MAX_FRAMES_IN_FLIGHT]));
+			}
+			const uint64_t lValue = lPacer.EndFrame();
+			CHECK(lValue == lQueue.GetLastSignaled());
+			CHECK(lPacer.GetLastFrameValue() == lValue);
+			lFrameValues.push_back(lValue);
+		}
+	}
+}
+
+TEST_CASE("Frame pacer does not block on frames the GPU already finished", "[frame_pacer]")
+{
+	SimulatedQueue lQueue;
+	FramePacer lPacer(lQueue, 2);
+	for (int f = 0; f < 10; ++f)
+	{
+		lPacer.BeginFrame();
+		CHECK(lPacer.GetStats().mGpuFramesInFlight == 0);
+		CHECK(lPacer.GetStats().mWaitMs == 0.0f);
+		lQueue.Complete(lPacer.EndFrame());
+	}
+	CHECK(lQueue.mWaits.empty());
+	//Values unrelated to frames do not confuse the pacer,it only waits on frame end values.
+	lQueue.Signal();
+	lPacer.BeginFrame();
+	CHECK(lQueue.mWaits.empty());
+	const uint64_t lValue = lPacer.EndFrame();
+	CHECK(lValue == lQueue.GetLastSignaled());
+	CHECK(lPacer.GetLastFrameValue() == lValue);
+}
+
+TEST_CASE("Frame pacer applies a new frame count at the next frame", "[frame_pacer]")
+{
+	REQUIRE(FramePacer::MAX_FRAMES_IN_FLIGHT >= 3);
+	SimulatedQueue lQueue;
+	FramePacer lPacer(lQueue, 3);
+	std::vector<uint64_t> lFrameValues;
+	auto lRunFrame = [&]()
+	{
+		lPacer.BeginFrame();
+		lFrameValues.push_back(lPacer.EndFrame());
+	};
+	for (int f = 0; f < 3; ++f)
+	{
+		lRunFrame();
+	}
+	CHECK(lQueue.mWaits.empty());
+
+	//Dropping to one frame makes frame 3 wait on frame 2,which also covers frames 0 and 1.
+	lPacer.SetFramesInFlight(1);
+	lRunFrame();
+	REQUIRE(lQueue.mWaits.size() == 1);
+	CHECK(lQueue.mWaits.back() == lFrameValues[2]);
+	lRunFrame();
+	REQUIRE(lQueue.mWaits.size() == 2);
+	CHECK(lQueue.mWaits.back() == lFrameValues[3]);
+
+	//Raising it again lets the CPU run ahead,frames 5 and 6 wait on frames 2 and 3 which already completed.
+	lPacer.SetFramesInFlight(3);
+	lRunFrame();
+	lRunFrame();
+	CHECK(lQueue.mWaits.size() == 2);
+	lRunFrame();
+	REQUIRE(lQueue.mWaits.size() == 3);
+	CHECK(lQueue.mWaits.back() == lFrameValues[4]);
+
+	//Changing the count mid frame only takes effect at the next BeginFrame.
+	lPacer.BeginFrame();
+	REQUIRE(lQueue.mWaits.size() == 4);
+	CHECK(lQueue.mWaits.back() == lFrameValues[5]);
+	lPacer.SetFramesInFlight(1);
+	lFrameValues.push_back(lPacer.EndFrame());
+	lRunFrame();
+	REQUIRE(lQueue.mWaits.size() == 5);
+	CHECK(lQueue.mWaits.back() == lFrameValues[8]);
+}
@@ -0,0 +1,188 @@
+#include "geometry_allocator.h"
+#include "synthetic_scene.h"
+#include <catch2/catch.hpp>
+
+using namespace Renderer;
+
+namespace
+{
+	//Mirror of the live allocations,checked against the allocator after every step.
+	void CheckAllocations(const GeometryAllocator& InAllocator, const std::map<uint32_t, uint32_t>& InLive)
+	{
+		uint32_t lUsed = 0;
+		uint32_t lEnd = 0;
+		for (auto [offset, size] : InLive)
+		{
+			REQUIRE(offset >= lEnd);
+			REQUIRE(InAllocator.GetSize(offset) == size);
+			lEnd = offset + size;
+			lUsed += size;
+		}
+		REQUIRE(lEnd <= InAllocator.GetCapacity());
+		const auto lStats = InAllocator.GetStats();
+		REQUIRE(lStats.mUsed == lUsed);
+		REQUIRE(lStats.mAllocations == InLive.size());
+		REQUIRE(lStats.mLargestFree <= lStats.mCapacity - lUsed);
+	}
+}
+
+TEST_CASE("Geometry allocator keeps allocations disjoint under random use", "[geometry_allocator]")
+{
+	GeometryAllocator lAllocator(4096);
+	std::map<uint32_t, uint32_t> lLive;
+	std::mt19937 lRandom(11);
+	std::uniform_int_distribution<int> lAction(0, 19);
+	std::uniform_int_distribution<uint32_t> lSmall(1, 64);
+	std::uniform_int_distribution<uint32_t> lLarge(65, 3000);
+	uint32_t lFailures = 0;
+	for (int step = 0; step < 20000; ++step)
+	{
+		const int lActionValue = lAction(lRandom);
+		if (lActionValue < 10)
+		{
+			const uint32_t lCount = lActionValue < 8 ? lSmall(lRandom) : lLarge(lRandom);
+			const uint32_t lOffset = lAllocator.Allocate(lCount);
+			if (lOffset == GeometryAllocator::INVALID_OFFSET)
+			{
+				//The request fails only when no free block in its rounded size class or above exists.
+				CHECK(lAllocator.GetStats().mLargestFree < lCount + lCount / 16 + 1);
+				lFailures++;
+			}
+			else
+			{
+				REQUIRE(lLive.count(lOffset) == 0);
+				lLive[lOffset] = lCount;
+			}
+		}
+		else if (lActionValue < 19)
+		{
+			if (!lLive.empty())
+			{
+				auto lIt = std::next(lLive.begin(), std::uniform_int_distribution<size_t>(0, lLive.size() - 1)(lRandom));
+				lAllocator.Free(lIt->first);
+				CHECK(lAllocator.GetSize(lIt->first) == 0);
+				lLive.erase(lIt);
+			}
+		}
+		else if (lAllocator.GetCapacity() < (1u << 20))
+		{
+			lAllocator.Grow(lAllocator.GetCapacity() + std::uniform_int_distribution<uint32_t>(0, 2048)(lRandom));
+		}
+		CheckAllocations(lAllocator, lLive);
+	}
+	CHECK(lFailures > 0);
+
+	//Freeing everything merges the range back into one block,whatever order it was split in.
+	for (auto [offset, size] : lLive)
+	{
+		lAllocator.Free(offset);
+	}
+	const auto lStats = lAllocator.GetStats();
+	CHECK(lStats.mUsed == 0);
+	CHECK(lStats.mFreeBlocks == 1);
+	CHECK(lStats.mLargestFree == lAllocator.GetCapacity());
+	//Good fit rounds the request up a size class,so ask for a little less than everything.
+	CHECK(lAllocator.Allocate(lAllocator.GetCapacity() - lAllocator.GetCapacity() / 16) == 0);
+}
+
+TEST_CASE("Geometry allocator grows into the free block at the end", "[geometry_allocator]")
+{
+	GeometryAllocator lAllocator(100);
+	CHECK(lAllocator.Allocate(60) == 0);
+	CHECK(lAllocator.Allocate(60) == GeometryAllocator::INVALID_OFFSET);
+	lAllocator.Grow(140);
+	CHECK(lAllocator.GetStats().mFreeBlocks == 1);
+	CHECK(lAllocator.Allocate(80) == 60);
+	//Full range,the new space becomes a block of its own.
+	lAllocator.Grow(200);
+	CHECK(lAllocator.GetStats().mFreeBlocks == 1);
+	CHECK(lAllocator.GetStats().mLargestFree == 60);
+	CHECK(lAllocator.Allocate(60) == 140);
+}
+
+TEST_CASE("Geometry allocator plans moves into the lowest holes", "[geometry_allocator]")
+{
+	SECTION("A single hole below an allocation")
+	{
+		GeometryAllocator lAllocator(100);
+		CHECK(lAllocator.Allocate(10) == 0);
+		CHECK(lAllocator.Allocate(10) == 10);
+		CHECK(lAllocator.Allocate(80) == 20);
+		lAllocator.Free(0);
+		const auto lMoves = lAllocator.PlanDefragment(8);
+		REQUIRE(lMoves.size() == 1);
+		CHECK(lMoves[0].mFrom == 10);
+		CHECK(lMoves[0].mTo == 0);
+		CHECK(lMoves[0].mCount == 10);
+		lAllocator.Free(10);
+		CHECK(lAllocator.GetStats().mFreeBlocks == 1);
+		CHECK(lAllocator.GetStats().mLargestFree == 10);
+	}
+
+	SECTION("Nothing to do when the only hole is at the end")
+	{
+		GeometryAllocator lAllocator(100);
+		CHECK(lAllocator.Allocate(10) == 0);
+		CHECK(lAllocator.Allocate(10) == 10);
+		CHECK(lAllocator.PlanDefragment(8).empty());
+		lAllocator.Free(10);
+		CHECK(lAllocator.PlanDefragment(8).empty());
+		CHECK(lAllocator.Allocate(88) == 10);
+		CHECK(lAllocator.PlanDefragment(8).empty());
+	}
+
+	SECTION("Random fragmentation packs the bottom of the range")
+	{
+		GeometryAllocator lAllocator(1 << 18);
+		std::map<uint32_t, uint32_t> lLive;
+		std::mt19937 lRandom(23);
+		std::uniform_int_distribution<uint32_t> lCount(1, 512);
+		for (int i = 0; i < 400; ++i)
+		{
+			const uint32_t lSize = lCount(lRandom);
+			const uint32_t lOffset = lAllocator.Allocate(lSize);
+			REQUIRE(lOffset != GeometryAllocator::INVALID_OFFSET);
+			lLive[lOffset] = lSize;
+		}
+		for (auto lIt = lLive.begin(); lIt != lLive.end();)
+		{
+			if (std::bernoulli_distribution(0.5)(lRandom))
+			{
+				lAllocator.Free(lIt->first);
+				lIt = lLive.erase(lIt);
+			}
+			else
+			{
+				++lIt;
+			}
+		}
+		const uint32_t lHighestBefore = std::prev(lLive.end())->first;
+
+		const auto lMoves = lAllocator.PlanDefragment(32);
+		REQUIRE(!lMoves.empty());
+		CHECK(lMoves.size() <= 32);
+		for (const auto& move : lMoves)
+		{
+			REQUIRE(lLive.count(move.mFrom) == 1);
+			CHECK(lLive[move.mFrom] == move.mCount);
+			CHECK(move.mTo < move.mFrom);
+			//The target is allocated while the source still is.
+			CHECK(lAllocator.GetSize(move.mTo) == move.mCount);
+			lLive[move.mTo] = move.mCount;
+		}
+		CheckAllocations(lAllocator, lLive);
+		//Sources are picked from the top down.
+		CHECK(lMoves[0].mFrom == lHighestBefore);
+		for (size_t i = 1; i < lMoves.size(); ++i)
+		{
+			CHECK(lMoves[i].mFrom < lMoves[i - 1].mFrom);
+		}
+		for (const auto& move : lMoves)
+		{
+			lAllocator.Free(move.mFrom);
+			lLive.erase(move.mFrom);
+		}
+		CheckAllocations(lAllocator, lLive);
+		CHECK(std::prev(lLive.end())->first < lHighestBefore);
+	}
+}
@@ -0,0 +1,152 @@
+#include "geometry_pool.h"
+#include "synthetic_scene.h"
+#include <catch2/catch.hpp>
+
+using namespace Renderer;
+
+namespace
+{
+	constexpr uint32_t STRIDES[] = { VERTEX_SIZE_IN_BYTE, sizeof(uint32_t), sizeof(uint16_t) };
+
+	//What the pools held before they were sized from the scene,1 GB of vertices each.
+	constexpr uint64_t LEGACY_POOL_BYTES = 1ull * 1024 * 1024 * 1024;
+
+	//Mesh asset with InVertices vertices and InTriangles triangles over them.
+	ECS::StaticMeshAsset MakeMeshAsset(uint32_t InVertices, uint32_t InTriangles)
+	{
+		ECS::StaticMesh lMesh = {};
+		lMesh.mVertices.resize(InVertices);
+		for (uint32_t i = 0; i < InTriangles * 3; ++i)
+		{
+			lMesh.mIndices.push_back(i % InVertices);
+		}
+		return ECS::StaticMeshAsset(std::move(lMesh));
+	}
+}
+
+TEST_CASE("Geometry pools grow in whole pages", "[geometry_pool]")
+{
+	for (uint32_t stride : STRIDES)
+	{
+		const uint32_t lPage = GeometryPool::GetPageCapacity(stride);
+		CHECK(lPage == GeometryPool::PAGE_BYTES / stride);
+
+		//A single element more still takes a whole page.
+		CHECK(GeometryPool::GetGrownCapacity(lPage, 1, stride) == GeometryPool::PAGE_BYTES * 2 / stride);
+		for (uint64_t count : { uint64_t(1), uint64_t(lPage / 3), uint64_t(lPage), uint64_t(lPage) * 5 + 7 })
+		{
+			const uint32_t lCapacity = GeometryPool::GetGrownCapacity(lPage, count, stride);
+			const uint64_t lPages = (uint64_t(lCapacity) * stride + GeometryPool::PAGE_BYTES - 1) / GeometryPool::PAGE_BYTES;
+			CHECK(lCapacity == lPages * GeometryPool::PAGE_BYTES / stride);
+			//Room for the request with an eighth of slack,and not a page more than that.
+			CHECK(lCapacity >= lPage + count + count / 8);
+			CHECK(uint64_t(lCapacity - lPage - count - count / 8) * stride <= GeometryPool::PAGE_BYTES + stride);
+		}
+	}
+}
+
+TEST_CASE("A reservation holds every mesh of the batch without growing again", "[geometry_pool]")
+{
+	std::mt19937 lRandom(5);
+	std::uniform_int_distribution<uint32_t> lMeshSize(1, 20000);
+	for (int batch = 0; batch < 200; ++batch)
+	{
+		const uint32_t lStride = STRIDES[batch % 3];
+		GeometryAllocator lAllocator(GeometryPool::GetPageCapacity(lStride));
+		//Some pools are fragmented by earlier loads and unloads first.
+		std::vector<uint32_t> lEarlier;
+		for (int i = batch % 4 * 10; i > 0; --i)
+		{
+			const uint32_t lOffset = lAllocator.Allocate(lMeshSize(lRandom) / 8 + 1);
+			if (lOffset != GeometryAllocator::INVALID_OFFSET)
+			{
+				lEarlier.push_back(lOffset);
+			}
+		}
+		for (size_t i = 0; i < lEarlier.size(); i += 2)
+		{
+			lAllocator.Free(lEarlier[i]);
+		}
+
+		std::vector<uint32_t> lMeshes(std::uniform_int_distribution<int>(1, 300)(lRandom));
+		uint64_t lDemand = 0;
+		for (auto& mesh : lMeshes)
+		{
+			mesh = lMeshSize(lRandom);
+			lDemand += mesh;
+		}
+		const uint32_t lCapacity = GeometryPool::GetReservedCapacity(lAllocator, lDemand, lStride);
+		REQUIRE(lCapacity >= lAllocator.GetCapacity());
+		lAllocator.Grow(lCapacity);
+		for (uint32_t mesh : lMeshes)
+		{
+			REQUIRE(lAllocator.Allocate(mesh) != GeometryAllocator::INVALID_OFFSET);
+		}
+	}
+}
+
+TEST_CASE("A reservation that fits the free space keeps the capacity", "[geometry_pool]")
+{
+	const uint32_t lPage = GeometryPool::GetPageCapacity(sizeof(uint32_t));
+	GeometryAllocator lAllocator(lPage);
+	CHECK(GeometryPool::GetReservedCapacity(lAllocator, 0, sizeof(uint32_t)) == lPage);
+	CHECK(GeometryPool::GetReservedCapacity(lAllocator, lPage / 2, sizeof(uint32_t)) == lPage);
+	//The whole page is free,but not with the slack TLSF rounding needs.
+	CHECK(GeometryPool::GetReservedCapacity(lAllocator, lPage, sizeof(uint32_t)) > lPage);
+}
+
+TEST_CASE("Meshes under 65536 vertices use 16 bit indices", "[geometry_pool]")
+{
+	CHECK(Uses16BitIndices(1));
+	CHECK(Uses16BitIndices(65535));
+	CHECK(!Uses16BitIndices(65536));
+	CHECK(!Uses16BitIndices(1 << 20));
+
+	GeometryDemand lDemand;
+	lDemand.Add(MakeMeshAsset(65535, 10));
+	CHECK(lDemand.mVertices == 65535);
+	CHECK(lDemand.mIndices16 == 30);
+	CHECK(lDemand.mIndices == 0);
+	lDemand.Add(MakeMeshAsset(65536, 7));
+	CHECK(lDemand.mVertices == 65535 + 65536);
+	CHECK(lDemand.mIndices16 == 30);
+	CHECK(lDemand.mIndices == 21);
+}
+
+TEST_CASE("Startup pool sizes follow the scene demand", "[geometry_pool]")
+{
+	//A city of small props plus a few large meshes that need 32 bit indices.
+	std::vector<ECS::StaticMeshAsset> lAssets;
+	for (uint32_t i = 0; i < 500; ++i)
+	{
+		lAssets.push_back(ECS::StaticMeshAsset(Synthetic::MakeCubeStaticMesh(1 + i % 6, "Prop" + std::to_string(i))));
+	}
+	lAssets.push_back(MakeMeshAsset(100000, 150000));
+	lAssets.push_back(MakeMeshAsset(70000, 90000));
+	GeometryDemand lDemand;
+	for (const auto& asset : lAssets)
+	{
+		lDemand.Add(asset);
+	}
+	REQUIRE(lDemand.mIndices == 3 * (150000 + 90000));
+	REQUIRE(lDemand.mIndices16 > 0);
+
+	const std::pair<uint64_t, uint32_t> lPools[] = {
+		{ lDemand.mVertices, VERTEX_SIZE_IN_BYTE },
+		{ lDemand.mIndices, sizeof(uint32_t) },
+		{ lDemand.mIndices16, sizeof(uint16_t) } };
+	for (auto [demand, stride] : lPools)
+	{
+		GeometryAllocator lAllocator(GeometryPool::GetPageCapacity(stride));
+		lAllocator.Grow(GeometryPool::GetReservedCapacity(lAllocator, demand, stride));
+		const uint64_t lBytes = uint64_t(lAllocator.GetCapacity()) * stride;
+		CHECK(lBytes >= demand * stride);
+		//Demand plus slack rounded up to a page,on top of the page every pool starts with.
+		CHECK(lBytes <= (demand + demand / 8 + 1) * stride + 2 * GeometryPool::PAGE_BYTES);
+		CHECK(lBytes < LEGACY_POOL_BYTES / 16);
+	}
+
+	//An empty scene keeps the single page.
+	GeometryAllocator lEmpty(GeometryPool::GetPageCapacity(VERTEX_SIZE_IN_BYTE));
+	CHECK(GeometryPool::GetReservedCapacity(lEmpty, GeometryDemand().mVertices, VERTEX_SIZE_IN_BYTE) == lEmpty.GetCapacity());
+}
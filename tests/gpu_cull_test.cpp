@@ -0,0 +1,430 @@
+#include "gpu_cull.h"
+#include "occlusion_culling.h"
+#include "synthetic_scene.h"
+#include <catch2/catch.hpp>
+
+using namespace Renderer;
+using namespace DirectX;
+
+namespace
+{
+	constexpr uint32_t DEPTH_WIDTH = 320;
+	constexpr uint32_t DEPTH_HEIGHT = 176;
+	const SimpleMath::Vector3 EYE(0.0f, 2.0f, 0.0f);
+
+	SimpleMath::Matrix MakeStreetViewPrj(const SimpleMath::Vector3& InEye = EYE)
+	{
+		return Synthetic::MakeViewPrj(InEye, InEye + SimpleMath::Vector3(0.0f, 0.0f, 1.0f), XM_PIDIV2, float(DEPTH_WIDTH) / DEPTH_HEIGHT, 0.1f);
+	}
+
+	void SetRows(XMFLOAT4* OutRows, const SimpleMath::Matrix& InMatrix)
+	{
+		for (int i = 0; i < 4; ++i)
+		{
+			OutRows[i] = XMFLOAT4(InMatrix.m[i]);
+		}
+	}
+
+	//Camera pass constants as Renderer fills them,the Hi-Z was rendered from the same view.
+	GpuCullConstants MakeCameraConstants(const SimpleMath::Matrix& InViewPrj, uint32_t InInstanceCount, bool InUseOcclusion)
+	{
+		GpuCullConstants lConstants = {};
+		GpuCullReference::InitHiZLayout(lConstants, DEPTH_WIDTH, DEPTH_HEIGHT);
+		SetRows(lConstants.mViewPrj, InViewPrj);
+		SetRows(lConstants.mOcclusionViewPrj, InViewPrj);
+		lConstants.mIndexBuffers[0].Format = DXGI_FORMAT_R32_UINT;
+		lConstants.mIndexBuffers[1].Format = DXGI_FORMAT_R16_UINT;
+		lConstants.mInstanceCount = InInstanceCount;
+		lConstants.mPassFlag = GPU_INSTANCE_CAMERA;
+		lConstants.mClipPlanes = GPU_CULL_SIDE_PLANES | GPU_CULL_NEAR_PLANE;
+		lConstants.mUseOcclusion = InUseOcclusion ? 1 : 0;
+		return lConstants;
+	}
+
+	GpuInstance MakeInstance(const BoundingBox& InBounds, uint32_t InFlags, uint32_t InId)
+	{
+		GpuInstance lInstance = {};
+		lInstance.mBoundsCenter = InBounds.Center;
+		lInstance.mBoundsExtents = InBounds.Extents;
+		lInstance.mFlags = InFlags;
+		lInstance.mMaterial = InId % 7;
+		lInstance.mIndexCount = 6 * (InId % 5 + 1);
+		lInstance.mStartIndexLocation = InId * 36;
+		lInstance.mBaseVertexLocation = int32_t(InId * 8);
+		return lInstance;
+	}
+
+	//Props on the ground,between the buildings and inside them.
+	std::vector<BoundingBox> MakeProps(uint32_t InCount, uint32_t InSeed)
+	{
+		std::mt19937 lRandom(InSeed);
+		std::uniform_real_distribution<float> lX(-120.0f, 120.0f);
+		std::uniform_real_distribution<float> lZ(-30.0f, 220.0f);
+		std::uniform_real_distribution<float> lExtent(0.2f, 2.0f);
+		std::vector<BoundingBox> lProps;
+		for (uint32_t i = 0; i < InCount; ++i)
+		{
+			const float lExtentValue = lExtent(lRandom);
+			lProps.emplace_back(XMFLOAT3(lX(lRandom), lExtentValue, lZ(lRandom)), XMFLOAT3(lExtentValue, lExtentValue, lExtentValue));
+		}
+		return lProps;
+	}
+
+	std::vector<float> RasterizeCity(const SimpleMath::Matrix& InViewPrj)
+	{
+		SoftwareOcclusionCuller lCuller(DEPTH_WIDTH, DEPTH_HEIGHT);
+		lCuller.BeginFrame(InViewPrj);
+		for (const auto& building : Synthetic::MakeCity(8, 8, 16.0f, 8.0f, 7).mBuildings)
+		{
+			const auto lMesh = Synthetic::MakeBoxMesh(building);
+			lCuller.RasterizeOccluder(lMesh.mPositions.data(), sizeof(XMFLOAT3), lMesh.mPositions.size(), lMesh.mIndices, SimpleMath::Matrix::Identity);
+		}
+		return std::vector<float>(lCuller.GetDepth().begin(), lCuller.GetDepth().end());
+	}
+
+	//Plane by plane on the corners,written against SimpleMath instead of the reference's row arithmetic.
+	bool AllCornersOutsideOnePlane(const SimpleMath::Matrix& InViewPrj, const BoundingBox& InBounds, bool InNearPlane)
+	{
+		XMFLOAT3 lCorners[BoundingBox::CORNER_COUNT];
+		InBounds.GetCorners(lCorners);
+		for (int plane = 0; plane < (InNearPlane ? 5 : 4); ++plane)
+		{
+			bool lAllOutside = true;
+			for (const auto& corner : lCorners)
+			{
+				const SimpleMath::Vector4 lClip = XMVector4Transform(SimpleMath::Vector4(corner.x, corner.y, corner.z, 1.0f), InViewPrj);
+				const float lDistance[] = { lClip.x + lClip.w, lClip.w - lClip.x, lClip.y + lClip.w, lClip.w - lClip.y, lClip.w - lClip.z };
+				lAllOutside = lAllOutside && lDistance[plane] < 0.0f;
+			}
+			if (lAllOutside)
+			{
+				return true;
+			}
+		}
+		return false;
+	}
+
+	//Some point on the box surface is clearly in front of the depth buffer,so any correct occlusion test keeps it.
+	bool HasVisibleSample(const SimpleMath::Matrix& InViewPrj, const BoundingBox& InBounds, std::span<const float> InDepth)
+	{
+		constexpr int STEPS = 8;
+		for (int axis = 0; axis < 3; ++axis)
+		{
+			for (float side : { -1.0f, 1.0f })
+			{
+				for (int u = 0; u <= STEPS; ++u)
+				{
+					for (int v = 0; v <= STEPS; ++v)
+					{
+						float lLocal[3];
+						lLocal[axis] = side;
+						lLocal[(axis + 1) % 3] = u * 2.0f / STEPS - 1.0f;
+						lLocal[(axis + 2) % 3] = v * 2.0f / STEPS - 1.0f;
+						const SimpleMath::Vector4 lPoint(InBounds.Center.x + lLocal[0] * InBounds.Extents.x, InBounds.Center.y + lLocal[1] * InBounds.Extents.y,
+							InBounds.Center.z + lLocal[2] * InBounds.Extents.z, 1.0f);
+						const SimpleMath::Vector4 lClip = XMVector4Transform(lPoint, InViewPrj);
+						if (lClip.w <= 0.0f || lClip.z > lClip.w)
+						{
+							continue;
+						}
+						const float lX = (lClip.x / lClip.w * 0.5f + 0.5f) * DEPTH_WIDTH;
+						const float lY = (0.5f - lClip.y / lClip.w * 0.5f) * DEPTH_HEIGHT;
+						if (lX < 0.0f || lY < 0.0f || lX >= DEPTH_WIDTH || lY >= DEPTH_HEIGHT)
+						{
+							continue;
+						}
+						if (lClip.z / lClip.w > InDepth[size_t(lY) * DEPTH_WIDTH + size_t(lX)] + 1e-4f)
+						{
+							return true;
+						}
+					}
+				}
+			}
+		}
+		return false;
+	}
+}
+
+TEST_CASE("Hi-Z levels hold the farthest depth of the pixels they cover", "[gpu_cull]")
+{
+	for (auto [width, height] : { std::pair<uint32_t, uint32_t>(DEPTH_WIDTH, DEPTH_HEIGHT), { 1, 1 }, { 1920, 1080 }, { 1917, 1083 }, { 37, 300 } })
+	{
+		GpuCullConstants lConstants = {};
+		const uint32_t lTexels = GpuCullReference::InitHiZLayout(lConstants, width, height);
+		CHECK(lConstants.mHiZWidth == (width + 7) / 8);
+		CHECK(lConstants.mHiZHeight == (height + 7) / 8);
+		REQUIRE(lConstants.mHiZLevels > 0);
+		REQUIRE(lConstants.mHiZLevels <= GpuCullConstants::MAX_HIZ_LEVELS);
+		CHECK(lTexels == lConstants.mHiZOffsets[lConstants.mHiZLevels - 1] + 1);
+
+		std::mt19937 lRandom(width * 31 + height);
+		std::uniform_real_distribution<float> lDepthValue(0.0f, 1.0f);
+		std::vector<float> lDepth(size_t(width) * height);
+		for (auto& depth : lDepth)
+		{
+			depth = lDepthValue(lRandom);
+		}
+		std::vector<float> lHiZ;
+		GpuCullReference::BuildHiZ(lConstants, lDepth, lHiZ);
+		REQUIRE(lHiZ.size() == lTexels);
+
+		uint32_t lLevelWidth = lConstants.mHiZWidth;
+		uint32_t lLevelHeight = lConstants.mHiZHeight;
+		for (uint32_t level = 0; level < lConstants.mHiZLevels; ++level)
+		{
+			const uint32_t lTexelSize = GpuCullReference::HIZ_TILE_SIZE << level;
+			for (uint32_t y = 0; y < lLevelHeight; ++y)
+			{
+				for (uint32_t x = 0; x < lLevelWidth; ++x)
+				{
+					float lFarthest = 1.0f;
+					for (uint32_t py = y * lTexelSize; py < std::min((y + 1) * lTexelSize, height); ++py)
+					{
+						for (uint32_t px = x * lTexelSize; px < std::min((x + 1) * lTexelSize, width); ++px)
+						{
+							lFarthest = std::min(lFarthest, lDepth[size_t(py) * width + px]);
+						}
+					}
+					REQUIRE(lHiZ[lConstants.mHiZOffsets[level] + size_t(y) * lLevelWidth + x] == lFarthest);
+				}
+			}
+			if (level + 1 == lConstants.mHiZLevels)
+			{
+				//Down to a single texel,unless the layout ran out of levels first.
+				CHECK(((lLevelWidth == 1 && lLevelHeight == 1) || lConstants.mHiZLevels == GpuCullConstants::MAX_HIZ_LEVELS));
+				break;
+			}
+			REQUIRE(lConstants.mHiZOffsets[level + 1] == lConstants.mHiZOffsets[level] + lLevelWidth * lLevelHeight);
+			lLevelWidth = (lLevelWidth + 1) / 2;
+			lLevelHeight = (lLevelHeight + 1) / 2;
+		}
+	}
+}
+
+TEST_CASE("Frustum culling rejects a box only when every corner is outside one plane", "[gpu_cull]")
+{
+	const auto lViewPrj = MakeStreetViewPrj();
+	const auto lProps = MakeProps(4000, 3);
+	auto lConstants = MakeCameraConstants(lViewPrj, 0, false);
+	uint32_t lCulled = 0;
+	for (size_t i = 0; i < lProps.size(); ++i)
+	{
+		const auto lInstance = MakeInstance(lProps[i], GPU_INSTANCE_CAMERA, uint32_t(i));
+		const bool lFrustumCulled = GpuCullReference::IsFrustumCulled(lConstants, lInstance);
+		REQUIRE(lFrustumCulled == AllCornersOutsideOnePlane(lViewPrj, lProps[i], true));
+		lCulled += lFrustumCulled ? 1 : 0;
+	}
+	//A quarter of the props are off to the sides or behind the camera.
+	CHECK(lCulled > lProps.size() / 5);
+	CHECK(lCulled < lProps.size());
+
+	//The shadow pass keeps boxes in front of its near plane.
+	lConstants.mClipPlanes = GPU_CULL_SIDE_PLANES;
+	const auto lNearViewPrj = Synthetic::MakeViewPrj(EYE, EYE + SimpleMath::Vector3(0.0f, 0.0f, 1.0f), XM_PIDIV2, 1.0f, 5.0f);
+	SetRows(lConstants.mViewPrj, lNearViewPrj);
+	const auto lCaster = MakeInstance(BoundingBox(XMFLOAT3(0.0f, 2.0f, 2.0f), XMFLOAT3(0.5f, 0.5f, 0.5f)), GPU_INSTANCE_SHADOW_CASTER, 0);
+	CHECK(!GpuCullReference::IsFrustumCulled(lConstants, lCaster));
+	lConstants.mClipPlanes |= GPU_CULL_NEAR_PLANE;
+	CHECK(GpuCullReference::IsFrustumCulled(lConstants, lCaster));
+}
+
+TEST_CASE("Occlusion culling never rejects a visible box", "[gpu_cull]")
+{
+	const auto lViewPrj = MakeStreetViewPrj();
+	const auto lDepth = RasterizeCity(lViewPrj);
+	const auto lProps = MakeProps(4000, 17);
+	const auto lConstants = MakeCameraConstants(lViewPrj, uint32_t(lProps.size()), true);
+	std::vector<float> lHiZ;
+	GpuCullReference::BuildHiZ(lConstants, lDepth, lHiZ);
+
+	uint32_t lInFrustum = 0;
+	uint32_t lOccluded = 0;
+	uint32_t lHidden = 0;
+	for (size_t i = 0; i < lProps.size(); ++i)
+	{
+		const auto lInstance = MakeInstance(lProps[i], GPU_INSTANCE_CAMERA, uint32_t(i));
+		if (GpuCullReference::IsFrustumCulled(lConstants, lInstance))
+		{
+			continue;
+		}
+		lInFrustum++;
+		const bool lVisible = HasVisibleSample(lViewPrj, lProps[i], lDepth);
+		lHidden += lVisible ? 0 : 1;
+		if (GpuCullReference::IsOcclusionCulled(lConstants, lInstance, lHiZ))
+		{
+			REQUIRE(!lVisible);
+			lOccluded++;
+		}
+	}
+	//Looking down the avenue most of the city is behind the first row of buildings.
+	REQUIRE(lInFrustum > 0);
+	CHECK(lOccluded > lInFrustum / 2);
+	//Conservative,but it finds most of what is hidden.
+	CHECK(lOccluded * 4 >= lHidden * 3);
+
+	//A box crossing the near plane is left to the frustum test.
+	const auto lNear = MakeInstance(BoundingBox(XMFLOAT3(EYE.x, EYE.y, EYE.z), XMFLOAT3(1.0f, 1.0f, 1.0f)), GPU_INSTANCE_CAMERA, 0);
+	CHECK(!GpuCullReference::IsOcclusionCulled(lConstants, lNear, lHiZ));
+	//Nothing behind an empty depth buffer is hidden.
+	const std::vector<float> lCleared(size_t(DEPTH_WIDTH) * DEPTH_HEIGHT, 0.0f);
+	GpuCullReference::BuildHiZ(lConstants, lCleared, lHiZ);
+	for (size_t i = 0; i < lProps.size(); ++i)
+	{
+		REQUIRE(!GpuCullReference::IsOcclusionCulled(lConstants, MakeInstance(lProps[i], GPU_INSTANCE_CAMERA, uint32_t(i)), lHiZ));
+	}
+}
+
+TEST_CASE("Culling compacts the visible draws of a pass in instance order", "[gpu_cull]")
+{
+	const auto lViewPrj = MakeStreetViewPrj();
+	const auto lDepth = RasterizeCity(lViewPrj);
+	const auto lProps = MakeProps(3000, 29);
+	std::vector<GpuInstance> lInstances;
+	for (size_t i = 0; i < lProps.size(); ++i)
+	{
+		//Every third prop only casts shadows,every fifth uses 16 bit indices.
+		const uint32_t lFlags = (i % 3 == 0 ? GPU_INSTANCE_SHADOW_CASTER : GPU_INSTANCE_CAMERA | GPU_INSTANCE_SHADOW_CASTER) |
+			(i % 5 == 0 ? GPU_INSTANCE_16BIT_INDICES : 0);
+		lInstances.push_back(MakeInstance(lProps[i], lFlags, uint32_t(i)));
+	}
+	//Instances past the count are left over from a larger frame.
+	const auto lConstants = MakeCameraConstants(lViewPrj, uint32_t(lInstances.size() - 100), true);
+	std::vector<float> lHiZ;
+	GpuCullReference::BuildHiZ(lConstants, lDepth, lHiZ);
+
+	GpuCullReference lReference;
+	lReference.Cull(lConstants, lInstances, lHiZ);
+	const auto& lCounts = lReference.GetCounts();
+	const auto lDraws = lReference.GetDraws();
+	CHECK(lCounts.mDraws == lDraws.size());
+	CHECK(lCounts.mTested == lCounts.mDraws + lCounts.mFrustumCulled + lCounts.mOcclusionCulled);
+	CHECK(lCounts.mOcclusionCulled > 0);
+
+	uint32_t lTested = 0;
+	size_t lNext = 0;
+	for (uint32_t i = 0; i < lConstants.mInstanceCount; ++i)
+	{
+		if ((lInstances[i].mFlags & GPU_INSTANCE_CAMERA) == 0)
+		{
+			continue;
+		}
+		lTested++;
+		const bool lCulled = GpuCullReference::IsFrustumCulled(lConstants, lInstances[i]) ||
+			GpuCullReference::IsOcclusionCulled(lConstants, lInstances[i], lHiZ);
+		if (lCulled)
+		{
+			continue;
+		}
+		REQUIRE(lNext < lDraws.size());
+		const auto& lDraw = lDraws[lNext++];
+		CHECK(lDraw.mDraw.StartInstanceLocation == i);
+		CHECK(lDraw.mDraw.InstanceCount == 1);
+		CHECK(lDraw.mDraw.IndexCountPerInstance == lInstances[i].mIndexCount);
+		CHECK(lDraw.mDraw.StartIndexLocation == lInstances[i].mStartIndexLocation);
+		CHECK(lDraw.mDraw.BaseVertexLocation == lInstances[i].mBaseVertexLocation);
+		CHECK(lDraw.mMaterial == lInstances[i].mMaterial);
+		CHECK(lDraw.mIndexBuffer.Format == ((lInstances[i].mFlags & GPU_INSTANCE_16BIT_INDICES) ? DXGI_FORMAT_R16_UINT : DXGI_FORMAT_R32_UINT));
+	}
+	CHECK(lNext == lDraws.size());
+	CHECK(lTested == lCounts.mTested);
+}
+
+TEST_CASE("Comparing against the GPU ignores draw order but finds every difference", "[gpu_cull]")
+{
+	const auto lViewPrj = MakeStreetViewPrj();
+	const auto lProps = MakeProps(2000, 41);
+	std::vector<GpuInstance> lInstances;
+	for (size_t i = 0; i < lProps.size(); ++i)
+	{
+		lInstances.push_back(MakeInstance(lProps[i], GPU_INSTANCE_CAMERA, uint32_t(i)));
+	}
+	GpuCullReference lReference;
+	lReference.Cull(MakeCameraConstants(lViewPrj, uint32_t(lInstances.size()), false), lInstances, {});
+	const GpuCullCounts lCounts = lReference.GetCounts();
+	REQUIRE(lCounts.mDraws > 10);
+
+	//The compute shader appends with an atomic,its draws come back shuffled.
+	std::vector<IndirectDraw> lGpuDraws(lReference.GetDraws().begin(), lReference.GetDraws().end());
+	std::shuffle(lGpuDraws.begin(), lGpuDraws.end(), std::mt19937(5));
+	CHECK(lReference.Compare(lCounts, lGpuDraws) == 0);
+	CHECK(lReference.CountsMatch());
+
+	SECTION("A draw the GPU dropped")
+	{
+		lGpuDraws.pop_back();
+		GpuCullCounts lGpuCounts = lCounts;
+		lGpuCounts.mDraws--;
+		lGpuCounts.mFrustumCulled++;
+		CHECK(lReference.Compare(lGpuCounts, lGpuDraws) == 1);
+		CHECK(!lReference.CountsMatch());
+	}
+
+	SECTION("A draw only the GPU kept")
+	{
+		IndirectDraw lExtra = lGpuDraws.front();
+		lExtra.mDraw.StartInstanceLocation = uint32_t(lInstances.size());
+		lGpuDraws.push_back(lExtra);
+		CHECK(lReference.Compare(lCounts, lGpuDraws) == 1);
+		CHECK(lReference.CountsMatch());
+	}
+
+	SECTION("A draw with different arguments")
+	{
+		lGpuDraws[lGpuDraws.size() / 2].mDraw.IndexCountPerInstance++;
+		lGpuDraws[0].mMaterial++;
+		CHECK(lReference.Compare(lCounts, lGpuDraws) == 2);
+		CHECK(lReference.GetMismatchedDraws() == 2);
+	}
+}
+
+TEST_CASE("The instance table only marks the records that changed", "[gpu_cull]")
+{
+	std::vector<GpuInstance> lInstances;
+	for (uint32_t i = 0; i < 64; ++i)
+	{
+		lInstances.push_back(MakeInstance(BoundingBox(XMFLOAT3(float(i), 0.0f, 10.0f), XMFLOAT3(0.5f, 0.5f, 0.5f)), GPU_INSTANCE_CAMERA, i));
+	}
+	auto lRebuild = [&](GpuInstanceTable& InTable, size_t InCount)
+		{
+			InTable.Begin();
+			for (size_t i = 0; i < InCount; ++i)
+			{
+				InTable.Add(lInstances[i]);
+			}
+			InTable.End();
+		};
+
+	GpuInstanceTable lTable;
+	lRebuild(lTable, lInstances.size());
+	CHECK(lTable.GetDirtyBegin() == 0);
+	CHECK(lTable.GetDirtyEnd() == 64);
+	lTable.ClearDirty();
+
+	//A static scene uploads nothing.
+	lRebuild(lTable, lInstances.size());
+	CHECK(!lTable.IsDirty());
+
+	lInstances[10].mBoundsCenter.y = 1.0f;
+	lInstances[20].mMaterial++;
+	lRebuild(lTable, lInstances.size());
+	CHECK(lTable.GetDirtyBegin() == 10);
+	CHECK(lTable.GetDirtyEnd() == 21);
+	CHECK(std::memcmp(&lTable.GetInstances()[20], &lInstances[20], sizeof(GpuInstance)) == 0);
+	lTable.ClearDirty();
+
+	//Removing entities from the end shrinks the table without an upload.
+	lRebuild(lTable, 40);
+	CHECK(lTable.GetInstances().size() == 40);
+	CHECK(!lTable.IsDirty());
+
+	//Growing again uploads the records past the old end,whether they changed or not.
+	lInstances[50].mMaterial++;
+	lRebuild(lTable, 64);
+	CHECK(lTable.GetDirtyBegin() == 40);
+	CHECK(lTable.GetDirtyEnd() == 64);
+	lTable.ClearDirty();
+
+	lTable.MarkAllDirty();
+	CHECK(lTable.GetDirtyBegin() == 0);
+	CHECK(lTable.GetDirtyEnd() == 64);
+}
@@ -0,0 +1,76 @@
+#include "light_buffer.h"
+#include <catch2/catch.hpp>
+
+using namespace Renderer;
+
+namespace
+{
+	std::vector<std::pair<uint32_t, uint32_t>> Coalesce(std::vector<uint32_t> InDirty, uint32_t InLightCount)
+	{
+		std::vector<LightCopy> lCopies;
+		LightBuffer::CoalesceCopies(InDirty, InLightCount, lCopies);
+		std::vector<std::pair<uint32_t, uint32_t>> lResult;
+		for (const auto& copy : lCopies)
+		{
+			lResult.emplace_back(copy.mFirstSlot, copy.mCount);
+		}
+		return lResult;
+	}
+}
+
+TEST_CASE("Dirty light slots coalesce into one copy per run", "[light_buffer]")
+{
+	using Copies = std::vector<std::pair<uint32_t, uint32_t>>;
+	CHECK(Coalesce({}, 100).empty());
+	CHECK(Coalesce({ 7 }, 100) == Copies{ { 7, 1 } });
+	//Dirty order is the order lights were patched in.
+	CHECK(Coalesce({ 12, 3, 11, 4, 10, 50 }, 100) == Copies{ { 3, 2 }, { 10, 3 }, { 50, 1 } });
+	//Half the lights still go as deltas,one more is a single full copy.
+	std::vector<uint32_t> lEven;
+	for (uint32_t i = 0; i < 100; i += 2)
+	{
+		lEven.push_back(i);
+	}
+	CHECK(Coalesce(lEven, 100).size() == 50);
+	lEven.push_back(1);
+	CHECK(Coalesce(lEven, 100) == Copies{ { 0, 100 } });
+}
+
+TEST_CASE("Light bounds enclose the shape they are culled for", "[light_buffer]")
+{
+	ECS::LightComponent lLight;
+	lLight.pos = { 1.0f, 2.0f, 3.0f, 1.0f };
+	lLight.radius_attenu = { 10.0f, 1.0f, 0.0f, 0.0f };
+	lLight.direction = { 0.0f, 0.0f, 2.0f };
+
+	auto lPoint = LightBuffer::ToLightData(lLight);
+	CHECK(lPoint.bounds.w == 10.0f);
+	CHECK(lPoint.direction.z == Approx(1.0f));
+
+	lLight.type = ECS::LightType::CAPSULE;
+	lLight.length = 4.0f;
+	auto lCapsule = LightBuffer::ToLightData(lLight);
+	CHECK(lCapsule.shape.x == 2.0f);
+	CHECK(lCapsule.bounds.w == 12.0f);
+
+	//Narrow and wide cones,the sphere holds the apex and the whole cap at the range.
+	lLight.type = ECS::LightType::SPOT;
+	for (float outer : { 0.3f, 0.7f, 1.2f, 2.0f })
+	{
+		lLight.spotOuterAngle = outer;
+		lLight.spotInnerAngle = outer * 0.5f;
+		auto lSpot = LightBuffer::ToLightData(lLight);
+		CHECK(lSpot.shape.x == Approx(std::cos(outer)));
+		const DirectX::SimpleMath::Vector3 lCenter(lSpot.bounds.x, lSpot.bounds.y, lSpot.bounds.z);
+		const DirectX::SimpleMath::Vector3 lApex(lLight.pos.x, lLight.pos.y, lLight.pos.z);
+		CHECK((lApex - lCenter).Length() <= lSpot.bounds.w + 1e-4f);
+		for (int i = 0; i < 16; ++i)
+		{
+			const float lAngle = DirectX::XM_2PI * i / 16;
+			const float lCone = std::min(outer, DirectX::XM_PIDIV2);
+			const DirectX::SimpleMath::Vector3 lRim = lApex + 10.0f * DirectX::SimpleMath::Vector3(
+				std::sin(lCone) * std::cos(lAngle), std::sin(lCone) * std::sin(lAngle), std::cos(lCone));
+			CHECK((lRim - lCenter).Length() <= lSpot.bounds.w + 1e-4f);
+		}
+	}
+}
@@ -0,0 +1,114 @@
+#include "material_table.h"
+#include "synthetic_scene.h"
+#include <catch2/catch.hpp>
+
+using namespace Renderer;
+using namespace AssetLoader;
+
+namespace
+{
+	constexpr uint32_t DEFAULT_BASE_COLOR = 7;
+	constexpr uint32_t DEFAULT_NORMAL = 8;
+	//Descriptor of texture slot i,as if the textures were uploaded behind the defaults.
+	constexpr uint32_t FIRST_TEXTURE_DESCRIPTOR = 100;
+
+	//Resolves like the renderer:a live texture maps to its descriptor,a stale or invalid handle does not.
+	MaterialTable::ResolveTexture MakeResolve(const AssetPool<TextureData>& InPool)
+	{
+		return [&InPool](TextureHandle InTexture)
+			{
+				return InPool.IsAlive(InTexture) ? FIRST_TEXTURE_DESCRIPTOR + InTexture.mIndex : MaterialTable::INVALID_TEXTURE;
+			};
+	}
+}
+
+TEST_CASE("Material table falls back to the default textures", "[material_table]")
+{
+	AssetPool<TextureData> lPool;
+	const auto lAlbedo = lPool.Add("albedo", std::make_unique<TextureData>());
+	const auto lNormal = lPool.Add("normal", std::make_unique<TextureData>());
+	const auto lReleased = lPool.Add("released", std::make_unique<TextureData>());
+	lPool.Release(lReleased, Residency::CPU);
+	//The freed slot is reused,the old handle stays stale although its index is live again.
+	const auto lReused = lPool.Add("reused", std::make_unique<TextureData>());
+	REQUIRE(lReused.mIndex == lReleased.mIndex);
+
+	std::vector<ECS::MaterialDesc> lDescs(5);
+	lDescs[0] = { lAlbedo, lNormal };
+	lDescs[1] = { lAlbedo, {} };
+	lDescs[2] = { {}, lNormal };
+	lDescs[3] = { lReleased, lReleased };
+	lDescs[4] = { lReused, TextureHandle{ 1000, 0 } };
+
+	MaterialTable lTable;
+	lTable.SetDefaultTextures(DEFAULT_BASE_COLOR, DEFAULT_NORMAL);
+	lTable.Pack(lDescs, MakeResolve(lPool));
+	const auto lMaterials = lTable.GetMaterials();
+	REQUIRE(lMaterials.size() == lDescs.size());
+
+	CHECK(lMaterials[0].mBaseColorTexture == FIRST_TEXTURE_DESCRIPTOR + lAlbedo.mIndex);
+	CHECK(lMaterials[0].mNormalTexture == FIRST_TEXTURE_DESCRIPTOR + lNormal.mIndex);
+	CHECK(lMaterials[1].mBaseColorTexture == FIRST_TEXTURE_DESCRIPTOR + lAlbedo.mIndex);
+	CHECK(lMaterials[1].mNormalTexture == DEFAULT_NORMAL);
+	CHECK(lMaterials[2].mBaseColorTexture == DEFAULT_BASE_COLOR);
+	CHECK(lMaterials[2].mNormalTexture == FIRST_TEXTURE_DESCRIPTOR + lNormal.mIndex);
+	CHECK(lMaterials[3].mBaseColorTexture == DEFAULT_BASE_COLOR);
+	CHECK(lMaterials[3].mNormalTexture == DEFAULT_NORMAL);
+	CHECK(lMaterials[4].mBaseColorTexture == FIRST_TEXTURE_DESCRIPTOR + lReused.mIndex);
+	CHECK(lMaterials[4].mNormalTexture == DEFAULT_NORMAL);
+}
+
+TEST_CASE("Material table keeps material ids and carries the base color factor", "[material_table]")
+{
+	AssetPool<TextureData> lPool;
+	std::vector<TextureHandle> lTextures;
+	for (int i = 0; i < 4; ++i)
+	{
+		lTextures.push_back(lPool.Add("texture" + std::to_string(i), std::make_unique<TextureData>()));
+	}
+	std::vector<ECS::MaterialDesc> lDescs;
+	for (uint32_t i = 0; i < 64; ++i)
+	{
+		ECS::MaterialDesc lDesc;
+		lDesc.mBaseColor = lTextures[i % 4];
+		lDesc.mNormalMap = lTextures[(i + 1) % 4];
+		lDesc.mBaseColorFactor = { float(i) / 64.0f, 0.5f, 1.0f - float(i) / 64.0f, 1.0f };
+		lDescs.push_back(lDesc);
+	}
+
+	MaterialTable lTable;
+	lTable.SetDefaultTextures(DEFAULT_BASE_COLOR, DEFAULT_NORMAL);
+	lTable.Pack(lDescs, MakeResolve(lPool));
+	auto lCheck = [&](uint32_t InCount)
+		{
+			const auto lMaterials = lTable.GetMaterials();
+			REQUIRE(lMaterials.size() == InCount);
+			for (uint32_t i = 0; i < InCount; ++i)
+			{
+				//Entry i belongs to MaterialId i,draws index the table with it.
+				CHECK(lMaterials[i].mBaseColorTexture == FIRST_TEXTURE_DESCRIPTOR + lTextures[i % 4].mIndex);
+				CHECK(lMaterials[i].mNormalTexture == FIRST_TEXTURE_DESCRIPTOR + lTextures[(i + 1) % 4].mIndex);
+				CHECK(lMaterials[i].mBaseColorFactor.x == lDescs[i].mBaseColorFactor.x);
+				CHECK(lMaterials[i].mBaseColorFactor.y == lDescs[i].mBaseColorFactor.y);
+				CHECK(lMaterials[i].mBaseColorFactor.z == lDescs[i].mBaseColorFactor.z);
+				CHECK(lMaterials[i].mBaseColorFactor.w == lDescs[i].mBaseColorFactor.w);
+			}
+		};
+	lCheck(64);
+
+	//Repacking after the scene added materials leaves the existing entries where they were.
+	for (uint32_t i = 64; i < 80; ++i)
+	{
+		ECS::MaterialDesc lDesc;
+		lDesc.mBaseColor = lTextures[i % 4];
+		lDesc.mNormalMap = lTextures[(i + 1) % 4];
+		lDescs.push_back(lDesc);
+	}
+	lTable.Pack(lDescs, MakeResolve(lPool));
+	lCheck(80);
+
+	//Fewer materials shrink the table,nothing of the larger pack is left behind.
+	lDescs.resize(10);
+	lTable.Pack(lDescs, MakeResolve(lPool));
+	lCheck(10);
+}
@@ -0,0 +1,306 @@
+#include "meshlet_cull.h"
+#include "synthetic_scene.h"
+#include <catch2/catch.hpp>
+
+using namespace Renderer;
+using namespace DirectX;
+
+namespace
+{
+	constexpr float VIEW_HEIGHT = 1080.0f;
+	constexpr float ASPECT = 16.0f / 9.0f;
+	constexpr float NEAR_PLANE = 0.1f;
+
+	MeshletCullConstants MakeConstants(const SimpleMath::Vector3& InEye, const SimpleMath::Vector3& InTarget, uint32_t InFlags, float InMinPixels = 1.0f)
+	{
+		const auto lViewPrj = Synthetic::MakeViewPrj(InEye, InTarget, XM_PIDIV2, ASPECT, NEAR_PLANE);
+		return MeshletCullReference::MakeConstants(lViewPrj, Synthetic::MakePrj(XM_PIDIV2, ASPECT, NEAR_PLANE), InEye, VIEW_HEIGHT, InFlags, InMinPixels);
+	}
+
+	std::vector<MeshletCullBounds> MakeBounds(const std::vector<Synthetic::MeshletTriangles>& InMeshlets)
+	{
+		std::vector<MeshletCullBounds> lBounds;
+		for (const auto& meshlet : InMeshlets)
+		{
+			lBounds.push_back(MeshletCullReference::MakeBounds(Synthetic::MakeCullData(meshlet)));
+		}
+		return lBounds;
+	}
+
+	//Every triangle of the meshlet turns its back to InEye.
+	bool IsBackFacing(const Synthetic::MeshletTriangles& InMeshlet, const SimpleMath::Matrix& InModel, const SimpleMath::Vector3& InEye)
+	{
+		for (const auto& triangle : InMeshlet)
+		{
+			const std::array<SimpleMath::Vector3, 3> lWorld = {
+				SimpleMath::Vector3::Transform(triangle[0], InModel),
+				SimpleMath::Vector3::Transform(triangle[1], InModel),
+				SimpleMath::Vector3::Transform(triangle[2], InModel) };
+			if ((InEye - lWorld[0]).Dot(Synthetic::GetTriangleNormal(lWorld)) > -1e-4f)
+			{
+				return false;
+			}
+		}
+		return true;
+	}
+}
+
+TEST_CASE("Meshlet bounds move the cone apex behind the center along the quantized axis", "[meshlet_cull]")
+{
+	for (const auto& meshlet : Synthetic::MakeSphereMeshlets(8, 16, 2))
+	{
+		const CullData lData = Synthetic::MakeCullData(meshlet);
+		const MeshletCullBounds lBounds = MeshletCullReference::MakeBounds(lData);
+		CHECK(lBounds.mCenter.x == lData.BoundingSphere.Center.x);
+		CHECK(lBounds.mCenter.y == lData.BoundingSphere.Center.y);
+		CHECK(lBounds.mCenter.z == lData.BoundingSphere.Center.z);
+		CHECK(lBounds.mRadius == lData.BoundingSphere.Radius);
+		CHECK(lBounds.mCone == lData.NormalCone.v);
+
+		SimpleMath::Vector3 lAxis(float(lBounds.mCone & 0xff) * (2.0f / 255.0f) - 1.0f, float((lBounds.mCone >> 8) & 0xff) * (2.0f / 255.0f) - 1.0f,
+			float((lBounds.mCone >> 16) & 0xff) * (2.0f / 255.0f) - 1.0f);
+		lAxis.Normalize();
+		const SimpleMath::Vector3 lOffset = SimpleMath::Vector3(lBounds.mCenter) - SimpleMath::Vector3(lBounds.mConeApex);
+		CHECK(lOffset.x == Approx(lAxis.x * lData.ApexOffset).margin(1e-5f));
+		CHECK(lOffset.y == Approx(lAxis.y * lData.ApexOffset).margin(1e-5f));
+		CHECK(lOffset.z == Approx(lAxis.z * lData.ApexOffset).margin(1e-5f));
+	}
+}
+
+TEST_CASE("Only uniformly scaled instances are cone culled", "[meshlet_cull]")
+{
+	const ECS::StaticMeshComponentMeshOffset lOffsets = { 256, 1, 2, 3 };
+	const auto lRotation = SimpleMath::Matrix::CreateFromAxisAngle(SimpleMath::Vector3(1.0f, 2.0f, 3.0f) / std::sqrt(14.0f), 0.7f);
+	const auto lUniform = MeshletCullReference::MakeInstance(SimpleMath::Matrix::CreateScale(2.5f) * lRotation * SimpleMath::Matrix::CreateTranslation(4.0f, 5.0f, 6.0f), lOffsets);
+	CHECK(lUniform.mScale == Approx(2.5f));
+	CHECK((lUniform.mFlags & MESHLET_INSTANCE_CONE_CULL) != 0);
+	CHECK(lUniform.mOffsets.MeshletOffset == 256);
+	CHECK(lUniform.mModelMatrix[3].x == Approx(4.0f));
+
+	const auto lStretched = MeshletCullReference::MakeInstance(SimpleMath::Matrix::CreateScale(1.0f, 3.0f, 1.0f) * lRotation, lOffsets);
+	CHECK(lStretched.mScale == Approx(3.0f));
+	CHECK((lStretched.mFlags & MESHLET_INSTANCE_CONE_CULL) == 0);
+
+	//The bounds would allow it,the instance does not.
+	const auto lConstants = MakeConstants(SimpleMath::Vector3(0.0f, 0.0f, -10.0f), SimpleMath::Vector3(0.0f, 0.0f, 0.0f), MESHLET_CULL_CONE);
+	for (const auto& bounds : MakeBounds(Synthetic::MakeSphereMeshlets(16, 32, 2)))
+	{
+		REQUIRE(!MeshletCullReference::IsConeCulled(lConstants, lStretched, bounds));
+	}
+}
+
+TEST_CASE("Cone culling only rejects meshlets facing away from the eye", "[meshlet_cull]")
+{
+	const auto lMeshlets = Synthetic::MakeSphereMeshlets(32, 64, 4);
+	const auto lBounds = MakeBounds(lMeshlets);
+	std::mt19937 lRandom(19);
+	std::uniform_real_distribution<float> lUnit(-1.0f, 1.0f);
+	std::uniform_real_distribution<float> lScale(0.5f, 4.0f);
+	uint32_t lTested = 0;
+	uint32_t lBackFacing = 0;
+	uint32_t lCulled = 0;
+	for (int trial = 0; trial < 50; ++trial)
+	{
+		SimpleMath::Vector3 lRotationAxis(lUnit(lRandom), lUnit(lRandom), lUnit(lRandom) + 2.0f);
+		lRotationAxis.Normalize();
+		const float lScaleValue = lScale(lRandom);
+		const SimpleMath::Vector3 lPosition(lUnit(lRandom) * 10.0f, lUnit(lRandom) * 10.0f, 20.0f + lUnit(lRandom) * 10.0f);
+		const auto lModel = SimpleMath::Matrix::CreateScale(lScaleValue) * SimpleMath::Matrix::CreateFromAxisAngle(lRotationAxis, lUnit(lRandom) * XM_PI) *
+			SimpleMath::Matrix::CreateTranslation(lPosition);
+		const auto lInstance = MeshletCullReference::MakeInstance(lModel, {});
+		REQUIRE((lInstance.mFlags & MESHLET_INSTANCE_CONE_CULL) != 0);
+		//Close up,far away and off to the side.
+		const SimpleMath::Vector3 lEye(lUnit(lRandom) * 30.0f, lUnit(lRandom) * 30.0f, lUnit(lRandom) * 10.0f - (trial % 3) * 40.0f);
+		const auto lConstants = MakeConstants(lEye, lPosition, MESHLET_CULL_CONE);
+		for (size_t i = 0; i < lMeshlets.size(); ++i)
+		{
+			const bool lBack = IsBackFacing(lMeshlets[i], lModel, lEye);
+			lTested++;
+			lBackFacing += lBack ? 1 : 0;
+			if (MeshletCullReference::IsConeCulled(lConstants, lInstance, lBounds[i]))
+			{
+				REQUIRE(lBack);
+				lCulled++;
+			}
+		}
+	}
+	//Close to half of a sphere faces away,the cones find most of it.
+	CHECK(lBackFacing > lTested / 3);
+	CHECK(lCulled * 4 > lBackFacing * 3);
+}
+
+TEST_CASE("Frustum culling rejects a sphere only when it is outside one plane", "[meshlet_cull]")
+{
+	const SimpleMath::Vector3 lEye(0.0f, 2.0f, 0.0f);
+	const SimpleMath::Vector3 lTarget(3.0f, 1.0f, 10.0f);
+	const auto lViewPrj = Synthetic::MakeViewPrj(lEye, lTarget, XM_PIDIV2, ASPECT, NEAR_PLANE);
+	const auto lConstants = MakeConstants(lEye, lTarget, MESHLET_CULL_FRUSTUM);
+	auto lInside = [&](const SimpleMath::Vector3& InPoint)
+		{
+			const SimpleMath::Vector4 lClip = XMVector4Transform(SimpleMath::Vector4(InPoint.x, InPoint.y, InPoint.z, 1.0f), lViewPrj);
+			return lClip.x >= -lClip.w && lClip.x <= lClip.w && lClip.y >= -lClip.w && lClip.y <= lClip.w && lClip.z <= lClip.w;
+		};
+
+	std::mt19937 lRandom(7);
+	std::uniform_real_distribution<float> lCoordinate(-60.0f, 60.0f);
+	std::uniform_real_distribution<float> lRadius(0.05f, 5.0f);
+	std::uniform_real_distribution<float> lUnit(-1.0f, 1.0f);
+	uint32_t lCulled = 0;
+	for (int i = 0; i < 20000; ++i)
+	{
+		const SimpleMath::Vector3 lCenter(lCoordinate(lRandom), lCoordinate(lRandom), lCoordinate(lRandom));
+		const float lRadiusValue = lRadius(lRandom);
+		if (!MeshletCullReference::IsFrustumCulled(lConstants, lCenter, lRadiusValue))
+		{
+			continue;
+		}
+		lCulled++;
+		REQUIRE(!lInside(lCenter));
+		//No point of the sphere gets into the frustum.
+		for (int sample = 0; sample < 64; ++sample)
+		{
+			SimpleMath::Vector3 lDirection(lUnit(lRandom), lUnit(lRandom), lUnit(lRandom));
+			lDirection.Normalize();
+			REQUIRE(!lInside(lCenter + lDirection * (lRadiusValue * 0.999f)));
+		}
+	}
+	CHECK(lCulled > 10000);
+
+	//Between the eye and the reversed Z near plane.
+	const SimpleMath::Vector3 lForward = (lTarget - lEye) / (lTarget - lEye).Length();
+	CHECK(MeshletCullReference::IsFrustumCulled(lConstants, lEye + lForward * (NEAR_PLANE * 0.25f), NEAR_PLANE * 0.5f));
+	CHECK(!MeshletCullReference::IsFrustumCulled(lConstants, lEye + lForward * (NEAR_PLANE * 0.25f), NEAR_PLANE));
+	CHECK(!MeshletCullReference::IsFrustumCulled(lConstants, lTarget, 0.01f));
+}
+
+TEST_CASE("Size culling follows the projected diameter in pixels", "[meshlet_cull]")
+{
+	const SimpleMath::Vector3 lEye(0.0f, 0.0f, 0.0f);
+	const float lYScale = Synthetic::MakePrj(XM_PIDIV2, ASPECT, NEAR_PLANE).m[1][1];
+	for (float distance : { 1.0f, 10.0f, 250.0f })
+	{
+		for (float radius : { 0.001f, 0.05f, 1.0f })
+		{
+			const float lPixels = 2.0f * radius * lYScale * VIEW_HEIGHT * 0.5f / distance;
+			const SimpleMath::Vector3 lCenter(0.0f, 0.0f, distance);
+			CHECK(MeshletCullReference::IsSmallCulled(MakeConstants(lEye, lCenter, MESHLET_CULL_SMALL, lPixels * 1.01f), lCenter, radius));
+			CHECK(!MeshletCullReference::IsSmallCulled(MakeConstants(lEye, lCenter, MESHLET_CULL_SMALL, lPixels * 0.99f), lCenter, radius));
+		}
+	}
+	//Behind the eye nothing is small,the frustum test handles it.
+	const auto lConstants = MakeConstants(lEye, SimpleMath::Vector3(0.0f, 0.0f, 1.0f), MESHLET_CULL_SMALL, 1000.0f);
+	CHECK(!MeshletCullReference::IsSmallCulled(lConstants, SimpleMath::Vector3(0.0f, 0.0f, -5.0f), 0.001f));
+}
+
+TEST_CASE("A batch counts every meshlet under the first test that culls it", "[meshlet_cull]")
+{
+	//450 meshlets take four amplification groups,the last one partly filled.
+	const auto lLargeMeshlets = Synthetic::MakeSphereMeshlets(30, 60, 2);
+	const auto lSmallMeshlets = Synthetic::MakeSphereMeshlets(8, 16, 2);
+	REQUIRE(lLargeMeshlets.size() == 450);
+	const auto lLargeBounds = MakeBounds(lLargeMeshlets);
+	const auto lSmallBounds = MakeBounds(lSmallMeshlets);
+
+	MeshletCullReference lReference;
+	constexpr uint32_t LARGE_OFFSET = 0;
+	constexpr uint32_t SMALL_OFFSET = 512;
+	lReference.AddMesh(LARGE_OFFSET, lLargeBounds);
+	lReference.AddMesh(SMALL_OFFSET, lSmallBounds);
+
+	//A row of spheres down the view direction,starting behind the eye,the far ones a few pixels across.
+	std::vector<MeshletInstance> lInstances;
+	std::vector<SimpleMath::Matrix> lModels;
+	std::vector<MeshletGroup> lGroups;
+	for (uint32_t i = 0; i < 40; ++i)
+	{
+		const bool lLarge = i % 2 == 0;
+		ECS::StaticMeshComponentMeshOffset lOffsets = {};
+		lOffsets.MeshletOffset = lLarge ? LARGE_OFFSET : SMALL_OFFSET;
+		const auto lModel = SimpleMath::Matrix::CreateScale(lLarge ? 1.0f : 0.5f) * SimpleMath::Matrix::CreateTranslation(float(i % 5) * 3.0f - 6.0f, 0.0f, float(i) * 20.0f - 36.0f);
+		const uint32_t lInstance = uint32_t(lInstances.size());
+		lInstances.push_back(MeshletCullReference::MakeInstance(lModel, lOffsets));
+		lModels.push_back(lModel);
+		const uint32_t lMeshletCount = uint32_t(lLarge ? lLargeBounds.size() : lSmallBounds.size());
+		for (uint32_t first = 0; first < lMeshletCount; first += MAX_MESHLET_PER_THREAD_GROUP)
+		{
+			lGroups.push_back({ lInstance, lOffsets.MeshletOffset + first, std::min(lMeshletCount - first, (uint32_t)MAX_MESHLET_PER_THREAD_GROUP), 0 });
+		}
+	}
+	const uint32_t lTotal = 20 * uint32_t(lLargeBounds.size() + lSmallBounds.size());
+
+	const SimpleMath::Vector3 lEye(0.0f, 1.0f, 0.0f);
+	const SimpleMath::Vector3 lTarget(8.0f, 0.0f, 100.0f);
+	MeshletCullCounts lPrevious;
+	for (uint32_t flags = 0; flags <= (MESHLET_CULL_FRUSTUM | MESHLET_CULL_CONE | MESHLET_CULL_SMALL); ++flags)
+	{
+		const auto lConstants = MakeConstants(lEye, lTarget, flags, 4.0f);
+		lReference.Cull(lConstants, lInstances, lGroups);
+		const MeshletCullCounts lCounts = lReference.GetCounts();
+		CHECK(lCounts.mMeshlets == lTotal);
+		CHECK(lCounts.mVisible + lCounts.mFrustumCulled + lCounts.mSmallCulled + lCounts.mConeCulled == lTotal);
+		CHECK(((flags & MESHLET_CULL_FRUSTUM) != 0) == (lCounts.mFrustumCulled > 0));
+		CHECK(((flags & MESHLET_CULL_SMALL) != 0) == (lCounts.mSmallCulled > 0));
+		CHECK(((flags & MESHLET_CULL_CONE) != 0) == (lCounts.mConeCulled > 0));
+
+		//Recount meshlet by meshlet in the shader's order.
+		MeshletCullCounts lExpected;
+		for (size_t i = 0; i < lInstances.size(); ++i)
+		{
+			const auto& instance = lInstances[i];
+			const auto& lBounds = instance.mOffsets.MeshletOffset == LARGE_OFFSET ? lLargeBounds : lSmallBounds;
+			for (const auto& bounds : lBounds)
+			{
+				const auto lCenter = SimpleMath::Vector3::Transform(bounds.mCenter, lModels[i]);
+				const float lRadius = bounds.mRadius * instance.mScale;
+				lExpected.mMeshlets++;
+				if ((flags & MESHLET_CULL_FRUSTUM) && MeshletCullReference::IsFrustumCulled(lConstants, lCenter, lRadius))
+				{
+					lExpected.mFrustumCulled++;
+				}
+				else if ((flags & MESHLET_CULL_SMALL) && MeshletCullReference::IsSmallCulled(lConstants, lCenter, lRadius))
+				{
+					lExpected.mSmallCulled++;
+				}
+				else if ((flags & MESHLET_CULL_CONE) && MeshletCullReference::IsConeCulled(lConstants, instance, bounds))
+				{
+					lExpected.mConeCulled++;
+				}
+				else
+				{
+					lExpected.mVisible++;
+				}
+			}
+		}
+		CHECK(lCounts.mFrustumCulled == lExpected.mFrustumCulled);
+		CHECK(lCounts.mSmallCulled == lExpected.mSmallCulled);
+		CHECK(lCounts.mConeCulled == lExpected.mConeCulled);
+		CHECK(lCounts.mVisible == lExpected.mVisible);
+		if (flags == 0)
+		{
+			CHECK(lCounts.mVisible == lTotal);
+		}
+		lPrevious = lCounts;
+	}
+	//Every test on leaves less than half of the batch.
+	CHECK(lPrevious.mVisible * 2 < lTotal);
+
+	//A mesh that moved in the meshlet buffer is culled from its new place.
+	lReference.RemoveMesh(SMALL_OFFSET);
+	lReference.AddMesh(SMALL_OFFSET + 128, lSmallBounds);
+	for (auto& instance : lInstances)
+	{
+		if (instance.mOffsets.MeshletOffset == SMALL_OFFSET)
+		{
+			instance.mOffsets.MeshletOffset = SMALL_OFFSET + 128;
+		}
+	}
+	for (auto& group : lGroups)
+	{
+		if (group.mFirstMeshlet >= SMALL_OFFSET)
+		{
+			group.mFirstMeshlet += 128;
+		}
+	}
+	lReference.Cull(MakeConstants(lEye, lTarget, MESHLET_CULL_FRUSTUM | MESHLET_CULL_CONE | MESHLET_CULL_SMALL, 4.0f), lInstances, lGroups);
+	CHECK(lReference.GetCounts() == lPrevious);
+}
@@ -0,0 +1,216 @@
+#include "occlusion_culling.h"
+#include "synthetic_scene.h"
+#include <catch2/catch.hpp>
+
+using namespace Renderer;
+using namespace DirectX;
+
+namespace
+{
+	constexpr float FOV_Y = XM_PIDIV2;
+	constexpr float NEAR_PLANE = 0.1f;
+	const SimpleMath::Vector3 EYE(0.0f, 2.0f, 0.0f);
+
+	SimpleMath::Matrix MakeStreetViewPrj(const SimpleMath::Vector3& InEye = EYE)
+	{
+		const float lAspect = float(SoftwareOcclusionCuller::DEFAULT_WIDTH) / SoftwareOcclusionCuller::DEFAULT_HEIGHT;
+		return Synthetic::MakeViewPrj(InEye, InEye + SimpleMath::Vector3(0.0f, 0.0f, 1.0f), FOV_Y, lAspect, NEAR_PLANE);
+	}
+
+	void RasterizeBox(SoftwareOcclusionCuller& InCuller, const BoundingBox& InBox)
+	{
+		auto lMesh = Synthetic::MakeBoxMesh(InBox);
+		InCuller.RasterizeOccluder(lMesh.mPositions.data(), sizeof(XMFLOAT3), lMesh.mPositions.size(), lMesh.mIndices, SimpleMath::Matrix::Identity);
+	}
+
+	BoundingBox MakeBox(float InX, float InY, float InZ, float InExtent)
+	{
+		return BoundingBox(XMFLOAT3(InX, InY, InZ), XMFLOAT3(InExtent, InExtent, InExtent));
+	}
+
+	//Slab test of the segment InFrom -> InTo against the box,the end point itself does not count.
+	bool SegmentHitsBox(const XMFLOAT3& InFrom, const XMFLOAT3& InTo, const BoundingBox& InBox)
+	{
+		float lEnter = 0.0f;
+		float lExit = 0.999f;
+		for (int axis = 0; axis < 3; ++axis)
+		{
+			const float lOrigin = (&InFrom.x)[axis];
+			const float lDirection = (&InTo.x)[axis] - lOrigin;
+			const float lMin = (&InBox.Center.x)[axis] - (&InBox.Extents.x)[axis];
+			const float lMax = (&InBox.Center.x)[axis] + (&InBox.Extents.x)[axis];
+			if (std::abs(lDirection) < 1e-6f)
+			{
+				if (lOrigin < lMin || lOrigin > lMax)
+				{
+					return false;
+				}
+				continue;
+			}
+			float t0 = (lMin - lOrigin) / lDirection;
+			float t1 = (lMax - lOrigin) / lDirection;
+			lEnter = std::max(lEnter, std::min(t0, t1));
+			lExit = std::min(lExit, std::max(t0, t1));
+		}
+		return lEnter <= lExit;
+	}
+
+	//Ground truth by ray casting:some point of the box is on screen and the eye sees it past every building.
+	//Buildings are grown by a few depth buffer pixels,so a sub pixel gap never counts as visible.
+	bool IsClearlyVisible(const BoundingBox& InBox, const Synthetic::City& InCity, const SimpleMath::Matrix& InViewPrj)
+	{
+		constexpr int SAMPLES = 4;
+		const float lPixelAngle = FOV_Y / SoftwareOcclusionCuller::DEFAULT_HEIGHT;
+		for (int i = 0; i <= SAMPLES; ++i)
+		{
+			for (int j = 0; j <= SAMPLES; ++j)
+			{
+				for (int k = 0; k <= SAMPLES; ++k)
+				{
+					const XMFLOAT3 lPoint(
+						InBox.Center.x + InBox.Extents.x * (2.0f * i / SAMPLES - 1.0f),
+						InBox.Center.y + InBox.Extents.y * (2.0f * j / SAMPLES - 1.0f),
+						InBox.Center.z + InBox.Extents.z * (2.0f * k / SAMPLES - 1.0f));
+					const XMVECTOR lClip = XMVector3Transform(XMLoadFloat3(&lPoint), InViewPrj);
+					const float w = XMVectorGetW(lClip);
+					if (w <= NEAR_PLANE || std::abs(XMVectorGetX(lClip)) > 0.98f * w || std::abs(XMVectorGetY(lClip)) > 0.98f * w)
+					{
+						continue;
+					}
+					bool lBlocked = false;
+					for (const auto& building : InCity.mBuildings)
+					{
+						const float lDistance = XMVectorGetX(XMVector3Length(XMVectorSubtract(XMLoadFloat3(&building.Center), EYE)));
+						const float lMargin = 3.0f * lPixelAngle * lDistance;
+						BoundingBox lGrown = building;
+						lGrown.Extents = XMFLOAT3(building.Extents.x + lMargin, building.Extents.y + lMargin, building.Extents.z + lMargin);
+						if (SegmentHitsBox(EYE, lPoint, lGrown))
+						{
+							lBlocked = true;
+							break;
+						}
+					}
+					if (!lBlocked)
+					{
+						return true;
+					}
+				}
+			}
+		}
+		return false;
+	}
+}
+
+TEST_CASE("Without occluders everything in the frustum is visible", "[occlusion]")
+{
+	SoftwareOcclusionCuller lCuller;
+	lCuller.BeginFrame(MakeStreetViewPrj());
+	lCuller.BuildHierarchy();
+
+	CHECK(lCuller.IsVisible(MakeBox(0.0f, 2.0f, 10.0f, 1.0f)));
+	CHECK(lCuller.IsVisible(MakeBox(5.0f, 4.0f, 100.0f, 1.0f)));
+
+	auto lBehind = lCuller.ProjectBounds(MakeBox(0.0f, 2.0f, -10.0f, 1.0f));
+	CHECK(lBehind.mOutsideFrustum);
+	auto lAside = lCuller.ProjectBounds(MakeBox(-100.0f, 2.0f, 10.0f, 1.0f));
+	CHECK(lAside.mOutsideFrustum);
+	CHECK_FALSE(lCuller.IsVisible(lAside));
+
+	//Crossing the near plane falls back to the whole screen.
+	auto lAround = lCuller.ProjectBounds(MakeBox(0.0f, 2.0f, 0.0f, 1.0f));
+	CHECK(lAround.mCrossNearPlane);
+	CHECK(lAround.Area() == lCuller.GetWidth() * lCuller.GetHeight());
+	CHECK(lCuller.IsVisible(lAround));
+}
+
+TEST_CASE("A wall hides what is behind it and nothing else", "[occlusion]")
+{
+	SoftwareOcclusionCuller lCuller;
+	lCuller.BeginFrame(MakeStreetViewPrj());
+	const BoundingBox lWall(XMFLOAT3(0.0f, 5.0f, 21.0f), XMFLOAT3(30.0f, 5.0f, 1.0f));
+	RasterizeBox(lCuller, lWall);
+	lCuller.BuildHierarchy();
+
+	//Only the side facing the camera is front facing and on screen.
+	CHECK(lCuller.GetRasterizedTriangles() == 2);
+	//Reversed Z,the wall face at z = 20 has depth near / 20.
+	const auto lDepth = lCuller.GetDepth();
+	const float lCenterDepth = lDepth[size_t(lCuller.GetHeight() / 2 + 4) * lCuller.GetWidth() + lCuller.GetWidth() / 2];
+	CHECK(lCenterDepth == Approx(NEAR_PLANE / 20.0f));
+	CHECK(lDepth[0] == 0.0f);
+
+	CHECK_FALSE(lCuller.IsVisible(MakeBox(0.0f, 5.0f, 40.0f, 1.0f)));
+	CHECK_FALSE(lCuller.IsVisible(MakeBox(-8.0f, 1.0f, 60.0f, 2.0f)));
+	//In front of the wall,above it,and poking out of it.
+	CHECK(lCuller.IsVisible(MakeBox(0.0f, 2.0f, 10.0f, 1.0f)));
+	CHECK(lCuller.IsVisible(MakeBox(0.0f, 20.0f, 40.0f, 1.0f)));
+	CHECK(lCuller.IsVisible(MakeBox(0.0f, 5.0f, 21.0f, 3.0f)));
+}
+
+TEST_CASE("Back facing and near clipped occluder triangles are dropped", "[occlusion]")
+{
+	SoftwareOcclusionCuller lCuller;
+	lCuller.BeginFrame(MakeStreetViewPrj());
+	//The camera facing side of a wall with its winding flipped.
+	const std::vector<XMFLOAT3> lQuad = { { -30.0f, 0.0f, 20.0f }, { 30.0f, 0.0f, 20.0f }, { 30.0f, 10.0f, 20.0f }, { -30.0f, 10.0f, 20.0f } };
+	const std::vector<uint32_t> lFlipped = { 0, 1, 2, 0, 2, 3 };
+	lCuller.RasterizeOccluder(lQuad.data(), sizeof(XMFLOAT3), lQuad.size(), lFlipped, SimpleMath::Matrix::Identity);
+	//Crosses the near plane.
+	RasterizeBox(lCuller, BoundingBox(XMFLOAT3(0.0f, 2.0f, 0.0f), XMFLOAT3(10.0f, 10.0f, 5.0f)));
+	lCuller.BuildHierarchy();
+
+	CHECK(lCuller.GetRasterizedTriangles() == 0);
+	CHECK(std::all_of(lCuller.GetDepth().begin(), lCuller.GetDepth().end(), [](float InDepth) { return InDepth == 0.0f; }));
+	CHECK(lCuller.IsVisible(MakeBox(0.0f, 5.0f, 40.0f, 1.0f)));
+}
+
+TEST_CASE("Synthetic city culling is conservative against ray cast visibility", "[occlusion]")
+{
+	const auto lCity = Synthetic::MakeCity(8, 6, 16.0f, 8.0f, 7);
+	const auto lViewPrj = MakeStreetViewPrj();
+	SoftwareOcclusionCuller lCuller;
+	lCuller.BeginFrame(lViewPrj);
+	for (const auto& building : lCity.mBuildings)
+	{
+		RasterizeBox(lCuller, building);
+	}
+	lCuller.BuildHierarchy();
+
+	//Props on the ground between and behind the buildings.
+	std::mt19937 lRandom(11);
+	std::uniform_real_distribution<float> lX(-80.0f, 80.0f);
+	std::uniform_real_distribution<float> lZ(4.0f, 150.0f);
+	std::uniform_real_distribution<float> lExtent(0.5f, 2.0f);
+	uint32_t lTested = 0;
+	uint32_t lHidden = 0;
+	uint32_t lCulled = 0;
+	while (lTested < 500)
+	{
+		const float lExtentValue = lExtent(lRandom);
+		const BoundingBox lProp = MakeBox(lX(lRandom), lExtentValue, lZ(lRandom), lExtentValue);
+		if (std::any_of(lCity.mBuildings.begin(), lCity.mBuildings.end(), [&lProp](const BoundingBox& InBuilding) { return InBuilding.Intersects(lProp); }))
+		{
+			continue;
+		}
+		auto lRect = lCuller.ProjectBounds(lProp);
+		if (lRect.mOutsideFrustum)
+		{
+			continue;
+		}
+		lTested++;
+		const bool lVisible = lCuller.IsVisible(lRect);
+		if (IsClearlyVisible(lProp, lCity, lViewPrj))
+		{
+			INFO("prop at " << lProp.Center.x << " " << lProp.Center.y << " " << lProp.Center.z);
+			CHECK(lVisible);
+		}
+		else
+		{
+			lHidden++;
+			lCulled += lVisible ? 0 : 1;
+		}
+	}
+	//Most props behind the buildings are hidden,a working culler removes the bulk of them.
+	REQUIRE(lHidden > 100);
+	CHECK(lCulled > lHidden * 3 / 4);
+}
@@ -0,0 +1,4 @@
+#pragma once
+//The tests exercise renderer and engine sources directly,so they are built against the renderer environment.
+#include "../renderer/pch.h"
+#include <random>
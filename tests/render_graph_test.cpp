@@ -0,0 +1,301 @@
+#include "render_graph.h"
+#include <catch2/catch.hpp>
+
+using namespace Renderer;
+
+namespace
+{
+	constexpr uint64_t PLACEMENT_ALIGNMENT = 64 * 1024;
+
+	//Sizes textures at 4 bytes per pixel and sample and logs what Execute hands it.
+	class MockBackend final : public RenderGraphBackend
+	{
+	public:
+		RGAllocationInfo GetAllocationInfo(const RGTextureDesc& InDesc) override
+		{
+			return { uint64_t(InDesc.mWidth) * InDesc.mHeight * InDesc.mSampleCount * 4, PLACEMENT_ALIGNMENT };
+		}
+
+		void Realize(const RenderGraph& InGraph) override
+		{
+			mLog.push_back("realize");
+		}
+
+		void Barriers(std::span<const RGBarrier> InBarriers) override
+		{
+			mLog.push_back("barriers " + std::to_string(InBarriers.size()));
+		}
+
+		std::vector<std::string> mLog;
+	};
+
+	using Transition = std::tuple<uint32_t, RGAccess, RGAccess>;
+
+	std::vector<Transition> Transitions(std::span<const RGBarrier> InBarriers)
+	{
+		std::vector<Transition> lTransitions;
+		for (const auto& barrier : InBarriers)
+		{
+			if (barrier.mType == RGBarrier::Type::TRANSITION)
+			{
+				lTransitions.emplace_back(barrier.mTexture.mIndex, barrier.mBefore, barrier.mAfter);
+			}
+		}
+		return lTransitions;
+	}
+
+	bool Overlaps(const RGPlacement& InA, const RGPlacement& InB)
+	{
+		return InA.mOffset < InB.mOffset + InB.mSize && InB.mOffset < InA.mOffset + InA.mSize;
+	}
+
+	//A deferred frame with an SSAO chain,a debug view nothing reads and a readback of the back buffer.
+	struct DeferredFrame
+	{
+		RGTextureHandle mBackBuffer;
+		RGTextureHandle mGBuffer;
+		RGTextureHandle mDepth;
+		RGTextureHandle mAO;
+		RGTextureHandle mDebug;
+		std::vector<std::string> mExecuted;
+
+		void Build(RenderGraph& OutGraph)
+		{
+			const RGTextureDesc lDesc = { 1280, 720, 1, 1 };
+			mBackBuffer = OutGraph.Import("BackBuffer", lDesc, RGAccess::PRESENT, RGAccess::PRESENT);
+			mGBuffer = OutGraph.Create("GBuffer", lDesc);
+			mDepth = OutGraph.Create("Depth", lDesc);
+			mAO = OutGraph.Create("AO", { 640, 360, 1, 1 });
+			mDebug = OutGraph.Create("Debug", lDesc);
+			auto lLog = [this](std::string InName) { return [this, InName]() { mExecuted.push_back(InName); }; };
+			OutGraph.AddPass("GBuffer", [this](RenderGraph::PassBuilder& InPass)
+				{
+					InPass.Write(mGBuffer, RGAccess::RENDER_TARGET);
+					InPass.Write(mDepth, RGAccess::DEPTH_WRITE);
+				}, lLog("GBuffer"));
+			OutGraph.AddPass("DepthDebug", [this](RenderGraph::PassBuilder& InPass)
+				{
+					InPass.Read(mDepth, RGAccess::SHADER_READ);
+					InPass.Write(mDebug, RGAccess::RENDER_TARGET);
+				}, lLog("DepthDebug"));
+			OutGraph.AddPass("SSAO", [this](RenderGraph::PassBuilder& InPass)
+				{
+					InPass.Read(mDepth, RGAccess::SHADER_READ);
+					InPass.Write(mAO, RGAccess::UNORDERED_ACCESS);
+				}, lLog("SSAO"));
+			//Blurs in place,a write the lighting read keeps alive together with the SSAO pass.
+			OutGraph.AddPass("SSAOBlur", [this](RenderGraph::PassBuilder& InPass)
+				{
+					InPass.Write(mAO, RGAccess::UNORDERED_ACCESS);
+				}, lLog("SSAOBlur"));
+			OutGraph.AddPass("Lighting", [this](RenderGraph::PassBuilder& InPass)
+				{
+					InPass.Read(mGBuffer, RGAccess::SHADER_READ);
+					InPass.Read(mAO, RGAccess::SHADER_READ);
+					InPass.Read(mDepth, RGAccess::DEPTH_READ);
+					InPass.Write(mBackBuffer, RGAccess::RENDER_TARGET);
+				}, lLog("Lighting"));
+			OutGraph.AddPass("Readback", [this](RenderGraph::PassBuilder& InPass)
+				{
+					InPass.Read(mBackBuffer, RGAccess::COPY_SOURCE);
+					InPass.SetSideEffects();
+				}, lLog("Readback"));
+			//Reads the output but its own result goes nowhere.
+			OutGraph.AddPass("Unused", [this](RenderGraph::PassBuilder& InPass)
+				{
+					InPass.Read(mBackBuffer, RGAccess::SHADER_READ);
+					InPass.Write(mDebug, RGAccess::UNORDERED_ACCESS);
+				}, lLog("Unused"));
+		}
+	};
+}
+
+TEST_CASE("Passes nothing reads are culled,read modify write chains and imports are kept", "[render_graph]")
+{
+	MockBackend lBackend;
+	RenderGraph lGraph;
+	DeferredFrame lFrame;
+	lFrame.Build(lGraph);
+	lGraph.Compile(lBackend);
+
+	std::vector<std::string> lKept;
+	for (uint32_t p = 0; p < lGraph.GetPassCount(); ++p)
+	{
+		if (!lGraph.IsCulled(p))
+		{
+			lKept.push_back(lGraph.GetPassName(p));
+		}
+	}
+	CHECK(lKept == std::vector<std::string>{ "GBuffer", "SSAO", "SSAOBlur", "Lighting", "Readback" });
+	CHECK(lGraph.GetStats().mCulledPasses == 2);
+	CHECK_FALSE(lGraph.IsAllocated(lFrame.mDebug));
+	CHECK(lGraph.IsAllocated(lFrame.mAO));
+	CHECK_FALSE(lGraph.IsAllocated(lFrame.mBackBuffer));
+	CHECK(lGraph.GetStats().mTransients == 3);
+
+	lGraph.Execute(lBackend);
+	CHECK(lFrame.mExecuted == lKept);
+
+	//A pass writing an import survives even when nothing in the graph reads it.
+	lGraph.Reset();
+	auto lTarget = lGraph.Import("Target", { 64, 64, 1, 1 }, RGAccess::RENDER_TARGET, RGAccess::SHADER_READ);
+	auto lScratch = lGraph.Create("Scratch", { 64, 64, 1, 1 });
+	lGraph.AddPass("Clear", [&](RenderGraph::PassBuilder& InPass) { InPass.Write(lTarget, RGAccess::RENDER_TARGET); }, []() {});
+	lGraph.AddPass("Scratch", [&](RenderGraph::PassBuilder& InPass) { InPass.Write(lScratch, RGAccess::RENDER_TARGET); }, []() {});
+	lGraph.Compile(lBackend);
+	CHECK_FALSE(lGraph.IsCulled(0));
+	CHECK(lGraph.IsCulled(1));
+	CHECK(lGraph.GetHeapSize() == 0);
+}
+
+TEST_CASE("Every state change gets a transition and imports end in their final state", "[render_graph]")
+{
+	MockBackend lBackend;
+	RenderGraph lGraph;
+	DeferredFrame lFrame;
+	lFrame.Build(lGraph);
+	lGraph.Compile(lBackend);
+	const uint32_t lBack = lFrame.mBackBuffer.mIndex, lGBuffer = lFrame.mGBuffer.mIndex, lDepth = lFrame.mDepth.mIndex, lAO = lFrame.mAO.mIndex;
+
+	CHECK(Transitions(lGraph.GetPassBarriers(0)) == std::vector<Transition>{
+		{ lGBuffer, RGAccess::NONE, RGAccess::RENDER_TARGET }, { lDepth, RGAccess::NONE, RGAccess::DEPTH_WRITE } });
+	CHECK(lGraph.GetPassBarriers(1).empty());
+	CHECK(Transitions(lGraph.GetPassBarriers(2)) == std::vector<Transition>{
+		{ lDepth, RGAccess::DEPTH_WRITE, RGAccess::SHADER_READ }, { lAO, RGAccess::NONE, RGAccess::UNORDERED_ACCESS } });
+	//Back to back UAV writes are ordered.
+	CHECK(Transitions(lGraph.GetPassBarriers(3)) == std::vector<Transition>{ { lAO, RGAccess::UNORDERED_ACCESS, RGAccess::UNORDERED_ACCESS } });
+	CHECK(Transitions(lGraph.GetPassBarriers(4)) == std::vector<Transition>{
+		{ lGBuffer, RGAccess::RENDER_TARGET, RGAccess::SHADER_READ },
+		{ lAO, RGAccess::UNORDERED_ACCESS, RGAccess::SHADER_READ },
+		{ lDepth, RGAccess::SHADER_READ, RGAccess::DEPTH_READ },
+		{ lBack, RGAccess::PRESENT, RGAccess::RENDER_TARGET } });
+	CHECK(Transitions(lGraph.GetPassBarriers(5)) == std::vector<Transition>{ { lBack, RGAccess::RENDER_TARGET, RGAccess::COPY_SOURCE } });
+	CHECK(lGraph.GetPassBarriers(6).empty());
+	CHECK(Transitions(lGraph.GetFinalBarriers()) == std::vector<Transition>{ { lBack, RGAccess::COPY_SOURCE, RGAccess::PRESENT } });
+	CHECK(lGraph.GetStats().mTransitions == 11);
+
+	//Realize first,then each pass's batch,the final batch last.Passes without barriers record no batch.
+	lGraph.Execute(lBackend);
+	CHECK(lBackend.mLog == std::vector<std::string>{ "realize", "barriers 2", "barriers 2", "barriers 1",
+		"barriers " + std::to_string(lGraph.GetPassBarriers(4).size()), "barriers 1", "barriers 1" });
+
+	//Imports already in their final state,or never touched with the same initial and final state,need nothing.
+	lGraph.Reset();
+	auto lShadow = lGraph.Import("Shadow", { 64, 64, 1, 1 }, RGAccess::SHADER_READ, RGAccess::SHADER_READ);
+	auto lIdle = lGraph.Import("Idle", { 64, 64, 1, 1 }, RGAccess::COPY_DEST, RGAccess::COPY_DEST);
+	auto lMoved = lGraph.Import("Moved", { 64, 64, 1, 1 }, RGAccess::COPY_DEST, RGAccess::SHADER_READ);
+	lGraph.AddPass("Shadow", [&](RenderGraph::PassBuilder& InPass) { InPass.Write(lShadow, RGAccess::DEPTH_WRITE); }, []() {});
+	lGraph.AddPass("Sample", [&](RenderGraph::PassBuilder& InPass)
+		{
+			InPass.Read(lShadow, RGAccess::SHADER_READ);
+			InPass.SetSideEffects();
+		}, []() {});
+	lGraph.Compile(lBackend);
+	CHECK(Transitions(lGraph.GetFinalBarriers()) == std::vector<Transition>{ { lMoved.mIndex, RGAccess::COPY_DEST, RGAccess::SHADER_READ } });
+	CHECK(lIdle.IsValid());
+}
+
+TEST_CASE("Transients alive at the same time never share memory and aliasing barriers mark shared memory", "[render_graph]")
+{
+	MockBackend lBackend;
+	RenderGraph lGraph;
+	std::mt19937 lRandom(41);
+	uint32_t lAliasedTextures = 0;
+	for (int graph = 0; graph < 200; ++graph)
+	{
+		lGraph.Reset();
+		const uint32_t lTextureCount = 2 + lRandom() % 14;
+		const uint32_t lPassCount = 2 + lRandom() % 20;
+		auto lOutput = lGraph.Import("Output", { 256, 256, 1, 1 }, RGAccess::PRESENT, RGAccess::PRESENT);
+		std::vector<RGTextureHandle> lTextures;
+		for (uint32_t t = 0; t < lTextureCount; ++t)
+		{
+			lTextures.push_back(lGraph.Create("T" + std::to_string(t), { 64u << (lRandom() % 4), 64u << (lRandom() % 4), 1, 1u + lRandom() % 2 }));
+		}
+		//Pass p touches up to four distinct textures,the last one also writes the output or has side effects.
+		std::vector<std::vector<std::pair<uint32_t, bool>>> lAccesses(lPassCount);
+		for (uint32_t p = 0; p < lPassCount; ++p)
+		{
+			std::vector<uint32_t> lPicked(lTextureCount);
+			std::iota(lPicked.begin(), lPicked.end(), 0u);
+			std::shuffle(lPicked.begin(), lPicked.end(), lRandom);
+			lPicked.resize(std::min<uint32_t>(lTextureCount, 1 + lRandom() % 4));
+			for (uint32_t t : lPicked)
+			{
+				lAccesses[p].emplace_back(t, lRandom() % 2 == 0);
+			}
+			const bool lOutputWrite = p + 1 == lPassCount || lRandom() % 6 == 0;
+			lGraph.AddPass("P" + std::to_string(p), [&, p, lOutputWrite](RenderGraph::PassBuilder& InPass)
+				{
+					for (auto [t, write] : lAccesses[p])
+					{
+						write ? InPass.Write(lTextures[t], RGAccess::UNORDERED_ACCESS) : InPass.Read(lTextures[t], RGAccess::SHADER_READ);
+					}
+					if (lOutputWrite)
+					{
+						InPass.Write(lOutput, RGAccess::RENDER_TARGET);
+					}
+				}, []() {});
+		}
+		lGraph.Compile(lBackend);
+
+		//Lifetimes over the surviving passes,recomputed here.
+		std::vector<uint32_t> lFirst(lTextureCount, UINT32_MAX), lLast(lTextureCount, 0);
+		for (uint32_t p = 0; p < lPassCount; ++p)
+		{
+			if (lGraph.IsCulled(p))
+			{
+				continue;
+			}
+			for (auto [t, write] : lAccesses[p])
+			{
+				lFirst[t] = std::min(lFirst[t], p);
+				lLast[t] = std::max(lLast[t], p);
+			}
+		}
+
+		uint64_t lUnaliased = 0;
+		for (uint32_t a = 0; a < lTextureCount; ++a)
+		{
+			REQUIRE(lGraph.IsAllocated(lTextures[a]) == (lFirst[a] != UINT32_MAX));
+			if (lFirst[a] == UINT32_MAX)
+			{
+				continue;
+			}
+			const auto& lPlacementA = lGraph.GetPlacement(lTextures[a]);
+			REQUIRE(lPlacementA.mOffset % PLACEMENT_ALIGNMENT == 0);
+			REQUIRE(lPlacementA.mSize == lBackend.GetAllocationInfo(lGraph.GetTextureDesc(lTextures[a])).mSize);
+			REQUIRE(lPlacementA.mOffset + lPlacementA.mSize <= lGraph.GetHeapSize());
+			lUnaliased += (lPlacementA.mSize + PLACEMENT_ALIGNMENT - 1) / PLACEMENT_ALIGNMENT * PLACEMENT_ALIGNMENT;
+			bool lShared = false;
+			for (uint32_t b = 0; b < lTextureCount; ++b)
+			{
+				if (a == b || lFirst[b] == UINT32_MAX || !Overlaps(lPlacementA, lGraph.GetPlacement(lTextures[b])))
+				{
+					continue;
+				}
+				lShared = true;
+				REQUIRE((lLast[a] < lFirst[b] || lLast[b] < lFirst[a]));
+			}
+
+			//Exactly one aliasing barrier,before its first pass,when the memory is shared and none otherwise.
+			uint32_t lAliasingBarriers = 0;
+			for (uint32_t p = 0; p < lPassCount; ++p)
+			{
+				for (const auto& barrier : lGraph.GetPassBarriers(p))
+				{
+					if (barrier.mType == RGBarrier::Type::ALIASING && barrier.mTexture == lTextures[a])
+					{
+						REQUIRE(p == lFirst[a]);
+						lAliasingBarriers++;
+					}
+				}
+			}
+			REQUIRE(lAliasingBarriers == uint32_t(lShared));
+			lAliasedTextures += lShared;
+		}
+		REQUIRE(lGraph.GetStats().mUnaliasedBytes == lUnaliased);
+		REQUIRE(lGraph.GetHeapSize() <= lUnaliased);
+	}
+	CHECK(lAliasedTextures > 100);
+}
@@ -0,0 +1,211 @@
+#include "shadow_culling.h"
+#include "synthetic_scene.h"
+#include <catch2/catch.hpp>
+
+using namespace Renderer;
+using namespace DirectX;
+
+namespace
+{
+	//Spot light on the origin looking down +z,reversed Z like the shadow camera.
+	const SimpleMath::Vector3 LIGHT(0.0f, 0.0f, 0.0f);
+	//The main camera stands in the light's cone and looks further down +z.
+	const SimpleMath::Vector3 EYE(0.0f, 0.0f, 15.0f);
+
+	SimpleMath::Matrix MakeLightViewPrj()
+	{
+		return Synthetic::MakeViewPrj(LIGHT, LIGHT + SimpleMath::Vector3(0.0f, 0.0f, 1.0f), XM_PIDIV2, 1.0f, 0.1f);
+	}
+
+	SimpleMath::Matrix MakeCameraViewPrj()
+	{
+		return Synthetic::MakeViewPrj(EYE, EYE + SimpleMath::Vector3(0.0f, 0.0f, 1.0f), XM_PIDIV2, 16.0f / 9.0f, 0.1f);
+	}
+
+	BoundingBox MakeBox(float InX, float InY, float InZ, float InExtent = 1.0f)
+	{
+		return BoundingBox(XMFLOAT3(InX, InY, InZ), XMFLOAT3(InExtent, InExtent, InExtent));
+	}
+
+	//What the camera culling hands over as receivers:boxes not entirely outside one plane of the view.
+	bool IsInView(const SimpleMath::Matrix& InViewPrj, const BoundingBox& InBox)
+	{
+		XMFLOAT3 lCorners[BoundingBox::CORNER_COUNT];
+		InBox.GetCorners(lCorners);
+		uint32_t lAllOutside = 0x1f;
+		for (const auto& corner : lCorners)
+		{
+			const SimpleMath::Vector4 lClip = XMVector4Transform(SimpleMath::Vector4(corner.x, corner.y, corner.z, 1.0f), InViewPrj);
+			uint32_t lOutside = 0;
+			lOutside |= lClip.x < -lClip.w ? 0x1 : 0;
+			lOutside |= lClip.x > lClip.w ? 0x2 : 0;
+			lOutside |= lClip.y < -lClip.w ? 0x4 : 0;
+			lOutside |= lClip.y > lClip.w ? 0x8 : 0;
+			lOutside |= lClip.z > lClip.w ? 0x10 : 0;
+			lAllOutside &= lOutside;
+		}
+		return lAllOutside == 0;
+	}
+
+	//Slab test of the segment InFrom -> InTo against the box.
+	bool SegmentHitsBox(const SimpleMath::Vector3& InFrom, const SimpleMath::Vector3& InTo, const BoundingBox& InBox)
+	{
+		float lEnter = 0.0f;
+		float lExit = 1.0f;
+		for (int axis = 0; axis < 3; ++axis)
+		{
+			const float lOrigin = (&InFrom.x)[axis];
+			const float lDirection = (&InTo.x)[axis] - lOrigin;
+			const float lMin = (&InBox.Center.x)[axis] - (&InBox.Extents.x)[axis];
+			const float lMax = (&InBox.Center.x)[axis] + (&InBox.Extents.x)[axis];
+			if (std::abs(lDirection) < 1e-6f)
+			{
+				if (lOrigin < lMin || lOrigin > lMax)
+				{
+					return false;
+				}
+				continue;
+			}
+			const float t0 = (lMin - lOrigin) / lDirection;
+			const float t1 = (lMax - lOrigin) / lDirection;
+			lEnter = std::max(lEnter, std::min(t0, t1));
+			lExit = std::min(lExit, std::max(t0, t1));
+		}
+		return lEnter <= lExit;
+	}
+}
+
+TEST_CASE("Shadow casters outside the receiver volume are rejected", "[shadow_culling]")
+{
+	ShadowCasterCuller lCuller;
+	lCuller.BeginFrame(MakeLightViewPrj());
+	CHECK(!lCuller.HasReceivers());
+	//Nothing receives a shadow,nothing has to be drawn.
+	CHECK(!lCuller.IsCasterRelevant(MakeBox(0.0f, 0.0f, 20.0f)));
+
+	const BoundingBox lReceiver = MakeBox(0.0f, 0.0f, 20.0f);
+	REQUIRE(IsInView(MakeCameraViewPrj(), lReceiver));
+	lCuller.AddReceiver(lReceiver);
+	//Outside the light frustum,the shadow map does not cover it.
+	lCuller.AddReceiver(MakeBox(80.0f, 0.0f, 20.0f));
+	REQUIRE(lCuller.HasReceivers());
+
+	SECTION("Outside a side plane of the light")
+	{
+		CHECK(!lCuller.IsCasterRelevant(MakeBox(40.0f, 0.0f, 20.0f)));
+		CHECK(!lCuller.IsCasterRelevant(MakeBox(0.0f, -40.0f, 20.0f)));
+	}
+
+	SECTION("Behind the light")
+	{
+		CHECK(!lCuller.IsCasterRelevant(MakeBox(0.0f, 0.0f, -20.0f)));
+		CHECK(!lCuller.IsCasterRelevant(MakeBox(5.0f, 3.0f, -2.0f, 0.5f)));
+	}
+
+	SECTION("Inside the light frustum but outside the receiver rect")
+	{
+		CHECK(!lCuller.IsCasterRelevant(MakeBox(10.0f, 0.0f, 20.0f)));
+		CHECK(!lCuller.IsCasterRelevant(MakeBox(0.0f, -12.0f, 25.0f)));
+	}
+
+	SECTION("Farther from the light than every receiver")
+	{
+		CHECK(!lCuller.IsCasterRelevant(MakeBox(0.0f, 0.0f, 40.0f)));
+		//Touching the receiver's far side still counts.
+		CHECK(lCuller.IsCasterRelevant(MakeBox(0.0f, 0.0f, 22.0f)));
+	}
+
+	SECTION("Between the light and a receiver,even outside the view")
+	{
+		const BoundingBox lCaster = MakeBox(0.0f, 0.0f, 10.0f);
+		REQUIRE(!IsInView(MakeCameraViewPrj(), lCaster));
+		CHECK(lCuller.IsCasterRelevant(lCaster));
+		//Crossing the light's plane,the near plane of the light is ignored.
+		CHECK(lCuller.IsCasterRelevant(MakeBox(0.0f, 0.0f, 0.0f, 0.5f)));
+	}
+
+	SECTION("A receiver around the light widens the rect to the whole map")
+	{
+		CHECK(!lCuller.IsCasterRelevant(MakeBox(10.0f, 0.0f, 20.0f)));
+		lCuller.AddReceiver(MakeBox(0.0f, 0.0f, 0.0f, 0.5f));
+		CHECK(lCuller.IsCasterRelevant(MakeBox(10.0f, 0.0f, 20.0f)));
+		CHECK(lCuller.IsCasterRelevant(MakeBox(0.0f, 0.0f, 80.0f)));
+		CHECK(!lCuller.IsCasterRelevant(MakeBox(40.0f, 0.0f, 20.0f)));
+	}
+}
+
+TEST_CASE("Casters on the way from the light to a visible receiver are kept", "[shadow_culling]")
+{
+	const auto lCameraViewPrj = MakeCameraViewPrj();
+	std::mt19937 lRandom(31);
+	std::uniform_real_distribution<float> lX(-30.0f, 30.0f);
+	std::uniform_real_distribution<float> lZ(-10.0f, 60.0f);
+	std::uniform_real_distribution<float> lExtent(0.2f, 3.0f);
+	std::vector<BoundingBox> lScene;
+	for (int i = 0; i < 2000; ++i)
+	{
+		lScene.push_back(MakeBox(lX(lRandom), lX(lRandom), lZ(lRandom), lExtent(lRandom)));
+	}
+
+	ShadowCasterCuller lCuller;
+	lCuller.BeginFrame(MakeLightViewPrj());
+	std::vector<BoundingBox> lReceivers;
+	for (const auto& box : lScene)
+	{
+		if (IsInView(lCameraViewPrj, box))
+		{
+			lReceivers.push_back(box);
+			lCuller.AddReceiver(box);
+		}
+	}
+	REQUIRE(!lReceivers.empty());
+
+	uint32_t lCulled = 0;
+	uint32_t lKeptOutsideView = 0;
+	for (const auto& caster : lScene)
+	{
+		const bool lRelevant = lCuller.IsCasterRelevant(caster);
+		lCulled += lRelevant ? 0 : 1;
+		//The light ray to the center of a receiver passes through the caster,its shadow can land on it.
+		for (const auto& receiver : lReceivers)
+		{
+			if (SegmentHitsBox(LIGHT, receiver.Center, caster))
+			{
+				REQUIRE(lRelevant);
+				lKeptOutsideView += IsInView(lCameraViewPrj, caster) ? 0 : 1;
+				break;
+			}
+		}
+	}
+	CHECK(lCulled > lScene.size() / 4);
+	CHECK(lKeptOutsideView > 0);
+}
+
+TEST_CASE("Meshes that opted out of shadows are never counted as casters", "[shadow_culling]")
+{
+	ShadowCasterCuller lCuller;
+	lCuller.BeginFrame(MakeLightViewPrj());
+	lCuller.AddReceiver(MakeBox(0.0f, 0.0f, 20.0f));
+	const BoundingBox lUnitBox = MakeBox(0.0f, 0.0f, 0.0f);
+	const auto lBetween = SimpleMath::Matrix::CreateTranslation(0.0f, 0.0f, 10.0f);
+	const auto lBehind = SimpleMath::Matrix::CreateTranslation(0.0f, 0.0f, -20.0f);
+
+	CHECK(!lCuller.AddCandidate(lUnitBox, lBetween, false, true));
+	CHECK(!lCuller.AddCandidate(lUnitBox, lBehind, false, true));
+	CHECK(!lCuller.AddCandidate(lUnitBox, lBetween, false, false));
+	CHECK(lCuller.AddCandidate(lUnitBox, lBetween, true, true));
+	CHECK(!lCuller.AddCandidate(lUnitBox, lBehind, true, true));
+	//Culling switched off keeps every caster.
+	CHECK(lCuller.AddCandidate(lUnitBox, lBehind, true, false));
+
+	const ShadowCullStats lStats = lCuller.GetStats();
+	CHECK(lStats.mCandidates == 6);
+	CHECK(lStats.mOptedOut == 3);
+	CHECK(lStats.mCasters == 2);
+	CHECK(lStats.mCulled == 1);
+	CHECK(lStats.mCasters + lStats.mCulled + lStats.mOptedOut == lStats.mCandidates);
+
+	//Counted per frame.
+	lCuller.BeginFrame(MakeLightViewPrj());
+	CHECK(lCuller.GetStats().mCandidates == 0);
+}
@@ -0,0 +1,163 @@
+#include "staging_ring.h"
+#include "synthetic_scene.h"
+#include <catch2/catch.hpp>
+
+using namespace Renderer;
+
+TEST_CASE("Staging ring aligns allocations and fails when full", "[staging_ring]")
+{
+	StagingRing lRing(256);
+	CHECK(lRing.Allocate(10, 1) == 0);
+	CHECK(lRing.Allocate(10, 16) == 16);
+	CHECK(lRing.Allocate(1, 64) == 64);
+	CHECK(lRing.GetUsed() == 65);
+	CHECK(lRing.HasUnretired());
+
+	//191 bytes left,an aligned allocation has to fit after its padding.
+	CHECK(lRing.Allocate(192, 1) == UINT64_MAX);
+	CHECK(lRing.Allocate(128, 128) == 128);
+	CHECK(lRing.GetUsed() == 256);
+	CHECK(lRing.Allocate(1, 1) == UINT64_MAX);
+	//A failed allocation takes nothing.
+	CHECK(lRing.GetUsed() == 256);
+}
+
+TEST_CASE("Staging ring skips the end of the ring instead of straddling it", "[staging_ring]")
+{
+	StagingRing lRing(100);
+	CHECK(lRing.Allocate(60, 1) == 0);
+	lRing.Retire(1);
+	CHECK(lRing.Allocate(30, 1) == 60);
+	lRing.Retire(2);
+	CHECK(lRing.GetOldestRetired() == 1);
+
+	//20 bytes from the front would fit behind frame 1 once it completes,but not before.
+	CHECK(lRing.Allocate(20, 1) == UINT64_MAX);
+	lRing.Reclaim(1);
+	CHECK(lRing.GetUsed() == 30);
+	CHECK(lRing.GetOldestRetired() == 2);
+	//The 10 bytes at the end are padding,used until the wrapped allocation is freed.
+	CHECK(lRing.Allocate(20, 1) == 0);
+	CHECK(lRing.GetUsed() == 60);
+	lRing.Retire(3);
+
+	lRing.Reclaim(2);
+	CHECK(lRing.GetUsed() == 30);
+	lRing.Reclaim(3);
+	CHECK(lRing.GetUsed() == 0);
+	CHECK(lRing.GetOldestRetired() == 0);
+}
+
+TEST_CASE("Staging ring starts over at the front once it is empty", "[staging_ring]")
+{
+	StagingRing lRing(100);
+	CHECK(lRing.Allocate(70, 1) == 0);
+	lRing.Retire(1);
+	lRing.Reclaim(1);
+	REQUIRE(lRing.GetUsed() == 0);
+	//Without the reset 70 bytes from offset 70 would wrap and find only 70 free.
+	CHECK(lRing.Allocate(100, 1) == 0);
+	CHECK(lRing.GetUsed() == 100);
+	lRing.Retire(2);
+	lRing.Reclaim(2);
+	CHECK(lRing.Allocate(40, 4) == 0);
+	CHECK(lRing.HasUnretired());
+}
+
+TEST_CASE("Staging ring reclaims in allocation order whatever values complete", "[staging_ring]")
+{
+	StagingRing lRing(64);
+	CHECK(lRing.Allocate(16, 16) == 0);
+	lRing.Retire(2);
+	//Retiring with nothing new allocated adds no span.
+	lRing.Retire(3);
+	CHECK(lRing.Allocate(16, 16) == 16);
+	lRing.Retire(4);
+	CHECK(lRing.Allocate(16, 16) == 32);
+	lRing.Retire(4);
+	CHECK(lRing.Allocate(16, 16) == 48);
+	lRing.Retire(9);
+
+	//Completion values between and behind the retired ones free exactly the spans they cover.
+	lRing.Reclaim(1);
+	CHECK(lRing.GetUsed() == 64);
+	lRing.Reclaim(3);
+	CHECK(lRing.GetUsed() == 48);
+	CHECK(lRing.GetOldestRetired() == 4);
+	lRing.Reclaim(8);
+	CHECK(lRing.GetUsed() == 16);
+	//A stale completed value never gives space back twice or takes it away.
+	lRing.Reclaim(2);
+	CHECK(lRing.GetUsed() == 16);
+	CHECK(lRing.Allocate(32, 16) == 0);
+	lRing.Retire(10);
+	lRing.Reclaim(10);
+	CHECK(lRing.GetUsed() == 0);
+}
+
+TEST_CASE("Staging ring never hands out bytes still in flight", "[staging_ring]")
+{
+	constexpr uint64_t CAPACITY = 4096;
+	StagingRing lRing(CAPACITY);
+	std::mt19937 lRandom(7);
+	std::uniform_int_distribution<uint64_t> lSize(1, 900);
+	std::uniform_int_distribution<int> lAlignment(0, 4);
+	std::uniform_int_distribution<int> lAction(0, 9);
+
+	struct Span
+	{
+		uint64_t mOffset;
+		uint64_t mSize;
+		uint64_t mFenceValue;
+	};
+	std::vector<Span> lLive;
+	uint64_t lSignaled = 0;
+	uint64_t lCompleted = 0;
+	uint32_t lFailures = 0;
+	for (int step = 0; step < 20000; ++step)
+	{
+		const int lActionValue = lAction(lRandom);
+		if (lActionValue < 6)
+		{
+			const uint64_t lAlign = uint64_t(1) << (lAlignment(lRandom) * 2);
+			const uint64_t lBytes = lSize(lRandom);
+			const uint64_t lOffset = lRing.Allocate(lBytes, lAlign);
+			if (lOffset == UINT64_MAX)
+			{
+				lFailures++;
+				continue;
+			}
+			REQUIRE(lOffset % lAlign == 0);
+			REQUIRE(lOffset + lBytes <= CAPACITY);
+			for (const auto& span : lLive)
+			{
+				REQUIRE((lOffset + lBytes <= span.mOffset || span.mOffset + span.mSize <= lOffset));
+			}
+			lLive.push_back({ lOffset, lBytes, UINT64_MAX });
+		}
+		else if (lActionValue < 8)
+		{
+			lRing.Retire(++lSignaled);
+			for (auto& span : lLive)
+			{
+				span.mFenceValue = std::min(span.mFenceValue, lSignaled);
+			}
+		}
+		else
+		{
+			//The fake GPU completes a random amount of the submitted work.
+			lCompleted = std::uniform_int_distribution<uint64_t>(lCompleted, lSignaled)(lRandom);
+			lRing.Reclaim(lCompleted);
+			std::erase_if(lLive, [&](const Span& InSpan) { return InSpan.mFenceValue <= lCompleted; });
+		}
+		REQUIRE(lRing.GetUsed() <= CAPACITY);
+		uint64_t lLiveBytes = 0;
+		for (const auto& span : lLive)
+		{
+			lLiveBytes += span.mSize;
+		}
+		REQUIRE(lRing.GetUsed() >= lLiveBytes);
+	}
+	CHECK(lFailures > 0);
+	CHECK(lSignaled > 1000);
+}
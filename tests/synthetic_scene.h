@@ -0,0 +1,269 @@
+#pragma once
+#include "asset_registry.h"
+#include "zbin_light_cull.h"
+#include <spdlog/sinks/null_sink.h>
+
+//Procedural scenes shared by the tests and the benchmarks,nothing here touches a device.
+namespace Synthetic
+{
+	struct BoxMesh
+	{
+		std::vector<DirectX::XMFLOAT3> mPositions;
+		std::vector<uint32_t> mIndices;
+	};
+
+	//Closed box,clockwise seen from outside like every mesh the renderer draws (left handed,D3D12 default front face).
+	//Indices follow the corner order of DirectX::BoundingBox::GetCorners.
+	inline BoxMesh MakeBoxMesh(const DirectX::BoundingBox& InBox)
+	{
+		BoxMesh lMesh;
+		lMesh.mPositions.resize(DirectX::BoundingBox::CORNER_COUNT);
+		InBox.GetCorners(lMesh.mPositions.data());
+		lMesh.mIndices = {
+			4, 0, 3, 4, 3, 7,
+			2, 1, 5, 2, 5, 6,
+			1, 0, 4, 1, 4, 5,
+			3, 2, 6, 3, 6, 7,
+			5, 4, 7, 5, 7, 6,
+			3, 0, 1, 3, 1, 2 };
+		return lMesh;
+	}
+
+	//The reversed Z infinite projection PerspectCamera builds.
+	inline DirectX::SimpleMath::Matrix MakePrj(float InFovY, float InAspect, float InNear)
+	{
+		const float lYScale = 1.0f / std::tan(InFovY * 0.5f);
+		return DirectX::SimpleMath::Matrix(
+			lYScale / InAspect, 0.0f, 0.0f, 0.0f,
+			0.0f, lYScale, 0.0f, 0.0f,
+			0.0f, 0.0f, 0.0f, 1.0f,
+			0.0f, 0.0f, InNear, 0.0f);
+	}
+
+	//Row vector view projection with MakePrj.
+	inline DirectX::SimpleMath::Matrix MakeViewPrj(const DirectX::SimpleMath::Vector3& InEye, const DirectX::SimpleMath::Vector3& InTarget,
+		float InFovY, float InAspect, float InNear)
+	{
+		const DirectX::SimpleMath::Matrix lView = DirectX::XMMatrixLookAtLH(InEye, InTarget, DirectX::SimpleMath::Vector3(0.0f, 1.0f, 0.0f));
+		return lView * MakePrj(InFovY, InAspect, InNear);
+	}
+
+	//FrameData as BaseRenderer fills it for a PerspectCamera(InWidth,InHeight,InNear) at InEye looking at InTarget,
+	//matrices transposed for the GPU.The far plane only spaces the cluster slices and the depth bins.
+	inline Renderer::FrameData MakeFrameData(uint32_t InWidth, uint32_t InHeight, const DirectX::SimpleMath::Vector3& InEye, const DirectX::SimpleMath::Vector3& InTarget,
+		const Renderer::ClusterGrid& InGrid = {}, float InNear = 0.1f, float InFar = 120.0f)
+	{
+		using namespace DirectX;
+		const SimpleMath::Matrix lView = XMMatrixLookAtLH(InEye, InTarget, SimpleMath::Vector3(0.0f, 1.0f, 0.0f));
+		const float lAspect = float(InWidth) / float(InHeight);
+		float lFovY = 90.0f * XM_PI / 180.0f;
+		if (lAspect < 1.0f)
+		{
+			lFovY /= lAspect;
+		}
+		lFovY *= 0.5f;
+		const SimpleMath::Matrix lPrj(
+			1.0f / std::tan(lFovY), 0.0f, 0.0f, 0.0f,
+			0.0f, lAspect / std::tan(lFovY), 0.0f, 0.0f,
+			0.0f, 0.0f, 0.0f, 1.0f,
+			0.0f, 0.0f, InNear, 0.0f);
+
+		Renderer::FrameData lFrame = {};
+		const auto lGridParams = Renderer::Utils::GetLightGridZParams(InNear, InFar, InGrid.mZ, InGrid.mDistributionScale);
+		lFrame.LightGridZParams = SimpleMath::Vector4(lGridParams.x, lGridParams.y, lGridParams.z, 0.0f);
+		lFrame.ViewSizeAndInvSize = SimpleMath::Vector4(float(InWidth), float(InHeight), 1.0f / float(InWidth), 1.0f / float(InHeight));
+		lFrame.PrjView = (lView * lPrj).Transpose();
+		lFrame.View = lView.Transpose();
+		lFrame.Prj = lPrj.Transpose();
+		lFrame.ClipToView = lPrj.Invert().Transpose();
+		lFrame.ViewMatrix = lView.Transpose();
+		lFrame.InvDeviceZToWorldZTransform = Renderer::Utils::CreateInvDeviceZToWorldZTransform(lPrj);
+		lFrame.ZBinTileCountX = Renderer::ZBinLightCuller::GetTileCount(InWidth);
+		lFrame.ZBinScale = Renderer::ZBIN_COUNT / InFar;
+		lFrame.ClusterCountX = InGrid.mX;
+		lFrame.ClusterCountY = InGrid.mY;
+		lFrame.ClusterCountZ = InGrid.mZ;
+		return lFrame;
+	}
+
+	struct City
+	{
+		std::vector<DirectX::BoundingBox> mBuildings;
+		float mBlockPitch = 0.0f;
+	};
+
+	//InBlocksX by InBlocksZ buildings on a grid in front of the origin,with streets along x and z.
+	//An even InBlocksX leaves a street on x = 0,so a camera on the origin looks down an avenue.
+	inline City MakeCity(int InBlocksX, int InBlocksZ, float InBlockSize, float InStreetWidth, uint32_t InSeed)
+	{
+		City lCity;
+		lCity.mBlockPitch = InBlockSize + InStreetWidth;
+		std::mt19937 lRandom(InSeed);
+		std::uniform_real_distribution<float> lHeight(6.0f, 30.0f);
+		for (int z = 0; z < InBlocksZ; ++z)
+		{
+			for (int x = 0; x < InBlocksX; ++x)
+			{
+				const float lHeightValue = lHeight(lRandom);
+				const DirectX::XMFLOAT3 lCenter((x - (InBlocksX - 1) * 0.5f) * lCity.mBlockPitch, lHeightValue * 0.5f,
+					InStreetWidth + (z + 0.5f) * lCity.mBlockPitch);
+				lCity.mBuildings.emplace_back(lCenter, DirectX::XMFLOAT3(InBlockSize * 0.5f, lHeightValue * 0.5f, InBlockSize * 0.5f));
+			}
+		}
+		return lCity;
+	}
+
+	//One meshlet as triangles,wound so the normal of each faces away from the surface.
+	using MeshletTriangles = std::vector<std::array<DirectX::SimpleMath::Vector3, 3>>;
+
+	inline DirectX::SimpleMath::Vector3 GetTriangleNormal(const std::array<DirectX::SimpleMath::Vector3, 3>& InTriangle)
+	{
+		auto lNormal = (InTriangle[1] - InTriangle[0]).Cross(InTriangle[2] - InTriangle[0]);
+		lNormal.Normalize();
+		return lNormal;
+	}
+
+	//Unit sphere of InStacks x InSlices quads around the origin,InPatch x InPatch quads per meshlet.
+	inline std::vector<MeshletTriangles> MakeSphereMeshlets(uint32_t InStacks, uint32_t InSlices, uint32_t InPatch)
+	{
+		using namespace DirectX;
+		auto lPoint = [&](uint32_t InStack, uint32_t InSlice)
+			{
+				const float lTheta = XM_PI * float(InStack) / float(InStacks);
+				const float lPhi = XM_2PI * float(InSlice) / float(InSlices);
+				return SimpleMath::Vector3(std::sin(lTheta) * std::cos(lPhi), std::cos(lTheta), std::sin(lTheta) * std::sin(lPhi));
+			};
+		std::vector<MeshletTriangles> lMeshlets;
+		for (uint32_t stack = 0; stack < InStacks; stack += InPatch)
+		{
+			for (uint32_t slice = 0; slice < InSlices; slice += InPatch)
+			{
+				MeshletTriangles lMeshlet;
+				for (uint32_t y = stack; y < std::min(stack + InPatch, InStacks); ++y)
+				{
+					for (uint32_t x = slice; x < std::min(slice + InPatch, InSlices); ++x)
+					{
+						//The quads at the poles collapse into a single triangle.
+						const std::array<SimpleMath::Vector3, 3> lQuad[] = {
+							{ lPoint(y, x), lPoint(y, x + 1), lPoint(y + 1, x + 1) },
+							{ lPoint(y, x), lPoint(y + 1, x + 1), lPoint(y + 1, x) } };
+						for (auto triangle : lQuad)
+						{
+							if ((triangle[1] - triangle[0]).Cross(triangle[2] - triangle[0]).LengthSquared() < 1e-12f)
+							{
+								continue;
+							}
+							if (GetTriangleNormal(triangle).Dot(triangle[0] + triangle[1] + triangle[2]) < 0.0f)
+							{
+								std::swap(triangle[1], triangle[2]);
+							}
+							lMeshlet.push_back(triangle);
+						}
+					}
+				}
+				lMeshlets.push_back(std::move(lMeshlet));
+			}
+		}
+		return lMeshlets;
+	}
+
+	//What DirectX::ComputeCullData stores for a meshlet:bounding sphere,the normal cone in unorm bytes and the apex offset.
+	//The cutoff is taken against the quantized axis and rounded up,so the cone stays conservative.
+	inline DirectX::CullData MakeCullData(const MeshletTriangles& InTriangles)
+	{
+		using namespace DirectX;
+		SimpleMath::Vector3 lCenter;
+		SimpleMath::Vector3 lAxis;
+		for (const auto& triangle : InTriangles)
+		{
+			lCenter += (triangle[0] + triangle[1] + triangle[2]) / (3.0f * float(InTriangles.size()));
+			lAxis += GetTriangleNormal(triangle);
+		}
+		CullData lData = {};
+		lData.BoundingSphere.Center = lCenter;
+		lData.BoundingSphere.Radius = 0.0f;
+		for (const auto& triangle : InTriangles)
+		{
+			for (const auto& position : triangle)
+			{
+				lData.BoundingSphere.Radius = std::max(lData.BoundingSphere.Radius, (position - lCenter).Length() * 1.0001f);
+			}
+		}
+
+		lAxis.Normalize();
+		auto lQuantize = [](float InValue)
+			{
+				return uint32_t(std::clamp(std::round(InValue * 255.0f), 0.0f, 255.0f));
+			};
+		const uint32_t lAxisBytes = lQuantize(lAxis.x * 0.5f + 0.5f) | (lQuantize(lAxis.y * 0.5f + 0.5f) << 8) | (lQuantize(lAxis.z * 0.5f + 0.5f) << 16);
+		SimpleMath::Vector3 lQuantizedAxis(float(lAxisBytes & 0xff) * (2.0f / 255.0f) - 1.0f, float((lAxisBytes >> 8) & 0xff) * (2.0f / 255.0f) - 1.0f,
+			float((lAxisBytes >> 16) & 0xff) * (2.0f / 255.0f) - 1.0f);
+		lQuantizedAxis.Normalize();
+		float lMinDot = 1.0f;
+		for (const auto& triangle : InTriangles)
+		{
+			lMinDot = std::min(lMinDot, GetTriangleNormal(triangle).Dot(lQuantizedAxis));
+		}
+		//Normals spread over more than a hemisphere,the meshlet can never be back facing as a whole.
+		if (lMinDot <= 0.0f)
+		{
+			lData.NormalCone.v = 0xff000000u;
+			return lData;
+		}
+		const float lCutoff = std::sqrt(1.0f - lMinDot * lMinDot);
+		lData.NormalCone.v = lAxisBytes | (std::min(uint32_t(std::ceil(lCutoff * 255.0f)), 254u) << 24);
+		//Far enough behind the center that the apex is behind the plane of every triangle.
+		for (const auto& triangle : InTriangles)
+		{
+			const auto lNormal = GetTriangleNormal(triangle);
+			lData.ApexOffset = std::max(lData.ApexOffset, (lCenter - triangle[0]).Dot(lNormal) / lQuantizedAxis.Dot(lNormal));
+		}
+		return lData;
+	}
+
+	//Engine code logs through gLogger,which InitLog only creates when a GameEngine starts.
+	inline void EnsureLogger()
+	{
+		if (!gLogger)
+		{
+			gLogger = spdlog::null_logger_mt("tests");
+		}
+	}
+
+	//Installs a fresh AssetRegistry for the lifetime of a test,the engine normally creates it in InitAssetLoader.
+	struct ScopedAssetRegistry
+	{
+		ScopedAssetRegistry()
+		{
+			EnsureLogger();
+			AssetLoader::gAssetRegistry = new AssetLoader::AssetRegistry;
+		}
+
+		~ScopedAssetRegistry()
+		{
+			delete AssetLoader::gAssetRegistry;
+			AssetLoader::gAssetRegistry = nullptr;
+		}
+	};
+
+	//Unit cube with InSubMeshes submeshes of two triangles each,submesh i uses material i.
+	inline ECS::StaticMesh MakeCubeStaticMesh(uint32_t InSubMeshes, std::string InName)
+	{
+		ECS::StaticMesh lMesh = {};
+		const auto lBox = MakeBoxMesh(DirectX::BoundingBox(DirectX::XMFLOAT3(0.0f, 0.0f, 0.0f), DirectX::XMFLOAT3(0.5f, 0.5f, 0.5f)));
+		for (const auto& position : lBox.mPositions)
+		{
+			Renderer::Vertex lVertex = {};
+			lVertex.pos = { position.x, position.y, position.z, 1.0f };
+			lMesh.mVertices.push_back(lVertex);
+		}
+		for (uint32_t i = 0; i < InSubMeshes; ++i)
+		{
+			const uint32_t lFace = i % 6;
+			lMesh.mSubmeshMap[int(i)] = { int(lMesh.mIndices.size()), 2, 6 };
+			lMesh.mIndices.insert(lMesh.mIndices.end(), lBox.mIndices.begin() + lFace * 6, lBox.mIndices.begin() + lFace * 6 + 6);
+		}
+		lMesh.mName = std::move(InName);
+		return lMesh;
+	}
+}
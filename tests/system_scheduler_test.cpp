@@ -0,0 +1,111 @@
+#include "system_scheduler.h"
+#include "synthetic_scene.h"
+#include <catch2/catch.hpp>
+
+using namespace ECS;
+
+namespace
+{
+	struct Position
+	{
+		float mValue = 0.0f;
+	};
+
+	struct Velocity
+	{
+		float mValue = 0.0f;
+	};
+
+	//Logs when it runs and records a command logging its name at playback.
+	class LoggingSystem final : public System
+	{
+	public:
+		LoggingSystem(std::string_view InName, std::mutex& InMutex, std::vector<std::string>& OutUpdates, std::vector<std::string>& OutPlayback)
+			: System(InName), mMutex(InMutex), mUpdates(OutUpdates), mPlayback(OutPlayback)
+		{
+
+		}
+
+		void Update(entt::registry& InRegistry, EntityCommandBuffer& OutCommands, float InDelta) override
+		{
+			{
+				std::lock_guard lLock(mMutex);
+				mUpdates.push_back(GetName());
+			}
+			OutCommands.Run([this](entt::registry&, std::span<entt::entity>) { mPlayback.push_back(GetName()); });
+		}
+
+		template<typename... T>
+		void DeclareReads() { Reads<T...>(); }
+
+		template<typename... T>
+		void DeclareWrites() { Writes<T...>(); }
+
+	private:
+		std::mutex& mMutex;
+		std::vector<std::string>& mUpdates;
+		std::vector<std::string>& mPlayback;
+	};
+}
+
+TEST_CASE("Systems conflict when one writes a pool the other touches", "[system_scheduler]")
+{
+	std::mutex lMutex;
+	std::vector<std::string> lUpdates, lPlayback;
+	LoggingSystem lReader("reader", lMutex, lUpdates, lPlayback);
+	lReader.DeclareReads<Position>();
+	LoggingSystem lOtherReader("other reader", lMutex, lUpdates, lPlayback);
+	lOtherReader.DeclareReads<Position, Velocity>();
+	LoggingSystem lWriter("writer", lMutex, lUpdates, lPlayback);
+	lWriter.DeclareWrites<Velocity>();
+	LoggingSystem lOtherWriter("other writer", lMutex, lUpdates, lPlayback);
+	lOtherWriter.DeclareWrites<Velocity>();
+
+	CHECK_FALSE(lReader.GetAccess().Conflicts(lOtherReader.GetAccess()));
+	CHECK_FALSE(lReader.GetAccess().Conflicts(lWriter.GetAccess()));
+	CHECK(lOtherReader.GetAccess().Conflicts(lWriter.GetAccess()));
+	CHECK(lWriter.GetAccess().Conflicts(lOtherReader.GetAccess()));
+	CHECK(lWriter.GetAccess().Conflicts(lOtherWriter.GetAccess()));
+}
+
+TEST_CASE("Conflicting systems keep registration order and commands play back in it", "[system_scheduler]")
+{
+	Synthetic::EnsureLogger();
+	std::mutex lMutex;
+	std::vector<std::string> lUpdates, lPlayback;
+	SystemScheduler lScheduler;
+	auto lFirst = lScheduler.Register<LoggingSystem>("first", lMutex, lUpdates, lPlayback);
+	lFirst->DeclareWrites<Position>();
+	auto lIndependent = lScheduler.Register<LoggingSystem>("independent", lMutex, lUpdates, lPlayback);
+	lIndependent->DeclareWrites<Velocity>();
+	auto lSecond = lScheduler.Register<LoggingSystem>("second", lMutex, lUpdates, lPlayback);
+	lSecond->DeclareReads<Position>();
+	auto lThird = lScheduler.Register<LoggingSystem>("third", lMutex, lUpdates, lPlayback);
+	lThird->DeclareWrites<Position>();
+
+	tf::Executor lExecutor(4);
+	entt::registry lRegistry;
+	EntityCommandQueue lQueue;
+	for (int frame = 0; frame < 50; ++frame)
+	{
+		lUpdates.clear();
+		lPlayback.clear();
+		lScheduler.Run(lRegistry, lQueue, 0.016f, lExecutor);
+		lQueue.Playback(lRegistry);
+
+		REQUIRE(lUpdates.size() == 4);
+		auto lAt = [&lUpdates](std::string_view InName) { return std::find(lUpdates.begin(), lUpdates.end(), InName) - lUpdates.begin(); };
+		REQUIRE(lAt("first") < lAt("second"));
+		REQUIRE(lAt("second") < lAt("third"));
+		REQUIRE(lPlayback == std::vector<std::string>{ "first", "independent", "second", "third" });
+	}
+
+	//Disabling a system rebuilds the graph without it.
+	lSecond->mEnabled = false;
+	lUpdates.clear();
+	lPlayback.clear();
+	lScheduler.Run(lRegistry, lQueue, 0.016f, lExecutor);
+	lQueue.Playback(lRegistry);
+	CHECK(lPlayback == std::vector<std::string>{ "first", "independent", "third" });
+	CHECK(std::find(lUpdates.begin(), lUpdates.end(), "second") == lUpdates.end());
+}
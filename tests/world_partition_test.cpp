@@ -0,0 +1,190 @@
+#include "world_partition.h"
+#include "mesh_store.h"
+#include "synthetic_scene.h"
+#include <catch2/catch.hpp>
+
+using namespace GAS;
+
+namespace
+{
+	constexpr float CELL_SIZE = 32.0f;
+
+	//InCount cells in a row along +x,each filling its grid cell and weighing InBytes.
+	std::vector<WorldPartition::Cell> MakeRow(int32_t InCount, size_t InBytes)
+	{
+		std::vector<WorldPartition::Cell> lCells;
+		for (int32_t x = 0; x < InCount; ++x)
+		{
+			WorldPartition::Cell lCell;
+			lCell.mCoord = { x, 0 };
+			lCell.mBounds = DirectX::BoundingBox(DirectX::XMFLOAT3((x + 0.5f) * CELL_SIZE, 0.0f, 0.5f * CELL_SIZE),
+				DirectX::XMFLOAT3(0.5f * CELL_SIZE, 10.0f, 0.5f * CELL_SIZE));
+			lCell.mBytes = InBytes;
+			lCells.push_back(std::move(lCell));
+		}
+		return lCells;
+	}
+
+	std::vector<int32_t> SortedX(const std::vector<CellCoord>& InCoords)
+	{
+		std::vector<int32_t> lX;
+		for (auto coord : InCoords)
+		{
+			lX.push_back(coord.x);
+		}
+		std::sort(lX.begin(), lX.end());
+		return lX;
+	}
+
+	void LoadAll(WorldPartition& InPartition, const std::vector<CellCoord>& InCoords)
+	{
+		for (auto coord : InCoords)
+		{
+			InPartition.OnCellLoaded(coord, {}, {});
+		}
+	}
+
+	void UnloadAll(WorldPartition& InPartition, const std::vector<CellCoord>& InCoords)
+	{
+		for (auto coord : InCoords)
+		{
+			InPartition.OnCellUnloaded(coord);
+		}
+	}
+
+	DirectX::SimpleMath::Vector3 CellCenter(float InX)
+	{
+		return DirectX::SimpleMath::Vector3((InX + 0.5f) * CELL_SIZE, 0.0f, 0.5f * CELL_SIZE);
+	}
+}
+
+TEST_CASE("Cells load inside the load radius and only unload past the unload radius", "[world_partition]")
+{
+	StreamingSettings lSettings;
+	lSettings.mCellSize = CELL_SIZE;
+	lSettings.mLoadRadius = 40.0f;
+	lSettings.mUnloadRadius = 80.0f;
+	lSettings.mMaxConcurrentLoads = 2;
+	WorldPartition lPartition;
+	lPartition.Open(MakeRow(10, 1024), lSettings);
+
+	//Cells 1,2 and 0 are 0,9.6 and 22.4 away,cell 3 is 41.6 away.Nearest first.
+	auto lPlan = lPartition.Plan(CellCenter(1.2f));
+	CHECK(SortedX(lPlan.mLoad) == std::vector<int32_t>{ 1, 2 });
+	CHECK(lPlan.mUnload.empty());
+	CHECK(lPartition.GetCell({ 1, 0 })->mState == WorldPartition::CellState::LOADING);
+	CHECK(lPartition.GetCell({ 0, 0 })->mState == WorldPartition::CellState::UNLOADED);
+	//Two loads in flight,nothing else starts until one lands.
+	CHECK(lPartition.Plan(CellCenter(1.2f)).mLoad.empty());
+	CHECK(lPartition.GetStats().mLoadingCells == 2);
+	LoadAll(lPartition, lPlan.mLoad);
+	lPlan = lPartition.Plan(CellCenter(1.2f));
+	CHECK(SortedX(lPlan.mLoad) == std::vector<int32_t>{ 0 });
+	LoadAll(lPartition, lPlan.mLoad);
+	CHECK(lPartition.GetStats().mResidentCells == 3);
+	CHECK(lPartition.GetStats().mResidentBytes == 3 * 1024);
+
+	//Cell 0 is now 48 away,between the radii,so it stays.
+	lPlan = lPartition.Plan(CellCenter(2));
+	CHECK(lPlan.mUnload.empty());
+	CHECK(SortedX(lPlan.mLoad) == std::vector<int32_t>{ 3 });
+	LoadAll(lPartition, lPlan.mLoad);
+
+	//Moving back and forth across a cell border does not churn.
+	for (int i = 0; i < 4; ++i)
+	{
+		lPlan = lPartition.Plan(CellCenter(i % 2 == 0 ? 1.4f : 1.6f));
+		CHECK(lPlan.mLoad.empty());
+		CHECK(lPlan.mUnload.empty());
+	}
+
+	//Cell 0 is 112 away,cell 1 is 80 which is not past the unload radius.
+	lPlan = lPartition.Plan(CellCenter(4));
+	CHECK(SortedX(lPlan.mUnload) == std::vector<int32_t>{ 0 });
+	CHECK(SortedX(lPlan.mLoad) == std::vector<int32_t>{ 4, 5 });
+	UnloadAll(lPartition, lPlan.mUnload);
+	CHECK(lPartition.GetStats().mCellUnloads == 1);
+	CHECK(lPartition.GetCell({ 0, 0 })->mState == WorldPartition::CellState::UNLOADED);
+}
+
+TEST_CASE("Loads that do not fit the budget evict the farthest optional cells or wait", "[world_partition]")
+{
+	StreamingSettings lSettings;
+	lSettings.mCellSize = CELL_SIZE;
+	lSettings.mLoadRadius = 40.0f;
+	lSettings.mUnloadRadius = 200.0f;
+	lSettings.mMaxConcurrentLoads = 8;
+	lSettings.mMemoryBudget = 3 * 1000;
+	WorldPartition lPartition;
+	lPartition.Open(MakeRow(10, 1000), lSettings);
+
+	auto lPlan = lPartition.Plan(CellCenter(1));
+	CHECK(SortedX(lPlan.mLoad) == std::vector<int32_t>{ 0, 1, 2 });
+	LoadAll(lPartition, lPlan.mLoad);
+
+	//Cells 0 and 1 fall between the radii,the farthest one makes room for each new cell.
+	lPlan = lPartition.Plan(CellCenter(3));
+	CHECK(SortedX(lPlan.mLoad) == std::vector<int32_t>{ 3, 4 });
+	CHECK(SortedX(lPlan.mUnload) == std::vector<int32_t>{ 0, 1 });
+	CHECK(lPartition.GetStats().mBudgetDeferrals == 0);
+	UnloadAll(lPartition, lPlan.mUnload);
+	LoadAll(lPartition, lPlan.mLoad);
+	CHECK(lPartition.GetStats().mResidentBytes == 3 * 1000);
+
+	//Over a tighter budget the optional cell 2 goes,cells 5 and 6 still do not fit and are deferred.
+	lPartition.GetSettings().mMemoryBudget = 2 * 1000;
+	lPlan = lPartition.Plan(CellCenter(4.4f));
+	CHECK(SortedX(lPlan.mUnload) == std::vector<int32_t>{ 2 });
+	CHECK(lPlan.mLoad.empty());
+	CHECK(lPartition.GetStats().mBudgetDeferrals == 2);
+	UnloadAll(lPartition, lPlan.mUnload);
+	CHECK(lPartition.GetStats().mResidentBytes == 2 * 1000);
+	//Fits now.
+	lPlan = lPartition.Plan(CellCenter(4.4f));
+	CHECK(lPlan.mLoad.empty());
+	lPartition.GetSettings().mMemoryBudget = 3 * 1000;
+	lPlan = lPartition.Plan(CellCenter(4.4f));
+	CHECK(SortedX(lPlan.mLoad) == std::vector<int32_t>{ 5 });
+}
+
+TEST_CASE("Removed meshes give their submesh ranges back to the store", "[world_partition][mesh_store]")
+{
+	Synthetic::ScopedAssetRegistry lAssets;
+	ECS::MeshStore lStore;
+	std::vector<ECS::StaticMeshComponent> lComponents;
+	for (uint32_t i = 0; i < 4; ++i)
+	{
+		lComponents.push_back(lStore.Add(Synthetic::MakeCubeStaticMesh(i + 1, "mesh" + std::to_string(i))));
+	}
+	CHECK(lComponents[3].mFirstSubMesh == 6);
+	CHECK(lStore.GetSubMeshes(lComponents[2]).size() == 3);
+
+	//A hole in the middle is reused by a mesh that fits into it.
+	lStore.Remove(std::span(&lComponents[1], 1));
+	auto lRefill = lStore.Add(Synthetic::MakeCubeStaticMesh(1, "refill"));
+	CHECK(lRefill.mFirstSubMesh == 1);
+	auto lLarge = lStore.Add(Synthetic::MakeCubeStaticMesh(3, "large"));
+	CHECK(lLarge.mFirstSubMesh == 10);
+	//The submesh ranges of the meshes that stayed are untouched.
+	CHECK(lStore.GetSubMeshes(lComponents[3])[2].IndexOffset == 12);
+
+	//Streaming churn does not grow the table.
+	for (int cycle = 0; cycle < 100; ++cycle)
+	{
+		std::vector<ECS::StaticMeshComponent> lCell;
+		for (uint32_t i = 0; i < 5; ++i)
+		{
+			lCell.push_back(lStore.Add(Synthetic::MakeCubeStaticMesh(1 + (cycle + i) % 4, "cell")));
+			REQUIRE(lCell.back().mFirstSubMesh + lCell.back().mSubMeshCount <= 13 + 5 * 4);
+		}
+		lStore.Remove(lCell);
+	}
+
+	std::vector<ECS::StaticMeshComponent> lRest = { lComponents[0], lComponents[2], lComponents[3], lRefill, lLarge };
+	lStore.Remove(lRest);
+	CHECK(lStore.GetMeshHandles().empty());
+	CHECK(AssetLoader::gAssetRegistry->GetMeshes().GetStats().mLive == 0);
+	//Everything freed coalesces and trims,so the next mesh starts at the front again.
+	auto lFirst = lStore.Add(Synthetic::MakeCubeStaticMesh(2, "first"));
+	CHECK(lFirst.mFirstSubMesh == 0);
+}
@@ -0,0 +1,150 @@
+#include "zbin_light_cull.h"
+#include "light_buffer.h"
+#include "synthetic_scene.h"
+#include <catch2/catch.hpp>
+
+using namespace Renderer;
+using namespace DirectX;
+
+namespace
+{
+	constexpr uint32_t WIDTH = 640;
+	constexpr uint32_t HEIGHT = 360;
+
+	std::vector<ECS::LigthData> MakeLights(uint32_t InCount, uint32_t InSeed)
+	{
+		std::mt19937 lRandom(InSeed);
+		std::uniform_real_distribution<float> lX(-40.0f, 40.0f);
+		std::uniform_real_distribution<float> lY(-10.0f, 20.0f);
+		std::uniform_real_distribution<float> lZ(-20.0f, 100.0f);
+		std::uniform_real_distribution<float> lRange(1.0f, 12.0f);
+		std::vector<ECS::LigthData> lLights;
+		for (uint32_t i = 0; i < InCount; ++i)
+		{
+			ECS::LightComponent lLight;
+			lLight.pos = { lX(lRandom), lY(lRandom), lZ(lRandom), 1.0f };
+			lLight.radius_attenu = { lRange(lRandom), 1.0f, 0.0f, 0.0f };
+			lLights.push_back(LightBuffer::ToLightData(lLight));
+		}
+		return lLights;
+	}
+}
+
+TEST_CASE("Z-binned lights are found from every view point their bounding sphere holds", "[zbin_light_cull]")
+{
+	const SimpleMath::Vector3 lEye(2.0f, 4.0f, -3.0f);
+	const SimpleMath::Vector3 lTarget(0.0f, 0.0f, 40.0f);
+	auto lFrame = Synthetic::MakeFrameData(WIDTH, HEIGHT, lEye, lTarget);
+	const auto lLights = MakeLights(150, 17);
+	lFrame.LightCount = (uint32_t)lLights.size();
+
+	tf::Executor lExecutor(2);
+	ZBinLightCuller lCuller(lExecutor);
+	lCuller.Cull(lFrame, lLights, WIDTH, HEIGHT, true);
+	const auto& lStats = lCuller.GetStats();
+	CHECK(lStats.mLights == lLights.size());
+	CHECK(lStats.mWordsPerTile == 5);
+	CHECK(lStats.mTiles == ZBinLightCuller::GetTileCount(WIDTH) * ZBinLightCuller::GetTileCount(HEIGHT));
+
+	//The order is a permutation of the lights,sorted by the near end of their depth range.
+	const auto lOrder = lCuller.GetLightOrder();
+	std::vector<uint32_t> lPosition(lLights.size(), UINT32_MAX);
+	for (uint32_t s = 0; s < lOrder.size(); ++s)
+	{
+		REQUIRE(lOrder[s] < lLights.size());
+		REQUIRE(lPosition[lOrder[s]] == UINT32_MAX);
+		lPosition[lOrder[s]] = s;
+	}
+	const SimpleMath::Matrix lView = XMMatrixLookAtLH(lEye, lTarget, SimpleMath::Vector3(0.0f, 1.0f, 0.0f));
+	std::vector<SimpleMath::Vector3> lCenters;
+	for (const auto& light : lLights)
+	{
+		lCenters.push_back(SimpleMath::Vector3::Transform(SimpleMath::Vector3(light.bounds.x, light.bounds.y, light.bounds.z), lView));
+	}
+	for (uint32_t s = 1; s < lOrder.size(); ++s)
+	{
+		CHECK(lCenters[lOrder[s - 1]].z - lLights[lOrder[s - 1]].bounds.w <= lCenters[lOrder[s]].z - lLights[lOrder[s]].bounds.w + 1e-4f);
+	}
+
+	//Random pixels at random depths,a light whose sphere holds the view point must be inside the point's bin range
+	//and set in its tile mask.PerspectCamera sees 90 degrees horizontally.
+	const auto lBins = lCuller.GetBins();
+	const auto lMasks = lCuller.GetTileMasks();
+	const uint32_t lTileCountX = ZBinLightCuller::GetTileCount(WIDTH);
+	std::mt19937 lRandom(29);
+	std::uniform_int_distribution<uint32_t> lPixelX(0, WIDTH - 1);
+	std::uniform_int_distribution<uint32_t> lPixelY(0, HEIGHT - 1);
+	std::uniform_real_distribution<float> lDepth(0.1f, 110.0f);
+	uint32_t lHits = 0;
+	for (int sample = 0; sample < 20000; ++sample)
+	{
+		const uint32_t lX = lPixelX(lRandom);
+		const uint32_t lY = lPixelY(lRandom);
+		const float lZ = lDepth(lRandom);
+		const float lNdcX = (lX + 0.5f) / WIDTH * 2.0f - 1.0f;
+		const float lNdcY = 1.0f - (lY + 0.5f) / HEIGHT * 2.0f;
+		const SimpleMath::Vector3 lPoint(lNdcX * lZ, lNdcY * lZ * HEIGHT / WIDTH, lZ);
+		const auto& lBin = lBins[std::min(uint32_t(lZ * lFrame.ZBinScale), uint32_t(ZBIN_COUNT - 1))];
+		const uint32_t* lTileMask = lMasks.data() + size_t((lY / ZBIN_TILE_SIZE) * lTileCountX + lX / ZBIN_TILE_SIZE) * lStats.mWordsPerTile;
+		for (uint32_t i = 0; i < lLights.size(); ++i)
+		{
+			if ((lPoint - lCenters[i]).Length() >= lLights[i].bounds.w)
+			{
+				continue;
+			}
+			lHits++;
+			const uint32_t s = lPosition[i];
+			REQUIRE(lBin.mMin <= s);
+			REQUIRE(s <= lBin.mMax);
+			REQUIRE((lTileMask[s / 32] & (1u << (s % 32))) != 0);
+		}
+	}
+	CHECK(lHits > 1000);
+}
+
+TEST_CASE("Z-bin tile masks match the tile rects and lights behind the eye touch nothing", "[zbin_light_cull]")
+{
+	auto lFrame = Synthetic::MakeFrameData(WIDTH, HEIGHT, { 0.0f, 0.0f, 0.0f }, { 0.0f, 0.0f, 1.0f });
+	auto lLights = MakeLights(40, 3);
+	ECS::LightComponent lBehind;
+	lBehind.pos = { 0.0f, 0.0f, -30.0f, 1.0f };
+	lBehind.radius_attenu = { 5.0f, 1.0f, 0.0f, 0.0f };
+	lLights.push_back(LightBuffer::ToLightData(lBehind));
+	lFrame.LightCount = (uint32_t)lLights.size();
+
+	tf::Executor lExecutor(2);
+	ZBinLightCuller lCuller(lExecutor);
+	lCuller.Cull(lFrame, lLights, WIDTH, HEIGHT, true);
+	const auto lOrder = lCuller.GetLightOrder();
+	const auto lRects = lCuller.GetTileRects();
+	const auto lMasks = lCuller.GetTileMasks();
+	const uint32_t lWords = lCuller.GetStats().mWordsPerTile;
+	const int32_t lTileCountX = (int32_t)ZBinLightCuller::GetTileCount(WIDTH);
+	const int32_t lTileCountY = (int32_t)ZBinLightCuller::GetTileCount(HEIGHT);
+
+	//The light behind the eye sorts first and has no tiles and no bins.
+	REQUIRE(lOrder[0] == lLights.size() - 1);
+	CHECK(lRects[0].mMinX > lRects[0].mMaxX);
+	for (const auto& bin : lCuller.GetBins())
+	{
+		CHECK((bin.mMin > bin.mMax || bin.mMin > 0));
+	}
+
+	uint32_t lBits = 0;
+	for (int32_t y = 0; y < lTileCountY; ++y)
+	{
+		for (int32_t x = 0; x < lTileCountX; ++x)
+		{
+			const uint32_t* lTileMask = lMasks.data() + size_t(y * lTileCountX + x) * lWords;
+			for (uint32_t s = 0; s < lOrder.size(); ++s)
+			{
+				const auto& lRect = lRects[s];
+				const bool lInside = x >= lRect.mMinX && x <= lRect.mMaxX && y >= lRect.mMinY && y <= lRect.mMaxY;
+				REQUIRE(((lTileMask[s / 32] >> (s % 32)) & 1u) == uint32_t(lInside));
+				lBits += lInside;
+			}
+		}
+	}
+	CHECK(lBits == lCuller.GetStats().mTileAssignments);
+	CHECK(lBits > 0);
+}